@@ -0,0 +1,552 @@
+//------------------------------------------------------------------------------
+// File: AuthTransport.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2013 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/eventfd.h>
+/*----------------------------------------------------------------------------*/
+#include "AuthTransport.hh"
+/*----------------------------------------------------------------------------*/
+
+EOSAUTHNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+AuthTransport::AuthTransport(zmq::context_t* context, int timeout):
+  eos::common::LogId(),
+  mZmqContext(context),
+  mTimeout(timeout),
+  mThread(0),
+  mStarted(false),
+  mStop(false),
+  mEventFd(-1),
+  mMaster(0),
+  mLastId(0)
+{ }
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+AuthTransport::~AuthTransport()
+{
+  Stop();
+
+  for (auto it = mBackends.begin(); it != mBackends.end(); ++it)
+    delete it->second;
+
+  if (mEventFd != -1)
+    close(mEventFd);
+}
+
+
+//------------------------------------------------------------------------------
+// Add an MGM endpoint
+//------------------------------------------------------------------------------
+void
+AuthTransport::AddBackend(const std::string& endpoint)
+{
+  mBackends.push_back(std::make_pair(endpoint, (zmq::socket_t*)0));
+}
+
+
+//------------------------------------------------------------------------------
+// Connect to the MGM nodes and start the I/O thread
+//------------------------------------------------------------------------------
+bool
+AuthTransport::Start()
+{
+  if (mStarted)
+    return true;
+
+  if (mBackends.empty())
+  {
+    eos_err("no MGM endpoint configured");
+    return false;
+  }
+
+  mEventFd = eventfd(0, EFD_NONBLOCK);
+
+  if (mEventFd == -1)
+  {
+    eos_err("unable to create the eventfd errno=%i", errno);
+    return false;
+  }
+
+  // The sockets are created here and then only used by the I/O thread - the
+  // thread creation acts as a full memory barrier
+  for (auto it = mBackends.begin(); it != mBackends.end(); ++it)
+  {
+    std::ostringstream sstr;
+    sstr << "tcp://" << it->first;
+
+    try
+    {
+      it->second = new zmq::socket_t(*mZmqContext, ZMQ_DEALER);
+      int linger = 0;
+      it->second->setsockopt(ZMQ_LINGER, &linger, sizeof linger);
+      it->second->connect(sstr.str().c_str());
+    }
+    catch (zmq::error_t& err)
+    {
+      eos_err("unable to connect to MGM %s: %s", it->first.c_str(), err.what());
+      return false;
+    }
+
+    eos_info("connected to MGM: %s", it->first.c_str());
+  }
+
+  mStop = false;
+
+  if (XrdSysThread::Run(&mThread, AuthTransport::StartIoThread,
+                        static_cast<void*>(this), XRDSYSTHREAD_HOLD,
+                        "Auth Transport Thread"))
+  {
+    eos_err("cannot start the authentication transport thread");
+    return false;
+  }
+
+  mStarted = true;
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Stop the I/O thread and fail all the requests in flight
+//------------------------------------------------------------------------------
+void
+AuthTransport::Stop()
+{
+  if (!mStarted)
+    return;
+
+  uint64_t one = 1;
+  mStop = true;
+
+  if (write(mEventFd, &one, sizeof one) != sizeof one)
+    eos_warning("unable to wake up the transport thread");
+
+  XrdSysThread::Join(mThread, 0);
+  XrdSysMutexHelper scope_lock(mMutex);
+  mStarted = false;
+
+  while (!mOutgoing.empty())
+  {
+    delete mOutgoing.front();
+    mOutgoing.pop_front();
+  }
+
+  for (auto it = mPending.begin(); it != mPending.end(); ++it)
+  {
+    XrdSysCondVarHelper cond_lock(it->second->mCond);
+    it->second->mDone = true;
+    it->second->mCond.Signal();
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Queue a request for the current master MGM
+//------------------------------------------------------------------------------
+uint64_t
+AuthTransport::Send(zmq::message_t& request, int timeout)
+{
+  OutgoingRequest* out = new OutgoingRequest();
+  PendingRequest* pending = new PendingRequest();
+  pending->mDeadline = GetTimeMs() + (timeout ? timeout : mTimeout);
+  out->mDeadline = pending->mDeadline;
+  out->mMsg.move(&request);
+  uint64_t id;
+  bool wakeup;
+  {
+    XrdSysMutexHelper scope_lock(mMutex);
+
+    if (!mStarted || mStop)
+    {
+      delete out;
+      delete pending;
+      return 0;
+    }
+
+    // Once queued the request belongs to the I/O thread
+    id = out->mId = ++mLastId;
+    mPending[id] = pending;
+    wakeup = mOutgoing.empty();
+    mOutgoing.push_back(out);
+  }
+
+  // The I/O thread drains the whole queue once woken up
+  if (wakeup)
+  {
+    uint64_t one = 1;
+
+    if (write(mEventFd, &one, sizeof one) != sizeof one)
+      eos_err("unable to wake up the transport thread errno=%i", errno);
+  }
+
+  return id;
+}
+
+
+//------------------------------------------------------------------------------
+// Wait for the reply of a request until its deadline
+//------------------------------------------------------------------------------
+bool
+AuthTransport::Recv(uint64_t id, zmq::message_t& reply)
+{
+  PendingRequest* pending = 0;
+  {
+    XrdSysMutexHelper scope_lock(mMutex);
+    auto it = mPending.find(id);
+
+    if (it == mPending.end())
+      return false;
+
+    pending = it->second;
+  }
+  bool ok = false;
+  {
+    XrdSysCondVarHelper cond_lock(pending->mCond);
+
+    while (!pending->mDone)
+    {
+      uint64_t now = GetTimeMs();
+
+      if (now >= pending->mDeadline)
+        break;
+
+      pending->mCond.WaitMS(pending->mDeadline - now);
+    }
+  }
+  {
+    // Once removed from the map the I/O thread can't touch it anymore
+    XrdSysMutexHelper scope_lock(mMutex);
+    mPending.erase(id);
+  }
+
+  if (pending->mOk)
+  {
+    reply.move(&pending->mReply);
+    ok = true;
+  }
+  else if (!pending->mDone)
+  {
+    eos_err("request id=%llu timed out", (unsigned long long)id);
+  }
+
+  delete pending;
+  return ok;
+}
+
+
+//------------------------------------------------------------------------------
+// Send the following requests to another MGM node
+//------------------------------------------------------------------------------
+bool
+AuthTransport::UpdateMaster(const std::string& redirect_host)
+{
+  eos_debug("redirect_host:%s", redirect_host.c_str());
+
+  for (size_t i = 0; i < mBackends.size(); ++i)
+  {
+    if (mBackends[i].first.find(redirect_host) != std::string::npos)
+    {
+      XrdSysMutexHelper scope_lock(mMutex);
+      mMaster = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+//------------------------------------------------------------------------------
+// Get the number of requests waiting for a reply
+//------------------------------------------------------------------------------
+size_t
+AuthTransport::GetNumInFlight()
+{
+  XrdSysMutexHelper scope_lock(mMutex);
+  return mPending.size();
+}
+
+
+//------------------------------------------------------------------------------
+// I/O thread startup function
+//------------------------------------------------------------------------------
+void*
+AuthTransport::StartIoThread(void* pp)
+{
+  AuthTransport* transport = static_cast<AuthTransport*>(pp);
+  transport->IoThread();
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// I/O thread which sends the queued requests and dispatches the replies
+//------------------------------------------------------------------------------
+void
+AuthTransport::IoThread()
+{
+  std::vector<zmq_pollitem_t> items(mBackends.size() + 1);
+  items[0].socket = 0;
+  items[0].fd = mEventFd;
+  items[0].events = ZMQ_POLLIN;
+
+  for (size_t i = 0; i < mBackends.size(); ++i)
+  {
+    items[i + 1].socket = static_cast<void*>(*mBackends[i].second);
+    items[i + 1].fd = 0;
+  }
+
+  bool held = false; // requests are queued until the master takes them
+  size_t master = 0;
+
+  while (!mStop)
+  {
+    for (size_t i = 0; i < mBackends.size(); ++i)
+      items[i + 1].events = ZMQ_POLLIN;
+
+    if (held)
+      items[master + 1].events |= ZMQ_POLLOUT;
+
+    try
+    {
+      // While requests are held the deadlines are checked periodically
+      zmq::poll(&items[0], items.size(), held ? sHoldPollMs : -1);
+    }
+    catch (zmq::error_t& err)
+    {
+      if (err.num() == EINTR)
+        continue;
+
+      eos_err("error in poll: %s", err.what());
+      break;
+    }
+
+    bool send = held;
+
+    if (items[0].revents & ZMQ_POLLIN)
+    {
+      uint64_t count;
+
+      if (read(mEventFd, &count, sizeof count) < 0)
+        eos_debug("eventfd read errno=%i", errno);
+
+      if (mStop)
+        break;
+
+      send = true;
+    }
+
+    if (send)
+      held = SendQueued(master);
+
+    for (size_t i = 0; i < mBackends.size(); ++i)
+    {
+      if (items[i + 1].revents & ZMQ_POLLIN)
+        DispatchReplies(mBackends[i].second);
+    }
+  }
+
+  eos_info("authentication transport thread exiting");
+}
+
+
+//------------------------------------------------------------------------------
+// Send all the queued requests to the current master MGM
+//------------------------------------------------------------------------------
+bool
+AuthTransport::SendQueued(size_t& master)
+{
+  std::deque<OutgoingRequest*> queued;
+  {
+    XrdSysMutexHelper scope_lock(mMutex);
+    queued.swap(mOutgoing);
+    master = mMaster;
+  }
+  zmq::socket_t* socket = mBackends[master].second;
+  uint64_t now = GetTimeMs();
+
+  while (!queued.empty())
+  {
+    OutgoingRequest* out = queued.front();
+
+    if (now >= out->mDeadline)
+    {
+      eos_err("request id=%llu not taken by the MGM before its deadline",
+              (unsigned long long)out->mId);
+      Complete(out->mId, 0);
+      queued.pop_front();
+      delete out;
+      continue;
+    }
+
+    // Envelope: request id and the delimiter expected by the REP workers
+    zmq::message_t id_frame(sizeof(out->mId));
+    zmq::message_t delim_frame;
+    memcpy(id_frame.data(), &out->mId, sizeof(out->mId));
+    bool sent = false;
+    bool again = false;
+
+    try
+    {
+      // A multi-part message is queued atomically, if the first part is
+      // refused (EAGAIN) nothing was sent and the request can be retried
+      again = !socket->send(id_frame, ZMQ_SNDMORE | ZMQ_NOBLOCK);
+      sent = (!again &&
+              socket->send(delim_frame, ZMQ_SNDMORE | ZMQ_NOBLOCK) &&
+              socket->send(out->mMsg, ZMQ_NOBLOCK));
+    }
+    catch (zmq::error_t& err)
+    {
+      eos_err("exception while sending request: %s", err.what());
+    }
+
+    if (again)
+      break;
+
+    queued.pop_front();
+
+    if (!sent)
+    {
+      eos_err("unable to send request id=%llu to the MGM",
+              (unsigned long long)out->mId);
+      Complete(out->mId, 0);
+    }
+
+    delete out;
+  }
+
+  if (queued.empty())
+    return false;
+
+  // Keep the held requests ahead of the ones queued in the meantime
+  XrdSysMutexHelper scope_lock(mMutex);
+  mOutgoing.insert(mOutgoing.begin(), queued.begin(), queued.end());
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Receive the replies available on a socket and hand them to the waiting
+// threads
+//------------------------------------------------------------------------------
+void
+AuthTransport::DispatchReplies(zmq::socket_t* socket)
+{
+  int more;
+  size_t moresz;
+
+  while (true)
+  {
+    zmq::message_t frame;
+    zmq::message_t reply;
+    uint64_t id = 0;
+    int nframes = 0;
+
+    try
+    {
+      if (!socket->recv(&frame, ZMQ_NOBLOCK))
+        return;
+
+      // Reply: request id, delimiter, response
+      do
+      {
+        if (nframes == 0 && frame.size() == sizeof(id))
+          memcpy(&id, frame.data(), sizeof(id));
+
+        reply.move(&frame);
+        nframes++;
+        moresz = sizeof more;
+        socket->getsockopt(ZMQ_RCVMORE, &more, &moresz);
+
+        if (more && !socket->recv(&frame))
+          return;
+      }
+      while (more);
+    }
+    catch (zmq::error_t& err)
+    {
+      eos_err("exception while receiving reply: %s", err.what());
+      return;
+    }
+
+    if (nframes != 3 || !id)
+    {
+      eos_err("discard malformed reply with %i frames", nframes);
+      continue;
+    }
+
+    Complete(id, &reply);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Mark a request as done and wake up the thread waiting for it
+//------------------------------------------------------------------------------
+void
+AuthTransport::Complete(uint64_t id, zmq::message_t* reply)
+{
+  XrdSysMutexHelper scope_lock(mMutex);
+  auto it = mPending.find(id);
+
+  if (it == mPending.end())
+  {
+    eos_debug("drop reply for request id=%llu past its deadline",
+              (unsigned long long)id);
+    return;
+  }
+
+  PendingRequest* pending = it->second;
+  XrdSysCondVarHelper cond_lock(pending->mCond);
+
+  if (reply)
+  {
+    pending->mReply.move(reply);
+    pending->mOk = true;
+  }
+
+  pending->mDone = true;
+  pending->mCond.Signal();
+}
+
+
+//------------------------------------------------------------------------------
+// Get the current time in milliseconds since the epoch
+//------------------------------------------------------------------------------
+uint64_t
+AuthTransport::GetTimeMs()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+EOSAUTHNAMESPACE_END
@@ -0,0 +1,226 @@
+//------------------------------------------------------------------------------
+// File: AuthTransport.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2013 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSAUTH_TRANSPORT_HH__
+#define __EOSAUTH_TRANSPORT_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+#include "common/ZMQ.hh"
+#include "common/Logging.hh"
+#include "Namespace.hh"
+/*----------------------------------------------------------------------------*/
+
+EOSAUTHNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class AuthTransport
+//!
+//! @description Asynchronous transport between the authentication proxy and
+//!   the MGM nodes. All the requests are multiplexed over one ZMQ_DEALER
+//!   socket per MGM node by a single I/O thread, so the number of requests in
+//!   flight is not bounded by a pool of sockets. Each request is prefixed by
+//!   a frame holding its id, which the MGM (ROUTER -> DEALER -> REP workers)
+//!   sends back as part of the reply envelope. The I/O thread uses it to hand
+//!   the reply to the thread waiting for it. Every request has a deadline,
+//!   until then it stays queued if the MGM can't take it yet and replies
+//!   arriving after it are dropped.
+//------------------------------------------------------------------------------
+class AuthTransport: public eos::common::LogId
+{
+public:
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param context ZMQ context used for the sockets
+  //! @param timeout default deadline of a request in milliseconds
+  //----------------------------------------------------------------------------
+  AuthTransport(zmq::context_t* context, int timeout);
+
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  virtual ~AuthTransport();
+
+
+  //----------------------------------------------------------------------------
+  //! Add an MGM endpoint, the first one added is the initial master
+  //!
+  //! @param endpoint MGM endpoint in the format "host:port"
+  //----------------------------------------------------------------------------
+  void AddBackend(const std::string& endpoint);
+
+
+  //----------------------------------------------------------------------------
+  //! Connect to the MGM nodes and start the I/O thread
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool Start();
+
+
+  //----------------------------------------------------------------------------
+  //! Stop the I/O thread and fail all the requests in flight
+  //----------------------------------------------------------------------------
+  void Stop();
+
+
+  //----------------------------------------------------------------------------
+  //! Queue a request for the current master MGM
+  //!
+  //! @param request serialized request, its content is taken over
+  //! @param timeout deadline of the request in milliseconds, if 0 the
+  //!                default one is used
+  //!
+  //! @return id of the request to be passed to Recv, 0 if it failed
+  //----------------------------------------------------------------------------
+  uint64_t Send(zmq::message_t& request, int timeout = 0);
+
+
+  //----------------------------------------------------------------------------
+  //! Wait for the reply of a request until its deadline
+  //!
+  //! @param id id of the request returned by Send
+  //! @param reply placeholder for the serialized reply
+  //!
+  //! @return true if the reply arrived, otherwise false
+  //----------------------------------------------------------------------------
+  bool Recv(uint64_t id, zmq::message_t& reply);
+
+
+  //----------------------------------------------------------------------------
+  //! Send the following requests to another MGM node
+  //!
+  //! @param redirect_host host (and port) of the new master MGM
+  //!
+  //! @return true if the host is one of our MGM nodes, otherwise false
+  //----------------------------------------------------------------------------
+  bool UpdateMaster(const std::string& redirect_host);
+
+
+  //----------------------------------------------------------------------------
+  //! Get the number of requests waiting for a reply
+  //----------------------------------------------------------------------------
+  size_t GetNumInFlight();
+
+private:
+
+  //----------------------------------------------------------------------------
+  //! Request waiting for a reply
+  //----------------------------------------------------------------------------
+  struct PendingRequest
+  {
+    PendingRequest(): mCond(0), mDeadline(0), mDone(false), mOk(false) {}
+
+    XrdSysCondVar mCond; ///< signalled once the request is done
+    uint64_t mDeadline; ///< deadline as milliseconds since the epoch
+    bool mDone; ///< reply received or request failed
+    bool mOk; ///< reply received
+    zmq::message_t mReply; ///< serialized reply
+  };
+
+  //----------------------------------------------------------------------------
+  //! Request queued for the I/O thread
+  //----------------------------------------------------------------------------
+  struct OutgoingRequest
+  {
+    uint64_t mId; ///< id of the request
+    uint64_t mDeadline; ///< deadline as milliseconds since the epoch
+    zmq::message_t mMsg; ///< serialized request
+  };
+
+  //! Poll interval of the I/O thread while the master can't take requests
+  static const int sHoldPollMs = 100;
+
+  zmq::context_t* mZmqContext; ///< ZMQ context
+  int mTimeout; ///< default deadline of a request in milliseconds
+  pthread_t mThread; ///< I/O thread id
+  bool mStarted; ///< the I/O thread is running
+  volatile bool mStop; ///< ask the I/O thread to exit
+  int mEventFd; ///< wakes up the I/O thread when requests are queued
+  //! MGM endpoints and the corresponding sockets, only used by the I/O thread
+  std::vector< std::pair<std::string, zmq::socket_t*> > mBackends;
+  XrdSysMutex mMutex; ///< protects all the members below
+  size_t mMaster; ///< index of the master MGM in mBackends
+  uint64_t mLastId; ///< id of the last request
+  std::deque<OutgoingRequest*> mOutgoing; ///< requests to be sent
+  std::unordered_map<uint64_t, PendingRequest*> mPending; ///< requests in flight
+
+
+  //----------------------------------------------------------------------------
+  //! I/O thread startup function
+  //----------------------------------------------------------------------------
+  static void* StartIoThread(void* pp);
+
+
+  //----------------------------------------------------------------------------
+  //! I/O thread which sends the queued requests and dispatches the replies
+  //----------------------------------------------------------------------------
+  void IoThread();
+
+
+  //----------------------------------------------------------------------------
+  //! Send all the queued requests to the current master MGM. The requests the
+  //! master can't take yet (no connection, high water mark) stay queued until
+  //! their deadline.
+  //!
+  //! @param master set to the index of the master MGM in mBackends
+  //!
+  //! @return true if requests are still queued, otherwise false
+  //----------------------------------------------------------------------------
+  bool SendQueued(size_t& master);
+
+
+  //----------------------------------------------------------------------------
+  //! Receive the replies available on a socket and hand them to the waiting
+  //! threads
+  //!
+  //! @param socket socket facing an MGM node
+  //----------------------------------------------------------------------------
+  void DispatchReplies(zmq::socket_t* socket);
+
+
+  //----------------------------------------------------------------------------
+  //! Mark a request as done and wake up the thread waiting for it
+  //!
+  //! @param id id of the request
+  //! @param reply serialized reply or 0 if the request failed
+  //----------------------------------------------------------------------------
+  void Complete(uint64_t id, zmq::message_t* reply);
+
+
+  //----------------------------------------------------------------------------
+  //! Get the current time in milliseconds since the epoch
+  //----------------------------------------------------------------------------
+  static uint64_t GetTimeMs();
+};
+
+EOSAUTHNAMESPACE_END
+
+#endif //__EOSAUTH_TRANSPORT_HH__
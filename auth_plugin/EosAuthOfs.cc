@@ -30,6 +30,7 @@
 #include <zlib.h>
 /*----------------------------------------------------------------------------*/
 #include "EosAuthOfs.hh"
+#include "AuthTransport.hh"
 #include "ProtoUtils.hh"
 #include "EosAuthOfsDirectory.hh"
 #include "EosAuthOfsFile.hh"
@@ -88,14 +89,12 @@ EOSAUTHNAMESPACE_BEGIN
 EosAuthOfs::EosAuthOfs():
   XrdOfs(),
   eos::common::LogId(),
-  proxy_tid(0),
-  mSizePoolSocket(5),
+  mTransport(0),
+  mTimeout(5),
   mLogLevel(LOG_INFO)
 {
   // Initialise the ZMQ client
   mZmqContext = new zmq::context_t(1);
-  mBackend1 = std::make_pair(std::string(""), (zmq::socket_t*)0);
-  mBackend2 = std::make_pair(std::string(""), (zmq::socket_t*)0);
 
   // Set Logging parameters
   XrdOucString unit = "auth@localhost";
@@ -113,22 +112,8 @@ EosAuthOfs::EosAuthOfs():
 //------------------------------------------------------------------------------
 EosAuthOfs::~EosAuthOfs()
 {
-  zmq::socket_t* socket;
-
-  // Kill the auth proxy thread
-  if (proxy_tid)
-  {
-    XrdSysThread::Cancel(proxy_tid);
-    XrdSysThread::Join(proxy_tid, 0);
-  }
-
-  // Release memory    
-  while (mPoolSocket.try_pop(socket))
-    delete socket;
-
-  delete mFrontend;
-  delete mBackend1.second;
-  delete mBackend2.second;
+  // Stop the transport thread and close its sockets before the context
+  delete mTransport;
   delete mZmqContext;
 }
 
@@ -195,7 +180,7 @@ EosAuthOfs::Configure(XrdSysError& error)
             mgm_instance = val;
 
             if (mgm_instance.find(":") != string::npos)
-              mBackend1 = std::make_pair(mgm_instance, (zmq::socket_t*)0);
+              mBackend1 = mgm_instance;
           }
           else
           {
@@ -215,19 +200,29 @@ EosAuthOfs::Configure(XrdSysError& error)
             mgm_instance = val;
 
             if (mgm_instance.find(":") != string::npos)
-              mBackend2 = std::make_pair(mgm_instance, (zmq::socket_t*)0);
+              mBackend2 = mgm_instance;
           }
         }
 
-        // Get number of sockets in the pool by default 10
-        option_tag = "numsockets";
+        // Get the deadline of a request in seconds by default 5
+        option_tag = "timeout";
 
         if (!strncmp(var, option_tag.c_str(), option_tag.length()))
         {
-          if (!(val = Config.GetWord()))
-            error.Emsg("Configure ", "No number of sockets specified");
+          if (!(val = Config.GetWord()) || (atoi(val) <= 0))
+            error.Emsg("Configure ", "No valid request timeout specified");
           else
-            mSizePoolSocket = atoi(val);
+            mTimeout = atoi(val);
+        }
+
+        // The socket pool is gone, all requests share one socket per MGM
+        option_tag = "numsockets";
+
+        if (!strncmp(var, option_tag.c_str(), option_tag.length()))
+        {
+          Config.GetWord();
+          error.Say("=====> eosauth.numsockets is deprecated and ignored, "
+                    "requests are multiplexed over one socket per MGM");
         }
         
         // Get log level by default LOG_INFO
@@ -266,44 +261,22 @@ EosAuthOfs::Configure(XrdSysError& error)
     }
 
     // Check and connect at least to an MGM master
-    if (!mBackend1.first.empty())
+    if (!mBackend1.empty())
     {
-      if ((XrdSysThread::Run(&proxy_tid, EosAuthOfs::StartAuthProxyThread,
-                             static_cast<void *>(this), 0, "Auth Proxy Thread")))
-      {
-        eos_err("cannot start the authentication proxy thread");
-        NoGo = 1;
-      }    
-      
-      // Create a pool of sockets connected to the master proxy service 
-      for (int i = 0; i < mSizePoolSocket; i++)
+      mTransport = new AuthTransport(mZmqContext, mTimeout * 1000);
+      mTransport->AddBackend(mBackend1);
+      OfsEroute.Say("=====> master MGM: ", mBackend1.c_str());
+
+      if (!mBackend2.empty())
       {
-        // Set socket receive timeout to 5 seconds
-        zmq::socket_t* socket = new zmq::socket_t(*mZmqContext, ZMQ_REQ);
-#if ZMQ_VERSION >= 20200
-        int timeout_mili = 5000;
-        socket->setsockopt(ZMQ_RCVTIMEO, &timeout_mili, sizeof timeout_mili);
-#endif
-        std::string endpoint = "inproc://proxyfrontend";
-        
-        // Try in a loop to connect to the proxyfrontend as it can take a while for
-        // the poxy thread to do the binding, therefore connect can fail
-        while (1)
-        {
-          try
-          {
-            socket->connect(endpoint.c_str());
-          }
-          catch (zmq::error_t& err)
-          {
-            eos_warning("dealing with connect exception, retrying ...");
-            continue;
-          }
+        mTransport->AddBackend(mBackend2);
+        OfsEroute.Say("=====> slave MGM: ", mBackend2.c_str());
+      }
 
-          break;
-        }
-        
-        mPoolSocket.push(socket);
+      if (!mTransport->Start())
+      {
+        eos_err("cannot start the authentication transport");
+        NoGo = 1;
       }
     }
     else
@@ -357,194 +330,6 @@ EosAuthOfs::Configure(XrdSysError& error)
 }
 
 
-//------------------------------------------------------------------------------
-// Authentication proxy thread startup function
-//------------------------------------------------------------------------------
-void*
-EosAuthOfs::StartAuthProxyThread(void *pp)
-{
-  EosAuthOfs* ofs = static_cast<EosAuthOfs*>(pp);
-  ofs->AuthProxyThread();
-  return 0;  
-}
-
-
-//------------------------------------------------------------------------------
-// Authentication proxt thread which forwards requests form the clients
-// to the proper MGM intance.
-//------------------------------------------------------------------------------
-void
-EosAuthOfs::AuthProxyThread()
-{
-  // Bind the client facing socket
-  mFrontend = new zmq::socket_t(*mZmqContext, ZMQ_ROUTER);
-  mFrontend->bind("inproc://proxyfrontend");
-
-  // Connect sockets facing the MGM nodes - master and slave
-  std::ostringstream sstr;
-  mBackend1 = std::make_pair(mBackend1.first,
-                             new zmq::socket_t(*mZmqContext, ZMQ_DEALER));
-  sstr << "tcp://" << mBackend1.first;
-  OfsEroute.Say("=====> connected to master MGM: ", mBackend1.first.c_str());
-  mBackend1.second->connect(sstr.str().c_str());
-  
-  // Connect to the slave if present
-  if (!mBackend2.first.empty())
-  {
-    sstr.str("");
-    mBackend2 = std::make_pair(mBackend2.first,
-                               new zmq::socket_t(*mZmqContext, ZMQ_DEALER));
-    sstr << "tcp://" << mBackend2.first;
-    OfsEroute.Say("=====> connected to slave MGM: ", mBackend2.first.c_str());
-    mBackend2.second->connect(sstr.str().c_str());
-  }
-  
-  // Set the master to point to the master MGM - no need for lock
-  mMaster = mBackend1.second;
-
-  int rc;
-  zmq::message_t msg;
-  
-  // Start the poxy using the first entry
-  int more;
-  size_t moresz;
-  int poll_size = 2;
-  zmq_pollitem_t items [3];
-  items[0] = {mFrontend, 0, ZMQ_POLLIN, 0};
-  items[1] = {mBackend1.second, 0, ZMQ_POLLIN, 0};
-    
-  if (!mBackend2.first.empty())
-  {
-    poll_size = 3;
-    items[2] = {mBackend2.second, 0, ZMQ_POLLIN, 0};
-  }
-  
-  // Main loop in which the proxy thread accepts request from the clients and
-  // then he forwards them to the current master MGM. The master MGM can change
-  // at any point.
-  while (true)
-  {
-    // Wait while there are either requests or replies to process
-    rc = zmq::poll(&items[0], poll_size, -1);
-    
-    if (rc < 0)
-    {
-      eos_err("error in poll");
-      return;
-    }
-
-    // Process a request
-    if (items[0].revents & ZMQ_POLLIN)
-    {
-      eos_debug("got frontend event");
-      
-      while (true)
-      {
-        if (!mFrontend->recv(&msg))
-        {
-          eos_err("error while recv on frontend");
-          return;
-        }
-      
-        try
-        {
-          moresz = sizeof more;
-          mFrontend->getsockopt(ZMQ_RCVMORE, &more, &moresz);
-        }
-        catch (zmq::error_t& err)
-        {
-          eos_err("exception in getsockopt");
-          return;
-        }
-        
-        // Send request to the current master MGM
-        {
-          XrdSysMutexHelper scop_lock(mMutexMaster);
-          if (!mMaster->send(msg, more ? ZMQ_SNDMORE : 0))
-          {
-            eos_err("error while sending to master");
-            return;
-          }
-        }
-
-        if (more == 0)
-          break;
-      }
-    }
-
-    // Process a reply from the first MGM
-    if (items[1].revents & ZMQ_POLLIN)
-    {
-      eos_debug("got mBackend1 event");
-      
-      while (true)
-      {
-        if (!mBackend1.second->recv(&msg))
-        {
-          eos_err("error while recv on mBackend1");
-          return;
-        }
-        
-        moresz = sizeof more;
-        try
-        {
-          mBackend1.second->getsockopt(ZMQ_RCVMORE, &more, &moresz);
-        }
-        catch (zmq::error_t& err)
-        {
-          eos_err("exception in getsockopt");
-          return;
-        }
-
-        if (!mFrontend->send(msg, more ? ZMQ_SNDMORE : 0))
-        {
-          eos_err("error while send to frontend(1)");
-          return;
-        }
-       
-        if (more == 0)
-          break;
-      }
-    }
-
-    // Process a reply from the second MGM
-    if ((poll_size == 3) && (items[2].revents & ZMQ_POLLIN))
-    {
-      eos_debug("got mBackend2 event");
-      
-      while (true)
-      {
-        if (!mBackend2.second->recv(&msg))
-        {
-          eos_err("error while recv on mBackend2");
-          return;
-        }
-        
-        moresz = sizeof more;
-        try
-        {
-          mBackend2.second->getsockopt(ZMQ_RCVMORE, &more, &moresz);
-        }
-        catch (zmq::error_t& err)
-        {
-          eos_err("exception in getsockopt");
-          return;
-        }
-
-        if (!mFrontend->send(msg, more ? ZMQ_SNDMORE : 0))
-        {
-          eos_err("error while send to frontend(2)");
-          return;
-        }
-
-        if (more == 0)
-          break;
-      }
-    }
-  }
-}
-
-
 //------------------------------------------------------------------------------
 // Get directory object
 //------------------------------------------------------------------------------
@@ -589,14 +374,12 @@ EosAuthOfs::stat(const char* path,
     delete req_proto;
     return retc;
   }  
- 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
 
-  if (SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_stat = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_stat = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_stat)
      {
@@ -620,8 +403,7 @@ EosAuthOfs::stat(const char* path,
      }
   }
     
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -649,15 +431,12 @@ EosAuthOfs::stat(const char* path,
     delete req_proto;
     return retc;
   }  
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
 
-     
-  if (SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_stat = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_stat = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_stat)
     {
@@ -677,8 +456,7 @@ EosAuthOfs::stat(const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -721,14 +499,12 @@ EosAuthOfs::fsctl(const int cmd,
     delete req_proto;
     return retc;
   }  
-    
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_fsctl1 = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_fsctl1 = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if(resp_fsctl1)
     {
@@ -744,8 +520,7 @@ EosAuthOfs::fsctl(const int cmd,
     }
   }
 
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -771,14 +546,12 @@ EosAuthOfs::FSctl(const int cmd,
     delete req_proto;
     return retc;
   }  
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_fsctl2 = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_fsctl2 = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_fsctl2)
     {
@@ -794,8 +567,7 @@ EosAuthOfs::FSctl(const int cmd,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -822,14 +594,12 @@ EosAuthOfs::chmod (const char *path,
     delete req_proto;
     return retc;
   }  
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_chmod = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_chmod = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_chmod)
     {
@@ -845,8 +615,7 @@ EosAuthOfs::chmod (const char *path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -876,13 +645,11 @@ EosAuthOfs::chksum(csFunc func,
     return retc;
   }
 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_chksum = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_chksum = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_chksum)
     {
@@ -899,8 +666,7 @@ EosAuthOfs::chksum(csFunc func,
     }
   }
  
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -927,14 +693,12 @@ EosAuthOfs::exists(const char* path,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_exists = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_exists = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_exists)
     {
@@ -954,8 +718,7 @@ EosAuthOfs::exists(const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -987,13 +750,11 @@ EosAuthOfs::mkdir (const char* path,
     return retc;
   }
 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-    
-  if (SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_mkdir = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_mkdir = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_mkdir)
     {
@@ -1010,8 +771,7 @@ EosAuthOfs::mkdir (const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1037,14 +797,12 @@ EosAuthOfs::remdir(const char* path,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_remdir = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_remdir = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_remdir)
     {
@@ -1061,8 +819,7 @@ EosAuthOfs::remdir(const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1088,14 +845,12 @@ EosAuthOfs::rem(const char* path,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_rem = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_rem = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_rem)
     {
@@ -1112,8 +867,7 @@ EosAuthOfs::rem(const char* path,
     }
   }
 
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1142,14 +896,12 @@ EosAuthOfs::rename (const char *oldName,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_rename = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_rename = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_rename)
     {
@@ -1166,8 +918,7 @@ EosAuthOfs::rename (const char *oldName,
     }
   }
 
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1192,14 +943,12 @@ EosAuthOfs::prepare(XrdSfsPrep& pargs,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_prepare = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_prepare = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_prepare)
     {
@@ -1216,8 +965,7 @@ EosAuthOfs::prepare(XrdSfsPrep& pargs,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1245,14 +993,12 @@ EosAuthOfs::truncate(const char* path,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
-     
-  if (SendProtoBufRequest(socket, req_proto))
+
+  uint64_t req_id = SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_truncate = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_truncate = static_cast<ResponseProto*>(GetResponse(req_id));
 
     if (resp_truncate)
     {
@@ -1269,8 +1015,7 @@ EosAuthOfs::truncate(const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1290,14 +1035,13 @@ EosAuthOfs::getStats (char *buff, int blen)
 
 
 //------------------------------------------------------------------------------
-// Send ProtocolBuffer object using ZMQ
+// Send ProtocolBuffer object to the master MGM
 //------------------------------------------------------------------------------
-bool
-EosAuthOfs::SendProtoBufRequest(zmq::socket_t* socket,
-                                google::protobuf::Message* message)
+uint64_t
+EosAuthOfs::SendProtoBufRequest(google::protobuf::Message* message)
 {
-  // Send the request
-  bool sent = false;
+  // Serialize the request directly into the ZMQ message which is then handed
+  // over to the transport without any further copy
   int msg_size = message->ByteSize();
   zmq::message_t request(msg_size);
   google::protobuf::io::ArrayOutputStream aos(request.data(), msg_size);
@@ -1305,34 +1049,33 @@ EosAuthOfs::SendProtoBufRequest(zmq::socket_t* socket,
   // Use google::protobuf::io::ArrayOutputStream which is way faster than
   // StringOutputStream as it avoids copying data
   message->SerializeToZeroCopyStream(&aos);
-  sent = socket->send(request, ZMQ_NOBLOCK);
+  uint64_t req_id = mTransport->Send(request);
 
-  if (!sent)
+  if (!req_id)
     eos_err("unable to send request using zmq");
 
-  return sent;
+  return req_id;
 }
 
 
 //------------------------------------------------------------------------------
-// Get ProtocolBuffer response object using ZMQ
+// Wait for the ProtocolBuffer response object of a request
 //------------------------------------------------------------------------------
 google::protobuf::Message*
-EosAuthOfs::GetResponse(zmq::socket_t* socket)
+EosAuthOfs::GetResponse(uint64_t req_id)
 {
   zmq::message_t reply;
   ResponseProto* resp = static_cast<ResponseProto*>(0);
-  bool done = socket->recv(&reply);
+  bool done = mTransport->Recv(req_id, reply);
   
   if (done)
   {
-    std::string resp_str = std::string(static_cast<char*>(reply.data()), reply.size());
     resp = new ResponseProto();
-    resp->ParseFromString(resp_str);
+    resp->ParseFromArray(reply.data(), reply.size());
 
     // If response is redirect and the error information matches one of the MGM
     // nodes specified in the configuration, this means there was a master/slave
-    // switch and we need to update the socket to which requests are sent.
+    // switch and we need to update the MGM to which requests are sent.
     if (resp->response() == SFS_REDIRECT)
     {
       if (resp->has_error())
@@ -1370,35 +1113,12 @@ EosAuthOfs::GetResponse(zmq::socket_t* socket)
 
 
 //------------------------------------------------------------------------------
-// Update the socket pointing to the master MGM instance
+// Update the MGM instance to which the requests are sent
 //------------------------------------------------------------------------------
 bool
 EosAuthOfs::UpdateMaster(std::string& redirect_host)
 {
-  bool found = false;
-  zmq::socket_t* upd_socket;
-  eos_debug("redirect_host:%s", redirect_host.c_str());
-  
-  // Chech if the new master was also specified in the configuration
-  if (mBackend1.first.find(redirect_host) != string::npos)
-  {
-    upd_socket = mBackend1.second;
-    found = true;
-  }
-  else if (mBackend2.first.find(redirect_host) != string::npos)
-  {
-    upd_socket = mBackend2.second;
-    found = true;
-  }
-
-  if (found)
-  {
-    XrdSysMutexHelper scop_lock(mMutexMaster);
-    if (mMaster != upd_socket)
-      mMaster = upd_socket;    
-  }
-
-  return found;
+  return mTransport->UpdateMaster(redirect_host);
 }
 
 
@@ -30,7 +30,6 @@
 /*----------------------------------------------------------------------------*/
 #include "common/ZMQ.hh"
 /*----------------------------------------------------------------------------*/
-#include "common/ConcurrentQueue.hh"
 #include "Namespace.hh"
 /*----------------------------------------------------------------------------*/
 
@@ -48,6 +47,8 @@ namespace google
 
 EOSAUTHNAMESPACE_BEGIN
 
+class AuthTransport;
+
 //------------------------------------------------------------------------------
 //! Class EosAuthOfs built on top of XrdOfs
 /*! Decription: The libEosAuthOfs.so is inteded to be used as an OFS library
@@ -70,11 +71,10 @@ EOSAUTHNAMESPACE_BEGIN
         ports to which ZMQ can connect to the MGM nodes so that it can forward
         requests and receive responses. Only the mastermgm parameter is mandatory
         the other one is optional and can be left out.
-    - eosauth.numsockets - once a clients wants to send a request the thread
-        allocated to him in XRootD will require a socket to send the request
-        to the MGM node. Therefore, we set up a pool of sockets from the
-        begining which can be used to send/receiver requests/responses.
-        The default size is 10 sockets.
+    - eosauth.timeout - deadline in seconds for the MGM to reply to a
+        request. All the requests are multiplexed over one connection per MGM
+        node (see AuthTransport) so there is no limit on the number of
+        requests in flight. The default deadline is 5 seconds.
 
     MGM - configuration
     ===================
@@ -269,61 +269,43 @@ class EosAuthOfs: public XrdOfs, public eos::common::LogId
   
   private:
 
-    pthread_t proxy_tid; ///< id of the proxy thread
     zmq::context_t* mZmqContext; ///< ZMQ context
-    zmq::socket_t* mFrontend; ///< proxy socket facing the clients
-    zmq::socket_t* mMaster; ///< socket pointing to the MGM master
-    XrdSysMutex mMutexMaster; ///< mutex for switching the MGM master
-    int mSizePoolSocket; ///< maximum size of the client socket pool
-    eos::common::ConcurrentQueue<zmq::socket_t*> mPoolSocket; ///< ZMQ client socket pool
-    ///! MGM endpoints to which requests can be dispatched and the corresponding sockets
-    std::pair<std::string, zmq::socket_t*> mBackend1;
-    std::pair<std::string, zmq::socket_t*> mBackend2;
+    AuthTransport* mTransport; ///< multiplexed connection to the MGM nodes
+    int mTimeout; ///< deadline of a request in seconds
+    ///! MGM endpoints to which requests can be dispatched
+    std::string mBackend1;
+    std::string mBackend2;
     std::string mManagerIp; ///< the IP address of the auth instance
     int mManagerPort;   ///< port on which the current auth server runs
     int mLogLevel; ///< log level value 0 -7 (LOG_EMERG - LOG_DEBUG)
 
 
     //--------------------------------------------------------------------------
-    //! Authentication proxy thread which forwards requests form the clients
-    //! to the proper MGM intance.
-    //--------------------------------------------------------------------------
-    void AuthProxyThread();
-
-
-    //--------------------------------------------------------------------------
-    //! Authentication proxy thread startup function
-    //--------------------------------------------------------------------------
-    static void* StartAuthProxyThread(void *pp);
-  
-
-    //--------------------------------------------------------------------------
-    //! Send ProtocolBuffer object using ZMQ
+    //! Send ProtocolBuffer object to the master MGM
     //!
-    //! @param socket ZMQ socket object
     //! @param object to be sent over the wire
     //!
-    //! @return true if object sent successfully, otherwise false
+    //! @return id of the request to be passed to GetResponse if object sent
+    //!         successfully, otherwise 0
     //!
     //--------------------------------------------------------------------------
-    bool SendProtoBufRequest(zmq::socket_t* socket,
-                             google::protobuf::Message* message);
+    uint64_t SendProtoBufRequest(google::protobuf::Message* message);
 
 
     //--------------------------------------------------------------------------
-    //! Get ProtocolBuffer reply object using ZMQ
+    //! Wait for the ProtocolBuffer reply object of a request
     //!
-    //! @param socket ZMQ socket object
+    //! @param req_id id of the request returned by SendProtoBufRequest
     //!
     //! @return pointer to received object, the user has the responsibility to
     //!         delete the obtained object
     //!
     //--------------------------------------------------------------------------
-    google::protobuf::Message* GetResponse(zmq::socket_t* socket);
+    google::protobuf::Message* GetResponse(uint64_t req_id);
 
 
     //--------------------------------------------------------------------------
-    //! Update the socket pointing to the master MGM instance
+    //! Update the MGM instance to which the requests are sent
     //!
     //! @param new_master new host and port values for the master MGM
     //!                   the format is: "host:port"
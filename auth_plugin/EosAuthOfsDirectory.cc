@@ -77,14 +77,12 @@ EosAuthOfsDirectory::open(const char* name,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_open = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_open = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_open)
     {
@@ -94,8 +92,7 @@ EosAuthOfsDirectory::open(const char* name,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -120,14 +117,12 @@ EosAuthOfsDirectory::nextEntry()
     delete req_proto;
     return static_cast<const char*>(0) ;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_read = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_read = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_read)
     {
@@ -148,8 +143,7 @@ EosAuthOfsDirectory::nextEntry()
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return (retc ? static_cast<const char*>(0) : mNextEntry.c_str());
 }
@@ -175,13 +169,11 @@ EosAuthOfsDirectory::close()
     return retc;
   }
 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  if (req_id)
   {
-    ResponseProto* resp_close = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_close = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_close)
     {
@@ -191,8 +183,7 @@ EosAuthOfsDirectory::close()
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -217,14 +208,12 @@ EosAuthOfsDirectory::FName()
     delete req_proto;
     return static_cast<const char*>(0) ;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_fname = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fname = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_fname)
     {
@@ -245,8 +234,7 @@ EosAuthOfsDirectory::FName()
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return (retc ? static_cast<const char*>(0) : mName.c_str());
 }
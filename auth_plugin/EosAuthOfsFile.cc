@@ -82,14 +82,12 @@ EosAuthOfsFile::open(const char* fileName,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_open = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_open = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_open)
     {
@@ -103,8 +101,7 @@ EosAuthOfsFile::open(const char* fileName,
     }
   }
 
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -132,14 +129,12 @@ EosAuthOfsFile::read(XrdSfsFileOffset offset,
     delete req_proto;
     return retc;
   }
- 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_fread = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fread = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_fread)
     {
@@ -156,8 +151,7 @@ EosAuthOfsFile::read(XrdSfsFileOffset offset,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -185,14 +179,12 @@ EosAuthOfsFile::write(XrdSfsFileOffset offset,
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_fwrite = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fwrite = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_fwrite)
     {
@@ -202,8 +194,7 @@ EosAuthOfsFile::write(XrdSfsFileOffset offset,
     }
   }
  
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -229,14 +220,12 @@ EosAuthOfsFile::FName()
     delete req_proto;
     return static_cast<const char*>(0);
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_fname = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fname = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_fname)
     {
@@ -257,8 +246,7 @@ EosAuthOfsFile::FName()
     }
   }
  
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return (retc ? static_cast<const char*>(0) : mName.c_str());
 }
@@ -285,13 +273,11 @@ EosAuthOfsFile::stat(struct stat* buf)
     return retc;
   }
 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  if (req_id)
   {
-    ResponseProto* resp_fstat = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fstat = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_fstat)
     {
@@ -309,8 +295,7 @@ EosAuthOfsFile::stat(struct stat* buf)
     memset(buf, 0, sizeof(struct stat));
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -336,14 +321,12 @@ EosAuthOfsFile::close()
     delete req_proto;
     return retc;
   }
-  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  uint64_t req_id = gOFS->SendProtoBufRequest(req_proto);
+
+  if (req_id)
   {
-    ResponseProto* resp_close = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_close = static_cast<ResponseProto*>(gOFS->GetResponse(req_id));
 
     if (resp_close)
     {
@@ -353,8 +336,7 @@ EosAuthOfsFile::close()
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
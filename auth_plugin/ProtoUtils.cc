@@ -273,6 +273,14 @@ utils::DeleteXrdSfsFSctl(XrdSfsFSctl*& obj)
 }
 
 
+//------------------------------------------------------------------------------
+// Per thread serialization buffer used for the HMAC computation. It keeps its
+// capacity, so that serializing a request does not allocate memory once the
+// buffer has grown to the usual size.
+//------------------------------------------------------------------------------
+static thread_local std::string tlHmacBuffer;
+
+
 //------------------------------------------------------------------------------
 // Compute HMAC value of the RequestProto object and append it to the
 // object using the required field hmac
@@ -280,7 +288,7 @@ utils::DeleteXrdSfsFSctl(XrdSfsFSctl*& obj)
 bool
 utils::ComputeHMAC(RequestProto*& req)
 {
-  std::string smsg;
+  std::string& smsg = tlHmacBuffer;
   req->set_hmac(""); // set it temporarily, we update it later
  
   if (!req->SerializeToString(&smsg))
@@ -0,0 +1,452 @@
+//------------------------------------------------------------------------------
+// File: AuthTransportTest.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cppunit/extensions/HelperMacros.h>
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+/*----------------------------------------------------------------------------*/
+#include "auth_plugin/AuthTransport.hh"
+/*----------------------------------------------------------------------------*/
+
+using eos::auth::AuthTransport;
+
+
+//------------------------------------------------------------------------------
+//! AuthTransportTest class
+//------------------------------------------------------------------------------
+class AuthTransportTest: public CppUnit::TestCase
+{
+  CPPUNIT_TEST_SUITE(AuthTransportTest);
+    CPPUNIT_TEST(CorrelationTest);
+    CPPUNIT_TEST(LateReplyTest);
+    CPPUNIT_TEST(StopTest);
+    CPPUNIT_TEST(NotConnectedTest);
+  CPPUNIT_TEST_SUITE_END();
+
+ public:
+
+  //----------------------------------------------------------------------------
+  //! setUp function called before each test is done
+  //----------------------------------------------------------------------------
+  void setUp(void);
+
+  //----------------------------------------------------------------------------
+  //! tearDown function after each test is done
+  //----------------------------------------------------------------------------
+  void tearDown(void);
+
+  //----------------------------------------------------------------------------
+  //! Replies sent out of order reach the requests they belong to
+  //----------------------------------------------------------------------------
+  void CorrelationTest();
+
+  //----------------------------------------------------------------------------
+  //! A reply arriving after the deadline of its request is dropped
+  //----------------------------------------------------------------------------
+  void LateReplyTest();
+
+  //----------------------------------------------------------------------------
+  //! Stop fails the requests waiting for a reply
+  //----------------------------------------------------------------------------
+  void StopTest();
+
+  //----------------------------------------------------------------------------
+  //! Requests sent before the MGM is up are delivered once it is, or fail at
+  //! their deadline
+  //----------------------------------------------------------------------------
+  void NotConnectedTest();
+
+ private:
+
+  zmq::context_t* mContext; ///< ZMQ context of the transport and the MGM
+  int mPort; ///< port of the stand-in MGM
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(AuthTransportTest);
+
+
+//------------------------------------------------------------------------------
+//! Stand-in for the MGM, a ROUTER socket answering with the envelope of the
+//! request like the ROUTER -> DEALER -> REP chain of the MGM does
+//------------------------------------------------------------------------------
+class StandInMgm
+{
+ public:
+
+  //----------------------------------------------------------------------------
+  //! Request received from the transport
+  //----------------------------------------------------------------------------
+  struct Request
+  {
+    std::vector<zmq::message_t*> mEnvelope; ///< peer identity, id, delimiter
+    std::string mBody; ///< serialized request
+
+    ~Request()
+    {
+      for (size_t i = 0; i < mEnvelope.size(); ++i)
+        delete mEnvelope[i];
+    }
+  };
+
+  StandInMgm(zmq::context_t* context, int port):
+    mSocket(*context, ZMQ_ROUTER)
+  {
+    std::ostringstream sstr;
+    sstr << "tcp://127.0.0.1:" << port;
+    int linger = 0;
+    mSocket.setsockopt(ZMQ_LINGER, &linger, sizeof linger);
+    mSocket.bind(sstr.str().c_str());
+  }
+
+  //----------------------------------------------------------------------------
+  //! Receive a request
+  //!
+  //! @param timeout time to wait for it in milliseconds
+  //!
+  //! @return the request or 0 if none arrived in time
+  //----------------------------------------------------------------------------
+  Request* Recv(long timeout)
+  {
+    zmq_pollitem_t item;
+    item.socket = static_cast<void*>(mSocket);
+    item.fd = 0;
+    item.events = ZMQ_POLLIN;
+    item.revents = 0;
+
+    if (zmq::poll(&item, 1, timeout) <= 0)
+      return 0;
+
+    Request* req = new Request();
+    int more = 1;
+    size_t moresz;
+
+    while (more)
+    {
+      zmq::message_t* frame = new zmq::message_t();
+      mSocket.recv(frame);
+      moresz = sizeof more;
+      mSocket.getsockopt(ZMQ_RCVMORE, &more, &moresz);
+
+      if (more)
+      {
+        req->mEnvelope.push_back(frame);
+      }
+      else
+      {
+        req->mBody.assign(static_cast<char*>(frame->data()), frame->size());
+        delete frame;
+      }
+    }
+
+    return req;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Reply to a request
+  //----------------------------------------------------------------------------
+  void Reply(Request* req, const std::string& body)
+  {
+    for (size_t i = 0; i < req->mEnvelope.size(); ++i)
+    {
+      zmq::message_t frame(req->mEnvelope[i]->size());
+      memcpy(frame.data(), req->mEnvelope[i]->data(), frame.size());
+      mSocket.send(frame, ZMQ_SNDMORE);
+    }
+
+    zmq::message_t reply(body.length());
+    memcpy(reply.data(), body.c_str(), body.length());
+    mSocket.send(reply);
+  }
+
+ private:
+
+  zmq::socket_t mSocket; ///< ROUTER socket the transport connects to
+};
+
+
+//------------------------------------------------------------------------------
+// Build a request message
+//------------------------------------------------------------------------------
+static void
+MakeMsg(zmq::message_t& msg, const std::string& body)
+{
+  msg.rebuild(body.length());
+  memcpy(msg.data(), body.c_str(), body.length());
+}
+
+
+//------------------------------------------------------------------------------
+// Get the content of a reply message
+//------------------------------------------------------------------------------
+static std::string
+GetBody(zmq::message_t& msg)
+{
+  return std::string(static_cast<char*>(msg.data()), msg.size());
+}
+
+
+//------------------------------------------------------------------------------
+// Get the current time in milliseconds
+//------------------------------------------------------------------------------
+static uint64_t
+NowMs()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+
+//------------------------------------------------------------------------------
+// Thread waiting for the reply of a request
+//------------------------------------------------------------------------------
+struct Waiter
+{
+  AuthTransport* mTransport;
+  uint64_t mId;
+  bool mOk;
+  uint64_t mWaitedMs;
+};
+
+static void*
+WaitForReply(void* arg)
+{
+  Waiter* waiter = static_cast<Waiter*>(arg);
+  zmq::message_t reply;
+  uint64_t start = NowMs();
+  waiter->mOk = waiter->mTransport->Recv(waiter->mId, reply);
+  waiter->mWaitedMs = NowMs() - start;
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// setUp function
+//------------------------------------------------------------------------------
+void
+AuthTransportTest::setUp()
+{
+  mContext = new zmq::context_t(1);
+  // a free port, the stand-in MGM binds it only when needed
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  struct sockaddr_in addr;
+  socklen_t len = sizeof addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  CPPUNIT_ASSERT(!bind(fd, (struct sockaddr*)&addr, sizeof addr));
+  CPPUNIT_ASSERT(!getsockname(fd, (struct sockaddr*)&addr, &len));
+  mPort = ntohs(addr.sin_port);
+  close(fd);
+}
+
+
+//------------------------------------------------------------------------------
+// tearDown function
+//------------------------------------------------------------------------------
+void
+AuthTransportTest::tearDown()
+{
+  delete mContext;
+  mContext = 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Correlation of the replies with the requests
+//------------------------------------------------------------------------------
+void
+AuthTransportTest::CorrelationTest()
+{
+  StandInMgm mgm(mContext, mPort);
+  AuthTransport transport(mContext, 5000);
+  std::ostringstream sstr;
+  sstr << "127.0.0.1:" << mPort;
+  transport.AddBackend(sstr.str());
+  CPPUNIT_ASSERT(transport.Start());
+  std::vector<uint64_t> ids;
+  std::vector<StandInMgm::Request*> reqs;
+  const char* bodies[3] = {"stat", "open", "close"};
+
+  for (int i = 0; i < 3; ++i)
+  {
+    zmq::message_t msg;
+    MakeMsg(msg, bodies[i]);
+    ids.push_back(transport.Send(msg));
+    CPPUNIT_ASSERT(ids.back());
+  }
+
+  for (int i = 0; i < 3; ++i)
+  {
+    reqs.push_back(mgm.Recv(5000));
+    CPPUNIT_ASSERT(reqs.back());
+  }
+
+  CPPUNIT_ASSERT_EQUAL((size_t) 3, transport.GetNumInFlight());
+
+  // answer in the reverse order
+  for (int i = 2; i >= 0; --i)
+  {
+    mgm.Reply(reqs[i], reqs[i]->mBody + "-reply");
+    delete reqs[i];
+  }
+
+  for (int i = 0; i < 3; ++i)
+  {
+    zmq::message_t reply;
+    CPPUNIT_ASSERT(transport.Recv(ids[i], reply));
+    CPPUNIT_ASSERT_EQUAL(std::string(bodies[i]) + "-reply", GetBody(reply));
+  }
+
+  CPPUNIT_ASSERT_EQUAL((size_t) 0, transport.GetNumInFlight());
+}
+
+
+//------------------------------------------------------------------------------
+// Replies arriving after the deadline
+//------------------------------------------------------------------------------
+void
+AuthTransportTest::LateReplyTest()
+{
+  StandInMgm mgm(mContext, mPort);
+  AuthTransport transport(mContext, 5000);
+  std::ostringstream sstr;
+  sstr << "127.0.0.1:" << mPort;
+  transport.AddBackend(sstr.str());
+  CPPUNIT_ASSERT(transport.Start());
+  zmq::message_t msg;
+  zmq::message_t reply;
+  MakeMsg(msg, "slow");
+  uint64_t id = transport.Send(msg, 200);
+  CPPUNIT_ASSERT(id);
+  StandInMgm::Request* req = mgm.Recv(5000);
+  CPPUNIT_ASSERT(req);
+  CPPUNIT_ASSERT(!transport.Recv(id, reply));
+  CPPUNIT_ASSERT_EQUAL((size_t) 0, transport.GetNumInFlight());
+  // the late reply must not be taken for the one of the next request
+  mgm.Reply(req, "late");
+  delete req;
+  MakeMsg(msg, "fast");
+  id = transport.Send(msg);
+  CPPUNIT_ASSERT(id);
+  req = mgm.Recv(5000);
+  CPPUNIT_ASSERT(req);
+  CPPUNIT_ASSERT_EQUAL(std::string("fast"), req->mBody);
+  mgm.Reply(req, "on-time");
+  delete req;
+  CPPUNIT_ASSERT(transport.Recv(id, reply));
+  CPPUNIT_ASSERT_EQUAL(std::string("on-time"), GetBody(reply));
+  CPPUNIT_ASSERT_EQUAL((size_t) 0, transport.GetNumInFlight());
+}
+
+
+//------------------------------------------------------------------------------
+// Stop with requests waiting for a reply
+//------------------------------------------------------------------------------
+void
+AuthTransportTest::StopTest()
+{
+  StandInMgm mgm(mContext, mPort);
+  AuthTransport transport(mContext, 10000);
+  std::ostringstream sstr;
+  sstr << "127.0.0.1:" << mPort;
+  transport.AddBackend(sstr.str());
+  CPPUNIT_ASSERT(transport.Start());
+  zmq::message_t msg;
+  MakeMsg(msg, "unanswered");
+  Waiter waiter;
+  waiter.mTransport = &transport;
+  waiter.mId = transport.Send(msg);
+  waiter.mOk = true;
+  waiter.mWaitedMs = 0;
+  CPPUNIT_ASSERT(waiter.mId);
+  StandInMgm::Request* req = mgm.Recv(5000);
+  CPPUNIT_ASSERT(req);
+  delete req;
+  pthread_t tid;
+  CPPUNIT_ASSERT(!pthread_create(&tid, 0, WaitForReply, &waiter));
+  usleep(100000);
+  transport.Stop();
+  pthread_join(tid, 0);
+  // failed right away, not at the deadline
+  CPPUNIT_ASSERT(!waiter.mOk);
+  CPPUNIT_ASSERT(waiter.mWaitedMs < 5000);
+  CPPUNIT_ASSERT_EQUAL((size_t) 0, transport.GetNumInFlight());
+  MakeMsg(msg, "after-stop");
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 0, transport.Send(msg));
+}
+
+
+//------------------------------------------------------------------------------
+// Requests sent while the MGM is not up
+//------------------------------------------------------------------------------
+void
+AuthTransportTest::NotConnectedTest()
+{
+  AuthTransport transport(mContext, 5000);
+  std::ostringstream sstr;
+  sstr << "127.0.0.1:" << mPort;
+  transport.AddBackend(sstr.str());
+  CPPUNIT_ASSERT(transport.Start());
+  zmq::message_t msg;
+  zmq::message_t reply;
+  // nobody answers before the deadline
+  MakeMsg(msg, "expired");
+  uint64_t id = transport.Send(msg, 200);
+  CPPUNIT_ASSERT(id);
+  CPPUNIT_ASSERT(!transport.Recv(id, reply));
+  CPPUNIT_ASSERT_EQUAL((size_t) 0, transport.GetNumInFlight());
+  // the MGM comes up while the request waits
+  MakeMsg(msg, "queued");
+  id = transport.Send(msg);
+  CPPUNIT_ASSERT(id);
+  usleep(300000);
+  StandInMgm mgm(mContext, mPort);
+  StandInMgm::Request* req = mgm.Recv(5000);
+  CPPUNIT_ASSERT(req);
+
+  // the expired request may be delivered as well, it is answered and dropped
+  if (req->mBody == "expired")
+  {
+    mgm.Reply(req, "dropped");
+    delete req;
+    req = mgm.Recv(5000);
+    CPPUNIT_ASSERT(req);
+  }
+
+  CPPUNIT_ASSERT_EQUAL(std::string("queued"), req->mBody);
+  mgm.Reply(req, "delivered");
+  delete req;
+  CPPUNIT_ASSERT(transport.Recv(id, reply));
+  CPPUNIT_ASSERT_EQUAL(std::string("delivered"), GetBody(reply));
+}
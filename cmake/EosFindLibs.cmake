@@ -66,6 +66,7 @@ endif ( MacOSX )
     find_package(CPPUnit)
     find_package(microhttpd)
     find_package(httpd)
+    find_package(uring)
     if (ENABLE_REDOX)
       find_package(libev REQUIRED)
       find_package(redox REQUIRED)
@@ -84,3 +85,7 @@ if (NOT MICROHTTPD_FOUND)
 else ()
   set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -DEOS_MICRO_HTTPD=1")
 endif ()
+
+if (URING_FOUND)
+  set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -DEOS_URING=1")
+endif ()
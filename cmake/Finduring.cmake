@@ -0,0 +1,38 @@
+# Try to find liburing
+# Once done, this will define
+#
+# URING_FOUND        - system has liburing
+# URING_INCLUDE_DIRS - liburing include directories
+# URING_LIBRARIES    - libraries needed to use liburing
+
+include(FindPackageHandleStandardArgs)
+
+if(URING_INCLUDE_DIRS AND URING_LIBRARIES)
+  set(URING_FIND_QUIETLY TRUE)
+else()
+  find_path(
+    URING_INCLUDE_DIR
+    NAMES liburing.h
+    HINTS ${URING_ROOT_DIR}
+    PATH_SUFFIXES include)
+
+  find_library(
+    URING_LIBRARY
+    NAMES uring
+    HINTS ${URING_ROOT_DIR}
+    PATH_SUFFIXES ${LIBRARY_PATH_PREFIX})
+
+  set(URING_INCLUDE_DIRS ${URING_INCLUDE_DIR})
+  set(URING_LIBRARIES ${URING_LIBRARY})
+
+  find_package_handle_standard_args(
+    uring
+    DEFAULT_MSG
+    URING_LIBRARY URING_INCLUDE_DIR)
+
+  mark_as_advanced(URING_LIBRARY URING_INCLUDE_DIR)
+endif()
+
+if (NOT URING_FOUND)
+  message (STATUS "liburing not found, local async IO uses a thread pool.")
+endif()
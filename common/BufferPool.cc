@@ -0,0 +1,377 @@
+// ----------------------------------------------------------------------
+// File: BufferPool.cc
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "common/BufferPool.hh"
+/*----------------------------------------------------------------------------*/
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+BufferPool::BufferPool (uint64_t max_bytes) :
+  mMaxBytes(max_bytes), mHits(0), mMisses(0), mPinned(0), mCached(0)
+{
+  pthread_key_create(&mCacheKey, &BufferPool::FlushThreadCache);
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+BufferPool::~BufferPool ()
+{
+  ThreadCache* cache = static_cast<ThreadCache*>(pthread_getspecific(mCacheKey));
+
+  if (cache)
+  {
+    pthread_setspecific(mCacheKey, 0);
+    FlushThreadCache(cache);
+  }
+
+  pthread_key_delete(mCacheKey);
+  Trim(0);
+}
+
+//------------------------------------------------------------------------------
+// Get the pool shared by all users
+//------------------------------------------------------------------------------
+BufferPool&
+BufferPool::Instance ()
+{
+  // never destroyed, threads may still release buffers at exit
+  static BufferPool* pool = new BufferPool(
+    (getenv("EOS_BUFFER_POOL_MAX_MB") ?
+     strtoull(getenv("EOS_BUFFER_POOL_MAX_MB"), 0, 10) : 4096) << 20);
+  return *pool;
+}
+
+//------------------------------------------------------------------------------
+// Get the size class of a request
+//------------------------------------------------------------------------------
+unsigned int
+BufferPool::GetClass (size_t size)
+{
+  if (size <= (1ul << sMinShift))
+    return 0;
+
+  if (size > (1ul << sMaxShift))
+    return sNumClasses;
+
+  unsigned int shift = 8 * sizeof(unsigned long) - __builtin_clzl(size - 1);
+  return shift - sMinShift;
+}
+
+//------------------------------------------------------------------------------
+// Get the NUMA node the calling thread runs on
+//------------------------------------------------------------------------------
+unsigned int
+BufferPool::GetNode ()
+{
+#ifdef SYS_getcpu
+  unsigned int cpu = 0;
+  unsigned int node = 0;
+
+  if (!syscall(SYS_getcpu, &cpu, &node, 0))
+    return node % sMaxNodes;
+#endif
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Get the cache of the calling thread, creating it if needed
+//------------------------------------------------------------------------------
+BufferPool::ThreadCache*
+BufferPool::GetThreadCache ()
+{
+  ThreadCache* cache = static_cast<ThreadCache*>(pthread_getspecific(mCacheKey));
+
+  if (!cache)
+  {
+    cache = new ThreadCache();
+    cache->mPool = this;
+    cache->mBytes = 0;
+
+    if (pthread_setspecific(mCacheKey, cache))
+    {
+      delete cache;
+      return 0;
+    }
+
+    XrdSysMutexHelper lock(mCachesMutex);
+    mCaches.insert(cache);
+  }
+
+  return cache;
+}
+
+//------------------------------------------------------------------------------
+// Move the buffers of a thread cache to the free lists
+//------------------------------------------------------------------------------
+void
+BufferPool::FlushThreadCache (void* arg)
+{
+  ThreadCache* cache = static_cast<ThreadCache*>(arg);
+  BufferPool* pool = cache->mPool;
+  {
+    // once unregistered Trim can not see the cache anymore
+    XrdSysMutexHelper lock(pool->mCachesMutex);
+    pool->mCaches.erase(cache);
+  }
+  FreeList& list = pool->mFreeLists[GetNode()];
+  {
+    XrdSysMutexHelper lock(list.mMutex);
+
+    for (unsigned int i = 0; i < sNumClasses; i++)
+    {
+      list.mBuffers[i].insert(list.mBuffers[i].end(),
+                              cache->mBuffers[i].begin(),
+                              cache->mBuffers[i].end());
+    }
+  }
+  delete cache;
+}
+
+//------------------------------------------------------------------------------
+// Map a new buffer
+//------------------------------------------------------------------------------
+char*
+BufferPool::Map (size_t size)
+{
+  void* ptr = mmap(0, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (ptr == MAP_FAILED)
+    throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+  if (size >= sHugePageSize)
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+  mPinned += size;
+  return static_cast<char*>(ptr);
+}
+
+//------------------------------------------------------------------------------
+// Unmap a buffer
+//------------------------------------------------------------------------------
+void
+BufferPool::Unmap (char* buffer, size_t size)
+{
+  munmap(buffer, size);
+  mPinned -= size;
+}
+
+//------------------------------------------------------------------------------
+// Unmap free buffers until the pool holds at most the given number of bytes
+//------------------------------------------------------------------------------
+void
+BufferPool::Trim (uint64_t target)
+{
+  for (unsigned int node = 0; node < sMaxNodes; node++)
+  {
+    FreeList& list = mFreeLists[node];
+    XrdSysMutexHelper lock(list.mMutex);
+
+    // the large buffers first, they give back the most memory
+    for (int i = sNumClasses - 1; i >= 0; i--)
+    {
+      size_t size = 1ul << (i + sMinShift);
+
+      while (!list.mBuffers[i].empty())
+      {
+        if (mPinned <= target)
+          return;
+
+        Unmap(list.mBuffers[i].back(), size);
+        list.mBuffers[i].pop_back();
+        mCached -= size;
+      }
+    }
+  }
+
+  // the free lists are empty, drain the thread caches
+  XrdSysMutexHelper lock(mCachesMutex);
+
+  for (auto it = mCaches.begin(); it != mCaches.end(); ++it)
+  {
+    ThreadCache* cache = *it;
+    XrdSysMutexHelper cache_lock(cache->mMutex);
+
+    for (int i = sNumClasses - 1; i >= 0; i--)
+    {
+      size_t size = 1ul << (i + sMinShift);
+
+      while (!cache->mBuffers[i].empty())
+      {
+        if (mPinned <= target)
+          return;
+
+        Unmap(cache->mBuffers[i].back(), size);
+        cache->mBuffers[i].pop_back();
+        cache->mBytes -= size;
+        mCached -= size;
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Allocate a page aligned buffer
+//------------------------------------------------------------------------------
+char*
+BufferPool::Allocate (size_t size)
+{
+  unsigned int cls = GetClass(size);
+
+  if (cls == sNumClasses)
+  {
+    mMisses++;
+    return Map(size);
+  }
+
+  size_t class_size = 1ul << (cls + sMinShift);
+  ThreadCache* cache = GetThreadCache();
+  char* buffer = 0;
+
+  if (cache)
+  {
+    // only contended while Trim drains the cache
+    XrdSysMutexHelper lock(cache->mMutex);
+
+    if (!cache->mBuffers[cls].empty())
+    {
+      buffer = cache->mBuffers[cls].back();
+      cache->mBuffers[cls].pop_back();
+      cache->mBytes -= class_size;
+    }
+  }
+
+  if (!buffer)
+  {
+    FreeList& list = mFreeLists[GetNode()];
+    XrdSysMutexHelper lock(list.mMutex);
+
+    if (!list.mBuffers[cls].empty())
+    {
+      buffer = list.mBuffers[cls].back();
+      list.mBuffers[cls].pop_back();
+    }
+  }
+
+  if (buffer)
+  {
+    mCached -= class_size;
+    mHits++;
+    return buffer;
+  }
+
+  // make room for the new buffer by dropping free ones of other classes,
+  // buffers in use can not be given back so the bound may only be exceeded
+  // by them
+  uint64_t max_bytes = mMaxBytes;
+
+  if (mPinned + class_size > max_bytes)
+    Trim((max_bytes > class_size) ? max_bytes - class_size : 0);
+
+  mMisses++;
+  return Map(class_size);
+}
+
+//------------------------------------------------------------------------------
+// Give back a buffer
+//------------------------------------------------------------------------------
+void
+BufferPool::Release (char* buffer, size_t size)
+{
+  if (!buffer)
+    return;
+
+  unsigned int cls = GetClass(size);
+
+  if (cls == sNumClasses)
+  {
+    Unmap(buffer, size);
+    return;
+  }
+
+  size_t class_size = 1ul << (cls + sMinShift);
+
+  if (mPinned > mMaxBytes)
+  {
+    Unmap(buffer, class_size);
+    return;
+  }
+
+  mCached += class_size;
+  ThreadCache* cache = GetThreadCache();
+
+  if (cache)
+  {
+    XrdSysMutexHelper lock(cache->mMutex);
+
+    if (cache->mBytes + class_size <= sThreadCacheBytes)
+    {
+      cache->mBuffers[cls].push_back(buffer);
+      cache->mBytes += class_size;
+      return;
+    }
+  }
+
+  FreeList& list = mFreeLists[GetNode()];
+  XrdSysMutexHelper lock(list.mMutex);
+  list.mBuffers[cls].push_back(buffer);
+}
+
+//------------------------------------------------------------------------------
+// Set the maximum number of bytes kept by the pool
+//------------------------------------------------------------------------------
+void
+BufferPool::SetMaxBytes (uint64_t max_bytes)
+{
+  mMaxBytes = max_bytes;
+
+  if (mPinned > max_bytes)
+    Trim(max_bytes);
+}
+
+//------------------------------------------------------------------------------
+// Get the pool statistics
+//------------------------------------------------------------------------------
+void
+BufferPool::GetStats (Stats& stats) const
+{
+  stats.mHits = mHits;
+  stats.mMisses = mMisses;
+  stats.mPinned = mPinned;
+  stats.mCached = mCached;
+  stats.mMaxBytes = mMaxBytes;
+}
+
+EOSCOMMONNAMESPACE_END
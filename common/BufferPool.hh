@@ -0,0 +1,201 @@
+// ----------------------------------------------------------------------
+// File: BufferPool.hh
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSCOMMON_BUFFERPOOL_HH__
+#define __EOSCOMMON_BUFFERPOOL_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "common/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <atomic>
+#include <pthread.h>
+#include <set>
+#include <stdint.h>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class BufferPool
+//!
+//! @description Pool of page aligned data buffers shared by the data path.
+//! Requests are rounded up to a power of two size class between 4 KB and
+//! 64 MB. Released buffers are kept in a small per-thread cache and, once
+//! this is full, in free lists per NUMA node, so that a buffer is normally
+//! reused on the node where its pages were first touched. Buffers are mapped
+//! anonymously and the ones of at least 2 MB are backed by transparent huge
+//! pages. The memory held by the pool is bounded: the buffers in the thread
+//! caches count against the configured maximum like all others, an
+//! allocation beyond it first unmaps free buffers of the free lists and the
+//! thread caches, and buffers released while the pool holds more than the
+//! maximum are unmapped.
+//------------------------------------------------------------------------------
+class BufferPool
+{
+public:
+  //! Smallest size class (4 KB)
+  static const unsigned int sMinShift = 12;
+  //! Largest size class (64 MB), bigger buffers are not pooled
+  static const unsigned int sMaxShift = 26;
+  static const unsigned int sNumClasses = sMaxShift - sMinShift + 1;
+  //! Maximum number of NUMA nodes with their own free lists
+  static const unsigned int sMaxNodes = 8;
+  //! Bytes kept in the cache of a thread, all size classes together
+  static const size_t sThreadCacheBytes = 4 * 1024 * 1024;
+  //! Size from which buffers are backed by huge pages
+  static const size_t sHugePageSize = 2 * 1024 * 1024;
+
+  //----------------------------------------------------------------------------
+  //! Pool statistics
+  //----------------------------------------------------------------------------
+  struct Stats
+  {
+    uint64_t mHits; ///< allocations served from a free list
+    uint64_t mMisses; ///< allocations which mapped new memory
+    uint64_t mPinned; ///< bytes mapped by the pool, in use or free
+    uint64_t mCached; ///< bytes in the free lists and thread caches
+    uint64_t mMaxBytes; ///< configured upper bound of the pinned bytes
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param max_bytes maximum number of bytes kept by the pool
+  //----------------------------------------------------------------------------
+  BufferPool (uint64_t max_bytes);
+
+  //----------------------------------------------------------------------------
+  //! Destructor - unmaps the free buffers, buffers in use or in the cache of
+  //! another thread must not outlive the pool
+  //----------------------------------------------------------------------------
+  ~BufferPool ();
+
+  //----------------------------------------------------------------------------
+  //! Get the pool shared by all users. The upper bound is configured in MB
+  //! via the environment variable EOS_BUFFER_POOL_MAX_MB (default 4096).
+  //----------------------------------------------------------------------------
+  static BufferPool& Instance ();
+
+  //----------------------------------------------------------------------------
+  //! Allocate a page aligned buffer
+  //!
+  //! @param size minimum size of the buffer
+  //!
+  //! @return buffer, throws std::bad_alloc if no memory can be mapped
+  //----------------------------------------------------------------------------
+  char* Allocate (size_t size);
+
+  //----------------------------------------------------------------------------
+  //! Give back a buffer
+  //!
+  //! @param buffer buffer returned by Allocate, can be 0
+  //! @param size size given to Allocate
+  //----------------------------------------------------------------------------
+  void Release (char* buffer, size_t size);
+
+  //----------------------------------------------------------------------------
+  //! Set the maximum number of bytes kept by the pool
+  //----------------------------------------------------------------------------
+  void SetMaxBytes (uint64_t max_bytes);
+
+  //----------------------------------------------------------------------------
+  //! Get the pool statistics
+  //----------------------------------------------------------------------------
+  void GetStats (Stats& stats) const;
+
+  //----------------------------------------------------------------------------
+  //! Unmap free buffers, from the free lists first and then from the thread
+  //! caches, until the pool holds at most the given number of bytes
+  //----------------------------------------------------------------------------
+  void Trim (uint64_t target);
+
+private:
+  //----------------------------------------------------------------------------
+  //! Free buffers of one NUMA node
+  //----------------------------------------------------------------------------
+  struct FreeList
+  {
+    XrdSysMutex mMutex; ///< protecting mBuffers
+    std::vector<char*> mBuffers[sNumClasses]; ///< free buffers per size class
+  };
+
+  //----------------------------------------------------------------------------
+  //! Free buffers of one thread
+  //----------------------------------------------------------------------------
+  struct ThreadCache
+  {
+    BufferPool* mPool; ///< owning pool
+    XrdSysMutex mMutex; ///< protecting mBuffers and mBytes against Trim
+    std::vector<char*> mBuffers[sNumClasses]; ///< free buffers per size class
+    size_t mBytes; ///< bytes in mBuffers
+  };
+
+  //----------------------------------------------------------------------------
+  //! Get the size class of a request
+  //!
+  //! @return class index or sNumClasses if the size is not pooled
+  //----------------------------------------------------------------------------
+  static unsigned int GetClass (size_t size);
+
+  //----------------------------------------------------------------------------
+  //! Get the NUMA node the calling thread runs on
+  //----------------------------------------------------------------------------
+  static unsigned int GetNode ();
+
+  //----------------------------------------------------------------------------
+  //! Get the cache of the calling thread, creating it if needed
+  //----------------------------------------------------------------------------
+  ThreadCache* GetThreadCache ();
+
+  //----------------------------------------------------------------------------
+  //! Move the buffers of a thread cache to the free lists, called at the exit
+  //! of a thread
+  //----------------------------------------------------------------------------
+  static void FlushThreadCache (void* arg);
+
+  //----------------------------------------------------------------------------
+  //! Map a new buffer
+  //----------------------------------------------------------------------------
+  char* Map (size_t size);
+
+  //----------------------------------------------------------------------------
+  //! Unmap a buffer
+  //----------------------------------------------------------------------------
+  void Unmap (char* buffer, size_t size);
+
+  pthread_key_t mCacheKey; ///< key of the thread caches
+  XrdSysMutex mCachesMutex; ///< protecting mCaches
+  std::set<ThreadCache*> mCaches; ///< caches of the running threads
+  FreeList mFreeLists[sMaxNodes]; ///< free buffers per NUMA node
+  std::atomic<uint64_t> mMaxBytes; ///< maximum number of bytes kept
+  std::atomic<uint64_t> mHits; ///< allocations served from a free list
+  std::atomic<uint64_t> mMisses; ///< allocations which mapped new memory
+  std::atomic<uint64_t> mPinned; ///< bytes mapped
+  std::atomic<uint64_t> mCached; ///< bytes in the free lists and caches
+};
+
+EOSCOMMONNAMESPACE_END
+
+#endif // __EOSCOMMON_BUFFERPOOL_HH__
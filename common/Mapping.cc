@@ -68,6 +68,7 @@ std::map<std::string, uid_t> Mapping::gPhysicalUserIdCache;
 std::map<std::string, gid_t> Mapping::gPhysicalGroupIdCache;
 
 Mapping::ip_cache Mapping::gIpCache (300);
+Mapping::vid_cache Mapping::gVidCache (300);
 /*----------------------------------------------------------------------------*/
 /**
  * Initialize Google maps
@@ -105,6 +106,7 @@ Mapping::Reset()
     XrdSysMutexHelper mLock(ActiveLock);
     ActiveTidents.clear();
   }
+  gVidCache.Invalidate();
 }
 
 
@@ -164,10 +166,94 @@ Mapping::IdMap (const XrdSecEntity* client, const char* env, const char* tident,
 
   eos_static_debug("name:%s role:%s group:%s tident:%s", client->name, client->role, client->grps, client->tident);
 
-  // you first are 'nobody'
-  Nobody(vid);
   XrdOucEnv Env(env);
+  std::shared_ptr<vid_cache::entry_t> entry;
+  std::string key;
 
+  if (gVidCache.Enabled())
+  {
+    // the key holds every client property the mapping depends on
+    const char* props[] = {
+      client->prot, client->name, client->host, client->grps, client->role,
+      tident, Env.Get("eos.ruid"), Env.Get("eos.rgid"), Env.Get("eos.app")
+    };
+
+    for (size_t i = 0; i < sizeof (props) / sizeof (props[0]); i++)
+    {
+      if (props[i])
+        key += props[i];
+      key += '\n';
+    }
+
+    entry = gVidCache.Get(key);
+  }
+
+  if (!entry)
+  {
+    XrdOucString mytident;
+    entry = std::make_shared<vid_cache::entry_t>();
+    // the generation has to be taken before reading the configuration
+    entry->mGeneration = gVidCache.GetGeneration();
+    entry->mActive = 0;
+    // you first are 'nobody'
+    Nobody(entry->mVid);
+    MapIdentity(client, Env, tident, entry->mVid, mytident);
+    entry->mTident = mytident.c_str();
+
+    if (key.length())
+      gVidCache.Put(key, entry);
+  }
+
+  ApplyIdentity(entry->mVid, vid);
+
+  time_t now = time(NULL);
+
+  // ---------------------------------------------------------------------------
+  // Maintain the active client map and expire old entries - a client
+  // reusing a cached identity updates it at most once per second
+  // ---------------------------------------------------------------------------
+  if (entry->mActive.exchange(now) != now)
+  {
+    ActiveLock.Lock();
+
+    // -------------------------------------------------------------------------
+    // safty measures not to exceed memory by 'nasty' clients
+    // -------------------------------------------------------------------------
+    if (ActiveTidents.size() > 25000)
+    {
+      ActiveExpire();
+    }
+    if (ActiveTidents.size() < 60000)
+    {
+      char actident[1024];
+      snprintf(actident, sizeof (actident) - 1, "%d^%s^%s^%s^%s", vid.uid, entry->mTident.c_str(), vid.prot.c_str(), vid.host.c_str(), vid.app.c_str());
+      std::string intident = actident;
+      ActiveTidents[intident] = now;
+    }
+    ActiveLock.UnLock();
+  }
+
+  if (log)
+  {
+    eos_static_info("%s sec.tident=\"%s\"", eos::common::SecEntity::ToString(client, Env.Get("eos.app")).c_str(), tident);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Map a client to its virtual identity without using the cache
+ *
+ * @param client xrootd client authenticatino object
+ * @param Env opaque information containing role selection like 'eos.ruid' and 'eos.rgid'
+ * @param tident trace identifier of the client
+ * @param vid 'nobody' identity to map
+ * @param mytident returns the reduced trace identifier of the client
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+Mapping::MapIdentity (const XrdSecEntity* client, XrdOucEnv &Env, const char* tident, Mapping::VirtualIdentity &vid, XrdOucString &mytident)
+{
   vid.name = client->name;
   vid.tident = tident;
   vid.sudoer = false;
@@ -450,7 +536,7 @@ Mapping::IdMap (const XrdSecEntity* client, const char* env, const char* tident,
   // ---------------------------------------------------------------------------
   // tident mapping
   // ---------------------------------------------------------------------------
-  XrdOucString mytident = "";
+  mytident = "";
   XrdOucString myrole = "";
   XrdOucString wildcardtident = "";
   XrdOucString host = "";
@@ -807,8 +893,6 @@ Mapping::IdMap (const XrdSecEntity* client, const char* env, const char* tident,
     vid.app = rapp.c_str();
   }
 
-  time_t now = time(NULL);
-
   // ---------------------------------------------------------------------------
   // Check the Geo Location
   // ---------------------------------------------------------------------------
@@ -844,32 +928,207 @@ Mapping::IdMap (const XrdSecEntity* client, const char* env, const char* tident,
     }
   }
 
-  // ---------------------------------------------------------------------------
-  // Maintain the active client map and expire old entries
-  // ---------------------------------------------------------------------------
-  ActiveLock.Lock();
+  eos_static_debug("selected %d %d [%s %s]", vid.uid, vid.gid, ruid.c_str(), rgid.c_str());
+}
 
-  // ---------------------------------------------------------------------------
-  // safty measures not to exceed memory by 'nasty' clients
-  // ---------------------------------------------------------------------------
-  if (ActiveTidents.size() > 25000)
+/*----------------------------------------------------------------------------*/
+/**
+ * Apply a mapped identity to the identity given to IdMap
+ *
+ * @param mapped identity mapped from 'nobody'
+ * @param vid identity to update
+ *
+ * Fields which IdMap only sets under certain conditions keep the value given
+ * by the caller otherwise, like a geo location set externally.
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+Mapping::ApplyIdentity (const VirtualIdentity &mapped, VirtualIdentity &vid)
+{
+  vid.uid = mapped.uid;
+  vid.gid = mapped.gid;
+  vid.uid_string = mapped.uid_string;
+  vid.gid_string = mapped.gid_string;
+  vid.uid_list = mapped.uid_list;
+  vid.gid_list = mapped.gid_list;
+  vid.tident = mapped.tident;
+  vid.name = mapped.name;
+  vid.prot = mapped.prot;
+  vid.host = mapped.host;
+  vid.sudoer = mapped.sudoer;
+
+  if (mapped.grps.length())
+    vid.grps = mapped.grps;
+
+  if (mapped.role.length())
+    vid.role = mapped.role;
+
+  if (mapped.app.length())
+    vid.app = mapped.app;
+
+  if (!vid.geolocation.length())
+    vid.geolocation = mapped.geolocation;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Constructor of the identity cache
+ *
+ * @param lifetime seconds after which an entry is mapped again
+ *
+ * The number of cached identities is configured via the environment variable
+ * EOS_VID_CACHE_SIZE (default 65536), 0 disables the cache.
+ */
+
+/*----------------------------------------------------------------------------*/
+Mapping::vid_cache::vid_cache (int lifetime) :
+  mLifeTime(lifetime), mGeneration(0), mHits(0), mMisses(0), mInvalidations(0)
+{
+  size_t size = getenv("EOS_VID_CACHE_SIZE") ?
+    strtoul(getenv("EOS_VID_CACHE_SIZE"), 0, 10) : 65536;
+  mMaxEntries = size ? (size + sShards - 1) / sShards : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Get the shard holding a key
+ */
+
+/*----------------------------------------------------------------------------*/
+Mapping::vid_cache::shard_t&
+Mapping::vid_cache::GetShard (const std::string &key)
+{
+  return mShards[std::hash<std::string>()(key) % sShards];
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Get a cached identity
+ *
+ * @param key client key
+ *
+ * @return entry of the current generation or an empty pointer
+ */
+
+/*----------------------------------------------------------------------------*/
+std::shared_ptr<Mapping::vid_cache::entry_t>
+Mapping::vid_cache::Get (const std::string &key)
+{
+  std::shared_ptr<entry_t> entry;
+  shard_t& shard = GetShard(key);
   {
-    ActiveExpire();
+    RWMutexReadLock lock(shard.mLocker);
+    std::map<std::string, std::shared_ptr<entry_t> >::const_iterator it =
+      shard.mEntries.find(key);
+
+    if (it != shard.mEntries.end())
+      entry = it->second;
   }
-  if (ActiveTidents.size() < 60000)
+
+  if (entry &&
+      ((entry->mGeneration != mGeneration) || (entry->mExpires < time(NULL))))
+    entry.reset();
+
+  if (entry)
+    mHits++;
+  else
+    mMisses++;
+
+  return entry;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Store a mapped identity
+ *
+ * @param key client key
+ * @param entry identity mapped with the configuration of entry->mGeneration
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+Mapping::vid_cache::Put (const std::string &key, std::shared_ptr<entry_t> entry)
+{
+  time_t now = time(NULL);
+  entry->mExpires = now + mLifeTime;
+  shard_t& shard = GetShard(key);
+  RWMutexWriteLock lock(shard.mLocker);
+
+  // the configuration changed while the identity was mapped
+  if (entry->mGeneration != mGeneration)
+    return;
+
+  if (shard.mEntries.size() >= mMaxEntries)
   {
-    char actident[1024];
-    snprintf(actident, sizeof (actident) - 1, "%d^%s^%s^%s^%s", vid.uid, mytident.c_str(), vid.prot.c_str(), vid.host.c_str(), vid.app.c_str());
-    std::string intident = actident;
-    ActiveTidents[intident] = now;
+    // drop invalid entries first and everything if this is not enough
+    std::map<std::string, std::shared_ptr<entry_t> >::iterator it;
+
+    for (it = shard.mEntries.begin(); it != shard.mEntries.end();)
+    {
+      if ((it->second->mGeneration != entry->mGeneration) ||
+          (it->second->mExpires < now))
+        shard.mEntries.erase(it++);
+      else
+        ++it;
+    }
+
+    if (shard.mEntries.size() >= mMaxEntries)
+      shard.mEntries.clear();
   }
-  ActiveLock.UnLock();
 
-  eos_static_debug("selected %d %d [%s %s]", vid.uid, vid.gid, ruid.c_str(), rgid.c_str());
-  if (log)
+  shard.mEntries[key] = entry;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Invalidate all cached identities
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+Mapping::vid_cache::Invalidate ()
+{
+  mGeneration++;
+  mInvalidations++;
+
+  for (unsigned int i = 0; i < sShards; i++)
   {
-    eos_static_info("%s sec.tident=\"%s\"", eos::common::SecEntity::ToString(client, Env.Get("eos.app")).c_str(), tident);
+    RWMutexWriteLock lock(mShards[i].mLocker);
+    mShards[i].mEntries.clear();
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Print the cache statistics
+ *
+ * @param stdOut the output is stored here
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+Mapping::vid_cache::Print (XrdOucString &stdOut)
+{
+  size_t entries = 0;
+
+  for (unsigned int i = 0; i < sShards; i++)
+  {
+    RWMutexReadLock lock(mShards[i].mLocker);
+    entries += mShards[i].mEntries.size();
   }
+
+  unsigned long long hits = mHits;
+  unsigned long long misses = mMisses;
+  char sline[1024];
+  snprintf(sline, sizeof (sline) - 1,
+           "vidcache: entries=%lu max=%lu hits=%llu misses=%llu hit-rate=%.02f%% "
+           "generation=%llu invalidations=%llu\n",
+           (unsigned long) entries, (unsigned long) (mMaxEntries * sShards),
+           hits, misses, (hits + misses) ? 100.0 * hits / (hits + misses) : 0.0,
+           (unsigned long long) mGeneration,
+           (unsigned long long) mInvalidations);
+  stdOut += sline;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -877,7 +1136,7 @@ Mapping::IdMap (const XrdSecEntity* client, const char* env, const char* tident,
  * Print the current mappings
  *
  * @param stdOut the output is stored here
- * @param option can be 'u' for user role mappings 'g' for group role mappings 's' for sudoer list 'U' for user alias mapping 'G' for group alias mapping 'y' for gateway mappings (tidents) 'a' for authentication mapping rules 'l' for geo location rules
+ * @param option can be 'u' for user role mappings 'g' for group role mappings 's' for sudoer list 'U' for user alias mapping 'G' for group alias mapping 'y' for gateway mappings (tidents) 'a' for authentication mapping rules 'l' for geo location rules 'c' for the identity cache statistics
  */
 
 /*----------------------------------------------------------------------------*/
@@ -1083,6 +1342,11 @@ Mapping::Print (XrdOucString &stdOut, XrdOucString option)
     }
   }
 
+  if (((option.find("c")) != STR_NPOS))
+  {
+    gVidCache.Print(stdOut);
+  }
+
   if ((!option.length()))
   {
     for (auto it = gAllowedTidentMatches.begin(); it != gAllowedTidentMatches.end(); ++it)
@@ -46,7 +46,9 @@
 /*----------------------------------------------------------------------------*/
 #include <pwd.h>
 #include <grp.h>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 #include <string>
@@ -144,6 +146,80 @@ public:
   // ---------------------------------------------------------------------------
   typedef struct VirtualIdentity_t VirtualIdentity;
 
+  // ---------------------------------------------------------------------------
+  //! Class caching the result of IdMap per client
+  //!
+  //! Entries are keyed by everything IdMap depends on besides the mapping
+  //! configuration: protocol, name, host, VOMS group/role, tident and the
+  //! role selection in the opaque environment. The configuration is covered
+  //! by a generation counter which is bumped by Invalidate on any change of
+  //! the vid maps, entries of an older generation are never returned.
+  // ---------------------------------------------------------------------------
+
+  class vid_cache {
+  public:
+    // cached virtual identity
+    struct entry_t {
+      VirtualIdentity mVid;
+      std::string mTident; // reduced tident used in the active client map
+      unsigned long long mGeneration;
+      time_t mExpires;
+      std::atomic<time_t> mActive; // last update of the active client map
+    };
+
+    // Constructor
+
+    vid_cache (int lifetime = 300);
+
+    // Destructor
+
+    virtual ~vid_cache ()
+    {
+    }
+
+    // Getter returning a valid entry or an empty pointer
+    std::shared_ptr<entry_t> Get (const std::string &key);
+
+    // Store an entry computed with the configuration of its generation
+    void Put (const std::string &key, std::shared_ptr<entry_t> entry);
+
+    // Current generation of the mapping configuration
+    unsigned long long GetGeneration () const
+    {
+      return mGeneration;
+    }
+
+    // Invalidate all entries, to be called after any change of the vid maps
+    void Invalidate ();
+
+    // Check if the cache is enabled
+    bool Enabled () const
+    {
+      return mMaxEntries > 0;
+    }
+
+    // Print the cache statistics
+    void Print (XrdOucString &stdOut);
+
+  private:
+    static const unsigned int sShards = 16;
+
+    struct shard_t {
+      RWMutex mLocker;
+      std::map<std::string, std::shared_ptr<entry_t> > mEntries;
+    };
+
+    shard_t& GetShard (const std::string &key);
+
+    shard_t mShards[sShards];
+    size_t mMaxEntries; // per shard
+    int mLifeTime;
+    std::atomic<unsigned long long> mGeneration;
+    std::atomic<unsigned long long> mHits;
+    std::atomic<unsigned long long> mMisses;
+    std::atomic<unsigned long long> mInvalidations;
+  };
+
   // ---------------------------------------------------------------------------
   //! Function creating the Nobody identity
   // ---------------------------------------------------------------------------
@@ -253,6 +329,16 @@ public:
   // ---------------------------------------------------------------------------
   static void IdMap (const XrdSecEntity* client, const char* env, const char* tident, Mapping::VirtualIdentity &vid, bool log = true);
 
+  // ---------------------------------------------------------------------------
+  //! Mapping function doing the actual work of IdMap for a 'nobody' identity
+  // ---------------------------------------------------------------------------
+  static void MapIdentity (const XrdSecEntity* client, XrdOucEnv &Env, const char* tident, Mapping::VirtualIdentity &vid, XrdOucString &mytident);
+
+  // ---------------------------------------------------------------------------
+  //! Function applying a mapped identity to the identity given to IdMap
+  // ---------------------------------------------------------------------------
+  static void ApplyIdentity (const VirtualIdentity &mapped, VirtualIdentity &vid);
+
   // ---------------------------------------------------------------------------
   //! Map describing which virtual user roles a user with a given uid has
   // ---------------------------------------------------------------------------
@@ -333,6 +419,11 @@ public:
   // ---------------------------------------------------------------------------
   static ip_cache gIpCache;
 
+  // ---------------------------------------------------------------------------
+  //! Cache of mapped virtual identities used by IdMap
+  // ---------------------------------------------------------------------------
+  static vid_cache gVidCache;
+
 
   // ---------------------------------------------------------------------------
   //! Function to expire unused ActiveTident entries by default after 1 day
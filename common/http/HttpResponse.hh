@@ -38,6 +38,7 @@
 /*----------------------------------------------------------------------------*/
 #include <map>
 #include <string>
+#include <sys/types.h>
 /*----------------------------------------------------------------------------*/
 
 EOSCOMMONNAMESPACE_BEGIN
@@ -96,6 +97,7 @@ protected:
 public:
   off_t        mResponseLength;        //!< length of the response
   bool         mUseFileReaderCallback; //!< read the file using callbacks
+  bool         mUseBodyCallback;       //!< produce the body using ReadBody
 
 public:
 
@@ -103,7 +105,8 @@ public:
    * Constructor
    */
   HttpResponse () :
-    mResponseCode(OK), mResponseLength(0), mUseFileReaderCallback(false) {};
+    mResponseCode(OK), mResponseLength(0), mUseFileReaderCallback(false),
+    mUseBodyCallback(false) {};
 
   /**
    * Destructor
@@ -164,6 +167,20 @@ public:
   inline size_t
   GetBodySize () { return mResponseBody.length(); }
 
+  /**
+   * Produce the next piece of a streamed response body. Responses setting
+   * mUseBodyCallback have to implement it, the body is then sent in pieces
+   * while it is built instead of being kept in memory as a whole.
+   *
+   * @param buf  the buffer to fill
+   * @param max  the size of the buffer
+   *
+   * @return number of bytes stored in buf, 0 at the end of the body and -1
+   *         on error
+   */
+  virtual ssize_t
+  ReadBody (char *buf, size_t max) { return 0; }
+
   /**
    * @return the server response code
    */
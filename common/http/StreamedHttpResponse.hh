@@ -0,0 +1,151 @@
+// ----------------------------------------------------------------------
+// File: StreamedHttpResponse.hh
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/**
+ * @file   StreamedHttpResponse.hh
+ *
+ * @brief  HTTP response whose body is built piece by piece while it is sent
+ *         to the client.
+ */
+
+#ifndef __EOSCOMMON_STREAMED_HTTP_RESPONSE__HH__
+#define __EOSCOMMON_STREAMED_HTTP_RESPONSE__HH__
+
+/*----------------------------------------------------------------------------*/
+#include "common/http/PlainHttpResponse.hh"
+#include "common/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+#include <string>
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_BEGIN
+
+/**
+ * Buffer between a producer appending the body of a response piece by piece
+ * and the HTTP server reading it in blocks of its own size. Responses which
+ * can not derive from StreamedHttpResponse use it as a second base class.
+ */
+class HttpBodyStream
+{
+
+private:
+  std::string mPending;    //!< produced data not yet sent
+  size_t      mPendingPos; //!< position of the unsent data in mPending
+  bool        mDone;       //!< true once the producer has finished
+
+public:
+
+  /**
+   * Constructor
+   */
+  HttpBodyStream () : mPendingPos(0), mDone(false) {};
+
+  /**
+   * Destructor
+   */
+  virtual ~HttpBodyStream () {};
+
+  /**
+   * Append the next piece of the body. Implementations should produce a
+   * few tens of kilobytes per call.
+   *
+   * @param body  the string to append the next piece to
+   *
+   * @return false once the body is complete, true if there is more to come
+   */
+  virtual bool
+  Produce (std::string &body) = 0;
+
+  /**
+   * Read the next block of the body
+   *
+   * @param buf  the buffer to fill
+   * @param max  the size of the buffer
+   *
+   * @return number of bytes stored in buf, 0 at the end of the body
+   */
+  ssize_t
+  ReadStream (char *buf, size_t max)
+  {
+    size_t nread = 0;
+
+    while (nread < max)
+    {
+      if (mPendingPos == mPending.length())
+      {
+        if (mDone)
+          break;
+
+        mPending.clear();
+        mPendingPos = 0;
+        mDone = !Produce(mPending);
+        continue;
+      }
+
+      size_t len = mPending.length() - mPendingPos;
+
+      if (len > max - nread)
+        len = max - nread;
+
+      memcpy(buf + nread, mPending.c_str() + mPendingPos, len);
+      mPendingPos += len;
+      nread += len;
+    }
+
+    return nread;
+  }
+};
+
+/**
+ * Plain response with a streamed body, the concrete response implements
+ * Produce.
+ */
+class StreamedHttpResponse : public PlainHttpResponse, public HttpBodyStream
+{
+
+public:
+
+  /**
+   * Constructor
+   */
+  StreamedHttpResponse ()
+  {
+    mUseBodyCallback = true;
+  };
+
+  /**
+   * Destructor
+   */
+  virtual ~StreamedHttpResponse () {};
+
+  /**
+   * Produce the next piece of the body
+   */
+  ssize_t
+  ReadBody (char *buf, size_t max) { return ReadStream(buf, max); }
+};
+
+/*----------------------------------------------------------------------------*/
+EOSCOMMONNAMESPACE_END
+
+#endif /* __EOSCOMMON_STREAMED_HTTP_RESPONSE__HH__ */
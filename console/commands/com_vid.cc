@@ -477,7 +477,7 @@ com_vid (char* arg1)
   }
 
 com_vid_usage:
-  fprintf(stdout, "usage: vid ls [-u] [-g] [-s] [-U] [-G] [-g] [-a] [-l] [-n]                                          : list configured policies\n");
+  fprintf(stdout, "usage: vid ls [-u] [-g] [-s] [-U] [-G] [-g] [-a] [-l] [-c] [-n]                                      : list configured policies\n");
   fprintf(stdout, "                                        -u : show only user role mappings\n");
   fprintf(stdout, "                                        -g : show only group role mappings\n");
   fprintf(stdout, "                                        -s : show list of sudoers\n");
@@ -486,6 +486,7 @@ com_vid_usage:
   fprintf(stdout, "                                        -y : show configured gateways\n");
   fprintf(stdout, "                                        -a : show authentication\n");
   fprintf(stdout, "                                        -l : show geo location mapping\n");
+  fprintf(stdout, "                                        -c : show identity cache statistics\n");
   fprintf(stdout, "                                        -n : show numerical ids instead of user/group names\n");
   fprintf(stdout, "\n");
   fprintf(stdout, "       vid set membership <uid> -uids [<uid1>,<uid2>,...]\n");
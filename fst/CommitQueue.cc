@@ -0,0 +1,376 @@
+//------------------------------------------------------------------------------
+// File: CommitQueue.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "fst/CommitQueue.hh"
+#include "fst/XrdFstOfs.hh"
+#include "fst/Config.hh"
+#include "common/SymKeys.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdCl/XrdClFileSystem.hh"
+#include "XrdSys/XrdSysTimer.hh"
+/*----------------------------------------------------------------------------*/
+#include <arpa/inet.h>
+#include <cstdlib>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//! Time during which single commits are used for a manager which rejected a
+//! batch e.g. because it does not implement batched commits yet
+#define COMMITQUEUE_NOBATCH_TIME 300
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+CommitQueue::CommitQueue ():
+  eos::common::LogId(), mStartTime(time(NULL)), mBatchSeq(0)
+{
+  SetLogId("FstCommitQueue");
+}
+
+//------------------------------------------------------------------------------
+// Start the sender threads
+//------------------------------------------------------------------------------
+bool
+CommitQueue::Start (unsigned int nthreads)
+{
+  for (unsigned int i = 0; i < nthreads; i++)
+  {
+    pthread_t tid;
+
+    if (XrdSysThread::Run(&tid, CommitQueue::StartSender,
+                          static_cast<void*>(this), 0, "Commit Sender"))
+    {
+      eos_err("msg=\"cannot start commit sender thread\"");
+      return false;
+    }
+
+    mThreads.push_back(tid);
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Sender thread startup function
+//------------------------------------------------------------------------------
+void*
+CommitQueue::StartSender (void* pp)
+{
+  static_cast<CommitQueue*>(pp)->Sender();
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Commit a file to the MGM
+//------------------------------------------------------------------------------
+int
+CommitQueue::Commit (XrdOucErrInfo* error, const char* path,
+                     const char* manager, XrdOucString& capOpaqueFile)
+{
+  static const char* epname = "CommitQueue";
+  Request req;
+  bool batched = false;
+
+  if (manager)
+  {
+    req.mManager = manager;
+  }
+  else
+  {
+    // use the broadcasted manager name
+    XrdSysMutexHelper lock(Config::gConfig.Mutex);
+    req.mManager = Config::gConfig.Manager.c_str();
+  }
+
+  req.mOpaque = capOpaqueFile.c_str();
+
+  if (!mThreads.empty() &&
+      ((req.mOpaque.length() + sizeof(uint32_t)) <= sMaxBatchBytes))
+  {
+    XrdSysCondVarHelper lock(mQueueCond);
+    std::map<std::string, time_t>::iterator it = mNoBatch.find(req.mManager);
+
+    if ((it == mNoBatch.end()) || (it->second < time(NULL)))
+    {
+      mQueue.push_back(&req);
+      mQueueCond.Signal();
+      batched = true;
+    }
+  }
+
+  if (batched)
+  {
+    req.mDone.Wait();
+  }
+
+  if (!batched || req.mFallback)
+  {
+    return gOFS.CallManager(error, path, manager, capOpaqueFile);
+  }
+
+  if (!req.mErrno)
+  {
+    return SFS_OK;
+  }
+
+  if (error)
+  {
+    gOFS.Emsg(epname, *error, req.mErrno, "commit file metadata", path);
+  }
+
+  // same return codes as CallManager for errors handled by the caller
+  switch (req.mErrno)
+  {
+  case EIDRM:
+  case EBADE:
+  case EBADR:
+  case EINVAL:
+  case EADV:
+    return -req.mErrno;
+
+  default:
+    return SFS_ERROR;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Sender loop collecting and sending batches
+//------------------------------------------------------------------------------
+void
+CommitQueue::Sender ()
+{
+  XrdCl::FileSystem* fs = 0;
+  std::string fsManager = "";
+
+  while (1)
+  {
+    std::vector<Request*> batch;
+    std::string manager;
+    unsigned long long seq;
+    {
+      XrdSysCondVarHelper lock(mQueueCond);
+
+      while (mQueue.empty())
+      {
+        mQueueCond.Wait();
+      }
+
+      seq = ++mBatchSeq;
+
+      // take all queued records for the manager of the oldest one
+      manager = mQueue.front()->mManager;
+      size_t nbytes = sizeof(uint32_t);
+
+      for (std::deque<Request*>::iterator it = mQueue.begin();
+           (it != mQueue.end()) && (batch.size() < sMaxBatchRecords);)
+      {
+        if ((*it)->mManager != manager)
+        {
+          ++it;
+          continue;
+        }
+
+        size_t reclen = sizeof(uint32_t) + (*it)->mOpaque.length();
+
+        if (nbytes + reclen > sMaxBatchBytes)
+        {
+          break;
+        }
+
+        nbytes += reclen;
+        batch.push_back(*it);
+        it = mQueue.erase(it);
+      }
+    }
+
+    if (fsManager != manager)
+    {
+      // keep one connection object per sender for the current manager
+      delete fs;
+      fs = 0;
+      fsManager = manager;
+    }
+
+    // unique batch id allowing the MGM to recognize a resent batch
+    std::string batchid;
+    {
+      XrdSysMutexHelper lock(Config::gConfig.Mutex);
+      batchid = Config::gConfig.FstHostPort.c_str();
+    }
+    batchid += ":";
+    batchid += std::to_string((long long) mStartTime);
+    batchid += ":";
+    batchid += std::to_string(seq);
+    SendBatch(fs, manager, batchid, batch);
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+      batch[i]->mDone.Post();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Send one batch of records to the same manager
+//------------------------------------------------------------------------------
+void
+CommitQueue::SendBatch (XrdCl::FileSystem*& fs, const std::string& manager,
+                        const std::string& batchid,
+                        std::vector<Request*>& batch)
+{
+  std::string records;
+  uint32_t value = htonl(batch.size());
+  records.append((const char*) &value, sizeof(value));
+
+  for (size_t i = 0; i < batch.size(); i++)
+  {
+    value = htonl(batch[i]->mOpaque.length());
+    records.append((const char*) &value, sizeof(value));
+    records += batch[i]->mOpaque;
+  }
+
+  XrdOucString records64;
+  std::string address = "root://";
+  address += manager;
+  address += "//dummy";
+  XrdCl::URL url(address);
+
+  if (!url.IsValid() ||
+      !eos::common::SymKey::Base64Encode((char*) records.c_str(), records.length(),
+                                         records64))
+  {
+    eos_err("msg=\"cannot build commit batch\" manager=%s", manager.c_str());
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+      batch[i]->mFallback = true;
+    }
+
+    return;
+  }
+
+  // the MGM answers a resent batch id from its reply cache, so retrying after
+  // a network error does not apply any record twice
+  XrdOucString query = "/?mgm.pcmd=commitbatch&mgm.commit.batchid=";
+  query += batchid.c_str();
+  query += "&mgm.commit.batch=";
+  query += records64;
+  XrdCl::Buffer arg;
+  arg.FromString(query.c_str());
+
+  while (1)
+  {
+    if (!fs)
+    {
+      fs = new XrdCl::FileSystem(url);
+    }
+
+    XrdCl::Buffer* response = 0;
+    XrdCl::XRootDStatus status = fs->Query(XrdCl::QueryCode::OpaqueFile, arg,
+                                           response);
+
+    if (status.IsOK())
+    {
+      // response format: OK <n> <errno-1> ... <errno-n>
+      std::string reply = response ? response->ToString() : "";
+      delete response;
+      const char* ptr = reply.c_str();
+      char* end = 0;
+      size_t nanswered = 0;
+
+      if ((reply.compare(0, 3, "OK ") == 0) &&
+          (strtoul(ptr + 3, &end, 10) == batch.size()))
+      {
+        ptr = end;
+
+        for (; nanswered < batch.size(); nanswered++)
+        {
+          long retc = strtol(ptr, &end, 10);
+
+          if (end == ptr)
+          {
+            break;
+          }
+
+          batch[nanswered]->mErrno = retc;
+          ptr = end;
+        }
+      }
+
+      if (nanswered < batch.size())
+      {
+        // only the records without a status of their own are sent again
+        eos_err("msg=\"incomplete commit batch response\" manager=%s "
+                "answered=%lu records=%lu response=\"%s\"", manager.c_str(),
+                (unsigned long) nanswered, (unsigned long) batch.size(),
+                reply.c_str());
+
+        for (size_t i = nanswered; i < batch.size(); i++)
+        {
+          batch[i]->mFallback = true;
+        }
+      }
+      else
+      {
+        eos_debug("msg=\"committed batch\" manager=%s records=%lu",
+                  manager.c_str(), (unsigned long) batch.size());
+      }
+
+      return;
+    }
+
+    delete response;
+
+    if ((status.code >= 100) && (status.code <= 300))
+    {
+      // network errors will be cured at some point - reconnect and retry
+      eos_err("msg=\"commit batch query error\" status=%d code=%d",
+              status.status, status.code);
+      delete fs;
+      fs = 0;
+      XrdSysTimer sleeper;
+      sleeper.Snooze(1);
+      continue;
+    }
+
+    // the manager rejected the whole batch before applying any record - use
+    // single commits for a while
+    eos_warning("msg=\"commit batch rejected - falling back to single commits\" "
+                "manager=%s error=\"%s\"", manager.c_str(),
+                status.ToString().c_str());
+    {
+      XrdSysCondVarHelper lock(mQueueCond);
+      mNoBatch[manager] = time(NULL) + COMMITQUEUE_NOBATCH_TIME;
+    }
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+      batch[i]->mFallback = true;
+    }
+
+    return;
+  }
+}
+
+EOSFSTNAMESPACE_END
@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+// File: CommitQueue.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSFST_COMMITQUEUE_HH__
+#define __EOSFST_COMMITQUEUE_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "fst/Namespace.hh"
+#include "common/Logging.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+#include "XrdOuc/XrdOucString.hh"
+#include "XrdOuc/XrdOucErrInfo.hh"
+/*----------------------------------------------------------------------------*/
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <ctime>
+/*----------------------------------------------------------------------------*/
+
+namespace XrdCl
+{
+class FileSystem;
+}
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class CommitQueue
+//!
+//! @description Coalesces the close commits of many files into batched commit
+//! requests sent to the MGM over persistent connections. A batch is a list of
+//! length-prefixed commit opaque strings transported base64 encoded in a
+//! single 'commitbatch' query and answered with one errno per record. The
+//! caller of Commit blocks until its own record has been answered, so the
+//! close semantics are the same as for a direct CallManager commit.
+//------------------------------------------------------------------------------
+class CommitQueue : public eos::common::LogId
+{
+public:
+  //! Maximum number of records in one batch
+  static const size_t sMaxBatchRecords = 64;
+  //! Maximum size of the raw record list - the MGM accepts up to 16kB of
+  //! opaque information, base64 encoding adds one third
+  static const size_t sMaxBatchBytes = 11264;
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  CommitQueue ();
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  virtual ~CommitQueue () { };
+
+  //----------------------------------------------------------------------------
+  //! Start the sender threads
+  //!
+  //! @param nthreads number of sender threads
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool Start (unsigned int nthreads);
+
+  //----------------------------------------------------------------------------
+  //! Commit a file to the MGM - same interface and return codes as
+  //! XrdFstOfs::CallManager
+  //!
+  //! @param error error object filled in case of failure
+  //! @param path logical path used for error messages
+  //! @param manager MGM host:port or 0 for the broadcasted manager
+  //! @param capOpaqueFile commit opaque information
+  //!
+  //! @return SFS_OK if successful, otherwise SFS_ERROR or -errno for the
+  //!         errors the caller has to handle
+  //----------------------------------------------------------------------------
+  int Commit (XrdOucErrInfo* error, const char* path, const char* manager,
+              XrdOucString& capOpaqueFile);
+
+  //----------------------------------------------------------------------------
+  //! Sender thread startup function
+  //----------------------------------------------------------------------------
+  static void* StartSender (void* pp);
+
+private:
+  //----------------------------------------------------------------------------
+  //! Pending commit
+  //----------------------------------------------------------------------------
+  struct Request
+  {
+    std::string mManager; ///< MGM host:port
+    std::string mOpaque; ///< commit opaque information
+    int mErrno; ///< errno returned by the MGM for this record
+    bool mFallback; ///< the record got no status and has to be sent as a
+                    ///< single commit
+    XrdSysSemaphore mDone; ///< posted once the record is answered
+
+    Request () : mErrno(0), mFallback(false), mDone(0) { }
+  };
+
+  //----------------------------------------------------------------------------
+  //! Sender loop collecting and sending batches
+  //----------------------------------------------------------------------------
+  void Sender ();
+
+  //----------------------------------------------------------------------------
+  //! Send one batch of records to the same manager and fill in the results
+  //!
+  //! @param fs connection to the manager, (re)created if needed
+  //! @param manager MGM host:port
+  //! @param batchid id identifying a resent batch at the MGM
+  //! @param batch records to commit
+  //----------------------------------------------------------------------------
+  void SendBatch (XrdCl::FileSystem*& fs, const std::string& manager,
+                  const std::string& batchid, std::vector<Request*>& batch);
+
+  XrdSysCondVar mQueueCond; ///< protecting mQueue, mNoBatch and mBatchSeq
+  std::deque<Request*> mQueue; ///< commits waiting to be sent
+  //! managers not supporting batched commits and the time until when
+  std::map<std::string, time_t> mNoBatch;
+  std::vector<pthread_t> mThreads; ///< sender threads
+  time_t mStartTime; ///< start time, part of the batch ids
+  unsigned long long mBatchSeq; ///< last batch sequence number
+};
+
+EOSFSTNAMESPACE_END
+
+#endif
@@ -39,6 +39,8 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <deque>
+#include <functional>
 /*----------------------------------------------------------------------------*/
 
 EOSFSTNAMESPACE_BEGIN
@@ -47,6 +49,136 @@ EOSFSTNAMESPACE_BEGIN
 FmdDbMapHandler gFmdDbMapHandler; //< static
 /*----------------------------------------------------------------------------*/
 
+/*----------------------------------------------------------------------------*/
+/** 
+ * Bounded queue of items processed by a pool of threads. It lets the
+ * directory walk or the parsing of an mgm dump run ahead of the work per
+ * file, while the number of threads bounds the requests in flight on a disk.
+ */
+
+/*----------------------------------------------------------------------------*/
+class ResyncPipeline
+{
+public:
+
+  ResyncPipeline (unsigned int nthreads, std::function<void (const std::string&) > work) :
+    mCond(0), mWork(work), mMaxQueued(2 * nthreads), mDone(false)
+  {
+    for (unsigned int i = 0; i < nthreads; i++)
+    {
+      pthread_t tid;
+      if (XrdSysThread::Run(&tid, ResyncPipeline::StartWorker, static_cast<void*> (this), XRDSYSTHREAD_HOLD, "Resync Worker"))
+      {
+        eos_static_err("cannot start resync worker thread");
+        continue;
+      }
+      mThreads.push_back(tid);
+    }
+  }
+
+  ~ResyncPipeline ()
+  {
+    Finish();
+  }
+
+  // ---------------------------------------------------------------------------
+  //! Queue an item, blocks while the queue is full
+  // ---------------------------------------------------------------------------
+  void
+  Push (const std::string& item)
+  {
+    if (mThreads.empty())
+    {
+      // no worker could be started, do the work inline
+      mWork(item);
+      return;
+    }
+
+    mCond.Lock();
+    while (mQueue.size() >= mMaxQueued)
+    {
+      mCond.Wait();
+    }
+    mQueue.push_back(item);
+    mCond.Broadcast();
+    mCond.UnLock();
+  }
+
+  // ---------------------------------------------------------------------------
+  //! Wait until all queued items have been processed
+  // ---------------------------------------------------------------------------
+  void
+  Finish ()
+  {
+    mCond.Lock();
+    mDone = true;
+    mCond.Broadcast();
+    mCond.UnLock();
+
+    for (size_t i = 0; i < mThreads.size(); i++)
+    {
+      XrdSysThread::Join(mThreads[i], NULL);
+    }
+    mThreads.clear();
+  }
+
+private:
+
+  static void*
+  StartWorker (void* pp)
+  {
+    static_cast<ResyncPipeline*> (pp)->Worker();
+    return 0;
+  }
+
+  void
+  Worker ()
+  {
+    mCond.Lock();
+    while (1)
+    {
+      while (mQueue.empty() && !mDone)
+      {
+        mCond.Wait();
+      }
+      if (mQueue.empty())
+      {
+        break;
+      }
+      std::string item = mQueue.front();
+      mQueue.pop_front();
+      // there is room for the producer again
+      mCond.Broadcast();
+      mCond.UnLock();
+      mWork(item);
+      mCond.Lock();
+    }
+    mCond.UnLock();
+  }
+
+  XrdSysCondVar mCond; //< protecting mQueue and mDone
+  std::function<void (const std::string&) > mWork; //< work per item
+  std::deque<std::string> mQueue; //< items waiting for a worker
+  size_t mMaxQueued; //< maximum number of waiting items
+  bool mDone; //< no more items will be queued
+  std::vector<pthread_t> mThreads; //< worker threads
+};
+
+/*----------------------------------------------------------------------------*/
+/** 
+ * Number of files of a disk resynced in parallel, configured via the
+ * environment variable EOS_FST_BOOT_QUEUE_DEPTH (default 16)
+ */
+
+/*----------------------------------------------------------------------------*/
+static unsigned int
+GetResyncQueueDepth ()
+{
+  static unsigned int depth = getenv("EOS_FST_BOOT_QUEUE_DEPTH") ?
+    strtoul(getenv("EOS_FST_BOOT_QUEUE_DEPTH"), 0, 10) : 16;
+  return depth;
+}
+
 /*----------------------------------------------------------------------------*/
 /** 
  * Set a new DB file for a filesystem id.
@@ -85,6 +217,26 @@ FmdDbMapHandler::SetDBFile (const char* dbfileprefix, int fsid, XrdOucString opt
     dbmap[fsid]=new eos::common::DbMap();
   }
 
+  if (!dirtymap.count(fsid))
+  {
+    dirtymap[fsid] = new FmdDirtySet();
+  }
+
+  {
+    // start the write back of the Fmd records with the first DB
+    XrdSysMutexHelper flock(mFlusherMutex);
+    if (!mFlusherRun)
+    {
+      mFlusherRun = true;
+      if (XrdSysThread::Run(&mFlusherTid, FmdDbMapHandler::StartFlusher, static_cast<void*> (this), XRDSYSTHREAD_HOLD, "Fmd Flusher"))
+      {
+        eos_crit("cannot start the fmd flusher thread");
+        mFlusherRun = false;
+        return false;
+      }
+    }
+  }
+
 
   //! -when we successfully attach to a DB we set the mode to S_IRWXU & ~S_IRGRP
   //! -when we shutdown the daemon clean we set the mode back to S_IRWXU | S_IRGRP
@@ -161,6 +313,16 @@ FmdDbMapHandler::ShutdownDB (eos::common::FileSystem::fsid_t fsid)
   eos_info("%s DB shutdown for fsid=%lu\n", eos::common::DbMap::getDbType().c_str(), (unsigned long) fsid);
   if (dbmap.count(fsid))
   {
+    // write back all records before the DB is marked clean
+    if (!FlushFmd(fsid))
+    {
+      stayDirty[fsid] = true;
+    }
+    if (dirtymap.count(fsid))
+    {
+      delete dirtymap[fsid];
+      dirtymap.erase(fsid);
+    }
     if (!stayDirty[fsid])
     {
       // if there was a complete boot procedure done, we remove the dirty flag
@@ -339,10 +501,6 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
 
       gettimeofday(&tv, &tz);
 
-      Mutex.UnLockRead(); // <--
-
-      eos::common::RWMutexWriteLock lock(Mutex); // --> (return)
-
       valfmd.set_uid(uid);
       valfmd.set_gid(gid);
       valfmd.set_lid(layoutid);
@@ -360,23 +518,26 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
       FmdHelper* fmd = new FmdHelper(fid, fsid);
       if (!fmd)
       {
+        Mutex.UnLockRead();
         return 0;
       }
 
       // make a copy of the current record
       fmd->Replicate(valfmd);
 
+      // the record only goes to the dirty set, the read lock is enough
       if (Commit(fmd, false))
       {
         eos_debug("returning meta data block for fid %d on fs %d", fid, (unsigned long) fsid);
         // return the mmaped meta data block
-
+        Mutex.UnLockRead();
         return fmd;
       }
       else
       {
         eos_crit("unable to write new block for fid %d on fs %d - no changelog db open for writing", fid, (unsigned long) fsid);
         delete fmd;
+        Mutex.UnLockRead();
         return 0;
       }
     }
@@ -412,19 +573,24 @@ FmdDbMapHandler::DeleteFmd (eos::common::FileId::fileid_t fid, eos::common::File
 {
   bool rc = true;
   eos_static_info("");
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
+
+  FmdDirtySet* dirty = GetDirtySet(fsid);
+  if (!dirty)
+  {
+    return false;
+  }
 
+  XrdSysMutexHelper dlock(dirty->mMutex);
   bool entryexist=ExistFmd(fid,fsid);
 
   // erase the hash entry
-  if (dbmap.count(fsid) && entryexist)
+  if (entryexist)
   {
-    // delete in the in-memory hash
-    if( dbmap[fsid]->remove(eos::common::Slice((const char*)&fid,sizeof(fid))) )
-    {
-      eos_err("unable to delete fid=%08llx from fst table\n", fid);
-      rc = false;
-    }
+    // the record is removed from the DB with the next write back
+    FmdDirtyEntry& entry = dirty->mEntries[fid];
+    entry.mDeleted = true;
+    entry.mValue.clear();
   }
   else
   {
@@ -466,24 +632,25 @@ FmdDbMapHandler::Commit (FmdHelper* fmd, bool lockit)
   if (lockit)
   {
     // ---->
-    Mutex.LockWrite();
+    Mutex.LockRead();
   }
 
   if (dbmap.count(fsid))
   {
     // update in-memory
+    bool rc = PutFmd(fid,fsid,fmd->fMd);
     if (lockit)
     {
-      Mutex.UnLockWrite(); // <----
+      Mutex.UnLockRead(); // <----
     }
-    return PutFmd(fid,fsid,fmd->fMd);
+    return rc;
   }
   else
   {
     eos_crit("no %s DB open for fsid=%llu", eos::common::DbMap::getDbType().c_str(), (unsigned long) fsid);
     if (lockit)
     {
-      Mutex.UnLockWrite(); // <----
+      Mutex.UnLockRead(); // <----
     }
   }
 
@@ -509,7 +676,7 @@ FmdDbMapHandler::Commit (FmdHelper* fmd, bool lockit)
 bool
 FmdDbMapHandler::UpdateFromDisk (eos::common::FileSystem::fsid_t fsid, eos::common::FileId::fileid_t fid, unsigned long long disksize, std::string diskchecksum, unsigned long checktime, bool filecxerror, bool blockcxerror, bool flaglayouterror)
 {
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
 
   eos_debug("fsid=%lu fid=%08llx disksize=%llu diskchecksum=%s checktime=%llu fcxerror=%d bcxerror=%d flaglayouterror=%d", (unsigned long) fsid, fid, disksize, diskchecksum.c_str(), checktime, filecxerror, blockcxerror, flaglayouterror);
 
@@ -519,6 +686,10 @@ FmdDbMapHandler::UpdateFromDisk (eos::common::FileSystem::fsid_t fsid, eos::comm
     return false;
   }
 
+  // serialize the read-modify-write of the record within the filesystem
+  FmdDirtySet* dirty = GetDirtySet(fsid);
+  XrdSysMutexHelper dlock(dirty ? &dirty->mMutex : 0);
+
   Fmd valfmd=RetrieveFmd(fid,fsid);
 
   if (dbmap.count(fsid))
@@ -568,7 +739,7 @@ FmdDbMapHandler::UpdateFromDisk (eos::common::FileSystem::fsid_t fsid, eos::comm
 bool
 FmdDbMapHandler::UpdateFromMgm (eos::common::FileSystem::fsid_t fsid, eos::common::FileId::fileid_t fid, eos::common::FileId::fileid_t cid, eos::common::LayoutId::layoutid_t lid, unsigned long long mgmsize, std::string mgmchecksum, uid_t uid, gid_t gid, unsigned long long ctime, unsigned long long ctime_ns, unsigned long long mtime, unsigned long long mtime_ns, int layouterror, std::string locations)
 {
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
 
   eos_debug("fsid=%lu fid=%08llx cid=%llu lid=%lx mgmsize=%llu mgmchecksum=%s",
       (unsigned long) fsid, fid, cid, lid, mgmsize, mgmchecksum.c_str());
@@ -579,6 +750,10 @@ FmdDbMapHandler::UpdateFromMgm (eos::common::FileSystem::fsid_t fsid, eos::commo
     return false;
   }
 
+  // serialize the read-modify-write of the record within the filesystem
+  FmdDirtySet* dirty = GetDirtySet(fsid);
+  XrdSysMutexHelper dlock(dirty ? &dirty->mMutex : 0);
+
   bool entryexist=ExistFmd(fid,fsid);
   Fmd valfmd=RetrieveFmd(fid,fsid);
 
@@ -639,6 +814,8 @@ FmdDbMapHandler::ResetDiskInformation (eos::common::FileSystem::fsid_t fsid)
     const eos::common::DbMapTypes::Tkey *k;
     const eos::common::DbMapTypes::Tval *v;
     eos::common::DbMapTypes::Tval val;
+    // the iteration only sees records written back to the DB
+    FlushFmd(fsid);
     dbmap[fsid]->beginSetSequence();
     unsigned long cpt=0;
     for ( dbmap[fsid]->beginIter(); dbmap[fsid]->iterate(&k, &v);) {
@@ -689,6 +866,8 @@ FmdDbMapHandler::ResetMgmInformation (eos::common::FileSystem::fsid_t fsid)
     const eos::common::DbMapTypes::Tkey *k;
     const eos::common::DbMapTypes::Tval *v;
     eos::common::DbMapTypes::Tval val;
+    // the iteration only sees records written back to the DB
+    FlushFmd(fsid);
     dbmap[fsid]->beginSetSequence();
     unsigned long cpt=0;
 
@@ -813,6 +992,7 @@ FmdDbMapHandler::ResyncDisk (const char* path,
  * 
  * @param path path to scan
  * @param fsid file system id
+ * @param progress if not 0 counts the resynced files
  * 
  * @return true if successfull
  */
@@ -821,7 +1001,8 @@ FmdDbMapHandler::ResyncDisk (const char* path,
 bool
 FmdDbMapHandler::ResyncAllDisk (const char* path,
     eos::common::FileSystem::fsid_t fsid,
-    bool flaglayouterror)
+    bool flaglayouterror,
+    ResyncProgress* progress)
 {
   char **paths = (char**) calloc(2, sizeof (char*));
   paths[0] = (char*) path;
@@ -851,6 +1032,17 @@ FmdDbMapHandler::ResyncAllDisk (const char* path,
     return false;
   }
 
+  // the walk feeds the stat and extended attribute reads of the workers
+  ResyncPipeline pipeline(GetResyncQueueDepth(),
+                          [this, fsid, flaglayouterror, progress] (const std::string& file)
+  {
+    ResyncDisk(file.c_str(), fsid, flaglayouterror);
+    if (progress)
+    {
+      progress->mDiskFiles++;
+    }
+  });
+
   FTSENT *node;
   unsigned long long cnt = 0;
   while ((node = fts_read(tree)))
@@ -868,7 +1060,7 @@ FmdDbMapHandler::ResyncAllDisk (const char* path,
         {
           cnt++;
           eos_debug("file=%s", filePath.c_str());
-          ResyncDisk(filePath.c_str(), fsid, flaglayouterror);
+          pipeline.Push(filePath.c_str());
           if (!(cnt % 10000))
           {
             eos_info("msg=\"synced files so far\" nfiles=%llu fsid=%lu", cnt, (unsigned long) fsid);
@@ -877,6 +1069,8 @@ FmdDbMapHandler::ResyncAllDisk (const char* path,
       }
     }
   }
+  pipeline.Finish();
+
   if (fts_close(tree))
   {
     eos_err("fts_close failed");
@@ -1013,21 +1207,45 @@ FmdDbMapHandler::ResyncMgm (eos::common::FileSystem::fsid_t fsid,
  * Resync all meta data from MGM into DB
  * 
  * @param fsid filesystem id
+ * @param manager manager hostname:port
+ * @param progress if not 0 counts the resynced records
  * 
  * @return true if successfull
  */
 
 /*----------------------------------------------------------------------------*/
 bool
-FmdDbMapHandler::ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char* manager)
+FmdDbMapHandler::ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char* manager, ResyncProgress* progress)
 {
+  std::string dumpfile;
 
-  if (!ResetMgmInformation(fsid))
+  if (!FetchMgmDump(fsid, manager, dumpfile))
   {
-    eos_err("failed to reset the mgm information before resyncing");
     return false;
   }
 
+  bool rc = ResyncAllFromDump(fsid, dumpfile.c_str(), progress);
+
+  // remove the temporary file
+  unlink(dumpfile.c_str());
+  return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+/** 
+ * Download the meta data dump of a filesystem from the MGM
+ * 
+ * @param fsid file system id
+ * @param manager manager hostname:port
+ * @param dumpfile filled with the name of the temporary dump file
+ * 
+ * @return true if successfull
+ */
+
+/*----------------------------------------------------------------------------*/
+bool
+FmdDbMapHandler::FetchMgmDump (eos::common::FileSystem::fsid_t fsid, const char* manager, std::string& dumpfile)
+{
   XrdOucString consolestring = "/proc/admin/?&mgm.format=fuse&mgm.cmd=fs&mgm.subcmd=dumpmd&mgm.dumpmd.storetime=1&mgm.dumpmd.option=m&mgm.fsid=";
   consolestring += (int) fsid;
   XrdOucString url = "root://";
@@ -1045,6 +1263,8 @@ FmdDbMapHandler::ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char*
   if (WEXITSTATUS(rc))
   {
     eos_err("%s returned %d", cmd.c_str(), WEXITSTATUS(rc));
+    unlink(tmpfile);
+    free(tmpfile);
     return false;
   }
   else
@@ -1052,15 +1272,36 @@ FmdDbMapHandler::ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char*
     eos_debug("%s executed successfully", cmd.c_str());
   }
 
-  // parse the result
-  std::ifstream inFile(tmpfile);
-  std::string dumpentry;
+  dumpfile = tmpfile;
+  free(tmpfile);
+  return true;
+}
 
-  unsigned long long cnt = 0;
-  while (std::getline(inFile, dumpentry))
+/*----------------------------------------------------------------------------*/
+/** 
+ * Resync meta data from an MGM dump file into the DB
+ * 
+ * @param fsid file system id
+ * @param dumpfile dump file produced by FetchMgmDump
+ * @param progress if not 0 counts the resynced records
+ * 
+ * @return true if successfull
+ */
+
+/*----------------------------------------------------------------------------*/
+bool
+FmdDbMapHandler::ResyncAllFromDump (eos::common::FileSystem::fsid_t fsid, const char* dumpfile, ResyncProgress* progress)
+{
+  if (!ResetMgmInformation(fsid))
+  {
+    eos_err("failed to reset the mgm information before resyncing");
+    return false;
+  }
+
+  // the parsing feeds the record updates of the workers
+  ResyncPipeline pipeline(GetResyncQueueDepth(),
+                          [this, fsid, progress] (const std::string& dumpentry)
   {
-    cnt++;
-    eos_debug("line=%s", dumpentry.c_str());
     XrdOucEnv* env = new XrdOucEnv(dumpentry.c_str());
     if (env)
     {
@@ -1099,17 +1340,30 @@ FmdDbMapHandler::ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char*
       }
       delete env;
     }
+    if (progress)
+    {
+      progress->mMgmFiles++;
+    }
+  });
+
+  // parse the result
+  std::ifstream inFile(dumpfile);
+  std::string dumpentry;
+
+  unsigned long long cnt = 0;
+  while (std::getline(inFile, dumpentry))
+  {
+    cnt++;
+    eos_debug("line=%s", dumpentry.c_str());
+    pipeline.Push(dumpentry);
     if (!(cnt % 10000))
     {
       eos_info("msg=\"synced files so far\" nfiles=%llu fsid=%lu", cnt, (unsigned long) fsid);
     }
   }
 
+  pipeline.Finish();
   isSyncing[fsid] = false;
-
-  // remove the temporary file
-  unlink(tmpfile);
-  free(tmpfile);
   return true;
 }
 
@@ -1154,6 +1408,9 @@ FmdDbMapHandler::GetInconsistencyStatistics (eos::common::FileSystem::fsid_t fsi
   if (!dbmap.count(fsid))
     return false;
 
+  // the iteration only sees records written back to the DB
+  FlushFmd(fsid);
+
   // query in-memory
   statistics["mem_n"] = 0; // number of files in DB
 
@@ -1288,6 +1545,13 @@ FmdDbMapHandler::ResetDB (eos::common::FileSystem::fsid_t fsid)
   // erase the hash entry
   if (dbmap.count(fsid))
   {
+    FmdDirtySet* dirty = GetDirtySet(fsid);
+    if (dirty)
+    {
+      // records not yet written back are dropped as well
+      XrdSysMutexHelper dlock(dirty->mMutex);
+      dirty->mEntries.clear();
+    }
     // delete in the in-memory hash
     if(!dbmap[fsid]->clear())
     {
@@ -1316,6 +1580,11 @@ FmdDbMapHandler::TrimDB()
   {
     eos_static_info("Trimming fsid=%llu ", it->first);
 
+    {
+      eos::common::RWMutexReadLock lock(Mutex);
+      FlushFmd(it->first);
+    }
+
     if (!it->second->trimDb())
     {
       eos_static_err("Cannot trim the DB file for fsid=%llu ", it->first);
@@ -1346,6 +1615,202 @@ FmdDbMapHandler::TrimDBFile (eos::common::FileSystem::fsid_t fsid, XrdOucString
   return true;
 }
 
+/*----------------------------------------------------------------------------*/
+/** 
+ * Look up a record which has not been written back to the DB yet
+ * 
+ * @param fid file id
+ * @param fsid filesystem id
+ * @param value filled with the serialized record if not 0
+ * @param deleted set to true if the record has been deleted
+ * 
+ * @return true if the record is dirty
+ */
+
+/*----------------------------------------------------------------------------*/
+bool
+FmdDbMapHandler::GetDirtyFmd (eos::common::FileId::fileid_t fid, eos::common::FileSystem::fsid_t fsid, std::string* value, bool& deleted)
+{
+  FmdDirtySet* dirty = GetDirtySet(fsid);
+  if (!dirty)
+  {
+    return false;
+  }
+
+  XrdSysMutexHelper lock(dirty->mMutex);
+  std::map<eos::common::FileId::fileid_t, FmdDirtyEntry>::const_iterator it = dirty->mEntries.find(fid);
+
+  if (it == dirty->mEntries.end())
+  {
+    // the record might be in the batch currently written back
+    it = dirty->mFlushing.find(fid);
+    if (it == dirty->mFlushing.end())
+    {
+      return false;
+    }
+  }
+
+  deleted = it->second.mDeleted;
+  if (value)
+  {
+    *value = it->second.mValue;
+  }
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+/** 
+ * Write back the dirty records of a filesystem in a single DB transaction.
+ * The records stay visible to readers until the transaction is committed.
+ * 
+ * @param fsid filesystem id
+ * 
+ * @return true if all records have been written
+ */
+
+/*----------------------------------------------------------------------------*/
+bool
+FmdDbMapHandler::FlushFmd (eos::common::FileSystem::fsid_t fsid)
+{
+  FmdDirtySet* dirty = GetDirtySet(fsid);
+  if (!dirty || !dbmap.count(fsid))
+  {
+    return true;
+  }
+
+  XrdSysMutexHelper flock(dirty->mFlushMutex);
+  {
+    XrdSysMutexHelper lock(dirty->mMutex);
+    if (dirty->mEntries.empty())
+    {
+      return true;
+    }
+    dirty->mFlushing.swap(dirty->mEntries);
+  }
+
+  bool rc = WriteDirtyFmd(dbmap[fsid], dirty->mFlushing);
+  {
+    XrdSysMutexHelper lock(dirty->mMutex);
+    if (!rc)
+    {
+      // requeue the batch for the next write back - records updated meanwhile
+      // are newer and stay as they are
+      eos_err("unable to write back %lu fmd records for fsid=%lu - retrying with the next flush",
+              (unsigned long) dirty->mFlushing.size(), (unsigned long) fsid);
+      std::map<eos::common::FileId::fileid_t, FmdDirtyEntry>::const_iterator it;
+      for (it = dirty->mFlushing.begin(); it != dirty->mFlushing.end(); ++it)
+      {
+        dirty->mEntries.insert(*it);
+      }
+    }
+    dirty->mFlushing.clear();
+  }
+  return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+/** 
+ * Write a batch of dirty records to a DB in one transaction
+ * 
+ * @param db DB of the filesystem
+ * @param entries records to write
+ * 
+ * @return true if all records have been written
+ */
+
+/*----------------------------------------------------------------------------*/
+bool
+FmdDbMapHandler::WriteDirtyFmd (eos::common::DbMap* db, const std::map<eos::common::FileId::fileid_t, FmdDirtyEntry>& entries)
+{
+  eos::common::DbMap::Tval val;
+  std::map<eos::common::FileId::fileid_t, FmdDirtyEntry>::const_iterator it;
+  unsigned long cpt = 0;
+
+  db->beginSetSequence();
+  for (it = entries.begin(); it != entries.end(); ++it)
+  {
+    eos::common::Slice key((const char*) &it->first, sizeof(it->first));
+    if (it->second.mDeleted)
+    {
+      // records created and deleted since the last write back are not in the DB
+      if (!db->get(key, &val))
+      {
+        continue;
+      }
+      db->remove(key);
+    }
+    else
+    {
+      db->set(key, it->second.mValue, "");
+    }
+    cpt++;
+  }
+
+  if (db->endSetSequence() != cpt)
+  {
+    return false;
+  }
+  eos_debug("wrote back %lu fmd records", cpt);
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+/** 
+ * Flusher thread startup function
+ */
+
+/*----------------------------------------------------------------------------*/
+void*
+FmdDbMapHandler::StartFlusher (void* pp)
+{
+  static_cast<FmdDbMapHandler*> (pp)->Flusher();
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/** 
+ * Flusher loop writing back the dirty records of all filesystems
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+FmdDbMapHandler::Flusher ()
+{
+  eos_info("msg=\"starting fmd flusher\" interval=%lums entries=%lu", mFlushInterval, (unsigned long) mFlushEntries);
+
+  while (mFlusherRun)
+  {
+    mFlushCond.WaitMS(mFlushInterval);
+
+    eos::common::RWMutexReadLock lock(Mutex);
+    std::map<eos::common::FileSystem::fsid_t, FmdDirtySet*>::const_iterator it;
+    for (it = dirtymap.begin(); it != dirtymap.end(); ++it)
+    {
+      FlushFmd(it->first);
+    }
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/** 
+ * Stop the flusher thread
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+FmdDbMapHandler::StopFlusher ()
+{
+  XrdSysMutexHelper lock(mFlusherMutex);
+  if (!mFlusherRun)
+  {
+    return;
+  }
+
+  mFlusherRun = false;
+  mFlushCond.Signal();
+  XrdSysThread::Join(mFlusherTid, NULL);
+}
+
 EOSFSTNAMESPACE_END
 
 
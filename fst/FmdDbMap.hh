@@ -52,6 +52,8 @@
 #include <google/sparsehash/densehashtable.h>
 #include <sys/time.h>
 #include <string.h>
+#include <atomic>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -119,6 +121,10 @@ public:
     eos::common::DbMap::Tval val;
     if(!dbmap.count(fsid))
     return false;
+    bool deleted=false;
+    // not yet written back records are the most recent ones
+    if(GetDirtyFmd(fid,fsid,0,deleted))
+    return !deleted;
     bool retval=dbmap[fsid]->get(eos::common::Slice((const char*)&fid,sizeof(fid)),&val);
     //eos_warning("ExistFmd fid=%lu fsid=%u result=%d",fid,fsid,retval);
     return retval;
@@ -126,21 +132,42 @@ public:
   inline Fmd RetrieveFmd(eos::common::FileId::fileid_t fid, eos::common::FileSystem::fsid_t fsid)
   {
     eos::common::DbMap::Tval val;
-    dbmap[fsid]->get(eos::common::Slice((const char*)&fid,sizeof(fid)),&val);
     Fmd retval;
+    if(!dbmap.count(fsid))
+    return retval;
+    bool deleted=false;
+    if(!GetDirtyFmd(fid,fsid,&val.value,deleted))
+    dbmap[fsid]->get(eos::common::Slice((const char*)&fid,sizeof(fid)),&val);
     retval.ParseFromString(val.value);
-    std::stringstream ss;
     //eos_warning("RetrieveFmd fid=%lu fsid=%u getfid=%lu getfsid=%u",fid,fsid,retval.fid(),retval.fsid());
     return retval;
   }
   inline bool PutFmd(eos::common::FileId::fileid_t fid, eos::common::FileSystem::fsid_t fsid, const Fmd &fmd)
   {
-    std::string sval;
-    fmd.SerializePartialToString(&sval);
+    FmdDirtySet* dirty=GetDirtySet(fsid);
+    if(!dirty)
+    return false;
+    XrdSysMutexHelper lock(dirty->mMutex);
+    FmdDirtyEntry& entry=dirty->mEntries[fid];
+    entry.mDeleted=false;
+    fmd.SerializePartialToString(&entry.mValue);
     //eos_warning("RetrieveFmd fid=%lu fsid=%u setfid=%lu setfsid=%u",fid,fsid,fmd.fid(),fmd.fsid());
-    return dbmap[fsid]->set(eos::common::Slice((const char*)&fid,sizeof(fid)),sval,"") == 0;
+    if(dirty->mEntries.size()==mFlushEntries)
+    mFlushCond.Signal();
+    return true;
   }
 
+  // ---------------------------------------------------------------------------
+  //! Write back the dirty Fmd records of a filesystem in one batch - you need
+  //! to lock the RWMutex Mutex before calling this
+  // ---------------------------------------------------------------------------
+  bool FlushFmd (eos::common::FileSystem::fsid_t fsid);
+
+  // ---------------------------------------------------------------------------
+  //! Flusher thread startup function
+  // ---------------------------------------------------------------------------
+  static void* StartFlusher (void* pp);
+
   // ---------------------------------------------------------------------------
   //! Commit a modified fmd record
   // ---------------------------------------------------------------------------
@@ -174,7 +201,7 @@ public:
   // ---------------------------------------------------------------------------
   //! Resync File meta data found under path
   // ---------------------------------------------------------------------------
-  virtual bool ResyncAllDisk (const char* path, eos::common::FileSystem::fsid_t fsid, bool flaglayouterror);
+  virtual bool ResyncAllDisk (const char* path, eos::common::FileSystem::fsid_t fsid, bool flaglayouterror, ResyncProgress* progress = 0);
 
   // ---------------------------------------------------------------------------
   //! Resync a single entry from Disk
@@ -189,7 +216,18 @@ public:
   // ---------------------------------------------------------------------------
   //! Resync all entries from Mgm
   // ---------------------------------------------------------------------------
-  virtual bool ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char* manager);
+  virtual bool ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char* manager, ResyncProgress* progress = 0);
+
+  // ---------------------------------------------------------------------------
+  //! Download the meta data dump of a filesystem from the Mgm into a
+  //! temporary file which has to be removed by the caller
+  // ---------------------------------------------------------------------------
+  bool FetchMgmDump (eos::common::FileSystem::fsid_t fsid, const char* manager, std::string& dumpfile);
+
+  // ---------------------------------------------------------------------------
+  //! Resync all entries from an Mgm dump file
+  // ---------------------------------------------------------------------------
+  bool ResyncAllFromDump (eos::common::FileSystem::fsid_t fsid, const char* dumpfile, ResyncProgress* progress = 0);
 
   // ---------------------------------------------------------------------------
   //! Query list of fids
@@ -234,9 +272,14 @@ public:
   //! Constructor
   // ---------------------------------------------------------------------------
 
-  FmdDbMapHandler ()
+  FmdDbMapHandler () : mFlusherRun(false)
   {
     SetLogId("CommonFmdDbMapHandler");
+    // Fmd records are written back every EOS_FST_FMD_FLUSH_MS milliseconds or
+    // earlier once EOS_FST_FMD_FLUSH_ENTRIES records of a filesystem are dirty
+    mFlushInterval = getenv("EOS_FST_FMD_FLUSH_MS") ? strtoul(getenv("EOS_FST_FMD_FLUSH_MS"), 0, 10) : 1000;
+    mFlushEntries = getenv("EOS_FST_FMD_FLUSH_ENTRIES") ? strtoul(getenv("EOS_FST_FMD_FLUSH_ENTRIES"), 0, 10) : 10000;
+    if (!mFlushInterval) mFlushInterval = 1;
 #ifndef EOS_SQLITE_DBMAP
     lvdboption.CacheSizeMb=0;
     lvdboption.BloomFilterNbits=0;
@@ -259,6 +302,8 @@ public:
   void
   Shutdown ()
   {
+    StopFlusher();
+
     // detach all opened db's
     std::map<eos::common::FileSystem::fsid_t, eos::common::DbMap*>::const_iterator it;
     for (it = dbmap.begin(); it != dbmap.end(); it++)
@@ -298,8 +343,75 @@ public:
   // ---------------------------------------------------------------------------
   google::sparse_hash_map<eos::common::FileSystem::fsid_t, eos::common::DbMap* > FmdMap;
 
+protected:
+  // ---------------------------------------------------------------------------
+  //! Fmd record not yet written back to the DB
+  // ---------------------------------------------------------------------------
+  struct FmdDirtyEntry
+  {
+    bool mDeleted; //< the record has to be removed from the DB
+    std::string mValue; //< serialized Fmd
+
+    FmdDirtyEntry () : mDeleted(false) { }
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Write a batch of dirty records to a DB in one transaction
+  //!
+  //! @return true if all records have been written
+  // ---------------------------------------------------------------------------
+  virtual bool WriteDirtyFmd (eos::common::DbMap* db, const std::map<eos::common::FileId::fileid_t, FmdDirtyEntry>& entries);
+
 private:
+
+  // ---------------------------------------------------------------------------
+  //! Dirty Fmd records of a filesystem
+  // ---------------------------------------------------------------------------
+  struct FmdDirtySet
+  {
+    XrdSysRecMutex mMutex; //< protecting mEntries and mFlushing
+    XrdSysMutex mFlushMutex; //< serializing the write back
+    std::map<eos::common::FileId::fileid_t, FmdDirtyEntry> mEntries; //< dirty records
+    std::map<eos::common::FileId::fileid_t, FmdDirtyEntry> mFlushing; //< records being written back
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Get the dirty records of a filesystem or 0 if there is no DB attached
+  // ---------------------------------------------------------------------------
+  inline FmdDirtySet* GetDirtySet (eos::common::FileSystem::fsid_t fsid)
+  {
+    std::map<eos::common::FileSystem::fsid_t, FmdDirtySet*>::const_iterator it = dirtymap.find(fsid);
+    return (it == dirtymap.end()) ? 0 : it->second;
+  }
+
+  // ---------------------------------------------------------------------------
+  //! Look up a dirty Fmd record
+  //!
+  //! @param value filled with the serialized record if not 0
+  //! @param deleted set to true if the record has been deleted
+  //!
+  //! @return true if the record is dirty
+  // ---------------------------------------------------------------------------
+  bool GetDirtyFmd (eos::common::FileId::fileid_t fid, eos::common::FileSystem::fsid_t fsid, std::string* value, bool& deleted);
+
+  // ---------------------------------------------------------------------------
+  //! Flusher loop writing back the dirty records of all filesystems
+  // ---------------------------------------------------------------------------
+  void Flusher ();
+
+  // ---------------------------------------------------------------------------
+  //! Stop the flusher thread
+  // ---------------------------------------------------------------------------
+  void StopFlusher ();
+
   std::map<eos::common::FileSystem::fsid_t, eos::common::DbMap*> dbmap;
+  std::map<eos::common::FileSystem::fsid_t, FmdDirtySet*> dirtymap; //< records not yet in the DB
+  XrdSysCondVar mFlushCond; //< wakes up the flusher
+  XrdSysMutex mFlusherMutex; //< protecting the flusher start and stop
+  pthread_t mFlusherTid; //< flusher thread
+  std::atomic<bool> mFlusherRun; //< the flusher thread is running
+  unsigned long mFlushInterval; //< write back interval in milliseconds
+  size_t mFlushEntries; //< dirty records of a filesystem triggering a write back
 #ifndef EOS_SQLITE_DBMAP
   eos::common::LvDbDbMapInterface::Option lvdboption;
 #endif
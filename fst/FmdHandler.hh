@@ -40,9 +40,22 @@
 #include "common/LayoutId.hh"
 #include "fst/FmdClient.hh"
 /*----------------------------------------------------------------------------*/
+#include <atomic>
+/*----------------------------------------------------------------------------*/
 
 EOSFSTNAMESPACE_BEGIN
 
+// ---------------------------------------------------------------------------
+//! Progress of a full resync of a filesystem
+// ---------------------------------------------------------------------------
+struct ResyncProgress
+{
+  std::atomic<unsigned long long> mDiskFiles; //< files resynced from disk
+  std::atomic<unsigned long long> mMgmFiles; //< records resynced from the mgm
+
+  ResyncProgress () : mDiskFiles(0), mMgmFiles(0) { }
+};
+
 class FmdHandler : public eos::fst::FmdClient
 {
 public:
@@ -146,7 +159,7 @@ public:
   // ---------------------------------------------------------------------------
   //! Resync File meta data found under path
   // ---------------------------------------------------------------------------
-  virtual bool ResyncAllDisk (const char* path, eos::common::FileSystem::fsid_t fsid, bool flaglayouterror)=0;
+  virtual bool ResyncAllDisk (const char* path, eos::common::FileSystem::fsid_t fsid, bool flaglayouterror, ResyncProgress* progress = 0)=0;
 
   // ---------------------------------------------------------------------------
   //! Resync a single entry from Disk
@@ -161,7 +174,7 @@ public:
   // ---------------------------------------------------------------------------
   //! Resync all entries from Mgm
   // ---------------------------------------------------------------------------
-  virtual bool ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char* manager)=0;
+  virtual bool ResyncAllMgm (eos::common::FileSystem::fsid_t fsid, const char* manager, ResyncProgress* progress = 0)=0;
 
 //  // ---------------------------------------------------------------------------
 //  //! Query list of fids
@@ -36,6 +36,10 @@
 #include <map>
 #include <string>
 #include <sys/time.h>
+#include <unistd.h>
+#ifndef __APPLE__
+#include <sys/sysmacros.h>
+#endif
 
 EOSFSTNAMESPACE_BEGIN
 
@@ -248,11 +252,58 @@ public:
     }
   }
 
+  //----------------------------------------------------------------------------
+  //! Get the name of the block device holding a path as used in
+  //! /proc/diskstats e.g. sdc1 or dm-3
+  //!
+  //! @param path local path
+  //! @param wholedisk return the disk instead of the partition e.g. sdc
+  //!
+  //! @return device name or empty string if the path is not on a block device
+  //----------------------------------------------------------------------------
+  static std::string
+  BlockDevice (const char* path, bool wholedisk = false)
+  {
+#ifdef __APPLE__
+    return "";
+#else
+    struct stat stbuf;
+    if (stat(path, &stbuf))
+      return "";
+
+    char sysdev[64];
+    snprintf(sysdev, sizeof (sysdev), "/sys/dev/block/%u:%u",
+             major(stbuf.st_dev), minor(stbuf.st_dev));
+    char link[4096];
+    ssize_t len = readlink(sysdev, link, sizeof (link) - 1);
+    if (len <= 0)
+      return "";
+
+    // the link points to ../../devices/.../block/<disk>[/<partition>]
+    link[len] = 0;
+    std::string target = link;
+    std::string name = target.substr(target.rfind('/') + 1);
+
+    if (wholedisk)
+    {
+      std::string partition = sysdev;
+      partition += "/partition";
+      if (!stat(partition.c_str(), &stbuf))
+      {
+        target.erase(target.rfind('/'));
+        name = target.substr(target.rfind('/') + 1);
+      }
+    }
+    return name;
+#endif
+  }
+
   const char*
   DevMap (const char* devpath)
   {
     static time_t loadtime = 0;
     static std::map<std::string, std::string> devicemap;
+    static std::map<std::string, std::string> blockmap;
     static XrdOucString mapdev;
     mapdev = devpath;
     static XrdOucString mappath;
@@ -263,9 +314,11 @@ public:
       struct stat stbuf;
       if (!(stat("/etc/mtab", &stbuf)))
       {
-        devicemap.clear();
         if (stbuf.st_mtime != loadtime)
         {
+          devicemap.clear();
+          blockmap.clear();
+          loadtime = stbuf.st_mtime;
           FILE* fd = fopen("/etc/mtab", "r");
           // reparse the mtab
           char line[1025];
@@ -290,6 +343,19 @@ public:
             fclose(fd);
         }
       }
+      // prefer the device holding the path as seen by the kernel - volumes
+      // mounted via /dev/mapper or by label don't match the disk statistics
+      if (!blockmap.count(devpath))
+      {
+        blockmap[devpath] = BlockDevice(devpath);
+      }
+
+      if (blockmap[devpath].length())
+      {
+        mapdev = blockmap[devpath].c_str();
+        return mapdev.c_str();
+      }
+
       std::map<std::string, std::string>::const_iterator devicemapit;
       for (devicemapit = devicemap.begin(); devicemapit != devicemap.end(); devicemapit++)
       {
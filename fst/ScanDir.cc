@@ -23,6 +23,7 @@
 
 /*----------------------------------------------------------------------------*/
 #include "common/Attr.hh"
+#include "common/BufferPool.hh"
 #include "common/Logging.hh"
 #include "common/FileId.hh"
 #include "common/Path.hh"
@@ -44,6 +45,10 @@
 #include <fcntl.h>
 /*----------------------------------------------------------------------------*/
 
+#ifdef __APPLE__
+#define O_DIRECT 0
+#endif
+
 // --------------------------------------------------------------------------- 
 // - we miss ioprio.h and gettid
 // ---------------------------------------------------------------------------
@@ -103,20 +108,243 @@ enum
   IOPRIO_WHO_USER,
 };
 
+//! Weight of a new latency measurement in the moving average
+#define SCANDEVICE_EWMA_ALPHA 0.2
+//! Device utilization above which the scan budget is reduced
+#define SCANDEVICE_MAX_LOAD 0.7
+//! Latency increase over the baseline above which the scan budget is reduced
+#define SCANDEVICE_LATENCY_FACTOR 2.0
+//! Latency in ms per MB below which the device is never considered congested
+#define SCANDEVICE_MIN_LATENCY 1.0
+//! Lowest scan budget in MB/s
+#define SCANDEVICE_MIN_RATE 5.0
+
 EOSFSTNAMESPACE_BEGIN
 
+XrdSysMutex ScanDevice::sMutex;
+std::map<std::string, ScanDevice*> ScanDevice::sDevices;
+
+/*----------------------------------------------------------------------------*/
+static double
+scandir_now_ms ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (tv.tv_sec * 1000.0) + (tv.tv_usec / 1000.0);
+}
+
+/*----------------------------------------------------------------------------*/
+ScanDevice::ScanDevice (const std::string& name, int maxrate) :
+mName (name), mMaxRate (maxrate), mRate (maxrate), mLatency (0), mBaseline (0),
+mNextRead (0) { }
+
+/*----------------------------------------------------------------------------*/
+ScanDevice*
+ScanDevice::Get (const std::string& name, int maxrate)
+{
+  // budgets live as long as the process, scanners come and go with the
+  // scan interval configuration
+  XrdSysMutexHelper lock(sMutex);
+  std::map<std::string, ScanDevice*>::iterator it = sDevices.find(name);
+
+  if (it != sDevices.end())
+  {
+    return it->second;
+  }
+
+  ScanDevice* device = new ScanDevice(name, maxrate);
+  sDevices[name] = device;
+  return device;
+}
+
+/*----------------------------------------------------------------------------*/
+unsigned long
+ScanDevice::Reserve (size_t nbytes)
+{
+  if (mMaxRate <= 0)
+  {
+    return 0;
+  }
+
+  double now = scandir_now_ms();
+  XrdSysMutexHelper lock(mMutex);
+
+  if (mNextRead < now)
+  {
+    mNextRead = now;
+  }
+
+  double wait = mNextRead - now;
+  mNextRead += nbytes / (mRate * 1000.0);
+  return (unsigned long) wait;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ScanDevice::Feedback (size_t nbytes, double latency, double load)
+{
+  if (!nbytes || !latency)
+  {
+    return;
+  }
+
+  double permb = latency * 1000000.0 / nbytes;
+  XrdSysMutexHelper lock(mMutex);
+
+  if (mLatency)
+  {
+    mLatency += SCANDEVICE_EWMA_ALPHA * (permb - mLatency);
+  }
+  else
+  {
+    mLatency = permb;
+  }
+
+  // the baseline follows increases slowly e.g. after a disk replacement
+  if (!mBaseline || (mLatency < mBaseline))
+  {
+    mBaseline = mLatency;
+  }
+  else
+  {
+    mBaseline += 0.001 * (mLatency - mBaseline);
+  }
+
+  if (mMaxRate <= 0)
+  {
+    return;
+  }
+
+  if ((load > SCANDEVICE_MAX_LOAD) ||
+      ((mLatency > SCANDEVICE_LATENCY_FACTOR * mBaseline) &&
+       (mLatency > SCANDEVICE_MIN_LATENCY)))
+  {
+    // back off quickly if the disk is busy with other requests
+    mRate *= 0.9;
+
+    if (mRate < SCANDEVICE_MIN_RATE)
+    {
+      mRate = (mMaxRate < SCANDEVICE_MIN_RATE) ? mMaxRate : SCANDEVICE_MIN_RATE;
+    }
+  }
+  else
+  {
+    mRate += 0.1 * mMaxRate;
+
+    if (mRate > mMaxRate)
+    {
+      mRate = mMaxRate;
+    }
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ScanDevice::GetBudget (double& rate, double& latency)
+{
+  XrdSysMutexHelper lock(mMutex);
+  rate = mRate;
+  latency = mLatency;
+}
+
+/*----------------------------------------------------------------------------*/
+ScanDir::ScanDir (const char* dirpath, eos::common::FileSystem::fsid_t fsid, eos::fst::Load* fstload, bool bgthread, long int testinterval, int ratebandwidth, bool setchecksum) :
+fstLoad (fstload), fsId (fsid), dirPath (dirpath), testInterval (testinterval),
+setChecksum (setchecksum), rateBandwidth (ratebandwidth), scanDevice (0),
+pipeCond (0), pipeNormalXS (0), pipeBlockXS (0), pipeBlockError (false),
+stopChecksum (false), nextBlock (0), xsThread (0), thread (0), stopScan (false),
+bgThread (bgthread)
+{
+  noNoChecksumFiles = noScanFiles = noCorruptFiles = noTotalFiles = SkippedFiles = 0;
+  lastTotalFiles = 0;
+  durationScan = 0;
+  totalScanSize = bufferSize = 0;
+  scanRate = 0;
+  rateBytes = 0;
+  gettimeofday(&rateStart, 0);
+
+  for (int i = 0; i < 2; i++)
+  {
+    blocks[i].buffer = 0;
+    blocks[i].offset = 0;
+    blocks[i].length = 0;
+    blocks[i].full = false;
+  }
+
+  alignment = pathconf(dirPath.c_str(), _PC_REC_XFER_ALIGN);
+
+  if (alignment <= 0)
+  {
+    fprintf(stderr, "error: OS does not provide alignment\n");
+    return;
+  }
+
+  // large aligned reads suitable for direct IO
+  bufferSize = ((4 * 1024 * 1024 + alignment - 1) / alignment) * alignment;
+
+  for (int i = 0; i < 2; i++)
+  {
+    // pool buffers are page aligned
+    blocks[i].buffer = eos::common::BufferPool::Instance().Allocate(bufferSize);
+
+    if ((unsigned long) blocks[i].buffer % alignment)
+    {
+      eos::common::BufferPool::Instance().Release(blocks[i].buffer, bufferSize);
+      blocks[i].buffer = 0;
+      fprintf(stderr, "error: buffer does not match the alignment on dirpath=%s. \n", dirPath.c_str());
+      return;
+    }
+  }
+
+  // scanners of filesystems on the same disk share its budget
+  std::string device = Load::BlockDevice(dirPath.c_str(), true);
+
+  if (device.empty())
+  {
+    device = dirPath.c_str();
+  }
+
+  scanDevice = ScanDevice::Get(device, rateBandwidth);
+
+  if (XrdSysThread::Run(&xsThread, ScanDir::StaticChecksumProc, static_cast<void *> (this), XRDSYSTHREAD_HOLD, "ScanDir Checksum Thread"))
+  {
+    xsThread = 0;
+    fprintf(stderr, "error: cannot start checksum thread for dirpath=%s\n", dirPath.c_str());
+    return;
+  }
+
+  if (bgthread)
+  {
+    openlog("scandir", LOG_PID | LOG_NDELAY, LOG_USER);
+    XrdSysThread::Run(&thread, ScanDir::StaticThreadProc, static_cast<void *> (this), XRDSYSTHREAD_HOLD, "ScanDir Thread");
+  }
+}
+
 /*----------------------------------------------------------------------------*/
 ScanDir::~ScanDir ()
 {
+  // a file scan in progress is not cancellable, let it stop at the next block
+  stopScan = true;
+
   if ((bgThread && thread))
   {
     XrdSysThread::Cancel(thread);
     XrdSysThread::Join(thread, NULL);
     closelog();
   }
-  if (buffer)
+
+  if (xsThread)
+  {
+    pipeCond.Lock();
+    stopChecksum = true;
+    pipeCond.Broadcast();
+    pipeCond.UnLock();
+    XrdSysThread::Join(xsThread, NULL);
+  }
+
+  for (int i = 0; i < 2; i++)
   {
-    free(buffer);
+    eos::common::BufferPool::Instance().Release(blocks[i].buffer, bufferSize);
   }
 }
 
@@ -234,7 +462,10 @@ ScanDir::CheckFile (const char* filepath)
   filePath = filepath;
   eos::common::Attr *attr = eos::common::Attr::OpenAttr(filePath.c_str());
 
-  noTotalFiles++;
+  {
+    XrdSysMutexHelper lock(statMutex);
+    noTotalFiles++;
+  }
 
   // get last modification time
   struct stat buf1;
@@ -322,9 +553,8 @@ ScanDir::CheckFile (const char* filepath)
             }
           }
         }
-        //collect statistics
+        //collect statistics, the scanned bytes are accounted per block
         durationScan += scantime;
-        totalScanSize += scansize;
 
 
         if ((!attr->Set("user.eos.timestamp", GetTimestampSmeared())) ||
@@ -523,6 +753,12 @@ ScanDir::StaticThreadProc (void* arg)
 void*
 ScanDir::ThreadProc (void)
 {
+  if (!xsThread)
+  {
+    // no buffers or no checksum thread, nothing can be scanned
+    return NULL;
+  }
+
 
   if (bgThread)
   {
@@ -564,26 +800,33 @@ ScanDir::ThreadProc (void)
     struct timezone tz;
     struct timeval tv_start, tv_end;
 
-    noScanFiles = 0;
-    totalScanSize = 0;
-    noCorruptFiles = 0;
-    noNoChecksumFiles = 0;
-    noTotalFiles = 0;
-    SkippedFiles = 0;
+    {
+      XrdSysMutexHelper lock(statMutex);
+      noScanFiles = 0;
+      totalScanSize = 0;
+      noCorruptFiles = 0;
+      noNoChecksumFiles = 0;
+      noTotalFiles = 0;
+      SkippedFiles = 0;
+    }
 
     gettimeofday(&tv_start, &tz);
     ScanFiles();
     gettimeofday(&tv_end, &tz);
 
     durationScan = ((tv_end.tv_sec - tv_start.tv_sec) * 1000.0) + ((tv_end.tv_usec - tv_start.tv_usec) / 1000.0);
+    {
+      XrdSysMutexHelper lock(statMutex);
+      lastTotalFiles = noTotalFiles;
+    }
     if (bgThread)
     {
-      syslog(LOG_ERR, "Directory: %s, files=%li scanduration=%.02f [s] scansize=%lli [Bytes] [ %lli MB ] scannedfiles=%li  corruptedfiles=%li nochecksumfiles=%li skippedfiles=%li\n", dirPath.c_str(), noTotalFiles, (durationScan / 1000.0), totalScanSize, ((totalScanSize / 1000) / 1000), noScanFiles, noCorruptFiles, noNoChecksumFiles, SkippedFiles);
-      eos_notice("Directory: %s, files=%li scanduration=%.02f [s] scansize=%lli [Bytes] [ %lli MB ] scannedfiles=%li  corruptedfiles=%li nochecksumfiles=%li skippedfiles=%li", dirPath.c_str(), noTotalFiles, (durationScan / 1000.0), totalScanSize, ((totalScanSize / 1000) / 1000), noScanFiles, noCorruptFiles, noNoChecksumFiles, SkippedFiles);
+      syslog(LOG_ERR, "Directory: %s, device=%s files=%li scanduration=%.02f [s] scansize=%lli [Bytes] [ %lli MB ] rate=%.02f [MB/s] scannedfiles=%li  corruptedfiles=%li nochecksumfiles=%li skippedfiles=%li\n", dirPath.c_str(), scanDevice->GetName().c_str(), noTotalFiles, (durationScan / 1000.0), totalScanSize, ((totalScanSize / 1000) / 1000), (durationScan ? (totalScanSize / durationScan / 1000.0) : 0), noScanFiles, noCorruptFiles, noNoChecksumFiles, SkippedFiles);
+      eos_notice("Directory: %s, device=%s files=%li scanduration=%.02f [s] scansize=%lli [Bytes] [ %lli MB ] rate=%.02f [MB/s] scannedfiles=%li  corruptedfiles=%li nochecksumfiles=%li skippedfiles=%li", dirPath.c_str(), scanDevice->GetName().c_str(), noTotalFiles, (durationScan / 1000.0), totalScanSize, ((totalScanSize / 1000) / 1000), (durationScan ? (totalScanSize / durationScan / 1000.0) : 0), noScanFiles, noCorruptFiles, noNoChecksumFiles, SkippedFiles);
     }
     else
     {
-      fprintf(stderr, "[ScanDir] Directory: %s, files=%li scanduration=%.02f [s] scansize=%lli [Bytes] [ %lli MB ] scannedfiles=%li  corruptedfiles=%li nochecksumfiles=%li skippedfiles=%li\n", dirPath.c_str(), noTotalFiles, (durationScan / 1000.0), totalScanSize, ((totalScanSize / 1000) / 1000), noScanFiles, noCorruptFiles, noNoChecksumFiles, SkippedFiles);
+      fprintf(stderr, "[ScanDir] Directory: %s, device=%s files=%li scanduration=%.02f [s] scansize=%lli [Bytes] [ %lli MB ] rate=%.02f [MB/s] scannedfiles=%li  corruptedfiles=%li nochecksumfiles=%li skippedfiles=%li\n", dirPath.c_str(), scanDevice->GetName().c_str(), noTotalFiles, (durationScan / 1000.0), totalScanSize, ((totalScanSize / 1000) / 1000), (durationScan ? (totalScanSize / durationScan / 1000.0) : 0), noScanFiles, noCorruptFiles, noNoChecksumFiles, SkippedFiles);
     }
 
     if (!bgThread)
@@ -611,9 +854,7 @@ ScanDir::ThreadProc (void)
 bool
 ScanDir::ScanFileLoadAware (const char* path, unsigned long long &scansize, float &scantime, const char* checksumVal, unsigned long layoutid, const char* lfn, bool &filecxerror, bool &blockcxerror)
 {
-  double load;
   bool retVal, corruptBlockXS = false;
-  int currentRate = rateBandwidth;
   std::string filePath, fileXSPath;
   struct timezone tz;
   struct timeval opentime;
@@ -623,6 +864,11 @@ ScanDir::ScanFileLoadAware (const char* path, unsigned long long &scansize, floa
   scansize = 0;
   scantime = 0;
 
+  if (!xsThread)
+  {
+    return false;
+  }
+
   filePath = path;
   fileXSPath = filePath + ".xsmap";
 
@@ -630,16 +876,30 @@ ScanDir::ScanFileLoadAware (const char* path, unsigned long long &scansize, floa
 
   gettimeofday(&opentime, &tz);
 
-  int fd = open(path, O_RDONLY);
+  // read around the page cache if the filesystem supports direct IO
+  bool direct = true;
+  int fd = open(path, O_RDONLY | O_DIRECT);
+  if (fd < 0)
+  {
+    direct = false;
+    fd = open(path, O_RDONLY);
+  }
+
   if (fd < 0)
   {
     delete normalXS;
     return false;
   }
 
+  if (!direct)
+  {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+
   struct stat current_stat;
   if (fstat(fd, &current_stat)) 
   {
+    close(fd);
     delete normalXS;
     return false;
   }
@@ -655,62 +915,30 @@ ScanDir::ScanFileLoadAware (const char* path, unsigned long long &scansize, floa
  
   if (normalXS) normalXS->Reset();
 
-  int nread = 0;
   off_t offset = 0;
 
-  do
-  {
-    errno = 0;
-    nread = read(fd, buffer, bufferSize);
-    if (nread < 0)
-    {
-      close(fd);
-      if (blockXS)
-      {
-        blockXS->CloseMap();
-        delete blockXS;
-      }
-      if (normalXS) delete normalXS;
-      return false;
-    }
+  // the pipeline has to be drained before the thread can be cancelled
+  if (bgThread)
+    XrdSysThread::SetCancelOff();
 
-    if (nread)
-    {
-      if (!corruptBlockXS && blockXS)
-        if (!blockXS->CheckBlockSum(offset, buffer, nread))
-          corruptBlockXS = true;
+  bool readOk = ReadFile(fd, direct, normalXS, blockXS, offset, corruptBlockXS);
 
-      //      fprintf(stderr,"adding %ld %llu\n", nread,offset);
-      if (normalXS) normalXS->Add(buffer, nread, offset);
+  if (bgThread)
+    XrdSysThread::SetCancelOn();
 
-      offset += nread;
-      if (currentRate)
-      {
-        // regulate the verification rate
-        gettimeofday(&currenttime, &tz);
-        scantime = (((currenttime.tv_sec - opentime.tv_sec)*1000.0) + ((currenttime.tv_usec - opentime.tv_usec) / 1000.0));
-        float expecttime = (1.0 * offset / currentRate) / 1000.0;
-        if (expecttime > scantime)
-        {
-          XrdSysTimer sleeper;
-          sleeper.Wait(expecttime - scantime);
-        }
-        //adjust the rate according to the load information
-        load = fstLoad->GetDiskRate("sda", "millisIO") / 1000.0;
-        if (load > 0.7)
-        {
-          //adjust currentRate
-          if (currentRate > 5)
-            currentRate = 0.9 * currentRate;
-        }
-        else
-        {
-          currentRate = rateBandwidth;
-        }
-      }
+  if (!readOk)
+  {
+    close(fd);
+    if (blockXS)
+    {
+      blockXS->CloseMap();
+      delete blockXS;
     }
+    if (normalXS) delete normalXS;
+    if (bgThread)
+      XrdSysThread::CancelPoint();
+    return false;
   }
-  while (nread == bufferSize);
 
   gettimeofday(&currenttime, &tz);
   scantime = (((currenttime.tv_sec - opentime.tv_sec)*1000.0) + ((currenttime.tv_usec - opentime.tv_usec) / 1000.0));
@@ -781,7 +1009,6 @@ ScanDir::ScanFileLoadAware (const char* path, unsigned long long &scansize, floa
   //collect statistics
   noScanFiles++;
 
-  if (normalXS) normalXS->Finalize();
   if (blockXS)
   {
     blockXS->CloseMap();
@@ -796,4 +1023,200 @@ ScanDir::ScanFileLoadAware (const char* path, unsigned long long &scansize, floa
   return retVal;
 }
 
+/*----------------------------------------------------------------------------*/
+bool
+ScanDir::ReadFile (int fd, bool direct, eos::fst::CheckSum* normalXS, eos::fst::CheckSum* blockXS, off_t& offset, bool& blockxserror)
+{
+  bool retc = true;
+  ssize_t nread = 0;
+  double start;
+
+  pipeCond.Lock();
+  pipeNormalXS = normalXS;
+  pipeBlockXS = blockXS;
+  pipeBlockError = false;
+  pipeCond.UnLock();
+
+  offset = 0;
+
+  do
+  {
+    ScanBlock& block = blocks[nextBlock];
+
+    // wait until the checksum thread is done with this buffer
+    pipeCond.Lock();
+    while (block.full)
+      pipeCond.Wait();
+    pipeCond.UnLock();
+
+    if (stopScan)
+    {
+      retc = false;
+      break;
+    }
+
+    start = scandir_now_ms();
+
+    do
+    {
+      nread = pread(fd, block.buffer, bufferSize, offset);
+    }
+    while ((nread < 0) && (errno == EINTR));
+
+    if (nread < 0)
+    {
+      retc = false;
+      break;
+    }
+
+    if (!nread)
+      break;
+
+    // only full blocks give a comparable latency
+    Feedback(nread, (nread == bufferSize) ? (scandir_now_ms() - start) : 0);
+
+    if (!direct)
+    {
+      // don't keep the scanned data in the page cache
+      posix_fadvise(fd, offset, nread, POSIX_FADV_DONTNEED);
+    }
+
+    pipeCond.Lock();
+    block.offset = offset;
+    block.length = nread;
+    block.full = true;
+    pipeCond.Broadcast();
+    pipeCond.UnLock();
+
+    offset += nread;
+    nextBlock ^= 1;
+
+    // the checksum of this block is computed while waiting for the budget
+    Throttle(nread);
+  }
+  while (nread == bufferSize);
+
+  // wait until all blocks of this file are checksummed
+  pipeCond.Lock();
+  while (blocks[0].full || blocks[1].full)
+    pipeCond.Wait();
+  blockxserror = pipeBlockError;
+  pipeNormalXS = 0;
+  pipeBlockXS = 0;
+  pipeCond.UnLock();
+  return retc;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ScanDir::Throttle (size_t nbytes)
+{
+  unsigned long wait = scanDevice->Reserve(nbytes);
+
+  // wait in short slices to react quickly to a shutdown
+  while (wait && !stopScan)
+  {
+    unsigned long slice = (wait > 100) ? 100 : wait;
+    XrdSysTimer sleeper;
+    sleeper.Wait(slice);
+    wait -= slice;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ScanDir::Feedback (size_t nbytes, double latency)
+{
+  double load = fstLoad ? (fstLoad->GetDiskRate(dirPath.c_str(), "millisIO") / 1000.0) : 0;
+  scanDevice->Feedback(nbytes, latency, load);
+
+  double now = scandir_now_ms();
+  XrdSysMutexHelper lock(statMutex);
+  double elapsed = now - ((rateStart.tv_sec * 1000.0) + (rateStart.tv_usec / 1000.0));
+  totalScanSize += nbytes;
+  rateBytes += nbytes;
+
+  if (elapsed >= 1000)
+  {
+    scanRate = rateBytes / elapsed / 1000.0;
+    rateBytes = 0;
+    gettimeofday(&rateStart, 0);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ScanDir::GetStats (ScanStats& stats)
+{
+  double now = scandir_now_ms();
+  XrdSysMutexHelper lock(statMutex);
+  double elapsed = now - ((rateStart.tv_sec * 1000.0) + (rateStart.tv_usec / 1000.0));
+
+  stats.device = scanDevice ? scanDevice->GetName() : dirPath.c_str();
+  // the rate decays to zero while the scanner is idle
+  stats.rate = (elapsed > 5000) ? (rateBytes / elapsed / 1000.0) : scanRate;
+  stats.files = noTotalFiles;
+  stats.bytes = totalScanSize;
+  stats.progress = 0;
+
+  if (lastTotalFiles)
+  {
+    stats.progress = 100.0 * noTotalFiles / lastTotalFiles;
+    if (stats.progress > 100)
+      stats.progress = 100;
+  }
+
+  stats.budget = stats.latency = 0;
+
+  if (scanDevice)
+  {
+    scanDevice->GetBudget(stats.budget, stats.latency);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+void*
+ScanDir::StaticChecksumProc (void* arg)
+{
+  reinterpret_cast<ScanDir*> (arg)->ChecksumProc();
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ScanDir::ChecksumProc ()
+{
+  int next = 0;
+  pipeCond.Lock();
+
+  while (1)
+  {
+    while (!blocks[next].full && !stopChecksum)
+      pipeCond.Wait();
+
+    if (!blocks[next].full)
+      break;
+
+    ScanBlock& block = blocks[next];
+    eos::fst::CheckSum* normalXS = pipeNormalXS;
+    eos::fst::CheckSum* blockXS = pipeBlockError ? 0 : pipeBlockXS;
+    pipeCond.UnLock();
+
+    // the reading thread fills the other buffer meanwhile
+    bool corrupt = (blockXS && !blockXS->CheckBlockSum(block.offset, block.buffer, block.length));
+
+    if (normalXS)
+      normalXS->Add(block.buffer, block.length, block.offset);
+
+    pipeCond.Lock();
+    if (corrupt)
+      pipeBlockError = true;
+    block.full = false;
+    next ^= 1;
+    pipeCond.Broadcast();
+  }
+
+  pipeCond.UnLock();
+}
+
 EOSFSTNAMESPACE_END
@@ -34,6 +34,9 @@
 #include "XrdOuc/XrdOucString.hh"
 #include "fst/checksum/ChecksumPlugins.hh"
 /*----------------------------------------------------------------------------*/
+#include <atomic>
+#include <map>
+#include <string>
 #include <syslog.h>
 /*----------------------------------------------------------------------------*/
 
@@ -44,14 +47,104 @@
 
 EOSFSTNAMESPACE_BEGIN
 
+//------------------------------------------------------------------------------
+//! Class ScanDevice
+//!
+//! @description Scan bandwidth budget of one block device shared by all the
+//! scanners of filesystems located on that device. The budget is adjusted by
+//! an additive increase/multiplicative decrease scheme driven by the device
+//! utilization and by an exponentially weighted moving average of the read
+//! latency per MB: the budget shrinks when the disk is busy or the latency
+//! rises well above the lowest latency observed and grows back otherwise.
+//------------------------------------------------------------------------------
+class ScanDevice
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Get the budget of a device, it is created if it does not exist yet
+  //!
+  //! @param name device name
+  //! @param maxrate maximum scan rate in MB/s, 0 means unlimited
+  //----------------------------------------------------------------------------
+  static ScanDevice* Get (const std::string& name, int maxrate);
+
+  //----------------------------------------------------------------------------
+  //! Reserve bandwidth for a read
+  //!
+  //! @param nbytes size of the read
+  //!
+  //! @return time in milliseconds to wait before reading
+  //----------------------------------------------------------------------------
+  unsigned long Reserve (size_t nbytes);
+
+  //----------------------------------------------------------------------------
+  //! Adjust the budget after a read
+  //!
+  //! @param nbytes bytes read
+  //! @param latency duration of the read in milliseconds
+  //! @param load utilization of the device between 0 and 1
+  //----------------------------------------------------------------------------
+  void Feedback (size_t nbytes, double latency, double load);
+
+  //----------------------------------------------------------------------------
+  //! Get the current budget in MB/s and the read latency in ms per MB
+  //----------------------------------------------------------------------------
+  void GetBudget (double& rate, double& latency);
+
+  const std::string&
+  GetName () const
+  {
+    return mName;
+  }
+
+private:
+  ScanDevice (const std::string& name, int maxrate);
+
+  static XrdSysMutex sMutex; ///< protecting sDevices
+  static std::map<std::string, ScanDevice*> sDevices; ///< budgets by device
+
+  XrdSysMutex mMutex; ///< protecting the budget
+  std::string mName; ///< device name
+  double mMaxRate; ///< maximum rate in MB/s
+  double mRate; ///< current budget in MB/s
+  double mLatency; ///< moving average of the read latency in ms per MB
+  double mBaseline; ///< lowest read latency observed in ms per MB
+  double mNextRead; ///< time in ms when the next read can start
+};
+
 class ScanDir : eos::common::LogId
 {
   // ---------------------------------------------------------------------------
   //! This class scan's a directory tree and checks checksums (and blockchecksums if present)
-  //! in a defined interval with limited bandwidth
+  //! in a defined interval with limited bandwidth. Files are read with large
+  //! aligned reads bypassing the page cache if possible and the checksums are
+  //! computed by a second thread while the next block is read.
   // ---------------------------------------------------------------------------
+public:
+
+  //! Progress and rates of a scanner
+  struct ScanStats
+  {
+    std::string device; // device name
+    double rate; // scan rate in MB/s
+    double budget; // bandwidth budget of the device in MB/s
+    double latency; // read latency of the device in ms per MB
+    double progress; // progress of the current scan in percent
+    long int files; // files checked in the current scan
+    long long int bytes; // bytes scanned in the current scan
+  };
+
 private:
 
+  //! Block handed from the reading to the checksum thread
+  struct ScanBlock
+  {
+    char* buffer;
+    off_t offset;
+    ssize_t length;
+    bool full;
+  };
+
   eos::fst::Load* fstLoad;
   eos::common::FileSystem::fsid_t fsId;
 
@@ -67,57 +160,39 @@ private:
   long int noNoChecksumFiles;
   long int noTotalFiles;
   long int SkippedFiles;
+  long int lastTotalFiles; // files seen by the previous scan
+  double scanRate; // MB/s
+  long long int rateBytes; // bytes read in the current rate window
+  struct timeval rateStart; // start of the current rate window
+  XrdSysMutex statMutex; // protecting the statistics read by GetStats
 
   bool setChecksum;
   int rateBandwidth; // MB/s
   long alignment;
-  char* buffer;
+  ScanDevice* scanDevice;
+
+  // checksum pipeline
+  ScanBlock blocks[2];
+  XrdSysCondVar pipeCond; // protecting blocks, the pipe* members and stopChecksum
+  eos::fst::CheckSum* pipeNormalXS;
+  eos::fst::CheckSum* pipeBlockXS;
+  bool pipeBlockError;
+  bool stopChecksum;
+  int nextBlock; // next block to fill by the reading thread
+  pthread_t xsThread;
 
   pthread_t thread;
+  std::atomic<bool> stopScan;
 
   bool bgThread;
 
+  bool ReadFile (int fd, bool direct, eos::fst::CheckSum* normalXS, eos::fst::CheckSum* blockXS, off_t& offset, bool& blockxserror);
+  void Throttle (size_t nbytes);
+  void Feedback (size_t nbytes, double latency);
+
 public:
 
-  ScanDir (const char* dirpath, eos::common::FileSystem::fsid_t fsid, eos::fst::Load* fstload, bool bgthread = true, long int testinterval = 10, int ratebandwidth = 100, bool setchecksum = false) :
-  fstLoad (fstload), fsId (fsid), dirPath (dirpath), testInterval (testinterval), rateBandwidth (ratebandwidth)
-  {
-    thread = 0;
-    noNoChecksumFiles = noScanFiles = noCorruptFiles = noTotalFiles = SkippedFiles = 0;
-    durationScan = 0;
-    totalScanSize = bufferSize = 0;
-    buffer = 0;
-    bgThread = bgthread;
-
-    alignment = pathconf(dirPath.c_str(), _PC_REC_XFER_ALIGN);
-    size_t palignment = alignment;
-
-    if (alignment > 0)
-    {
-      bufferSize = 256 * alignment;
-      setChecksum = setchecksum;
-      if (posix_memalign((void**) &buffer, palignment, bufferSize))
-      {
-        buffer = 0;
-        fprintf(stderr, "error: error calling posix_memaling on dirpath=%s. \n", dirPath.c_str());
-        return;
-      }
-#ifdef __APPLE__
-      palignment = 0;
-#endif
-    }
-    else
-    {
-      fprintf(stderr, "error: OS does not provide alignment\n");
-      return;
-    }
-
-    if (bgthread)
-    {
-      openlog("scandir", LOG_PID | LOG_NDELAY, LOG_USER);
-      XrdSysThread::Run(&thread, ScanDir::StaticThreadProc, static_cast<void *> (this), XRDSYSTHREAD_HOLD, "ScanDir Thread");
-    }
-  };
+  ScanDir (const char* dirpath, eos::common::FileSystem::fsid_t fsid, eos::fst::Load* fstload, bool bgthread = true, long int testinterval = 10, int ratebandwidth = 100, bool setchecksum = false);
 
   void ScanFiles ();
 
@@ -129,9 +204,14 @@ public:
   std::string GetTimestampSmeared ();
   bool RescanFile (std::string);
 
+  void GetStats (ScanStats& stats);
+
   static void* StaticThreadProc (void*);
   void* ThreadProc ();
 
+  static void* StaticChecksumProc (void*);
+  void ChecksumProc ();
+
   virtual ~ScanDir ();
 
 };
@@ -559,6 +559,14 @@ XrdFstOfs::Configure (XrdSysError& Eroute, XrdOucEnv* envP)
     return 1;
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Start the batched commit senders
+  if (!Committer.Start(4))
+  {
+    Eroute.Emsg("Config", "cannot start the commit sender threads");
+    return 1;
+  }
+
   XrdSysTimer sleeper;
   sleeper.Snooze(5);
   ObjectNotifier.SetShareObjectManager(&ObjectManager);
@@ -35,6 +35,7 @@
 #include "fst/storage/Storage.hh"
 #include "fst/Config.hh"
 #include "fst/Messaging.hh"
+#include "fst/CommitQueue.hh"
 #include "fst/http/HttpServer.hh"
 #include "mq/XrdMqMessaging.hh"
 #include "mq/XrdMqSharedObject.hh"
@@ -329,6 +330,7 @@ public:
   XrdSysError* Eroute;
   eos::fst::Messaging* Messaging; ///< messaging interface class
   eos::fst::Storage* Storage; ///< Meta data & filesytem store object
+  eos::fst::CommitQueue Committer; ///< batching close commits to the MGM
 
   XrdSysMutex OpenFidMutex;
 
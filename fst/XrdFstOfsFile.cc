@@ -30,6 +30,7 @@
 #include "fst/XrdFstOfs.hh"
 #include "fst/layout/LayoutPlugin.hh"
 #include "fst/checksum/ChecksumPlugins.hh"
+#include "fst/io/ReadVEngine.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOss/XrdOssApi.hh"
 #include "XrdOuc/XrdOucIOVec.hh"
@@ -1339,7 +1340,13 @@ XrdFstOfsFile::MakeReportEnv (XrdOucString & reportString)
   unsigned long rcmin, rcmax, rcsum;      // readv count 
   unsigned long long wmin, wmax, wsum;
   double rsigma, rvsigma, rssigma, rcsigma, wsigma;
- 
+  ReadaheadStats rdahead;
+
+  if (layOut)
+  {
+    layOut->AddReadaheadStats(rdahead);
+  }
+
   {
     XrdSysMutexHelper vecLock(vecMutex);
     ComputeStatistics(rvec, rmin, rmax, rsum, rsigma);
@@ -1362,6 +1369,7 @@ XrdFstOfsFile::MakeReportEnv (XrdOucString & reportString)
              "wb=%llu&wb_min=%llu&wb_max=%llu&wb_sigma=%.02f&"
              "sfwdb=%llu&sbwdb=%llu&sxlfwdb=%llu&sxlbwdb=%llu"
              "nfwds=%lu&nbwds=%lu&nxlfwds=%lu&nxlbwds=%lu&"
+             "ra_pf=%llu&ra_hit=%llu&ra_waste=%llu&ra_hitb=%llu&ra_wait=%llu&ra_win=%u&"
              "rt=%.02f&rvt=%.02f&wt=%.02f&osize=%llu&csize=%llu&%s"
              , this->logId, Path.c_str(), this->vid.uid, this->vid.gid, tIdent.c_str()
              , gOFS.mHostName, lid, fileid, fsid
@@ -1384,6 +1392,12 @@ XrdFstOfsFile::MakeReportEnv (XrdOucString & reportString)
              , nBwdSeeks
              , nXlFwdSeeks
              , nXlBwdSeeks
+             , (unsigned long long) rdahead.mPrefetched
+             , (unsigned long long) rdahead.mHits
+             , (unsigned long long) rdahead.mWasted
+             , (unsigned long long) rdahead.mHitBytes
+             , (unsigned long long) rdahead.mWaits
+             , rdahead.mMaxWindow
              , ((rTime.tv_sec * 1000.0) + (rTime.tv_usec / 1000.0))
              , ((rvTime.tv_sec * 1000.0) + (rvTime.tv_usec / 1000.0))
              , ((wTime.tv_sec * 1000.0) + (wTime.tv_usec / 1000.0))
@@ -2004,8 +2018,9 @@ XrdFstOfsFile::close ()
               capOpaqueFile += eos::common::OwnCloud::FilterOcQuery(openOpaque->Env(envlen));
             }
 
-            rc = gOFS.CallManager(&error, capOpaque->Get("mgm.path"),
-                                  capOpaque->Get("mgm.manager"), capOpaqueFile);
+            rc = gOFS.Committer.Commit(&error, capOpaque->Get("mgm.path"),
+                                       capOpaque->Get("mgm.manager"),
+                                       capOpaqueFile);
 
             if (rc)
             {
@@ -2544,7 +2559,40 @@ XrdFstOfsFile::readvofs(XrdOucIOVec* readV,
 {
   eos_debug("read count=%i", readCount);
   gettimeofday(&cTime, &tz);
-  XrdSfsXferSize sz = XrdOfsFile::readv(readV, readCount);
+  XrdSfsXferSize sz;
+  XrdOucErrInfo fd_error;
+
+  // Block checksums are verified in the OSS layer, such reads can not bypass it
+  if (!HasBlockXs() && !XrdOfsFile::fctl(SFS_FCTL_GETFD, 0, fd_error) &&
+      (fd_error.getErrInfo() > 0))
+  {
+    XrdCl::ChunkList chunkList;
+    chunkList.reserve(readCount);
+
+    for (uint32_t i = 0; i < readCount; ++i)
+    {
+      chunkList.push_back(XrdCl::ChunkInfo((uint64_t)readV[i].offset,
+                                           (uint32_t)readV[i].size,
+                                           (void*)readV[i].data));
+    }
+
+    int64_t nread = ReadVEngine::Instance().ReadV(fd_error.getErrInfo(),
+                                                  chunkList);
+
+    if (nread < 0)
+    {
+      sz = gOFS.Emsg("readvofs", error, (int) -nread, "readv", FName());
+    }
+    else
+    {
+      sz = (XrdSfsXferSize) nread;
+    }
+  }
+  else
+  {
+    sz = XrdOfsFile::readv(readV, readCount);
+  }
+
   gettimeofday(&lrvTime, &tz);
   AddReadVTime();
 
@@ -2571,6 +2619,8 @@ XrdFstOfsFile::readv(XrdOucIOVec* readV,
                      int readCount)
 {
   eos_debug("read count=%i", readCount);
+  struct timeval start, stop;
+  gettimeofday(&start, 0);
     
   // Copy the XrdOucIOVec structure to XrdCl::ChunkList
   uint32_t total_read = 0;
@@ -2585,7 +2635,11 @@ XrdFstOfsFile::readv(XrdOucIOVec* readV,
                                          (void*)readV[i].data));
   }
   
-  return layOut->ReadV(chunkList, total_read);
+  XrdSfsXferSize sz = layOut->ReadV(chunkList, total_read);
+  gettimeofday(&stop, 0);
+  ReadVEngine::Instance().AddLatency(fsid, (stop.tv_sec - start.tv_sec) * 1000000 +
+                                     (stop.tv_usec - start.tv_usec));
+  return sz;
 }
 
 
@@ -352,6 +352,14 @@ public:
     return isOCchunk;
   }
 
+  //--------------------------------------------------------------------------
+  //! Check if the file is read through block checksums
+  //--------------------------------------------------------------------------
+  bool HasBlockXs()
+  {
+    return hasBlockXs;
+  }
+
 protected:
   XrdOucEnv* openOpaque;
   XrdOucEnv* capOpaque;
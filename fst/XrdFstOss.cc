@@ -37,6 +37,7 @@
 /*----------------------------------------------------------------------------*/
 #include "fst/XrdFstOss.hh"
 #include "fst/checksum/ChecksumPlugins.hh"
+#include "common/FileId.hh"
 /*----------------------------------------------------------------------------*/
 
 extern XrdSysError OssEroute;
@@ -610,6 +611,23 @@ XrdFstOss::Truncate (const char* path,
 }
 
 
+//------------------------------------------------------------------------------
+// Get the shard of the file <-> xs map holding a file name
+//------------------------------------------------------------------------------
+XrdFstOss::XsShard&
+XrdFstOss::GetXsShard (const std::string& fileName)
+{
+  unsigned long long fid = eos::common::FileId::PathToFid(fileName.c_str());
+
+  if (!fid)
+  {
+    fid = std::hash<std::string>()(fileName);
+  }
+
+  return mXsShards[fid % sNumXsShards];
+}
+
+
 //------------------------------------------------------------------------------
 // Add new entry to file name <-> blockchecksum map
 //------------------------------------------------------------------------------
@@ -618,14 +636,17 @@ XrdFstOss::AddMapping (const std::string& fileName,
                        CheckSum*& blockXs,
                        bool isRW)
 {
-  XrdSysRWLockHelper wr_lock(mRWMap, 0); // --> wrlock map
+  XsShard& shard = GetXsShard(fileName);
+  XrdSysRWLockHelper wr_lock(shard.mRWMap, 0); // --> wrlock map
   std::pair<XrdSysRWLock*, CheckSum*> pair_value;
-  eos_debug("Initial map size: %i and filename: %s.",
-            mMapFileXs.size(), fileName.c_str());
+  eos_debug("Initial shard size: %i and filename: %s.",
+            shard.mMapFileXs.size(), fileName.c_str());
 
-  if (mMapFileXs.count(fileName))
+  auto iter = shard.mMapFileXs.find(fileName);
+
+  if (iter != shard.mMapFileXs.end())
   {
-    pair_value = mMapFileXs[fileName];
+    pair_value = iter->second;
     XrdSysRWLockHelper wr_xslock(pair_value.first, 0); // --> wrlock xs obj
 
     // If no. ref 0 then the obj is closed and waiting to be deleted so we can
@@ -634,8 +655,8 @@ XrdFstOss::AddMapping (const std::string& fileName,
     {
       delete pair_value.second;
       pair_value = std::make_pair(pair_value.first, blockXs);
-      mMapFileXs[fileName] = pair_value;
-      eos_debug("Update old entry, map size: %i. ", mMapFileXs.size());
+      iter->second = pair_value;
+      eos_debug("Update old entry, shard size: %i. ", shard.mMapFileXs.size());
     }
     else
     {
@@ -653,9 +674,9 @@ XrdFstOss::AddMapping (const std::string& fileName,
 
     // Can increment without the lock as no one knows about this obj. yet
     blockXs->IncrementRef(isRW);
-    mMapFileXs[fileName] = pair_value;
-    eos_debug("Add completely new obj, map size: %i and filename: %s.",
-              mMapFileXs.size(), fileName.c_str());
+    shard.mMapFileXs[fileName] = pair_value;
+    eos_debug("Add completely new obj, shard size: %i and filename: %s.",
+              shard.mMapFileXs.size(), fileName.c_str());
     return mutex_xs;
   }
 }
@@ -667,14 +688,14 @@ XrdFstOss::AddMapping (const std::string& fileName,
 std::pair<XrdSysRWLock*, CheckSum*>
 XrdFstOss::GetXsObj (const std::string& fileName, bool isRW)
 {
-  XrdSysRWLockHelper rd_lock(mRWMap); // --> rdlock map
-  std::pair<XrdSysRWLock*, CheckSum*> pair_value;
+  XsShard& shard = GetXsShard(fileName);
+  XrdSysRWLockHelper rd_lock(shard.mRWMap); // --> rdlock map
+  auto iter = shard.mMapFileXs.find(fileName);
 
-  if (mMapFileXs.count(fileName))
+  if (iter != shard.mMapFileXs.end())
   {
-    pair_value = mMapFileXs[fileName];
-    XrdSysRWLock* mutex_xs = pair_value.first;
-    CheckSum* xs_obj = pair_value.second;
+    XrdSysRWLock* mutex_xs = iter->second.first;
+    CheckSum* xs_obj = iter->second.second;
 
     // Lock xs obj as multiple threads can update the value here
     XrdSysRWLockHelper xs_wrlock(mutex_xs, 0); // --> wrlock xs obj
@@ -702,13 +723,14 @@ XrdFstOss::GetXsObj (const std::string& fileName, bool isRW)
 void
 XrdFstOss::DropXs (const std::string& fileName, bool force)
 {
-  XrdSysRWLockHelper wr_lock(mRWMap, 0); // --> wrlock map
-  std::pair<XrdSysRWLock*, CheckSum*> pair_value;
-  eos_debug("Oss map size before drop: %i.", mMapFileXs.size());
+  XsShard& shard = GetXsShard(fileName);
+  XrdSysRWLockHelper wr_lock(shard.mRWMap, 0); // --> wrlock map
+  eos_debug("Oss shard size before drop: %i.", shard.mMapFileXs.size());
+  auto iter = shard.mMapFileXs.find(fileName);
 
-  if (mMapFileXs.count(fileName))
+  if (iter != shard.mMapFileXs.end())
   {
-    pair_value = mMapFileXs[fileName];
+    std::pair<XrdSysRWLock*, CheckSum*> pair_value = iter->second;
 
     // If no refs to the checksum, we can safely delete it
     pair_value.first->WriteLock(); // --> wrlock xs obj
@@ -719,7 +741,7 @@ XrdFstOss::DropXs (const std::string& fileName, bool force)
       pair_value.first->UnLock(); // <-- unlock xs obj
       delete pair_value.first;
       delete pair_value.second;
-      mMapFileXs.erase(fileName);
+      shard.mMapFileXs.erase(iter);
     }
     else
     {
@@ -728,7 +750,7 @@ XrdFstOss::DropXs (const std::string& fileName, bool force)
     }
   }
 
-  eos_debug("Oss map size after drop: %i.", mMapFileXs.size());
+  eos_debug("Oss shard size after drop: %i.", shard.mMapFileXs.size());
 }
 
 EOSFSTNAMESPACE_END
@@ -28,6 +28,7 @@
 /*----------------------------------------------------------------------------*/
 #include <map>
 #include <string>
+#include <unordered_map>
 /*----------------------------------------------------------------------------*/
 #include "fst/Namespace.hh"
 #include "fst/checksum/CheckSum.hh"
@@ -281,9 +282,31 @@ public:
 
 private:
 
-  XrdSysRWLock mRWMap; ///< rw lock for the file <-> xs map
-  //! map between file names and block xs objects
-  std::map< std::string, std::pair<XrdSysRWLock*, CheckSum*> > mMapFileXs;
+  //! Number of shards of the file <-> xs map
+  static const unsigned int sNumXsShards = 64;
+
+  //--------------------------------------------------------------------------
+  //! Shard of the file <-> block xs map. Entries stay keyed by the file name
+  //! as the same file id can be stored on several file systems of the FST.
+  //--------------------------------------------------------------------------
+  struct XsShard
+  {
+    XrdSysRWLock mRWMap; ///< rw lock for this shard
+    //! map between file names and block xs objects
+    std::unordered_map< std::string, std::pair<XrdSysRWLock*, CheckSum*> > mMapFileXs;
+  };
+
+  XsShard mXsShards[sNumXsShards]; ///< file <-> xs map sharded by file id
+
+  //--------------------------------------------------------------------------
+  //! Get the shard of the file <-> xs map holding a file name
+  //!
+  //! @param fileName physical file name
+  //!
+  //! @return shard selected by the file id or by a hash of the name for
+  //!         files not following the hex file id naming
+  //--------------------------------------------------------------------------
+  XsShard& GetXsShard (const std::string& fileName);
 
   // Parameters for pre-reading (i.e. for fadvise)
   long long mPrPBits; ///< page lo order bit mask
@@ -213,7 +213,9 @@ XrdFstOssFile::Read (void* buffer, off_t offset, size_t length)
     
     if (mBlockXs)
     {
-      XrdSysRWLockHelper wr_lock(mRWLockXs, 0);
+      // Verification does not modify the block xs object, so concurrent
+      // readers of the same file only exclude writers
+      XrdSysRWLockHelper rd_lock(mRWLockXs);
       
       if ((nread > 0) &&
           (!mBlockXs->CheckBlockSum(piece->offset, piece->data, nread)))
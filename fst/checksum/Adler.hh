@@ -94,6 +94,18 @@ public:
   {
     return sizeof (unsigned int);
   }
+
+  void
+  BlockChecksums (const char* buffer, size_t nblocks, char* xs)
+  {
+    // stateless - the chunk map is not needed for single blocks
+    for (size_t i = 0; i < nblocks; i++)
+    {
+      unsigned int value = adler32(adler32(0L, Z_NULL, 0),
+                                   (const Bytef*) buffer + (i * BlockSize), BlockSize);
+      memcpy(xs + (i * sizeof (unsigned int)), &value, sizeof (unsigned int));
+    }
+  }
   void ValidateAdlerMap ();
 
   const char* GetHexChecksum ();
@@ -91,6 +91,17 @@ public:
     return sizeof (unsigned int);
   }
 
+  void
+  BlockChecksums (const char* buffer, size_t nblocks, char* xs)
+  {
+    for (size_t i = 0; i < nblocks; i++)
+    {
+      unsigned int value = crc32(crc32(0L, Z_NULL, 0),
+                                 (const Bytef*) buffer + (i * BlockSize), BlockSize);
+      memcpy(xs + (i * sizeof (unsigned int)), &value, sizeof (unsigned int));
+    }
+  }
+
   void
   Reset ()
   {
@@ -100,6 +100,13 @@ public:
     return sizeof (unsigned int);
   }
 
+  void
+  BlockChecksums (const char* buffer, size_t nblocks, char* xs)
+  {
+    // interleaves several blocks on hardware supporting SSE4.2
+    checksum::crc32cBlocks(buffer, BlockSize, nblocks, xs);
+  }
+
   void
   Reset ()
   {
@@ -50,7 +50,12 @@ EOSFSTNAMESPACE_BEGIN
 // static variable + sig handler to deal with SIGBUS error
 /*----------------------------------------------------------------------------*/
 
-static sigjmp_buf sj_env;
+static __thread sigjmp_buf sj_env;
+
+//! Number of blocks checksummed and compared with the map in one go
+#define CHECKSUM_BLOCK_BATCH 64
+//! Largest binary checksum of the supported algorithms
+#define CHECKSUM_MAX_LEN 64
 
 /*----------------------------------------------------------------------------*/
 static void
@@ -525,6 +530,22 @@ CheckSum::AlignBlockShrink (off_t offset, size_t len, off_t &aligned_offset, siz
   return;
 }
 
+/*----------------------------------------------------------------------------*/
+void
+CheckSum::BlockChecksums (const char* buffer, size_t nblocks, char* xs)
+{
+  int len = 0;
+  size_t xslen = GetCheckSumLen();
+
+  for (size_t i = 0; i < nblocks; i++)
+  {
+    Reset();
+    Add(buffer + (i * BlockSize), BlockSize, 0);
+    Finalize();
+    memcpy(xs + (i * xslen), GetBinChecksum(len), xslen);
+  }
+}
+
 /*----------------------------------------------------------------------------*/
 bool
 CheckSum::AddBlockSum (off_t offset, const char* buffer, size_t len)
@@ -535,6 +556,10 @@ CheckSum::AddBlockSum (off_t offset, const char* buffer, size_t len)
 
   off_t aligned_offset;
   size_t aligned_len;
+  size_t xslen = GetCheckSumLen();
+
+  if (xslen > CHECKSUM_MAX_LEN)
+    return false;
 
   // -----------------------------------------------------------------------------
   // first wipe out the concerned pages (set to 0)
@@ -543,44 +568,61 @@ CheckSum::AddBlockSum (off_t offset, const char* buffer, size_t len)
   AlignBlockExpand(offset, len, aligned_offset, aligned_len);
   if (aligned_len)
   {
-    off_t endoffset = aligned_offset + aligned_len;
-    off_t position = offset;
-    const char* bufferptr = buffer + (aligned_offset - offset);
-    // loop over all blocks
-    for (position = aligned_offset; position < endoffset; position += BlockSize)
+    // grow the map once for the whole range
+    if (!ChangeMap(aligned_offset + aligned_len, false))
+      return false;
+
+    off_t mapoffset = (aligned_offset / BlockSize) * xslen;
+    size_t maplen = (aligned_len / BlockSize) * xslen;
+
+    if (!sigsetjmp(sj_env, 1))
     {
-      Reset();
-      Finalize();
-      if (!SetXSMap(position))
-        return false;
-      bufferptr += BlockSize;
+      memset(ChecksumMap + mapoffset, 0, maplen);
+    }
+    else
+    {
+      // return point from signal handler
+      fprintf(stderr, "Fatal: [CheckSum::AddBlockSum] recovered SIGBUS by illegal write access to mmaped XS map file [ mapoffset=%llu maplen=%llu map=%llu mapsize=%llu ]\n", (unsigned long long) mapoffset, (unsigned long long) maplen, (unsigned long long) ChecksumMap, (unsigned long long) ChecksumMapSize);
+      return false;
     }
   }
 
-
   // -----------------------------------------------------------------------------
-  // write the inner matching page
+  // write the inner matching pages
   // -----------------------------------------------------------------------------
 
   AlignBlockShrink(offset, len, aligned_offset, aligned_len);
 
   if (aligned_len)
   {
-    off_t endoffset = aligned_offset + aligned_len;
-    off_t position = offset;
+    size_t nblocks = aligned_len / BlockSize;
     const char* bufferptr = buffer + (aligned_offset - offset);
-    // loop over all blocks
-    for (position = aligned_offset; position < endoffset; position += BlockSize)
+    off_t mapoffset = (aligned_offset / BlockSize) * xslen;
+    char xs[CHECKSUM_BLOCK_BATCH * CHECKSUM_MAX_LEN];
+
+    for (size_t done = 0; done < nblocks;)
     {
-      // checksum this block
-      Reset();
-      Add(bufferptr, BlockSize, 0);
-      Finalize();
-      // write the checksum page
-      if (!SetXSMap(position))
+      size_t n = nblocks - done;
+
+      if (n > CHECKSUM_BLOCK_BATCH)
+        n = CHECKSUM_BLOCK_BATCH;
+
+      // checksum a batch of blocks and write the checksum pages
+      BlockChecksums(bufferptr + (done * BlockSize), n, xs);
+
+      if (!sigsetjmp(sj_env, 1))
+      {
+        memcpy(ChecksumMap + mapoffset + (done * xslen), xs, n * xslen);
+      }
+      else
+      {
+        // return point from signal handler
+        fprintf(stderr, "Fatal: [CheckSum::AddBlockSum] recovered SIGBUS by illegal write access to mmaped XS map file [ mapoffset=%llu map=%llu mapsize=%llu ]\n", (unsigned long long) (mapoffset + (done * xslen)), (unsigned long long) ChecksumMap, (unsigned long long) ChecksumMapSize);
         return false;
-      nXSBlocksWritten++;
-      bufferptr += BlockSize;
+      }
+
+      done += n;
+      nXSBlocksWritten += n;
     }
   }
   return true;
@@ -593,31 +635,72 @@ CheckSum::CheckBlockSum (off_t offset, const char* buffer, size_t len)
   // --------------------------------------------------------------------------------------
   // !this only checks the checksum on full blocks, not matching edge is not calculated
   // --------------------------------------------------------------------------------------
+  // ! the map is never changed here, so several readers can verify concurrently
+  // ! provided the plug-in implements a stateless BlockChecksums
+  // --------------------------------------------------------------------------------------
 
   off_t aligned_offset;
   size_t aligned_len;
+  size_t xslen = GetCheckSumLen();
+
+  if ((!ChecksumMap) || (xslen > CHECKSUM_MAX_LEN))
+  {
+    fprintf(stderr, "Fatal: [CheckSum::CheckBlockSum] no map\n");
+    return false;
+  }
 
   AlignBlockShrink(offset, len, aligned_offset, aligned_len);
 
   if (aligned_len)
   {
-    off_t endoffset = aligned_offset + aligned_len;
-    off_t position = offset;
+    size_t nblocks = aligned_len / BlockSize;
+    size_t first = aligned_offset / BlockSize;
+
+    // blocks beyond the end of the map have no checksum stored yet
+    if ((first + nblocks) * xslen > ChecksumMapSize)
+    {
+      nblocks = (ChecksumMapSize / xslen > first) ? (ChecksumMapSize / xslen - first) : 0;
+    }
+
     const char* bufferptr = buffer + (aligned_offset - offset);
-    // loop over all blocks
-    for (position = aligned_offset; position < endoffset; position += BlockSize)
+    const char* mapptr = ChecksumMap + (first * xslen);
+    char xs[CHECKSUM_BLOCK_BATCH * CHECKSUM_MAX_LEN];
+
+    for (size_t done = 0; done < nblocks;)
     {
-      // checksum this block
-      Reset();
-      Add(bufferptr, BlockSize, 0);
-      Finalize();
-      // compare the checksum page
-      if (!VerifyXSMap(position))
+      size_t n = nblocks - done;
+
+      if (n > CHECKSUM_BLOCK_BATCH)
+        n = CHECKSUM_BLOCK_BATCH;
+
+      // checksum a batch of blocks
+      BlockChecksums(bufferptr + (done * BlockSize), n, xs);
+
+      // compare the checksum pages - zero bytes are not set (yet)
+      if (!sigsetjmp(sj_env, 1))
       {
+        const char* ref = mapptr + (done * xslen);
+
+        if (memcmp(ref, xs, n * xslen))
+        {
+          for (size_t i = 0; i < n * xslen; i++)
+          {
+            if (ref[i] && (ref[i] != xs[i]))
+            {
+              return false;
+            }
+          }
+        }
+      }
+      else
+      {
+        // return point from signal handler
+        fprintf(stderr, "Fatal: [CheckSum::CheckBlockSum] recovered SIGBUS by illegal read access to mmaped XS map file [ offset=%llu fd=%d map=%llu mapsize=%llu ]\n", (unsigned long long) (aligned_offset + (done * BlockSize)), (int) ChecksumMapFd, (unsigned long long) ChecksumMap, (unsigned long long) ChecksumMapSize);
         return false;
       }
-      nXSBlocksChecked++;
-      bufferptr += BlockSize;
+
+      done += n;
+      __sync_fetch_and_add(&nXSBlocksChecked, n);
     }
   }
 
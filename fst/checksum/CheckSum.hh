@@ -158,6 +158,19 @@ public:
   virtual bool CheckBlockSum (off_t offset, const char* buffer, size_t buffersizem); // this only verifies the checksum on full blocks, not matching edge is not calculated
   virtual bool AddBlockSumHoles (int fd);
 
+  //----------------------------------------------------------------------------
+  //! Compute the binary checksums of consecutive full blocks
+  //!
+  //! @param buffer nblocks * BlockSize bytes of data
+  //! @param nblocks number of blocks
+  //! @param xs receives nblocks * GetCheckSumLen() bytes
+  //!
+  //! The default implementation uses the running checksum of the object, the
+  //! built-in algorithms override it with a stateless version so that blocks
+  //! can be verified concurrently by several readers of the same file.
+  //----------------------------------------------------------------------------
+  virtual void BlockChecksums (const char* buffer, size_t nblocks, char* xs);
+
   virtual const char*
   MakeBlockXSPath (const char *filepath)
   {
@@ -74,6 +74,12 @@ public:
 
   int GetCheckSumLen() { return MD5_DIGEST_LENGTH;}
 
+  void BlockChecksums(const char* buffer, size_t nblocks, char* xs) {
+    for (size_t i=0; i< nblocks; i++) {
+      ::MD5((const unsigned char*) buffer + (i*BlockSize), BlockSize, (unsigned char*) xs + (i*MD5_DIGEST_LENGTH));
+    }
+  }
+
   void Finalize() {
     if (!finalized) 
     {
@@ -96,6 +96,16 @@ public:
     return SHA_DIGEST_LENGTH;
   }
 
+  void
+  BlockChecksums (const char* buffer, size_t nblocks, char* xs)
+  {
+    for (size_t i = 0; i < nblocks; i++)
+    {
+      ::SHA1((const unsigned char*) buffer + (i * BlockSize), BlockSize,
+             (unsigned char*) xs + (i * SHA_DIGEST_LENGTH));
+    }
+  }
+
   void
   Finalize ()
   {
@@ -27,6 +27,18 @@ extern CRC32CFunctionPtr crc32c;
 
 CRC32CFunctionPtr detectBestCRC32C();
 
+/** Pointer to a function that computes the final CRC32-C checksums of
+consecutive blocks of the same size.
+@arg data Pointer to nblocks blocks of blocksize bytes.
+@arg blocksize size of each block in bytes.
+@arg nblocks number of blocks.
+@arg crcs receives nblocks 32-bit values, it does not need to be aligned.
+*/
+typedef void (*CRC32CBlocksFunctionPtr)(const void* data, size_t blocksize, size_t nblocks, void* crcs);
+
+/** This will map automatically to the "best" multi-block implementation. */
+extern CRC32CBlocksFunctionPtr crc32cBlocks;
+
 /** Converts a partial CRC32-C computation to the final value. */
 static inline uint32_t crc32cFinish(uint32_t crc) {
     return ~crc;
@@ -37,6 +49,8 @@ uint32_t crc32cSlicingBy4(uint32_t crc, const void* data, size_t length);
 uint32_t crc32cSlicingBy8(uint32_t crc, const void* data, size_t length);
 uint32_t crc32cHardware32(uint32_t crc, const void* data, size_t length);
 uint32_t crc32cHardware64(uint32_t crc, const void* data, size_t length);
+void crc32cBlocksGeneric(const void* data, size_t blocksize, size_t nblocks, void* crcs);
+void crc32cBlocksHardware64(const void* data, size_t blocksize, size_t nblocks, void* crcs);
 
 }  // namespace checksum
 #endif
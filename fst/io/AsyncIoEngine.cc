@@ -0,0 +1,689 @@
+//------------------------------------------------------------------------------
+// File: AsyncIoEngine.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "fst/io/AsyncIoEngine.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysTimer.hh"
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <climits>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+AsyncIoEngine::AsyncIoEngine (unsigned int queue_depth, unsigned int nthreads,
+                              bool use_uring) :
+  eos::common::LogId(),
+  mJobCond(0),
+  mNumWorkers(nthreads ? nthreads : 1),
+  mShutdown(false),
+  mUring(false),
+  mQueueDepth(queue_depth ? queue_depth : 1)
+#ifdef EOS_URING
+  , mInFlight(0),
+  mRingFailed(false)
+#endif
+{
+#ifdef EOS_URING
+  if (use_uring)
+  {
+    int rc = io_uring_queue_init(mQueueDepth, &mRing, 0);
+
+    if (rc)
+    {
+      eos_warning("msg=\"io_uring not available - using thread pool\" errno=%d",
+                  -rc);
+    }
+    else if (XrdSysThread::Run(&mReaper, AsyncIoEngine::StartReaper,
+                               static_cast<void*>(this), XRDSYSTHREAD_HOLD,
+                               "AsyncIo Reaper"))
+    {
+      eos_err("msg=\"cannot start io_uring reaper thread\"");
+      io_uring_queue_exit(&mRing);
+    }
+    else
+    {
+      mUring = true;
+    }
+  }
+#endif
+
+  // the pool serves all reads without io_uring, otherwise it is started only
+  // if the ring fails
+  if (!mUring)
+    StartWorkers();
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+AsyncIoEngine::~AsyncIoEngine ()
+{
+  {
+    XrdSysCondVarHelper lock(mJobCond);
+    mShutdown = true;
+    mJobCond.Broadcast();
+  }
+
+  for (size_t i = 0; i < mWorkers.size(); i++)
+  {
+    XrdSysThread::Join(mWorkers[i], 0);
+  }
+
+#ifdef EOS_URING
+  if (mUring)
+  {
+    bool failed = false;
+    {
+      // wake up the reaper, it exits once nothing is in flight anymore
+      XrdSysMutexHelper lock(mSqMutex);
+      failed = mRingFailed;
+
+      if (!failed)
+      {
+        struct io_uring_sqe* sqe = io_uring_get_sqe(&mRing);
+
+        if (sqe)
+        {
+          io_uring_prep_nop(sqe);
+          io_uring_sqe_set_data(sqe, 0);
+          io_uring_submit(&mRing);
+        }
+      }
+    }
+
+    if (failed)
+    {
+      // nothing can wake up the reaper anymore - wait for the requests which
+      // were accepted by the kernel, the reaper exits after the last one
+      // unless it waits for a completion already
+      while (1)
+      {
+        {
+          XrdSysMutexHelper lock(mSqMutex);
+
+          if (!mInFlight)
+            break;
+        }
+
+        XrdSysTimer::Wait(10);
+      }
+
+      XrdSysThread::Detach(mReaper);
+    }
+    else
+    {
+      XrdSysThread::Join(mReaper, 0);
+      io_uring_queue_exit(&mRing);
+    }
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Get the engine shared by all local files
+//------------------------------------------------------------------------------
+AsyncIoEngine&
+AsyncIoEngine::Instance ()
+{
+  static AsyncIoEngine engine(
+    getenv("EOS_FST_AIO_QUEUE_DEPTH") ?
+    strtoul(getenv("EOS_FST_AIO_QUEUE_DEPTH"), 0, 10) : 128,
+    getenv("EOS_FST_AIO_THREADS") ?
+    strtoul(getenv("EOS_FST_AIO_THREADS"), 0, 10) : 16,
+    !getenv("EOS_FST_NO_URING"));
+  return engine;
+}
+
+//------------------------------------------------------------------------------
+// Submit a vector read
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::SubmitReadV (int fd, const XrdCl::ChunkList& chunks,
+                            Callback done)
+{
+  std::vector<ScatterRead> reads(chunks.size());
+
+  for (size_t i = 0; i < chunks.size(); i++)
+  {
+    struct iovec vec;
+    vec.iov_base = chunks[i].buffer;
+    vec.iov_len = chunks[i].length;
+    reads[i].mOffset = chunks[i].offset;
+    reads[i].mIov.push_back(vec);
+  }
+
+  SubmitScatter(fd, reads, done);
+}
+
+//------------------------------------------------------------------------------
+// Submit a list of scatter reads
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::SubmitScatter (int fd, std::vector<ScatterRead>& reads,
+                              Callback done)
+{
+  if (reads.empty())
+  {
+    done(0);
+    return;
+  }
+
+  Batch* batch = new Batch();
+  batch->mFd = fd;
+  batch->mReads.swap(reads);
+  batch->mNext = 0;
+  batch->mPending = 0;
+  batch->mBytes = 0;
+  batch->mErrno = 0;
+  batch->mDone = done;
+
+#ifdef EOS_URING
+  if (mUring)
+  {
+    std::vector<Batch*> completed;
+    bool queued = false;
+    {
+      XrdSysMutexHelper lock(mSqMutex);
+
+      if (!mRingFailed)
+      {
+        batch->mRequests.resize(batch->mReads.size());
+
+        for (size_t i = 0; i < batch->mReads.size(); i++)
+        {
+          Request& req = batch->mRequests[i];
+          req.mBatch = batch;
+          req.mIov = batch->mReads[i].mIov;
+          req.mOffset = batch->mReads[i].mOffset;
+          req.mLeft = 0;
+
+          for (size_t j = 0; j < req.mIov.size(); j++)
+            req.mLeft += req.mIov[j].iov_len;
+        }
+
+        mBacklog.push_back(batch);
+        FillRing(completed);
+        queued = true;
+      }
+    }
+
+    Complete(completed);
+
+    if (queued)
+      return;
+  }
+#endif
+
+  StartWorkers();
+  XrdSysCondVarHelper lock(mJobCond);
+  mJobs.push_back(batch);
+  mJobCond.Signal();
+}
+
+//------------------------------------------------------------------------------
+// Vector read waiting for the completion
+//------------------------------------------------------------------------------
+int64_t
+AsyncIoEngine::ReadV (int fd, const XrdCl::ChunkList& chunks)
+{
+  XrdSysSemaphore sem(0);
+  int64_t result = 0;
+  SubmitReadV(fd, chunks, [&sem, &result](int64_t nread)
+  {
+    result = nread;
+    sem.Post();
+  });
+  sem.Wait();
+  return result;
+}
+
+//------------------------------------------------------------------------------
+// Thread startup functions
+//------------------------------------------------------------------------------
+void*
+AsyncIoEngine::StartWorker (void* pp)
+{
+  static_cast<AsyncIoEngine*>(pp)->Worker();
+  return 0;
+}
+
+void*
+AsyncIoEngine::StartReaper (void* pp)
+{
+#ifdef EOS_URING
+  static_cast<AsyncIoEngine*>(pp)->Reaper();
+#endif
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Start the thread pool unless it is running already
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::StartWorkers ()
+{
+  XrdSysCondVarHelper lock(mJobCond);
+
+  if (!mWorkers.empty() || mShutdown)
+    return;
+
+  for (unsigned int i = 0; i < mNumWorkers; i++)
+  {
+    pthread_t tid;
+
+    if (XrdSysThread::Run(&tid, AsyncIoEngine::StartWorker,
+                          static_cast<void*>(this), XRDSYSTHREAD_HOLD,
+                          "AsyncIo Worker"))
+    {
+      eos_err("msg=\"cannot start async io worker thread\"");
+      continue;
+    }
+
+    mWorkers.push_back(tid);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Call the callbacks of completed batches and delete them
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::Complete (std::vector<Batch*>& completed)
+{
+  for (size_t i = 0; i < completed.size(); i++)
+  {
+    Batch* batch = completed[i];
+    batch->mDone(batch->mErrno ? -batch->mErrno : batch->mBytes);
+    delete batch;
+  }
+
+  completed.clear();
+}
+
+//------------------------------------------------------------------------------
+// Serve batches from the thread pool queue
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::Worker ()
+{
+  while (1)
+  {
+    Batch* batch = 0;
+    {
+      XrdSysCondVarHelper lock(mJobCond);
+
+      while (mJobs.empty() && !mShutdown)
+      {
+        mJobCond.Wait();
+      }
+
+      if (mJobs.empty())
+      {
+        return;
+      }
+
+      batch = mJobs.front();
+      mJobs.pop_front();
+    }
+
+    ReadBatch(batch);
+    batch->mDone(batch->mErrno ? -batch->mErrno : batch->mBytes);
+    delete batch;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Do all reads of a batch with positional reads
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::ReadBatch (Batch* batch)
+{
+  for (size_t i = 0; i < batch->mReads.size(); i++)
+  {
+    int64_t nread = ReadScatter(batch->mFd, batch->mReads[i]);
+
+    if (nread < 0)
+    {
+      batch->mErrno = -nread;
+      return;
+    }
+
+    batch->mBytes += nread;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Do one scatter read, retrying on partial reads
+//------------------------------------------------------------------------------
+int64_t
+AsyncIoEngine::ReadScatter (int fd, const ScatterRead& read)
+{
+  std::vector<struct iovec> iov = read.mIov;
+  size_t first = 0;
+  int64_t done = 0;
+
+  while (first < iov.size())
+  {
+    ssize_t nread;
+
+    if (iov.size() - first == 1)
+    {
+      nread = pread(fd, iov[first].iov_base, iov[first].iov_len,
+                    read.mOffset + done);
+    }
+    else
+    {
+      nread = preadv(fd, &iov[first], std::min(iov.size() - first,
+                                               (size_t) IOV_MAX),
+                     read.mOffset + done);
+    }
+
+    if (nread < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      return -errno;
+    }
+
+    if (nread == 0)
+      break;
+
+    done += nread;
+
+    // skip the buffers filled completely and continue in the partial one
+    while ((first < iov.size()) && ((size_t) nread >= iov[first].iov_len))
+    {
+      nread -= iov[first].iov_len;
+      first++;
+    }
+
+    if (first < iov.size())
+    {
+      iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + nread;
+      iov[first].iov_len -= nread;
+    }
+  }
+
+  return done;
+}
+
+#ifdef EOS_URING
+//------------------------------------------------------------------------------
+// Fill the submission queue from the resubmissions and the backlog
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::FillRing (std::vector<Batch*>& completed)
+{
+  while (mInFlight < mQueueDepth)
+  {
+    Request* req = 0;
+
+    if (!mResubmit.empty())
+    {
+      req = mResubmit.front();
+    }
+    else if (!mBacklog.empty())
+    {
+      Batch* batch = mBacklog.front();
+      req = &batch->mRequests[batch->mNext];
+    }
+    else
+    {
+      break;
+    }
+
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&mRing);
+
+    if (!sqe)
+      break;
+
+    if (!mResubmit.empty())
+    {
+      mResubmit.pop_front();
+    }
+    else
+    {
+      Batch* batch = mBacklog.front();
+      batch->mNext++;
+      batch->mPending++;
+
+      if (batch->mNext == batch->mReads.size())
+        mBacklog.pop_front();
+    }
+
+    if (req->mIov.size() == 1)
+    {
+      io_uring_prep_read(sqe, req->mBatch->mFd, req->mIov[0].iov_base,
+                         req->mIov[0].iov_len, req->mOffset);
+    }
+    else
+    {
+      // the vector lives in the request until it completes
+      io_uring_prep_readv(sqe, req->mBatch->mFd, &req->mIov[0],
+                          std::min(req->mIov.size(), (size_t) IOV_MAX),
+                          req->mOffset);
+    }
+
+    io_uring_sqe_set_data(sqe, req);
+    mQueued.push_back(req);
+    mInFlight++;
+  }
+
+  if (!mQueued.empty())
+    SubmitRing(completed);
+}
+
+//------------------------------------------------------------------------------
+// Submit the queued requests
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::SubmitRing (std::vector<Batch*>& completed)
+{
+  // one system call for all the requests queued in this round, requests not
+  // accepted by an earlier call are part of it since they are still queued
+  int rc;
+
+  while ((rc = io_uring_submit(&mRing)) == -EINTR)
+  { }
+
+  if (rc >= 0)
+  {
+    for (int i = 0; (i < rc) && !mQueued.empty(); i++)
+      mQueued.pop_front();
+
+    return;
+  }
+
+  if (((rc == -EAGAIN) || (rc == -EBUSY)) && (mInFlight > mQueued.size()))
+  {
+    // the kernel is short of resources, the requests stay queued and are
+    // submitted again once the reaper got a completion
+    eos_warning("msg=\"io_uring submission deferred\" errno=%d queued=%lu",
+                -rc, (unsigned long) mQueued.size());
+    return;
+  }
+
+  // no completion is coming which would retry the submission - the queued
+  // requests fail, and since they cannot be taken back from the submission
+  // queue the ring must not be entered for submission again
+  eos_err("msg=\"io_uring submission failed - using thread pool\" errno=%d",
+          -rc);
+  mRingFailed = true;
+
+  while (!mQueued.empty())
+  {
+    Request* req = mQueued.front();
+    mQueued.pop_front();
+    mInFlight--;
+    FinishRequest(req, rc, completed);
+  }
+
+  while (!mResubmit.empty())
+  {
+    Request* req = mResubmit.front();
+    mResubmit.pop_front();
+    FinishRequest(req, rc, completed);
+  }
+
+  while (!mBacklog.empty())
+  {
+    // reads not submitted yet are failed as well
+    Batch* batch = mBacklog.front();
+    mBacklog.pop_front();
+    batch->mNext = batch->mReads.size();
+
+    if (!batch->mErrno)
+      batch->mErrno = -rc;
+
+    if (!batch->mPending)
+      completed.push_back(batch);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Account a finished request
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::FinishRequest (Request* req, int res,
+                              std::vector<Batch*>& completed)
+{
+  Batch* batch = req->mBatch;
+
+  if (res > 0)
+  {
+    batch->mBytes += res;
+
+    if (((uint64_t) res < req->mLeft) && !mRingFailed)
+    {
+      // short read - continue after the bytes read, a read of 0 bytes is
+      // the end of the file
+      req->mOffset += res;
+      req->mLeft -= res;
+      size_t first = 0;
+
+      while ((first < req->mIov.size()) &&
+             ((size_t) res >= req->mIov[first].iov_len))
+      {
+        res -= req->mIov[first].iov_len;
+        first++;
+      }
+
+      req->mIov.erase(req->mIov.begin(), req->mIov.begin() + first);
+      req->mIov[0].iov_base = static_cast<char*>(req->mIov[0].iov_base) + res;
+      req->mIov[0].iov_len -= res;
+      mResubmit.push_back(req);
+      return;
+    }
+
+    if (((uint64_t) res < req->mLeft) && !batch->mErrno)
+    {
+      // the rest of a short read cannot be submitted anymore
+      batch->mErrno = EIO;
+    }
+  }
+  else if ((res < 0) && !batch->mErrno)
+  {
+    batch->mErrno = -res;
+  }
+
+  batch->mPending--;
+
+  if (!batch->mPending && (batch->mNext == batch->mReads.size()))
+    completed.push_back(batch);
+}
+
+//------------------------------------------------------------------------------
+// Reap completions and complete batches
+//------------------------------------------------------------------------------
+void
+AsyncIoEngine::Reaper ()
+{
+  bool stopping = false;
+  int backoff = 1;
+
+  while (1)
+  {
+    struct io_uring_cqe* cqe = 0;
+    int rc = io_uring_wait_cqe(&mRing, &cqe);
+
+    if (rc)
+    {
+      if (rc == -EINTR)
+        continue;
+
+      eos_err("msg=\"io_uring wait failed\" errno=%d retry-ms=%d", -rc, backoff);
+      {
+        XrdSysMutexHelper lock(mSqMutex);
+
+        if (mRingFailed && !mInFlight)
+          return;
+      }
+      // back off instead of spinning on a failing ring
+      XrdSysTimer::Wait(backoff);
+      backoff = std::min(2 * backoff, 1000);
+      continue;
+    }
+
+    backoff = 1;
+    Request* req = static_cast<Request*>(io_uring_cqe_get_data(cqe));
+    int res = cqe->res;
+    io_uring_cqe_seen(&mRing, cqe);
+    std::vector<Batch*> completed;
+    bool idle = false;
+
+    // the shutdown request is the only entry without a request
+    if (!req)
+      stopping = true;
+
+    {
+      XrdSysMutexHelper lock(mSqMutex);
+
+      if (req)
+      {
+        mInFlight--;
+        FinishRequest(req, res, completed);
+
+        if (!mRingFailed)
+          FillRing(completed);
+      }
+
+      idle = (!mInFlight && mBacklog.empty() && mResubmit.empty());
+      stopping = stopping || (mRingFailed && idle);
+    }
+
+    Complete(completed);
+
+    if (stopping && idle)
+      return;
+  }
+}
+#endif
+
+EOSFSTNAMESPACE_END
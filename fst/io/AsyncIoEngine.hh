@@ -0,0 +1,243 @@
+//------------------------------------------------------------------------------
+// File: AsyncIoEngine.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSFST_ASYNCIOENGINE_HH__
+#define __EOSFST_ASYNCIOENGINE_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "fst/Namespace.hh"
+#include "common/Logging.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+#include "XrdCl/XrdClXRootDResponses.hh"
+/*----------------------------------------------------------------------------*/
+#include <deque>
+#include <functional>
+#include <vector>
+#include <sys/uio.h>
+#ifdef EOS_URING
+#include <liburing.h>
+#endif
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class AsyncIoEngine
+//!
+//! @description Asynchronous engine for local disk reads. Vector reads are
+//! submitted to an io_uring instance as one batch of read requests and
+//! completed by a reaper thread. The number of requests in flight is bounded
+//! by the queue depth, chunks which do not fit are kept in a backlog and
+//! submitted as soon as completions free a slot. Reads of one file range into
+//! several buffers are scattered with a single vectored request. Short reads
+//! are resubmitted for the remaining range. Without io_uring support (at
+//! build or at run time) or once the ring stopped accepting requests,
+//! requests are served by a pool of threads doing positional reads.
+//------------------------------------------------------------------------------
+class AsyncIoEngine : public eos::common::LogId
+{
+public:
+  //! Completion callback getting the number of bytes read or -errno
+  typedef std::function<void (int64_t)> Callback;
+
+  //----------------------------------------------------------------------------
+  //! Read of a contiguous file range into one or more buffers
+  //----------------------------------------------------------------------------
+  struct ScatterRead
+  {
+    uint64_t mOffset; ///< file offset
+    std::vector<struct iovec> mIov; ///< destination buffers in file order
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param queue_depth maximum number of requests in flight in io_uring
+  //! @param nthreads number of threads in the pool
+  //! @param use_uring use io_uring if available
+  //----------------------------------------------------------------------------
+  AsyncIoEngine (unsigned int queue_depth, unsigned int nthreads,
+                 bool use_uring = true);
+
+  //----------------------------------------------------------------------------
+  //! Destructor - waits for the requests in flight
+  //----------------------------------------------------------------------------
+  virtual ~AsyncIoEngine ();
+
+  //----------------------------------------------------------------------------
+  //! Get the engine shared by all local files. It is configured via the
+  //! environment variables EOS_FST_AIO_QUEUE_DEPTH, EOS_FST_AIO_THREADS and
+  //! EOS_FST_NO_URING.
+  //----------------------------------------------------------------------------
+  static AsyncIoEngine& Instance ();
+
+  //----------------------------------------------------------------------------
+  //! Check if requests are served by io_uring
+  //----------------------------------------------------------------------------
+  bool UsesUring () const
+  {
+    return mUring;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Submit a vector read
+  //!
+  //! @param fd file descriptor
+  //! @param chunks list of chunks to read
+  //! @param done callback called once all chunks are read
+  //----------------------------------------------------------------------------
+  void SubmitReadV (int fd, const XrdCl::ChunkList& chunks, Callback done);
+
+  //----------------------------------------------------------------------------
+  //! Submit a list of scatter reads
+  //!
+  //! @param fd file descriptor
+  //! @param reads reads to do, at most IOV_MAX buffers each - the list is
+  //!        taken over and left empty
+  //! @param done callback called once all reads are done
+  //----------------------------------------------------------------------------
+  void SubmitScatter (int fd, std::vector<ScatterRead>& reads, Callback done);
+
+  //----------------------------------------------------------------------------
+  //! Vector read waiting for the completion
+  //!
+  //! @return number of bytes read or -errno
+  //----------------------------------------------------------------------------
+  int64_t ReadV (int fd, const XrdCl::ChunkList& chunks);
+
+  //----------------------------------------------------------------------------
+  //! Thread startup functions
+  //----------------------------------------------------------------------------
+  static void* StartWorker (void* pp);
+  static void* StartReaper (void* pp);
+
+private:
+  struct Batch;
+
+  //----------------------------------------------------------------------------
+  //! One io_uring read request, resubmitted until its range is read
+  //----------------------------------------------------------------------------
+  struct Request
+  {
+    Batch* mBatch; ///< batch the request belongs to
+    std::vector<struct iovec> mIov; ///< buffers still to fill
+    uint64_t mOffset; ///< file offset of the remaining range
+    uint64_t mLeft; ///< bytes still to read
+  };
+
+  //----------------------------------------------------------------------------
+  //! Vector read in progress
+  //----------------------------------------------------------------------------
+  struct Batch
+  {
+    int mFd; ///< file descriptor
+    std::vector<ScatterRead> mReads; ///< reads to do
+    std::vector<Request> mRequests; ///< io_uring requests, one per read
+    size_t mNext; ///< next read to submit
+    size_t mPending; ///< reads submitted and not completed
+    int64_t mBytes; ///< bytes read so far
+    int mErrno; ///< first error
+    Callback mDone; ///< completion callback
+  };
+
+  //----------------------------------------------------------------------------
+  //! Start the thread pool unless it is running already
+  //----------------------------------------------------------------------------
+  void StartWorkers ();
+
+  //----------------------------------------------------------------------------
+  //! Serve batches from the thread pool queue
+  //----------------------------------------------------------------------------
+  void Worker ();
+
+  //----------------------------------------------------------------------------
+  //! Do all reads of a batch with positional reads
+  //----------------------------------------------------------------------------
+  static void ReadBatch (Batch* batch);
+
+  //----------------------------------------------------------------------------
+  //! Do one scatter read, retrying on partial reads
+  //!
+  //! @return number of bytes read or -errno
+  //----------------------------------------------------------------------------
+  static int64_t ReadScatter (int fd, const ScatterRead& read);
+
+  //----------------------------------------------------------------------------
+  //! Call the callbacks of completed batches and delete them
+  //----------------------------------------------------------------------------
+  static void Complete (std::vector<Batch*>& completed);
+
+  XrdSysCondVar mJobCond; ///< protecting mJobs, mWorkers and mShutdown
+  std::deque<Batch*> mJobs; ///< batches waiting for a thread
+  std::vector<pthread_t> mWorkers; ///< thread pool
+  unsigned int mNumWorkers; ///< size of the thread pool
+  bool mShutdown; ///< set when the engine is destroyed
+  bool mUring; ///< requests are served by io_uring
+  unsigned int mQueueDepth; ///< maximum requests in flight
+
+#ifdef EOS_URING
+  //----------------------------------------------------------------------------
+  //! Fill the submission queue from the resubmissions and the backlog and
+  //! submit it, must be called with mSqMutex held
+  //!
+  //! @param completed filled with the batches completed by a failure
+  //----------------------------------------------------------------------------
+  void FillRing (std::vector<Batch*>& completed);
+
+  //----------------------------------------------------------------------------
+  //! Submit the queued requests, must be called with mSqMutex held. If the
+  //! ring does not accept them and nothing is left to reap, the requests fail
+  //! and the ring is not used for new requests anymore.
+  //!
+  //! @param completed filled with the batches completed by a failure
+  //----------------------------------------------------------------------------
+  void SubmitRing (std::vector<Batch*>& completed);
+
+  //----------------------------------------------------------------------------
+  //! Account a finished request, must be called with mSqMutex held
+  //!
+  //! @param req finished request
+  //! @param res number of bytes read or -errno
+  //! @param completed filled with the batch if it is complete
+  //----------------------------------------------------------------------------
+  void FinishRequest (Request* req, int res, std::vector<Batch*>& completed);
+
+  //----------------------------------------------------------------------------
+  //! Reap completions and complete batches
+  //----------------------------------------------------------------------------
+  void Reaper ();
+
+  struct io_uring mRing; ///< ring shared by all files
+  XrdSysMutex mSqMutex; ///< protecting the submission side of the ring
+  std::deque<Batch*> mBacklog; ///< batches with chunks to submit
+  std::deque<Request*> mResubmit; ///< short reads to continue
+  std::deque<Request*> mQueued; ///< requests not yet accepted by the kernel
+  unsigned int mInFlight; ///< requests queued or submitted and not completed
+  bool mRingFailed; ///< the ring does not accept requests anymore
+  pthread_t mReaper; ///< completion thread
+#endif
+};
+
+EOSFSTNAMESPACE_END
+
+#endif // __EOSFST_ASYNCIOENGINE_HH__
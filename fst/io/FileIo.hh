@@ -31,6 +31,7 @@
 #include "common/Logging.hh"
 #include "fst/Namespace.hh"
 #include "fst/XrdFstOfsFile.hh"
+#include "fst/io/ReadaheadController.hh"
 #include "XrdCl/XrdClXRootDResponses.hh"
 /*----------------------------------------------------------------------------*/
 
@@ -294,6 +295,18 @@ public:
   virtual void* GetAsyncHandler () = 0;
 
 
+  //----------------------------------------------------------------------------
+  //! Add the readahead statistics of the file, only remote files read ahead
+  //!
+  //! @param stats statistics to add to
+  //!
+  //----------------------------------------------------------------------------
+  virtual void AddReadaheadStats (ReadaheadStats& stats)
+  {
+    // empty
+  }
+
+
   //----------------------------------------------------------------------------
   //! Get path to current file
   //----------------------------------------------------------------------------
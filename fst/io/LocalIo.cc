@@ -24,6 +24,11 @@
 /*----------------------------------------------------------------------------*/
 #include "fst/XrdFstOfsFile.hh"
 #include "fst/io/LocalIo.hh"
+#include "fst/io/AsyncIoEngine.hh"
+#include "fst/io/ReadVEngine.hh"
+#include "fst/io/AsyncMetaHandler.hh"
+#include "fst/io/ChunkHandler.hh"
+#include "fst/io/VectChunkHandler.hh"
 /*----------------------------------------------------------------------------*/
 #ifndef __APPLE__
 #include <xfs/xfs.h>
@@ -39,7 +44,8 @@ LocalIo::LocalIo (XrdFstOfsFile* file,
                   const XrdSecEntity* client) :
     FileIo(),
     mLogicalFile(file),
-    mSecEntity(client)
+    mSecEntity(client),
+    mMetaHandler(new AsyncMetaHandler())
 {  
   // In this case the logical file is the same as the local physical file
 }
@@ -50,7 +56,9 @@ LocalIo::LocalIo (XrdFstOfsFile* file,
 //------------------------------------------------------------------------------
 LocalIo::~LocalIo ()
 {
-  //empty
+  // The engine still references the handlers of requests in flight
+  mMetaHandler->WaitOK();
+  delete mMetaHandler;
 }
 
 
@@ -125,13 +133,49 @@ LocalIo::ReadV (XrdCl::ChunkList& chunkList,
 
 
 //--------------------------------------------------------------------------
-// Vector read - async - in this case it is the same as the sync one
+// Vector read - async
 //--------------------------------------------------------------------------
 int64_t
 LocalIo::ReadVAsync (XrdCl::ChunkList& chunkList,
                      uint16_t timeout)
 {
-  return ReadV(chunkList, timeout);
+  int fd = GetAsyncFd();
+
+  if (fd < 0)
+    return ReadV(chunkList, timeout);
+
+  eos_debug("read count=%i", chunkList.size());
+  VectChunkHandler* vhandler = mMetaHandler->Register(chunkList, NULL, false);
+
+  if (!vhandler)
+  {
+    eos_err("unable to get vector handler");
+    return SFS_ERROR;
+  }
+
+  int64_t nread = vhandler->GetLength();
+  ReadVEngine::Instance().SubmitReadV(fd, chunkList,
+                                      [vhandler](int64_t nbytes)
+  {
+    XrdCl::AnyObject* response = 0;
+    XrdCl::XRootDStatus* status = 0;
+
+    if (nbytes < 0)
+    {
+      status = new XrdCl::XRootDStatus(XrdCl::stError, XrdCl::errOSError, -nbytes);
+    }
+    else
+    {
+      status = new XrdCl::XRootDStatus();
+      XrdCl::VectorReadInfo* info = new XrdCl::VectorReadInfo();
+      info->SetSize(nbytes);
+      response = new XrdCl::AnyObject();
+      response->Set(info);
+    }
+
+    vhandler->HandleResponse(status, response);
+  });
+  return nread;
 }
 
 
@@ -152,7 +196,7 @@ LocalIo::Write (XrdSfsFileOffset offset,
 
 
 //------------------------------------------------------------------------------
-// Read from file async - falls back on synchronous mode
+// Read from file async
 //------------------------------------------------------------------------------
 int64_t
 LocalIo::ReadAsync (XrdSfsFileOffset offset,
@@ -161,7 +205,44 @@ LocalIo::ReadAsync (XrdSfsFileOffset offset,
                     bool readahead,
                     uint16_t timeout)
 {
-  return Read(offset, buffer, length, timeout);
+  int fd = GetAsyncFd();
+
+  if (fd < 0)
+    return Read(offset, buffer, length, timeout);
+
+  eos_debug("offset=%llu length=%llu",
+            static_cast<uint64_t> (offset),
+            static_cast<uint64_t> (length));
+  ChunkHandler* handler = mMetaHandler->Register(offset, length, buffer, false);
+
+  if (!handler)
+  {
+    eos_err("unable to get handler");
+    return SFS_ERROR;
+  }
+
+  XrdCl::ChunkList chunks;
+  chunks.push_back(XrdCl::ChunkInfo(offset, length, buffer));
+  AsyncIoEngine::Instance().SubmitReadV(fd, chunks,
+                                        [handler, offset, buffer](int64_t nbytes)
+  {
+    XrdCl::AnyObject* response = 0;
+    XrdCl::XRootDStatus* status = 0;
+
+    if (nbytes < 0)
+    {
+      status = new XrdCl::XRootDStatus(XrdCl::stError, XrdCl::errOSError, -nbytes);
+    }
+    else
+    {
+      status = new XrdCl::XRootDStatus();
+      response = new XrdCl::AnyObject();
+      response->Set(new XrdCl::ChunkInfo(offset, nbytes, buffer));
+    }
+
+    handler->HandleResponse(status, response);
+  });
+  return length;
 }
 
 
@@ -291,7 +372,25 @@ LocalIo::Stat (struct stat* buf, uint16_t timeout)
 int
 LocalIo::Close (uint16_t timeout)
 {
-  return mLogicalFile->closeofs();
+  bool async_ok = true;
+
+  // Wait for any async requests before closing
+  if (mMetaHandler->WaitOK() != XrdCl::errNone)
+  {
+    eos_err("error=async requests failed for file path=%s", mFilePath.c_str());
+    async_ok = false;
+  }
+
+  int retc = mLogicalFile->closeofs();
+
+  // If any of the async requests failed then we have an error
+  if (!async_ok)
+  {
+    errno = EIO;
+    return SFS_ERROR;
+  }
+
+  return retc;
 }
 
 
@@ -319,7 +418,27 @@ LocalIo::Remove (uint16_t timeout)
 void*
 LocalIo::GetAsyncHandler ()
 {
-  return NULL;
+  return static_cast<void*>(mMetaHandler);
+}
+
+
+//------------------------------------------------------------------------------
+// Get the file descriptor usable for asynchronous reads
+//------------------------------------------------------------------------------
+int
+LocalIo::GetAsyncFd ()
+{
+  // Block checksums are verified in the OSS layer, such reads can not bypass it
+  if (!mLogicalFile || mLogicalFile->HasBlockXs())
+    return -1;
+
+  XrdOucErrInfo error;
+
+  if (mLogicalFile->XrdOfsFile::fctl(SFS_FCTL_GETFD, 0, error))
+    return -1;
+
+  int fd = error.getErrInfo();
+  return (fd > 0) ? fd : -1;
 }
 
 EOSFSTNAMESPACE_END
@@ -31,6 +31,9 @@
 
 EOSFSTNAMESPACE_BEGIN
 
+//! Forward declaration
+class AsyncMetaHandler;
+
 //------------------------------------------------------------------------------
 //! Class used for doing local IO operations
 //------------------------------------------------------------------------------
@@ -105,13 +108,15 @@ public:
 
 
   //------------------------------------------------------------------------------
-  //! Vector read - async 
+  //! Vector read - async. The chunks are merged by the vector read engine and
+  //! submitted to the asynchronous IO engine, files with block checksums are
+  //! read synchronously.
   //!
   //! @param chunkList list of chunks for the vector read
   //! @param timeout timeout value
   //!
-  //! @return number of bytes read of -1 if error; this actually calls the
-  //!         ReadV sync method
+  //! @return number of bytes requested or -1 if error, errors of the async
+  //!         requests are reported by the async handler
   //!
   //------------------------------------------------------------------------------
   virtual int64_t ReadVAsync (XrdCl::ChunkList& chunkList,
@@ -136,7 +141,7 @@ public:
 
 
   //----------------------------------------------------------------------------
-  //! Read from file async - falls back to synchrounous mode
+  //! Read from file async - same as a vector read with a single chunk
   //!
   //! @param offset offset in file
   //! @param buffer where the data is read
@@ -265,6 +270,15 @@ private:
 
   XrdFstOfsFile* mLogicalFile; ///< handler to logical file
   const XrdSecEntity* mSecEntity; ///< security entity
+  AsyncMetaHandler* mMetaHandler; ///< async requests meta handler
+
+  //----------------------------------------------------------------------------
+  //! Get the file descriptor usable for asynchronous reads
+  //!
+  //! @return file descriptor or -1 if the file has to be read through the
+  //!         OFS layer
+  //----------------------------------------------------------------------------
+  int GetAsyncFd ();
 
   //----------------------------------------------------------------------------
   //! Disable copy constructor
@@ -0,0 +1,328 @@
+//------------------------------------------------------------------------------
+// File: ReadVEngine.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "fst/io/ReadVEngine.hh"
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Histogram constructor
+//------------------------------------------------------------------------------
+ReadVEngine::Histogram::Histogram () :
+  mLastSum(0)
+{
+  for (unsigned int i = 0; i < sNumBuckets; i++)
+  {
+    mBuckets[i] = 0;
+    mLast[i] = 0;
+  }
+
+  mSum = 0;
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+ReadVEngine::ReadVEngine (uint32_t merge_gap) :
+  eos::common::LogId(),
+  mMergeGap(std::min(merge_gap, sMaxMergeGap))
+{
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+ReadVEngine::~ReadVEngine ()
+{
+  for (auto it = mHistograms.begin(); it != mHistograms.end(); ++it)
+  {
+    delete it->second;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Get the engine shared by all local files
+//------------------------------------------------------------------------------
+ReadVEngine&
+ReadVEngine::Instance ()
+{
+  static ReadVEngine engine(
+    getenv("EOS_FST_READV_MERGE_GAP") ?
+    strtoul(getenv("EOS_FST_READV_MERGE_GAP"), 0, 10) : 4096);
+  return engine;
+}
+
+//------------------------------------------------------------------------------
+// Build the scatter reads for a list of chunks
+//------------------------------------------------------------------------------
+uint64_t
+ReadVEngine::Plan (const XrdCl::ChunkList& chunks,
+                   std::vector<AsyncIoEngine::ScatterRead>& reads,
+                   std::vector<char>& scratch)
+{
+  std::vector<uint32_t> order;
+  order.reserve(chunks.size());
+  reads.clear();
+
+  for (uint32_t i = 0; i < chunks.size(); i++)
+  {
+    if (chunks[i].length)
+      order.push_back(i);
+  }
+
+  std::stable_sort(order.begin(), order.end(),
+                   [&chunks](uint32_t a, uint32_t b)
+  {
+    return chunks[a].offset < chunks[b].offset;
+  });
+
+  uint64_t total = 0;
+  uint64_t end = 0;
+  uint64_t run = 0;
+  // largest gap of every read - the reads run in parallel, so each of them
+  // gets its own scratch region which its gaps overwrite one after the other
+  std::vector<uint64_t> maxgap;
+
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    const XrdCl::ChunkInfo& chunk = chunks[order[i]];
+    char* buffer = static_cast<char*>(chunk.buffer);
+    bool merge = false;
+
+    // overlapping chunks can not share a read, they start a new one
+    if (!reads.empty() && (chunk.offset >= end))
+    {
+      uint64_t gap = chunk.offset - end;
+      merge = ((gap <= mMergeGap) &&
+               (run + gap + chunk.length <= sMaxRunBytes) &&
+               (reads.back().mIov.size() + 2 <= IOV_MAX));
+    }
+
+    if (!merge)
+    {
+      reads.push_back(AsyncIoEngine::ScatterRead());
+      reads.back().mOffset = chunk.offset;
+      maxgap.push_back(0);
+      end = chunk.offset;
+      run = 0;
+    }
+
+    std::vector<struct iovec>& iov = reads.back().mIov;
+    uint64_t gap = chunk.offset - end;
+    struct iovec vec;
+
+    if (gap)
+    {
+      // the scratch region is assigned once all reads are known
+      vec.iov_base = 0;
+      vec.iov_len = gap;
+      iov.push_back(vec);
+      maxgap.back() = std::max(maxgap.back(), gap);
+    }
+
+    if (!gap && !iov.empty() &&
+        (static_cast<char*>(iov.back().iov_base) + iov.back().iov_len == buffer))
+    {
+      // the buffers follow each other as well
+      iov.back().iov_len += chunk.length;
+    }
+    else
+    {
+      vec.iov_base = buffer;
+      vec.iov_len = chunk.length;
+      iov.push_back(vec);
+    }
+
+    run += gap + chunk.length;
+    total += gap + chunk.length;
+    end = chunk.offset + chunk.length;
+  }
+
+  uint64_t nscratch = 0;
+
+  for (size_t i = 0; i < maxgap.size(); i++)
+  {
+    nscratch += maxgap[i];
+  }
+
+  scratch.resize(nscratch);
+  char* region = scratch.empty() ? 0 : &scratch[0];
+
+  for (size_t i = 0; i < reads.size(); i++)
+  {
+    std::vector<struct iovec>& iov = reads[i].mIov;
+
+    for (size_t j = 0; j < iov.size(); j++)
+    {
+      if (!iov[j].iov_base)
+        iov[j].iov_base = region;
+    }
+
+    region += maxgap[i];
+  }
+
+  return total;
+}
+
+//------------------------------------------------------------------------------
+// Submit a vector read
+//------------------------------------------------------------------------------
+void
+ReadVEngine::SubmitReadV (int fd, const XrdCl::ChunkList& chunks,
+                          AsyncIoEngine::Callback done)
+{
+  std::vector<AsyncIoEngine::ScatterRead> reads;
+  std::shared_ptr< std::vector<char> > scratch(new std::vector<char>());
+  uint64_t expected = Plan(chunks, reads, *scratch);
+  int64_t requested = 0;
+
+  for (size_t i = 0; i < chunks.size(); i++)
+  {
+    requested += chunks[i].length;
+  }
+
+  eos_debug("chunks=%lu reads=%lu bytes=%llu", (unsigned long) chunks.size(),
+            (unsigned long) reads.size(), (unsigned long long) expected);
+  AsyncIoEngine::Instance().SubmitScatter(fd, reads,
+                                          [done, expected, requested, scratch](int64_t nread)
+  {
+    if (nread < 0)
+      done(nread);
+    else if ((uint64_t) nread != expected)
+      done(-ESPIPE);
+    else
+      done(requested);
+  });
+}
+
+//------------------------------------------------------------------------------
+// Vector read waiting for the completion
+//------------------------------------------------------------------------------
+int64_t
+ReadVEngine::ReadV (int fd, const XrdCl::ChunkList& chunks)
+{
+  XrdSysSemaphore sem(0);
+  int64_t result = 0;
+  SubmitReadV(fd, chunks, [&sem, &result](int64_t nread)
+  {
+    result = nread;
+    sem.Post();
+  });
+  sem.Wait();
+  return result;
+}
+
+//------------------------------------------------------------------------------
+// Get the histogram of a file system, creating it if needed
+//------------------------------------------------------------------------------
+ReadVEngine::Histogram*
+ReadVEngine::GetHistogram (unsigned long fsid)
+{
+  XrdSysMutexHelper lock(mMutex);
+  Histogram*& hist = mHistograms[fsid];
+
+  if (!hist)
+    hist = new Histogram();
+
+  return hist;
+}
+
+//------------------------------------------------------------------------------
+// Account the latency of a vector read
+//------------------------------------------------------------------------------
+void
+ReadVEngine::AddLatency (unsigned long fsid, uint64_t usec)
+{
+  Histogram* hist = GetHistogram(fsid);
+  unsigned int bucket = 0;
+
+  while ((bucket < sNumBuckets - 1) && (usec >> (bucket + 1)))
+    bucket++;
+
+  hist->mBuckets[bucket]++;
+  hist->mSum += usec;
+}
+
+//------------------------------------------------------------------------------
+// Get the latency statistics of a file system since the previous call
+//------------------------------------------------------------------------------
+void
+ReadVEngine::GetStats (unsigned long fsid, Stats& stats)
+{
+  XrdSysMutexHelper lock(mMutex);
+  stats.mCount = 0;
+  stats.mAvg = stats.mP50 = stats.mP90 = stats.mP99 = 0;
+  auto it = mHistograms.find(fsid);
+
+  if (it == mHistograms.end())
+    return;
+
+  Histogram* hist = it->second;
+  uint64_t delta[sNumBuckets];
+
+  for (unsigned int i = 0; i < sNumBuckets; i++)
+  {
+    uint64_t value = hist->mBuckets[i];
+    delta[i] = value - hist->mLast[i];
+    hist->mLast[i] = value;
+    stats.mCount += delta[i];
+  }
+
+  uint64_t sum = hist->mSum;
+
+  if (stats.mCount)
+    stats.mAvg = (double)(sum - hist->mLastSum) / stats.mCount;
+
+  hist->mLastSum = sum;
+
+  // the percentiles are reported as the upper bound of their bucket
+  double* values[3] = {&stats.mP50, &stats.mP90, &stats.mP99};
+  double quantiles[3] = {0.5, 0.9, 0.99};
+
+  for (int q = 0; (q < 3) && stats.mCount; q++)
+  {
+    uint64_t needed = (uint64_t) ceil(quantiles[q] * stats.mCount);
+    uint64_t seen = 0;
+
+    for (unsigned int i = 0; i < sNumBuckets; i++)
+    {
+      seen += delta[i];
+
+      if (seen >= needed)
+      {
+        *values[q] = (double)(1ull << (i + 1));
+        break;
+      }
+    }
+  }
+}
+
+EOSFSTNAMESPACE_END
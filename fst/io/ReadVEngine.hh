@@ -0,0 +1,166 @@
+//------------------------------------------------------------------------------
+// File: ReadVEngine.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSFST_READVENGINE_HH__
+#define __EOSFST_READVENGINE_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "fst/Namespace.hh"
+#include "fst/io/AsyncIoEngine.hh"
+#include "common/Logging.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+#include "XrdCl/XrdClXRootDResponses.hh"
+/*----------------------------------------------------------------------------*/
+#include <atomic>
+#include <map>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class ReadVEngine
+//!
+//! @description Serves vector reads on local files. The chunks are sorted by
+//! offset and chunks which are adjacent in the file, or separated by a small
+//! gap, are merged into one scatter read filling the caller's buffers
+//! directly - the bytes of a gap go to a scratch buffer owned by the request,
+//! with a separate region for every merged read. All merged reads of a
+//! request are submitted at once to the asynchronous IO engine. The engine
+//! also keeps the vector read latency histograms of the file systems.
+//------------------------------------------------------------------------------
+class ReadVEngine : public eos::common::LogId
+{
+public:
+  //! Largest file range read with one scatter read
+  static const uint64_t sMaxRunBytes = 4 * 1024 * 1024;
+  //! Largest gap bridged between two chunks
+  static const uint32_t sMaxMergeGap = 64 * 1024;
+  //! Number of log2 latency buckets, the last one collects everything slower
+  static const unsigned int sNumBuckets = 32;
+
+  //----------------------------------------------------------------------------
+  //! Vector read latency statistics in micro seconds
+  //----------------------------------------------------------------------------
+  struct Stats
+  {
+    uint64_t mCount; ///< number of vector reads
+    double mAvg; ///< average latency
+    double mP50; ///< median latency
+    double mP90; ///< 90th percentile latency
+    double mP99; ///< 99th percentile latency
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param merge_gap largest gap in bytes bridged between two chunks
+  //----------------------------------------------------------------------------
+  ReadVEngine (uint32_t merge_gap);
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  virtual ~ReadVEngine ();
+
+  //----------------------------------------------------------------------------
+  //! Get the engine shared by all local files. The merge gap is configured
+  //! via the environment variable EOS_FST_READV_MERGE_GAP.
+  //----------------------------------------------------------------------------
+  static ReadVEngine& Instance ();
+
+  //----------------------------------------------------------------------------
+  //! Build the scatter reads for a list of chunks
+  //!
+  //! @param chunks list of chunks
+  //! @param reads filled with the merged reads
+  //! @param scratch filled with the buffer receiving the bytes of the gaps,
+  //!        it has to live until the reads are done
+  //!
+  //! @return number of bytes read including the gaps
+  //----------------------------------------------------------------------------
+  uint64_t Plan (const XrdCl::ChunkList& chunks,
+                 std::vector<AsyncIoEngine::ScatterRead>& reads,
+                 std::vector<char>& scratch);
+
+  //----------------------------------------------------------------------------
+  //! Submit a vector read
+  //!
+  //! @param fd file descriptor
+  //! @param chunks list of chunks to read
+  //! @param done callback getting the number of bytes requested, -ESPIPE if
+  //!        the file is too short or -errno
+  //----------------------------------------------------------------------------
+  void SubmitReadV (int fd, const XrdCl::ChunkList& chunks,
+                    AsyncIoEngine::Callback done);
+
+  //----------------------------------------------------------------------------
+  //! Vector read waiting for the completion
+  //!
+  //! @return number of bytes read or -errno
+  //----------------------------------------------------------------------------
+  int64_t ReadV (int fd, const XrdCl::ChunkList& chunks);
+
+  //----------------------------------------------------------------------------
+  //! Account the latency of a vector read
+  //!
+  //! @param fsid file system id
+  //! @param usec latency in micro seconds
+  //----------------------------------------------------------------------------
+  void AddLatency (unsigned long fsid, uint64_t usec);
+
+  //----------------------------------------------------------------------------
+  //! Get the latency statistics of a file system since the previous call
+  //!
+  //! @param fsid file system id
+  //! @param stats filled with the statistics
+  //----------------------------------------------------------------------------
+  void GetStats (unsigned long fsid, Stats& stats);
+
+private:
+  //----------------------------------------------------------------------------
+  //! Latency histogram of one file system
+  //----------------------------------------------------------------------------
+  struct Histogram
+  {
+    std::atomic<uint64_t> mBuckets[sNumBuckets]; ///< counts per log2 bucket
+    std::atomic<uint64_t> mSum; ///< sum of all latencies
+    uint64_t mLast[sNumBuckets]; ///< counts at the previous GetStats
+    uint64_t mLastSum; ///< sum at the previous GetStats
+
+    Histogram ();
+  };
+
+  //----------------------------------------------------------------------------
+  //! Get the histogram of a file system, creating it if needed
+  //----------------------------------------------------------------------------
+  Histogram* GetHistogram (unsigned long fsid);
+
+  uint32_t mMergeGap; ///< largest gap bridged between two chunks
+  XrdSysMutex mMutex; ///< protecting mHistograms and the snapshots
+  std::map<unsigned long, Histogram*> mHistograms; ///< histograms per fsid
+};
+
+EOSFSTNAMESPACE_END
+
+#endif // __EOSFST_READVENGINE_HH__
@@ -0,0 +1,174 @@
+//------------------------------------------------------------------------------
+// File: ReadaheadController.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "fst/io/ReadaheadController.hh"
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+ReadaheadController::ReadaheadController (uint64_t blocksize,
+                                          uint32_t max_window) :
+  mBlocksize(blocksize),
+  mMaxWindow(max_window ? max_window : 1),
+  mWindow(0),
+  mThreshold(mMaxWindow),
+  mPattern(kSequential),
+  mCandidate(kSequential),
+  mMatches(0),
+  mFirst(true),
+  mLastOffset(0),
+  mLastEnd(0),
+  mStride(0)
+{
+  // start optimistic, a file is most often read from the beginning
+  SetWindow(1);
+}
+
+
+//------------------------------------------------------------------------------
+// Account a read request and update the access pattern
+//------------------------------------------------------------------------------
+ReadaheadController::Pattern
+ReadaheadController::Access (uint64_t offset, uint32_t length)
+{
+  if (mFirst)
+  {
+    mFirst = false;
+    mLastOffset = offset;
+    mLastEnd = offset + length;
+    return mPattern;
+  }
+
+  Pattern observed;
+
+  if (offset == mLastEnd)
+    observed = kSequential;
+  else if (mStride && (offset > mLastOffset) && (offset - mLastOffset == mStride))
+    observed = kStrided;
+  else
+    observed = kRandom;
+
+  mStride = (offset > mLastOffset) ? offset - mLastOffset : 0;
+  mLastOffset = offset;
+  mLastEnd = offset + length;
+
+  if (observed == mCandidate)
+  {
+    mMatches++;
+  }
+  else
+  {
+    mCandidate = observed;
+    mMatches = 1;
+  }
+
+  // a single odd read does not change the pattern
+  if ((mCandidate != mPattern) && (mMatches >= sPatternThreshold))
+  {
+    mPattern = mCandidate;
+
+    if (mPattern == kRandom)
+    {
+      mWindow = 0;
+    }
+    else if (!mWindow)
+    {
+      mThreshold = mMaxWindow;
+      SetWindow(1);
+    }
+  }
+
+  return mPattern;
+}
+
+
+//------------------------------------------------------------------------------
+// Account the first use of a prefetched block
+//------------------------------------------------------------------------------
+void
+ReadaheadController::Hit (bool waited)
+{
+  mStats.mHits++;
+
+  if (!waited || !mWindow)
+    return;
+
+  // the block was not there in time, read further ahead
+  mStats.mWaits++;
+
+  if (mWindow < mThreshold)
+    SetWindow((2 * mWindow < mThreshold) ? 2 * mWindow : mThreshold);
+  else
+    SetWindow(mWindow + 1);
+}
+
+
+//------------------------------------------------------------------------------
+// Account prefetched blocks dropped without being used
+//------------------------------------------------------------------------------
+void
+ReadaheadController::Waste (uint32_t nblocks)
+{
+  if (!nblocks)
+    return;
+
+  mStats.mWasted += nblocks;
+
+  if (mWindow)
+  {
+    mThreshold = (mWindow > 1) ? mWindow / 2 : 1;
+    SetWindow(mThreshold);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Get the distance between two prefetched blocks
+//------------------------------------------------------------------------------
+uint64_t
+ReadaheadController::GetStep () const
+{
+  // short strides are covered by reading the blocks one after the other
+  if ((mPattern == kStrided) && (mStride > mBlocksize))
+    return mStride;
+
+  return mBlocksize;
+}
+
+
+//------------------------------------------------------------------------------
+// Set the window and keep track of the maximum
+//------------------------------------------------------------------------------
+void
+ReadaheadController::SetWindow (uint32_t window)
+{
+  mWindow = (window < mMaxWindow) ? window : mMaxWindow;
+
+  if (mWindow > mStats.mMaxWindow)
+    mStats.mMaxWindow = mWindow;
+}
+
+EOSFSTNAMESPACE_END
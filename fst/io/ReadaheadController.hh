@@ -0,0 +1,197 @@
+//------------------------------------------------------------------------------
+// File: ReadaheadController.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSFST_READAHEADCONTROLLER_HH__
+#define __EOSFST_READAHEADCONTROLLER_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "fst/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Readahead statistics of a file
+//------------------------------------------------------------------------------
+struct ReadaheadStats
+{
+  uint64_t mPrefetched; ///< blocks prefetched
+  uint64_t mHits; ///< prefetched blocks used by a read
+  uint64_t mWasted; ///< prefetched blocks dropped without being used
+  uint64_t mHitBytes; ///< bytes served from prefetched blocks
+  uint64_t mWaits; ///< hits which had to wait for the block to arrive
+  uint32_t mMaxWindow; ///< largest window reached
+
+  ReadaheadStats () :
+    mPrefetched(0), mHits(0), mWasted(0), mHitBytes(0), mWaits(0),
+    mMaxWindow(0)
+  {}
+
+  //----------------------------------------------------------------------------
+  //! Add the statistics of another file
+  //----------------------------------------------------------------------------
+  void Add (const ReadaheadStats& other)
+  {
+    mPrefetched += other.mPrefetched;
+    mHits += other.mHits;
+    mWasted += other.mWasted;
+    mHitBytes += other.mHitBytes;
+    mWaits += other.mWaits;
+
+    if (other.mMaxWindow > mMaxWindow)
+      mMaxWindow = other.mMaxWindow;
+  }
+};
+
+//------------------------------------------------------------------------------
+//! Class ReadaheadController
+//!
+//! @description Decides how far to read ahead in a file. The access pattern
+//! is classified from the offsets of consecutive reads as sequential, strided
+//! (constant distance between reads) or random. For sequential and strided
+//! readers the window - the number of blocks prefetched ahead of the current
+//! one - grows like a TCP slow start whenever a read has to wait for its
+//! prefetched block and shrinks by half whenever a prefetched block is
+//! dropped unused. Random readers get no readahead at all until the pattern
+//! turns sequential or strided again.
+//------------------------------------------------------------------------------
+class ReadaheadController
+{
+public:
+
+  //! Access patterns
+  enum Pattern
+  {
+    kSequential, kStrided, kRandom
+  };
+
+  //! Consecutive reads needed to switch to a new pattern
+  static const uint32_t sPatternThreshold = 2;
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param blocksize size of a readahead block
+  //! @param max_window maximum number of blocks prefetched ahead
+  //!
+  //----------------------------------------------------------------------------
+  ReadaheadController (uint64_t blocksize, uint32_t max_window);
+
+
+  //----------------------------------------------------------------------------
+  //! Account a read request and update the access pattern
+  //!
+  //! @param offset read offset
+  //! @param length read length
+  //!
+  //! @return current access pattern
+  //!
+  //----------------------------------------------------------------------------
+  Pattern Access (uint64_t offset, uint32_t length);
+
+
+  //----------------------------------------------------------------------------
+  //! Account the first use of a prefetched block
+  //!
+  //! @param waited true if the read had to wait for the block
+  //!
+  //----------------------------------------------------------------------------
+  void Hit (bool waited);
+
+
+  //----------------------------------------------------------------------------
+  //! Account bytes served from a prefetched block
+  //----------------------------------------------------------------------------
+  void HitBytes (uint64_t nbytes)
+  {
+    mStats.mHitBytes += nbytes;
+  }
+
+
+  //----------------------------------------------------------------------------
+  //! Account a prefetch request
+  //----------------------------------------------------------------------------
+  void Prefetched ()
+  {
+    mStats.mPrefetched++;
+  }
+
+
+  //----------------------------------------------------------------------------
+  //! Account prefetched blocks dropped without being used
+  //!
+  //! @param nblocks number of blocks dropped at once
+  //!
+  //----------------------------------------------------------------------------
+  void Waste (uint32_t nblocks);
+
+
+  //----------------------------------------------------------------------------
+  //! Get the number of blocks to prefetch ahead of the current one, 0 means
+  //! that readahead is suspended
+  //----------------------------------------------------------------------------
+  uint32_t GetWindow () const
+  {
+    return mWindow;
+  }
+
+
+  //----------------------------------------------------------------------------
+  //! Get the distance between two prefetched blocks
+  //----------------------------------------------------------------------------
+  uint64_t GetStep () const;
+
+
+  //----------------------------------------------------------------------------
+  //! Get the statistics
+  //----------------------------------------------------------------------------
+  const ReadaheadStats& GetStats () const
+  {
+    return mStats;
+  }
+
+private:
+
+  //----------------------------------------------------------------------------
+  //! Set the window and keep track of the maximum
+  //----------------------------------------------------------------------------
+  void SetWindow (uint32_t window);
+
+  uint64_t mBlocksize; ///< size of a readahead block
+  uint32_t mMaxWindow; ///< maximum window
+  uint32_t mWindow; ///< blocks prefetched ahead
+  uint32_t mThreshold; ///< window up to which it is doubled
+  Pattern mPattern; ///< current access pattern
+  Pattern mCandidate; ///< pattern of the latest reads
+  uint32_t mMatches; ///< consecutive reads matching the candidate
+  bool mFirst; ///< no read seen yet
+  uint64_t mLastOffset; ///< offset of the previous read
+  uint64_t mLastEnd; ///< end offset of the previous read
+  uint64_t mStride; ///< distance between the previous two reads
+  ReadaheadStats mStats; ///< statistics
+};
+
+EOSFSTNAMESPACE_END
+
+#endif // __EOSFST_READAHEADCONTROLLER_HH__
@@ -122,6 +122,20 @@ SimpleHandler::WaitOK ()
 }
 
 
+//------------------------------------------------------------------------------
+// Test if the response to the request arrived
+//------------------------------------------------------------------------------
+bool
+SimpleHandler::IsDone ()
+{
+  bool ret = false;
+  mCond.Lock();
+  ret = mReqDone;
+  mCond.UnLock();
+  return ret;
+}
+
+
 //------------------------------------------------------------------------------
 //! Get if there is any request to process
 //------------------------------------------------------------------------------
@@ -83,6 +83,15 @@ public:
   bool WaitOK ();
 
 
+  //----------------------------------------------------------------------------
+  //! Test if the response to the request arrived, without waiting
+  //!
+  //! @return true if the request is done, false otherwise
+  //!
+  //----------------------------------------------------------------------------
+  bool IsDone ();
+
+
   //----------------------------------------------------------------------------
   //! Get if there is any request to process
   //!
@@ -36,6 +36,8 @@ EOSFSTNAMESPACE_BEGIN
 
 const uint64_t ReadaheadBlock::sDefaultBlocksize = 1 *1024 * 1024; ///< 1MB default
 const uint32_t XrdIo::sNumRdAheadBlocks = 2;
+const uint32_t XrdIo::sMaxRdAheadBlocks = 8;
+const uint64_t XrdIo::sRdAheadBudget = 16 * 1024 * 1024; ///< 16MB per file
 
 //------------------------------------------------------------------------------
 // Handle asynchronous open responses
@@ -66,7 +68,12 @@ FileIo(),
 mDoReadahead (false),
 mBlocksize (ReadaheadBlock::sDefaultBlocksize),
 mXrdFile (NULL),
-mMetaHandler(new AsyncMetaHandler())
+mMetaHandler(new AsyncMetaHandler()),
+mNumBlocks (0),
+mMaxRdAheadBlocks (sMaxRdAheadBlocks),
+mMaxNumBlocks (2 * (sMaxRdAheadBlocks + 1)),
+mRdAheadEnd (UINT64_MAX),
+mReadahead (mBlocksize, sMaxRdAheadBlocks)
 {
   // Set the TimeoutResolution to 1 
   XrdCl::Env* env = XrdCl::DefaultEnv::GetEnv();
@@ -78,20 +85,13 @@ mMetaHandler(new AsyncMetaHandler())
 //------------------------------------------------------------------------------
 XrdIo::~XrdIo ()
 {
-  if (mDoReadahead)
-  {
-    while (!mQueueBlocks.empty())
-    {
-      ReadaheadBlock* ptr_readblock = mQueueBlocks.front();
-      mQueueBlocks.pop();
-      delete ptr_readblock;
-    }
+  FreeBlocks();
 
-    while (!mMapBlocks.empty())
-    {
-      delete mMapBlocks.begin()->second;
-      mMapBlocks.erase(mMapBlocks.begin());
-    }
+  while (!mQueueBlocks.empty())
+  {
+    ReadaheadBlock* ptr_readblock = mQueueBlocks.front();
+    mQueueBlocks.pop();
+    delete ptr_readblock;
   }
 
   delete mMetaHandler;  
@@ -107,7 +107,6 @@ int
 XrdIo::Open (const std::string& path, XrdSfsFileOpenMode flags, mode_t mode,
              const std::string& opaque, uint16_t timeout)
 {
-  const char* val = 0;
   std::string request;
   std::string lOpaque;
   size_t qpos = 0;
@@ -125,27 +124,7 @@ XrdIo::Open (const std::string& path, XrdSfsFileOpenMode flags, mode_t mode,
 
   XrdOucEnv open_opaque(lOpaque.c_str());
 
-  // Decide if readahead is used and the block size
-  if ((val = open_opaque.Get("fst.readahead")) &&
-      (strncmp(val, "true", 4) == 0))
-  {
-    eos_debug("Enabling the readahead.");
-    mDoReadahead = true;
-    val = 0;
-
-    if ((val = open_opaque.Get("fst.blocksize")))
-    {
-      mBlocksize = static_cast<uint64_t> (atoll(val));
-    }
-
-    if (mQueueBlocks.empty())
-    {
-      for (unsigned int i = 0; i < sNumRdAheadBlocks; i++)
-      {
-        mQueueBlocks.push(new ReadaheadBlock(mBlocksize));
-      }
-    }
-  }
+  SetupReadahead(open_opaque);
 
   request = path;
   request += "?";
@@ -196,7 +175,6 @@ XrdIo::OpenAsync (const std::string& path, XrdCl::ResponseHandler* io_handler,
                   XrdSfsFileOpenMode flags, mode_t mode,
                   const std::string& opaque, uint16_t timeout)
 {
-  const char* val = 0;
   std::string request;
   std::string lOpaque;
   size_t qpos = 0;
@@ -214,29 +192,7 @@ XrdIo::OpenAsync (const std::string& path, XrdCl::ResponseHandler* io_handler,
 
   XrdOucEnv open_opaque(lOpaque.c_str());
 
-  // Decide if readahead is used and the block size
-  if ((val = open_opaque.Get("fst.readahead")) &&
-      (strncmp(val, "true", 4) == 0))
-  {
-    eos_debug("Enabling the readahead.");
-    mDoReadahead = true;
-    val = 0;
-
-    if ((val = open_opaque.Get("fst.blocksize")))
-    {
-      mBlocksize = static_cast<uint64_t> (atoll(val));
-    }
-
-    // Allocate only if not already done - this can happen if open is called
-    // multiple times on the same XrdIo object
-    if (mQueueBlocks.empty())
-    {
-      for (unsigned int i = 0; i < sNumRdAheadBlocks; i++)
-      {
-        mQueueBlocks.push(new ReadaheadBlock(mBlocksize));
-      }
-    }
-  }
+  SetupReadahead(open_opaque);
 
   request = path;
   request += "?";
@@ -275,6 +231,69 @@ XrdIo::OpenAsync (const std::string& path, XrdCl::ResponseHandler* io_handler,
   return SFS_OK;
 }
 
+//------------------------------------------------------------------------------
+// Enable the readahead if requested in the opaque information
+//------------------------------------------------------------------------------
+void
+XrdIo::SetupReadahead (XrdOucEnv& opaque)
+{
+  const char* val = 0;
+
+  // Decide if readahead is used, the block size and the maximum window
+  if ((val = opaque.Get("fst.readahead")) &&
+      (strncmp(val, "true", 4) == 0))
+  {
+    eos_debug("Enabling the readahead.");
+    mDoReadahead = true;
+
+    // Allocate only if not already done - this can happen if open is called
+    // multiple times on the same XrdIo object
+    if (mNumBlocks)
+      return;
+
+    if ((val = opaque.Get("fst.blocksize")))
+    {
+      mBlocksize = static_cast<uint64_t> (atoll(val));
+    }
+
+    if ((val = opaque.Get("fst.readahead.maxblocks")) && atoi(val) > 0)
+    {
+      mMaxRdAheadBlocks = static_cast<uint32_t> (atoi(val));
+    }
+
+    // Room for the current block, the window and as many dropped blocks in
+    // flight, but not more than the readahead budget of the file - layouts
+    // reading several stripes share their budget among the stripes
+    uint64_t budget = sRdAheadBudget;
+
+    if ((val = opaque.Get("fst.readahead.budget")) && atoll(val) > 0)
+    {
+      budget = static_cast<uint64_t> (atoll(val));
+    }
+
+    uint64_t nblocks = mBlocksize ? budget / mBlocksize : sNumRdAheadBlocks;
+    mMaxNumBlocks = 2 * (mMaxRdAheadBlocks + 1);
+
+    if (nblocks < mMaxNumBlocks)
+    {
+      mMaxNumBlocks = (nblocks > sNumRdAheadBlocks) ? nblocks : sNumRdAheadBlocks;
+    }
+
+    if (mMaxRdAheadBlocks >= mMaxNumBlocks)
+    {
+      mMaxRdAheadBlocks = mMaxNumBlocks - 1;
+    }
+
+    mReadahead = ReadaheadController(mBlocksize, mMaxRdAheadBlocks);
+
+    for (unsigned int i = 0; i < sNumRdAheadBlocks; i++)
+    {
+      mQueueBlocks.push(new ReadaheadBlock(mBlocksize));
+      mNumBlocks++;
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 // Read from file - sync
 //------------------------------------------------------------------------------
@@ -464,40 +483,48 @@ XrdIo::ReadAsync (XrdSfsFileOffset offset,
     std::map<uint64_t, ReadaheadBlock*>::iterator iter;
 
     mPrefetchMutex.Lock(); // -->
+    mReadahead.Access(offset, length);
+
+    if (!mReadahead.GetWindow())
+    {
+      // Random access - prefetched blocks are of no use, read directly
+      eos_debug("readahead suspended for random access");
+      DropBlocks(mMapBlocks.end());
+    }
 
-    while (length)
+    while (length && mReadahead.GetWindow())
     {
       iter = FindBlock(offset);
       
       if (iter != mMapBlocks.end())
       {
         // Block found in prefetched blocks
-        SimpleHandler* sh = iter->second->handler;
+        ReadaheadBlock* block = iter->second;
+        SimpleHandler* sh = block->handler;
         shift = offset - iter->first;
 
-        // We can prefetch another block if we still have available blocks in
-        // the queue or if first read was from second prefetched block
-        if (!mQueueBlocks.empty() || (iter != mMapBlocks.begin()))
+        // Blocks before the current one were passed, recycle them and keep
+        // the window ahead of the current block in flight
+        DropBlocks(iter);
+        FillWindow(iter->first, timeout);
+        bool waited = !sh->IsDone();
+
+        if (sh->WaitOK())
         {
-          if (iter != mMapBlocks.begin())
+          eos_debug("block in cache, blk_off=%lld, req_off= %lld", iter->first, offset);
+
+          if (!block->used)
           {
-            eos_debug("recycle the oldest block");
-            mQueueBlocks.push(mMapBlocks.begin()->second);
-            mMapBlocks.erase(mMapBlocks.begin());
+            block->used = true;
+            mReadahead.Hit(waited);
           }
 
-          eos_debug("prefetch new block(2)");
-          if (!PrefetchBlock(offset + mBlocksize, false, timeout))
+          if (sh->GetRespLength() < mBlocksize)
           {
-            eos_warning("failed to send prefetch request(2)");
-            break;
+            // Short block - nothing to prefetch beyond its end
+            mRdAheadEnd = iter->first + sh->GetRespLength();
           }
-        }
-        
-        if (sh->WaitOK())
-        {
-          eos_debug("block in cache, blk_off=%lld, req_off= %lld", iter->first, offset);
-          
+
           if (sh->GetRespLength() == 0)
           {
             // The request got a response but it read 0 bytes
@@ -517,18 +544,19 @@ XrdIo::ReadAsync (XrdSfsFileOffset offset,
             break;
           }
 
-          pBuff = static_cast<char*> (memcpy(pBuff, iter->second->buffer + shift,
+          pBuff = static_cast<char*> (memcpy(pBuff, block->buffer + shift,
                                              read_length));
 
           pBuff += read_length;
           offset += read_length;
           length -= read_length;
           nread += read_length;
+          mReadahead.HitBytes(read_length);
         }
         else
         {
           // Error while prefetching, remove block from map
-          mQueueBlocks.push(iter->second);
+          mQueueBlocks.push(block);
           mMapBlocks.erase(iter);
           eos_err("error=prefetching failed, disable it and remove block from map");
           mDoReadahead = false;
@@ -537,35 +565,17 @@ XrdIo::ReadAsync (XrdSfsFileOffset offset,
       }
       else
       {
-        // Remove all elements from map so that we can align with the new 
-        // requests and prefetch a new block. But first we need to collect any
-        // responses which are in-flight as otherwise these response might
-        // arrive later on, when we are expecting replies for other blocks since
-        // we are recycling the SimpleHandler objects.
-        while (!mMapBlocks.empty())
-        {
-          SimpleHandler* sh = mMapBlocks.begin()->second->handler;
-          
-          if (sh->HasRequest())
-          {
-            // Not interested in the result - discard it 
-            sh->WaitOK();
-          }
-          
-          mQueueBlocks.push(mMapBlocks.begin()->second);
-          mMapBlocks.erase(mMapBlocks.begin());
-        }
+        // The offset is not in the window - drop all prefetched blocks and
+        // restart from the new offset. The responses of blocks still in
+        // flight are collected later when the blocks are reused.
+        DropBlocks(mMapBlocks.end());
+        eos_debug("prefetch new block(1)");
 
-        if (!mQueueBlocks.empty())
+        if (!PrefetchBlock(offset, false, timeout))
         {
-          eos_debug("prefetch new block(1)");
-          
-          if (!PrefetchBlock(offset, false, timeout))
-          {
-            eos_err("error=failed to send prefetch request(1)");
-            mDoReadahead = false;
-            break;
-          }
+          eos_err("error=failed to send prefetch request(1)");
+          mDoReadahead = false;
+          break;
         }
       }
     }
@@ -827,22 +837,8 @@ XrdIo::Close (uint16_t timeout)
     return SFS_ERROR;
   }
 
-  bool async_ok = true;
-
-  if (mDoReadahead)
-  {
-    // Wait for any requests on the fly and then close
-    while (!mMapBlocks.empty())
-    {
-      SimpleHandler* shandler = mMapBlocks.begin()->second->handler;
-      if (shandler->HasRequest())
-      {
-        async_ok = shandler->WaitOK();
-      }
-      delete mMapBlocks.begin()->second;
-      mMapBlocks.erase(mMapBlocks.begin());
-    }
-  }
+  // Wait for any prefetch requests on the fly and then close
+  bool async_ok = FreeBlocks();
   
   // Wait for any async requests before closing
   if (mMetaHandler)
@@ -916,17 +912,13 @@ XrdIo::PrefetchBlock (int64_t offset, bool isWrite, uint16_t timeout)
   eos_debug("try to prefetch with offset: %lli, length: %4u",
             offset, mBlocksize);
 
-  if (!mQueueBlocks.empty())
-  {
-    block = mQueueBlocks.front();
-    mQueueBlocks.pop();
-  }
-  else
+  if (!(block = GetFreeBlock()))
   {
     done = false;
     return done;
   }
 
+  block->used = false;
   block->handler->Update(offset, mBlocksize, isWrite);
   status = mXrdFile->Read(offset,
                           mBlocksize,
@@ -945,12 +937,176 @@ XrdIo::PrefetchBlock (int64_t offset, bool isWrite, uint16_t timeout)
   else
   {
     mMapBlocks.insert(std::make_pair(offset, block));
+    mReadahead.Prefetched();
   }
 
   return done;
 }
 
 
+//------------------------------------------------------------------------------
+// Get a free readahead block
+//------------------------------------------------------------------------------
+ReadaheadBlock*
+XrdIo::GetFreeBlock ()
+{
+  ReadaheadBlock* block = NULL;
+
+  // Collect the dropped blocks whose response arrived in the meantime
+  for (auto it = mCancelledBlocks.begin(); it != mCancelledBlocks.end(); )
+  {
+    if ((*it)->handler->IsDone())
+    {
+      (*it)->handler->WaitOK();
+      mQueueBlocks.push(*it);
+      it = mCancelledBlocks.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  if (!mQueueBlocks.empty())
+  {
+    block = mQueueBlocks.front();
+    mQueueBlocks.pop();
+  }
+  else if (mNumBlocks < mMaxNumBlocks)
+  {
+    block = new ReadaheadBlock(mBlocksize);
+    mNumBlocks++;
+  }
+  else if (!mCancelledBlocks.empty())
+  {
+    block = mCancelledBlocks.front();
+    mCancelledBlocks.pop_front();
+    block->handler->WaitOK();
+  }
+
+  return block;
+}
+
+
+//------------------------------------------------------------------------------
+// Remove blocks from the map of prefetched blocks
+//------------------------------------------------------------------------------
+void
+XrdIo::DropBlocks (PrefetchMap::iterator end)
+{
+  uint32_t wasted = 0;
+
+  while (mMapBlocks.begin() != end)
+  {
+    ReadaheadBlock* block = mMapBlocks.begin()->second;
+    SimpleHandler* sh = block->handler;
+    mMapBlocks.erase(mMapBlocks.begin());
+
+    if (!block->used)
+      wasted++;
+
+    if (sh->HasRequest() && !sh->IsDone())
+    {
+      // The response still has to arrive, the block is reused afterwards
+      mCancelledBlocks.push_back(block);
+    }
+    else
+    {
+      if (sh->HasRequest())
+        sh->WaitOK();
+
+      mQueueBlocks.push(block);
+    }
+  }
+
+  mReadahead.Waste(wasted);
+}
+
+
+//------------------------------------------------------------------------------
+// Prefetch the blocks of the readahead window following a block
+//------------------------------------------------------------------------------
+void
+XrdIo::FillWindow (uint64_t offset, uint16_t timeout)
+{
+  uint64_t step = mReadahead.GetStep();
+
+  for (uint32_t i = 1; i <= mReadahead.GetWindow(); i++)
+  {
+    uint64_t block_offset = offset + i * step;
+
+    if (block_offset >= mRdAheadEnd)
+      break;
+
+    if (mMapBlocks.count(block_offset))
+      continue;
+
+    eos_debug("prefetch new block(2)");
+
+    if (!PrefetchBlock(block_offset, false, timeout))
+    {
+      eos_debug("no block available for prefetching offset=%llu",
+                (unsigned long long) block_offset);
+      break;
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Wait for all readahead blocks in flight and free them
+//------------------------------------------------------------------------------
+bool
+XrdIo::FreeBlocks ()
+{
+  bool ok = true;
+  uint32_t wasted = 0;
+  XrdSysMutexHelper lock(mPrefetchMutex);
+
+  while (!mMapBlocks.empty())
+  {
+    ReadaheadBlock* block = mMapBlocks.begin()->second;
+
+    if (block->handler->HasRequest())
+      ok = block->handler->WaitOK() && ok;
+
+    if (!block->used)
+      wasted++;
+
+    delete block;
+    mMapBlocks.erase(mMapBlocks.begin());
+    mNumBlocks--;
+  }
+
+  // Responses to dropped blocks are not of interest but must arrive before
+  // the blocks are freed
+  while (!mCancelledBlocks.empty())
+  {
+    ReadaheadBlock* block = mCancelledBlocks.front();
+    mCancelledBlocks.pop_front();
+    block->handler->WaitOK();
+    delete block;
+    mNumBlocks--;
+  }
+
+  mReadahead.Waste(wasted);
+  return ok;
+}
+
+
+//------------------------------------------------------------------------------
+// Add the readahead statistics of the file
+//------------------------------------------------------------------------------
+void
+XrdIo::AddReadaheadStats (ReadaheadStats& stats)
+{
+  XrdSysMutexHelper lock(mPrefetchMutex);
+
+  if (mDoReadahead || mReadahead.GetStats().mPrefetched)
+    stats.Add(mReadahead.GetStats());
+}
+
+
 //------------------------------------------------------------------------------
 // Get pointer to async meta handler object 
 //------------------------------------------------------------------------------
@@ -28,10 +28,14 @@
 /*----------------------------------------------------------------------------*/
 #include "fst/io/FileIo.hh"
 #include "fst/io/SimpleHandler.hh"
+#include "fst/io/ReadaheadController.hh"
+#include "common/BufferPool.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdCl/XrdClFile.hh"
 #include "XrdCl/XrdClXRootDResponses.hh"
 /*----------------------------------------------------------------------------*/
+#include <list>
+/*----------------------------------------------------------------------------*/
 
 EOSFSTNAMESPACE_BEGIN
 
@@ -55,9 +59,11 @@ struct ReadaheadBlock
   //! @param blocksize the size of the readahead
   //!
   //----------------------------------------------------------------------------
-  ReadaheadBlock(uint64_t blocksize = sDefaultBlocksize)
+  ReadaheadBlock(uint64_t blocksize = sDefaultBlocksize):
+    size(blocksize),
+    used(false)
   {
-    buffer = new char[blocksize];
+    buffer = eos::common::BufferPool::Instance().Allocate(blocksize);
     handler = new SimpleHandler();
   }
 
@@ -81,10 +87,12 @@ struct ReadaheadBlock
   //----------------------------------------------------------------------------
   virtual ~ReadaheadBlock()
   {
-    delete[] buffer;
+    eos::common::BufferPool::Instance().Release(buffer, size);
     delete handler;
   };
 
+  uint64_t size; ///< size of the buffer
+  bool used; ///< mark if a read was served from the block
   char* buffer; ///< pointer to where the data is read
   SimpleHandler* handler; ///< async handler for the requests
 };
@@ -135,7 +143,9 @@ class XrdIo : public FileIo
   friend class AsyncIoOpenHandler;
 public:
 
-  static const uint32_t sNumRdAheadBlocks; ///< no. of blocks used for readahead
+  static const uint32_t sNumRdAheadBlocks; ///< no. of blocks allocated at open
+  static const uint32_t sMaxRdAheadBlocks; ///< default max. readahead window
+  static const uint64_t sRdAheadBudget; ///< default readahead memory of a file
 
   //----------------------------------------------------------------------------
   //! Constructor
@@ -351,6 +361,15 @@ public:
   //--------------------------------------------------------------------------
   virtual void* GetAsyncHandler ();
 
+
+  //--------------------------------------------------------------------------
+  //! Add the readahead statistics of the file
+  //!
+  //! @param stats statistics to add to
+  //!
+  //--------------------------------------------------------------------------
+  virtual void AddReadaheadStats (ReadaheadStats& stats);
+
 private:
 
   bool mDoReadahead; ///< mark if readahead is enabled
@@ -360,7 +379,62 @@ private:
   AsyncMetaHandler* mMetaHandler; ///< async requests meta handler
   PrefetchMap mMapBlocks; ///< map of block read/prefetched
   std::queue<ReadaheadBlock*> mQueueBlocks; ///< queue containing available blocks
+  std::list<ReadaheadBlock*> mCancelledBlocks; ///< dropped blocks in flight
+  uint32_t mNumBlocks; ///< number of readahead blocks allocated
+  uint32_t mMaxRdAheadBlocks; ///< max. readahead window of the file
+  uint32_t mMaxNumBlocks; ///< max. blocks allowed by the readahead budget
+  uint64_t mRdAheadEnd; ///< offset from which prefetching is useless (EOF)
+  ReadaheadController mReadahead; ///< decides how far to read ahead
   XrdSysMutex mPrefetchMutex; ///< mutex to serialise the prefetch step
+
+
+  //--------------------------------------------------------------------------
+  //! Enable the readahead if requested in the opaque information
+  //!
+  //! @param opaque open opaque information
+  //!
+  //--------------------------------------------------------------------------
+  void SetupReadahead (XrdOucEnv& opaque);
+
+
+  //--------------------------------------------------------------------------
+  //! Get a free readahead block, recycling dropped blocks whose response
+  //! arrived or allocating a new one if the readahead budget allows it
+  //!
+  //! @return readahead block or NULL if none is available
+  //!
+  //--------------------------------------------------------------------------
+  ReadaheadBlock* GetFreeBlock ();
+
+
+  //--------------------------------------------------------------------------
+  //! Remove blocks from the map of prefetched blocks without waiting for
+  //! the ones still in flight. Blocks which were never used are accounted
+  //! as wasted.
+  //!
+  //! @param end first block to keep
+  //!
+  //--------------------------------------------------------------------------
+  void DropBlocks (PrefetchMap::iterator end);
+
+
+  //--------------------------------------------------------------------------
+  //! Prefetch the blocks of the readahead window following a block
+  //!
+  //! @param offset offset of the current block
+  //! @param timeout timeout value
+  //!
+  //--------------------------------------------------------------------------
+  void FillWindow (uint64_t offset, uint16_t timeout);
+
+
+  //--------------------------------------------------------------------------
+  //! Wait for all readahead blocks in flight and free them
+  //!
+  //! @return true if all prefetch requests succeeded, otherwise false
+  //!
+  //--------------------------------------------------------------------------
+  bool FreeBlocks ();
   
   //--------------------------------------------------------------------------
   //! Method used to prefetch the next block using the readahead mechanism
@@ -303,6 +303,18 @@ public:
   //----------------------------------------------------------------------------
   virtual int Stat (struct stat* buf) = 0;
 
+
+  //----------------------------------------------------------------------------
+  //! Add the readahead statistics of the files used by the layout
+  //!
+  //! @param stats statistics to add to
+  //!
+  //----------------------------------------------------------------------------
+  virtual void AddReadaheadStats (ReadaheadStats& stats)
+  {
+    // empty
+  }
+
   
 protected:
 
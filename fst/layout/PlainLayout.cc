@@ -293,6 +293,15 @@ PlainLayout::Stat (struct stat* buf)
   return mPlainFile->Stat(buf, mTimeout);
 }
 
+//------------------------------------------------------------------------------
+// Add the readahead statistics of the files used by the layout
+//------------------------------------------------------------------------------
+void
+PlainLayout::AddReadaheadStats (ReadaheadStats& stats)
+{
+  mPlainFile->AddReadaheadStats(stats);
+}
+
 //------------------------------------------------------------------------------
 // Close file
 //------------------------------------------------------------------------------
@@ -248,6 +248,15 @@ public:
   virtual int Stat (struct stat* buf);
 
 
+  //----------------------------------------------------------------------------
+  //! Add the readahead statistics of the files used by the layout
+  //!
+  //! @param stats statistics to add to
+  //!
+  //----------------------------------------------------------------------------
+  virtual void AddReadaheadStats (ReadaheadStats& stats);
+
+
   //----------------------------------------------------------------------------
   //! Close file
   //!
@@ -22,20 +22,26 @@
  ************************************************************************/
 
 /*----------------------------------------------------------------------------*/
+#include <algorithm>
 #include <cmath>
 #include <string>
 #include <utility>
 #include <stdint.h>
 /*----------------------------------------------------------------------------*/
 #include "common/Timing.hh"
+#include "common/BufferPool.hh"
 #include "fst/layout/RaidMetaLayout.hh"
 #include "fst/io/AsyncMetaHandler.hh"
+#include "fst/io/XrdIo.hh"
 /*----------------------------------------------------------------------------*/
 
 #ifdef __APPLE__
 #define EREMOTEIO 121
 #endif
 
+//! Maximum number of chunks in one vector read request sent to a stripe
+#define RAID_READV_MAX_CHUNKS 1024
+
 EOSFSTNAMESPACE_BEGIN
 
 //------------------------------------------------------------------------------
@@ -98,7 +104,7 @@ RaidMetaLayout::~RaidMetaLayout ()
  {
    char* ptr_char = mDataBlocks.back();
    mDataBlocks.pop_back();
-   delete[] ptr_char;
+   eos::common::BufferPool::Instance().Release(ptr_char, mStripeWidth);
  }
 }
 
@@ -169,6 +175,9 @@ RaidMetaLayout::Open (const std::string& path,
  enhanced_opaque += "&fst.readahead=true";
  enhanced_opaque += "&fst.blocksize=";
  enhanced_opaque += static_cast<int> (mStripeWidth);
+ // The readahead budget of the file is shared by all stripes
+ enhanced_opaque += "&fst.readahead.budget=";
+ enhanced_opaque += static_cast<int> (XrdIo::sRdAheadBudget / mNbTotalFiles);
 
  // Do open on local stripe - force it in RDWR mode if store recovery enabled
  mLocalPath = path;
@@ -232,7 +241,8 @@ RaidMetaLayout::Open (const std::string& path,
    // Allocate memory for blocks - used only by the entry server
    for (unsigned int i = 0; i < mNbTotalBlocks; i++)
    {
-     mDataBlocks.push_back(new char[mStripeWidth]);
+     mDataBlocks.push_back(
+       eos::common::BufferPool::Instance().Allocate(mStripeWidth));
    }
    
    // Assign stripe urls and check minimal requirements
@@ -424,7 +434,8 @@ RaidMetaLayout::OpenPio (std::vector<std::string> stripeUrls,
  // Allocate memory for blocks - done only once
  for (unsigned int i = 0; i < mNbTotalBlocks; i++)
  {
-   mDataBlocks.push_back(new char[mStripeWidth]);
+   mDataBlocks.push_back(
+     eos::common::BufferPool::Instance().Allocate(mStripeWidth));
  }
 
  //!!!!
@@ -454,6 +465,8 @@ RaidMetaLayout::OpenPio (std::vector<std::string> stripeUrls,
    openOpaque += "&fst.readahead=true";
    openOpaque += "&fst.blocksize=";
    openOpaque += static_cast<int> (mStripeWidth);
+   openOpaque += "&fst.readahead.budget=";
+   openOpaque += static_cast<int> (XrdIo::sRdAheadBudget / mNbTotalFiles);
 
    ret = file->Open(stripe_urls[i], flags, mode, openOpaque.c_str());
       
@@ -683,7 +696,8 @@ RaidMetaLayout::Read (XrdSfsFileOffset offset, char* buffer,
        len = mSizeGroup;
      }
 
-     char* recover_block = new char[mStripeWidth];
+     char* recover_block =
+       eos::common::BufferPool::Instance().Allocate(mStripeWidth);
 
      while ((uint32_t)len >= mStripeWidth)
      {
@@ -696,6 +710,8 @@ RaidMetaLayout::Read (XrdSfsFileOffset offset, char* buffer,
          if (!RecoverPieces(all_errs))
          {
            eos_err("failed recovery of stripe");
+           eos::common::BufferPool::Instance().Release(recover_block,
+                                                       mStripeWidth);
            return SFS_ERROR;
          }
          else
@@ -708,7 +724,7 @@ RaidMetaLayout::Read (XrdSfsFileOffset offset, char* buffer,
        offset += mSizeGroup;
      }
 
-     delete[] recover_block;
+     eos::common::BufferPool::Instance().Release(recover_block, mStripeWidth);
    }
    else
    {
@@ -865,23 +881,44 @@ RaidMetaLayout::ReadV (XrdCl::ChunkList& chunkList, uint32_t len)
     // Entry server splits requests per stripe returning the relative position of
     // each chunks inside the stripe file including the header offset
     bool do_recovery = false;
-    bool got_error = false;
     uint32_t stripe_id;
     uint32_t physical_id;
     std::vector<XrdCl::ChunkList> stripe_chunks = SplitReadV(chunkList, mSizeHeader);
 
+    // All requests to all stripes are sent before waiting for any of them
     for (stripe_id = 0; stripe_id < stripe_chunks.size(); ++stripe_id)
     {
+      bool got_error = false;
       physical_id = mapLP[stripe_id];
 
       if (mStripe[physical_id])
       {
+        XrdCl::ChunkList& chunks = stripe_chunks[stripe_id];
         eos_debug("readv stripe=%u, read_count=%i physical_id=%u ",
-                  stripe_id, stripe_chunks[stripe_id].size(), physical_id);
-        nread = mStripe[physical_id]->ReadVAsync(stripe_chunks[stripe_id], mTimeout);
-      
-        if (nread == SFS_ERROR)
-          got_error = true;
+                  stripe_id, chunks.size(), physical_id);
+
+        if (chunks.size() <= RAID_READV_MAX_CHUNKS)
+        {
+          nread = mStripe[physical_id]->ReadVAsync(chunks, mTimeout);
+
+          if (nread == SFS_ERROR)
+            got_error = true;
+        }
+        else
+        {
+          // Split into requests the stripe server accepts, each one is read
+          // in parallel into the final buffers
+          for (size_t first = 0; (first < chunks.size()) && !got_error;
+               first += RAID_READV_MAX_CHUNKS)
+          {
+            size_t last = std::min(first + RAID_READV_MAX_CHUNKS, chunks.size());
+            XrdCl::ChunkList batch(chunks.begin() + first, chunks.begin() + last);
+            nread = mStripe[physical_id]->ReadVAsync(batch, mTimeout);
+
+            if (nread == SFS_ERROR)
+              got_error = true;
+          }
+        }
       }    
       else
       {
@@ -1478,6 +1515,20 @@ RaidMetaLayout::Remove ()
 }
 
 
+//------------------------------------------------------------------------------
+// Add the readahead statistics of the files used by the layout
+//------------------------------------------------------------------------------
+void
+RaidMetaLayout::AddReadaheadStats (ReadaheadStats& stats)
+{
+ for (unsigned int i = 0; i < mStripe.size(); i++)
+ {
+   if (mStripe[i])
+     mStripe[i]->AddReadaheadStats(stats);
+ }
+}
+
+
 //------------------------------------------------------------------------------
 // Get stat about file
 //------------------------------------------------------------------------------
@@ -348,7 +348,9 @@ ReplicaParLayout::Write (XrdSfsFileOffset offset,
 {
   int64_t rc;
 
-  for (unsigned int i = 0; i < mReplicaFile.size(); i++)
+  // Dispatch the remote replicas first so that their transfers overlap with
+  // the write of the local replica which has index 0 on the head server
+  for (int i = (int) mReplicaFile.size() - 1; i >= 0; i--)
   {
     rc = mReplicaFile[i]->WriteAsync(offset, buffer, length, mTimeout);
 
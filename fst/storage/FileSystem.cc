@@ -69,9 +69,13 @@ FileSystem::FileSystem (const char* queuepath,
 /*----------------------------------------------------------------------------*/
 FileSystem::~FileSystem ()
 {
-  if (scanDir)
   {
-    delete scanDir;
+    XrdSysMutexHelper lock(scanDirMutex);
+    if (scanDir)
+    {
+      delete scanDir;
+      scanDir = 0;
+    }
   }
 
   // ----------------------------------------------------------------------------
@@ -297,6 +301,7 @@ FileSystem::SyncTransactions (const char* manager)
 void
 FileSystem::RunScanner (Load* fstLoad, time_t interval)
 {
+  XrdSysMutexHelper lock(scanDirMutex);
   if (scanDir)
   {
     delete scanDir;
@@ -308,6 +313,19 @@ FileSystem::RunScanner (Load* fstLoad, time_t interval)
            (unsigned long) interval);
 }
 
+/*----------------------------------------------------------------------------*/
+bool
+FileSystem::GetScanStats (ScanDir::ScanStats& stats)
+{
+  XrdSysMutexHelper lock(scanDirMutex);
+  if (!scanDir)
+  {
+    return false;
+  }
+  scanDir->GetStats(stats);
+  return true;
+}
+
 /*----------------------------------------------------------------------------*/
 bool
 FileSystem::OpenTransaction (unsigned long long fid)
@@ -28,6 +28,7 @@
 #include "fst/ScanDir.hh"
 #include "fst/txqueue/TransferQueue.hh"
 #include "fst/txqueue/TransferMultiplexer.hh"
+#include "fst/FmdHandler.hh"
 #include "common/Logging.hh"
 #include "common/Statfs.hh"
 #include "common/FileSystem.hh"
@@ -53,6 +54,7 @@ private:
 
   eos::common::Statfs* statFs; // the owner of the object is a global hash in eos::common::Statfs - this are just references
   eos::fst::ScanDir* scanDir; // the class scanning checksum on a filesystem
+  XrdSysMutex scanDirMutex; // protecting scanDir against the publisher
   unsigned long last_blocks_free;
   time_t last_status_broadcast;
   eos::common::FileSystem::fsstatus_t mLocalBootStatus; // the internal boot state not stored in the shared hash
@@ -69,6 +71,8 @@ private:
   long long seqBandwidth; // measurement of sequential bandwidth
   int IOPS; // measurement of IOPS
 
+  ResyncProgress mBootProgress; // progress of the resync during the boot
+
 public:
   FileSystem (const char* queuepath, const char* queue, XrdMqSharedObjectManager* som);
 
@@ -83,6 +87,7 @@ public:
   bool SyncTransactions (const char* manager);
 
   void RunScanner (Load* fstLoad, time_t interval);
+  bool GetScanStats (ScanDir::ScanStats& stats);
 
   std::string
   GetPath ()
@@ -171,6 +176,12 @@ public:
 
   void IoPing();
 
+  ResyncProgress&
+  GetBootProgress ()
+  {
+    return mBootProgress;
+  }
+
   long long getSeqBandwidth() {return seqBandwidth;}
   int getIOPS() {return IOPS;}
 };
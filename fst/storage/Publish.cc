@@ -24,6 +24,8 @@
 /*----------------------------------------------------------------------------*/
 #include "fst/storage/Storage.hh"
 #include "fst/XrdFstOfs.hh"
+#include "fst/io/ReadVEngine.hh"
+#include "common/BufferPool.hh"
 #include "common/LinuxStat.hh"
 #include "common/ShellCmd.hh"
 /*----------------------------------------------------------------------------*/
@@ -297,6 +299,9 @@ Storage::Publish ()
 	  success &= fileSystemsVector[i]->SetLongLong("stat.usedfiles", used_files);
 
           success &= fileSystemsVector[i]->SetString("stat.boot", fileSystemsVector[i]->GetStatusAsString(fileSystemsVector[i]->GetStatus()));
+          // copy out the resync progress of the last boot
+          success &= fileSystemsVector[i]->SetLongLong("stat.boot.diskfiles", fileSystemsVector[i]->GetBootProgress().mDiskFiles);
+          success &= fileSystemsVector[i]->SetLongLong("stat.boot.mgmfiles", fileSystemsVector[i]->GetBootProgress().mMgmFiles);
           success &= fileSystemsVector[i]->SetString("stat.geotag", lNodeGeoTag.c_str());
           struct timeval tvfs;
           gettimeofday(&tvfs, &tz);
@@ -309,6 +314,28 @@ Storage::Publish ()
           success &= fileSystemsVector[i]->SetLongLong("stat.disk.iops", fileSystemsVector[i]->getIOPS());
           success &= fileSystemsVector[i]->SetDouble("stat.disk.bw", fileSystemsVector[i]->getSeqBandwidth()); // in MB
 
+          // copy out the scanner progress and the budget of its disk
+          eos::fst::ScanDir::ScanStats scanStats;
+          if (fileSystemsVector[i]->GetScanStats(scanStats))
+          {
+            success &= fileSystemsVector[i]->SetString("stat.scan.device", scanStats.device.c_str());
+            success &= fileSystemsVector[i]->SetDouble("stat.scan.ratemb", scanStats.rate);
+            success &= fileSystemsVector[i]->SetDouble("stat.scan.budgetmb", scanStats.budget);
+            success &= fileSystemsVector[i]->SetDouble("stat.scan.latencyms", scanStats.latency);
+            success &= fileSystemsVector[i]->SetDouble("stat.scan.progress", scanStats.progress);
+            success &= fileSystemsVector[i]->SetLongLong("stat.scan.files", scanStats.files);
+            success &= fileSystemsVector[i]->SetLongLong("stat.scan.bytes", scanStats.bytes);
+          }
+
+          // copy out the vector read latencies since the last publishing
+          eos::fst::ReadVEngine::Stats readvStats;
+          eos::fst::ReadVEngine::Instance().GetStats(fsid, readvStats);
+          success &= fileSystemsVector[i]->SetLongLong("stat.readv.count", readvStats.mCount);
+          success &= fileSystemsVector[i]->SetDouble("stat.readv.avgus", readvStats.mAvg);
+          success &= fileSystemsVector[i]->SetDouble("stat.readv.p50us", readvStats.mP50);
+          success &= fileSystemsVector[i]->SetDouble("stat.readv.p90us", readvStats.mP90);
+          success &= fileSystemsVector[i]->SetDouble("stat.readv.p99us", readvStats.mP99);
+
 	  {
             // we have to set something which is not empty to update the value
             if (!r_open_hotfiles.length())
@@ -377,6 +404,13 @@ Storage::Publish ()
             hash->Set("stat.sys.uptime", publish_uptime.c_str());
             hash->Set("stat.sys.sockets", publish_sockets.c_str());
             hash->Set("stat.sys.eos.start", eos::fst::Config::gConfig.StartDate.c_str());
+            eos::common::BufferPool::Stats poolStats;
+            eos::common::BufferPool::Instance().GetStats(poolStats);
+            hash->SetLongLong("stat.sys.bufferpool.hits", poolStats.mHits);
+            hash->SetLongLong("stat.sys.bufferpool.misses", poolStats.mMisses);
+            hash->SetLongLong("stat.sys.bufferpool.pinned", poolStats.mPinned);
+            hash->SetLongLong("stat.sys.bufferpool.cached", poolStats.mCached);
+            hash->SetLongLong("stat.sys.bufferpool.max", poolStats.mMaxBytes);
 	    hash->Set("stat.geotag", lNodeGeoTag.c_str());
 	    hash->Set("debug.state", LC_STRING(eos::common::Logging::GetPriorityString(eos::common::Logging::gPriorityLevel)));
           }
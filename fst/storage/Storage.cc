@@ -36,6 +36,7 @@
 /*----------------------------------------------------------------------------*/
 #include <google/dense_hash_map>
 #include <math.h>
+#include <algorithm>
 /*----------------------------------------------------------------------------*/
 #include "fst/XrdFstOss.hh"
 #include "XrdSys/XrdSysTimer.hh"
@@ -46,7 +47,10 @@ extern eos::fst::XrdFstOss *XrdOfsOss;
 EOSFSTNAMESPACE_BEGIN
 
 /*----------------------------------------------------------------------------*/
-Storage::Storage (const char* metadirectory)
+Storage::Storage (const char* metadirectory) :
+  // at least one dump slot, otherwise the boots wait forever
+  MgmDumpSlots(std::max(1, getenv("EOS_FST_BOOT_MAX_DUMPS") ?
+                        atoi(getenv("EOS_FST_BOOT_MAX_DUMPS")) : 4))
 {
   SetLogId("FstOfsStorage");
 
@@ -395,6 +399,10 @@ Storage::Boot (FileSystem *fs)
     return;
   }
 
+  ResyncProgress& progress = fs->GetBootProgress();
+  progress.mDiskFiles = 0;
+  progress.mMgmFiles = 0;
+
   bool is_dirty = gFmdDbMapHandler.IsDirty(fsid);
   bool fast_boot = (!getenv("EOS_FST_NO_FAST_BOOT")) || (strcmp(getenv("EOS_FST_NO_FAST_BOOT"),"1"));
   bool resyncmgm = ( (is_dirty) ||
@@ -402,24 +410,72 @@ Storage::Boot (FileSystem *fs)
   bool resyncdisk = ( (is_dirty) ||
                      (fs->GetLongLong("bootcheck") >= eos::common::FileSystem::kBootForced));
 
+  // the mgm dump is downloaded while the disk is resynced
+  MgmDumpInfo dumpinfo;
+  dumpinfo.storage = 0;
+  dumpinfo.ok = false;
+  pthread_t dumptid;
+  bool dumping = false;
+
+  if (resyncmgm && resyncdisk)
+  {
+    dumpinfo.storage = this;
+    dumpinfo.fsid = fsid;
+    dumpinfo.manager = manager;
+    if (XrdSysThread::Run(&dumptid, Storage::StartMgmDump,
+                          static_cast<void *> (&dumpinfo), XRDSYSTHREAD_HOLD,
+                          "MgmDump"))
+    {
+      eos_warning("msg=\"cannot start mgm dump thread - downloading after the disk synchronisation\" fsid=%lu",
+                  (unsigned long) fsid);
+      dumpinfo.storage = 0;
+    }
+    else
+    {
+      dumping = true;
+    }
+  }
+
+  auto wait_dump = [&]()
+  {
+    if (dumping)
+    {
+      XrdSysThread::Join(dumptid, NULL);
+      dumping = false;
+    }
+  };
+
+  auto drop_dump = [&]()
+  {
+    wait_dump();
+    if (dumpinfo.ok)
+    {
+      unlink(dumpinfo.dumpfile.c_str());
+      dumpinfo.ok = false;
+    }
+  };
+
   eos_info("msg=\"start disk synchronisation\"");
   // resync the DB 
   gFmdDbMapHandler.StayDirty(fsid, true); // indicate the flag to keep the DP dirty
 
   if (resyncdisk)
   {
+    fs->SetString("stat.boot.phase", "resync-disk");
     if (resyncmgm)
     {
       // clean-up the DB
       if (!gFmdDbMapHandler.ResetDB(fsid))
       {
+        drop_dump();
         fs->SetStatus(eos::common::FileSystem::kBootFailure);
         fs->SetError(EFAULT, "cannot clean SQLITE DB on local disk");
         return;
       }
     }
-    if (!gFmdDbMapHandler.ResyncAllDisk(fs->GetPath().c_str(), fsid, resyncmgm))
+    if (!gFmdDbMapHandler.ResyncAllDisk(fs->GetPath().c_str(), fsid, resyncmgm, &progress))
     {
+      drop_dump();
       fs->SetStatus(eos::common::FileSystem::kBootFailure);
       fs->SetError(EFAULT, "cannot resync the SQLITE DB from local disk");
       return;
@@ -442,8 +498,23 @@ Storage::Boot (FileSystem *fs)
   if (resyncmgm)
   {
     eos_info("msg=\"start mgm synchronisation\" fsid=%lu", (unsigned long) fsid);
-    // resync the MGM meta data
-    if (!gFmdDbMapHandler.ResyncAllMgm(fsid, manager.c_str()))
+    fs->SetString("stat.boot.phase", "resync-mgm");
+    bool synced = false;
+
+    if (dumpinfo.storage)
+    {
+      wait_dump();
+      synced = (dumpinfo.ok &&
+                gFmdDbMapHandler.ResyncAllFromDump(fsid, dumpinfo.dumpfile.c_str(), &progress));
+      drop_dump();
+    }
+    else
+    {
+      // resync the MGM meta data
+      synced = gFmdDbMapHandler.ResyncAllMgm(fsid, manager.c_str(), &progress);
+    }
+
+    if (!synced)
     {
       fs->SetStatus(eos::common::FileSystem::kBootFailure);
       fs->SetError(EFAULT, "cannot resync the mgm meta data");
@@ -500,13 +571,17 @@ Storage::Boot (FileSystem *fs)
   }
 
   fs->SetTransactionDirectory(transactionDirectory.c_str());
+  fs->SetString("stat.boot.phase", "transactions");
   if (fs->SyncTransactions(manager.c_str()))
     fs->CleanTransactions();
   fs->SetLongLong("stat.bootdonetime", (unsigned long long) time(NULL));
   fs->IoPing();
   fs->SetStatus(eos::common::FileSystem::kBooted);
+  fs->SetString("stat.boot.phase", "done");
   fs->SetError(0, "");
-  eos_info("msg=\"finished boot procedure\" fsid=%lu", (unsigned long) fsid);
+  eos_info("msg=\"finished boot procedure\" fsid=%lu diskfiles=%llu mgmfiles=%llu",
+           (unsigned long) fsid, (unsigned long long) progress.mDiskFiles,
+           (unsigned long long) progress.mMgmFiles);
 
   return;
 }
@@ -881,6 +956,18 @@ Storage::StartBoot (void * pp)
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+void*
+Storage::StartMgmDump (void * pp)
+{
+  MgmDumpInfo* info = (MgmDumpInfo*) pp;
+  // don't let all booting filesystems stream their dump from the mgm at once
+  info->storage->MgmDumpSlots.Wait();
+  info->ok = gFmdDbMapHandler.FetchMgmDump(info->fsid, info->manager.c_str(), info->dumpfile);
+  info->storage->MgmDumpSlots.Post();
+  return 0;
+}
+
 /*----------------------------------------------------------------------------*/
 bool
 Storage::RunBootThread (FileSystem* fs)
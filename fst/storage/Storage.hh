@@ -98,6 +98,19 @@ public:
 
   static void* StartBoot (void* pp);
 
+  struct MgmDumpInfo
+  {
+    Storage* storage;
+    eos::common::FileSystem::fsid_t fsid;
+    std::string manager;
+    std::string dumpfile;
+    bool ok;
+  };
+
+  static void* StartMgmDump (void* pp);
+
+  XrdSysSemaphore MgmDumpSlots; // limits the mgm dumps downloaded at the same time
+
   XrdSysMutex BootSetMutex; // Mutex protecting the boot set
   std::set<eos::common::FileSystem::fsid_t> BootSet; // set containing the filesystems currently booting
   bool RunBootThread (FileSystem* fs);
@@ -0,0 +1,189 @@
+//------------------------------------------------------------------------------
+// File: BufferPoolTest.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "BufferPoolTest.hh"
+#include "common/BufferPool.hh"
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <vector>
+#include <pthread.h>
+/*----------------------------------------------------------------------------*/
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BufferPoolTest);
+
+using eos::common::BufferPool;
+
+static const size_t sMB = 1024 * 1024;
+
+//------------------------------------------------------------------------------
+// Thread filling its cache and keeping it until it is told to exit
+//------------------------------------------------------------------------------
+struct CacheThread
+{
+  BufferPool* mPool;
+  size_t mNumBuffers;
+  size_t mSize;
+  XrdSysSemaphore mFilled;
+  XrdSysSemaphore mExit;
+
+  CacheThread(): mPool(0), mNumBuffers(0), mSize(0), mFilled(0), mExit(0) {}
+};
+
+static void*
+FillCache(void* arg)
+{
+  CacheThread* ct = static_cast<CacheThread*>(arg);
+  std::vector<char*> buffers;
+
+  for (size_t i = 0; i < ct->mNumBuffers; i++)
+    buffers.push_back(ct->mPool->Allocate(ct->mSize));
+
+  for (size_t i = 0; i < buffers.size(); i++)
+    ct->mPool->Release(buffers[i], ct->mSize);
+
+  ct->mFilled.Post();
+  ct->mExit.Wait();
+  // the cache might have been drained meanwhile, allocating has to work
+  char* buffer = ct->mPool->Allocate(ct->mSize);
+  buffer[0] = 1;
+  ct->mPool->Release(buffer, ct->mSize);
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Thread cache bound
+//------------------------------------------------------------------------------
+void
+BufferPoolTest::ThreadCacheBoundTest()
+{
+  BufferPool pool(64 * sMB);
+  std::vector<char*> buffers;
+
+  for (int i = 0; i < 10; i++)
+    buffers.push_back(pool.Allocate(sMB));
+
+  for (size_t i = 0; i < buffers.size(); i++)
+    pool.Release(buffers[i], sMB);
+
+  BufferPool::Stats stats;
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)(10 * sMB), (uint64_t) stats.mPinned);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)(10 * sMB), (uint64_t) stats.mCached);
+  // the free lists give back what is not in the thread cache
+  pool.Trim(BufferPool::sThreadCacheBytes);
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) BufferPool::sThreadCacheBytes,
+                       (uint64_t) stats.mPinned);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) BufferPool::sThreadCacheBytes,
+                       (uint64_t) stats.mCached);
+}
+
+//------------------------------------------------------------------------------
+// Trim of the caches of other threads
+//------------------------------------------------------------------------------
+void
+BufferPoolTest::TrimThreadCachesTest()
+{
+  BufferPool pool(64 * sMB);
+  CacheThread ct[4];
+  pthread_t tid[4];
+
+  for (int i = 0; i < 4; i++)
+  {
+    ct[i].mPool = &pool;
+    ct[i].mNumBuffers = 4;
+    ct[i].mSize = sMB;
+    CPPUNIT_ASSERT(!pthread_create(&tid[i], 0, FillCache, &ct[i]));
+  }
+
+  for (int i = 0; i < 4; i++)
+    ct[i].mFilled.Wait();
+
+  BufferPool::Stats stats;
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)(16 * sMB), (uint64_t) stats.mPinned);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)(16 * sMB), (uint64_t) stats.mCached);
+  pool.Trim(0);
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 0, (uint64_t) stats.mPinned);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 0, (uint64_t) stats.mCached);
+
+  for (int i = 0; i < 4; i++)
+  {
+    ct[i].mExit.Post();
+    pthread_join(tid[i], 0);
+  }
+
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) stats.mCached, (uint64_t) stats.mPinned);
+}
+
+//------------------------------------------------------------------------------
+// Memory bound of the pool
+//------------------------------------------------------------------------------
+void
+BufferPoolTest::MaxBytesTest()
+{
+  BufferPool pool(8 * sMB);
+  CacheThread ct;
+  pthread_t tid;
+  ct.mPool = &pool;
+  ct.mNumBuffers = 16;
+  ct.mSize = 256 * 1024;
+  CPPUNIT_ASSERT(!pthread_create(&tid, 0, FillCache, &ct));
+  ct.mFilled.Wait();
+  BufferPool::Stats stats;
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)(4 * sMB), (uint64_t) stats.mPinned);
+  // the cached buffers of the other thread make room for the new ones
+  char* in_use[3];
+
+  for (int i = 0; i < 3; i++)
+    in_use[i] = pool.Allocate(2 * sMB);
+
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT(stats.mPinned <= 8 * sMB);
+  // buffers in use can not be dropped, the pool grows beyond the bound by them
+  char* extra = pool.Allocate(4 * sMB);
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 0, (uint64_t) stats.mCached);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)(10 * sMB), (uint64_t) stats.mPinned);
+  // releasing while above the bound unmaps
+  pool.Release(extra, 4 * sMB);
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)(6 * sMB), (uint64_t) stats.mPinned);
+
+  for (int i = 0; i < 3; i++)
+    pool.Release(in_use[i], 2 * sMB);
+
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT(stats.mPinned <= 8 * sMB);
+  pool.SetMaxBytes(sMB);
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT(stats.mPinned <= sMB);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) sMB, (uint64_t) stats.mMaxBytes);
+  ct.mExit.Post();
+  pthread_join(tid, 0);
+  pool.GetStats(stats);
+  CPPUNIT_ASSERT(stats.mPinned <= sMB);
+}
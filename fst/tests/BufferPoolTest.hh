@@ -0,0 +1,58 @@
+//------------------------------------------------------------------------------
+//! @file BufferPoolTest.hh
+//! @brief Unit tests of the memory bound of the buffer pool
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#ifndef __EOSFSTTEST_BUFFERPOOLTEST_HH__
+#define __EOSFSTTEST_BUFFERPOOLTEST_HH__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+//------------------------------------------------------------------------------
+//! Declaration of BufferPoolTest class
+//------------------------------------------------------------------------------
+class BufferPoolTest: public CppUnit::TestCase
+{
+  CPPUNIT_TEST_SUITE(BufferPoolTest);
+    CPPUNIT_TEST(ThreadCacheBoundTest);
+    CPPUNIT_TEST(TrimThreadCachesTest);
+    CPPUNIT_TEST(MaxBytesTest);
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  //----------------------------------------------------------------------------
+  //! Released buffers beyond the thread cache go to the free lists and all of
+  //! them count as cached bytes
+  //----------------------------------------------------------------------------
+  void ThreadCacheBoundTest();
+
+  //----------------------------------------------------------------------------
+  //! Trim drains the caches of other threads
+  //----------------------------------------------------------------------------
+  void TrimThreadCachesTest();
+
+  //----------------------------------------------------------------------------
+  //! Allocations beyond the bound drop free buffers, also from thread caches,
+  //! and lowering the bound trims the pool
+  //----------------------------------------------------------------------------
+  void MaxBytesTest();
+};
+
+#endif // __EOSFSTTEST_BUFFERPOOLTEST_HH__
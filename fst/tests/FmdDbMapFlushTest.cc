@@ -0,0 +1,167 @@
+//------------------------------------------------------------------------------
+// File: FmdDbMapFlushTest.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "FmdDbMapFlushTest.hh"
+#include "fst/FmdDbMap.hh"
+/*----------------------------------------------------------------------------*/
+#include <cstdlib>
+/*----------------------------------------------------------------------------*/
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FmdDbMapFlushTest);
+
+using eos::fst::Fmd;
+using eos::fst::FmdDbMapHandler;
+
+static const eos::common::FileSystem::fsid_t sFsid = 1;
+
+//------------------------------------------------------------------------------
+// Handler failing a given number of write backs, optionally updating a record
+// while the failing batch is written
+//------------------------------------------------------------------------------
+class FailingFmdDbMapHandler : public FmdDbMapHandler
+{
+public:
+  FailingFmdDbMapHandler(): mFailWrites(0), mUpdateFid(0), mWritten(0) {}
+
+  int mFailWrites; ///< number of write backs to fail
+  eos::common::FileId::fileid_t mUpdateFid; ///< record updated during a failing write back
+  Fmd mUpdate; ///< new value of that record
+  size_t mWritten; ///< records in the last successful write back
+
+protected:
+  virtual bool
+  WriteDirtyFmd(eos::common::DbMap* db,
+                const std::map<eos::common::FileId::fileid_t, FmdDirtyEntry>& entries)
+  {
+    if (mFailWrites > 0)
+    {
+      mFailWrites--;
+
+      if (mUpdateFid)
+      {
+        PutFmd(mUpdateFid, sFsid, mUpdate);
+        mUpdateFid = 0;
+      }
+
+      return false;
+    }
+
+    mWritten = entries.size();
+    return FmdDbMapHandler::WriteDirtyFmd(db, entries);
+  }
+};
+
+//------------------------------------------------------------------------------
+// Build an Fmd record
+//------------------------------------------------------------------------------
+static Fmd
+MakeFmd(eos::common::FileId::fileid_t fid, unsigned long long size)
+{
+  Fmd fmd;
+  fmd.set_fid(fid);
+  fmd.set_fsid(sFsid);
+  fmd.set_size(size);
+  return fmd;
+}
+
+//------------------------------------------------------------------------------
+// Flush the dirty records of the test filesystem
+//------------------------------------------------------------------------------
+static bool
+Flush(FmdDbMapHandler& handler)
+{
+  eos::common::RWMutexReadLock lock(handler.Mutex);
+  return handler.FlushFmd(sFsid);
+}
+
+//------------------------------------------------------------------------------
+// setUp
+//------------------------------------------------------------------------------
+void
+FmdDbMapFlushTest::setUp()
+{
+  // only flush when told to
+  setenv("EOS_FST_FMD_FLUSH_MS", "3600000", 1);
+  char tmpdir[] = "/tmp/eos-fmdflush-XXXXXX";
+  CPPUNIT_ASSERT(mkdtemp(tmpdir));
+  mDir = tmpdir;
+}
+
+//------------------------------------------------------------------------------
+// tearDown
+//------------------------------------------------------------------------------
+void
+FmdDbMapFlushTest::tearDown()
+{
+  unsetenv("EOS_FST_FMD_FLUSH_MS");
+
+  if (mDir.length())
+  {
+    std::string cmd = "rm -rf ";
+    cmd += mDir;
+    (void) system(cmd.c_str());
+  }
+}
+
+//------------------------------------------------------------------------------
+// Failed write back
+//------------------------------------------------------------------------------
+void
+FmdDbMapFlushTest::FailedFlushTest()
+{
+  std::string prefix = mDir + "/fmd";
+  FailingFmdDbMapHandler handler;
+  CPPUNIT_ASSERT(handler.SetDBFile(prefix.c_str(), sFsid));
+  CPPUNIT_ASSERT(handler.PutFmd(1, sFsid, MakeFmd(1, 100)));
+  CPPUNIT_ASSERT(handler.PutFmd(2, sFsid, MakeFmd(2, 200)));
+  CPPUNIT_ASSERT(handler.PutFmd(3, sFsid, MakeFmd(3, 300)));
+  handler.mFailWrites = 1;
+  handler.mUpdateFid = 2;
+  handler.mUpdate = MakeFmd(2, 2000);
+  CPPUNIT_ASSERT(!Flush(handler));
+  // the records are still served from the dirty set
+  CPPUNIT_ASSERT(handler.ExistFmd(1, sFsid));
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 100,
+                       (uint64_t) handler.RetrieveFmd(1, sFsid).size());
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 2000,
+                       (uint64_t) handler.RetrieveFmd(2, sFsid).size());
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 300,
+                       (uint64_t) handler.RetrieveFmd(3, sFsid).size());
+  // the next flush retries the whole batch
+  CPPUNIT_ASSERT(Flush(handler));
+  CPPUNIT_ASSERT_EQUAL((size_t) 3, handler.mWritten);
+  // nothing is left to write
+  handler.mWritten = 0;
+  CPPUNIT_ASSERT(Flush(handler));
+  CPPUNIT_ASSERT_EQUAL((size_t) 0, handler.mWritten);
+  // reattaching shuts the DB down and reads the records back from it
+  CPPUNIT_ASSERT(handler.SetDBFile(prefix.c_str(), sFsid));
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 100,
+                       (uint64_t) handler.RetrieveFmd(1, sFsid).size());
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 2000,
+                       (uint64_t) handler.RetrieveFmd(2, sFsid).size());
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 300,
+                       (uint64_t) handler.RetrieveFmd(3, sFsid).size());
+  CPPUNIT_ASSERT(!handler.ExistFmd(4, sFsid));
+  handler.Shutdown();
+}
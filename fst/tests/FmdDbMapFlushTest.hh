@@ -0,0 +1,60 @@
+//------------------------------------------------------------------------------
+//! @file FmdDbMapFlushTest.hh
+//! @brief Unit tests of the write back of Fmd records to the DB
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#ifndef __EOSFSTTEST_FMDDBMAPFLUSHTEST_HH__
+#define __EOSFSTTEST_FMDDBMAPFLUSHTEST_HH__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <string>
+
+//------------------------------------------------------------------------------
+//! Declaration of FmdDbMapFlushTest class
+//------------------------------------------------------------------------------
+class FmdDbMapFlushTest: public CppUnit::TestCase
+{
+  CPPUNIT_TEST_SUITE(FmdDbMapFlushTest);
+    CPPUNIT_TEST(FailedFlushTest);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  //----------------------------------------------------------------------------
+  //! Create a temporary directory for the DB
+  //----------------------------------------------------------------------------
+  void setUp();
+
+  //----------------------------------------------------------------------------
+  //! Remove the temporary directory
+  //----------------------------------------------------------------------------
+  void tearDown();
+
+protected:
+  //----------------------------------------------------------------------------
+  //! A failed write back keeps the batch dirty, an update made meanwhile wins
+  //! and the next flush writes everything to the DB
+  //----------------------------------------------------------------------------
+  void FailedFlushTest();
+
+private:
+  std::string mDir; ///< temporary directory holding the DB
+};
+
+#endif // __EOSFSTTEST_FMDDBMAPFLUSHTEST_HH__
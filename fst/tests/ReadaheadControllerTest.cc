@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+// File: ReadaheadControllerTest.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "ReadaheadControllerTest.hh"
+#include "fst/io/ReadaheadController.hh"
+/*----------------------------------------------------------------------------*/
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ReadaheadControllerTest);
+
+using eos::fst::ReadaheadController;
+
+static const uint64_t sBlock = 1024 * 1024;
+
+//------------------------------------------------------------------------------
+// Sequential reads grow the window
+//------------------------------------------------------------------------------
+void
+ReadaheadControllerTest::SequentialGrowTest()
+{
+  ReadaheadController ra(sBlock, 8);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 1, ra.GetWindow());
+
+  for (uint64_t i = 0; i < 4; i++)
+  {
+    CPPUNIT_ASSERT(ra.Access(i * sBlock, sBlock) ==
+                   ReadaheadController::kSequential);
+  }
+
+  CPPUNIT_ASSERT_EQUAL(sBlock, ra.GetStep());
+  // a block which arrived in time does not change the window
+  ra.Hit(false);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 1, ra.GetWindow());
+  // waiting reads double the window up to the maximum
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 2, ra.GetWindow());
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 4, ra.GetWindow());
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 8, ra.GetWindow());
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 8, ra.GetWindow());
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 5, ra.GetStats().mHits);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 4, ra.GetStats().mWaits);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 8, ra.GetStats().mMaxWindow);
+}
+
+//------------------------------------------------------------------------------
+// Wasted blocks shrink the window
+//------------------------------------------------------------------------------
+void
+ReadaheadControllerTest::WasteShrinkTest()
+{
+  ReadaheadController ra(sBlock, 16);
+
+  for (int i = 0; i < 3; i++)
+    ra.Hit(true);
+
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 8, ra.GetWindow());
+  ra.Waste(0);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 8, ra.GetWindow());
+  ra.Waste(3);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 4, ra.GetWindow());
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 3, ra.GetStats().mWasted);
+  // above the threshold set by the waste the window grows by one
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 5, ra.GetWindow());
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 6, ra.GetWindow());
+
+  // the window never drops below one block while reading sequentially
+  for (int i = 0; i < 8; i++)
+    ra.Waste(1);
+
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 1, ra.GetWindow());
+}
+
+//------------------------------------------------------------------------------
+// Random reads suspend the readahead
+//------------------------------------------------------------------------------
+void
+ReadaheadControllerTest::RandomTest()
+{
+  ReadaheadController ra(sBlock, 8);
+  ra.Access(0, 4096);
+  ra.Hit(true);
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 4, ra.GetWindow());
+  // a single odd read does not change the pattern
+  CPPUNIT_ASSERT(ra.Access(100 * sBlock, 4096) ==
+                 ReadaheadController::kSequential);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 4, ra.GetWindow());
+  CPPUNIT_ASSERT(ra.Access(7 * sBlock, 4096) == ReadaheadController::kRandom);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 0, ra.GetWindow());
+  // hits do not grow a suspended window
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 0, ra.GetWindow());
+  CPPUNIT_ASSERT(ra.Access(3 * sBlock, 4096) == ReadaheadController::kRandom);
+  // sequential reads restart the readahead with one block
+  ra.Access(3 * sBlock + 4096, 4096);
+  CPPUNIT_ASSERT(ra.Access(3 * sBlock + 8192, 4096) ==
+                 ReadaheadController::kSequential);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 1, ra.GetWindow());
+  ra.Hit(true);
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 2, ra.GetWindow());
+}
+
+//------------------------------------------------------------------------------
+// Strided reads prefetch at the stride
+//------------------------------------------------------------------------------
+void
+ReadaheadControllerTest::StridedTest()
+{
+  ReadaheadController ra(sBlock, 8);
+  uint64_t stride = 4 * sBlock;
+
+  for (uint64_t i = 0; i < 4; i++)
+    ra.Access(i * stride, 4096);
+
+  CPPUNIT_ASSERT(ra.Access(4 * stride, 4096) == ReadaheadController::kStrided);
+  CPPUNIT_ASSERT_EQUAL(stride, ra.GetStep());
+  CPPUNIT_ASSERT_EQUAL((uint32_t) 1, ra.GetWindow());
+  // strides shorter than a block are read block after block
+  ReadaheadController small(sBlock, 8);
+
+  for (uint64_t i = 0; i < 5; i++)
+    small.Access(i * 8192, 4096);
+
+  CPPUNIT_ASSERT_EQUAL(sBlock, small.GetStep());
+}
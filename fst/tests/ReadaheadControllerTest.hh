@@ -0,0 +1,63 @@
+//------------------------------------------------------------------------------
+//! @file ReadaheadControllerTest.hh
+//! @brief Unit tests of the readahead window decisions
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#ifndef __EOSFSTTEST_READAHEADCONTROLLERTEST_HH__
+#define __EOSFSTTEST_READAHEADCONTROLLERTEST_HH__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+//------------------------------------------------------------------------------
+//! Declaration of ReadaheadControllerTest class
+//------------------------------------------------------------------------------
+class ReadaheadControllerTest: public CppUnit::TestCase
+{
+  CPPUNIT_TEST_SUITE(ReadaheadControllerTest);
+    CPPUNIT_TEST(SequentialGrowTest);
+    CPPUNIT_TEST(WasteShrinkTest);
+    CPPUNIT_TEST(RandomTest);
+    CPPUNIT_TEST(StridedTest);
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  //----------------------------------------------------------------------------
+  //! The window of a sequential reader grows while reads wait for their
+  //! blocks, up to the maximum window
+  //----------------------------------------------------------------------------
+  void SequentialGrowTest();
+
+  //----------------------------------------------------------------------------
+  //! Dropped blocks halve the window and growth is linear afterwards
+  //----------------------------------------------------------------------------
+  void WasteShrinkTest();
+
+  //----------------------------------------------------------------------------
+  //! Random reads suspend the readahead until the reads turn sequential
+  //----------------------------------------------------------------------------
+  void RandomTest();
+
+  //----------------------------------------------------------------------------
+  //! Strided reads prefetch at the stride
+  //----------------------------------------------------------------------------
+  void StridedTest();
+};
+
+#endif // __EOSFSTTEST_READAHEADCONTROLLERTEST_HH__
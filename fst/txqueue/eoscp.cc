@@ -48,6 +48,7 @@
 #include "fst/io/ChunkHandler.hh"
 #include "fst/io/XrdIo.hh"
 #include "fst/checksum/ChecksumPlugins.hh"
+#include "common/BufferPool.hh"
 /*----------------------------------------------------------------------------*/
 
 #define PROGRAM "eoscp"
@@ -116,6 +117,7 @@ uint32_t buffersize = DEFAULTBUFFERSIZE;
 double read_wait = 0; ///< statistics about total read time
 double write_wait = 0; ///< statistics about total write time
 char* buffer = NULL; ///< used for doing the reading
+uint64_t buffer_alloc = 0; ///< allocated size of the buffer
 bool first_time = true; ///< first time prefetch two blocks
 
 //..............................................................................
@@ -759,7 +761,8 @@ main (int argc, char* argv[])
   //............................................................................
   // Allocate the buffer used for copy
   //............................................................................
-  buffer = new char[2 * buffersize];
+  buffer_alloc = 2 * (uint64_t) buffersize;
+  buffer = eos::common::BufferPool::Instance().Allocate(buffer_alloc);
 
   if ((!buffer))
   {
@@ -2363,7 +2366,7 @@ main (int argc, char* argv[])
   // fprintf(stderr, "Total write wait time is: %f miliseconds. \n", write_wait);
 
   // Free memory
-  delete[] buffer;
+  eos::common::BufferPool::Instance().Release(buffer, buffer_alloc);
 
   if (write_error)
     return -EIO;
@@ -36,6 +36,8 @@
 #include <sstream>
 #include <cstdio>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 /*----------------------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 
@@ -54,7 +56,13 @@ ConfigEngineChangeLog::ConfigEngineChangeLog ()
  * @brief Constructor
  */
 /*----------------------------------------------------------------------------*/ {
-  // do nothing
+  redoFd = -1;
+  redoRecords = 0;
+  redoStart = 0;
+  redoMaxRecords = getenv("EOS_MGM_CONFIG_REDO_RECORDS") ?
+    strtoull(getenv("EOS_MGM_CONFIG_REDO_RECORDS"), 0, 10) : 1000;
+  redoMaxAge = getenv("EOS_MGM_CONFIG_REDO_INTERVAL") ?
+    strtoul(getenv("EOS_MGM_CONFIG_REDO_INTERVAL"), 0, 10) : 3600;
 }
 
 void
@@ -78,7 +86,7 @@ ConfigEngineChangeLog::~ConfigEngineChangeLog ()
  * @brief Destructor
  */
 /*----------------------------------------------------------------------------*/ {
-  // nothing to do
+  CloseRedoLog();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -220,6 +228,217 @@ ConfigEngineChangeLog::Tail (unsigned int nlines, XrdOucString &tail)
   return true;
 }
 
+/*----------------------------------------------------------------------------*/
+bool
+ConfigEngineChangeLog::OpenRedoLog (const char* file,
+                                    off_t length,
+                                    unsigned long long records)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Open the redo log of a configuration for appending
+ * @param file path of the redo log
+ * @param length length of the valid records, anything behind is cut away
+ * @param records number of valid records
+ * @return true if ok otherwise false
+ */
+/*----------------------------------------------------------------------------*/
+{
+  XrdSysMutexHelper lock(redoMutex);
+
+  if (redoFd >= 0)
+    close(redoFd);
+
+  redoFile = file;
+  redoRecords = records;
+  redoStart = time(0);
+  redoFd = open(file, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+  if (redoFd < 0)
+  {
+    eos_err("failed to open config redo log %s errno=%d", file, errno);
+    return false;
+  }
+
+  // drop a record which was only partially written
+  if (ftruncate(redoFd, length))
+  {
+    eos_err("failed to truncate config redo log %s errno=%d", file, errno);
+    close(redoFd);
+    redoFd = -1;
+    return false;
+  }
+
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ConfigEngineChangeLog::CloseRedoLog ()
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Close the redo log
+ */
+/*----------------------------------------------------------------------------*/
+{
+  XrdSysMutexHelper lock(redoMutex);
+
+  if (redoFd >= 0)
+  {
+    close(redoFd);
+    redoFd = -1;
+  }
+
+  redoFile = "";
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ConfigEngineChangeLog::AddRedoEntry (const char* action,
+                                     const char* key,
+                                     const char* value)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Append a record to the redo log
+ * @param action one of "set", "del" or "delmatch"
+ * @param key configuration key or key prefix for "delmatch"
+ * @param value configuration value for "set"
+ * @return true if the record was written otherwise false
+ *
+ * A record is a single line "set <key> => <value>", "del <key>" or
+ * "delmatch <prefix>" written with one write call.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  std::string record = action;
+  record += " ";
+  record += key;
+
+  if (value)
+  {
+    record += " => ";
+    record += value;
+  }
+
+  record += "\n";
+  XrdSysMutexHelper lock(redoMutex);
+
+  if (redoFd < 0)
+    return false;
+
+  size_t nwrite = 0;
+
+  while (nwrite < record.length())
+  {
+    ssize_t n = write(redoFd, record.c_str() + nwrite, record.length() - nwrite);
+
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      eos_err("failed to write config redo log %s errno=%d",
+              redoFile.c_str(), errno);
+      // force a checkpoint which starts a new redo log
+      close(redoFd);
+      redoFd = -1;
+      return false;
+    }
+
+    nwrite += n;
+  }
+
+  if (!redoRecords)
+    redoStart = time(0);
+
+  redoRecords++;
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ConfigEngineChangeLog::NeedsCheckpoint ()
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Check if the redo log is due to be folded into the config file
+ */
+/*----------------------------------------------------------------------------*/
+{
+  XrdSysMutexHelper lock(redoMutex);
+  return (redoRecords >= redoMaxRecords) ||
+    (redoRecords && ((time(0) - redoStart) >= redoMaxAge));
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ConfigEngineChangeLog::ReplayRedoLog (const char* file,
+                                      XrdOucHash<XrdOucString> &config,
+                                      off_t &length,
+                                      unsigned long long &records)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Apply the records of a redo log to a set of config definitions
+ * @param file path of the redo log, a missing file is an empty redo log
+ * @param config config definitions to update
+ * @param length returns the length of the complete records
+ * @param records returns the number of complete records
+ * @return true if ok otherwise false
+ */
+/*----------------------------------------------------------------------------*/
+{
+  length = 0;
+  records = 0;
+  std::ifstream infile(file);
+
+  if (!infile.is_open())
+  {
+    if (errno == ENOENT)
+      return true;
+
+    eos_static_err("failed to open config redo log %s errno=%d", file, errno);
+    return false;
+  }
+
+  std::string line;
+
+  while (getline(infile, line))
+  {
+    // a last line without newline is a partially written record
+    if (infile.eof())
+      break;
+
+    length += line.length() + 1;
+    records++;
+
+    if (!line.compare(0, 4, "set "))
+    {
+      size_t seppos = line.find(" => ", 4);
+
+      if (seppos != std::string::npos)
+      {
+        std::string key = line.substr(4, seppos - 4);
+        config.Rep(key.c_str(), new XrdOucString(line.c_str() + seppos + 4));
+        continue;
+      }
+    }
+    else if (!line.compare(0, 4, "del "))
+    {
+      config.Del(line.c_str() + 4);
+      continue;
+    }
+    else if (!line.compare(0, 9, "delmatch "))
+    {
+      XrdOucString match = line.c_str() + 9;
+      config.Apply(ConfigEngine::DeleteConfigByMatch, &match);
+      continue;
+    }
+
+    eos_static_warning("ignoring malformed record in config redo log %s: %s",
+                       file, line.c_str());
+  }
+
+  return true;
+}
+
 //------------------------------------------------------------------------------
 //                     *** ConfigEngine class ***
 //------------------------------------------------------------------------------
@@ -289,11 +508,30 @@ ConfigEngine::LoadConfig (XrdOucEnv &env, XrdOucString &err)
 	allconfig += s.c_str();
 	allconfig += "\n";
       }
-      eos_notice("IN ==> %s", s.c_str());
+      eos_debug("IN ==> %s", s.c_str());
     }
     infile.close();
     if (!ParseConfig(allconfig, err))
       return false;
+
+    // replay the changes stored after the last checkpoint
+    XrdOucString redolog = GetRedoLogPath(name);
+    off_t redolength = 0;
+    unsigned long long redorecords = 0;
+    Mutex.Lock();
+    bool replayed = ConfigEngineChangeLog::ReplayRedoLog(redolog.c_str(),
+                                                         configDefinitions,
+                                                         redolength,
+                                                         redorecords);
+    Mutex.UnLock();
+    if (!replayed)
+    {
+      err = "error: failed to replay config redo log ";
+      err += redolog.c_str();
+      return false;
+    }
+    eos_notice("replayed %llu records of config redo log %s",
+               redorecords, redolog.c_str());
     configBroadcast = false;
     if (!ApplyConfig(err))
     {
@@ -311,6 +549,8 @@ ConfigEngine::LoadConfig (XrdOucEnv &env, XrdOucString &err)
       changeLog.AddEntry(cl.c_str());
       currentConfigFile = name;
       changeLog.configChanges = "";
+      if (changeLog.OpenRedoLog(redolog.c_str(), redolength, redorecords))
+        redoConfigFile = name;
       return true;
     }
 
@@ -460,6 +700,11 @@ ConfigEngine::SaveConfig (XrdOucEnv &env, XrdOucString &err)
     eos::common::StringConversion::SortLines(config);
     outfile << config.c_str();
     outfile.close();
+
+    // the file is the new checkpoint, start an empty redo log
+    redoConfigFile = "";
+    if (changeLog.OpenRedoLog(GetRedoLogPath(name).c_str(), 0, 0))
+      redoConfigFile = name;
   }
   else
   {
@@ -629,6 +874,8 @@ ConfigEngine::ResetConfig ()
   changeLog.AddEntry(cl.c_str());
   changeLog.configChanges = "";
   currentConfigFile = "";
+  changeLog.CloseRedoLog();
+  redoConfigFile = "";
 
   // Cleanup the quota map
   (void) Quota::CleanUp();
@@ -640,6 +887,7 @@ ConfigEngine::ResetConfig ()
   eos::common::Mapping::gVirtualGidMap.clear();
   eos::common::Mapping::gMapMutex.UnLockWrite();
   eos::common::Mapping::gAllowedTidentMatches.clear();
+  eos::common::Mapping::gVidCache.Invalidate();
 
   Access::Reset();
 
@@ -680,6 +928,7 @@ ConfigEngine::ApplyConfig (XrdOucString &err)
   eos::common::Mapping::gVirtualGidMap.clear();
   eos::common::Mapping::gMapMutex.UnLockWrite();
   eos::common::Mapping::gAllowedTidentMatches.clear();
+  eos::common::Mapping::gVidCache.Invalidate();
 
   Access::Reset();
 
@@ -1229,7 +1478,39 @@ ConfigEngine::DumpConfig (XrdOucString &out, XrdOucEnv &filter)
 
     std::ifstream infile(fullpath.c_str());
     std::string inputline;
+    std::string stored;
+    XrdOucHash<XrdOucString> merged;
     while (getline(infile, inputline))
+    {
+      stored += inputline;
+      stored += "\n";
+      size_t seppos = inputline.find(" => ");
+      if (seppos != std::string::npos)
+      {
+	std::string key = inputline.substr(0, seppos);
+	merged.Add(key.c_str(), new XrdOucString(inputline.c_str() + seppos + 4));
+      }
+    }
+
+    // add the changes stored after the last checkpoint, the result is what
+    // the config file contains once they are checkpointed
+    off_t redolength = 0;
+    unsigned long long redorecords = 0;
+    ConfigEngineChangeLog::ReplayRedoLog(GetRedoLogPath(name).c_str(), merged,
+                                         redolength, redorecords);
+    if (redorecords)
+    {
+      XrdOucString mergedconfig = "";
+      struct PrintInfo allinfo;
+      allinfo.out = &mergedconfig;
+      allinfo.option = "vfqcpgms";
+      merged.Apply(PrintEachConfig, &allinfo);
+      eos::common::StringConversion::SortLines(mergedconfig);
+      stored = mergedconfig.c_str();
+    }
+
+    std::istringstream instored(stored);
+    while (getline(instored, inputline))
     {
       XrdOucString sinputline = inputline.c_str();
       // filter according to user specification
@@ -1367,30 +1648,7 @@ ConfigEngine::SetConfigValue (const char* prefix,
     }
   }
 
-  if (gOFS->MgmMaster.IsMaster() && autosave && currentConfigFile.length())
-  {
-    int aspos = 0;
-    if ((aspos = currentConfigFile.find(".autosave")) != STR_NPOS)
-    {
-      currentConfigFile.erase(aspos);
-    }
-    if ((aspos = currentConfigFile.find(".backup")) != STR_NPOS)
-    {
-      currentConfigFile.erase(aspos);
-    }
-    XrdOucString envstring = "mgm.config.file=";
-    envstring += currentConfigFile;
-    envstring += "&mgm.config.force=1";
-    envstring += "&mgm.config.autosave=1";
-    XrdOucEnv env(envstring.c_str());
-    XrdOucString err = "";
-
-    if (!SaveConfig(env, err))
-    {
-
-      eos_static_err("%s\n", err.c_str());
-    }
-  }
+  AutoSaveChange("set", configname.c_str(), val);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -1444,29 +1702,7 @@ ConfigEngine::DeleteConfigValue (const char* prefix,
   if (tochangelog)
     changeLog.AddEntry(cl.c_str());
 
-  if (gOFS->MgmMaster.IsMaster() && autosave && currentConfigFile.length())
-  {
-    int aspos = 0;
-    if ((aspos = currentConfigFile.find(".autosave")) != STR_NPOS)
-    {
-      currentConfigFile.erase(aspos);
-    }
-    if ((aspos = currentConfigFile.find(".backup")) != STR_NPOS)
-    {
-      currentConfigFile.erase(aspos);
-    }
-    XrdOucString envstring = "mgm.config.file=";
-    envstring += currentConfigFile;
-    envstring += "&mgm.config.force=1";
-    envstring += "&mgm.config.autosave=1";
-    XrdOucEnv env(envstring.c_str());
-    XrdOucString err = "";
-    if (!SaveConfig(env, err))
-    {
-
-      eos_static_err("%s\n", err.c_str());
-    }
-  }
+  AutoSaveChange("del", configname.c_str());
   Mutex.UnLock();
   eos_static_debug("%s", key);
 }
@@ -1489,6 +1725,76 @@ ConfigEngine::DeleteConfigValueByMatch (const char* prefix,
   smatch += match;
   configDefinitions.Apply(DeleteConfigByMatch, &smatch);
   Mutex.UnLock();
+  AutoSaveChange("delmatch", smatch.c_str());
+}
+
+/*----------------------------------------------------------------------------*/
+XrdOucString
+ConfigEngine::GetRedoLogPath (const char* name)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Get the path of the redo log of a configuration
+ * @param name name of the configuration
+ */
+/*----------------------------------------------------------------------------*/
+{
+  XrdOucString path = configDir;
+  path += name;
+  path += EOSMGMCONFIGENGINE_EOS_SUFFIX;
+  path += EOSMGMCONFIGENGINE_REDO_SUFFIX;
+  return path;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ConfigEngine::AutoSaveChange (const char* action,
+			      const char* key,
+			      const char* val)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Store a change of the current configuration if autosave is enabled
+ * @param action redo record type "set", "del" or "delmatch"
+ * @param key configuration key or key prefix
+ * @param val configuration value for "set"
+ *
+ * The change is appended to the redo log of the current configuration. The
+ * configuration file is only rewritten if there is no redo log for it yet or
+ * the redo log is due for a checkpoint.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  if (!gOFS->MgmMaster.IsMaster() || !autosave || !currentConfigFile.length())
+    return;
+
+  int aspos = 0;
+  if ((aspos = currentConfigFile.find(".autosave")) != STR_NPOS)
+  {
+    currentConfigFile.erase(aspos);
+  }
+  if ((aspos = currentConfigFile.find(".backup")) != STR_NPOS)
+  {
+    currentConfigFile.erase(aspos);
+  }
+
+  if ((redoConfigFile == currentConfigFile) &&
+      changeLog.AddRedoEntry(action, key, val) &&
+      !changeLog.NeedsCheckpoint())
+  {
+    changeLog.configChanges = "";
+    return;
+  }
+
+  XrdOucString envstring = "mgm.config.file=";
+  envstring += currentConfigFile;
+  envstring += "&mgm.config.force=1";
+  envstring += "&mgm.config.autosave=1";
+  XrdOucEnv env(envstring.c_str());
+  XrdOucString err = "";
+
+  if (!SaveConfig(env, err))
+  {
+    eos_static_err("%s\n", err.c_str());
+  }
 }
 
 EOSMGMNAMESPACE_END
@@ -62,11 +62,20 @@
 EOSMGMNAMESPACE_BEGIN
 
 #define EOSMGMCONFIGENGINE_EOS_SUFFIX ".eoscf"
+#define EOSMGMCONFIGENGINE_REDO_SUFFIX ".redo"
 
 /*----------------------------------------------------------------------------*/
 /** 
  * @brief Class implementing the changelog store/history
  *
+ * Besides the history the changelog keeps the redo log of the configuration
+ * file currently in use. With autosave enabled every change is appended to
+ * <config>.eoscf.redo as a single record instead of rewriting the whole
+ * configuration file. The configuration file is the checkpoint: it is only
+ * rewritten when the redo log grows beyond EOS_MGM_CONFIG_REDO_RECORDS
+ * records (default 1000) or gets older than EOS_MGM_CONFIG_REDO_INTERVAL
+ * seconds (default 3600), then the redo log starts empty again. Loading a
+ * configuration replays its redo log on top of the checkpoint.
  */
 /*----------------------------------------------------------------------------*/
 class ConfigEngineChangeLog : public eos::common::LogId
@@ -84,6 +93,14 @@ private:
   XrdSysMutex Mutex;
   eos::common::DbMap map;
   std::string changelogfile;
+
+  XrdSysMutex redoMutex; ///< protects the redo log members below
+  int redoFd; ///< file descriptor of the redo log
+  std::string redoFile; ///< path of the redo log
+  unsigned long long redoRecords; ///< records since the last checkpoint
+  time_t redoStart; ///< time of the first record since the last checkpoint
+  unsigned long long redoMaxRecords; ///< records triggering a checkpoint
+  time_t redoMaxAge; ///< age of the redo log triggering a checkpoint
 public:
   XrdOucString configChanges;
 
@@ -94,6 +111,34 @@ public:
 
   bool AddEntry (const char* info);
   bool Tail (unsigned int nlines, XrdOucString &tail);
+
+  // ---------------------------------------------------------------------------
+  // Open the redo log of a configuration
+  // ---------------------------------------------------------------------------
+  bool OpenRedoLog (const char* file, off_t length, unsigned long long records);
+
+  // ---------------------------------------------------------------------------
+  // Close the redo log
+  // ---------------------------------------------------------------------------
+  void CloseRedoLog ();
+
+  // ---------------------------------------------------------------------------
+  // Append a record to the redo log
+  // ---------------------------------------------------------------------------
+  bool AddRedoEntry (const char* action, const char* key, const char* value = 0);
+
+  // ---------------------------------------------------------------------------
+  // Check if the configuration file should be rewritten
+  // ---------------------------------------------------------------------------
+  bool NeedsCheckpoint ();
+
+  // ---------------------------------------------------------------------------
+  // Replay a redo log on a set of config definitions
+  // ---------------------------------------------------------------------------
+  static bool ReplayRedoLog (const char* file,
+                             XrdOucHash<XrdOucString> &config,
+                             off_t &length,
+                             unsigned long long &records);
 };
 
 /*----------------------------------------------------------------------------*/
@@ -122,10 +167,23 @@ private:
   /// autosave flag - if enabled all changes trigger to store an autosave file
   bool autosave;
 
+  /// name of the configuration whose redo log is open
+  XrdOucString redoConfigFile;
+
   /// broadcasting flag - if enabled all changes are broadcasted into the MGM
   /// configuration queue (config/<instance>/mgm)
   bool configBroadcast;
 
+  // ---------------------------------------------------------------------------
+  // Get the path of the redo log of a configuration
+  // ---------------------------------------------------------------------------
+  XrdOucString GetRedoLogPath (const char* name);
+
+  // ---------------------------------------------------------------------------
+  // Store a change of the current configuration if autosave is enabled
+  // ---------------------------------------------------------------------------
+  void AutoSaveChange (const char* action, const char* key, const char* val = 0);
+
 public:
 
 
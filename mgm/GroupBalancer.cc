@@ -37,15 +37,253 @@
 /*----------------------------------------------------------------------------*/
 #include <random>
 #include <cmath>
+#include <chrono>
 /*----------------------------------------------------------------------------*/
 extern XrdSysError gMgmOfsEroute;
 extern XrdOucTrace gMgmOfsTrace;
 
 #define CACHE_LIFE_TIME 60 // seconds
+#define CANDIDATES_PER_FS 1024 // transfer candidates indexed per filesystem
 
 /*----------------------------------------------------------------------------*/
 EOSMGMNAMESPACE_BEGIN
 
+GroupCandidateIndex GroupBalancer::gCandidateIndex(CANDIDATES_PER_FS);
+
+/*----------------------------------------------------------------------------*/
+GroupCandidateIndex::GroupCandidateIndex (size_t maxPerFs)
+: mMaxPerFs (maxPerFs)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Constructor
+ *
+ * @param maxPerFs maximum number of candidates kept per filesystem
+ */
+/*----------------------------------------------------------------------------*/
+{
+}
+
+/*----------------------------------------------------------------------------*/
+void
+GroupCandidateIndex::add (FsSample &sample,
+                          eos::common::FileId::fileid_t fid,
+                          uint64_t size)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Adds a candidate to a sample or updates its size, empty files are
+ *        never candidates (must be called with mMutex held)
+ */
+/*----------------------------------------------------------------------------*/
+{
+  if (size == 0)
+  {
+    remove(sample, fid);
+    return;
+  }
+
+  auto it = sample.mPos.find(fid);
+
+  if (it != sample.mPos.end())
+  {
+    sample.mCandidates[it->second].mSize = size;
+    return;
+  }
+
+  if (sample.mCandidates.size() >= mMaxPerFs)
+    return;
+
+  sample.mPos[fid] = sample.mCandidates.size();
+  sample.mCandidates.push_back(Candidate{fid, size});
+}
+
+/*----------------------------------------------------------------------------*/
+void
+GroupCandidateIndex::remove (FsSample &sample,
+                             eos::common::FileId::fileid_t fid)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Removes a candidate from a sample (must be called with mMutex held)
+ */
+/*----------------------------------------------------------------------------*/
+{
+  auto it = sample.mPos.find(fid);
+
+  if (it == sample.mPos.end())
+    return;
+
+  size_t pos = it->second;
+  sample.mPos.erase(it);
+
+  if (pos != sample.mCandidates.size() - 1)
+  {
+    sample.mCandidates[pos] = sample.mCandidates.back();
+    sample.mPos[sample.mCandidates[pos].mFid] = pos;
+  }
+
+  sample.mCandidates.pop_back();
+}
+
+/*----------------------------------------------------------------------------*/
+void
+GroupCandidateIndex::fileMDChanged (eos::IFileMDChangeListener::Event* e)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Namespace change notification, only filesystems which have been
+ *        seeded before are tracked
+ */
+/*----------------------------------------------------------------------------*/
+{
+  eos::common::FileId::fileid_t fid = (e->file ? e->file->getId() : e->fileId);
+  XrdSysMutexHelper lock(mMutex);
+
+  if (mSamples.empty())
+    return;
+
+  switch (e->action)
+  {
+  case eos::IFileMDChangeListener::LocationAdded:
+  {
+    auto it = mSamples.find(e->location);
+
+    if (e->file && (it != mSamples.end()))
+      add(it->second, fid, e->file->getSize());
+
+    break;
+  }
+
+  case eos::IFileMDChangeListener::LocationReplaced:
+  {
+    auto it = mSamples.find(e->oldLocation);
+
+    if (it != mSamples.end())
+      remove(it->second, fid);
+
+    it = mSamples.find(e->location);
+
+    if (e->file && (it != mSamples.end()))
+      add(it->second, fid, e->file->getSize());
+
+    break;
+  }
+
+  case eos::IFileMDChangeListener::LocationUnlinked:
+  case eos::IFileMDChangeListener::LocationRemoved:
+  {
+    auto it = mSamples.find(e->location);
+
+    if (it != mSamples.end())
+      remove(it->second, fid);
+
+    break;
+  }
+
+  case eos::IFileMDChangeListener::SizeChange:
+  {
+    if (!e->file)
+      break;
+
+    eos::IFileMD::LocationVector locations = e->file->getLocations();
+
+    for (auto loc = locations.begin(); loc != locations.end(); ++loc)
+    {
+      auto it = mSamples.find(*loc);
+
+      if (it != mSamples.end())
+        add(it->second, fid, e->file->getSize());
+    }
+
+    break;
+  }
+
+  default:
+    break;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+GroupCandidateIndex::needsRefill (eos::IFileMD::location_t fsid,
+                                  time_t minAge)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Checks if a filesystem is not indexed yet or if its sample dropped
+ *        below a quarter of the maximum and was not seeded for minAge seconds
+ */
+/*----------------------------------------------------------------------------*/
+{
+  XrdSysMutexHelper lock(mMutex);
+  auto it = mSamples.find(fsid);
+
+  if (it == mSamples.end())
+    return true;
+
+  if (it->second.mCandidates.size() >= mMaxPerFs / 4)
+    return false;
+
+  return (difftime(time(NULL), it->second.mLastRefill) > minAge);
+}
+
+/*----------------------------------------------------------------------------*/
+void
+GroupCandidateIndex::refill (eos::IFileMD::location_t fsid,
+                             const std::vector<Candidate> &candidates)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Adds the given candidates to the sample of a filesystem (up to the
+ *        maximum), the candidates still in the sample are kept
+ */
+/*----------------------------------------------------------------------------*/
+{
+  XrdSysMutexHelper lock(mMutex);
+  FsSample &sample = mSamples[fsid];
+
+  for (auto it = candidates.begin(); it != candidates.end(); ++it)
+    add(sample, it->mFid, it->mSize);
+
+  sample.mLastRefill = time(NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+GroupCandidateIndex::take (eos::IFileMD::location_t fsid,
+                           const std::map<eos::common::FileId::fileid_t,
+                           std::string> &exclude,
+                           Candidate &candidate)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Removes a random candidate from the sample of a filesystem
+ *
+ * @param fsid filesystem id
+ * @param exclude files which are already scheduled
+ * @param candidate return address for the chosen candidate
+ *
+ * @return true if a candidate was found, otherwise false
+ */
+/*----------------------------------------------------------------------------*/
+{
+  XrdSysMutexHelper lock(mMutex);
+  auto it = mSamples.find(fsid);
+
+  if (it == mSamples.end())
+    return false;
+
+  FsSample &sample = it->second;
+
+  while (!sample.mCandidates.empty())
+  {
+    Candidate entry = sample.mCandidates[random() % sample.mCandidates.size()];
+    remove(sample, entry.mFid);
+
+    if (exclude.count(entry.mFid) == 0)
+    {
+      candidate = entry;
+      return true;
+    }
+  }
+
+  return false;
+}
+
 /*----------------------------------------------------------------------------*/
 GroupBalancer::GroupBalancer (const char* spacename)
 : mThreshold (.5),
@@ -390,7 +628,7 @@ GroupBalancer::updateTransferList ()
 }
 
 /*----------------------------------------------------------------------------*/
-void
+bool
 GroupBalancer::scheduleTransfer (eos::common::FileId::fileid_t fid,
                                  FsGroup *sourceGroup,
                                  FsGroup *targetGroup)
@@ -401,6 +639,7 @@ GroupBalancer::scheduleTransfer (eos::common::FileId::fileid_t fid,
  * @param fid the id of the file to be transferred
  * @param sourceGroup the group where the file is currently located
  * @param targetGroup the group to which the file is will be transferred
+ * @return true if the transfer was scheduled, otherwise false
  */
 /*----------------------------------------------------------------------------*/
 {
@@ -411,9 +650,11 @@ GroupBalancer::scheduleTransfer (eos::common::FileId::fileid_t fid,
   std::string fileName = getFileProcTransferNameAndSize(fid, targetGroup, &size);
 
   if (fileName == "")
-    return;
+    return false;
 
-  if (!gOFS->_touch(fileName.c_str(), mError, rootvid, 0))
+  bool scheduled = !gOFS->_touch(fileName.c_str(), mError, rootvid, 0);
+
+  if (scheduled)
   {
     eos_static_info("scheduledfile=%s", fileName.c_str());
   }
@@ -429,63 +670,137 @@ GroupBalancer::scheduleTransfer (eos::common::FileId::fileid_t fid,
 
   updateGroupAvgCache(sourceGroup);
   updateGroupAvgCache(targetGroup);
+  return scheduled;
 }
 
 /*----------------------------------------------------------------------------*/
-eos::common::FileId::fileid_t
-GroupBalancer::chooseFidFromGroup (FsGroup *group)
+void
+GroupBalancer::refreshCandidates ()
 /*----------------------------------------------------------------------------*/
 /**
- * @brief Chooses a random file ID from a random filesystem in the given group
- * @param group the group from which the file id will be chosen
- * @return the chosen file ID
+ * @brief Seeds the candidate index for the filesystems of the groups over the
+ *        average which are not indexed yet or whose sample got exhausted. The
+ *        namespace is only scanned here, afterwards the index is kept up to
+ *        date by the namespace change notifications.
  */
 /*----------------------------------------------------------------------------*/
 {
-  int rndIndex;
-  eos::common::RWMutexReadLock vlock(FsView::gFsView.ViewMutex);
-  eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
-  eos::IFsView::FileList filelist;
-  std::vector<int> validFsIndexes(group->size());
+  std::vector<eos::IFileMD::location_t> fsids;
+
+  {
+    eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
+    std::map<std::string, FsGroup *>::const_iterator git;
 
-  for (size_t i = 0; i < group->size(); i++)
-    validFsIndexes[i] = (int) i;
+    for (git = mGroupsOverAvg.cbegin(); git != mGroupsOverAvg.cend(); git++)
+    {
+      eos::mgm::BaseView::const_iterator fs_it;
 
-  eos::mgm::BaseView::const_iterator fs_it;
+      for (fs_it = (*git).second->begin(); fs_it != (*git).second->end(); fs_it++)
+      {
+        if (FsView::gFsView.mIdView.count(*fs_it) &&
+            (FsView::gFsView.mIdView[*fs_it]->GetActiveStatus() ==
+             eos::common::FileSystem::kOnline) &&
+            gCandidateIndex.needsRefill(*fs_it, CACHE_LIFE_TIME))
+          fsids.push_back(*fs_it);
+      }
+    }
+  }
+
+  size_t maxCandidates = gCandidateIndex.maxPerFs();
 
-  while (validFsIndexes.size() > 0)
+  for (size_t i = 0; i < fsids.size(); i++)
   {
-    fs_it = group->begin();
-    rndIndex = getRandom(validFsIndexes.size() - 1);
-    std::advance(fs_it, validFsIndexes[rndIndex]);
+    std::vector<GroupCandidateIndex::Candidate> candidates;
+    std::vector<eos::common::FileId::fileid_t> fids;
+    fids.reserve(maxCandidates);
 
-    // accept only active file systems
-    if (FsView::gFsView.mIdView[*fs_it]->GetActiveStatus() ==
-        eos::common::FileSystem::kOnline)
+    // the namespace lock is kept while refilling the index so that no change
+    // notification can be lost in between
+    eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
+    eos::IFsView::FileList filelist = gOFS->eosFsView->getFileList(fsids[i]);
+    size_t seen = 0;
+
+    // reservoir sampling of the file ids on the filesystem
+    for (eos::IFsView::FileIterator it = filelist.begin();
+         it != filelist.end(); ++it, ++seen)
     {
-      filelist = gOFS->eosFsView->getFileList(*fs_it);
+      if (fids.size() < maxCandidates)
+      {
+        fids.push_back(*it);
+      }
+      else
+      {
+        size_t pos = random() % (seen + 1);
 
-      if (filelist.size() > 0)
-        break;
+        if (pos < maxCandidates)
+          fids[pos] = *it;
+      }
     }
 
-    validFsIndexes.erase(validFsIndexes.begin() + rndIndex);
+    for (size_t j = 0; j < fids.size(); j++)
+    {
+      try
+      {
+        std::shared_ptr<eos::IFileMD> fmd =
+          gOFS->eosFileService->getFileMD(fids[j]);
+
+        if (fmd->getContainerId() == 0 || fmd->getSize() == 0)
+          continue;
+
+        candidates.push_back(GroupCandidateIndex::Candidate{fids[j],
+                                                            fmd->getSize()});
+      }
+      catch (eos::MDException &e)
+      {
+        eos_static_debug("msg=\"exception\" ec=%d emsg=\"%s\"\n",
+                         e.getErrno(), e.getMessage().str().c_str());
+      }
+    }
+
+    gCandidateIndex.refill(fsids[i], candidates);
+    eos_static_info("msg=\"indexed transfer candidates\" fsid=%u files=%lu "
+                    "candidates=%lu", fsids[i], (unsigned long) filelist.size(),
+                    (unsigned long) candidates.size());
   }
+}
 
-  if (filelist.size() == 0)
-    return -1;
+/*----------------------------------------------------------------------------*/
+eos::common::FileId::fileid_t
+GroupBalancer::chooseFidFromGroup (FsGroup *group)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Chooses a random file ID from a random filesystem in the given group
+ *        using the candidate index (no namespace lock is taken)
+ * @param group the group from which the file id will be chosen
+ * @return the chosen file ID
+ */
+/*----------------------------------------------------------------------------*/
+{
+  std::vector<eos::IFileMD::location_t> validFsIds;
 
-  int attempts = 10;
-  eos::IFsView::FileIterator fid_it;
+  {
+    eos::common::RWMutexReadLock vlock(FsView::gFsView.ViewMutex);
+    eos::mgm::BaseView::const_iterator fs_it;
 
-  while (attempts-- > 0)
+    for (fs_it = group->begin(); fs_it != group->end(); fs_it++)
+    {
+      // accept only active file systems
+      if (FsView::gFsView.mIdView.count(*fs_it) &&
+          (FsView::gFsView.mIdView[*fs_it]->GetActiveStatus() ==
+           eos::common::FileSystem::kOnline))
+        validFsIds.push_back(*fs_it);
+    }
+  }
+
+  while (validFsIds.size() > 0)
   {
-    rndIndex = getRandom(filelist.size() - 1);
-    fid_it = filelist.begin();
-    std::advance(fid_it, rndIndex);
+    int rndIndex = getRandom(validFsIds.size() - 1);
+    GroupCandidateIndex::Candidate candidate;
+
+    if (gCandidateIndex.take(validFsIds[rndIndex], mTransfers, candidate))
+      return candidate.mFid;
 
-    if (mTransfers.count(*fid_it) == 0)
-      return *fid_it;
+    validFsIds.erase(validFsIds.begin() + rndIndex);
   }
 
   return -1;
@@ -502,12 +817,13 @@ printSizes (const std::map<std::string, GroupSize *> *sizes)
 }
 
 /*----------------------------------------------------------------------------*/
-void
+bool
 GroupBalancer::prepareTransfer ()
 /*----------------------------------------------------------------------------*/
 /**
  * @brief Picks two groups (source and target) randomly and schedule a file ID
  *        to be transferred
+ * @return true if a transfer was scheduled, otherwise false
  */
 /*----------------------------------------------------------------------------*/
 {
@@ -524,7 +840,7 @@ GroupBalancer::prepareTransfer ()
       eos_static_debug("No groups under the average!");
 
     recalculateAvg();
-    return;
+    return false;
   }
 
   over_it = mGroupsOverAvg.begin();
@@ -540,17 +856,17 @@ GroupBalancer::prepareTransfer ()
   toGroup = (*under_it).second;
 
   if (fromGroup->size() == 0)
-    return;
+    return false;
 
   eos::common::FileId::fileid_t fid = chooseFidFromGroup(fromGroup);
   if ((int) fid == -1)
   {
     eos_static_info("Couldn't choose any FID to schedule: failedgroup=%s",
                     fromGroup->mName.c_str());
-    return;
+    return false;
   }
 
-  scheduleTransfer(fid, fromGroup, toGroup);
+  return scheduleTransfer(fid, fromGroup, toGroup);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -575,6 +891,31 @@ GroupBalancer::cacheExpired ()
   return false;
 }
 
+/*----------------------------------------------------------------------------*/
+void
+GroupBalancer::publishRate (double rate)
+{
+  /*--------------------------------------------------------------------------*/
+  /**
+   * @brief Publish the scheduling rate of the last round in the space view
+   * @param rate transfers scheduled per second
+   */
+  /*--------------------------------------------------------------------------*/
+  eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
+
+  if (!FsView::gFsView.mSpaceView.count(mSpaceName.c_str()))
+    return;
+
+  char srate[256];
+  snprintf(srate, sizeof (srate) - 1, "%.02f", rate);
+  FsView::gFsView.mSpaceView[mSpaceName.c_str()]->SetConfigMember
+    ("stat.groupbalancer.rate",
+     srate,
+     true,
+     "/eos/*/mgm",
+     true);
+}
+
 /*----------------------------------------------------------------------------*/
 void
 GroupBalancer::prepareTransfers (int nrTransfers)
@@ -585,11 +926,27 @@ GroupBalancer::prepareTransfers (int nrTransfers)
    */
   /*--------------------------------------------------------------------------*/
   int allowedTransfers = nrTransfers - mTransfers.size();
+  int scheduledTransfers = 0;
+  auto start = std::chrono::steady_clock::now();
+
   for (int i = 0; i < allowedTransfers; i++)
-    prepareTransfer();
+  {
+    if (prepareTransfer())
+      scheduledTransfers++;
+  }
 
   if (allowedTransfers > 0)
+  {
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+    double rate = (elapsed.count() > 0) ?
+      scheduledTransfers / elapsed.count() : 0.0;
+    eos_static_info("space=%s requested=%d scheduled=%d duration=%.03fs "
+                    "rate=%.02fHz", mSpaceName.c_str(), allowedTransfers,
+                    scheduledTransfers, elapsed.count(), rate);
+    publishRate(rate);
     printSizes(&mGroupSizes);
+  }
 }
 
 /*----------------------------------------------------------------------------*/
@@ -692,6 +1049,7 @@ GroupBalancer::GroupBalance ()
       else
         recalculateAvg();
 
+      refreshCandidates();
       prepareTransfers(nrTransfers);
     }
 
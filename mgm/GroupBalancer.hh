@@ -28,12 +28,15 @@
 #include "mgm/Namespace.hh"
 #include "common/Logging.hh"
 #include "common/FileId.hh"
+#include "namespace/interface/IFileMDSvc.hh"
 /* -------------------------------------------------------------------------- */
 #include "XrdSys/XrdSysPthread.hh"
 /* -------------------------------------------------------------------------- */
 #include <vector>
 #include <string>
 #include <deque>
+#include <map>
+#include <unordered_map>
 #include <cstring>
 #include <ctime>
 /* -------------------------------------------------------------------------- */
@@ -81,6 +84,96 @@ private:
   uint64_t mCapacity;
 };
 
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Index of transfer candidates per filesystem
+ *
+ * It keeps a bounded sample of (file id, size) pairs for each indexed
+ * filesystem. A filesystem is seeded by the group balancer with a random
+ * sample taken from the namespace and afterwards kept up to date by the
+ * namespace change notifications, so that candidates can be picked without
+ * taking any namespace lock.
+ */
+
+/*----------------------------------------------------------------------------*/
+class GroupCandidateIndex : public eos::IFileMDChangeListener {
+public:
+
+  struct Candidate {
+    eos::common::FileId::fileid_t mFid;
+    uint64_t mSize;
+  };
+
+  GroupCandidateIndex (size_t maxPerFs);
+
+  virtual ~GroupCandidateIndex () { }
+
+  // ---------------------------------------------------------------------------
+  // Namespace change notification - updates the indexed filesystems
+  // ---------------------------------------------------------------------------
+  virtual void fileMDChanged (eos::IFileMDChangeListener::Event* e);
+
+  virtual void
+  fileMDRead (eos::IFileMD* obj) { }
+
+  virtual bool
+  fileMDCheck (eos::IFileMD* obj) {
+    return true;
+  }
+
+  virtual void
+  AddTree (eos::IContainerMD* obj, int64_t dsize) { }
+
+  virtual void
+  RemoveTree (eos::IContainerMD* obj, int64_t dsize) { }
+
+  // ---------------------------------------------------------------------------
+  // Check if a filesystem should be (re-)seeded from the namespace
+  // ---------------------------------------------------------------------------
+  bool needsRefill (eos::IFileMD::location_t fsid, time_t minAge);
+
+  // ---------------------------------------------------------------------------
+  // Replace the sample of a filesystem
+  // ---------------------------------------------------------------------------
+  void refill (eos::IFileMD::location_t fsid,
+               const std::vector<Candidate> &candidates);
+
+  // ---------------------------------------------------------------------------
+  // Remove and return a random candidate of a filesystem which is not
+  // contained in the exclude map
+  // ---------------------------------------------------------------------------
+  bool take (eos::IFileMD::location_t fsid,
+             const std::map<eos::common::FileId::fileid_t, std::string> &exclude,
+             Candidate &candidate);
+
+  size_t
+  maxPerFs () const {
+    return mMaxPerFs;
+  };
+
+private:
+
+  struct FsSample {
+    std::vector<Candidate> mCandidates;
+    /// file id to position in mCandidates
+    std::unordered_map<eos::common::FileId::fileid_t, size_t> mPos;
+    /// last time the sample was seeded from the namespace
+    time_t mLastRefill;
+  };
+
+  void add (FsSample &sample, eos::common::FileId::fileid_t fid,
+            uint64_t size);
+
+  void remove (FsSample &sample, eos::common::FileId::fileid_t fid);
+
+  /// protecting mSamples
+  XrdSysMutex mMutex;
+  /// samples of the indexed filesystems
+  std::unordered_map<eos::IFileMD::location_t, FsSample> mSamples;
+  /// maximum number of candidates kept per filesystem
+  size_t mMaxPerFs;
+};
+
 /*----------------------------------------------------------------------------*/
 /**
  * @brief Class running the balancing among groups
@@ -120,6 +213,8 @@ private:
 
   eos::common::FileId::fileid_t chooseFidFromGroup (FsGroup *group);
 
+  void refreshCandidates (void);
+
   void populateGroupsInfo (void);
 
   void clearCachedSizes (void);
@@ -132,9 +227,11 @@ private:
 
   void prepareTransfers (int nrTransfers);
 
-  void prepareTransfer (void);
+  void publishRate (double rate);
 
-  void scheduleTransfer (eos::common::FileId::fileid_t fid,
+  bool prepareTransfer (void);
+
+  bool scheduleTransfer (eos::common::FileId::fileid_t fid,
                          FsGroup *sourceGroup,
                          FsGroup *targetGroup);
 
@@ -146,6 +243,9 @@ private:
 
 public:
 
+  /// transfer candidates shared by all group balancers
+  static GroupCandidateIndex gCandidateIndex;
+
   // ---------------------------------------------------------------------------
   // Constructor (per space)
   // ---------------------------------------------------------------------------
@@ -32,6 +32,7 @@
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 /*----------------------------------------------------------------------------*/
 #include "XrdSys/XrdSysDNS.hh"
 /*----------------------------------------------------------------------------*/
@@ -45,7 +46,16 @@ const char* Iostat::gIostatPopularity = "iostat::popularity";
 const char* Iostat::gIostatUdpTargetList = "iostat::udptargets";
 
 /* ------------------------------------------------------------------------- */
-Iostat::Iostat ()
+Iostat::Iostat () :
+  mIngestNext(0),
+  mIngestStop(false),
+  mReportsReceived(0),
+  mReportsDropped(0),
+  mReportsDigested(0),
+  mPopularity(IOSTAT_POPULARITY_HISTORY_DAYS, IOSTAT_POPULARITY_TOPK),
+  mStoreGeneration(0),
+  mStoreDeltas(0),
+  mPopularityWindows(IOSTAT_POPULARITY_HISTORY_DAYS)
 {
   mRunning = false;
   mInit = false;
@@ -79,13 +89,6 @@ Iostat::Iostat ()
   IoNodes.insert("cms-cdr"); // CMS DAQ
   IoNodes.insert("pc-tdq"); // ATLAS DAQ
 
-  for (size_t i = 0; i < IOSTAT_POPULARITY_HISTORY_DAYS; i++)
-  {
-    IostatPopularity[i].set_deleted_key("");
-    IostatPopularity[i].resize(100000);
-  }
-
-  IostatLastPopularityBin = 0;
   mReportPopularity = true;
   mReportNamespace = false;
   mReport = true;
@@ -202,6 +205,18 @@ Iostat::Start ()
   if (!mRunning)
   {
     mClient.Subscribe();
+    mIngestStop = false;
+    mIngestNext = 0;
+
+    for (size_t i = 0; i < IOSTAT_INGEST_WORKERS; i++)
+    {
+      if (mIngestQueue.size() <= i)
+        mIngestQueue.push_back(new eos::common::ConcurrentQueue<std::string*>());
+      pthread_t tid;
+      XrdSysThread::Run(&tid, Iostat::StaticIngest, static_cast<void *> (this), XRDSYSTHREAD_HOLD, "Report Ingest Thread");
+      mIngestThreads.push_back(tid);
+    }
+
     XrdSysThread::Run(&thread, Iostat::StaticReceive, static_cast<void *> (this), XRDSYSTHREAD_HOLD, "Report Receiver Thread");
     mRunning = true;
     return true;
@@ -220,6 +235,27 @@ Iostat::Stop ()
   {
     XrdSysThread::Cancel(thread);
     XrdSysThread::Join(thread, NULL);
+
+    // let the ingestion workers merge what they have and exit
+    mIngestStop = true;
+    for (size_t i = 0; i < mIngestQueue.size(); i++)
+    {
+      std::string* flush = 0;
+      mIngestQueue[i]->push(flush);
+    }
+    for (size_t i = 0; i < mIngestThreads.size(); i++)
+    {
+      XrdSysThread::Join(mIngestThreads[i], NULL);
+    }
+    mIngestThreads.clear();
+    for (size_t i = 0; i < mIngestQueue.size(); i++)
+    {
+      std::string* body = 0;
+      while (mIngestQueue[i]->try_pop(body))
+      {
+        delete body;
+      }
+    }
     mRunning = false;
     mClient.Unsubscribe();
     return true;
@@ -240,6 +276,10 @@ Iostat::~Iostat ()
     XrdSysThread::Cancel(cthread);
     XrdSysThread::Join(cthread, NULL);
   }
+  for (size_t i = 0; i < mIngestQueue.size(); i++)
+  {
+    delete mIngestQueue[i];
+  }
 }
 
 /* ------------------------------------------------------------------------- */
@@ -256,10 +296,24 @@ Iostat::StaticCirculate (void* arg)
   return reinterpret_cast<Iostat*> (arg)->Circulate();
 }
 
+/* ------------------------------------------------------------------------- */
+void*
+Iostat::StaticIngest (void* arg)
+{
+  return reinterpret_cast<Iostat*> (arg)->Ingest();
+}
+
 /* ------------------------------------------------------------------------- */
 void*
 Iostat::Receive (void)
 {
+  // ---------------------------------------------------------------------------
+  // ! dequeue report messages, append them to the report log and hand them to
+  // ! the ingestion workers - if a worker queue is full the report is dropped
+  // ---------------------------------------------------------------------------
+  size_t next = 0;
+  std::vector<bool> pending(mIngestQueue.size(), false); // worker got reports since its last flush
+
   while (1)
   {
     XrdMqMessage* newmessage = 0;
@@ -269,114 +323,8 @@ Iostat::Receive (void)
       while (body.replace("&&", "&"))
       {
       }
-      XrdOucEnv ioreport(body.c_str());
-      eos::common::Report* report = new eos::common::Report(ioreport);
-      Add("bytes_read", report->uid, report->gid, report->rb, report->ots, report->cts);
-      Add("bytes_written", report->uid, report->gid, report->wb, report->ots, report->cts);
-      Add("read_calls", report->uid, report->gid, report->nrc, report->ots, report->cts);
-      Add("readv_calls", report->uid, report->gid, report->rv_op, report->ots, report->cts);      
-      Add("write_calls", report->uid, report->gid, report->nwc, report->ots, report->cts);
-      Add("fwd_seeks", report->uid, report->gid, report->nfwds, report->ots, report->cts);
-      Add("bwd_seeks", report->uid, report->gid, report->nbwds, report->ots, report->cts);
-      Add("xl_fwd_seeks", report->uid, report->gid, report->nxlfwds, report->ots, report->cts);
-      Add("xl_bwd_seeks", report->uid, report->gid, report->nxlbwds, report->ots, report->cts);
-      Add("bytes_fwd_seek", report->uid, report->gid, report->sfwdb, report->ots, report->cts);
-      Add("bytes_bwd_wseek", report->uid, report->gid, report->sbwdb, report->ots, report->cts);
-      Add("bytes_xl_fwd_seek", report->uid, report->gid, report->sxlfwdb, report->ots, report->cts);
-      Add("bytes_xl_bwd_wseek", report->uid, report->gid, report->sxlbwdb, report->ots, report->cts);
-      Add("disk_time_read", report->uid, report->gid, (unsigned long long) report->rt, report->ots, report->cts);
-      Add("disk_time_write", report->uid, report->gid, (unsigned long long) report->wt, report->ots, report->cts);
-
-      // do the UDP broadcasting here
-      {
-        XrdSysMutexHelper mLock(BroadcastMutex);
-        if (mUdpPopularityTarget.size())
-        {
-          UdpBroadCast(report);
-        }
-      }
 
-      // do the domain accounting here      
-      if (report->path.substr(0, 11) == "/replicate:")
-      {
-        // check if this is a replication path
-        // push into the 'eos' domain
-        Mutex.Lock();
-        if (report->rb)
-          IostatAvgDomainIOrb["eos"].Add(report->rb, report->ots, report->cts);
-        if (report->wb)
-          IostatAvgDomainIOwb["eos"].Add(report->wb, report->ots, report->cts);
-        Mutex.UnLock();
-      }
-      else
-      {
-        bool dfound = false;
-
-        if (mReportPopularity)
-        {
-          // do the popularity accounting here for everything which is not replication!
-          AddToPopularity(report->path, report->rb, report->ots, report->cts);
-        }
-
-        size_t pos = 0;
-        if ((pos = report->sec_domain.rfind(".")) != std::string::npos)
-        {
-          // we can sort in by domain
-          std::string sdomain = report->sec_domain.substr(pos);
-          if (IoDomains.find(sdomain) != IoDomains.end())
-          {
-            Mutex.Lock();
-            if (report->rb)
-              IostatAvgDomainIOrb[sdomain].Add(report->rb, report->ots, report->cts);
-            if (report->wb)
-              IostatAvgDomainIOwb[sdomain].Add(report->wb, report->ots, report->cts);
-            Mutex.UnLock();
-            dfound = true;
-          }
-        }
-
-        // do the node accounting here - keep the node list small !!!
-        std::set<std::string>::const_iterator nit;
-        for (nit = IoNodes.begin(); nit != IoNodes.end(); nit++)
-        {
-          if (*nit == report->sec_host.substr(0, nit->length()))
-          {
-            Mutex.Lock();
-            if (report->rb)
-              IostatAvgDomainIOrb[*nit].Add(report->rb, report->ots, report->cts);
-            if (report->wb)
-              IostatAvgDomainIOwb[*nit].Add(report->wb, report->ots, report->cts);
-            Mutex.UnLock();
-            dfound = true;
-          }
-        }
-
-        if (!dfound)
-        {
-          // push into the 'other' domain
-          Mutex.Lock();
-          if (report->rb)
-            IostatAvgDomainIOrb["other"].Add(report->rb, report->ots, report->cts);
-          if (report->wb)
-            IostatAvgDomainIOwb["other"].Add(report->wb, report->ots, report->cts);
-          Mutex.UnLock();
-        }
-      }
-
-      // do the application accounting here      
-      std::string apptag = "other";
-      if (report->sec_app.length())
-      {
-        apptag = report->sec_app;
-      }
-
-      // push into the app accounting
-      Mutex.Lock();
-      if (report->rb)
-        IostatAvgAppIOrb[apptag].Add(report->rb, report->ots, report->cts);
-      if (report->wb)
-        IostatAvgAppIOwb[apptag].Add(report->wb, report->ots, report->cts);
-      Mutex.UnLock();
+      mReportsReceived++;
 
       if (mReport)
       {
@@ -430,6 +378,71 @@ Iostat::Receive (void)
         }
       }
 
+      std::string* sbody = new std::string(body.c_str());
+
+      if (!mIngestQueue[next]->push_size(sbody, IOSTAT_INGEST_QUEUE_SIZE))
+      {
+        mReportsDropped++;
+        delete sbody;
+        if (!(mReportsDropped % 10000))
+        {
+          eos_static_warning("report ingestion is falling behind - dropped %llu reports", (unsigned long long) mReportsDropped);
+        }
+      }
+      else
+      {
+        pending[next] = true;
+      }
+
+      next = (next + 1) % mIngestQueue.size();
+      delete newmessage;
+    }
+
+    // nothing pending - ask the workers which got reports to merge their
+    // partial tables
+    for (size_t i = 0; i < mIngestQueue.size(); i++)
+    {
+      if (pending[i])
+      {
+        std::string* flush = 0;
+        mIngestQueue[i]->push(flush);
+        pending[i] = false;
+      }
+    }
+
+    XrdSysThread::SetCancelOn();
+    XrdSysTimer sleeper;
+    sleeper.Snooze(1);
+    XrdSysThread::CancelPoint();
+    XrdSysThread::SetCancelOff();
+
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+void*
+Iostat::Ingest ()
+{
+  // ---------------------------------------------------------------------------
+  // ! parse report bodies and aggregate them into a private partial table,
+  // ! merged into the global tables every IOSTAT_INGEST_MERGE_BATCH reports or
+  // ! when a flush is requested
+  // ---------------------------------------------------------------------------
+  size_t idx = mIngestNext++;
+  IostatPartial partial;
+
+  while (1)
+  {
+    std::string* body = 0;
+    mIngestQueue[idx]->wait_pop(body);
+
+    if (body)
+    {
+      XrdOucEnv ioreport(body->c_str());
+      eos::common::Report* report = new eos::common::Report(ioreport);
+      Digest(report, partial);
+
       if (mReportNamespace)
       {
         // add the record into the report namespace file
@@ -442,25 +455,210 @@ Iostat::Receive (void)
           FILE* freport = fopen(path, "a+");
           if (freport)
           {
-            fprintf(freport, "%s\n", body.c_str());
+            fprintf(freport, "%s\n", body->c_str());
             fclose(freport);
           }
         }
       }
 
       delete report;
-      delete newmessage;
+      delete body;
     }
-    XrdSysThread::SetCancelOn();
-    XrdSysTimer sleeper;
-    sleeper.Snooze(1);
-    XrdSysThread::CancelPoint();
-    XrdSysThread::SetCancelOff();
 
+    if ((!body && partial.nreports) || (partial.nreports >= IOSTAT_INGEST_MERGE_BATCH))
+    {
+      Merge(partial);
+    }
+
+    if (!body && mIngestStop)
+      break;
   }
   return 0;
 }
 
+/* ------------------------------------------------------------------------- */
+void
+Iostat::Digest (eos::common::Report* report, IostatPartial& partial)
+{
+  // ---------------------------------------------------------------------------
+  // ! account a single report into a partial table - no locks are taken except
+  // ! for the UDP broadcast
+  // ---------------------------------------------------------------------------
+  struct
+  {
+    const char* tag;
+    unsigned long long val;
+  } counters[] = {
+    {"bytes_read", report->rb},
+    {"bytes_written", report->wb},
+    {"read_calls", report->nrc},
+    {"readv_calls", report->rv_op},
+    {"write_calls", report->nwc},
+    {"fwd_seeks", report->nfwds},
+    {"bwd_seeks", report->nbwds},
+    {"xl_fwd_seeks", report->nxlfwds},
+    {"xl_bwd_seeks", report->nxlbwds},
+    {"bytes_fwd_seek", report->sfwdb},
+    {"bytes_bwd_wseek", report->sbwdb},
+    {"bytes_xl_fwd_seek", report->sxlfwdb},
+    {"bytes_xl_bwd_wseek", report->sxlbwdb},
+    {"disk_time_read", (unsigned long long) report->rt},
+    {"disk_time_write", (unsigned long long) report->wt}
+  };
+
+  for (size_t i = 0; i < sizeof (counters) / sizeof (counters[0]); i++)
+  {
+    partial.Uid[counters[i].tag][report->uid] += counters[i].val;
+    partial.Gid[counters[i].tag][report->gid] += counters[i].val;
+    partial.AvgUid[counters[i].tag][report->uid].Add(counters[i].val, report->ots, report->cts);
+    partial.AvgGid[counters[i].tag][report->gid].Add(counters[i].val, report->ots, report->cts);
+  }
+
+  // do the UDP broadcasting here
+  {
+    XrdSysMutexHelper mLock(BroadcastMutex);
+    if (mUdpPopularityTarget.size())
+    {
+      UdpBroadCast(report);
+    }
+  }
+
+  // do the domain accounting here
+  if (report->path.substr(0, 11) == "/replicate:")
+  {
+    // check if this is a replication path
+    // push into the 'eos' domain
+    if (report->rb)
+      partial.AvgDomainIOrb["eos"].Add(report->rb, report->ots, report->cts);
+    if (report->wb)
+      partial.AvgDomainIOwb["eos"].Add(report->wb, report->ots, report->cts);
+  }
+  else
+  {
+    bool dfound = false;
+
+    if (mReportPopularity)
+    {
+      // do the popularity accounting here for everything which is not replication!
+      IostatPartial::PopularityRecord record = {report->path, report->rb,
+                                                (time_t) report->ots,
+                                                (time_t) report->cts};
+      partial.Popularity.push_back(record);
+    }
+
+    size_t pos = 0;
+    if ((pos = report->sec_domain.rfind(".")) != std::string::npos)
+    {
+      // we can sort in by domain
+      std::string sdomain = report->sec_domain.substr(pos);
+      if (IoDomains.find(sdomain) != IoDomains.end())
+      {
+        if (report->rb)
+          partial.AvgDomainIOrb[sdomain].Add(report->rb, report->ots, report->cts);
+        if (report->wb)
+          partial.AvgDomainIOwb[sdomain].Add(report->wb, report->ots, report->cts);
+        dfound = true;
+      }
+    }
+
+    // do the node accounting here - keep the node list small !!!
+    std::set<std::string>::const_iterator nit;
+    for (nit = IoNodes.begin(); nit != IoNodes.end(); nit++)
+    {
+      if (*nit == report->sec_host.substr(0, nit->length()))
+      {
+        if (report->rb)
+          partial.AvgDomainIOrb[*nit].Add(report->rb, report->ots, report->cts);
+        if (report->wb)
+          partial.AvgDomainIOwb[*nit].Add(report->wb, report->ots, report->cts);
+        dfound = true;
+      }
+    }
+
+    if (!dfound)
+    {
+      // push into the 'other' domain
+      if (report->rb)
+        partial.AvgDomainIOrb["other"].Add(report->rb, report->ots, report->cts);
+      if (report->wb)
+        partial.AvgDomainIOwb["other"].Add(report->wb, report->ots, report->cts);
+    }
+  }
+
+  // do the application accounting here
+  std::string apptag = "other";
+  if (report->sec_app.length())
+  {
+    apptag = report->sec_app;
+  }
+
+  if (report->rb)
+    partial.AvgAppIOrb[apptag].Add(report->rb, report->ots, report->cts);
+  if (report->wb)
+    partial.AvgAppIOwb[apptag].Add(report->wb, report->ots, report->cts);
+
+  partial.nreports++;
+}
+
+/* ------------------------------------------------------------------------- */
+void
+Iostat::Merge (IostatPartial& partial)
+{
+  // ---------------------------------------------------------------------------
+  // ! merge a partial table into the global tables taking the mutex only once
+  // ---------------------------------------------------------------------------
+  Mutex.Lock();
+  for (auto tit = partial.Uid.begin(); tit != partial.Uid.end(); ++tit)
+  {
+    google::sparse_hash_map<uid_t, unsigned long long>& tag = IostatUid[tit->first];
+    std::set<uid_t>& dirty = IostatUidDirty[tit->first];
+    for (auto it = tit->second.begin(); it != tit->second.end(); ++it)
+    {
+      tag[it->first] += it->second;
+      dirty.insert(it->first);
+    }
+  }
+  for (auto tit = partial.Gid.begin(); tit != partial.Gid.end(); ++tit)
+  {
+    google::sparse_hash_map<gid_t, unsigned long long>& tag = IostatGid[tit->first];
+    std::set<gid_t>& dirty = IostatGidDirty[tit->first];
+    for (auto it = tit->second.begin(); it != tit->second.end(); ++it)
+    {
+      tag[it->first] += it->second;
+      dirty.insert(it->first);
+    }
+  }
+  for (auto tit = partial.AvgUid.begin(); tit != partial.AvgUid.end(); ++tit)
+  {
+    google::sparse_hash_map<uid_t, IostatAvg>& tag = IostatAvgUid[tit->first];
+    for (auto it = tit->second.begin(); it != tit->second.end(); ++it)
+      tag[it->first].Merge(it->second);
+  }
+  for (auto tit = partial.AvgGid.begin(); tit != partial.AvgGid.end(); ++tit)
+  {
+    google::sparse_hash_map<gid_t, IostatAvg>& tag = IostatAvgGid[tit->first];
+    for (auto it = tit->second.begin(); it != tit->second.end(); ++it)
+      tag[it->first].Merge(it->second);
+  }
+  for (auto it = partial.AvgDomainIOrb.begin(); it != partial.AvgDomainIOrb.end(); ++it)
+    IostatAvgDomainIOrb[it->first].Merge(it->second);
+  for (auto it = partial.AvgDomainIOwb.begin(); it != partial.AvgDomainIOwb.end(); ++it)
+    IostatAvgDomainIOwb[it->first].Merge(it->second);
+  for (auto it = partial.AvgAppIOrb.begin(); it != partial.AvgAppIOrb.end(); ++it)
+    IostatAvgAppIOrb[it->first].Merge(it->second);
+  for (auto it = partial.AvgAppIOwb.begin(); it != partial.AvgAppIOwb.end(); ++it)
+    IostatAvgAppIOwb[it->first].Merge(it->second);
+  Mutex.UnLock();
+
+  for (auto it = partial.Popularity.begin(); it != partial.Popularity.end(); ++it)
+  {
+    AddToPopularity(it->path, it->rb, it->starttime, it->stoptime);
+  }
+
+  mReportsDigested += partial.nreports;
+  partial.Clear();
+}
+
 /* ------------------------------------------------------------------------- */
 void
 Iostat::PrintOut (XrdOucString &out, bool summary, bool details,
@@ -525,6 +723,30 @@ Iostat::PrintOut (XrdOucString &out, bool summary, bool details,
       out += outline;
     }
 
+    {
+      // report ingestion pipeline statistics
+      size_t queued = 0;
+      for (size_t i = 0; i < mIngestQueue.size(); i++)
+      {
+        queued += mIngestQueue[i]->size();
+      }
+
+      if (!monitoring)
+      {
+        out += "# -----------------------------------------------------------------------------------------------------------\n";
+        snprintf(outline, sizeof (outline) - 1, "ALL        %-32s received=%llu digested=%llu dropped=%llu queued=%llu\n", "report_ingestion",
+                 (unsigned long long) mReportsReceived, (unsigned long long) mReportsDigested,
+                 (unsigned long long) mReportsDropped, (unsigned long long) queued);
+      }
+      else
+      {
+        snprintf(outline, sizeof (outline) - 1, "uid=all gid=all measurement=report_ingestion received=%llu digested=%llu dropped=%llu queued=%llu\n",
+                 (unsigned long long) mReportsReceived, (unsigned long long) mReportsDigested,
+                 (unsigned long long) mReportsDropped, (unsigned long long) queued);
+      }
+      out += outline;
+    }
+
     {
       XrdSysMutexHelper mLock(BroadcastMutex);
       std::set<std::string>::const_iterator it;
@@ -939,7 +1161,7 @@ Iostat::PrintNs (XrdOucString &out, XrdOucString option)
   // ! compute and printout the namespace popularity ranking
   // ---------------------------------------------------------------------------
   size_t limit = 10;
-  size_t popularitybin = (((time(NULL))) % (IOSTAT_POPULARITY_DAY * IOSTAT_POPULARITY_HISTORY_DAYS)) / IOSTAT_POPULARITY_DAY;
+  time_t today = time(NULL) / IOSTAT_POPULARITY_DAY;
   size_t days = 1;
   time_t tmarker = time(NULL) / IOSTAT_POPULARITY_DAY*IOSTAT_POPULARITY_DAY;
 
@@ -1163,16 +1385,19 @@ Iostat::PrintNs (XrdOucString &out, XrdOucString option)
 
   for (size_t pbin = 0; pbin < days; pbin++)
   {
-    PopularityMutex.Lock();
-    size_t sbin = (IOSTAT_POPULARITY_HISTORY_DAYS + popularitybin - pbin) % IOSTAT_POPULARITY_HISTORY_DAYS;
-    google::sparse_hash_map<std::string, struct Popularity>::const_iterator it;
+    // only the requested top entries are extracted and sorted
+    std::vector<IostatPopularity::Entry> popularity_nread;
+    std::vector<IostatPopularity::Entry> popularity_rb;
 
-    std::vector<popularity_t> popularity_nread(IostatPopularity[sbin].begin(), IostatPopularity[sbin].end());
-    std::vector<popularity_t> popularity_rb(IostatPopularity[sbin].begin(), IostatPopularity[sbin].end());
+    if (bycount)
+    {
+      mPopularity.GetTop(today - pbin, false, limit, popularity_nread);
+    }
 
-    // sort them (backwards) by rb or nread
-    std::sort(popularity_nread.begin(), popularity_nread.end(), PopularityCmp_nread());
-    std::sort(popularity_rb.begin(), popularity_rb.end(), PopularityCmp_rb());
+    if (bybytes)
+    {
+      mPopularity.GetTop(today - pbin, true, limit, popularity_rb);
+    }
 
     XrdOucString marker = "<today>";
     if (pbin == 1)
@@ -1200,7 +1425,7 @@ Iostat::PrintNs (XrdOucString &out, XrdOucString option)
       marker = "<6 days ago>";
     }
 
-    std::vector<popularity_t>::const_iterator popit;
+    std::vector<IostatPopularity::Entry>::const_iterator popit;
 
     if (bycount)
     {
@@ -1222,15 +1447,15 @@ Iostat::PrintNs (XrdOucString &out, XrdOucString option)
           break;
         char line[4096];
         char nr[256];
-        snprintf(nr, sizeof (nr) - 1, "%u", popit->second.nread);
+        snprintf(nr, sizeof (nr) - 1, "%u", popit->mNread);
         if (monitoring)
         {
-          snprintf(line, sizeof (line) - 1, "measurement=popularitybyaccess time=%u rank=%d nread=%u rb=%llu path=%s\n", (unsigned int) tmarker, (int) cnt, popit->second.nread, popit->second.rb, popit->first.c_str());
+          snprintf(line, sizeof (line) - 1, "measurement=popularitybyaccess time=%u rank=%d nread=%u rb=%llu path=%s\n", (unsigned int) tmarker, (int) cnt, popit->mNread, popit->mRb, popit->mPath.c_str());
         }
         else
         {
           XrdOucString sizestring;
-          snprintf(line, sizeof (line) - 1, "%06d nread=%-7s rb=%-10s %-64s\n", (int) cnt, nr, eos::common::StringConversion::GetReadableSizeString(sizestring, popit->second.rb, "B"), popit->first.c_str());
+          snprintf(line, sizeof (line) - 1, "%06d nread=%-7s rb=%-10s %-64s\n", (int) cnt, nr, eos::common::StringConversion::GetReadableSizeString(sizestring, popit->mRb, "B"), popit->mPath.c_str());
         }
         out += line;
       }
@@ -1254,36 +1479,183 @@ Iostat::PrintNs (XrdOucString &out, XrdOucString option)
           break;
         char line[4096];
         char nr[256];
-        snprintf(nr, sizeof (nr) - 1, "%u", popit->second.nread);
+        snprintf(nr, sizeof (nr) - 1, "%u", popit->mNread);
         if (monitoring)
         {
-          snprintf(line, sizeof (line) - 1, "measurement=popularitybyvolume time=%u rank=%d nread=%u rb=%llu path=%s\n", (unsigned int) tmarker, (int) cnt, popit->second.nread, popit->second.rb, popit->first.c_str());
+          snprintf(line, sizeof (line) - 1, "measurement=popularitybyvolume time=%u rank=%d nread=%u rb=%llu path=%s\n", (unsigned int) tmarker, (int) cnt, popit->mNread, popit->mRb, popit->mPath.c_str());
         }
         else
         {
           XrdOucString sizestring;
-          snprintf(line, sizeof (line) - 1, "%06d rb=%-10s nread=%-7s %-64s\n", (int) cnt, eos::common::StringConversion::GetReadableSizeString(sizestring, popit->second.rb, "B"), nr, popit->first.c_str());
+          snprintf(line, sizeof (line) - 1, "%06d rb=%-10s nread=%-7s %-64s\n", (int) cnt, eos::common::StringConversion::GetReadableSizeString(sizestring, popit->mRb, "B"), nr, popit->mPath.c_str());
         }
         out += line;
       }
     }
-
-    PopularityMutex.UnLock();
   }
 }
 
+//------------------------------------------------------------------------------
+// Binary record helpers for the counter checkpoint and delta journal. A record
+// is <kind:u8><taglen:u16><tag><id:u32><val:u64> with kind 0=uid and 1=gid.
+//------------------------------------------------------------------------------
+static const char* sIostatMagic = "EOSIOST1";
+
+static bool
+IostatWriteHeader (FILE* fout, unsigned long long generation)
+{
+  return ((fwrite(sIostatMagic, 8, 1, fout) == 1) &&
+          (fwrite(&generation, sizeof (generation), 1, fout) == 1));
+}
+
+static bool
+IostatReadHeader (FILE* fin, unsigned long long& generation)
+{
+  char magic[8];
+  return ((fread(magic, sizeof (magic), 1, fin) == 1) &&
+          (!memcmp(magic, sIostatMagic, sizeof (magic))) &&
+          (fread(&generation, sizeof (generation), 1, fin) == 1));
+}
+
+static bool
+IostatWriteRecord (FILE* fout, uint8_t kind, const std::string& tag,
+                   uint32_t id, unsigned long long val)
+{
+  uint16_t len = tag.length();
+  uint64_t v = val;
+  return ((fwrite(&kind, sizeof (kind), 1, fout) == 1) &&
+          (fwrite(&len, sizeof (len), 1, fout) == 1) &&
+          (fwrite(tag.c_str(), 1, len, fout) == len) &&
+          (fwrite(&id, sizeof (id), 1, fout) == 1) &&
+          (fwrite(&v, sizeof (v), 1, fout) == 1));
+}
+
+static bool
+IostatReadRecord (FILE* fin, uint8_t& kind, std::string& tag, uint32_t& id,
+                  unsigned long long& val)
+{
+  uint16_t len = 0;
+  uint64_t v = 0;
+
+  if ((fread(&kind, sizeof (kind), 1, fin) != 1) ||
+      (fread(&len, sizeof (len), 1, fin) != 1))
+    return false;
+
+  tag.resize(len);
+
+  if ((len && (fread(&tag[0], 1, len, fin) != len)) ||
+      (fread(&id, sizeof (id), 1, fin) != 1) ||
+      (fread(&v, sizeof (v), 1, fin) != 1))
+    return false;
+
+  val = v;
+  return true;
+}
+
 /* ------------------------------------------------------------------------- */
 bool
 Iostat::Store ()
 {
   // ---------------------------------------------------------------------------
-  // ! save current uid/gid counters to a dump file
+  // ! append the uid/gid counters which changed since the last call to the
+  // ! delta journal - once the journal holds more records than there are
+  // ! counters a new full checkpoint is written instead
   // ---------------------------------------------------------------------------
-  XrdOucString tmpname = mStoreFileName;
   if (!mStoreFileName.length())
     return false;
 
+  struct delta_t
+  {
+    uint8_t kind;
+    std::string tag;
+    uint32_t id;
+    unsigned long long val;
+  };
+
+  std::vector<delta_t> deltas;
+  size_t ncounters = 0;
+  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >::iterator tit;
+
+  Mutex.Lock();
+  for (uint8_t kind = 0; kind < 2; kind++)
+  {
+    google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >& current = kind ? IostatGid : IostatUid;
+    std::map<std::string, std::set<uid_t> >& dirty = kind ? IostatGidDirty : IostatUidDirty;
+
+    for (tit = current.begin(); tit != current.end(); ++tit)
+      ncounters += tit->second.size();
+
+    for (auto dit = dirty.begin(); dit != dirty.end(); ++dit)
+    {
+      google::sparse_hash_map<uid_t, unsigned long long>& tag = current[dit->first];
+
+      for (auto it = dit->second.begin(); it != dit->second.end(); ++it)
+      {
+        delta_t delta = {kind, dit->first, (uint32_t) * it, tag[*it]};
+        deltas.push_back(delta);
+      }
+    }
+
+    dirty.clear();
+  }
+  Mutex.UnLock();
+
+  bool ok = true;
+
+  if (mStoreGeneration && (mStoreDeltas + deltas.size() <= ncounters))
+  {
+    if (deltas.size())
+    {
+      XrdOucString journal = mStoreFileName;
+      journal += ".delta";
+      FILE* fout = fopen(journal.c_str(), "a");
+
+      if (fout)
+      {
+        for (size_t i = 0; ok && (i < deltas.size()); i++)
+        {
+          ok = IostatWriteRecord(fout, deltas[i].kind, deltas[i].tag,
+                                 deltas[i].id, deltas[i].val);
+        }
+
+        ok &= (fclose(fout) == 0);
+        mStoreDeltas += deltas.size();
+      }
+      else
+      {
+        ok = false;
+      }
+
+      // the deltas are gone, so the next call writes a full checkpoint
+      if (!ok)
+        mStoreGeneration = 0;
+    }
+  }
+  else
+  {
+    ok = StoreCheckpoint();
+  }
+
+  if (mPopularity.IsDirty())
+  {
+    ok &= StorePopularity();
+  }
+
+  return ok;
+}
+
+/* ------------------------------------------------------------------------- */
+bool
+Iostat::StoreCheckpoint ()
+{
+  // ---------------------------------------------------------------------------
+  // ! write all uid/gid counters to a binary checkpoint and start a new journal
+  // ---------------------------------------------------------------------------
+  XrdOucString tmpname = mStoreFileName;
+  XrdOucString journal = mStoreFileName;
   tmpname += ".tmp";
+  journal += ".delta";
+  unsigned long long generation = std::max((unsigned long long) time(NULL), mStoreGeneration + 1);
   FILE* fout = fopen(tmpname.c_str(), "w+");
   if (!fout)
     return false;
@@ -1294,31 +1666,92 @@ Iostat::Store ()
     return false;
   }
 
-  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >::iterator tuit;
-  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >::iterator tgit;
+  bool ok = IostatWriteHeader(fout, generation);
+  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >::iterator tit;
+
   Mutex.Lock();
-  // store user counters
-  for (tuit = IostatUid.begin(); tuit != IostatUid.end(); tuit++)
+  for (uint8_t kind = 0; ok && (kind < 2); kind++)
   {
-    google::sparse_hash_map<uid_t, unsigned long long>::iterator it;
-    for (it = tuit->second.begin(); it != tuit->second.end(); ++it)
+    google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >& current = kind ? IostatGid : IostatUid;
+
+    for (tit = current.begin(); ok && (tit != current.end()); ++tit)
     {
-      fprintf(fout, "tag=%s&uid=%u&val=%llu\n", tuit->first.c_str(), it->first, it->second);
+      google::sparse_hash_map<uid_t, unsigned long long>::iterator it;
+
+      for (it = tit->second.begin(); ok && (it != tit->second.end()); ++it)
+      {
+        ok = IostatWriteRecord(fout, kind, tit->first, it->first, it->second);
+      }
     }
   }
-  // store group counter
-  for (tgit = IostatGid.begin(); tgit != IostatGid.end(); tgit++)
+
+  IostatUidDirty.clear();
+  IostatGidDirty.clear();
+  Mutex.UnLock();
+
+  ok &= (fclose(fout) == 0);
+
+  if (!ok || rename(tmpname.c_str(), mStoreFileName.c_str()))
   {
-    google::sparse_hash_map<uid_t, unsigned long long>::iterator it;
-    for (it = tgit->second.begin(); it != tgit->second.end(); ++it)
-    {
-      fprintf(fout, "tag=%s&gid=%u&val=%llu\n", tgit->first.c_str(), it->first, it->second);
-    }
+    // force a full checkpoint on the next call
+    mStoreGeneration = 0;
+    return false;
   }
-  Mutex.UnLock();
 
-  fclose(fout);
-  return (rename(tmpname.c_str(), mStoreFileName.c_str()) ? false : true);
+  // the new journal is tagged with the generation of the checkpoint so that a
+  // stale journal is never replayed on top of a newer checkpoint
+  fout = fopen(journal.c_str(), "w");
+  if (!fout || !IostatWriteHeader(fout, generation) || fclose(fout))
+  {
+    mStoreGeneration = 0;
+    return false;
+  }
+
+  mStoreGeneration = generation;
+  mStoreDeltas = 0;
+  return true;
+}
+
+/* ------------------------------------------------------------------------- */
+bool
+Iostat::StorePopularity ()
+{
+  // ---------------------------------------------------------------------------
+  // ! append the popularity windows changed since the last call to the
+  // ! popularity checkpoint - once more windows were appended than the
+  // ! history holds, a new full checkpoint is written instead
+  // ---------------------------------------------------------------------------
+  XrdOucString popname = mStoreFileName;
+  popname += ".popularity";
+  size_t nwindows = 0;
+
+  if (mPopularityWindows < mPopularity.GetNumWindows())
+  {
+    FILE* fout = fopen(popname.c_str(), "a");
+    bool ok = fout && mPopularity.Checkpoint(fout, false, nwindows);
+
+    if (fout)
+      ok &= (fclose(fout) == 0);
+
+    mPopularityWindows = ok ? (mPopularityWindows + nwindows) :
+                         mPopularity.GetNumWindows();
+    return ok;
+  }
+
+  XrdOucString tmpname = popname;
+  tmpname += ".tmp";
+  FILE* fout = fopen(tmpname.c_str(), "w+");
+  if (!fout)
+    return false;
+
+  bool ok = mPopularity.Checkpoint(fout, true, nwindows);
+  ok &= (fclose(fout) == 0);
+  ok = (ok && !rename(tmpname.c_str(), popname.c_str()));
+
+  if (ok)
+    mPopularityWindows = 0;
+
+  return ok;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1326,7 +1759,8 @@ bool
 Iostat::Restore ()
 {
   // ---------------------------------------------------------------------------
-  // ! load current uid/gid counters from a dump file
+  // ! load current uid/gid counters from the checkpoint and the delta journal,
+  // ! dump files written in the legacy text format are still understood
   // ---------------------------------------------------------------------------
   if (!mStoreFileName.length())
     return false;
@@ -1335,29 +1769,91 @@ Iostat::Restore ()
   if (!fin)
     return false;
 
+  unsigned long long generation = 0;
+  uint8_t kind;
+  std::string tag;
+  uint32_t id;
+  unsigned long long val;
+
   Mutex.Lock();
-  int item = 0;
-  char line[16384];
-  while ((item = fscanf(fin, "%s\n", line)) == 1)
+  if (IostatReadHeader(fin, generation))
   {
-    XrdOucEnv env(line);
-    if (env.Get("tag") && env.Get("uid") && env.Get("val"))
+    while (IostatReadRecord(fin, kind, tag, id, val))
+    {
+      if (kind)
+        IostatGid[tag][id] = val;
+      else
+        IostatUid[tag][id] = val;
+    }
+
+    XrdOucString journal = mStoreFileName;
+    journal += ".delta";
+    FILE* fjournal = fopen(journal.c_str(), "r");
+    unsigned long long jgeneration = 0;
+
+    if (fjournal)
     {
-      std::string tag = env.Get("tag");
-      uid_t uid = atoi(env.Get("uid"));
-      unsigned long long val = strtoull(env.Get("val"), 0, 10);
-      IostatUid[tag][uid] = val;
+      if (IostatReadHeader(fjournal, jgeneration) && (jgeneration == generation))
+      {
+        while (IostatReadRecord(fjournal, kind, tag, id, val))
+        {
+          if (kind)
+            IostatGid[tag][id] = val;
+          else
+            IostatUid[tag][id] = val;
+        }
+      }
+      fclose(fjournal);
     }
-    if (env.Get("tag") && env.Get("gid") && env.Get("val"))
+  }
+  else
+  {
+    // legacy text dump
+    rewind(fin);
+    int item = 0;
+    char line[16384];
+    while ((item = fscanf(fin, "%s\n", line)) == 1)
     {
-      std::string tag = env.Get("tag");
-      gid_t gid = atoi(env.Get("gid"));
-      unsigned long long val = strtoull(env.Get("val"), 0, 10);
-      IostatGid[tag][gid] = val;
+      XrdOucEnv env(line);
+      if (env.Get("tag") && env.Get("uid") && env.Get("val"))
+      {
+        std::string tag = env.Get("tag");
+        uid_t uid = atoi(env.Get("uid"));
+        unsigned long long val = strtoull(env.Get("val"), 0, 10);
+        IostatUid[tag][uid] = val;
+      }
+      if (env.Get("tag") && env.Get("gid") && env.Get("val"))
+      {
+        std::string tag = env.Get("tag");
+        gid_t gid = atoi(env.Get("gid"));
+        unsigned long long val = strtoull(env.Get("val"), 0, 10);
+        IostatGid[tag][gid] = val;
+      }
     }
   }
+  // the next Store writes a fresh checkpoint including the replayed deltas
+  IostatUidDirty.clear();
+  IostatGidDirty.clear();
+  mStoreGeneration = 0;
+  mStoreDeltas = 0;
   Mutex.UnLock();
   fclose(fin);
+
+  XrdOucString popname = mStoreFileName;
+  popname += ".popularity";
+  FILE* fpop = fopen(popname.c_str(), "r");
+
+  if (fpop)
+  {
+    if (!mPopularity.Restore(fpop))
+    {
+      eos_static_err("failed to restore popularity from <%s>", popname.c_str());
+    }
+    fclose(fpop);
+    // the next Store compacts the appended windows into a full checkpoint
+    mPopularityWindows = mPopularity.GetNumWindows();
+  }
+
   return true;
 }
 
@@ -1484,16 +1980,7 @@ Iostat::Circulate ()
 
     Mutex.UnLock();
 
-    size_t popularitybin = (((time(NULL))) % (IOSTAT_POPULARITY_DAY * IOSTAT_POPULARITY_HISTORY_DAYS)) / IOSTAT_POPULARITY_DAY;
-    if (IostatLastPopularityBin != popularitybin)
-    {
-      // only if we enter a new bin we erase it 
-      PopularityMutex.Lock();
-      IostatPopularity[popularitybin].clear();
-      IostatPopularity[popularitybin].resize(10000);
-      IostatLastPopularityBin = popularitybin;
-      PopularityMutex.UnLock();
-    }
+    // popularity windows are recycled by the popularity engine itself
     XrdSysThread::CancelPoint();
   }
   return 0;
@@ -31,10 +31,15 @@
 #include "common/FileId.hh"
 #include "common/Path.hh"
 #include "common/Report.hh"
+#include "common/ConcurrentQueue.hh"
+#include "mgm/IostatPopularity.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdSys/XrdSysPthread.hh"
 /*----------------------------------------------------------------------------*/
 #include <google/sparse_hash_map>
+#include <atomic>
+#include <map>
+#include <vector>
 #include <sys/types.h>
 #include <string>
 #include <set>
@@ -50,6 +55,39 @@ EOSMGMNAMESPACE_BEGIN
 // define the history in days we want to do popularity tracking
 #define IOSTAT_POPULARITY_HISTORY_DAYS 7 
 #define IOSTAT_POPULARITY_DAY 86400
+// define the number of paths ranked per day in the popularity tracking
+#define IOSTAT_POPULARITY_TOPK 100000
+// define the number of report ingestion workers
+#define IOSTAT_INGEST_WORKERS 4
+// define the maximum number of reports queued per ingestion worker
+#define IOSTAT_INGEST_QUEUE_SIZE 50000
+// define the number of reports a worker aggregates before merging
+#define IOSTAT_INGEST_MERGE_BATCH 512
+
+class IostatSamples
+{
+  // -------------------------------------------------------------
+  // ! measurements kept by the ingestion workers until they are
+  // ! binned into an IostatAvg by their own time stamps at merge time
+  // -------------------------------------------------------------
+public:
+
+  struct Sample
+  {
+    unsigned long val;
+    time_t starttime;
+    time_t stoptime;
+  };
+
+  std::vector<Sample> samples;
+
+  void
+  Add (unsigned long val, time_t starttime, time_t stoptime)
+  {
+    Sample sample = {val, starttime, stoptime};
+    samples.push_back(sample);
+  }
+};
 
 class IostatAvg
 {
@@ -138,6 +176,13 @@ public:
     }
   }
 
+  void
+  Merge (const IostatSamples& other)
+  {
+    for (size_t i = 0; i < other.samples.size(); i++)
+      Add(other.samples[i].val, other.samples[i].starttime, other.samples[i].stoptime);
+  }
+
   void
   StampZero ()
   {
@@ -212,43 +257,78 @@ private:
   std::set<std::string> IoNodes;
 
   // -----------------------------------------------------------
-  // here we handle the popularity history for the last 7+1 days
-  // ----------------------------------------------------------- 
-
-  XrdSysMutex PopularityMutex;
+  // report ingestion pipeline: the receiver thread only dequeues
+  // messages and hands the bodies to the ingestion workers which
+  // parse them and aggregate into a private partial table that is
+  // merged into the tables above once per batch
+  // -----------------------------------------------------------
 
-  struct Popularity
+  struct IostatPartial
   {
-    unsigned int nread;
-    unsigned long long rb;
-  };
-
-  size_t IostatLastPopularityBin; // this points to the bin which was last used in IostatPopularity
-
-  google::sparse_hash_map<std::string, struct Popularity> IostatPopularity[ IOSTAT_POPULARITY_HISTORY_DAYS ];
+    std::map<std::string, std::map<uid_t, unsigned long long> > Uid;
+    std::map<std::string, std::map<gid_t, unsigned long long> > Gid;
+    std::map<std::string, std::map<uid_t, IostatSamples> > AvgUid;
+    std::map<std::string, std::map<gid_t, IostatSamples> > AvgGid;
+    std::map<std::string, IostatSamples> AvgDomainIOrb;
+    std::map<std::string, IostatSamples> AvgDomainIOwb;
+    std::map<std::string, IostatSamples> AvgAppIOrb;
+    std::map<std::string, IostatSamples> AvgAppIOwb;
+
+    struct PopularityRecord
+    {
+      std::string path;
+      unsigned long long rb;
+      time_t starttime;
+      time_t stoptime;
+    };
 
-  typedef std::pair<std::string, struct Popularity> popularity_t;
+    std::vector<PopularityRecord> Popularity;
+    size_t nreports;
 
-  struct PopularityCmp_nread
-  {
+    IostatPartial () : nreports(0) { }
 
-    bool operator() (popularity_t const &l, popularity_t const &r)
+    void
+    Clear ()
     {
-      if (l.second.nread == r.second.nread) return (l.first < r.first);
-      return l.second.nread > r.second.nread;
+      Uid.clear();
+      Gid.clear();
+      AvgUid.clear();
+      AvgGid.clear();
+      AvgDomainIOrb.clear();
+      AvgDomainIOwb.clear();
+      AvgAppIOrb.clear();
+      AvgAppIOwb.clear();
+      Popularity.clear();
+      nreports = 0;
     }
   };
 
-  struct PopularityCmp_rb
-  {
+  std::vector<eos::common::ConcurrentQueue<std::string*>*> mIngestQueue; // one queue per worker, 0 is a flush request
+  std::vector<pthread_t> mIngestThreads; // ingestion worker threads
+  std::atomic<size_t> mIngestNext; // index given to the next starting worker
+  std::atomic<bool> mIngestStop; // tells the ingestion workers to exit
+  std::atomic<unsigned long long> mReportsReceived; // reports taken from the MQ
+  std::atomic<unsigned long long> mReportsDropped; // reports dropped since the worker queue was full
+  std::atomic<unsigned long long> mReportsDigested; // reports parsed and accounted
 
-    bool operator() (popularity_t const &l, popularity_t const &r)
-    {
-      if (l.second.rb == r.second.rb) return (l.first < r.first);
-      return l.second.rb > r.second.rb;
-    }
-  };
+  void Digest (eos::common::Report* report, IostatPartial& partial); // account one report into a partial table
+  void Merge (IostatPartial& partial); // merge a partial table into the global tables and clear it
 
+  // -----------------------------------------------------------
+  // here we handle the popularity history for the last 7 days
+  // ----------------------------------------------------------- 
+
+  IostatPopularity mPopularity; // approximate top-K rankings per day
+
+  // -----------------------------------------------------------
+  // counters changed since the last Store, used to write deltas
+  // -----------------------------------------------------------
+
+  std::map<std::string, std::set<uid_t> > IostatUidDirty;
+  std::map<std::string, std::set<gid_t> > IostatGidDirty;
+  unsigned long long mStoreGeneration; // generation of the last full checkpoint
+  unsigned long long mStoreDeltas; // number of delta records since the last full checkpoint
+  size_t mPopularityWindows; // number of popularity windows appended since the last full checkpoint
 
   bool mReport; // indicates if we store reports to the local report store
 
@@ -264,6 +344,9 @@ private:
   XrdOucString mUdpPopularityTargetList; // contains the string describing the set above for the configuration store
   XrdOucString mStoreFileName; // file name where a dump is loaded/saved in Restore/Store
 
+  bool StoreCheckpoint (); // write a full binary checkpoint and start a new delta journal
+  bool StorePopularity (); // write the popularity checkpoint
+
 
 public:
   // configuration keys used in config key-val store
@@ -293,8 +376,8 @@ public:
     return Restore ();
   }
 
-  bool Store ();
-  bool Restore ();
+  bool Store (); // persist the counters changed since the last call and the popularity
+  bool Restore (); // load counters (binary checkpoint + delta journal or legacy text dump) and popularity
 
   void StartCirculate ();
   bool Start ();
@@ -318,24 +401,16 @@ public:
 
   static void* StaticReceive (void*);
   static void* StaticCirculate (void*);
+  static void* StaticIngest (void*);
   void* Receive ();
+  void* Ingest ();
 
   static bool NamespaceReport (const char* path, XrdOucString &stdOut, XrdOucString &stdErr);
 
   void
   AddToPopularity (std::string path, unsigned long long rb, time_t starttime, time_t stoptime)
   {
-    size_t popularitybin = (((starttime + stoptime) / 2) % (IOSTAT_POPULARITY_DAY * IOSTAT_POPULARITY_HISTORY_DAYS)) / IOSTAT_POPULARITY_DAY;
-    PopularityMutex.Lock ();
-    eos::common::Path cPath (path.c_str ());
-    for (size_t k = 0; k < cPath.GetSubPathSize (); k++)
-    {
-      std::string sp = cPath.GetSubPath (k);
-      IostatPopularity[popularitybin][sp].rb += rb;
-      IostatPopularity[popularitybin][sp].nread++;
-    }
-    IostatLastPopularityBin = popularitybin;
-    PopularityMutex.UnLock ();
+    mPopularity.Add(((starttime + stoptime) / 2) / IOSTAT_POPULARITY_DAY, path, rb);
   }
 
   // stats collection
@@ -346,6 +421,8 @@ public:
     Mutex.Lock ();
     IostatUid[tag][uid] += val;
     IostatGid[tag][gid] += val;
+    IostatUidDirty[tag].insert(uid);
+    IostatGidDirty[tag].insert(gid);
     IostatAvgUid[tag][uid].Add (val, starttime, stoptime);
     IostatAvgGid[tag][gid].Add (val, starttime, stoptime);
     Mutex.UnLock ();
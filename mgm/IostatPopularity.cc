@@ -0,0 +1,496 @@
+// ----------------------------------------------------------------------
+// File: IostatPopularity.cc
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/IostatPopularity.hh"
+#include "common/Path.hh"
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cstring>
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+const uint32_t PathInterner::sInvalid;
+const char* IostatPopularity::sMagic = "EOSPOP01";
+
+//------------------------------------------------------------------------------
+// Find interned path
+//------------------------------------------------------------------------------
+uint32_t
+PathInterner::Find (const std::string& path) const
+{
+  auto it = mIndex.find(path);
+  return (it == mIndex.end()) ? sInvalid : it->second;
+}
+
+//------------------------------------------------------------------------------
+// Intern path and take a reference
+//------------------------------------------------------------------------------
+uint32_t
+PathInterner::Acquire (const std::string& path)
+{
+  auto it = mIndex.find(path);
+
+  if (it != mIndex.end())
+  {
+    mSlots[it->second].mRefs++;
+    return it->second;
+  }
+
+  uint32_t id;
+
+  if (mFree.size())
+  {
+    id = mFree.back();
+    mFree.pop_back();
+  }
+  else
+  {
+    id = mSlots.size();
+    mSlots.push_back(Slot());
+  }
+
+  mSlots[id].mPath = path;
+  mSlots[id].mRefs = 1;
+  mIndex[path] = id;
+  return id;
+}
+
+//------------------------------------------------------------------------------
+// Drop a reference
+//------------------------------------------------------------------------------
+void
+PathInterner::Release (uint32_t id)
+{
+  if ((id >= mSlots.size()) || !mSlots[id].mRefs)
+    return;
+
+  if (--mSlots[id].mRefs == 0)
+  {
+    mIndex.erase(mSlots[id].mPath);
+    std::string().swap(mSlots[id].mPath);
+    mFree.push_back(id);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Increment tracked key
+//------------------------------------------------------------------------------
+bool
+TopKSketch::Increment (uint32_t key, uint64_t weight, uint64_t other)
+{
+  auto it = mPos.find(key);
+
+  if (it == mPos.end())
+    return false;
+
+  size_t pos = it->second;
+  mHeap[pos].mWeight += weight;
+  mHeap[pos].mOther += other;
+  SiftDown(pos);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Insert untracked key
+//------------------------------------------------------------------------------
+uint32_t
+TopKSketch::Insert (uint32_t key, uint64_t weight, uint64_t other)
+{
+  if (!mCapacity)
+    return key;
+
+  if (mHeap.size() < mCapacity)
+  {
+    Counter counter = {key, weight, 0, other};
+    mHeap.push_back(counter);
+    mPos[key] = mHeap.size() - 1;
+    SiftUp(mHeap.size() - 1);
+    return PathInterner::sInvalid;
+  }
+
+  // Replace the smallest counter, the new key inherits its weight as error
+  Counter& min = mHeap[0];
+  uint32_t evicted = min.mKey;
+  mPos.erase(evicted);
+  min.mKey = key;
+  min.mError = min.mWeight;
+  min.mWeight += weight;
+  min.mOther = other;
+  mPos[key] = 0;
+  SiftDown(0);
+  return evicted;
+}
+
+//------------------------------------------------------------------------------
+// Load counter from checkpoint
+//------------------------------------------------------------------------------
+uint32_t
+TopKSketch::Load (const Counter& counter)
+{
+  if (!mCapacity || mPos.count(counter.mKey))
+    return counter.mKey;
+
+  if (mHeap.size() < mCapacity)
+  {
+    mHeap.push_back(counter);
+    mPos[counter.mKey] = mHeap.size() - 1;
+    SiftUp(mHeap.size() - 1);
+    return PathInterner::sInvalid;
+  }
+
+  if (counter.mWeight <= mHeap[0].mWeight)
+    return counter.mKey;
+
+  uint32_t evicted = mHeap[0].mKey;
+  mPos.erase(evicted);
+  mHeap[0] = counter;
+  mPos[counter.mKey] = 0;
+  SiftDown(0);
+  return evicted;
+}
+
+//------------------------------------------------------------------------------
+// Get top entries
+//------------------------------------------------------------------------------
+void
+TopKSketch::GetTop (size_t limit, std::vector<Counter>& top) const
+{
+  top = mHeap;
+  limit = std::min(limit, top.size());
+  std::partial_sort(top.begin(), top.begin() + limit, top.end(),
+                    [](const Counter & l, const Counter & r)
+  {
+    return l.mWeight > r.mWeight;
+  });
+  top.resize(limit);
+}
+
+//------------------------------------------------------------------------------
+// Heap helpers
+//------------------------------------------------------------------------------
+void
+TopKSketch::Swap (size_t a, size_t b)
+{
+  std::swap(mHeap[a], mHeap[b]);
+  mPos[mHeap[a].mKey] = a;
+  mPos[mHeap[b].mKey] = b;
+}
+
+void
+TopKSketch::SiftUp (size_t pos)
+{
+  while (pos)
+  {
+    size_t parent = (pos - 1) / 2;
+
+    if (mHeap[parent].mWeight <= mHeap[pos].mWeight)
+      break;
+
+    Swap(parent, pos);
+    pos = parent;
+  }
+}
+
+void
+TopKSketch::SiftDown (size_t pos)
+{
+  size_t size = mHeap.size();
+
+  while (true)
+  {
+    size_t smallest = pos;
+    size_t left = 2 * pos + 1;
+    size_t right = left + 1;
+
+    if ((left < size) && (mHeap[left].mWeight < mHeap[smallest].mWeight))
+      smallest = left;
+
+    if ((right < size) && (mHeap[right].mWeight < mHeap[smallest].mWeight))
+      smallest = right;
+
+    if (smallest == pos)
+      break;
+
+    Swap(smallest, pos);
+    pos = smallest;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+IostatPopularity::IostatPopularity (size_t nbins, size_t capacity) :
+  mByCount(nbins, TopKSketch(capacity)),
+  mByBytes(nbins, TopKSketch(capacity)),
+  mDays(nbins, 0),
+  mDirty(nbins, false) { }
+
+//------------------------------------------------------------------------------
+// Update one sketch
+//------------------------------------------------------------------------------
+void
+IostatPopularity::Update (TopKSketch& sketch, const std::string& path,
+                          uint64_t weight, uint64_t other)
+{
+  uint32_t id = mPaths.Find(path);
+
+  if ((id != PathInterner::sInvalid) && sketch.Increment(id, weight, other))
+    return;
+
+  id = mPaths.Acquire(path);
+  uint32_t evicted = sketch.Insert(id, weight, other);
+
+  if (evicted != PathInterner::sInvalid)
+    mPaths.Release(evicted);
+}
+
+//------------------------------------------------------------------------------
+// Account a read
+//------------------------------------------------------------------------------
+void
+IostatPopularity::Add (time_t day, const std::string& path,
+                       unsigned long long rb)
+{
+  eos::common::Path cPath(path.c_str());
+  XrdSysMutexHelper lock(mMutex);
+
+  if (mDays.empty())
+    return;
+
+  size_t bin = day % mDays.size();
+
+  if (mDays[bin] != day)
+  {
+    // First access for a new day recycles the window
+    ResetBin(bin);
+    mDays[bin] = day;
+  }
+
+  for (size_t k = 0; k < cPath.GetSubPathSize(); k++)
+  {
+    std::string sp = cPath.GetSubPath(k);
+    Update(mByCount[bin], sp, 1, rb);
+    Update(mByBytes[bin], sp, rb, 1);
+  }
+
+  mDirty[bin] = true;
+}
+
+//------------------------------------------------------------------------------
+// Drop a time window
+//------------------------------------------------------------------------------
+void
+IostatPopularity::ResetBin (size_t bin)
+{
+  for (auto it = mByCount[bin].Counters().begin();
+       it != mByCount[bin].Counters().end(); ++it)
+  {
+    mPaths.Release(it->mKey);
+  }
+
+  for (auto it = mByBytes[bin].Counters().begin();
+       it != mByBytes[bin].Counters().end(); ++it)
+  {
+    mPaths.Release(it->mKey);
+  }
+
+  mByCount[bin].Clear();
+  mByBytes[bin].Clear();
+  mDirty[bin] = true;
+}
+
+//------------------------------------------------------------------------------
+// Get ranking
+//------------------------------------------------------------------------------
+void
+IostatPopularity::GetTop (time_t day, bool by_bytes, size_t limit,
+                          std::vector<Entry>& top)
+{
+  std::vector<TopKSketch::Counter> counters;
+  top.clear();
+  XrdSysMutexHelper lock(mMutex);
+
+  if (mDays.empty())
+    return;
+
+  size_t bin = day % mDays.size();
+
+  if (mDays[bin] != day)
+    return;
+
+  if (by_bytes)
+    mByBytes[bin].GetTop(limit, counters);
+  else
+    mByCount[bin].GetTop(limit, counters);
+
+  top.reserve(counters.size());
+
+  for (auto it = counters.begin(); it != counters.end(); ++it)
+  {
+    Entry entry;
+    entry.mPath = mPaths.Lookup(it->mKey);
+    entry.mNread = by_bytes ? it->mOther : it->mWeight;
+    entry.mRb = by_bytes ? it->mWeight : it->mOther;
+    top.push_back(entry);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Write one time window
+//------------------------------------------------------------------------------
+bool
+IostatPopularity::WriteBin (FILE* fout, size_t bin)
+{
+  TopKSketch* sketches[2] = {&mByCount[bin], &mByBytes[bin]};
+  int64_t day = mDays[bin];
+  bool ok = (fwrite(&day, sizeof(day), 1, fout) == 1);
+
+  for (size_t i = 0; ok && (i < 2); i++)
+  {
+    uint32_t n = sketches[i]->Counters().size();
+    ok &= (fwrite(&n, sizeof(n), 1, fout) == 1);
+
+    for (auto it = sketches[i]->Counters().begin();
+         ok && (it != sketches[i]->Counters().end()); ++it)
+    {
+      const std::string& path = mPaths.Lookup(it->mKey);
+      uint16_t len = path.length();
+      ok &= (fwrite(&len, sizeof(len), 1, fout) == 1);
+      ok &= (fwrite(path.c_str(), 1, len, fout) == len);
+      ok &= (fwrite(&it->mWeight, sizeof(it->mWeight), 1, fout) == 1);
+      ok &= (fwrite(&it->mError, sizeof(it->mError), 1, fout) == 1);
+      ok &= (fwrite(&it->mOther, sizeof(it->mOther), 1, fout) == 1);
+    }
+  }
+
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// Write binary checkpoint
+//------------------------------------------------------------------------------
+bool
+IostatPopularity::Checkpoint (FILE* fout, bool full, size_t& nwindows)
+{
+  XrdSysMutexHelper lock(mMutex);
+  bool ok = true;
+  nwindows = 0;
+
+  if (full)
+  {
+    uint32_t nbins = mByCount.size();
+    ok &= (fwrite(sMagic, strlen(sMagic), 1, fout) == 1);
+    ok &= (fwrite(&nbins, sizeof(nbins), 1, fout) == 1);
+  }
+
+  for (size_t bin = 0; ok && (bin < mByCount.size()); bin++)
+  {
+    if (!full && !mDirty[bin])
+      continue;
+
+    ok &= WriteBin(fout, bin);
+    nwindows++;
+  }
+
+  // The caller writes a full checkpoint after a failure
+  std::fill(mDirty.begin(), mDirty.end(), false);
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// Load binary checkpoint
+//------------------------------------------------------------------------------
+bool
+IostatPopularity::Restore (FILE* fin)
+{
+  char magic[8];
+  uint32_t nbins = 0;
+
+  if ((fread(magic, sizeof(magic), 1, fin) != 1) ||
+      memcmp(magic, sMagic, sizeof(magic)) ||
+      (fread(&nbins, sizeof(nbins), 1, fin) != 1))
+    return false;
+
+  XrdSysMutexHelper lock(mMutex);
+  std::string path;
+
+  // The header is followed by all windows, then by the windows appended by
+  // the incremental checkpoints until the end of the file
+  while (true)
+  {
+    int64_t day = 0;
+
+    if (fread(&day, sizeof(day), 1, fin) != 1)
+      return (feof(fin) != 0);
+
+    // Windows are re-mapped in case the history length changed, a window
+    // appended later replaces the one of the same day
+    size_t nbin = mDays.size() ? (day % mDays.size()) : 0;
+    bool keep = mDays.size() && (day >= mDays[nbin]);
+
+    if (keep)
+    {
+      ResetBin(nbin);
+      mDays[nbin] = day;
+    }
+    for (size_t i = 0; i < 2; i++)
+    {
+      uint32_t n = 0;
+
+      if (fread(&n, sizeof(n), 1, fin) != 1)
+        return false;
+
+      for (uint32_t k = 0; k < n; k++)
+      {
+        uint16_t len = 0;
+        TopKSketch::Counter counter;
+
+        if (fread(&len, sizeof(len), 1, fin) != 1)
+          return false;
+
+        path.resize(len);
+
+        if ((len && (fread(&path[0], 1, len, fin) != len)) ||
+            (fread(&counter.mWeight, sizeof(counter.mWeight), 1, fin) != 1) ||
+            (fread(&counter.mError, sizeof(counter.mError), 1, fin) != 1) ||
+            (fread(&counter.mOther, sizeof(counter.mOther), 1, fin) != 1))
+          return false;
+
+        if (!keep)
+          continue;
+
+        TopKSketch& sketch = i ? mByBytes[nbin] : mByCount[nbin];
+        counter.mKey = mPaths.Acquire(path);
+        uint32_t dropped = sketch.Load(counter);
+
+        if (dropped != PathInterner::sInvalid)
+          mPaths.Release(dropped);
+      }
+    }
+  }
+
+  return true;
+}
+
+EOSMGMNAMESPACE_END
@@ -0,0 +1,289 @@
+// ----------------------------------------------------------------------
+// File: IostatPopularity.hh
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_IOSTATPOPULARITY__HH__
+#define __EOSMGM_IOSTATPOPULARITY__HH__
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Reference counted string table - every path tracked by a popularity sketch
+//! is stored exactly once and referenced by a 32-bit id.
+//------------------------------------------------------------------------------
+class PathInterner
+{
+public:
+  static const uint32_t sInvalid = 0xffffffff;
+
+  //----------------------------------------------------------------------------
+  //! Find the id of an interned path without taking a reference
+  //!
+  //! @return path id or sInvalid if path is not interned
+  //----------------------------------------------------------------------------
+  uint32_t Find (const std::string& path) const;
+
+  //----------------------------------------------------------------------------
+  //! Intern a path and take a reference to it
+  //!
+  //! @return path id
+  //----------------------------------------------------------------------------
+  uint32_t Acquire (const std::string& path);
+
+  //----------------------------------------------------------------------------
+  //! Drop a reference, the path is released once no sketch uses it anymore
+  //----------------------------------------------------------------------------
+  void Release (uint32_t id);
+
+  //----------------------------------------------------------------------------
+  //! Get path for id
+  //----------------------------------------------------------------------------
+  const std::string& Lookup (uint32_t id) const
+  {
+    return mSlots[id].mPath;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Number of interned paths
+  //----------------------------------------------------------------------------
+  size_t Size () const
+  {
+    return mIndex.size();
+  }
+
+private:
+  struct Slot
+  {
+    std::string mPath;
+    uint32_t mRefs;
+  };
+
+  std::unordered_map<std::string, uint32_t> mIndex; //< path to slot id
+  std::vector<Slot> mSlots; //< slots indexed by id
+  std::vector<uint32_t> mFree; //< free slot ids
+};
+
+//------------------------------------------------------------------------------
+//! Space-saving top-K sketch: tracks at most K keys with a guaranteed
+//! overestimation bounded by the smallest tracked counter. Updates are
+//! O(log K) and the memory footprint does not depend on the key cardinality.
+//------------------------------------------------------------------------------
+class TopKSketch
+{
+public:
+  struct Counter
+  {
+    uint32_t mKey; //< interned path id
+    uint64_t mWeight; //< ranked value (overestimate)
+    uint64_t mError; //< maximum overestimation of mWeight
+    uint64_t mOther; //< secondary value accumulated while tracked
+  };
+
+  TopKSketch (size_t capacity = 0) : mCapacity(capacity) { }
+
+  //----------------------------------------------------------------------------
+  //! Check if key is tracked and if yes increment it
+  //!
+  //! @return true if key was tracked, otherwise false
+  //----------------------------------------------------------------------------
+  bool Increment (uint32_t key, uint64_t weight, uint64_t other);
+
+  //----------------------------------------------------------------------------
+  //! Insert a key which is not tracked yet
+  //!
+  //! @return key which had to be evicted or PathInterner::sInvalid
+  //----------------------------------------------------------------------------
+  uint32_t Insert (uint32_t key, uint64_t weight, uint64_t other);
+
+  //----------------------------------------------------------------------------
+  //! Restore a counter from a checkpoint
+  //!
+  //! @return key which had to be evicted or PathInterner::sInvalid
+  //----------------------------------------------------------------------------
+  uint32_t Load (const Counter& counter);
+
+  //----------------------------------------------------------------------------
+  //! Get the top entries sorted by descending weight
+  //!
+  //! @param limit maximum number of entries to return
+  //! @param top vector filled with the result
+  //----------------------------------------------------------------------------
+  void GetTop (size_t limit, std::vector<Counter>& top) const;
+
+  //----------------------------------------------------------------------------
+  //! Access all tracked counters in heap order
+  //----------------------------------------------------------------------------
+  const std::vector<Counter>& Counters () const
+  {
+    return mHeap;
+  }
+
+  void Clear ()
+  {
+    mHeap.clear();
+    mPos.clear();
+  }
+
+private:
+  void SiftDown (size_t pos);
+  void SiftUp (size_t pos);
+  void Swap (size_t a, size_t b);
+
+  size_t mCapacity;
+  std::vector<Counter> mHeap; //< min-heap by mWeight
+  std::unordered_map<uint32_t, size_t> mPos; //< key to heap position
+};
+
+//------------------------------------------------------------------------------
+//! Popularity engine keeping per-day approximate top-K rankings by read count
+//! and by read bytes. Days are mapped onto a ring of time windows, a window is
+//! recycled the first time it is written for a new day.
+//------------------------------------------------------------------------------
+class IostatPopularity
+{
+public:
+  struct Entry
+  {
+    std::string mPath;
+    unsigned int mNread;
+    unsigned long long mRb;
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param nbins number of time windows (days)
+  //! @param capacity number of paths tracked per window and ranking
+  //----------------------------------------------------------------------------
+  IostatPopularity (size_t nbins, size_t capacity);
+
+  //----------------------------------------------------------------------------
+  //! Account a read of rb bytes for path and all its parent directories
+  //!
+  //! @param day day number i.e. seconds since epoch / 86400
+  //! @param path logical path
+  //! @param rb bytes read
+  //----------------------------------------------------------------------------
+  void Add (time_t day, const std::string& path, unsigned long long rb);
+
+  //----------------------------------------------------------------------------
+  //! Get the ranking of a day - O(K) plus sorting of the result
+  //!
+  //! @param day day number i.e. seconds since epoch / 86400
+  //! @param by_bytes rank by read bytes if true, otherwise by read count
+  //! @param limit maximum number of entries returned
+  //! @param top vector filled with the ranking, empty if the day is no longer
+  //!        (or not yet) in the history
+  //----------------------------------------------------------------------------
+  void GetTop (time_t day, bool by_bytes, size_t limit,
+               std::vector<Entry>& top);
+
+  //----------------------------------------------------------------------------
+  //! Write a binary checkpoint
+  //!
+  //! @param fout output file
+  //! @param full if true write the header and all time windows, otherwise only
+  //!        append the windows changed since the last checkpoint
+  //! @param nwindows set to the number of windows written
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool Checkpoint (FILE* fout, bool full, size_t& nwindows);
+
+  //----------------------------------------------------------------------------
+  //! Load a binary checkpoint - windows appended later replace the ones
+  //! written before for the same day
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool Restore (FILE* fin);
+
+  //----------------------------------------------------------------------------
+  //! Check if anything changed since the last checkpoint
+  //----------------------------------------------------------------------------
+  bool IsDirty ()
+  {
+    XrdSysMutexHelper lock(mMutex);
+    return std::find(mDirty.begin(), mDirty.end(), true) != mDirty.end();
+  }
+
+  //----------------------------------------------------------------------------
+  //! Number of time windows
+  //----------------------------------------------------------------------------
+  size_t GetNumWindows () const
+  {
+    return mDays.size();
+  }
+
+  //----------------------------------------------------------------------------
+  //! Number of distinct paths currently kept in memory
+  //----------------------------------------------------------------------------
+  size_t GetNumPaths ()
+  {
+    XrdSysMutexHelper lock(mMutex);
+    return mPaths.Size();
+  }
+
+private:
+  //! Magic identifying popularity checkpoint files
+  static const char* sMagic;
+
+  //----------------------------------------------------------------------------
+  //! Drop all entries of a time window, must be called with the mutex held
+  //----------------------------------------------------------------------------
+  void ResetBin (size_t bin);
+
+  //----------------------------------------------------------------------------
+  //! Write one time window, must be called with the mutex held
+  //----------------------------------------------------------------------------
+  bool WriteBin (FILE* fout, size_t bin);
+
+  //----------------------------------------------------------------------------
+  //! Update one sketch, must be called with the mutex held
+  //----------------------------------------------------------------------------
+  void Update (TopKSketch& sketch, const std::string& path, uint64_t weight,
+               uint64_t other);
+
+  XrdSysMutex mMutex; //< protecting all members below
+  PathInterner mPaths;
+  std::vector<TopKSketch> mByCount; //< per window ranking by read count
+  std::vector<TopKSketch> mByBytes; //< per window ranking by read bytes
+  std::vector<time_t> mDays; //< day currently stored in each window
+  std::vector<bool> mDirty; //< window changed since the last checkpoint
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
@@ -29,6 +29,7 @@
 #include "mgm/XrdMgmOfs.hh"
 #include "common/Statfs.hh"
 #include "common/ShellCmd.hh"
+#include "common/StringConversion.hh"
 #include "common/plugin_manager/PluginManager.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdNet/XrdNet.hh"
@@ -40,6 +41,9 @@
 #include "namespace/interface/IChLogFileMDSvc.hh"
 #include "namespace/interface/IChLogContainerMDSvc.hh"
 /*----------------------------------------------------------------------------*/
+#include <cstdlib>
+#include <sys/time.h>
+/*----------------------------------------------------------------------------*/
 
 // -----------------------------------------------------------------------------
 // Note: the defines after have to be in agreements with the defins in XrdMqOfs.cc
@@ -70,12 +74,19 @@ Master::Master()
   fCompactingRatio = 0;
   fCompactFiles = false;
   fCompactDirectories = false;
+  fDirCompactingRatio = 0;
+  fCompactingStallMs = 0;
+  fCompactingRounds = 0;
   fDevNull = 0;
   fDevNullLogger = 0;
   fDevNullErr = 0;
   fCheckRemote = true;
   fFileNamespaceInode = fDirNamespaceInode = 0;
   f2MasterTransitionTime = time(NULL) - 3600; // start without service delays
+  fShippingPort = 0;
+  fFileShipper = 0;
+  fDirShipper = 0;
+  fLogReceiver = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -170,6 +181,15 @@ Master::Init()
   // start the heartbeat thread anyway
   XrdSysThread::Run(&fThread, Master::StaticSupervisor, static_cast<void *> (this), XRDSYSTHREAD_HOLD, "Master Supervisor Thread");
 
+  // ship the changelogs ourselves instead of eosfilesync if configured - eossync
+  // does not sync the changelogs in this case, so we cannot run without it
+  if (getenv("EOS_MGM_NS_REPLICATION_PORT") &&
+      !StartLogShipping(strtoul(getenv("EOS_MGM_NS_REPLICATION_PORT"), 0, 10)))
+  {
+    eos_crit("failed to start the changelog shipping");
+    return false;
+  }
+
   // get sync up if it is not up
   eos::common::ShellCmd scmd1("service --skip-redirect eos status sync || service --skip-redirect eos start sync");
   eos::common::cmd_status rc = scmd1.wait(30);
@@ -631,6 +651,37 @@ Master::ScheduleOnlineCompacting(time_t starttime, time_t repetitioninterval)
   return true;
 }
 
+//------------------------------------------------------------------------------
+// Compact the directory changelog next to the file changelog
+//------------------------------------------------------------------------------
+namespace
+{
+  struct DirCompactingJob
+  {
+    eos::IChLogContainerMDSvc* svc;
+    void* data;
+    int errc;
+    std::string error;
+
+    static void* Start(void* arg)
+    {
+      DirCompactingJob* job = static_cast<DirCompactingJob*>(arg);
+
+      try
+      {
+	job->svc->compact(job->data);
+      }
+      catch (eos::MDException& e)
+      {
+	job->errc = e.getErrno() ? e.getErrno() : EIO;
+	job->error = e.getMessage().str();
+      }
+
+      return 0;
+    }
+  };
+}
+
 //------------------------------------------------------------------------------
 // Do compacting
 //------------------------------------------------------------------------------
@@ -787,23 +838,100 @@ Master::Compacting()
 	{
 	  MasterLog(eos_info("msg=\"compacting\""));
 
-	  // Does not require namespace lock
+	  // Does not require namespace lock - the directories are compacted in
+	  // a second thread while we compact the files
+	  DirCompactingJob dirJob = {eos_chlog_dirsvc, compDirData, 0, ""};
+	  pthread_t dirThread = 0;
+	  bool dirThreadRunning = false;
+
+	  if (CompactDirectories)
+	  {
+	    if (XrdSysThread::Run(&dirThread, DirCompactingJob::Start,
+				  static_cast<void*>(&dirJob), XRDSYSTHREAD_HOLD,
+				  "Master DirCompacting Thread"))
+	      DirCompactingJob::Start(&dirJob);
+	    else
+	      dirThreadRunning = true;
+	  }
+
+	  int errc = 0;
+	  std::string error;
+
 	  if (CompactFiles)
+	  {
+	    try
+	    {
 	      eos_chlog_filesvc->compact(compData);
+	    }
+	    catch (eos::MDException& e)
+	    {
+	      errc = e.getErrno() ? e.getErrno() : EIO;
+	      error = e.getMessage().str();
+	    }
+	  }
+
+	  if (dirThreadRunning)
+	    XrdSysThread::Join(dirThread, 0);
+
+	  compDirData = dirJob.data;
+
+	  if (errc || dirJob.errc)
+	  {
+	    eos::MDException e(errc ? errc : dirJob.errc);
+	    e.getMessage() << (errc ? error : dirJob.error);
+	    throw e;
+	  }
+	}
+
+	// Catch up with the records appended while compacting, without the
+	// namespace lock, until what is left for the commit is small
+	unsigned long long catchupBytes =
+	  getenv("EOS_MGM_COMPACTING_CATCHUP_BYTES") ?
+	  strtoull(getenv("EOS_MGM_COMPACTING_CATCHUP_BYTES"), 0, 10) :
+	  1024 * 1024;
+	int maxRounds = getenv("EOS_MGM_COMPACTING_CATCHUP_ROUNDS") ?
+			atoi(getenv("EOS_MGM_COMPACTING_CATCHUP_ROUNDS")) : 16;
+	unsigned long long delta = 0;
+	int rounds = 0;
+
+	do
+	{
+	  delta = 0;
+
+	  if (CompactFiles)
+	    delta += eos_chlog_filesvc->compactCatchUp(compData, fAutoRepair);
 
 	  if (CompactDirectories)
-	      eos_chlog_dirsvc->compact(compDirData);
+	    delta += eos_chlog_dirsvc->compactCatchUp(compDirData, fAutoRepair);
+
+	  rounds++;
+	  MasterLog(eos_info("msg=\"compact catch up\" round=%d bytes=%llu",
+			     rounds, delta));
 	}
+	while ((delta > catchupBytes) && (rounds < maxRounds));
+
 	{
-	  // Requires namespace write lock
+	  // Requires namespace write lock - only the records appended since the
+	  // last catch up are replayed
 	  MasterLog(eos_info("msg=\"compact commit\""));
+	  struct timeval tv_start, tv_stop;
+	  gettimeofday(&tv_start, 0);
 	  eos::common::RWMutexWriteLock lock(gOFS->eosViewRWMutex);
+
 	  if (CompactFiles)
-	      eos_chlog_filesvc->compactCommit(compData);
+	      eos_chlog_filesvc->compactCommit(compData, fAutoRepair);
 
 	  if (CompactDirectories)
-	      eos_chlog_dirsvc->compactCommit(compDirData);
+	      eos_chlog_dirsvc->compactCommit(compDirData, fAutoRepair);
+
+	  gettimeofday(&tv_stop, 0);
+	  fCompactingStallMs = ((tv_stop.tv_sec - tv_start.tv_sec) * 1000 +
+				(tv_stop.tv_usec - tv_start.tv_usec) / 1000);
+	  fCompactingRounds = rounds;
 	}
+
+	MasterLog(eos_info("msg=\"compact commit done\" stall=%llums rounds=%d",
+			   fCompactingStallMs, fCompactingRounds));
 	{
 	  XrdSysMutexHelper cLock(fCompactingMutex);
 	  reschedule = (fCompactingInterval != 0);
@@ -1034,6 +1162,107 @@ Master::PrintOutCompacting(XrdOucString& out)
   out += " ratio-dir=";
   out += cfratio;
   out += ":1";
+  snprintf(cfratio, sizeof(cfratio) - 1, "%llu", fCompactingStallMs);
+  out += " stall-ms=";
+  out += cfratio;
+  out += " catchup-rounds=";
+  out += fCompactingRounds;
+}
+
+//------------------------------------------------------------------------------
+// Print out changelog shipping status
+//------------------------------------------------------------------------------
+void
+Master::PrintOutShipping(XrdOucString& out)
+{
+  if (!fShippingPort)
+  {
+    out += "status=off";
+    return;
+  }
+
+  XrdOucString sizestring;
+  eos::LogShipperStats stats[2];
+  const char* tags[2] = {"files", "directories"};
+  fFileShipper->getStats(stats[0]);
+  fDirShipper->getStats(stats[1]);
+  out += "status=on port=";
+  out += (int) fShippingPort;
+
+  // what we ship to the remote MGM
+  for (int i = 0; i < 2; i++)
+  {
+    out += " ";
+    out += tags[i];
+    out += (stats[i].connected ? "=connected " : "=down ");
+    out += tags[i];
+    out += ".acked=";
+    out += eos::common::StringConversion::GetSizeString(sizestring,
+	   (unsigned long long) stats[i].ackedOffset);
+    out += " ";
+    out += tags[i];
+    out += ".lag=";
+    out += eos::common::StringConversion::GetSizeString(sizestring,
+	   (unsigned long long) (stats[i].localOffset > stats[i].ackedOffset ?
+				 stats[i].localOffset - stats[i].ackedOffset : 0));
+    out += " ";
+    out += tags[i];
+    out += ".lag.ms=";
+    out += eos::common::StringConversion::GetSizeString(sizestring,
+	   (unsigned long long) stats[i].lagMs);
+    out += " ";
+    out += tags[i];
+    out += ".rtt.ms=";
+    out += eos::common::StringConversion::GetSizeString(sizestring,
+	   (unsigned long long) stats[i].rttMs);
+  }
+
+  // what the remote MGM ships to us
+  std::map<std::string, eos::LogReceiverStats> received;
+  fLogReceiver->getStats(received);
+
+  for (int i = 0; i < 2; i++)
+  {
+    std::string name = tags[i];
+    name += ".";
+    name += fRemoteHost.c_str();
+    name += ".mdlog";
+    const eos::LogReceiverStats& rstats = received[name];
+    out += " received.";
+    out += tags[i];
+    out += (rstats.connected ? "=connected" : "=down");
+    out += " received.";
+    out += tags[i];
+    out += ".offset=";
+    out += eos::common::StringConversion::GetSizeString(sizestring,
+	   (unsigned long long) rstats.offset);
+    out += " received.";
+    out += tags[i];
+    out += ".errors=";
+    out += eos::common::StringConversion::GetSizeString(sizestring,
+	   (unsigned long long) rstats.errors);
+
+    if (!i && !IsMaster() && gOFS->eosFileService)
+    {
+      // how far the follower is behind the received records
+      eos::IChLogFileMDSvc* eos_chlog_filesvc =
+	dynamic_cast<eos::IChLogFileMDSvc*>(gOFS->eosFileService);
+
+      if (eos_chlog_filesvc)
+      {
+	uint64_t follow = eos_chlog_filesvc->getFollowOffset();
+	out += " received.files.follow.lag=";
+	out += eos::common::StringConversion::GetSizeString(sizestring,
+	       (unsigned long long) (rstats.offset > follow ?
+				     rstats.offset - follow : 0));
+      }
+    }
+  }
+
+  // connections refused before they named an accepted changelog
+  out += " received.refused=";
+  out += eos::common::StringConversion::GetSizeString(sizestring,
+	 (unsigned long long) received[""].errors);
 }
 
 //------------------------------------------------------------------------------
@@ -1399,6 +1628,9 @@ Master::Slave2Master()
   eos::common::ShellCmd scmd1("service --skip-redirect eos status sync && service --skip-redirect eos stop sync");
   eos::common::cmd_status rc = scmd1.wait(30);
 
+  // the old master must not append to our copy of its changelogs anymore
+  EnableLogReceiver(false);
+
   if (rc.exit_code)
   {
     if (rc.exit_code == -1)
@@ -1419,6 +1651,7 @@ Master::Slave2Master()
 
     eos::common::ShellCmd scmd2("service --skip-redirect eos start sync");
     rc = scmd2.wait(30);
+    EnableLogReceiver(true);
 
     if (rc.exit_code)
     {
@@ -1451,6 +1684,7 @@ Master::Slave2Master()
     MasterLog(eos_crit("slave=>master transition aborted since we cannot stat "
 		       "our own slave file-changelog-file"));
     fRunningState = Run::State::kIsRunningSlave;
+    EnableLogReceiver(true);
     return false;
   }
 
@@ -1463,6 +1697,7 @@ Master::Slave2Master()
     MasterLog(eos_crit("slave=>master transition aborted since we cannot stat "
 		       "our own slave dir-changelog-file"));
     fRunningState = Run::State::kIsRunningSlave;
+    EnableLogReceiver(true);
     return false;
   }
 
@@ -1531,6 +1766,7 @@ Master::Slave2Master()
 			 "remote-size=%llu local-size=%llu", rfclf.c_str(),
 			 size_remote_file_changelog, size_local_file_changelog));
       fRunningState = Run::State::kIsRunningSlave;
+      EnableLogReceiver(true);
       return false;
     }
 
@@ -1541,6 +1777,7 @@ Master::Slave2Master()
 			 "remote-size=%llu local-size=%llu", rdclf.c_str(),
 			 size_remote_dir_changelog, size_local_dir_changelog));
       fRunningState = Run::State::kIsRunningSlave;
+      EnableLogReceiver(true);
       return false;
     }
   }
@@ -1607,6 +1844,7 @@ Master::Slave2Master()
     fRunningState = Run::State::kIsNothing;
     eos::common::ShellCmd scmd3("service --skip-redirect eos start sync");
     rc = scmd3.wait(30);
+    EnableLogReceiver(true);
 
     if (rc.exit_code)
     {
@@ -1619,6 +1857,7 @@ Master::Slave2Master()
   fRunningState = Run::State::kIsRunningMaster;
   eos::common::ShellCmd scmd3("service --skip-redirect eos start sync");
   rc = scmd3.wait(30);
+  EnableLogReceiver(true);
   if (rc.exit_code)
   {
     MasterLog(eos_warning("failed to start sync service - %d", rc.exit_code));
@@ -1641,7 +1880,16 @@ Master::Slave2Master()
   }
 
   UnBlockCompacting();
-  // Re-start the recycler thread
+  // Re-start the recycler thread - continue with the recycle index journal
+  // of the previous master and rebuild it from the bin only if it is missing
+  XrdOucString recycleindex = gOFS->MgmMetaLogDir;
+  recycleindex += "/recycle.";
+  recycleindex += fRemoteHost;
+  recycleindex += ".index";
+
+  if (!Recycle::TakeOverIndex(recycleindex.c_str()))
+    Recycle::InvalidateIndex();
+
   gOFS->Recycler.Start();
   eos_alert("msg=\"running as master-rw\"");
   MasterLog(eos_notice("running in master mode"));
@@ -1864,6 +2112,13 @@ Master::~Master()
     delete fDevNullErr;
     fDevNullErr = 0;
   }
+
+  delete fFileShipper;
+  fFileShipper = 0;
+  delete fDirShipper;
+  fDirShipper = 0;
+  delete fLogReceiver;
+  fLogReceiver = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -1985,6 +2240,10 @@ Master::BootNamespace()
     ns_preset=true;
   }
 
+  // Directories with at least this many entries keep their names sorted
+  if (getenv("EOS_NS_CHILD_INDEX_MIN"))
+    contSettings["child_index_min"] = getenv("EOS_NS_CHILD_INDEX_MIN");
+
   if (ns_preset)
   {
     eos_alert("msg=\"namespace size optimization\" nfiles=%s ndirs=%s", getenv("EOS_NS_DIR_SIZE"), getenv("EOS_NS_FILE_SIZE"));
@@ -2036,6 +2295,7 @@ Master::BootNamespace()
       MasterLog(eos_notice("%s", (char*) "eos directory view configure started as slave"));
 
     gOFS->eosFileService->addChangeListener(gOFS->eosFsView);
+    gOFS->eosFileService->addChangeListener(&GroupBalancer::gCandidateIndex);
 
     // This is only done for the ChangeLog implementation
     eos::IChLogContainerMDSvc* eos_chlog_dirsvc =
@@ -2650,6 +2910,100 @@ Master::ShutdownSlaveFollower()
   }
 }
 
+//------------------------------------------------------------------------------
+// Start shipping the changelogs to and receiving them from the remote MGM
+//------------------------------------------------------------------------------
+bool
+Master::StartLogShipping(unsigned int port)
+{
+  if (fShippingPort)
+    return true;
+
+  if (!port || port > 65535)
+  {
+    MasterLog(eos_crit("invalid changelog shipping port %u", port));
+    return false;
+  }
+
+  // both MGMs share the sss key, it authenticates the shipped changelogs
+  eos::common::SymKey* symkey = eos::common::gSymKeyStore.GetCurrentKey();
+
+  if (!symkey)
+  {
+    MasterLog(eos_crit("no sss key to authenticate the changelog shipping"));
+    return false;
+  }
+
+  std::string secret = symkey->GetKey64();
+  std::string dir = gOFS->MgmMetaLogDir.c_str();
+  std::string remote = fRemoteHost.c_str();
+  std::string local = fThisHost.c_str();
+  fFileShipper = new eos::LogShipper(dir + "/files." + local + ".mdlog",
+				     remote, port, secret);
+  fDirShipper = new eos::LogShipper(dir + "/directories." + local + ".mdlog",
+				    remote, port, secret);
+  fLogReceiver = new eos::LogReceiver(dir, port, secret);
+  fLogReceiver->allowPeer(remote);
+  fLogReceiver->allow("files." + remote + ".mdlog");
+  fLogReceiver->allow("directories." + remote + ".mdlog");
+
+  try
+  {
+    fLogReceiver->start();
+    fFileShipper->start();
+    fDirShipper->start();
+  }
+  catch (eos::MDException& e)
+  {
+    MasterLog(eos_crit("failed to start the changelog shipping on port %u "
+		       "ec=%d %s", port, e.getErrno(),
+		       e.getMessage().str().c_str()));
+    // stop whatever was started already, stop() is a no-op otherwise
+    fDirShipper->stop();
+    fFileShipper->stop();
+    fLogReceiver->stop();
+    delete fFileShipper;
+    fFileShipper = 0;
+    delete fDirShipper;
+    fDirShipper = 0;
+    delete fLogReceiver;
+    fLogReceiver = 0;
+    return false;
+  }
+
+  // only now the shipping is reported as running
+  fShippingPort = port;
+  MasterLog(eos_notice("msg=\"changelog shipping started\" remote=%s port=%u",
+		       remote.c_str(), port));
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Accept or refuse the changelogs shipped by the remote MGM
+//------------------------------------------------------------------------------
+void
+Master::EnableLogReceiver(bool enable)
+{
+  if (!fShippingPort)
+    return;
+
+  if (!enable)
+  {
+    fLogReceiver->stop();
+    return;
+  }
+
+  try
+  {
+    fLogReceiver->start();
+  }
+  catch (eos::MDException& e)
+  {
+    MasterLog(eos_crit("failed to restart the changelog receiver ec=%d %s",
+		       e.getErrno(), e.getMessage().str().c_str()));
+  }
+}
+
 //------------------------------------------------------------------------------
 // Post the namespace record errors to the master changelog
 //------------------------------------------------------------------------------
@@ -29,6 +29,7 @@
 #include "common/Logging.hh"
 #include "mgm/Namespace.hh"
 #include "namespace/utils/Locking.hh"
+#include "namespace/utils/LogShipping.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOuc/XrdOucString.hh"
 /*----------------------------------------------------------------------------*/
@@ -108,6 +109,11 @@ class Master : public eos::common::LogId
   //----------------------------------------------------------------------------
   void PrintOutCompacting(XrdOucString& out);
 
+  //----------------------------------------------------------------------------
+  //! Print out the changelog shipping status
+  //----------------------------------------------------------------------------
+  void PrintOutShipping(XrdOucString& out);
+
   //----------------------------------------------------------------------------
   //! Enable remote check
   //----------------------------------------------------------------------------
@@ -285,11 +291,18 @@ class Master : public eos::common::LogId
   double fCompactingRatio;
   //! compacting ratio for directory changelog e.g. 4:1 => 4 times smaller after compaction
   double fDirCompactingRatio;
+  //! time the last compaction commit held the namespace write lock
+  unsigned long long fCompactingStallMs;
+  int fCompactingRounds; ///< catch up rounds of the last compaction
   XrdSysLogger* fDevNullLogger; ///< /dev/null logger
   XrdSysError* fDevNullErr; ///< /dev/null error
   unsigned long long fFileNamespaceInode; ///< inode number of the file namespace file
   unsigned long long fDirNamespaceInode; ///< inode number of the dir  namespace file
   bool fAutoRepair; ///< enable auto-repair to skip over broken records during compaction
+  unsigned int fShippingPort; ///< port of the changelog shipping, 0 if disabled
+  eos::LogShipper* fFileShipper; ///< ships our file changelog to the remote MGM
+  eos::LogShipper* fDirShipper; ///< ships our directory changelog to the remote MGM
+  eos::LogReceiver* fLogReceiver; ///< receives the changelogs of the remote MGM
 
   //----------------------------------------------------------------------------
   // Lock class wrapper used by the namespace
@@ -374,6 +387,20 @@ class Master : public eos::common::LogId
   //----------------------------------------------------------------------------
   bool HostCheck(const char* hostname, int port = 1094, int timeout = 5);
 
+  //----------------------------------------------------------------------------
+  //! Start shipping our changelogs to the remote MGM and receiving its
+  //! changelogs on the given port, this replaces the eosfilesync processes
+  //! for the changelog files
+  //!
+  //! @return true if the shipping runs, false if nothing was started
+  //----------------------------------------------------------------------------
+  bool StartLogShipping(unsigned int port);
+
+  //----------------------------------------------------------------------------
+  //! Accept or refuse the changelogs shipped by the remote MGM
+  //----------------------------------------------------------------------------
+  void EnableLogReceiver(bool enable);
+
   //----------------------------------------------------------------------------
   //! Do a slave=>master transition
   //----------------------------------------------------------------------------
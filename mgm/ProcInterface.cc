@@ -255,8 +255,12 @@ ProcCommand::ProcCommand ()
   mClosed = true;
   pOpaque = 0;
   ininfo = 0;
-  fstdout = fstderr = fresultStream = 0;
-  fstdoutfilename = fstderrfilename = fresultStreamfilename = "";
+  fstdout = fstderr = 0;
+  mStreamErr = "";
+  mLastOut = '\n';
+  mStreaming = false;
+  mStream = 0;
+  mStreamThread = 0;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -267,25 +271,25 @@ ProcCommand::ProcCommand ()
 /*----------------------------------------------------------------------------*/
 ProcCommand::~ProcCommand ()
 {
+  if (mStream)
+  {
+    // stop a streamed command which has not been closed
+    mStream->Abort();
+    XrdSysThread::Join(mStreamThread, 0);
+    delete mStream;
+    mStream = 0;
+  }
+
   if (fstdout)
   {
     fclose(fstdout);
     fstdout = 0;
-    unlink(fstdoutfilename.c_str());
   }
 
   if (fstderr)
   {
     fclose(fstderr);
     fstderr = 0;
-    unlink(fstderrfilename.c_str());
-  }
-
-  if (fresultStream)
-  {
-    fclose(fresultStream);
-    fresultStream = 0;
-    unlink(fresultStreamfilename.c_str());
   }
 
   if (pOpaque)
@@ -297,49 +301,180 @@ ProcCommand::~ProcCommand ()
 
 /*----------------------------------------------------------------------------*/
 /**
- * Open temporary output files for results of find commands
+ * Open the output streams for results of find commands. The stdout is sealed
+ * while it is written and appended to the result, the stderr is collected in
+ * memory and appended once the command is done.
  * @return true if successful otherwise false
  */
 
 /*----------------------------------------------------------------------------*/
 bool
-ProcCommand::OpenTemporaryOutputFiles ()
+ProcCommand::OpenOutputStreams ()
 {
-  char tmpdir [4096];
-  snprintf(tmpdir, sizeof (tmpdir) - 1, "/tmp/eos.mgm/%llu", (unsigned long long) XrdSysThread::ID());
-  fstdoutfilename = tmpdir;
-  fstdoutfilename += ".stdout";
-  fstderrfilename = tmpdir;
-  fstderrfilename += ".stderr";
-  fresultStreamfilename = tmpdir;
-  fresultStreamfilename += ".mResultstream";
-
-  eos::common::Path cPath(fstdoutfilename.c_str());
-
-  if (!cPath.MakeParentPath(S_IRWXU))
+  cookie_io_functions_t stdout_funcs = {0, ProcCommand::WriteStdOut, 0, 0};
+  cookie_io_functions_t stderr_funcs = {0, ProcCommand::WriteStdErr, 0, 0};
+  mStreamErr = "";
+  mLastOut = '\n';
+  fstdout = fopencookie(this, "w", stdout_funcs);
+  fstderr = fopencookie(this, "w", stderr_funcs);
+
+  if ((!fstdout) || (!fstderr))
   {
-    eos_err("Unable to create temporary outputfile directory %s", tmpdir);
+    eos_err("unable to create find output streams");
+    if (fstdout) fclose(fstdout);
+    if (fstderr) fclose(fstderr);
+    fstdout = fstderr = 0;
     return false;
   }
 
-  // own the directory by daemon
-  if (::chown(cPath.GetParentPath(), 2, 2))
+  if (!mFuseFormat)
   {
-    eos_err("Unable to own temporary outputfile directory %s", cPath.GetParentPath());
+    AppendResult("&mgm.proc.stdout=", 17);
   }
+  return true;
+}
 
-  fstdout = fopen(fstdoutfilename.c_str(), "w");
-  fstderr = fopen(fstderrfilename.c_str(), "w");
-  fresultStream = fopen(fresultStreamfilename.c_str(), "w+");
+/*----------------------------------------------------------------------------*/
+/**
+ * Wait until the client consumed enough of a streamed result
+ * @return true if the command can go on, false if the client has gone away
+ */
 
-  if ((!fstdout) || (!fstderr) || (!fresultStream))
+/*----------------------------------------------------------------------------*/
+bool
+ProcCommand::WaitForClient ()
+{
+  if (!mStream)
   {
-    if (fstdout) fclose(fstdout);
-    if (fstderr) fclose(fstderr);
-    if (fresultStream) fclose(fresultStream);
-    return false;
+    return true;
   }
-  return true;
+  return mStream->WaitForSpace();
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Append raw data to the streamed or to the in-memory result
+ * @param data data to append
+ * @param len length of the data
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+ProcCommand::AppendResult (const char* data, size_t len)
+{
+  if (!len)
+  {
+    return;
+  }
+
+  if (mStream)
+  {
+    // if the client has gone away the data is dropped and the command stops
+    // at its next WaitForClient call
+    mStream->Write(data, len);
+  }
+  else
+  {
+    mResultStream.insert(data, -1, (int) len);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Write callback of fstdout sealing the output on the fly
+ * @param cookie proc command owning the stream
+ * @param buf data written
+ * @param size length of the data
+ * @return number of bytes consumed
+ */
+
+/*----------------------------------------------------------------------------*/
+ssize_t
+ProcCommand::WriteStdOut (void* cookie, const char* buf, size_t size)
+{
+  ProcCommand* cmd = static_cast<ProcCommand*> (cookie);
+
+  if (!size)
+  {
+    return 0;
+  }
+
+  if (cmd->mFuseFormat)
+  {
+    cmd->AppendResult(buf, size);
+  }
+  else
+  {
+    // same as XrdMqMessage::Seal on the complete output
+    const char* start = buf;
+
+    for (const char* ptr = buf; ptr < buf + size; ptr++)
+    {
+      if (*ptr == '&')
+      {
+        cmd->AppendResult(start, ptr - start);
+        cmd->AppendResult("#and#", 5);
+        start = ptr + 1;
+      }
+    }
+    cmd->AppendResult(start, buf + size - start);
+  }
+
+  cmd->mLastOut = buf[size - 1];
+  return size;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Write callback of fstderr collecting the output in memory
+ * @param cookie proc command owning the stream
+ * @param buf data written
+ * @param size length of the data
+ * @return number of bytes consumed
+ */
+
+/*----------------------------------------------------------------------------*/
+ssize_t
+ProcCommand::WriteStdErr (void* cookie, const char* buf, size_t size)
+{
+  ProcCommand* cmd = static_cast<ProcCommand*> (cookie);
+  cmd->mStreamErr.append(buf, size);
+  return size;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Static thread startup function of a streamed command
+ */
+
+/*----------------------------------------------------------------------------*/
+void*
+ProcCommand::StartStreamThread (void* pp)
+{
+  static_cast<ProcCommand*> (pp)->StreamThread();
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Execute a streamed command - its output is handed to the client while the
+ * command is running, a result built in memory (e.g. an early error) is
+ * written to the stream once the command is done.
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+ProcCommand::StreamThread ()
+{
+  Find();
+  bool inmemory = (fstdout == 0);
+  MakeResult();
+
+  if (inmemory)
+  {
+    mStream->Write(mResultStream.c_str(), mLen);
+  }
+  mStream->Close();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -367,7 +502,9 @@ ProcCommand::open (const char* inpath,
   mDoSort = false;
   mError = error;
 
-  ininfo = info;
+  // keep a copy of the opaque info, a streamed command uses it after open
+  mInfo = info ? info : "";
+  ininfo = info ? mInfo.c_str() : 0;
   if ((path.beginswith("/proc/admin")))
   {
     mAdminCmd = true;
@@ -640,6 +777,29 @@ ProcCommand::open (const char* inpath,
     }
     else if (mCmd == "find")
     {
+      if (mStreaming && !mFuseFormat)
+      {
+        // ----------------------------------------------------------------------
+        // run the command in a separate thread, the client reads the result
+        // while it is produced
+        // ----------------------------------------------------------------------
+        static size_t sStreamBuffer = getenv("EOS_MGM_PROC_STREAM_BUFFER") ?
+          strtoul(getenv("EOS_MGM_PROC_STREAM_BUFFER"), 0, 10) :
+          EOSMGMPROCSTREAMBUFFER;
+
+        mStream = new ProcStream(sStreamBuffer);
+
+        if (!XrdSysThread::Run(&mStreamThread, ProcCommand::StartStreamThread,
+                               static_cast<void*> (this), XRDSYSTHREAD_HOLD,
+                               "Proc Stream Thread"))
+        {
+          return SFS_OK;
+        }
+
+        eos_err("unable to start stream thread - executing find in memory");
+        delete mStream;
+        mStream = 0;
+      }
       Find();
     }
     else if (mCmd == "map")
@@ -698,20 +858,29 @@ ProcCommand::open (const char* inpath,
 int
 ProcCommand::read (XrdSfsFileOffset mOffset, char* buff, XrdSfsXferSize blen)
 {
-  if (fresultStream)
+  if (mStream)
   {
-    // file based results go here ...
-    if ((fseek(fresultStream, mOffset, 0)) == 0)
+    // streamed results go here - they can only be read sequentially
+    if ((uint64_t) mOffset != mStream->GetOffset())
     {
-      size_t nread = fread(buff, 1, blen, fresultStream);
-      if (nread > 0)
-        return nread;
+      eos_err("read at offset %llu of a stream at offset %llu",
+              (unsigned long long) mOffset,
+              (unsigned long long) mStream->GetOffset());
+      return gOFS->Emsg("read", *mError, ESPIPE,
+                        "read a streamed proc result at this offset",
+                        path.c_str());
     }
-    else
+
+    // only return less than requested at the end of the result
+    size_t nread = 0;
+    while (nread < (size_t) blen)
     {
-      eos_err("seek to %llu failed\n", mOffset);
+      size_t len = mStream->Read(buff + nread, blen - nread);
+      if (!len)
+        break;
+      nread += len;
     }
-    return 0;
+    return nread;
   }
   else
   {
@@ -742,7 +911,8 @@ int
 ProcCommand::stat (struct stat* buf)
 {
   memset(buf, 0, sizeof (struct stat));
-  buf->st_size = mLen;
+  // the size of a streamed result is unknown until it has been read
+  buf->st_size = mStream ? 0 : mLen;
 
   return SFS_OK;
 }
@@ -757,6 +927,15 @@ ProcCommand::stat (struct stat* buf)
 int
 ProcCommand::close ()
 {
+  if (mStream)
+  {
+    // stop the command if the client did not read the complete result
+    mStream->Abort();
+    XrdSysThread::Join(mStreamThread, 0);
+    delete mStream;
+    mStream = 0;
+  }
+
   if (!mClosed)
   {
     // only instance users or sudoers can add to the log book
@@ -787,10 +966,10 @@ ProcCommand::close ()
 void
 ProcCommand::MakeResult ()
 {
-  mResultStream = "";
-
   if (!fstdout)
   {
+    mResultStream = "";
+
     if (mDoSort)
     {
       eos::common::StringConversion::SortLines(stdOut);
@@ -991,70 +1170,40 @@ ProcCommand::MakeResult ()
   else
   {
     // --------------------------------------------------------------------------
-    // file based results CANNOT be sorted and don't have mFuseFormat
+    // stream based results CANNOT be sorted - the stdout has already been
+    // appended to the result while it was written, closing the streams
+    // flushes what is left
     // --------------------------------------------------------------------------
+    fclose(fstdout);
+    fstdout = 0;
+    fclose(fstderr);
+    fstderr = 0;
+
+    if (mLastOut != '\n')
+    {
+      AppendResult("\n", 1);
+    }
+
     if (!mFuseFormat)
     {
       // ------------------------------------------------------------------------
-      // create the stdout result
+      // create the stderr result
       // ------------------------------------------------------------------------
-      if (!fseek(fstdout, 0, 0) &&
-          !fseek(fstderr, 0, 0) &&
-          !fseek(fresultStream, 0, 0))
-      {
-        fprintf(fresultStream, "&mgm.proc.stdout=");
-
-        std::ifstream inStdout(fstdoutfilename.c_str());
-        std::ifstream inStderr(fstderrfilename.c_str());
-        std::string entry;
-
-        while (std::getline(inStdout, entry))
-        {
-          XrdOucString sentry = entry.c_str();
-          sentry += "\n";
-          if (!mFuseFormat)
-          {
-            XrdMqMessage::Seal(sentry);
-          }
-          fprintf(fresultStream, "%s", sentry.c_str());
-        }
-        // ----------------------------------------------------------------------
-        // close and remove - if this fails there is nothing to recover anyway
-        // ----------------------------------------------------------------------
-        fclose(fstdout);
-        fstdout = 0;
-        unlink(fstdoutfilename.c_str());
-        // ----------------------------------------------------------------------
-        // create the stderr result
-        // ----------------------------------------------------------------------
-        fprintf(fresultStream, "&mgm.proc.stderr=");
-        while (std::getline(inStderr, entry))
-        {
-          XrdOucString sentry = entry.c_str();
-          sentry += "\n";
-          XrdMqMessage::Seal(sentry);
-          fprintf(fresultStream, "%s", sentry.c_str());
-        }
-        // ----------------------------------------------------------------------
-        // close and remove - if this fails there is nothing to recover anyway
-        // ----------------------------------------------------------------------
-        fclose(fstderr);
-        fstderr = 0;
-        unlink(fstderrfilename.c_str());
+      XrdOucString tail = "&mgm.proc.stderr=";
+      XrdOucString serr = mStreamErr.c_str();
 
-        fprintf(fresultStream, "&mgm.proc.retc=%d", retc);
-        mLen = ftell(fresultStream);
-        // ----------------------------------------------------------------------
-        // spool the resultstream to the beginning
-        // ----------------------------------------------------------------------
-        fseek(fresultStream, 0, 0);
-      }
-      else
+      if (serr.length() && !serr.endswith('\n'))
       {
-
-        eos_static_err("cannot seek to position 0 in result files");
+        serr += "\n";
       }
+      tail += XrdMqMessage::Seal(serr);
+      tail += "&mgm.proc.retc=";
+      tail += retc;
+      AppendResult(tail.c_str(), tail.length());
     }
+    mStreamErr = "";
+    mLen = mResultStream.length();
+    mOffset = 0;
   }
 }
 
@@ -28,6 +28,7 @@
 #include "mgm/Namespace.hh"
 #include "common/Logging.hh"
 #include "common/Mapping.hh"
+#include "mgm/ProcStream.hh"
 #include "proc/proc_fs.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOuc/XrdOucString.hh"
@@ -54,6 +55,9 @@ EOSMGMNAMESPACE_BEGIN
  * opaque output stream with 3 keys indicating the three return objects.
  * The resultstream is streamed by a client like a file read using 'xrdcp'
  * issuing several read requests. On close the resultstream is freed.
+ * Commands with potentially huge outputs like 'find' can be streamed: they
+ * run in a separate thread writing into a bounded buffer which is consumed by
+ * the client reads, so the memory used does not depend on the output size.
  *
  * The implementations of user commands are found under mgm/proc/user/X.cc
  * The implementations of admin commands are found under mgm/proc/admin/X.cc
@@ -106,15 +110,20 @@ private:
 
 
   // -------------------------------------------------------------------------
-  //! the 'find' command does not keep results in memory but writes to
-  //! a temporary output file which is streamed to the client
+  //! the 'find' command does not build its stdout in a string but writes it
+  //! to an output stream which is sealed on the fly and appended to the
+  //! result - if the command is streamed the result goes through a bounded
+  //! buffer to the client while the command is still running. The stderr
+  //! is collected in memory since it follows the stdout in the result.
   // -------------------------------------------------------------------------
   FILE* fstdout;
   FILE* fstderr;
-  FILE* fresultStream;
-  XrdOucString fstdoutfilename;
-  XrdOucString fstderrfilename;
-  XrdOucString fresultStreamfilename;
+  std::string mStreamErr; //< stderr collected from fstderr
+  char mLastOut; //< last character written to fstdout
+  bool mStreaming; //< execute the command in a thread and stream the result
+  ProcStream* mStream; //< buffer between the command thread and the client
+  pthread_t mStreamThread; //< thread executing a streamed command
+  XrdOucString mInfo; //< copy of the opaque info used by a streamed command
   XrdOucErrInfo* mError;
 
   XrdOucString mComment; //< comment issued by the user for the proc comamnd
@@ -128,6 +137,24 @@ private:
   // -------------------------------------------------------------------------
   void MakeResult ();
 
+  // -------------------------------------------------------------------------
+  //! Append raw data to the result - to the stream if the command is
+  //! streamed, otherwise to the in-memory result
+  // -------------------------------------------------------------------------
+  void AppendResult (const char* data, size_t len);
+
+  // -------------------------------------------------------------------------
+  //! Output stream callbacks for fstdout and fstderr
+  // -------------------------------------------------------------------------
+  static ssize_t WriteStdOut (void* cookie, const char* buf, size_t size);
+  static ssize_t WriteStdErr (void* cookie, const char* buf, size_t size);
+
+  // -------------------------------------------------------------------------
+  //! Start function and body of the thread executing a streamed command
+  // -------------------------------------------------------------------------
+  static void* StartStreamThread (void* pp);
+  void StreamThread ();
+
   // helper function able to detect key value pair output and convert to http table format
   bool KeyValToHttpTable(XrdOucString &stdOut);
   bool mAdminCmd; // < indicates an admin command
@@ -310,9 +337,28 @@ public:
   }
 
   // -------------------------------------------------------------------------
-  //! open temporary outputfiles for find commands
+  //! open the output streams for find commands
+  // -------------------------------------------------------------------------
+  bool OpenOutputStreams ();
+
+  // -------------------------------------------------------------------------
+  //! wait until the client consumed enough of a streamed result - returns
+  //! false if the client has gone away and the command should stop. It must
+  //! not be called while holding any namespace lock.
   // -------------------------------------------------------------------------
-  bool OpenTemporaryOutputFiles ();
+  bool WaitForClient ();
+
+  // -------------------------------------------------------------------------
+  //! execute the next opened 'find' command in a separate thread streaming
+  //! the result to the reader instead of building it in memory. The result
+  //! can then only be read sequentially and its size is unknown.
+  // -------------------------------------------------------------------------
+
+  void
+  SetStreaming (bool streaming)
+  {
+    mStreaming = streaming;
+  }
 
   // -------------------------------------------------------------------------
   //! get the return code of a proc command
@@ -324,14 +370,6 @@ public:
   }
 
 
-  //----------------------------------------------------------------------------
-  //! Get result file name 
-  //----------------------------------------------------------------------------
-  inline const char* GetResultFn() const
-  {
-    return fresultStreamfilename.c_str();
-  }
-
   // -------------------------------------------------------------------------
   //! list of user proc commands
   // -------------------------------------------------------------------------
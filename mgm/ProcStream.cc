@@ -0,0 +1,197 @@
+// ----------------------------------------------------------------------
+// File: ProcStream.cc
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/ProcStream.hh"
+/*----------------------------------------------------------------------------*/
+#include <string.h>
+#include <algorithm>
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+ProcStream::ProcStream(size_t capacity):
+  mCond(0),
+  mCapacity(capacity ? capacity : 1),
+  mHead(0),
+  mSize(0),
+  mOffset(0),
+  mClosed(false),
+  mAborted(false)
+{
+  mBuffer.resize(mCapacity);
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+ProcStream::~ProcStream() { }
+
+
+//------------------------------------------------------------------------------
+// Append data to the stream
+//------------------------------------------------------------------------------
+bool
+ProcStream::Write(const char* data, size_t len)
+{
+  XrdSysCondVarHelper lock(mCond);
+
+  if (mAborted)
+    return false;
+
+  if (!len)
+    return true;
+
+  // Grow the buffer for an entry which does not fit - it shrinks back to its
+  // capacity once the consumer has drained it
+  if (mSize + len > mBuffer.size())
+    Resize(mSize + len);
+
+  size_t tail = (mHead + mSize) % mBuffer.size();
+  size_t first = std::min(len, mBuffer.size() - tail);
+  memcpy(&mBuffer[tail], data, first);
+
+  if (first < len)
+    memcpy(&mBuffer[0], data + first, len - first);
+
+  mSize += len;
+  mCond.Broadcast();
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Wait until the buffered data is below the capacity
+//------------------------------------------------------------------------------
+bool
+ProcStream::WaitForSpace()
+{
+  XrdSysCondVarHelper lock(mCond);
+
+  while (!mAborted && (mSize >= mCapacity))
+    mCond.Wait();
+
+  return !mAborted;
+}
+
+
+//------------------------------------------------------------------------------
+// Mark the end of the stream
+//------------------------------------------------------------------------------
+void
+ProcStream::Close()
+{
+  XrdSysCondVarHelper lock(mCond);
+  mClosed = true;
+  mCond.Broadcast();
+}
+
+
+//------------------------------------------------------------------------------
+// Read the next part of the stream
+//------------------------------------------------------------------------------
+size_t
+ProcStream::Read(char* buff, size_t len)
+{
+  XrdSysCondVarHelper lock(mCond);
+
+  // Don't wait for more than the producer is allowed to buffer
+  while (!mClosed && !mAborted && (mSize < len) && (mSize < mCapacity))
+    mCond.Wait();
+
+  if (mAborted)
+    return 0;
+
+  size_t nread = std::min(len, mSize);
+  size_t first = std::min(nread, mBuffer.size() - mHead);
+  memcpy(buff, &mBuffer[mHead], first);
+
+  if (first < nread)
+    memcpy(buff + first, &mBuffer[0], nread - first);
+
+  mHead = (mHead + nread) % mBuffer.size();
+  mSize -= nread;
+  mOffset += nread;
+
+  if (!mSize)
+  {
+    mHead = 0;
+
+    if (mBuffer.size() > mCapacity)
+      Resize(mCapacity);
+  }
+
+  mCond.Broadcast();
+  return nread;
+}
+
+
+//------------------------------------------------------------------------------
+// Drop the buffered data and release the producer
+//------------------------------------------------------------------------------
+void
+ProcStream::Abort()
+{
+  XrdSysCondVarHelper lock(mCond);
+  mAborted = true;
+  mSize = 0;
+  mHead = 0;
+  std::vector<char>().swap(mBuffer);
+  mCond.Broadcast();
+}
+
+
+//------------------------------------------------------------------------------
+// Get the number of bytes consumed so far
+//------------------------------------------------------------------------------
+uint64_t
+ProcStream::GetOffset()
+{
+  XrdSysCondVarHelper lock(mCond);
+  return mOffset;
+}
+
+
+//------------------------------------------------------------------------------
+// Resize the ring buffer keeping its content
+//------------------------------------------------------------------------------
+void
+ProcStream::Resize(size_t size)
+{
+  std::vector<char> buffer(size);
+  size_t first = std::min(mSize, mBuffer.size() - mHead);
+
+  if (first)
+    memcpy(&buffer[0], &mBuffer[mHead], first);
+
+  if (first < mSize)
+    memcpy(&buffer[first], &mBuffer[0], mSize - first);
+
+  mBuffer.swap(buffer);
+  mHead = 0;
+}
+
+EOSMGMNAMESPACE_END
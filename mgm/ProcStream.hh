@@ -0,0 +1,145 @@
+// ----------------------------------------------------------------------
+// File: ProcStream.hh
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_PROCSTREAM__HH__
+#define __EOSMGM_PROCSTREAM__HH__
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <sys/types.h>
+#include <stdint.h>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+//! default capacity of a proc stream buffer in bytes
+#define EOSMGMPROCSTREAMBUFFER (4 * 1024 * 1024)
+
+//------------------------------------------------------------------------------
+//! Class ProcStream
+//!
+//! @description Bounded ring buffer handing the result of a proc command from
+//!   the thread executing it (producer) to the client reading it (consumer).
+//!   The producer is held back in WaitForSpace while the buffer is filled up to
+//!   its capacity and the consumer waits in Read until enough data arrived or
+//!   the producer is done, so the memory used does not depend on the size of
+//!   the result. Write itself never blocks: an entry larger than the free space
+//!   grows the buffer once, so producers can write while holding namespace
+//!   locks and only wait at points where they hold none.
+//------------------------------------------------------------------------------
+class ProcStream
+{
+public:
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param capacity number of buffered bytes above which the producer waits
+  //----------------------------------------------------------------------------
+  ProcStream(size_t capacity = EOSMGMPROCSTREAMBUFFER);
+
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~ProcStream();
+
+
+  //----------------------------------------------------------------------------
+  //! Append data to the stream (producer side)
+  //!
+  //! @param data data to append
+  //! @param len length of the data
+  //!
+  //! @return true if successful, false if the consumer has gone away
+  //----------------------------------------------------------------------------
+  bool Write(const char* data, size_t len);
+
+
+  //----------------------------------------------------------------------------
+  //! Wait until the buffered data is below the capacity (producer side)
+  //!
+  //! @return true if the producer can go on, false if the consumer has gone
+  //!         away and the producer should stop
+  //----------------------------------------------------------------------------
+  bool WaitForSpace();
+
+
+  //----------------------------------------------------------------------------
+  //! Mark the end of the stream (producer side)
+  //----------------------------------------------------------------------------
+  void Close();
+
+
+  //----------------------------------------------------------------------------
+  //! Read the next part of the stream (consumer side). It waits until len bytes
+  //! are available, the buffered data reached the capacity or the stream is
+  //! closed. A len larger than the capacity can therefore return less than len
+  //! bytes before the end of the stream, callers have to read again until 0.
+  //!
+  //! @param buff buffer to fill
+  //! @param len length of the buffer
+  //!
+  //! @return number of bytes read, 0 only at the end of the stream or after
+  //!         Abort
+  //----------------------------------------------------------------------------
+  size_t Read(char* buff, size_t len);
+
+
+  //----------------------------------------------------------------------------
+  //! Drop the buffered data and release the producer (consumer side)
+  //----------------------------------------------------------------------------
+  void Abort();
+
+
+  //----------------------------------------------------------------------------
+  //! Get the number of bytes consumed so far i.e. the offset of the next read
+  //----------------------------------------------------------------------------
+  uint64_t GetOffset();
+
+private:
+
+  XrdSysCondVar mCond; ///< protects and signals changes of the members below
+  std::vector<char> mBuffer; ///< ring buffer
+  size_t mCapacity; ///< buffered bytes above which the producer waits
+  size_t mHead; ///< position of the first buffered byte in mBuffer
+  size_t mSize; ///< number of buffered bytes
+  uint64_t mOffset; ///< number of bytes consumed
+  bool mClosed; ///< producer is done
+  bool mAborted; ///< consumer has gone away
+
+
+  //----------------------------------------------------------------------------
+  //! Resize the ring buffer keeping its content, the caller holds mCond
+  //!
+  //! @param size new size of the buffer, at least mSize
+  //----------------------------------------------------------------------------
+  void Resize(size_t size);
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
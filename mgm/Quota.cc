@@ -51,7 +51,8 @@ SpaceQuota::SpaceQuota(const char* path):
   mQuotaNode((eos::IQuotaNode*)0),
   mLastEnableCheck(0),
   mLayoutSizeFactor(1.0),
-  mDirtyTarget(true)
+  mDirtyTarget(true),
+  mProjectUpdateTime(0)
 {
   std::shared_ptr<eos::IContainerMD> quotadir;
 
@@ -214,11 +215,9 @@ bool
 SpaceQuota::RmQuota(unsigned long tag, unsigned long id)
 {
   eos_static_debug("rm quota tag=%lu id=%lu", tag, id);
-  XrdSysMutexHelper scope_lock(mMutex);
 
-  if (mMapIdQuota.count(Index(tag, id)))
+  if (mQuotaTable.Erase(Index(tag, id)))
   {
-    mMapIdQuota.erase(Index(tag, id));
     mDirtyTarget = true;
     return true;
   }
@@ -232,8 +231,7 @@ SpaceQuota::RmQuota(unsigned long tag, unsigned long id)
 long long
 SpaceQuota::GetQuota(unsigned long tag, unsigned long id)
 {
-  XrdSysMutexHelper scope_lock(mMutex);
-  return static_cast<long long>(mMapIdQuota[Index(tag, id)]);
+  return mQuotaTable.Get(Index(tag, id));
 }
 
 //------------------------------------------------------------------------------
@@ -243,8 +241,7 @@ void
 SpaceQuota::SetQuota(unsigned long tag, unsigned long id, unsigned long long value)
 {
   eos_static_debug("set quota tag=%lu id=%lu value=%llu", tag, id, value);
-  XrdSysMutexHelper scope_lock(mMutex);
-  mMapIdQuota[Index(tag, id)] = value;
+  mQuotaTable.Set(Index(tag, id), static_cast<long long>(value));
 
   if ((tag == kUserBytesTarget) ||
       (tag == kGroupBytesTarget) ||
@@ -263,7 +260,7 @@ SpaceQuota::SetQuota(unsigned long tag, unsigned long id, unsigned long long val
 void
 SpaceQuota::ResetQuota(unsigned long tag, unsigned long id)
 {
-  mMapIdQuota[Index(tag, id)] = 0;
+  mQuotaTable.Set(Index(tag, id), 0);
 
   if ((tag == kUserBytesTarget) ||
       (tag == kGroupBytesTarget) ||
@@ -285,11 +282,9 @@ SpaceQuota::AddQuota(unsigned long tag, unsigned long id, long long value)
   eos_static_debug("add quota tag=%lu id=%lu value=%llu", tag, id, value);
 
   // Avoid negative numbers
-  if (((long long) mMapIdQuota[Index(tag, id)] + value) >= 0)
-    mMapIdQuota[Index(tag, id)] += value;
-
+  mQuotaTable.Add(Index(tag, id), value);
   eos_static_debug("sum quota tag=%lu id=%lu value=%llu", tag, id,
-		   mMapIdQuota[Index(tag, id)]);
+		   mQuotaTable.Get(Index(tag, id)));
 }
 
 //------------------------------------------------------------------------------
@@ -304,33 +299,40 @@ SpaceQuota::UpdateTargetSums()
   eos_static_debug("updating targets");
   XrdSysMutexHelper scope_lock(mMutex);
   mDirtyTarget = false;
-  mMapIdQuota[Index(kAllUserBytesTarget, 0)] = 0;
-  mMapIdQuota[Index(kAllUserFilesTarget, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupBytesTarget, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupFilesTarget, 0)] = 0;
-  mMapIdQuota[Index(kAllUserLogicalBytesTarget, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupLogicalBytesTarget, 0)] = 0;
-
-  for (auto it = mMapIdQuota.begin(); it != mMapIdQuota.end(); it++)
+  long long user_bytes = 0, user_logical_bytes = 0, user_files = 0;
+  long long group_bytes = 0, group_logical_bytes = 0, group_files = 0;
+  std::vector< std::pair<unsigned long long, long long> > entries;
+  mQuotaTable.GetEntries(entries);
+
+  // The sums are computed aside and published at once, so that concurrent
+  // checks never see partial sums
+  for (auto it = entries.begin(); it != entries.end(); it++)
   {
     if ((UnIndex(it->first) == kUserBytesTarget))
     {
-      AddQuota(kAllUserBytesTarget, 0, it->second);
-      AddQuota(kAllUserLogicalBytesTarget, 0, it->second / mLayoutSizeFactor);
+      user_bytes += it->second;
+      user_logical_bytes += (long long)(it->second / mLayoutSizeFactor);
     }
 
     if ((UnIndex(it->first) == kUserFilesTarget))
-      AddQuota(kAllUserFilesTarget, 0, it->second);
+      user_files += it->second;
 
     if ((UnIndex(it->first) == kGroupBytesTarget))
     {
-      AddQuota(kAllGroupBytesTarget, 0, it->second);
-      AddQuota(kAllGroupLogicalBytesTarget, 0, it->second / mLayoutSizeFactor);
+      group_bytes += it->second;
+      group_logical_bytes += (long long)(it->second / mLayoutSizeFactor);
     }
 
     if ((UnIndex(it->first) == kGroupFilesTarget))
-      AddQuota(kAllGroupFilesTarget, 0, it->second);
+      group_files += it->second;
   }
+
+  mQuotaTable.Set(Index(kAllUserBytesTarget, 0), user_bytes);
+  mQuotaTable.Set(Index(kAllUserFilesTarget, 0), user_files);
+  mQuotaTable.Set(Index(kAllGroupBytesTarget, 0), group_bytes);
+  mQuotaTable.Set(Index(kAllGroupFilesTarget, 0), group_files);
+  mQuotaTable.Set(Index(kAllUserLogicalBytesTarget, 0), user_logical_bytes);
+  mQuotaTable.Set(Index(kAllGroupLogicalBytesTarget, 0), group_logical_bytes);
 }
 
 //------------------------------------------------------------------------------
@@ -340,41 +342,39 @@ void
 SpaceQuota::UpdateIsSums()
 {
   eos_static_debug("updating IS values");
-
   XrdSysMutexHelper scope_lock(mMutex);
-  mMapIdQuota[Index(kAllUserBytesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllUserLogicalBytesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllUserFilesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupBytesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupFilesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupLogicalBytesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllUserBytesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllUserLogicalBytesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllUserFilesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupBytesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupFilesIs, 0)] = 0;
-  mMapIdQuota[Index(kAllGroupLogicalBytesIs, 0)] = 0;
-
-  for (auto it = mMapIdQuota.begin(); it != mMapIdQuota.end(); it++)
+  long long user_bytes = 0, user_logical_bytes = 0, user_files = 0;
+  long long group_bytes = 0, group_logical_bytes = 0, group_files = 0;
+  std::vector< std::pair<unsigned long long, long long> > entries;
+  mQuotaTable.GetEntries(entries);
+
+  for (auto it = entries.begin(); it != entries.end(); it++)
   {
     if ((UnIndex(it->first) == kUserBytesIs))
-      AddQuota(kAllUserBytesIs, 0, it->second);
+      user_bytes += it->second;
 
     if ((UnIndex(it->first) == kUserLogicalBytesIs))
-      AddQuota(kAllUserLogicalBytesIs, 0, it->second);
+      user_logical_bytes += it->second;
 
     if ((UnIndex(it->first) == kUserFilesIs))
-      AddQuota(kAllUserFilesIs, 0, it->second);
+      user_files += it->second;
 
     if ((UnIndex(it->first) == kGroupBytesIs))
-      AddQuota(kAllGroupBytesIs, 0, it->second);
+      group_bytes += it->second;
 
     if ((UnIndex(it->first) == kGroupLogicalBytesIs))
-      AddQuota(kAllGroupLogicalBytesIs, 0, it->second);
+      group_logical_bytes += it->second;
 
     if ((UnIndex(it->first) == kGroupFilesIs))
-      AddQuota(kAllGroupFilesIs, 0, it->second);
+      group_files += it->second;
   }
+
+  mQuotaTable.Set(Index(kAllUserBytesIs, 0), user_bytes);
+  mQuotaTable.Set(Index(kAllUserLogicalBytesIs, 0), user_logical_bytes);
+  mQuotaTable.Set(Index(kAllUserFilesIs, 0), user_files);
+  mQuotaTable.Set(Index(kAllGroupBytesIs, 0), group_bytes);
+  mQuotaTable.Set(Index(kAllGroupFilesIs, 0), group_files);
+  mQuotaTable.Set(Index(kAllGroupLogicalBytesIs, 0), group_logical_bytes);
 }
 
 //------------------------------------------------------------------------------
@@ -384,61 +384,53 @@ void
 SpaceQuota::UpdateFromQuotaNode(uid_t uid, gid_t gid, bool upd_proj_quota)
 {
   eos_static_debug("updating uid/gid values from quota node");
-  XrdSysMutexHelper scope_lock(mMutex);
 
+  // Every value is published with a single store, so concurrent checks see
+  // either the old or the new one but never a reset counter
   if (mQuotaNode)
   {
-    mMapIdQuota[Index(kUserBytesIs, uid)] = 0;
-    mMapIdQuota[Index(kUserLogicalBytesIs, uid)] = 0;
-    mMapIdQuota[Index(kUserFilesIs, uid)] = 0;
-    mMapIdQuota[Index(kGroupBytesIs, gid)] = 0;
-    mMapIdQuota[Index(kGroupFilesIs, gid)] = 0;
-    mMapIdQuota[Index(kGroupLogicalBytesIs, gid)] = 0;
-
-    AddQuota(kUserBytesIs, uid, mQuotaNode->getPhysicalSpaceByUser(uid));
-    AddQuota(kUserLogicalBytesIs, uid, mQuotaNode->getUsedSpaceByUser(uid));
-    AddQuota(kUserFilesIs, uid, mQuotaNode->getNumFilesByUser(uid));
-    AddQuota(kGroupBytesIs, gid, mQuotaNode->getPhysicalSpaceByGroup(gid));
-    AddQuota(kGroupLogicalBytesIs, gid, mQuotaNode->getUsedSpaceByGroup(gid));
-    AddQuota(kGroupFilesIs, gid, mQuotaNode->getNumFilesByGroup(gid));
-
-    mMapIdQuota[Index(kUserBytesIs, Quota::gProjectId)] = 0;
-    mMapIdQuota[Index(kUserLogicalBytesIs, Quota::gProjectId)] = 0;
-    mMapIdQuota[Index(kUserFilesIs, Quota::gProjectId)] = 0;
+    mQuotaTable.Set(Index(kUserBytesIs, uid),
+		    mQuotaNode->getPhysicalSpaceByUser(uid));
+    mQuotaTable.Set(Index(kUserLogicalBytesIs, uid),
+		    mQuotaNode->getUsedSpaceByUser(uid));
+    mQuotaTable.Set(Index(kUserFilesIs, uid),
+		    mQuotaNode->getNumFilesByUser(uid));
+    mQuotaTable.Set(Index(kGroupBytesIs, gid),
+		    mQuotaNode->getPhysicalSpaceByGroup(gid));
+    mQuotaTable.Set(Index(kGroupLogicalBytesIs, gid),
+		    mQuotaNode->getUsedSpaceByGroup(gid));
+    mQuotaTable.Set(Index(kGroupFilesIs, gid),
+		    mQuotaNode->getNumFilesByGroup(gid));
+
+    mQuotaTable.Set(Index(kUserBytesIs, Quota::gProjectId), 0);
+    mQuotaTable.Set(Index(kUserLogicalBytesIs, Quota::gProjectId), 0);
+    mQuotaTable.Set(Index(kUserFilesIs, Quota::gProjectId), 0);
 
     if (upd_proj_quota)
     {
       // Recalculate the project quota only every 5 seconds to boost perf.
-      static XrdSysMutex lMutex;
-      static time_t lUpdateTime = 0;
-      bool docalc = false;
-      {
-	XrdSysMutexHelper lock(lMutex);
-	time_t now = time(NULL);
-
-	if (lUpdateTime < now)
-	{
-	  // Next recalculation in 5 second
-	  docalc = true;
-	  lUpdateTime = now + 5;
-	}
-      }
+      time_t now = time(NULL);
+      time_t last = mProjectUpdateTime.load();
 
-      if (docalc)
+      // Only the thread moving the next recalculation time does it
+      if ((last < now) && mProjectUpdateTime.compare_exchange_strong(last, now + 5))
       {
-	mMapIdQuota[Index(kGroupBytesIs, Quota::gProjectId)] = 0;
-	mMapIdQuota[Index(kGroupFilesIs, Quota::gProjectId)] = 0;
-	mMapIdQuota[Index(kGroupLogicalBytesIs, Quota::gProjectId)] = 0;
+	long long bytes = 0, logical_bytes = 0, files = 0;
 
 	// Loop over users and fill project quota
 	std::vector<unsigned long> uids = mQuotaNode->getUids();
 
 	for (auto itu = uids.begin(); itu != uids.end(); ++itu)
 	{
-	  AddQuota(kGroupBytesIs, Quota::gProjectId, mQuotaNode->getPhysicalSpaceByUser(*itu));
-	  AddQuota(kGroupLogicalBytesIs, Quota::gProjectId, mQuotaNode->getUsedSpaceByUser(*itu));
-	  AddQuota(kGroupFilesIs, Quota::gProjectId, mQuotaNode->getNumFilesByUser(*itu));
+	  bytes += mQuotaNode->getPhysicalSpaceByUser(*itu);
+	  logical_bytes += mQuotaNode->getUsedSpaceByUser(*itu);
+	  files += mQuotaNode->getNumFilesByUser(*itu);
 	}
+
+	mQuotaTable.Set(Index(kGroupBytesIs, Quota::gProjectId), bytes);
+	mQuotaTable.Set(Index(kGroupFilesIs, Quota::gProjectId), files);
+	mQuotaTable.Set(Index(kGroupLogicalBytesIs, Quota::gProjectId),
+			logical_bytes);
       }
     }
   }
@@ -470,13 +462,14 @@ SpaceQuota::PrintOut(XrdOucString& output, long uid_sel, long gid_sel,
   XrdOucString header;
 
   {
-    XrdSysMutexHelper scope_lock(mMutex);
+    std::vector< std::pair<unsigned long long, long long> > entries;
+    mQuotaTable.GetEntries(entries);
 
     // For project space we just print the user/group entry gProjectId
-    if (mMapIdQuota[Index(kGroupBytesTarget, Quota::gProjectId)] > 0)
+    if (GetQuota(kGroupBytesTarget, Quota::gProjectId) > 0)
       gid_sel = Quota::gProjectId;
 
-    for (auto it = mMapIdQuota.begin(); it != mMapIdQuota.end(); it++)
+    for (auto it = entries.begin(); it != entries.end(); it++)
     {
       if ((UnIndex(it->first) >= kUserBytesIs)
 	  && (UnIndex(it->first) <= kUserFilesTarget))
@@ -899,8 +892,22 @@ SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
   // Update info from the ns quota node - user, group and project quotas
   UpdateFromQuotaNode(uid, gid, GetQuota(kGroupBytesTarget, Quota::gProjectId)
 		      ? true : false);
+  // Take a snapshot of the values used by the decision, each one is read once
+  // from the lock-free quota table
+  long long user_bytes_target = GetQuota(kUserBytesTarget, uid);
+  long long user_bytes_is = GetQuota(kUserBytesIs, uid);
+  long long user_files_target = GetQuota(kUserFilesTarget, uid);
+  long long user_files_is = GetQuota(kUserFilesIs, uid);
+  long long group_bytes_target = GetQuota(kGroupBytesTarget, gid);
+  long long group_bytes_is = GetQuota(kGroupBytesIs, gid);
+  long long group_files_target = GetQuota(kGroupFilesTarget, gid);
+  long long group_files_is = GetQuota(kGroupFilesIs, gid);
+  long long proj_bytes_target = GetQuota(kGroupBytesTarget, Quota::gProjectId);
+  long long proj_bytes_is = GetQuota(kGroupBytesIs, Quota::gProjectId);
+  long long proj_files_target = GetQuota(kGroupFilesTarget, Quota::gProjectId);
+  long long proj_files_is = GetQuota(kGroupFilesIs, Quota::gProjectId);
   eos_static_info("uid=%d gid=%d size=%llu quota=%llu", uid, gid, desired_vol,
-		  GetQuota(kUserBytesTarget, uid));
+		  user_bytes_target);
   bool userquota = false;
   bool groupquota = false;
   bool projectquota = false;
@@ -912,25 +919,25 @@ SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
   bool groupvolumequota = false;
   bool groupinodequota = false;
 
-  if (GetQuota(kUserBytesTarget, uid) > 0)
+  if (user_bytes_target > 0)
   {
     userquota = true;
     uservolumequota = true;
   }
 
-  if (GetQuota(kGroupBytesTarget, gid) > 0)
+  if (group_bytes_target > 0)
   {
     groupquota = true;
     groupvolumequota = true;
   }
 
-  if (GetQuota(kUserFilesTarget, uid) > 0)
+  if (user_files_target > 0)
   {
     userquota = true;
     userinodequota = true;
   }
 
-  if (GetQuota(kGroupFilesTarget, gid) > 0)
+  if (group_files_target > 0)
   {
     groupquota = true;
     groupinodequota = true;
@@ -938,7 +945,7 @@ SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
 
   if (uservolumequota)
   {
-    if ((GetQuota(kUserBytesTarget, uid) - GetQuota(kUserBytesIs, uid)) > (long long)desired_vol)
+    if ((user_bytes_target - user_bytes_is) > (long long)desired_vol)
     {
       hasuserquota = true;
     }
@@ -950,7 +957,7 @@ SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
 
   if (userinodequota)
   {
-    if ((GetQuota(kUserFilesTarget, uid) - GetQuota(kUserFilesIs, uid)) > inodes)
+    if ((user_files_target - user_files_is) > inodes)
     {
       if (!uservolumequota)
 	hasuserquota = true;
@@ -963,7 +970,7 @@ SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
 
   if (groupvolumequota)
   {
-    if ((GetQuota(kGroupBytesTarget, gid) - GetQuota(kGroupBytesIs, gid)) > desired_vol)
+    if ((group_bytes_target - group_bytes_is) > desired_vol)
     {
       hasgroupquota = true;
     }
@@ -975,7 +982,7 @@ SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
 
   if (groupinodequota)
   {
-    if ((GetQuota(kGroupFilesTarget, gid) - GetQuota(kGroupFilesIs, gid)) > inodes)
+    if ((group_files_target - group_files_is) > inodes)
     {
       if (!groupvolumequota)
 	hasgroupquota = true;
@@ -986,10 +993,8 @@ SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
     }
   }
 
-  if (((GetQuota(kGroupBytesTarget, Quota::gProjectId) -
-	GetQuota(kGroupBytesIs, Quota::gProjectId)) > desired_vol) &&
-      ((GetQuota(kGroupFilesTarget, Quota::gProjectId) -
-	GetQuota(kGroupFilesIs, Quota::gProjectId)) > inodes))
+  if (((proj_bytes_target - proj_bytes_is) > desired_vol) &&
+      ((proj_files_target - proj_files_is) > inodes))
   {
     hasprojectquota = true;
   }
@@ -1028,33 +1033,32 @@ SpaceQuota::AccountNsToSpace()
   if (UpdateQuotaNodeAddress())
   {
     XrdSysMutexHelper scope_lock(mMutex);
-
-    // Insert current state of a single quota node into a SpaceQuota
-    ResetQuota(kGroupBytesIs, Quota::gProjectId);
-    ResetQuota(kGroupFilesIs, Quota::gProjectId);
-    ResetQuota(kGroupLogicalBytesIs, Quota::gProjectId);
+    // Insert current state of a single quota node into a SpaceQuota, every
+    // value is set at once so that concurrent checks never see it reset
+    long long proj_bytes = 0, proj_logical_bytes = 0, proj_files = 0;
+    bool is_project = (GetQuota(kGroupBytesTarget, Quota::gProjectId) > 0);
 
     // Loop over users
     std::vector<unsigned long> uids = mQuotaNode->getUids();
 
     for (auto itu = uids.begin(); itu != uids.end(); ++itu)
     {
-      ResetQuota(kUserBytesIs, *itu);
-      AddQuota(kUserBytesIs, *itu, mQuotaNode->getPhysicalSpaceByUser(*itu));
-      ResetQuota(kUserFilesIs, *itu);
-      AddQuota(kUserFilesIs, *itu, mQuotaNode->getNumFilesByUser(*itu));
-      ResetQuota(kUserLogicalBytesIs, *itu);
-      AddQuota(kUserLogicalBytesIs, *itu, mQuotaNode->getUsedSpaceByUser(*itu));
-
-      if (mMapIdQuota[Index(kGroupBytesTarget, Quota::gProjectId)] > 0)
+      SetQuota(kUserBytesIs, *itu, mQuotaNode->getPhysicalSpaceByUser(*itu));
+      SetQuota(kUserFilesIs, *itu, mQuotaNode->getNumFilesByUser(*itu));
+      SetQuota(kUserLogicalBytesIs, *itu, mQuotaNode->getUsedSpaceByUser(*itu));
+
+      if (is_project)
       {
 	// Only account in project quota nodes
-	AddQuota(kGroupBytesIs, Quota::gProjectId, mQuotaNode->getPhysicalSpaceByUser(*itu));
-	AddQuota(kGroupLogicalBytesIs, Quota::gProjectId, mQuotaNode->getUsedSpaceByUser(*itu));
-	AddQuota(kGroupFilesIs, Quota::gProjectId, mQuotaNode->getNumFilesByUser(*itu));
+	proj_bytes += mQuotaNode->getPhysicalSpaceByUser(*itu);
+	proj_logical_bytes += mQuotaNode->getUsedSpaceByUser(*itu);
+	proj_files += mQuotaNode->getNumFilesByUser(*itu);
       }
     }
 
+    SetQuota(kGroupBytesIs, Quota::gProjectId, proj_bytes);
+    SetQuota(kGroupFilesIs, Quota::gProjectId, proj_files);
+    SetQuota(kGroupLogicalBytesIs, Quota::gProjectId, proj_logical_bytes);
     std::vector<unsigned long> gids = mQuotaNode->getGids();
 
     for (auto itg = gids.begin(); itg != gids.end(); ++itg)
@@ -1063,12 +1067,9 @@ SpaceQuota::AccountNsToSpace()
       if (*itg == Quota::gProjectId)
 	continue;
 
-      ResetQuota(kGroupBytesIs, *itg);
-      AddQuota(kGroupBytesIs, *itg, mQuotaNode->getPhysicalSpaceByGroup(*itg));
-      ResetQuota(kGroupFilesIs, *itg);
-      AddQuota(kGroupFilesIs, *itg, mQuotaNode->getNumFilesByGroup(*itg));
-      ResetQuota(kGroupLogicalBytesIs, *itg);
-      AddQuota(kGroupLogicalBytesIs, *itg, mQuotaNode->getUsedSpaceByGroup(*itg));
+      SetQuota(kGroupBytesIs, *itg, mQuotaNode->getPhysicalSpaceByGroup(*itg));
+      SetQuota(kGroupFilesIs, *itg, mQuotaNode->getNumFilesByGroup(*itg));
+      SetQuota(kGroupLogicalBytesIs, *itg, mQuotaNode->getUsedSpaceByGroup(*itg));
     }
   }
 }
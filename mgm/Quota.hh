@@ -30,11 +30,13 @@
 /*----------------------------------------------------------------------------*/
 #include <vector>
 #include <set>
+#include <atomic>
 #include <stdint.h>
 #include "mgm/Namespace.hh"
 #include "mgm/FsView.hh"
 #include "mgm/XrdMgmOfs.hh"
 #include "mgm/Scheduler.hh"
+#include "mgm/QuotaTable.hh"
 #include "common/Logging.hh"
 #include "common/LayoutId.hh"
 #include "common/Mapping.hh"
@@ -52,6 +54,11 @@ class Quota;
 
 //------------------------------------------------------------------------------
 //! Class SpaceQuota
+//!
+//! @description The quota values are kept in a QuotaTable of atomic counters,
+//!   so the admission check done for every write open (CheckWriteQuota) and
+//!   the per-identity update from the ns quota node never take a mutex. mMutex
+//!   only serializes the periodic bulk updates (sums and ns accounting).
 //------------------------------------------------------------------------------
 class SpaceQuota
 {
@@ -126,7 +133,7 @@ private:
   //! @param tag quota type tag (eQuotaTag)
   //! @param id uid/gid/projec it
   //!
-  //! @return reuqested quota value
+  //! @return reuqested quota value, 0 if not set
   //----------------------------------------------------------------------------
   long long GetQuota(unsigned long tag, unsigned long id);
 
@@ -144,8 +151,6 @@ private:
   //!
   //! @param tag quota type tag (eQuotaTag)
   //! @param uid uid/gid/project id
-  //!
-  //! @warning Caller needs to hold a lock on mMutex
   //----------------------------------------------------------------------------
   void ResetQuota(unsigned long tag, unsigned long id);
 
@@ -155,8 +160,6 @@ private:
   //! @param tag quota type tag (eQuotaTag)
   //! @param id user/group id
   //! @param value quota value to be added
-  //!
-  //! @warning Caller needs to hold a lock on mMutex.
   //----------------------------------------------------------------------------
   void AddQuota(unsigned long tag, unsigned long id, long long value);
 
@@ -301,13 +304,15 @@ private:
 
   std::string pPath; ///< quota node path
   eos::IQuotaNode* mQuotaNode; ///< corresponding ns quota node
-  XrdSysMutex mMutex; ///< mutex to protect access to mMapIdQuota
+  XrdSysMutex mMutex; ///< serializes the bulk updates of mQuotaTable
   time_t mLastEnableCheck; ///< timestamp of the last check
   double mLayoutSizeFactor; ///< layout dependent size factor
-  bool mDirtyTarget; ///< mark to recompute target values
+  std::atomic<bool> mDirtyTarget; ///< mark to recompute target values
+  //! next time the project quota is recomputed during the checks
+  std::atomic<time_t> mProjectUpdateTime;
 
-  //! Map for user view, depending on eQuota and uid/gid
-  std::map<long long, unsigned long long> mMapIdQuota;
+  //! Quota values, depending on eQuota and uid/gid
+  QuotaTable mQuotaTable;
 };
 
 
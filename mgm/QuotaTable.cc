@@ -0,0 +1,234 @@
+// ----------------------------------------------------------------------
+// File: QuotaTable.cc
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/QuotaTable.hh"
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+//! initial number of slots of a quota table
+#define EOSMGMQUOTATABLESIZE 256
+
+//------------------------------------------------------------------------------
+// Constructor of a table of slots
+//------------------------------------------------------------------------------
+QuotaTable::Slots::Slots(size_t size):
+  mMask(size - 1),
+  mUsed(0),
+  mSlot(size)
+{
+  for (size_t i = 0; i < size; i++)
+    mSlot[i].store(0, std::memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+QuotaTable::QuotaTable():
+  mSlots(new Slots(EOSMGMQUOTATABLESIZE))
+{ }
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+QuotaTable::~QuotaTable()
+{
+  Slots* slots = mSlots.load();
+
+  for (size_t i = 0; i <= slots->mMask; i++)
+    delete slots->mSlot[i].load();
+
+  delete slots;
+
+  for (auto it = mRetired.begin(); it != mRetired.end(); ++it)
+    delete *it;
+}
+
+
+//------------------------------------------------------------------------------
+// Hash a key - the uid/gid are in the low bits and the tag in the high ones
+//------------------------------------------------------------------------------
+size_t
+QuotaTable::Hash(unsigned long long key)
+{
+  key *= 0x9e3779b97f4a7c15ull;
+  return (size_t)(key ^ (key >> 32));
+}
+
+
+//------------------------------------------------------------------------------
+// Find the entry of a key in a table
+//------------------------------------------------------------------------------
+QuotaTable::Entry*
+QuotaTable::Find(const Slots* slots, unsigned long long key)
+{
+  // The table is never more than half full, so there is always an empty slot
+  for (size_t i = Hash(key) & slots->mMask; ; i = (i + 1) & slots->mMask)
+  {
+    Entry* entry = slots->mSlot[i].load(std::memory_order_acquire);
+
+    if (!entry || (entry->mKey == key))
+      return entry;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Find the entry of a key and create it if needed
+//------------------------------------------------------------------------------
+QuotaTable::Entry*
+QuotaTable::FindOrCreate(unsigned long long key)
+{
+  Entry* entry = Find(mSlots.load(std::memory_order_acquire), key);
+
+  if (entry)
+    return entry;
+
+  XrdSysMutexHelper lock(mMutex);
+  Slots* slots = mSlots.load(std::memory_order_relaxed);
+
+  // Someone else may have added it in the meantime
+  if ((entry = Find(slots, key)))
+    return entry;
+
+  if (2 * (slots->mUsed + 1) > slots->mMask + 1)
+  {
+    // Readers may still use the old table, it's only deleted with us
+    Slots* grown = new Slots(2 * (slots->mMask + 1));
+
+    for (size_t i = 0; i <= slots->mMask; i++)
+    {
+      Entry* old = slots->mSlot[i].load(std::memory_order_relaxed);
+
+      if (!old)
+        continue;
+
+      size_t j = Hash(old->mKey) & grown->mMask;
+
+      while (grown->mSlot[j].load(std::memory_order_relaxed))
+        j = (j + 1) & grown->mMask;
+
+      grown->mSlot[j].store(old, std::memory_order_relaxed);
+      grown->mUsed++;
+    }
+
+    mRetired.push_back(slots);
+    mSlots.store(grown, std::memory_order_release);
+    slots = grown;
+  }
+
+  entry = new Entry(key);
+  size_t i = Hash(key) & slots->mMask;
+
+  while (slots->mSlot[i].load(std::memory_order_relaxed))
+    i = (i + 1) & slots->mMask;
+
+  slots->mSlot[i].store(entry, std::memory_order_release);
+  slots->mUsed++;
+  return entry;
+}
+
+
+//------------------------------------------------------------------------------
+// Get a value
+//------------------------------------------------------------------------------
+long long
+QuotaTable::Get(unsigned long long key) const
+{
+  Entry* entry = Find(mSlots.load(std::memory_order_acquire), key);
+
+  if (!entry || !entry->mSet.load(std::memory_order_relaxed))
+    return 0;
+
+  return entry->mValue.load(std::memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------------------
+// Set a value
+//------------------------------------------------------------------------------
+void
+QuotaTable::Set(unsigned long long key, long long value)
+{
+  Entry* entry = FindOrCreate(key);
+  entry->mValue.store(value, std::memory_order_relaxed);
+  entry->mSet.store(true, std::memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------------------
+// Add to a value unless the result is negative
+//------------------------------------------------------------------------------
+void
+QuotaTable::Add(unsigned long long key, long long value)
+{
+  Entry* entry = FindOrCreate(key);
+  long long current = entry->mValue.load(std::memory_order_relaxed);
+
+  while ((current + value >= 0) &&
+         !entry->mValue.compare_exchange_weak(current, current + value,
+                                              std::memory_order_relaxed))
+    ;
+
+  entry->mSet.store(true, std::memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------------------
+// Unset a value
+//------------------------------------------------------------------------------
+bool
+QuotaTable::Erase(unsigned long long key)
+{
+  Entry* entry = Find(mSlots.load(std::memory_order_acquire), key);
+
+  if (!entry || !entry->mSet.exchange(false, std::memory_order_relaxed))
+    return false;
+
+  entry->mValue.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Get all the set values
+//------------------------------------------------------------------------------
+void
+QuotaTable::GetEntries(std::vector< std::pair<unsigned long long, long long> >&
+                       entries) const
+{
+  const Slots* slots = mSlots.load(std::memory_order_acquire);
+
+  for (size_t i = 0; i <= slots->mMask; i++)
+  {
+    Entry* entry = slots->mSlot[i].load(std::memory_order_acquire);
+
+    if (entry && entry->mSet.load(std::memory_order_relaxed))
+      entries.push_back(std::make_pair(entry->mKey,
+                                       entry->mValue.load(std::memory_order_relaxed)));
+  }
+}
+
+EOSMGMNAMESPACE_END
@@ -0,0 +1,167 @@
+// ----------------------------------------------------------------------
+// File: QuotaTable.hh
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_QUOTATABLE__HH__
+#define __EOSMGM_QUOTATABLE__HH__
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <atomic>
+#include <utility>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class QuotaTable
+//!
+//! @description Quota values of a space quota node indexed by a key made of
+//!   the quota tag and the uid/gid. Every value is an atomic counter, reading
+//!   or updating an existing one needs no lock. Only adding a new key takes
+//!   a mutex: the counters are referenced by an open addressing table which
+//!   is only modified by filling empty slots, and which is replaced by a
+//!   bigger copy once half full. Replaced tables are kept until destruction,
+//!   so readers holding one never see freed memory - they grow geometrically
+//!   and use less memory than the current table. Entries are never removed,
+//!   a removed value is just marked unset.
+//------------------------------------------------------------------------------
+class QuotaTable
+{
+public:
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  QuotaTable();
+
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~QuotaTable();
+
+
+  //----------------------------------------------------------------------------
+  //! Get a value, lock-free
+  //!
+  //! @param key quota tag and uid/gid
+  //!
+  //! @return value or 0 if it is not set
+  //----------------------------------------------------------------------------
+  long long Get(unsigned long long key) const;
+
+
+  //----------------------------------------------------------------------------
+  //! Set a value, lock-free unless the key is new
+  //!
+  //! @param key quota tag and uid/gid
+  //! @param value value to set
+  //----------------------------------------------------------------------------
+  void Set(unsigned long long key, long long value);
+
+
+  //----------------------------------------------------------------------------
+  //! Add to a value unless the result is negative, lock-free unless the key
+  //! is new
+  //!
+  //! @param key quota tag and uid/gid
+  //! @param value value to add
+  //----------------------------------------------------------------------------
+  void Add(unsigned long long key, long long value);
+
+
+  //----------------------------------------------------------------------------
+  //! Unset a value
+  //!
+  //! @param key quota tag and uid/gid
+  //!
+  //! @return true if the value was set, otherwise false
+  //----------------------------------------------------------------------------
+  bool Erase(unsigned long long key);
+
+
+  //----------------------------------------------------------------------------
+  //! Get all the set values
+  //!
+  //! @param entries vector filled with the keys and values
+  //----------------------------------------------------------------------------
+  void GetEntries(std::vector< std::pair<unsigned long long, long long> >&
+                  entries) const;
+
+private:
+
+  //----------------------------------------------------------------------------
+  //! Counter of a key
+  //----------------------------------------------------------------------------
+  struct Entry
+  {
+    Entry(unsigned long long key): mKey(key), mValue(0), mSet(false) {}
+
+    const unsigned long long mKey; ///< quota tag and uid/gid
+    std::atomic<long long> mValue; ///< current value
+    std::atomic<bool> mSet; ///< value is set i.e. not removed
+  };
+
+  //----------------------------------------------------------------------------
+  //! Open addressing table of entries with linear probing
+  //----------------------------------------------------------------------------
+  struct Slots
+  {
+    Slots(size_t size);
+
+    size_t mMask; ///< number of slots - 1, the number is a power of 2
+    size_t mUsed; ///< number of filled slots, only used under mMutex
+    std::vector< std::atomic<Entry*> > mSlot; ///< slots, 0 if empty
+  };
+
+  std::atomic<Slots*> mSlots; ///< current table
+  std::vector<Slots*> mRetired; ///< replaced tables, deleted in the destructor
+  XrdSysMutex mMutex; ///< serializes the insertion of new keys
+
+
+  //----------------------------------------------------------------------------
+  //! Hash a key
+  //----------------------------------------------------------------------------
+  static size_t Hash(unsigned long long key);
+
+
+  //----------------------------------------------------------------------------
+  //! Find the entry of a key in a table
+  //!
+  //! @return entry or 0 if the key is not in the table
+  //----------------------------------------------------------------------------
+  static Entry* Find(const Slots* slots, unsigned long long key);
+
+
+  //----------------------------------------------------------------------------
+  //! Find the entry of a key and create it if needed
+  //----------------------------------------------------------------------------
+  Entry* FindOrCreate(unsigned long long key);
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
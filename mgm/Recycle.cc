@@ -33,6 +33,12 @@
 /*----------------------------------------------------------------------------*/
 #include "XrdSys/XrdSysTimer.hh"
 /*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+/*----------------------------------------------------------------------------*/
 std::string Recycle::gRecyclingPrefix = "/recycle/"; // MgmOfsConfigure prepends the proc directory path e.g. the bin is /eos/<instance/proc/recycle/
 std::string Recycle::gRecyclingAttribute = "sys.recycle";
 std::string Recycle::gRecyclingTimeAttribute = "sys.recycle.keeptime";
@@ -40,6 +46,12 @@ std::string Recycle::gRecyclingKeepRatio = "sys.recycle.keepratio";
 std::string Recycle::gRecyclingVersionKey = "sys.recycle.version.key";
 std::string Recycle::gRecyclingPostFix = ".d";
 int Recycle::gRecyclingPollTime = 30;
+XrdSysMutex Recycle::gIndexMutex;
+std::set<Recycle::IndexEntry> Recycle::gIndex;
+std::string Recycle::gIndexFileName = "";
+FILE* Recycle::gIndexFile = 0;
+bool Recycle::gIndexLoaded = false;
+unsigned long long Recycle::gIndexPurged = 0;
 
 /*----------------------------------------------------------------------------*/
 
@@ -71,6 +83,28 @@ Recycle::Stop ()
   mThread = 0;
 }
 
+/*----------------------------------------------------------------------------*/
+void
+Recycle::InvalidateIndex ()
+{
+  XrdSysMutexHelper lock(gIndexMutex);
+  gIndex.clear();
+  gIndexLoaded = false;
+  gIndexPurged = 0;
+
+  // remove the journal as well, a restart before the rebuild scans the bin
+  if (gIndexFile)
+  {
+    fclose(gIndexFile);
+    gIndexFile = 0;
+  }
+
+  if (!gIndexFileName.empty())
+    unlink(gIndexFileName.c_str());
+
+  eos_static_info("msg=\"recycle index invalidated - garbage bin will be scanned\"");
+}
+
 void*
 Recycle::StartRecycleThread (void* arg)
 {
@@ -93,7 +127,6 @@ Recycle::Recycler ()
   XrdOucErrInfo lError;
   time_t lKeepTime = 0;
   double lSpaceKeepRatio = 0;
-  std::multimap<time_t, std::string> lDeletionMap;
   time_t snoozetime = 10;
 
   unsigned long long lLowInodesWatermark = 0;
@@ -208,242 +241,190 @@ Recycle::Recycler ()
       if (attrmap.count(Recycle::gRecyclingTimeAttribute))
       {
         lKeepTime = strtoull(attrmap[Recycle::gRecyclingTimeAttribute].c_str(), 0, 10);
-        eos_static_info("keep-time=%llu deletion-map=%llu", lKeepTime, lDeletionMap.size());
+        {
+          XrdSysMutexHelper lock(gIndexMutex);
+          eos_static_info("keep-time=%llu recycle-index=%llu", lKeepTime, gIndex.size());
+        }
         if (lKeepTime > 0)
         {
-          if (!lDeletionMap.size())
+          bool indexLoaded = false;
+          {
+            XrdSysMutexHelper lock(gIndexMutex);
+            indexLoaded = gIndexLoaded;
+          }
+
+          if (!indexLoaded)
           {
             //...................................................................
-            //  the deletion map is filled if there is nothing inside with files/
-            //  directories found previously in the garbage bin
+            // there is no valid recycle index - build it once from the garbage
+            // directory tree, afterwards it is maintained by ToGarbage
             //...................................................................
-            std::string subdirs;
-            XrdMgmOfsDirectory dirl1;
-            XrdMgmOfsDirectory dirl2;
-            XrdMgmOfsDirectory dirl3;
-            int listrc = dirl1.open(Recycle::gRecyclingPrefix.c_str(), rootvid, (const char*) 0);
-            if (listrc)
+            RebuildIndex();
+          }
+
+          time_t now = time(NULL);
+
+          while (1)
+          {
+            IndexEntry entry;
             {
-              eos_static_err("msg=\"unable to list the garbage directory level-1\" recycle-path=%s", Recycle::gRecyclingPrefix.c_str());
+              XrdSysMutexHelper lock(gIndexMutex);
+              if (gIndex.empty())
+                break;
+              entry = *gIndex.begin();
             }
-            else
+
+            if ((entry.mCtime + lKeepTime) >= now)
             {
-              // loop over all directories = group directories
-              const char* dname1;
-              while ((dname1 = dirl1.nextEntry()))
+              //...............................................................
+              // the oldest entry has still to be kept
+              //...............................................................
+              snoozetime = (entry.mCtime + lKeepTime) - now;
+              if (snoozetime < gRecyclingPollTime)
               {
+                //.............................................................
+                // avoid to activate this thread too many times, 5 minutess
+                // resolution is perfectly fine
+                //.............................................................
+                snoozetime = gRecyclingPollTime;
+              }
+              if (snoozetime > lKeepTime)
+              {
+                eos_static_warning("msg=\"snooze time exceeds keeptime\" snooze-time=%llu keep-time=%llu", snoozetime, lKeepTime);
+                //.............................................................
+                // that is sort of strange but let's have a fix for that
+                //.............................................................
+                snoozetime = lKeepTime;
+              }
+              break;
+            }
+
+            // This entry can be removed
+            // If there is a keep-ratio policy defined we abort deletion once
+            // we are enough under the thresholds
+            if (attrmap.count(Recycle::gRecyclingKeepRatio))
+            {
+              auto map_quotas = Quota::GetGroupStatistics(Recycle::gRecyclingPrefix,
+                                                          Quota::gProjectId);
+
+              if (!map_quotas.empty())
+              {
+                unsigned long long usedbytes = map_quotas[SpaceQuota::kGroupBytesIs];
+                unsigned long long usedfiles = map_quotas[SpaceQuota::kGroupFilesIs];
+                eos_static_debug("low-volume=%lld is-volume=%lld low-inodes=%lld is-inodes=%lld",
+                                 usedfiles,
+                                 lLowInodesWatermark,
+                                 usedbytes,
+                                 lLowSpaceWatermark);
+                if ((lLowInodesWatermark >= usedfiles) &&
+                    (lLowSpaceWatermark >= usedbytes))
                 {
-                  std::string sdname = dname1;
-                  if ((sdname == ".") || (sdname == ".."))
-                  {
-                    continue;
-                  }
-                }
-                std::string l2 = Recycle::gRecyclingPrefix;
-                l2 += dname1;
-                // list level-2 user directories
-                listrc = dirl2.open(l2.c_str(), rootvid, (const char*) 0);
-                if (listrc)
-                {
-                  eos_static_err("msg=\"unable to list the garbage directory level-2\" recycle-path=%s l2-path=%s", Recycle::gRecyclingPrefix.c_str(), l2.c_str());
-                }
-                else
-                {
-                  const char* dname2;
-                  while ((dname2 = dirl2.nextEntry()))
-                  {
-                    {
-                      std::string sdname = dname2;
-                      if ((sdname == ".") || (sdname == ".."))
-                      {
-                        continue;
-                      }
-                    }
-                    std::string l3 = l2;
-                    l3 += "/";
-                    l3 += dname2;
-                    // list the level-3 entries
-                    listrc = dirl3.open(l3.c_str(), rootvid, (const char*) 0);
-                    if (listrc)
-                    {
-                      eos_static_err("msg=\"unable to list the garbage directory level-2\" recycle-path=%s l2-path=%s l3-path=%s", Recycle::gRecyclingPrefix.c_str(), l2.c_str(), l3.c_str());
-                    }
-                    else
-                    {
-                      const char* dname3;
-                      while ((dname3 = dirl3.nextEntry()))
-                      {
-                        {
-                          std::string sdname = dname3;
-                          if ((sdname == ".") || (sdname == ".."))
-                          {
-                            continue;
-                          }
-                        }
-                        std::string l4 = l3;
-                        l4 += "/";
-                        l4 += dname3;
-                        eos_static_info("path=%s", l4.c_str());
-                        //.......................................................
-                        // stat the directory to get the mtime
-                        //.......................................................
-                        struct stat buf;
-                        if (gOFS->_stat(l4.c_str(), &buf, lError, rootvid, ""))
-                        {
-                          eos_static_err("msg=\"unable to stat a garbage directory entry\" recycle-path=%s l2-path=%s l3-path=%s", Recycle::gRecyclingPrefix.c_str(), l2.c_str(), l3.c_str());
-
-                        }
-                        else
-                        {
-                          //.....................................................
-                          // add to the garbage fifo deletion multimap
-                          //.....................................................
-                          lDeletionMap.insert(std::pair<time_t, std::string > (buf.st_ctime, l4));
-                        }
-                      }
-                      dirl3.close();
-                    }
-                  }
-                  dirl2.close();
+                  eos_static_debug("msg=\"skipping recycle clean-up - ratio went under low watermarks\"");
+                  break; // leave the deletion loop
                 }
               }
-              dirl1.close();
             }
-          }
-          else
-          {
-            auto it = lDeletionMap.begin();
-            time_t now = time(NULL);
-            while (it != lDeletionMap.end())
+
+            std::string delpath;
+
+            if (!ResolveIndexEntry(entry, delpath))
             {
-              // take the first element and see if it is exceeding the keep time
-              if ((it->first + lKeepTime) < now)
+              //...............................................................
+              // the object was restored, purged or recycled again meanwhile
+              //...............................................................
+              eos_static_debug("msg=\"dropping stale recycle index entry\" id=%016llx dir=%d", entry.mId, entry.mIsDir);
+            }
+            else if (entry.mIsDir)
+            {
+              //...............................................................
+              // do a directory deletion - first find all subtree children
+              //...............................................................
+              std::map<std::string, std::set<std::string> > found;
+              std::map<std::string, std::set<std::string> >::const_reverse_iterator rfoundit;
+              std::set<std::string>::const_iterator fileit;
+              XrdOucString stdErr;
+              if (gOFS->_find(delpath.c_str(), lError, stdErr, rootvid, found))
               {
-                // This entry can be removed
-                // If there is a keep-ratio policy defined we abort deletion once
-		// we are enough under the thresholds
-                if (attrmap.count(Recycle::gRecyclingKeepRatio))
-		{
-		  auto map_quotas = Quota::GetGroupStatistics(Recycle::gRecyclingPrefix,
-							      Quota::gProjectId);
-
-		  if (!map_quotas.empty())
-		  {
-		    unsigned long long usedbytes = map_quotas[SpaceQuota::kGroupBytesIs];
-                    unsigned long long usedfiles = map_quotas[SpaceQuota::kGroupFilesIs];
-                    eos_static_debug("low-volume=%lld is-volume=%lld low-inodes=%lld is-inodes=%lld",
-                                     usedfiles,
-                                     lLowInodesWatermark,
-                                     usedbytes,
-                                     lLowSpaceWatermark);
-                    if ((lLowInodesWatermark >= usedfiles) &&
-                        (lLowSpaceWatermark >= usedbytes))
-                    {
-                      eos_static_debug("msg=\"skipping recycle clean-up - ratio went under low watermarks\"");
-                      break; // leave the deletion loop
-                    }
-		  }
-		}
-
-	        XrdOucString delpath = it->second.c_str();
-                if ((it->second.length()) && (delpath.endswith(Recycle::gRecyclingPostFix.c_str())))
-		{
-                  //.............................................................
-                  // do a directory deletion - first find all subtree children
-                  //.............................................................
-                  std::map<std::string, std::set<std::string> > found;
-                  std::map<std::string, std::set<std::string> >::const_reverse_iterator rfoundit;
-                  std::set<std::string>::const_iterator fileit;
-                  XrdOucString stdErr;
-                  if (gOFS->_find(it->second.c_str(), lError, stdErr, rootvid, found))
-                  {
-                    eos_static_err("msg=\"unable to do a find in subtree\" path=%s stderr=\"%s\"", it->second.c_str(), stdErr.c_str());
-                  }
-                  else
+                eos_static_err("msg=\"unable to do a find in subtree\" path=%s stderr=\"%s\"", delpath.c_str(), stdErr.c_str());
+              }
+              else
+              {
+                //...........................................................
+                // standard way to delete files recursively
+                //...........................................................
+                // delete files starting at the deepest level
+                for (rfoundit = found.rbegin(); rfoundit != found.rend(); rfoundit++)
+                {
+                  for (fileit = rfoundit->second.begin(); fileit != rfoundit->second.end(); fileit++)
                   {
-                    //...........................................................
-                    // standard way to delete files recursively
-                    //...........................................................
-                    // delete files starting at the deepest level
-                    for (rfoundit = found.rbegin(); rfoundit != found.rend(); rfoundit++)
+                    std::string fspath = rfoundit->first;
+                    fspath += *fileit;
+                    if (gOFS->_rem(fspath.c_str(), lError, rootvid, (const char*) 0))
                     {
-                      for (fileit = rfoundit->second.begin(); fileit != rfoundit->second.end(); fileit++)
-                      {
-                        std::string fspath = rfoundit->first;
-                        fspath += *fileit;
-                        if (gOFS->_rem(fspath.c_str(), lError, rootvid, (const char*) 0))
-                        {
-                          eos_static_err("msg=\"unable to remove file\" path=%s", fspath.c_str());
-                        }
-                        else
-                        {
-                          eos_static_info("msg=\"permanently deleted file from recycle bin\" path=%s keep-time=%llu", fspath.c_str(), lKeepTime);
-                        }
-                      }
+                      eos_static_err("msg=\"unable to remove file\" path=%s", fspath.c_str());
                     }
-                    //...........................................................
-                    // delete directories starting at the deepest level
-                    //...........................................................
-                    for (rfoundit = found.rbegin(); rfoundit != found.rend(); rfoundit++)
+                    else
                     {
-                      //.........................................................
-                      // don't even try to delete the root directory
-                      //.........................................................
-                      std::string fspath = rfoundit->first.c_str();
-                      if (fspath == "/")
-                        continue;
-                      if (gOFS->_remdir(rfoundit->first.c_str(), lError, rootvid, (const char*) 0))
-                      {
-                        eos_static_err("msg=\"unable to remove directory\" path=%s", fspath.c_str());
-                      }
-                      else
-                      {
-                        eos_static_info("msg=\"permanently deleted directory from recycle bin\" path=%s keep-time=%llu", fspath.c_str(), lKeepTime);
-                      }
+                      eos_static_info("msg=\"permanently deleted file from recycle bin\" path=%s keep-time=%llu", fspath.c_str(), lKeepTime);
                     }
                   }
-                  lDeletionMap.erase(it);
-                  it = lDeletionMap.begin();
                 }
-                else
+                //...........................................................
+                // delete directories starting at the deepest level
+                //...........................................................
+                for (rfoundit = found.rbegin(); rfoundit != found.rend(); rfoundit++)
                 {
-                  //...........................................................
-                  // do a single file deletion
-                  //...........................................................
-                  if (gOFS->_rem(it->second.c_str(), lError, rootvid, (const char*) 0))
+                  //.........................................................
+                  // don't even try to delete the root directory
+                  //.........................................................
+                  std::string fspath = rfoundit->first.c_str();
+                  if (fspath == "/")
+                    continue;
+                  if (gOFS->_remdir(rfoundit->first.c_str(), lError, rootvid, (const char*) 0))
                   {
-                    eos_static_err("msg=\"unable to remove file\" path=%s", it->second.c_str());
+                    eos_static_err("msg=\"unable to remove directory\" path=%s", fspath.c_str());
+                  }
+                  else
+                  {
+                    eos_static_info("msg=\"permanently deleted directory from recycle bin\" path=%s keep-time=%llu", fspath.c_str(), lKeepTime);
                   }
-                  lDeletionMap.erase(it);
-                  it = lDeletionMap.begin();
                 }
               }
-              else
+            }
+            else
+            {
+              //...............................................................
+              // do a single file deletion
+              //...............................................................
+              if (gOFS->_rem(delpath.c_str(), lError, rootvid, (const char*) 0))
               {
-                //...............................................................
-                // this entry has still to be kept
-                //...............................................................
-                snoozetime = (it->first + lKeepTime) - now;
-                if (snoozetime < gRecyclingPollTime)
-                {
-                  //.............................................................
-                  // avoid to activate this thread too many times, 5 minutess
-                  // resolution is perfectly fine
-                  //.............................................................
-                  snoozetime = gRecyclingPollTime;
-                }
-                if (snoozetime > lKeepTime)
-                {
-                  eos_static_warning("msg=\"snooze time exceeds keeptime\" snooze-time=%llu keep-time=%llu", snoozetime, lKeepTime);
-                  //.............................................................
-                  // that is sort of strange but let's have a fix for that
-                  //.............................................................
-                  snoozetime = lKeepTime;
-                }
-                it++;
+                eos_static_err("msg=\"unable to remove file\" path=%s", delpath.c_str());
+              }
+            }
+
+            {
+              //...............................................................
+              // drop the entry by its key - it is still the head unless a
+              // late entry was inserted before
+              //...............................................................
+              XrdSysMutexHelper lock(gIndexMutex);
+              if (gIndex.erase(entry))
+              {
+                gIndexPurged++;
+                // journal the purge, the slave replays it on take-over
+                JournalIndexEntry(entry, true);
               }
             }
           }
+
+          {
+            //.................................................................
+            // rewrite the journal once it holds more purged than live entries
+            //.................................................................
+            XrdSysMutexHelper lock(gIndexMutex);
+            if (gIndexPurged > (gIndex.size() + 1000))
+              CompactIndex();
+          }
         }
         else
         {
@@ -463,6 +444,350 @@ Recycle::Recycler ()
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+bool
+Recycle::SetIndexFileName (const char* name)
+{
+  XrdSysMutexHelper lock(gIndexMutex);
+  gIndexFileName = name;
+
+  std::set<IndexEntry> entries;
+
+  if (!ReadIndex(name, entries))
+  {
+    // the journal is only written once the index is complete
+    eos_static_info("msg=\"no recycle index found - garbage bin will be scanned\" path=%s", name);
+    return false;
+  }
+
+  // entries which have been added before the index was configured are kept
+  gIndex.insert(entries.begin(), entries.end());
+  gIndexLoaded = true;
+  eos_static_info("msg=\"loaded recycle index\" path=%s entries=%llu", name,
+                  (unsigned long long) gIndex.size());
+  return CompactIndex();
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+Recycle::TakeOverIndex (const char* name)
+{
+  std::set<IndexEntry> entries;
+
+  if (!ReadIndex(name, entries))
+  {
+    eos_static_warning("msg=\"no recycle index of the previous master found\" path=%s", name);
+    return false;
+  }
+
+  XrdSysMutexHelper lock(gIndexMutex);
+  gIndex.swap(entries);
+  gIndexLoaded = true;
+  eos_static_info("msg=\"took over recycle index\" path=%s entries=%llu", name,
+                  (unsigned long long) gIndex.size());
+  // continue the journal under our own name
+  return CompactIndex();
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+Recycle::ReadIndex (const char* name, std::set<IndexEntry> &index)
+{
+  FILE* fin = fopen(name, "r");
+
+  if (!fin)
+    return false;
+
+  char line[256];
+
+  while (fgets(line, sizeof (line), fin))
+  {
+    long long ctime;
+    unsigned long long id;
+    char type;
+    char op = '+';
+
+    if (sscanf(line, "%lld %llx %c %c", &ctime, &id, &type, &op) < 3)
+    {
+      eos_static_err("msg=\"skipping corrupted recycle index line\" path=%s line=\"%s\"", name, line);
+      continue;
+    }
+
+    IndexEntry entry;
+    entry.mCtime = (time_t) ctime;
+    entry.mId = id;
+    entry.mIsDir = (type == 'd');
+
+    // purged entries are journaled with a trailing '-'
+    if (op == '-')
+      index.erase(entry);
+    else
+      index.insert(entry);
+  }
+
+  fclose(fin);
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+Recycle::CompactIndex ()
+{
+  // called with gIndexMutex held
+  gIndexPurged = 0;
+
+  if (gIndexFileName.empty())
+    return false;
+
+  if (gIndexFile)
+  {
+    fclose(gIndexFile);
+    gIndexFile = 0;
+  }
+
+  std::string tmpname = gIndexFileName + ".tmp";
+  FILE* fout = fopen(tmpname.c_str(), "w");
+
+  if (!fout)
+  {
+    eos_static_err("msg=\"unable to write recycle index\" path=%s errno=%d", tmpname.c_str(), errno);
+    return false;
+  }
+
+  bool ok = true;
+
+  for (auto it = gIndex.begin(); it != gIndex.end(); ++it)
+  {
+    if (fprintf(fout, "%lld %016llx %c\n", (long long) it->mCtime, it->mId,
+                it->mIsDir ? 'd' : 'f') < 0)
+    {
+      ok = false;
+      break;
+    }
+  }
+
+  if (fclose(fout) || !ok || rename(tmpname.c_str(), gIndexFileName.c_str()))
+  {
+    eos_static_err("msg=\"unable to write recycle index\" path=%s errno=%d", gIndexFileName.c_str(), errno);
+    unlink(tmpname.c_str());
+    return false;
+  }
+
+  gIndexFile = fopen(gIndexFileName.c_str(), "a");
+
+  if (!gIndexFile)
+  {
+    eos_static_err("msg=\"unable to open recycle index for appending\" path=%s errno=%d", gIndexFileName.c_str(), errno);
+    return false;
+  }
+
+  eos_static_info("msg=\"compacted recycle index\" path=%s entries=%llu", gIndexFileName.c_str(), (unsigned long long) gIndex.size());
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Recycle::AddToIndex (time_t ctime, unsigned long long id, bool isdir)
+{
+  IndexEntry entry;
+  entry.mCtime = ctime;
+  entry.mId = id;
+  entry.mIsDir = isdir;
+
+  XrdSysMutexHelper lock(gIndexMutex);
+  gIndex.insert(entry);
+  JournalIndexEntry(entry, false);
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Recycle::JournalIndexEntry (const IndexEntry &entry, bool purged)
+{
+  // called with gIndexMutex held
+  if (!gIndexFile)
+    return;
+
+  if ((fprintf(gIndexFile, "%lld %016llx %c%s\n", (long long) entry.mCtime,
+               entry.mId, entry.mIsDir ? 'd' : 'f', purged ? " -" : "") < 0) ||
+      fflush(gIndexFile))
+  {
+    eos_static_err("msg=\"unable to append to recycle index\" path=%s errno=%d", gIndexFileName.c_str(), errno);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+Recycle::ResolveIndexEntry (const IndexEntry &entry, std::string &path)
+{
+  eos::IFileMD::ctime_t ctime;
+  char skey[64];
+  snprintf(skey, sizeof (skey), ".%016llx%s", entry.mId,
+           entry.mIsDir ? Recycle::gRecyclingPostFix.c_str() : "");
+
+  {
+    eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
+    try
+    {
+      if (entry.mIsDir)
+      {
+        std::shared_ptr<eos::IContainerMD> cmd =
+          gOFS->eosDirectoryService->getContainerMD(entry.mId);
+        path = gOFS->eosView->getUri(cmd.get());
+        cmd->getCTime(ctime);
+      }
+      else
+      {
+        std::shared_ptr<eos::IFileMD> fmd =
+          gOFS->eosFileService->getFileMD(entry.mId);
+        path = gOFS->eosView->getUri(fmd.get());
+        fmd->getCTime(ctime);
+      }
+    }
+    catch (eos::MDException &e)
+    {
+      return false;
+    }
+  }
+
+  if (path.length() && (path[path.length() - 1] == '/'))
+    path.erase(path.length() - 1);
+
+  // the object has to be still in the recycle bin under its recycle key
+  if (path.compare(0, Recycle::gRecyclingPrefix.length(),
+                   Recycle::gRecyclingPrefix) ||
+      (path.length() < strlen(skey)) ||
+      path.compare(path.length() - strlen(skey), strlen(skey), skey))
+    return false;
+
+  // the object was recycled again after this entry has been created
+  if (ctime.tv_sec > entry.mCtime)
+    return false;
+
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Recycle::RebuildIndex ()
+{
+  eos::common::Mapping::VirtualIdentity rootvid;
+  eos::common::Mapping::Root(rootvid);
+  XrdOucErrInfo lError;
+  std::vector<IndexEntry> entries;
+
+  //...........................................................................
+  // the garbage bin has the structure <prefix>/<gid>/<uid>/<name>.<016llx:id>
+  // and directories have the additional recycling postfix
+  //...........................................................................
+  XrdMgmOfsDirectory dirl1;
+  XrdMgmOfsDirectory dirl2;
+  XrdMgmOfsDirectory dirl3;
+  int listrc = dirl1.open(Recycle::gRecyclingPrefix.c_str(), rootvid, (const char*) 0);
+  if (listrc)
+  {
+    eos_static_err("msg=\"unable to list the garbage directory level-1\" recycle-path=%s", Recycle::gRecyclingPrefix.c_str());
+    return;
+  }
+
+  // loop over all directories = group directories
+  const char* dname1;
+  while ((dname1 = dirl1.nextEntry()))
+  {
+    {
+      std::string sdname = dname1;
+      if ((sdname == ".") || (sdname == ".."))
+      {
+        continue;
+      }
+    }
+    std::string l2 = Recycle::gRecyclingPrefix;
+    l2 += dname1;
+    // list level-2 user directories
+    listrc = dirl2.open(l2.c_str(), rootvid, (const char*) 0);
+    if (listrc)
+    {
+      eos_static_err("msg=\"unable to list the garbage directory level-2\" recycle-path=%s l2-path=%s", Recycle::gRecyclingPrefix.c_str(), l2.c_str());
+      continue;
+    }
+
+    const char* dname2;
+    while ((dname2 = dirl2.nextEntry()))
+    {
+      {
+        std::string sdname = dname2;
+        if ((sdname == ".") || (sdname == ".."))
+        {
+          continue;
+        }
+      }
+      std::string l3 = l2;
+      l3 += "/";
+      l3 += dname2;
+      // list the level-3 entries
+      listrc = dirl3.open(l3.c_str(), rootvid, (const char*) 0);
+      if (listrc)
+      {
+        eos_static_err("msg=\"unable to list the garbage directory level-3\" recycle-path=%s l2-path=%s l3-path=%s", Recycle::gRecyclingPrefix.c_str(), l2.c_str(), l3.c_str());
+        continue;
+      }
+
+      const char* dname3;
+      while ((dname3 = dirl3.nextEntry()))
+      {
+        XrdOucString sdname = dname3;
+        if ((sdname == ".") || (sdname == ".."))
+        {
+          continue;
+        }
+
+        IndexEntry entry;
+        entry.mIsDir = sdname.endswith(Recycle::gRecyclingPostFix.c_str());
+
+        if (entry.mIsDir)
+          sdname.erase(sdname.length() - Recycle::gRecyclingPostFix.length());
+
+        int pos = sdname.rfind(".");
+
+        if ((pos == STR_NPOS) || ((sdname.length() - pos - 1) != 16))
+        {
+          eos_static_err("msg=\"garbage directory entry without recycle key\" l3-path=%s name=%s", l3.c_str(), dname3);
+          continue;
+        }
+
+        entry.mId = strtoull(sdname.c_str() + pos + 1, 0, 16);
+
+        std::string l4 = l3;
+        l4 += "/";
+        l4 += dname3;
+        //.......................................................
+        // stat the entry to get the time it was moved into the bin
+        //.......................................................
+        struct stat buf;
+        if (gOFS->_stat(l4.c_str(), &buf, lError, rootvid, ""))
+        {
+          eos_static_err("msg=\"unable to stat a garbage directory entry\" recycle-path=%s l2-path=%s l3-path=%s", Recycle::gRecyclingPrefix.c_str(), l2.c_str(), l3.c_str());
+          continue;
+        }
+
+        entry.mCtime = buf.st_ctime;
+        entries.push_back(entry);
+      }
+      dirl3.close();
+    }
+    dirl2.close();
+  }
+  dirl1.close();
+
+  XrdSysMutexHelper lock(gIndexMutex);
+
+  // the index only holds entries added by ToGarbage since it was
+  // invalidated - they are kept, duplicates of scanned entries collapse
+  gIndex.insert(entries.begin(), entries.end());
+  gIndexLoaded = true;
+  eos_static_info("msg=\"rebuilt recycle index\" entries=%llu", (unsigned long long) gIndex.size());
+  CompactIndex();
+}
+
 /*----------------------------------------------------------------------------*/
 int
 Recycle::ToGarbage (const char* epname, XrdOucErrInfo & error)
@@ -566,6 +891,11 @@ Recycle::ToGarbage (const char* epname, XrdOucErrInfo & error)
   {
     return gOFS->Emsg(epname, error, EIO, "rename file/directory", srecyclepath);
   }
+  // index the object - the rename has set its change time before 'now'
+  if (mRecyclePath.compare(0, Recycle::gRecyclingPrefix.length(),
+                           Recycle::gRecyclingPrefix) == 0)
+    AddToIndex(time(NULL), mId, isdir);
+
   // store the recycle path in the error object
   error.setErrInfo(0,srecyclepath);
   return SFS_OK;
@@ -32,6 +32,8 @@
 #include "XrdOuc/XrdOucErrInfo.hh"
 /*----------------------------------------------------------------------------*/
 #include <sys/types.h>
+#include <set>
+#include <cstdio>
 
 /*----------------------------------------------------------------------------*/
 
@@ -51,6 +53,13 @@ EOSMGMNAMESPACE_BEGIN
  * The Recycling bin has the substructure <instance-proc>/recycle/<gid>/<uid>/<constracted-path>.<08x:inode>
  * The constrcated path is the full path of the file where all '/' are replaced
  * with a '#:#'
+ *
+ * Every object moved into the recycling bin is appended to a time ordered
+ * index of (deletion time, id) pairs which is journaled to a local file
+ * together with the purged entries. The clean-up thread purges only the
+ * expired head of this index. The journal is replicated to the slave by
+ * eossync, a new master continues with the journal of the previous one and
+ * scans the garbage directory tree only if no journal could be loaded.
  */
 
 class Recycle
@@ -75,6 +84,60 @@ private:
   bool mWakeUp;
   XrdSysMutex mWakeUpMutex;
 
+  //............................................................................
+  // variables for the recycle index
+  //............................................................................
+
+  struct IndexEntry
+  {
+    time_t mCtime; //< time when the object was moved into the bin
+    unsigned long long mId; //< id of the container or file
+    bool mIsDir; //< true if mId is a container id
+
+    bool operator< (const IndexEntry &other) const
+    {
+      if (mCtime != other.mCtime)
+        return mCtime < other.mCtime;
+
+      if (mId != other.mId)
+        return mId < other.mId;
+
+      return mIsDir < other.mIsDir;
+    }
+  };
+
+  static XrdSysMutex gIndexMutex; //< protecting all index variables
+  static std::set<IndexEntry> gIndex; //< entries ordered by mCtime
+  static std::string gIndexFileName; //< index journal file name
+  static FILE* gIndexFile; //< index journal opened for appending
+  static bool gIndexLoaded; //< true if the index is complete
+  static unsigned long long gIndexPurged; //< entries purged since the last compaction
+
+  /* rebuild the index by scanning the garbage directory tree
+   */
+  void RebuildIndex ();
+
+  /* rewrite the index journal from the in-memory index
+   */
+  static bool CompactIndex ();
+
+  /* append an added or purged entry to the index journal
+   */
+  static void JournalIndexEntry (const IndexEntry &entry, bool purged);
+
+  /* read an index journal
+   * @param name of the journal file
+   * @param index filled with the entries which were not purged
+   * @return true if the journal could be opened
+   */
+  static bool ReadIndex (const char* name, std::set<IndexEntry> &index);
+
+  /* resolve an index entry to a path in the recycle bin
+   * @return true if the object still lives in the recycle bin and was not
+   * moved there again after the entry was created
+   */
+  static bool ResolveIndexEntry (const IndexEntry &entry, std::string &path);
+
 public:
 
   /* Default Constructor - use it to run the Recycle thread by callign Start afterwards
@@ -92,6 +155,19 @@ public:
    */
   void Stop ();
 
+  /* Discard the recycle index so that the recycle thread rebuilds it from
+   * the garbage directory tree - used when a slave becomes master and the
+   * journal of the previous master is not available
+   */
+  static void InvalidateIndex ();
+
+  /* Continue with the index journal of the previous master, which eossync
+   * replicates to the slave - used when a slave becomes master
+   * @param name of the replicated journal
+   * @return true if the journal could be loaded
+   */
+  static bool TakeOverIndex (const char* name);
+
   /* Thread start function for recycle thread
    */
   static void* StartRecycleThread (void*);
@@ -188,6 +264,22 @@ public:
   static int Config (XrdOucString &stdOut, XrdOucString &stdErr, eos::common::Mapping::VirtualIdentity_t &vid, const char* arg, XrdOucString & options);
 
 
+  /**
+   * set the file used to journal the recycle index and load it
+   * @param name of the index file
+   * @return true if an index could be loaded, otherwise the index is rebuilt
+   * by the recycle thread
+   */
+  static bool SetIndexFileName (const char* name);
+
+  /**
+   * add an object which was moved into the recycle bin to the index
+   * @param ctime time of the deletion
+   * @param id of the container or file
+   * @param isdir true if id is a container id
+   */
+  static void AddToIndex (time_t ctime, unsigned long long id, bool isdir);
+
   /**
    * set the wake-up flag in the recycle thread to look at modified recycle bin settings
    */
@@ -39,6 +39,8 @@ Vid::Set (const char* value,
           bool storeConfig)
 {
   eos::common::RWMutexWriteLock lock(eos::common::Mapping::gMapMutex);
+  // cached identities can not be trusted anymore
+  eos::common::Mapping::gVidCache.Invalidate();
 
   XrdOucEnv env(value);
   XrdOucString skey = env.Get("mgm.vid.key");
@@ -291,6 +293,8 @@ Vid::Rm (XrdOucEnv &env,
          bool storeConfig)
 {
   eos::common::RWMutexWriteLock lock(eos::common::Mapping::gMapMutex);
+  // cached identities can not be trusted anymore
+  eos::common::Mapping::gVidCache.Invalidate();
   XrdOucString skey = env.Get("mgm.vid.key");
   XrdOucString vidcmd = env.Get("mgm.vid.cmd");
   int envlen = 0;
@@ -64,6 +64,8 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <memory>
+#include <vector>
+#include <arpa/inet.h>
 /*----------------------------------------------------------------------------*/
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 /*----------------------------------------------------------------------------*/
@@ -76,6 +78,10 @@
 #define S_IAMB  0x1FF
 #endif
 
+//! Time during which a resent commit batch is stalled while its first attempt
+//! is still in progress, later resends are rejected with EBUSY
+#define COMMIT_BATCH_MAX_STALL 300
+
 
 /*----------------------------------------------------------------------------*/
 XrdSysError gMgmOfsEroute (0);
@@ -192,6 +198,7 @@ XrdMgmOfs::newFile (char *user, int MonID)
 #include "XrdMgmOfs/Chksum.cc"
 #include "XrdMgmOfs/Chmod.cc"
 #include "XrdMgmOfs/Chown.cc"
+#include "XrdMgmOfs/Commit.cc"
 #include "XrdMgmOfs/DeleteExternal.cc"
 #include "XrdMgmOfs/Exists.cc"
 #include "XrdMgmOfs/Find.cc"
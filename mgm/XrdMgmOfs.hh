@@ -134,6 +134,7 @@
 #include "XrdSys/XrdSysTimer.hh"
 /*----------------------------------------------------------------------------*/
 #include <dirent.h>
+#include <deque>
 /*----------------------------------------------------------------------------*/
 #include "auth_plugin/ProtoUtils.hh"
 /*----------------------------------------------------------------------------*/
@@ -496,6 +497,41 @@ public:
              bool follow = true,
              std::string* uri = 0);
 
+  // ---------------------------------------------------------------------------
+  // stat information of a directory entry returned by _stat_dir
+  // ---------------------------------------------------------------------------
+  struct DirEntryStat
+  {
+    std::string name; //< entry name
+    struct stat buf; //< stat information as returned by _stat
+    std::string etag; //< ETag as returned by _stat
+    std::string checksum; //< hex checksum of a file, empty for directories
+    eos::IContainerMD::XAttrMap xattrs; //< requested extended attributes
+  };
+
+  // ---------------------------------------------------------------------------
+  // stat all entries of a directory in one pass over the namespace
+  // ---------------------------------------------------------------------------
+  int _stat_dir (const char *Name,
+                 std::vector<DirEntryStat> &entries,
+                 XrdOucErrInfo &out_error,
+                 eos::common::Mapping::VirtualIdentity &vid,
+                 const std::set<std::string> *xattrs = 0);
+
+  // ---------------------------------------------------------------------------
+  // fill the stat information and ETag of a file
+  // ---------------------------------------------------------------------------
+  void FileMDToStat (eos::IFileMD *fmd,
+                     struct stat *buf,
+                     std::string *etag);
+
+  // ---------------------------------------------------------------------------
+  // fill the stat information and ETag of a container
+  // ---------------------------------------------------------------------------
+  void ContainerMDToStat (eos::IContainerMD *cmd,
+                          struct stat *buf,
+                          std::string *etag);
+
 
   // ---------------------------------------------------------------------------
   // stat file to retrieve mode
@@ -557,6 +593,72 @@ public:
   // ---------------------------------------------------------------------------
   int _utimes (const char*, struct timespec *tvp, XrdOucErrInfo&, eos::common::Mapping::VirtualIdentity &vid, const char* opaque = 0);
 
+  // ---------------------------------------------------------------------------
+  // commit a replica after a close on an FST
+  // ---------------------------------------------------------------------------
+  int _commit (XrdOucEnv &env,
+               XrdOucErrInfo &error,
+               eos::common::Mapping::VirtualIdentity &vid,
+               const char *tident);
+
+  // ---------------------------------------------------------------------------
+  // commit of a replica handed from one phase of a commit to the next
+  // ---------------------------------------------------------------------------
+  struct CommitState
+  {
+    eos::common::LogId logid; //< log id of the close on the FST
+    std::string path; //< path sent by the FST
+    std::string checksum; //< hex checksum sent by the FST, empty if none
+    unsigned long long size;
+    unsigned long long fid;
+    unsigned long fsid;
+    unsigned long dropfsid; //< replica to drop, 0 if none
+    unsigned long mtime;
+    unsigned long mtimens;
+    bool verifychecksum;
+    bool commitchecksum;
+    bool verifysize;
+    bool commitsize;
+    bool replication;
+    bool modified;
+    bool occhunk; //< commit of a chunk of an OC chunked upload
+    int oc_n;
+    int oc_max;
+    bool ocdone; //< the last chunk of an OC chunked upload was committed
+    eos::Buffer checksumbuffer; //< binary checksum
+    std::shared_ptr<eos::IFileMD> fmd; //< committed file
+    std::string fmdname; //< name of the file before de-atomizing
+
+    CommitState () : size(0), fid(0), fsid(0), dropfsid(0), mtime(0),
+    mtimens(0), verifychecksum(false), commitchecksum(false),
+    verifysize(false), commitsize(false), replication(false),
+    modified(false), occhunk(false), oc_n(0), oc_max(0), ocdone(false) { }
+  };
+
+  // ---------------------------------------------------------------------------
+  // parse a commit and check the target file system - no lock is needed
+  // ---------------------------------------------------------------------------
+  int _commit_prepare (XrdOucEnv &env,
+                       XrdOucErrInfo &error,
+                       eos::common::Mapping::VirtualIdentity &vid,
+                       const char *tident,
+                       CommitState &state);
+
+  // ---------------------------------------------------------------------------
+  // apply a prepared commit to the namespace - the caller has to hold the
+  // namespace write lock, a batch of commits is applied under a single lock
+  // ---------------------------------------------------------------------------
+  int _commit_namespace (XrdOucErrInfo &error,
+                         eos::common::Mapping::VirtualIdentity &vid,
+                         CommitState &state);
+
+  // ---------------------------------------------------------------------------
+  // de-atomize and version a committed file - takes the namespace lock itself
+  // ---------------------------------------------------------------------------
+  int _commit_finish (XrdOucErrInfo &error,
+                      eos::common::Mapping::VirtualIdentity &vid,
+                      CommitState &state);
+
   // ---------------------------------------------------------------------------
   // touch a file
   // ---------------------------------------------------------------------------
@@ -1125,6 +1227,14 @@ public:
 
   XrdSysMutex DumpmdTimeMapMutex; //< mutex protecting the 'dumpmd' time
 
+  std::map<std::string, std::string> CommitBatchReplies; //< replies of the recently applied commit batches by batch id - a batch resent by an FST after a network error is answered from here instead of being applied twice, an empty reply marks a batch in progress
+
+  std::map<std::string, time_t> CommitBatchStart; //< start time of the commit batches in progress - a resent batch is stalled only for a bounded time while the first attempt is still running
+
+  std::deque<std::string> CommitBatchIds; //< batch ids in CommitBatchReplies in the order they were received
+
+  XrdSysMutex CommitBatchMutex; //< mutex protecting the commit batch replies
+
   eos::common::RWMutex PathMapMutex; //< mutex protecting the path map
 
   std::map<std::string, std::string> PathMap; //< containing global path remapping
@@ -285,6 +285,14 @@ XrdMgmOfs::FSctl (const int cmd,
 #include "fsctl/Commit.cc"
     }
 
+    // -------------------------------------------------------------------------
+    // Commit a batch of replicas
+    // -------------------------------------------------------------------------
+    if (execmd == "commitbatch")
+    {
+#include "fsctl/CommitBatch.cc"
+    }
+
     // -------------------------------------------------------------------------
     // Drop a replica
     // -------------------------------------------------------------------------
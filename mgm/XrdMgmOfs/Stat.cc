@@ -187,188 +187,399 @@ XrdMgmOfs::_stat (const char *path,
 
   if (fmd)
   {
-    memset(buf, 0, sizeof (struct stat));
-    buf->st_dev = 0xcaff;
-    buf->st_ino = eos::common::FileId::FidToInode(fmd->getId());
+    FileMDToStat(fmd.get(), buf, etag);
+    EXEC_TIMING_END("Stat");
+    return SFS_OK;
+  }
 
-    if (fmd->isLink())
-      buf->st_mode = S_IFLNK;
-    else
-      buf->st_mode = S_IFREG;
+  // Check if it's a directory
+  std::shared_ptr<eos::IContainerMD> cmd;
+  errno = 0;
 
-    uint16_t flags = fmd->getFlags();
+  // ---------------------------------------------------------------------------
+  try
+  {
+    cmd = gOFS->eosView->getContainer(cPath.GetPath(), follow);
 
-    if (fmd->isLink())
+    if (uri)
     {
-      buf->st_mode |= (S_IRWXU | S_IRWXG | S_IRWXO);
-      buf->st_nlink = 1;
+      *uri = gOFS->eosView->getUri(cmd.get());
     }
+
+    ContainerMDToStat(cmd.get(), buf, etag);
+    return SFS_OK;
+  }
+  catch (eos::MDException &e)
+  {
+    errno = e.getErrno();
+    eos_debug("msg=\"exception\" ec=%d emsg=\"%s\"", e.getErrno(), e.getMessage().str().c_str());
+    return Emsg(epname, error, errno, "stat", cPath.GetPath());
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+void
+XrdMgmOfs::FileMDToStat (eos::IFileMD *fmd,
+                         struct stat *buf,
+                         std::string *etag)
+/*----------------------------------------------------------------------------*/
+/*
+ * @brief fill the stat information and ETag of a file
+ *
+ * @param fmd file meta data, the namespace has to be read locked
+ * @param buf stat buffer where to store the stat information
+ * @param etag if given the ETag is stored here
+ */
+/*----------------------------------------------------------------------------*/
+{
+  memset(buf, 0, sizeof (struct stat));
+  buf->st_dev = 0xcaff;
+  buf->st_ino = eos::common::FileId::FidToInode(fmd->getId());
+
+  if (fmd->isLink())
+    buf->st_mode = S_IFLNK;
+  else
+    buf->st_mode = S_IFREG;
+
+  uint16_t flags = fmd->getFlags();
+
+  if (fmd->isLink())
+  {
+    buf->st_mode |= (S_IRWXU | S_IRWXG | S_IRWXO);
+    buf->st_nlink = 1;
+  }
+  else
+  {
+    if (!flags)
+      buf->st_mode |= (S_IRUSR | S_IRGRP | S_IROTH | S_IWUSR);
     else
-    {
-      if (!flags)
-	buf->st_mode |= (S_IRUSR | S_IRGRP | S_IROTH | S_IWUSR);
-      else
-	buf->st_mode |= flags;
+      buf->st_mode |= flags;
 
-      buf->st_nlink = fmd->getNumLocation();
-    }
+    buf->st_nlink = fmd->getNumLocation();
+  }
 
 
-    buf->st_uid = fmd->getCUid();
-    buf->st_gid = fmd->getCGid();
-    buf->st_rdev = 0; /* device type (if inode device) */
-    buf->st_size = fmd->getSize();
-    buf->st_blksize = 512;
-    buf->st_blocks = Quota::MapSizeCB(fmd.get()) / 512; // including layout factor
-    eos::IFileMD::ctime_t atime;
+  buf->st_uid = fmd->getCUid();
+  buf->st_gid = fmd->getCGid();
+  buf->st_rdev = 0; /* device type (if inode device) */
+  buf->st_size = fmd->getSize();
+  buf->st_blksize = 512;
+  buf->st_blocks = Quota::MapSizeCB(fmd) / 512; // including layout factor
+  eos::IFileMD::ctime_t atime;
 
-    // adding also nanosecond to stat struct
-    fmd->getCTime(atime);
+  // adding also nanosecond to stat struct
+  fmd->getCTime(atime);
 #ifdef __APPLE__
-    buf->st_ctimespec.tv_sec = atime.tv_sec;
-    buf->st_ctimespec.tv_nsec = atime.tv_nsec;
+  buf->st_ctimespec.tv_sec = atime.tv_sec;
+  buf->st_ctimespec.tv_nsec = atime.tv_nsec;
 #else
-    buf->st_ctime = atime.tv_sec;
-    buf->st_ctim.tv_sec = atime.tv_sec;
-    buf->st_ctim.tv_nsec = atime.tv_nsec;
+  buf->st_ctime = atime.tv_sec;
+  buf->st_ctim.tv_sec = atime.tv_sec;
+  buf->st_ctim.tv_nsec = atime.tv_nsec;
 #endif
 
-    fmd->getMTime(atime);
+  fmd->getMTime(atime);
 
 #ifdef __APPLE__
-    buf->st_mtimespec.tv_sec = atime.tv_sec;
-    buf->st_mtimespec.tv_nsec = atime.tv_nsec;
+  buf->st_mtimespec.tv_sec = atime.tv_sec;
+  buf->st_mtimespec.tv_nsec = atime.tv_nsec;
 
-    buf->st_atimespec.tv_sec = atime.tv_sec;
-    buf->st_atimespec.tv_nsec = atime.tv_nsec;
+  buf->st_atimespec.tv_sec = atime.tv_sec;
+  buf->st_atimespec.tv_nsec = atime.tv_nsec;
 #else
-    buf->st_mtime = atime.tv_sec;
-    buf->st_mtim.tv_sec = atime.tv_sec;
-    buf->st_mtim.tv_nsec = atime.tv_nsec;
+  buf->st_mtime = atime.tv_sec;
+  buf->st_mtim.tv_sec = atime.tv_sec;
+  buf->st_mtim.tv_nsec = atime.tv_nsec;
 
-    buf->st_atime = atime.tv_sec;
-    buf->st_atim.tv_sec = atime.tv_sec;
-    buf->st_atim.tv_nsec = atime.tv_nsec;
+  buf->st_atime = atime.tv_sec;
+  buf->st_atim.tv_sec = atime.tv_sec;
+  buf->st_atim.tv_nsec = atime.tv_nsec;
 #endif
 
-    if (etag)
+  if (etag)
+  {
+    // if there is a checksum we use the checksum, otherwise we return inode+mtime
+    size_t cxlen = eos::common::LayoutId::GetChecksumLen(fmd->getLayoutId());
+    if (cxlen)
     {
-      // if there is a checksum we use the checksum, otherwise we return inode+mtime
-      size_t cxlen = eos::common::LayoutId::GetChecksumLen(fmd->getLayoutId());
-      if (cxlen)
-      {
-	// use inode + checksum
-	char setag[256];
-	snprintf(setag, sizeof (setag) - 1, "\"%llu:", (unsigned long long) buf->st_ino);
-	// if MD5 checksums are used we omit the inode number in the ETag (S3 wants that)
-	if (eos::common::LayoutId::GetChecksum(fmd->getLayoutId()) != eos::common::LayoutId::kMD5)
-	  *etag = setag;
-	else
-	  *etag = "";
-
-	for (unsigned int i = 0; i < cxlen; i++)
-	{
-	  char hb[3];
-	  sprintf(hb, "%02x", (i < cxlen) ? (unsigned char) (fmd->getChecksum().getDataPadded(i)) : 0);
-	  *etag += hb;
-	}
-	*etag += "\"";
-      }
+      // use inode + checksum
+      char setag[256];
+      snprintf(setag, sizeof (setag) - 1, "\"%llu:", (unsigned long long) buf->st_ino);
+      // if MD5 checksums are used we omit the inode number in the ETag (S3 wants that)
+      if (eos::common::LayoutId::GetChecksum(fmd->getLayoutId()) != eos::common::LayoutId::kMD5)
+        *etag = setag;
       else
+        *etag = "";
+
+      for (unsigned int i = 0; i < cxlen; i++)
       {
-	// use inode + mtime
-	char setag[256];
-	snprintf(setag, sizeof (setag) - 1, "\"%llu:%llu\"", (unsigned long long) buf->st_ino,
-		 (unsigned long long) buf->st_mtime);
-	*etag = setag;
+        char hb[3];
+        sprintf(hb, "%02x", (i < cxlen) ? (unsigned char) (fmd->getChecksum().getDataPadded(i)) : 0);
+        *etag += hb;
       }
+      *etag += "\"";
+    }
+    else
+    {
+      // use inode + mtime
+      char setag[256];
+      snprintf(setag, sizeof (setag) - 1, "\"%llu:%llu\"", (unsigned long long) buf->st_ino,
+      	 (unsigned long long) buf->st_mtime);
+      *etag = setag;
     }
+  }
+}
 
-    EXEC_TIMING_END("Stat");
-    return SFS_OK;
+/*----------------------------------------------------------------------------*/
+void
+XrdMgmOfs::ContainerMDToStat (eos::IContainerMD *cmd,
+                              struct stat *buf,
+                              std::string *etag)
+/*----------------------------------------------------------------------------*/
+/*
+ * @brief fill the stat information and ETag of a container
+ *
+ * @param cmd container meta data, the namespace has to be read locked
+ * @param buf stat buffer where to store the stat information
+ * @param etag if given the ETag is stored here
+ */
+/*----------------------------------------------------------------------------*/
+{
+  memset(buf, 0, sizeof (struct stat));
+  buf->st_dev = 0xcaff;
+  buf->st_ino = cmd->getId();
+  buf->st_mode = cmd->getMode();
+
+  if (cmd->attributesBegin() != cmd->attributesEnd())
+  {
+    buf->st_mode |= S_ISVTX;
   }
 
-  // Check if it's a directory
-  std::shared_ptr<eos::IContainerMD> cmd;
-  errno = 0;
+  buf->st_nlink = 1;
+  buf->st_uid = cmd->getCUid();
+  buf->st_gid = cmd->getCGid();
+  buf->st_rdev = 0; /* device type (if inode device) */
+  buf->st_size = cmd->getTreeSize();
+  buf->st_blksize = 0;
+  buf->st_blocks = 0;
+
+  eos::IContainerMD::ctime_t ctime;
+  eos::IContainerMD::ctime_t mtime;
+  eos::IContainerMD::ctime_t tmtime;
+  cmd->getCTime(ctime);
+  cmd->getMTime(mtime);
+
+  if (gOFS->eosSyncTimeAccounting)
+    cmd->getTMTime(tmtime);
+  else
+    // if there is no sync time accounting we just use the normal modification time
+    tmtime = mtime;
 
-  // ---------------------------------------------------------------------------
-  try
+#ifdef __APPLE__
+  buf->st_atimespec.tv_sec = tmtime.tv_sec;
+  buf->st_mtimespec.tv_sec = mtime.tv_sec;
+  buf->st_ctimespec.tv_sec = ctime.tv_sec;
+  buf->st_atimespec.tv_nsec = tmtime.tv_nsec;
+  buf->st_mtimespec.tv_nsec = mtime.tv_nsec;
+  buf->st_ctimespec.tv_nsec = ctime.tv_nsec;
+#else
+  buf->st_atime = tmtime.tv_sec;
+  buf->st_mtime = mtime.tv_sec;
+  buf->st_ctime = ctime.tv_sec;
+  buf->st_atim.tv_sec = tmtime.tv_sec;
+  buf->st_mtim.tv_sec = mtime.tv_sec;
+  buf->st_ctim.tv_sec = ctime.tv_sec;
+  buf->st_atim.tv_nsec = tmtime.tv_nsec;
+  buf->st_mtim.tv_nsec = mtime.tv_nsec;
+  buf->st_ctim.tv_nsec = ctime.tv_nsec;
+#endif
+
+  if (etag)
   {
-    cmd = gOFS->eosView->getContainer(cPath.GetPath(), follow);
+    // use inode + mtime
+    char setag[256];
+    snprintf(setag, sizeof (setag) - 1, "\"%llx:%llu.%03lu\"",
+             (unsigned long long) cmd->getId(), (unsigned long long) buf->st_atime,
+             (unsigned long) buf->st_atim.tv_nsec/1000000);
+    *etag = setag;
+  }
+}
 
-    if (uri)
-    {
-      *uri = gOFS->eosView->getUri(cmd.get());
-    }
+/*----------------------------------------------------------------------------*/
+int
+XrdMgmOfs::_stat_dir (const char *path,
+                      std::vector<DirEntryStat> &entries,
+                      XrdOucErrInfo &error,
+                      eos::common::Mapping::VirtualIdentity &vid,
+                      const std::set<std::string> *xattrs)
+/*----------------------------------------------------------------------------*/
+/*
+ * @brief return stat information for all entries of a directory
+ *
+ * @param path directory to list
+ * @param entries returns one entry per file and subdirectory sorted by name
+ * @param error error object
+ * @param vid virtual identity of the client
+ * @param xattrs names of the extended attributes to return with each entry
+ * @return SFS_OK on success otherwise SFS_ERROR
+ *
+ * The directory has to be browsable like for opendir. All entries are looked
+ * up in their parent container under one namespace lock instead of resolving
+ * the full path of every entry, only symbolic links are resolved afterwards
+ * by _stat.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  static const char *epname = "_stat_dir";
+  EXEC_TIMING_BEGIN("StatDir");
+  gOFS->MgmStats.Add("StatDir", vid.uid, vid.gid, 1);
 
-    memset(buf, 0, sizeof (struct stat));
-    buf->st_dev = 0xcaff;
-    buf->st_ino = cmd->getId();
-    buf->st_mode = cmd->getMode();
+  eos::common::Path cPath(path);
+  std::vector<size_t> links;
+  entries.clear();
+
+  {
+    eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
+    std::shared_ptr<eos::IContainerMD> dh;
 
-    if (cmd->attributesBegin() != cmd->attributesEnd())
+    try
+    {
+      dh = gOFS->eosView->getContainer(cPath.GetPath());
+    }
+    catch (eos::MDException &e)
     {
-      buf->st_mode |= S_ISVTX;
+      errno = e.getErrno();
+      eos_debug("msg=\"exception\" ec=%d emsg=\"%s\"", e.getErrno(),
+                e.getMessage().str().c_str());
+      return Emsg(epname, error, errno, "stat directory", cPath.GetPath());
     }
 
-    buf->st_nlink = 1;
-    buf->st_uid = cmd->getCUid();
-    buf->st_gid = cmd->getCGid();
-    buf->st_rdev = 0; /* device type (if inode device) */
-    buf->st_size = cmd->getTreeSize();
-    buf->st_blksize = 0;
-    buf->st_blocks = 0;
-
-    eos::IContainerMD::ctime_t ctime;
-    eos::IContainerMD::ctime_t mtime;
-    eos::IContainerMD::ctime_t tmtime;
-    cmd->getCTime(ctime);
-    cmd->getMTime(mtime);
-
-    if (gOFS->eosSyncTimeAccounting)
-      cmd->getTMTime(tmtime);
-    else
-      // if there is no sync time accounting we just use the normal modification time
-      tmtime = mtime;
+    // same permission check as opendir
+    if (!dh->access(vid.uid, vid.gid, R_OK | X_OK))
+    {
+      eos::IContainerMD::XAttrMap attrmap;
+      Acl acl(cPath.GetPath(), error, vid, attrmap, false);
 
-#ifdef __APPLE__
-    buf->st_atimespec.tv_sec = tmtime.tv_sec;
-    buf->st_mtimespec.tv_sec = mtime.tv_sec;
-    buf->st_ctimespec.tv_sec = ctime.tv_sec;
-    buf->st_atimespec.tv_nsec = tmtime.tv_nsec;
-    buf->st_mtimespec.tv_nsec = mtime.tv_nsec;
-    buf->st_ctimespec.tv_nsec = ctime.tv_nsec;
-#else
-    buf->st_atime = tmtime.tv_sec;
-    buf->st_mtime = mtime.tv_sec;
-    buf->st_ctime = ctime.tv_sec;
-    buf->st_atim.tv_sec = tmtime.tv_sec;
-    buf->st_mtim.tv_sec = mtime.tv_sec;
-    buf->st_ctim.tv_sec = ctime.tv_sec;
-    buf->st_atim.tv_nsec = tmtime.tv_nsec;
-    buf->st_mtim.tv_nsec = mtime.tv_nsec;
-    buf->st_ctim.tv_nsec = ctime.tv_nsec;
-#endif
+      if (!acl.HasAcl() || !acl.CanBrowse())
+      {
+        return Emsg(epname, error, EPERM, "stat directory", cPath.GetPath());
+      }
+    }
+
+    gOFS->MgmStats.Add("StatDir-Entry", vid.uid, vid.gid,
+                       dh->getNumContainers() + dh->getNumFiles());
+    std::set<std::string> fnames = dh->getNameFiles();
+    std::set<std::string> dnames = dh->getNameContainers();
+    std::set<std::string>::const_iterator fit = fnames.begin();
+    std::set<std::string>::const_iterator dit = dnames.begin();
+    entries.reserve(fnames.size() + dnames.size());
 
-    if (etag)
+    while ((fit != fnames.end()) || (dit != dnames.end()))
     {
-      // use inode + mtime
-      char setag[256];
-      snprintf(setag, sizeof (setag) - 1, "\"%llx:%llu.%03lu\"",
-	       (unsigned long long) cmd->getId(), (unsigned long long) buf->st_atime,
-	       (unsigned long) buf->st_atim.tv_nsec/1000000);
-      *etag = setag;
+      bool isfile = ((dit == dnames.end()) ||
+                     ((fit != fnames.end()) && (*fit < *dit)));
+      const std::string &name = isfile ? *fit++ : *dit++;
+      entries.push_back(DirEntryStat());
+      DirEntryStat &entry = entries.back();
+      entry.name = name;
+
+      if (isfile)
+      {
+        std::shared_ptr<eos::IFileMD> fmd = dh->findFile(name);
+
+        if (!fmd)
+        {
+          entries.pop_back();
+          continue;
+        }
+
+        FileMDToStat(fmd.get(), &entry.buf, &entry.etag);
+
+        if (fmd->isLink())
+        {
+          links.push_back(entries.size() - 1);
+          continue;
+        }
+
+        size_t cxlen = eos::common::LayoutId::GetChecksumLen(fmd->getLayoutId());
+
+        for (unsigned int i = 0; i < cxlen; i++)
+        {
+          char hb[3];
+          sprintf(hb, "%02x", (unsigned char) (fmd->getChecksum().getDataPadded(i)));
+          entry.checksum += hb;
+        }
+
+        if (xattrs)
+        {
+          for (auto it = xattrs->begin(); it != xattrs->end(); ++it)
+          {
+            if (fmd->hasAttribute(*it))
+              entry.xattrs[*it] = fmd->getAttribute(*it);
+          }
+        }
+      }
+      else
+      {
+        std::shared_ptr<eos::IContainerMD> cmd = dh->findContainer(name);
+
+        if (!cmd)
+        {
+          entries.pop_back();
+          continue;
+        }
+
+        ContainerMDToStat(cmd.get(), &entry.buf, &entry.etag);
+
+        if (xattrs)
+        {
+          for (auto it = xattrs->begin(); it != xattrs->end(); ++it)
+          {
+            if (cmd->hasAttribute(*it))
+              entry.xattrs[*it] = cmd->getAttribute(*it);
+          }
+        }
+      }
     }
-
-    return SFS_OK;
   }
-  catch (eos::MDException &e)
+
+  // ---------------------------------------------------------------------------
+  // symbolic links are reported with the stat information of their target
+  // ---------------------------------------------------------------------------
+  for (auto it = links.begin(); it != links.end(); ++it)
   {
-    errno = e.getErrno();
-    eos_debug("msg=\"exception\" ec=%d emsg=\"%s\"", e.getErrno(), e.getMessage().str().c_str());
-    return Emsg(epname, error, errno, "stat", cPath.GetPath());
+    DirEntryStat &entry = entries[*it];
+    std::string lpath = cPath.GetFullPath().c_str();
+    lpath += "/";
+    lpath += entry.name;
+    XrdOucErrInfo lerror;
+    struct stat lbuf;
+    std::string letag;
+
+    if (_stat(lpath.c_str(), &lbuf, lerror, vid, (const char*) 0, &letag))
+    {
+      // dangling link, keep the link itself
+      continue;
+    }
+
+    entry.buf = lbuf;
+    entry.etag = letag;
+
+    if (xattrs)
+    {
+      for (auto xit = xattrs->begin(); xit != xattrs->end(); ++xit)
+      {
+        XrdOucString value;
+
+        if (!_attr_get(lpath.c_str(), lerror, vid, (const char*) 0,
+                       xit->c_str(), value))
+          entry.xattrs[*xit] = value.c_str();
+      }
+    }
   }
+
+  EXEC_TIMING_END("StatDir");
+  return SFS_OK;
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,208 @@
+// ----------------------------------------------------------------------
+// File: CommitBatch.cc
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+// -----------------------------------------------------------------------
+// This file is included source code in XrdMgmOfs.cc to make the code more
+// transparent without slowing down the compilation time.
+// -----------------------------------------------------------------------
+
+{
+  REQUIRE_SSS_OR_LOCAL_AUTH;
+  ACCESSMODE_W;
+  MAYSTALL;
+  MAYREDIRECT;
+
+  EXEC_TIMING_BEGIN("CommitBatch");
+
+  // ---------------------------------------------------------------------------
+  // the batch is a base64 encoded list of commit opaque strings:
+  // <n:uint32> { <length:uint32> <opaque> } - integers in network byte order
+  // ---------------------------------------------------------------------------
+  XrdOucString batch64 = env.Get("mgm.commit.batch");
+  char* batch = 0;
+  unsigned int batchlen = 0;
+
+  if (!batch64.length() ||
+      !eos::common::SymKey::Base64Decode(batch64, batch, batchlen) ||
+      (batchlen < sizeof (uint32_t)))
+  {
+    if (batch)
+      free(batch);
+
+    gOFS->MgmStats.Add("CommitFailedParameters", 0, 0, 1);
+    return Emsg(epname, error, EINVAL, "commit batch - cannot decode record list", "");
+  }
+
+  uint32_t nrecords;
+  memcpy(&nrecords, batch, sizeof (nrecords));
+  nrecords = ntohl(nrecords);
+  unsigned int offset = sizeof (uint32_t);
+  std::vector<std::string> records;
+
+  while ((records.size() < nrecords) && (offset + sizeof (uint32_t) <= batchlen))
+  {
+    uint32_t reclen;
+    memcpy(&reclen, batch + offset, sizeof (reclen));
+    reclen = ntohl(reclen);
+    offset += sizeof (uint32_t);
+
+    if (offset + reclen > batchlen)
+      break;
+
+    records.push_back(std::string(batch + offset, reclen));
+    offset += reclen;
+  }
+
+  free(batch);
+
+  if (records.size() != nrecords)
+  {
+    gOFS->MgmStats.Add("CommitFailedParameters", 0, 0, 1);
+    return Emsg(epname, error, EINVAL, "commit batch - record list is truncated", "");
+  }
+
+  // ---------------------------------------------------------------------------
+  // a batch resent after a network error gets the reply of the first attempt,
+  // its records must not be applied twice - while the first attempt is still
+  // running the resent batch is stalled, but only for a bounded time, after
+  // that the FST gets EBUSY and commits the records one by one
+  // ---------------------------------------------------------------------------
+  std::string batchid = env.Get("mgm.commit.batchid") ?
+                        env.Get("mgm.commit.batchid") : "";
+
+  if (batchid.length())
+  {
+    XrdSysMutexHelper lock(gOFS->CommitBatchMutex);
+    std::map<std::string, std::string>::iterator it =
+      gOFS->CommitBatchReplies.find(batchid);
+
+    if (it != gOFS->CommitBatchReplies.end())
+    {
+      if (it->second.empty())
+      {
+        std::map<std::string, time_t>::iterator st =
+          gOFS->CommitBatchStart.find(batchid);
+
+        if ((st != gOFS->CommitBatchStart.end()) &&
+            ((time(NULL) - st->second) < COMMIT_BATCH_MAX_STALL))
+        {
+          return gOFS->Stall(error, 1, "commit batch is in progress");
+        }
+
+        eos_thread_err("msg=\"commit batch is in progress for too long\" "
+                       "batchid=%s", batchid.c_str());
+        return Emsg(epname, error, EBUSY, "commit batch - batch is still in "
+                    "progress, commit the records one by one [EBUSY]",
+                    batchid.c_str());
+      }
+
+      eos_thread_info("msg=\"answering resent commit batch\" batchid=%s",
+                      batchid.c_str());
+      error.setErrInfo(it->second.length() + 1, it->second.c_str());
+      return SFS_DATA;
+    }
+
+    gOFS->CommitBatchReplies[batchid] = "";
+    gOFS->CommitBatchStart[batchid] = time(NULL);
+    gOFS->CommitBatchIds.push_back(batchid);
+
+    while (gOFS->CommitBatchIds.size() > 4096)
+    {
+      gOFS->CommitBatchReplies.erase(gOFS->CommitBatchIds.front());
+      gOFS->CommitBatchStart.erase(gOFS->CommitBatchIds.front());
+      gOFS->CommitBatchIds.pop_front();
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // commit all records - parsing and de-atomizing run without the namespace
+  // lock, the file meta data of all records is updated under a single write
+  // lock. The response carries one errno per record.
+  // ---------------------------------------------------------------------------
+  std::vector<CommitState> states(records.size());
+  std::vector<int> retcs(records.size(), 0);
+
+  for (size_t i = 0; i < records.size(); i++)
+  {
+    size_t qpos = records[i].find('?');
+    XrdOucEnv recenv((qpos == std::string::npos) ? records[i].c_str() :
+                     records[i].c_str() + qpos + 1);
+    XrdOucErrInfo recerror(tident);
+
+    if (_commit_prepare(recenv, recerror, vid, tident, states[i]))
+    {
+      retcs[i] = recerror.getErrInfo() ? recerror.getErrInfo() : EIO;
+    }
+  }
+
+  {
+    // -------------------------------------------------------------------------
+    // keep the lock order View=>Namespace=>Quota
+    // -------------------------------------------------------------------------
+    eos::common::RWMutexWriteLock nslock(gOFS->eosViewRWMutex);
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+      XrdOucErrInfo recerror(tident);
+
+      if (!retcs[i] && _commit_namespace(recerror, vid, states[i]))
+      {
+        retcs[i] = recerror.getErrInfo() ? recerror.getErrInfo() : EIO;
+      }
+    }
+  }
+
+  std::string response = "OK ";
+  response += std::to_string((unsigned long long) records.size());
+
+  for (size_t i = 0; i < records.size(); i++)
+  {
+    if (!retcs[i])
+    {
+      XrdOucErrInfo recerror(tident);
+      _commit_finish(recerror, vid, states[i]);
+    }
+
+    response += " ";
+    response += std::to_string((long long) retcs[i]);
+  }
+
+  if (batchid.length())
+  {
+    XrdSysMutexHelper lock(gOFS->CommitBatchMutex);
+    std::map<std::string, std::string>::iterator it =
+      gOFS->CommitBatchReplies.find(batchid);
+
+    if (it != gOFS->CommitBatchReplies.end())
+    {
+      it->second = response;
+    }
+
+    gOFS->CommitBatchStart.erase(batchid);
+  }
+
+  gOFS->MgmStats.Add("CommitBatch", 0, 0, 1);
+  error.setErrInfo(response.length() + 1, response.c_str());
+  EXEC_TIMING_END("CommitBatch");
+  return SFS_DATA;
+}
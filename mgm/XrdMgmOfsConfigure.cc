@@ -1945,6 +1945,15 @@ XrdMgmOfs::Configure (XrdSysError &Eroute)
   // start the LRU daemon
   if (!LRUd.Start())
     eos_warning("msg=\"cannot start LRU thread\"");
+  // set the recycle bin index file
+  XrdOucString recycleindex = MgmMetaLogDir;
+  recycleindex += "/recycle.";
+  recycleindex += HostName;
+  recycleindex += ".index";
+
+  if (!Recycle::SetIndexFileName(recycleindex.c_str()))
+    eos_notice("recycle bin index %s will be rebuilt", recycleindex.c_str());
+
   // start the recycler garbage collection thread on a master machine
   if ((MgmMaster.IsMaster()) && (!Recycler.Start()))
     eos_warning("msg=\"cannot start recycle thread\"");
@@ -42,6 +42,9 @@
 #define S_IAMB  0x1FF
 #endif
 
+//! number of directory entries copied per namespace lock
+#define EOSMGMDIRECTORYBATCH 1024
+
 
 /*----------------------------------------------------------------------------*/
 
@@ -60,6 +63,9 @@ XrdMgmOfsDirectory::XrdMgmOfsDirectory (char *user, int MonID):
 {
   dirName = "";
   dh.reset();
+  dh_pos = 0;
+  dh_eof = true;
+  dh_dotdot = false;
   d_pnt = &dirent_full.d_entry;
   eos::common::Mapping::Nobody (vid);
   eos::common::LogId ();
@@ -121,8 +127,9 @@ XrdMgmOfsDirectory::open (const char *inpath,
  *
  * @return SFS_OK otherwise SFS_ERROR
  *
- * We create during the open the full directory listing which then is retrieved
- * via nextEntry() and cleaned up with close().
+ * We fetch during the open the first batch of the directory listing, the
+ * following ones are fetched by nextEntry() after the last entry returned, so
+ * a large directory is never copied in one go.
  */
 /*----------------------------------------------------------------------------*/
 {
@@ -215,14 +222,13 @@ XrdMgmOfsDirectory::_open (const char *dir_path,
       // Add all the files and subdirectories
       gOFS->MgmStats.Add("OpenDir-Entry", vid.uid, vid.gid,
                          dh->getNumContainers() + dh->getNumFiles());
-      dh_list = dh->getNameFiles();
-      std::set<std::string> dnames = dh->getNameContainers();
-      dh_list.insert(dnames.begin(), dnames.end());
-      dh_list.insert(".");
-
+      dh_list.clear();
+      dh_pos = 0;
+      dh_last = "";
+      dh_eof = false;
       // The root dir has no .. entry
-      if (strcmp(dir_path, "/"))
-        dh_list.insert("..");
+      dh_dotdot = (strcmp(dir_path, "/") != 0);
+      FetchEntries();
     }
   }
   catch (eos::MDException &e)
@@ -256,10 +262,6 @@ XrdMgmOfsDirectory::_open (const char *dir_path,
 
   dirName = dir_path;
 
-  // Set up values for this directory object
-  //
-  dh_it = dh_list.begin();
-
   EXEC_TIMING_END("OpenDir");
   return SFS_OK;
 }
@@ -280,15 +282,104 @@ XrdMgmOfsDirectory::nextEntry ()
  */
 /*----------------------------------------------------------------------------*/
 {
-  if (dh_it == dh_list.end())
+  if ((dh_pos == dh_list.size()) && !dh_eof && dh)
+  {
+    eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
+    FetchEntries();
+  }
+
+  if (dh_pos == dh_list.size())
   {
     // no more entry
     return (const char *) 0;
   }
 
-  std::set<std::string>::iterator tmp_it = dh_it;
-  dh_it++;
-  return tmp_it->c_str();
+  return dh_list[dh_pos++].c_str();
+}
+
+/*----------------------------------------------------------------------------*/
+void
+XrdMgmOfsDirectory::FetchEntries ()
+/*----------------------------------------------------------------------------*/
+/*
+ * @brief fetch the next batch of directory entries following dh_last
+ *
+ * Files, subdirectories and the . and .. entries are merged in name order.
+ * Resuming after the last name instead of keeping a position keeps the
+ * listing consistent while entries are added or removed in between: every
+ * entry present during the whole listing is returned exactly once.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  eos::ContainerNameBatch files(EOSMGMDIRECTORYBATCH);
+  eos::ContainerNameBatch conts(EOSMGMDIRECTORYBATCH);
+  std::vector<std::string> dots;
+  dh_list.clear();
+  dh_pos = 0;
+
+  try
+  {
+    dh->visitNameFiles(&files, dh_last);
+    dh->visitNameContainers(&conts, dh_last);
+  }
+  catch (eos::MDException &e)
+  {
+    eos_debug("msg=\"exception\" ec=%d emsg=\"%s\"\n",
+              e.getErrno(), e.getMessage().str().c_str());
+    dh_eof = true;
+    return;
+  }
+
+  if (dh_last < ".")
+    dots.push_back(".");
+
+  if (dh_dotdot && (dh_last < ".."))
+    dots.push_back("..");
+
+  // A full batch may be followed by names missing in the other ones, so we
+  // stop at the smallest last name of the full batches
+  const std::string* bound = 0;
+
+  if (files.isFull())
+    bound = &files.getNames().back();
+
+  if (conts.isFull() && (!bound || (conts.getNames().back() < *bound)))
+    bound = &conts.getNames().back();
+
+  std::vector<std::string>* lists[3] = {
+    &files.getNames(), &conts.getNames(), &dots
+  };
+  size_t pos[3] = {0, 0, 0};
+
+  while (true)
+  {
+    int next = -1;
+
+    for (int i = 0; i < 3; i++)
+    {
+      if ((pos[i] < lists[i]->size()) &&
+          ((next < 0) || ((*lists[i])[pos[i]] < (*lists[next])[pos[next]])))
+        next = i;
+    }
+
+    if (next < 0)
+      break;
+
+    std::string& name = (*lists[next])[pos[next]++];
+
+    if (bound && (name > *bound))
+      break;
+
+    // Never list a name twice
+    if (dh_list.empty() || (dh_list.back() != name))
+      dh_list.push_back(name);
+  }
+
+  if (!bound)
+    dh_eof = true;
+
+  if (!dh_list.empty())
+    dh_last = dh_list.back();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -304,6 +395,9 @@ XrdMgmOfsDirectory::close ()
 {
   //  static const char *epname = "closedir";
   dh_list.clear();
+  dh_pos = 0;
+  dh_eof = true;
+  dh.reset();
 
   return SFS_OK;
 }
@@ -43,7 +43,7 @@
 /*----------------------------------------------------------------------------*/
 #include <dirent.h>
 #include <string>
-#include <set>
+#include <vector>
 /*----------------------------------------------------------------------------*/
 
 //! Forward declaration
@@ -143,8 +143,17 @@ private:
   eos::common::Mapping::VirtualIdentity vid;
 
   std::shared_ptr<eos::IContainerMD> dh;
-  std::set<std::string> dh_list;
-  std::set<std::string>::const_iterator dh_it;
+  std::vector<std::string> dh_list; ///< current batch of entries in name order
+  size_t dh_pos; ///< position of the next entry in the batch
+  std::string dh_last; ///< last entry fetched, the next batch starts after it
+  bool dh_eof; ///< all the entries have been fetched
+  bool dh_dotdot; ///< the directory has a .. entry
+
+  // ---------------------------------------------------------------------------
+  //! Fetch the next batch of entries following dh_last, the caller holds the
+  //! namespace read lock
+  // ---------------------------------------------------------------------------
+  void FetchEntries ();
 };
 
 
@@ -419,6 +419,8 @@ XrdMgmOfsFile::open (const char *inpath,
     {
       procCmd = new ProcCommand();
       procCmd->SetLogId(logId, vid, tident);
+      // large results are streamed to the client while it reads
+      procCmd->SetStreaming(true);
       return procCmd->open(path, info, vid, &error);
     }
   }
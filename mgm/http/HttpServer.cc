@@ -188,9 +188,23 @@ HttpServer::Handler (void *cls,
 
   // Create the response
   struct MHD_Response *mhdResponse;
-  mhdResponse = MHD_create_response_from_buffer(response->GetBodySize(), (void*)
-                                                response->GetBody().c_str(),
-                                                MHD_RESPMEM_MUST_COPY);
+  bool streamed = response->mUseBodyCallback;
+
+  if (streamed)
+  {
+    // the handler lives until the body has been sent
+    mhdResponse = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN,
+                                                    64 * 1024,
+                                                    &HttpServer::BodyReaderCallback,
+                                                    (void*) protocolHandler,
+                                                    &HttpServer::BodyCloseCallback);
+  }
+  else
+  {
+    mhdResponse = MHD_create_response_from_buffer(response->GetBodySize(), (void*)
+                                                  response->GetBody().c_str(),
+                                                  MHD_RESPMEM_MUST_COPY);
+  }
 
   if (mhdResponse)
   {
@@ -206,7 +220,8 @@ HttpServer::Handler (void *cls,
                                  mhdResponse);
     eos_static_debug("msg=\"MHD_queue_response\" retc=%d", ret);
     MHD_destroy_response(mhdResponse);
-    delete protocolHandler;
+    if (!streamed)
+      delete protocolHandler;
     *ptr = 0;
     return ret;
   }
@@ -219,6 +234,35 @@ HttpServer::Handler (void *cls,
   }
 }
 
+/*----------------------------------------------------------------------------*/
+ssize_t
+HttpServer::BodyReaderCallback (void *cls, uint64_t pos, char *buf, size_t max)
+{
+  eos::common::ProtocolHandler *handler =
+    static_cast<eos::common::ProtocolHandler*> (cls);
+  eos::common::HttpResponse *response = handler->GetResponse();
+  ssize_t nread = response ? response->ReadBody(buf, max) : -1;
+
+  if (nread < 0)
+  {
+    eos_static_err("msg=\"failed to produce response body\" pos=%llu",
+                   (unsigned long long) pos);
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+  }
+
+  if (!nread)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+
+  return nread;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+HttpServer::BodyCloseCallback (void *cls)
+{
+  delete static_cast<eos::common::ProtocolHandler*> (cls);
+}
+
 #endif
 
 /*----------------------------------------------------------------------------*/
@@ -91,7 +91,27 @@ public:
 		   void                             **con_cls,
 		   enum MHD_RequestTerminationCode    toe);
 
-  
+  /**
+   * Body reader callback function for streamed responses
+   *
+   * @param cls protocol handler owning the response
+   * @param pos offset in the body
+   * @param buf buffer to write to
+   * @param max size of the buffer
+   *
+   * @return number of bytes stored or MHD end of stream marker
+   */
+  static ssize_t
+  BodyReaderCallback (void *cls, uint64_t pos, char *buf, size_t max);
+
+  /**
+   * Body close callback function for streamed responses, deletes the
+   * protocol handler
+   *
+   * @param cls protocol handler owning the response
+   */
+  static void
+  BodyCloseCallback (void *cls);
 
 #endif
 
@@ -25,11 +25,15 @@
 #include "mgm/http/s3/S3Store.hh"
 #include "mgm/http/s3/S3Handler.hh"
 #include "mgm/XrdMgmOfs.hh"
-#include "mgm/XrdMgmOfsDirectory.hh"
 #include "common/http/PlainHttpResponse.hh"
+#include "common/http/StreamedHttpResponse.hh"
 #include "common/Logging.hh"
 #include "common/LayoutId.hh"
 /*----------------------------------------------------------------------------*/
+#include <vector>
+#include <set>
+#include <limits>
+/*----------------------------------------------------------------------------*/
 
 EOSMGMNAMESPACE_BEGIN
 
@@ -216,6 +220,230 @@ S3Store::ListBuckets (const std::string &id)
   return response;
 }
 
+/*----------------------------------------------------------------------------*/
+/**
+ * Streamed body of a bucket listing. The keys of the listed page are selected
+ * by ListBucket, their metadata is looked up in the namespace and rendered
+ * while the listing is sent, a limited number of entries per namespace lock.
+ */
+/*----------------------------------------------------------------------------*/
+class S3ListBucketResponse : public eos::common::StreamedHttpResponse
+{
+private:
+  std::string              mHead;        //< XML up to the first entry
+  std::string              mPrefix;      //< prefix of all keys
+  eos::IContainerMD::id_t  mContainerId; //< id of the listed directory
+  std::vector<std::string> mKeys;        //< keys relative to the prefix
+  size_t                   mNext;        //< next key to render
+  bool                     mHeadSent;    //< true once mHead was produced
+
+  static const size_t sEntriesPerLock = 256;
+
+public:
+
+  S3ListBucketResponse (const std::string &head,
+                        const std::string &prefix,
+                        eos::IContainerMD::id_t cid,
+                        std::vector<std::string> &keys) :
+    mHead(head), mPrefix(prefix), mContainerId(cid), mNext(0), mHeadSent(false)
+  {
+    mKeys.swap(keys);
+  }
+
+  virtual ~S3ListBucketResponse () {};
+
+  bool
+  Produce (std::string &body)
+  {
+    using namespace eos::common;
+
+    if (!mHeadSent)
+    {
+      body += mHead;
+      mHeadSent = true;
+      return true;
+    }
+
+    if (mNext == mKeys.size())
+    {
+      body += "</ListBucketResult>";
+      return false;
+    }
+
+    RWMutexReadLock lock(gOFS->eosViewRWMutex);
+    std::shared_ptr<eos::IContainerMD> dh;
+
+    try
+    {
+      dh = gOFS->eosDirectoryService->getContainerMD(mContainerId);
+    }
+    catch (eos::MDException &e)
+    {
+      // the directory is gone, there is nothing left to list
+      mNext = mKeys.size();
+      return true;
+    }
+
+    for (size_t n = 0; (n < sEntriesPerLock) && (mNext < mKeys.size());
+         n++, mNext++)
+    {
+      const std::string &key = mKeys[mNext];
+      int errc = 0;
+
+      if (key[key.length() - 1] != '/')
+      {
+        std::shared_ptr<eos::IFileMD> fmd = dh->findFile(key);
+
+        if (!fmd)
+        {
+          // deleted since the page was selected
+          continue;
+        }
+
+        body += "<Contents>";
+        body += "<Key>";
+        body += mPrefix;
+        body += key;
+        body += "</Key>";
+        body += "<LastModified>";
+        eos::IFileMD::ctime_t mtime;
+        fmd->getMTime(mtime);
+        body += Timing::UnixTimstamp_to_ISO8601(mtime.tv_sec);
+        body += "</LastModified>";
+        body += "<ETag>";
+        for (unsigned int i = 0; i < LayoutId::GetChecksumLen(fmd->getLayoutId()); i++)
+        {
+          char hb[3];
+          sprintf(hb, "%02x", (unsigned char) (fmd->getChecksum().getDataPtr()[i]));
+          body += hb;
+        }
+        body += "</ETag>";
+        body += "<Size>";
+        std::string sconv;
+        body += StringConversion::GetSizeString(sconv, (unsigned long long)
+                                                fmd->getSize());
+        body += "</Size>";
+        body += "<StorageClass>STANDARD</StorageClass>";
+        body += "<Owner>";
+        body += "<ID>";
+        body += Mapping::UidToUserName(fmd->getCUid(), errc);
+        body += "</ID>";
+        body += "<DisplayName>";
+        body += Mapping::UidToUserName(fmd->getCUid(), errc);
+        body += ":";
+        body += Mapping::GidToGroupName(fmd->getCGid(), errc);
+        body += "</DisplayName>";
+        body += "</Owner>";
+        body += "</Contents>";
+      }
+      else
+      {
+        std::shared_ptr<eos::IContainerMD> cmd =
+          dh->findContainer(key.substr(0, key.length() - 1));
+
+        if (!cmd)
+        {
+          // deleted since the page was selected
+          continue;
+        }
+
+        body += "<Contents>";
+        body += "<Key>";
+        body += mPrefix;
+        body += key;
+        body += "</Key>";
+        body += "<LastModified>";
+        eos::IContainerMD::mtime_t mtime;
+        cmd->getMTime(mtime);
+        body += Timing::UnixTimstamp_to_ISO8601(mtime.tv_sec);
+        body += "</LastModified>";
+        body += "<ETag>";
+        body += "</ETag>";
+        body += "<Size>0</Size>";
+        body += "<StorageClass>STANDARD</StorageClass>";
+        body += "<Owner>";
+        body += "<ID>";
+        body += Mapping::UidToUserName(cmd->getCUid(), errc);
+        body += "</ID>";
+        body += "<DisplayName>";
+        body += Mapping::UidToUserName(cmd->getCUid(), errc);
+        body += ":";
+        body += Mapping::GidToGroupName(cmd->getCGid(), errc);
+        body += "</DisplayName>";
+        body += "</Owner>";
+        body += "</Contents>";
+      }
+    }
+
+    return true;
+  }
+};
+
+/*----------------------------------------------------------------------------*/
+//! Subdirectory name visitor collecting the first keys ('<name>/') following
+//! a marker in key order. The names are visited in name order, which differs
+//! from the key order when a name continues with a character sorting before
+//! '/' e.g. 'a-b/' comes before 'a/'. A key is therefore held back until a
+//! name greater than it is visited, all the following keys being greater too.
+/*----------------------------------------------------------------------------*/
+class S3DirKeyCollector : public eos::IContainerNameVisitor
+{
+public:
+
+  S3DirKeyCollector (const std::string &start, size_t max_keys) :
+    mStart(start), mMaxKeys(max_keys) { }
+
+  bool
+  visitName (const std::string &name)
+  {
+    Flush(&name);
+
+    if (mKeys.size() >= mMaxKeys)
+    {
+      return false;
+    }
+
+    std::string key = name + "/";
+
+    if (key > mStart)
+    {
+      mPending.insert(key);
+    }
+
+    return true;
+  }
+
+  // ---------------------------------------------------------------------------
+  //! get the collected keys once all the names have been visited
+  // ---------------------------------------------------------------------------
+  std::vector<std::string>&
+  GetKeys ()
+  {
+    Flush(0);
+    return mKeys;
+  }
+
+private:
+  std::string mStart;
+  size_t mMaxKeys;
+  std::set<std::string> mPending;
+  std::vector<std::string> mKeys;
+
+  // ---------------------------------------------------------------------------
+  //! move the pending keys lower than name (all if 0) to the collected ones
+  // ---------------------------------------------------------------------------
+  void
+  Flush (const std::string *name)
+  {
+    while (!mPending.empty() && (mKeys.size() < mMaxKeys) &&
+           (!name || (*mPending.begin() < *name)))
+    {
+      mKeys.push_back(*mPending.begin());
+      mPending.erase(mPending.begin());
+    }
+  }
+};
+
 /*----------------------------------------------------------------------------*/
 eos::common::HttpResponse*
 S3Store::ListBucket (const std::string &bucket, const std::string &query)
@@ -257,16 +485,10 @@ S3Store::ListBucket (const std::string &bucket, const std::string &query)
   result += "</Name>";
 
   XrdOucEnv parameter(query.c_str());
-  XrdOucString stdErr;
-  XrdMgmOfsDirectory bucketdir;
-  uint64_t cnt = 0;
   uint64_t max_keys = 1000;
   std::string marker = "";
   std::string prefix = "";
 
-  // indicates that the given marker has been found in the list and output starts
-  bool marker_found = true;
-
   const char* val = 0;
   if ((val = parameter.Get("max-keys")))
   {
@@ -284,19 +506,12 @@ S3Store::ListBucket (const std::string &bucket, const std::string &query)
   {
     prefix = val;
   }
-  if (marker.length())
-  {
-    marker_found = false;
-  }
 
   std::string lPrefix = prefix;
-  if (prefix == "")
-  {
-    //    lPrefix = "/";
-  }
 
-  eos_static_info("msg=\"listing\" bucket=%s prefix=%s", bucket.c_str(),
-                  lPrefix.c_str());
+  eos_static_info("msg=\"listing\" bucket=%s prefix=%s marker=%s max-keys=%llu",
+                  bucket.c_str(), lPrefix.c_str(), marker.c_str(),
+                  (unsigned long long) max_keys);
 
   if (!prefix.length())
   {
@@ -328,159 +543,124 @@ S3Store::ListBucket (const std::string &bucket, const std::string &query)
   result += smaxkeys;
   result += "</MaxKeys>";
 
-  bool truncated = false;
-
-  size_t truncate_pos = result.length() + 13;
-  result += "<IsTruncated>false</IsTruncated>";
-
   XrdOucString sPrefix = lPrefix.c_str();
   if (!sPrefix.endswith("/") && sPrefix.length())
   {
     lPrefix += "/";
   }
 
-  int listrc = bucketdir.open((mS3ContainerPath[bucket] + lPrefix).c_str(),
-                              vid, (const char*) 0);
+  // ---------------------------------------------------------------------------
+  // the listing continues after the marker: keys of the listed directory are
+  // compared without the prefix, a marker before the prefix lists everything
+  // and a marker after it nothing
+  // ---------------------------------------------------------------------------
+  std::string start = "";
+  bool list = true;
 
-  if (!listrc)
+  if (!marker.compare(0, lPrefix.length(), lPrefix))
+  {
+    start = marker.substr(lPrefix.length());
+  }
+  else if (marker > lPrefix)
   {
-    const char* dname1 = 0;
+    list = false;
+  }
 
-    while ((dname1 = bucketdir.nextEntry()))
-    {
-      // loop over the directory contents
+  std::vector<std::string> keys;
+  eos::IContainerMD::id_t cid = 0;
+  bool truncated = false;
 
-      std::string sdname = dname1;
-      if ((sdname == ".") || (sdname == ".."))
-      {
-        continue;
-      }
+  if (list)
+  {
+    // -------------------------------------------------------------------------
+    // select the page: files and directories ('<name>/') merged in key order
+    // starting after the marker, without looking at the entries themselves
+    // -------------------------------------------------------------------------
+    RWMutexReadLock lock(gOFS->eosViewRWMutex);
+
+    try
+    {
+      std::shared_ptr<eos::IContainerMD> dh =
+        gOFS->eosView->getContainer(mS3ContainerPath[bucket] + lPrefix);
+      cid = dh->getId();
+      // one key more than the page tells if the listing is truncated
+      size_t batch = std::numeric_limits<size_t>::max();
 
-      if (cnt > max_keys)
+      if (max_keys < batch)
       {
-        truncated = true;
-        // don't return more than max-keys
-        break;
+        batch = max_keys + 1;
       }
-      std::string objectname = lPrefix;
 
-      std::string fullname;
-      objectname += sdname;
-      fullname = mS3ContainerPath[bucket];
-      fullname += objectname;
+      eos::ContainerNameBatch files(batch);
+      S3DirKeyCollector dirs(start, batch);
+      dh->visitNameFiles(&files, start);
 
-      if (!marker_found)
+      // subdirectories whose name is a prefix of the marker followed by a
+      // character sorting before '/' have a key after it, but not their name
+      for (size_t i = 1; i <= start.length(); i++)
       {
-        if (marker == objectname)
+        if ((i == start.length()) || (start[i] < '/'))
         {
-          marker_found = true;
+          if (dh->findContainer(start.substr(0, i)))
+          {
+            dirs.visitName(start.substr(0, i));
+          }
         }
-        continue;
       }
 
-      // get the file md object
-      gOFS->eosViewRWMutex.LockRead();
-      std::shared_ptr<eos::IFileMD> fmd;
+      dh->visitNameContainers(&dirs, start);
+      std::vector<std::string>& fnames = files.getNames();
+      std::vector<std::string>& dnames = dirs.GetKeys();
+      std::vector<std::string>::const_iterator fit = fnames.begin();
+      std::vector<std::string>::const_iterator dit = dnames.begin();
 
-      try
+      while ((fit != fnames.end()) || (dit != dnames.end()))
       {
-	gOFS->eosViewRWMutex.UnLockRead();
-        //-------------------------------------------
-
-        result += "<Contents>";
-        result += "<Key>";
-        result += objectname.c_str();
-        result += "</Key>";
-        result += "<LastModified>";
-
-        eos::IFileMD::ctime_t mtime;
-        fmd->getMTime(mtime);
-
-        result += Timing::UnixTimstamp_to_ISO8601(mtime.tv_sec);
-        result += "</LastModified>";
-        result += "<ETag>";
-        for (unsigned int i = 0; i < LayoutId::GetChecksumLen(fmd->getLayoutId()); i++)
+        if (keys.size() == max_keys)
         {
-          char hb[3];
-          sprintf(hb, "%02x", (unsigned char) (fmd->getChecksum().getDataPtr()[i]));
-          result += hb;
+          truncated = true;
+          break;
         }
-        result += "</ETag>";
-        result += "<Size>";
-        std::string sconv;
-        result += StringConversion::GetSizeString(sconv, (unsigned long long)
-                                                  fmd->getSize());
-        result += "</Size>";
-        result += "<StorageClass>STANDARD</StorageClass>";
-        result += "<Owner>";
-        result += "<ID>";
-        int errc = 0;
-        result += Mapping::UidToUserName(fmd->getCUid(), errc);
-        result += "</ID>";
-        result += "<DisplayName>";
-        result += Mapping::UidToUserName(fmd->getCUid(), errc);
-        result += ":";
-        result += Mapping::GidToGroupName(fmd->getCGid(), errc);
-        result += "</DisplayName>";
-        result += "</Owner>";
-        result += "</Contents>";
-      }
-      catch (eos::MDException &e)
-      {
-        gOFS->eosViewRWMutex.UnLockRead();
-        //-------------------------------------------
-      }
-
-      if (!fmd)
-      {
-        // TODO: add the real container info here ...
-        // this must be a container
-        result += "<Contents>";
-        result += "<Key>";
-        result += objectname.c_str();
-        result += "/";
-        result += "</Key>";
-        result += "<LastModified>";
-        result += Timing::UnixTimstamp_to_ISO8601(time(NULL));
-        result += "</LastModified>";
-        result += "<ETag>";
-        result += "</ETag>";
-        result += "<Size>0</Size>";
-        result += "<StorageClass>STANDARD</StorageClass>";
-        result += "<Owner>";
-        result += "<ID>";
-        result += "0";
-        result += "</ID>";
-        result += "<DisplayName>";
-        result += "fake";
-        result += ":";
-        result += "fake";
-        result += "</DisplayName>";
-        result += "</Owner>";
-        result += "</Contents>";
 
-      }
-      cnt++;
-      if (truncated)
-      {
-        break;
+        if ((dit == dnames.end()) ||
+            ((fit != fnames.end()) && (*fit < *dit)))
+        {
+          keys.push_back(*fit++);
+        }
+        else
+        {
+          keys.push_back(*dit++);
+        }
       }
     }
+    catch (eos::MDException &e)
+    {
+      eos_static_debug("msg=\"exception\" ec=%d emsg=\"%s\"", e.getErrno(),
+                       e.getMessage().str().c_str());
+      keys.clear();
+    }
   }
 
-  bucketdir.close();
-
   if (truncated)
   {
-    result.replace(truncate_pos, 19, "true</IsTruncated> ");
-  }
+    result += "<IsTruncated>true</IsTruncated>";
 
-  result += "</ListBucketResult>";
+    if (keys.size())
+    {
+      result += "<NextMarker>";
+      result += lPrefix;
+      result += keys.back();
+      result += "</NextMarker>";
+    }
+  }
+  else
+  {
+    result += "<IsTruncated>false</IsTruncated>";
+  }
 
-  response = new PlainHttpResponse();
+  response = new S3ListBucketResponse(result, lPrefix, cid, keys);
   response->AddHeader("Content-Type", "application/xml");
   response->AddHeader("Connection", "close");
-  response->SetBody(result);
 
   return response;
 }
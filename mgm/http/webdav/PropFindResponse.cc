@@ -24,7 +24,6 @@
 /*----------------------------------------------------------------------------*/
 #include "mgm/http/webdav/PropFindResponse.hh"
 #include "mgm/XrdMgmOfs.hh"
-#include "mgm/XrdMgmOfsDirectory.hh"
 #include "mgm/Quota.hh"
 #include "common/Logging.hh"
 #include "common/Timing.hh"
@@ -178,10 +177,10 @@ PropFindResponse::BuildResponse (eos::common::HttpRequest *request)
 
   else if (depth == "1")
   {
-    // Stat the resource and all child resources
-    XrdMgmOfsDirectory directory;
-    int listrc = directory._open(request->GetUrl().c_str(), *mVirtualIdentity,
-                                 (const char*) 0);
+    // Stat the resource and all child resources, the children in one pass
+    XrdOucErrInfo direrror;
+    int listrc = gOFS->_stat_dir(request->GetUrl().c_str(), mEntries,
+                                 direrror, *mVirtualIdentity);
 
     responseNode = BuildResponseNode(request->GetUrl().c_str(), request->GetUrl(true).c_str());
 
@@ -190,43 +189,36 @@ PropFindResponse::BuildResponse (eos::common::HttpRequest *request)
       multistatusNode->append_node(responseNode);
     }
 
-    if (!listrc)
-    {
-      const char *val;
-      while ((val = directory.nextEntry()))
-      {
-        XrdOucString entryname = val;
-        // don't display . .., atomic(+version) uploads and version directories
-        if (entryname.beginswith(EOS_COMMON_PATH_VERSION_FILE_PREFIX) ||
-            entryname.beginswith(EOS_COMMON_PATH_ATOMIC_FILE_PREFIX) ||
-            entryname.beginswith(EOS_WEBDAV_HIDE_IN_PROPFIND_PREFIX) ||
-            (entryname == ".") ||
-            (entryname == ".."))
-        {
-          // skip over . .. and hidden files
-          continue;
-        }
-
-        // one response node for each file...
-        eos::common::Path path((request->GetUrl() + std::string("/") + std::string(val)).c_str());
-        eos::common::Path refpath((request->GetUrl(true) + std::string("/") + std::string(val)).c_str());
-        responseNode = BuildResponseNode(path.GetPath(), refpath.GetPath());
-        if (responseNode)
-        {
-          multistatusNode->append_node(responseNode);
-        }
-        else
-        {
-          return this;
-        }
-      }
-    }
-    else
+    if (listrc)
     {
       eos_static_warning("msg=\"error opening directory\"");
       SetResponseCode(HttpResponse::BAD_REQUEST);
       return this;
     }
+
+    // the child nodes are built and sent while the response is streamed
+    rapidxml::print(std::back_inserter(mStreamHead), mXMLResponseDocument, rapidxml::print_no_indenting);
+    mXMLResponseDocument.clear();
+    std::string tail = "</d:multistatus>";
+
+    if ((mStreamHead.length() >= tail.length()) &&
+        !mStreamHead.compare(mStreamHead.length() - tail.length(), tail.length(), tail))
+    {
+      mStreamHead.erase(mStreamHead.length() - tail.length());
+    }
+    else if ((mStreamHead.length() >= 2) &&
+             !mStreamHead.compare(mStreamHead.length() - 2, 2, "/>"))
+    {
+      // empty multistatus node
+      mStreamHead.replace(mStreamHead.length() - 2, 2, ">");
+    }
+
+    mStreamUrl = request->GetUrl();
+    mStreamHrefUrl = request->GetUrl(true);
+    mUseBodyCallback = true;
+    SetResponseCode(HttpResponse::MULTI_STATUS);
+    AddHeader("Content-Type", "application/xml; charset=utf-8");
+    return this;
   }
 
   else if (depth == "1,noroot")
@@ -329,29 +321,68 @@ PropFindResponse::ParseRequestPropertyTypes (rapidxml::xml_node<> *node)
   }
 }
 
+/*----------------------------------------------------------------------------*/
+bool
+PropFindResponse::Produce (std::string &body)
+{
+  if (!mStreamHeadSent)
+  {
+    body += mStreamHead;
+    mStreamHead.clear();
+    mStreamHeadSent = true;
+    return true;
+  }
+
+  size_t nnodes = 0;
+
+  while ((mNextEntry < mEntries.size()) && (nnodes < sNodesPerChunk))
+  {
+    const XrdMgmOfs::DirEntryStat &entry = mEntries[mNextEntry++];
+    XrdOucString entryname = entry.name.c_str();
+
+    // don't display atomic(+version) uploads and version directories
+    if (entryname.beginswith(EOS_COMMON_PATH_VERSION_FILE_PREFIX) ||
+        entryname.beginswith(EOS_COMMON_PATH_ATOMIC_FILE_PREFIX) ||
+        entryname.beginswith(EOS_WEBDAV_HIDE_IN_PROPFIND_PREFIX))
+    {
+      continue;
+    }
+
+    // one response node for each file...
+    eos::common::Path path((mStreamUrl + std::string("/") + entry.name).c_str());
+    eos::common::Path refpath((mStreamHrefUrl + std::string("/") + entry.name).c_str());
+    rapidxml::xml_node<> *responseNode = BuildResponseNode(path.GetPath(),
+                                                           refpath.GetPath(),
+                                                           entry.buf,
+                                                           entry.etag);
+    rapidxml::print(std::back_inserter(body), *responseNode, rapidxml::print_no_indenting);
+    nnodes++;
+  }
+
+  // the nodes of this chunk are printed, release their memory
+  mXMLResponseDocument.clear();
+
+  if (mNextEntry < mEntries.size())
+    return true;
+
+  body += "</d:multistatus>";
+  std::vector<XrdMgmOfs::DirEntryStat>().swap(mEntries);
+  return false;
+}
+
 /*----------------------------------------------------------------------------*/
 rapidxml::xml_node<>*
 PropFindResponse::BuildResponseNode (const std::string &url, const std::string &hrefurl)
 {
-  using namespace rapidxml;
-
-  XrdMgmOfsDirectory directory;
   XrdOucErrInfo error;
   struct stat statInfo;
   std::string etag;
-  std::string id;
-
-  bool allpropresponse = false;
 
   XrdOucString urlp = url.c_str();
-  XrdOucString hrefp = hrefurl.c_str();
 
   while (urlp.replace("//", "/"))
   {
   }
-  while (hrefp.replace("//", "/"))
-  {
-  }
 
   // Is the requested resource a file or directory?
   eos_static_debug("url=%s", urlp.c_str());
@@ -365,6 +396,33 @@ PropFindResponse::BuildResponseNode (const std::string &url, const std::string &
   }
   eos_static_debug("url=%s etag=%s", urlp.c_str(), etag.c_str());
 
+  return BuildResponseNode(url, hrefurl, statInfo, etag);
+}
+
+/*----------------------------------------------------------------------------*/
+rapidxml::xml_node<>*
+PropFindResponse::BuildResponseNode (const std::string &url,
+                                     const std::string &hrefurl,
+                                     const struct stat &statInfo,
+                                     const std::string &etag)
+{
+  using namespace rapidxml;
+
+  XrdOucErrInfo error;
+  std::string id;
+
+  bool allpropresponse = false;
+
+  XrdOucString urlp = url.c_str();
+  XrdOucString hrefp = hrefurl.c_str();
+
+  while (urlp.replace("//", "/"))
+  {
+  }
+  while (hrefp.replace("//", "/"))
+  {
+  }
+
   // encode the url's
   urlp = EncodeURI(urlp.c_str()).c_str();
   hrefp = EncodeURI(hrefp.c_str()).c_str();
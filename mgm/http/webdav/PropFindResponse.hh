@@ -36,10 +36,15 @@
 /*----------------------------------------------------------------------------*/
 #include "mgm/http/webdav/WebDAVResponse.hh"
 #include "mgm/Namespace.hh"
+#include "mgm/XrdMgmOfs.hh"
 #include "common/Mapping.hh"
+#include "common/http/StreamedHttpResponse.hh"
 #include "mgm/http/rapidxml/rapidxml.hpp"
 #include "mgm/http/rapidxml/rapidxml_print.hpp"
 /*----------------------------------------------------------------------------*/
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
 
 EOSMGMNAMESPACE_BEGIN;
 
@@ -53,7 +58,8 @@ extern char dav_html5[256];
  */
 extern int dav_uri_decode (char* source, char* dest );
 
-class PropFindResponse : public WebDAVResponse {
+class PropFindResponse : public WebDAVResponse,
+                         public eos::common::HttpBodyStream {
 public:
 
   /**
@@ -82,6 +88,18 @@ protected:
   int mRequestPropertyTypes; //!< properties that were requested
   eos::common::Mapping::VirtualIdentity *mVirtualIdentity; //!< virtual identity for this client
 
+  /**
+   * Depth 1 responses are streamed, the child response nodes are built from
+   * the bulk stat of the directory while the body is sent
+   */
+  static const size_t sNodesPerChunk = 256; //!< child nodes printed per chunk
+  std::vector<XrdMgmOfs::DirEntryStat> mEntries; //!< stat of the children
+  size_t mNextEntry;       //!< next child to print
+  std::string mStreamUrl;      //!< URL of the listed directory
+  std::string mStreamHrefUrl;  //!< href URL of the listed directory
+  std::string mStreamHead;     //!< XML header and the directory response node
+  bool mStreamHeadSent;        //!< true once mStreamHead has been produced
+
 public:
 
   /**
@@ -92,7 +110,7 @@ public:
   PropFindResponse (eos::common::HttpRequest *request,
                     eos::common::Mapping::VirtualIdentity *vid) :
   WebDAVResponse (request), mRequestPropertyTypes (NONE),
-  mVirtualIdentity (vid)
+  mVirtualIdentity (vid), mNextEntry (0), mStreamHeadSent (false)
   {
     static bool initialized = false;
     if (!initialized)
@@ -147,6 +165,37 @@ public:
   rapidxml::xml_node<>*
   BuildResponseNode (const std::string &url, const std::string &hrefurl);
 
+  /**
+   * Build a response XML <response/> node for a resource which has already
+   * been stat'ed.
+   *
+   * @param url       the URL of the resource to build a response node for
+   * @param hrefurl   the URL to put into the href node
+   * @param statInfo  the stat information of the resource
+   * @param etag      the etag of the resource
+   *
+   * @return the newly build response node
+   */
+  rapidxml::xml_node<>*
+  BuildResponseNode (const std::string &url, const std::string &hrefurl,
+                     const struct stat &statInfo, const std::string &etag);
+
+  /**
+   * Append the next child response nodes of a streamed Depth 1 response.
+   *
+   * @param body  the string to append the printed nodes to
+   *
+   * @return false once the multistatus node is closed
+   */
+  bool
+  Produce (std::string &body);
+
+  /**
+   * Read the next block of a streamed response body
+   */
+  ssize_t
+  ReadBody (char *buf, size_t max) { return ReadStream(buf, max); }
+
   /**
    * Convert the given property type string into its integer constant
    * representation.
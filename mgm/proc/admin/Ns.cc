@@ -222,6 +222,12 @@ ProcCommand::Ns ()
      }
    }
 
+   // statistics of the namespace object caches (if any)
+   std::map<std::string, uint64_t> fcache;
+   std::map<std::string, uint64_t> dcache;
+   gOFS->eosFileService->getCacheStatistics(fcache);
+   gOFS->eosDirectoryService->getCacheStatistics(dcache);
+
    double avg = 0;
    double sigma = 0;
 
@@ -256,6 +262,9 @@ ProcCommand::Ns ()
      stdOut += "ALL      Replication                      ";
      gOFS->MgmMaster.PrintOut(stdOut);
      stdOut += "\n";
+     stdOut += "ALL      Changelog Shipping               ";
+     gOFS->MgmMaster.PrintOutShipping(stdOut);
+     stdOut += "\n";
      if (!gOFS->MgmMaster.IsMaster())
      {
        char slatency[1024];
@@ -278,6 +287,28 @@ ProcCommand::Ns ()
      stdOut += "ALL      avg. Dir  Entry Size             ";
      stdOut += cldratio;
      stdOut += "\n";
+     if (fcache.size() || dcache.size())
+     {
+       stdOut += "# ....................................................................................\n";
+       stdOut += "ALL      File Cache                       ";
+       for (auto it = fcache.begin(); it != fcache.end(); ++it)
+       {
+         stdOut += it->first.c_str();
+         stdOut += "=";
+         stdOut += eos::common::StringConversion::GetSizeString(sizestring, (unsigned long long) it->second);
+         stdOut += " ";
+       }
+       stdOut += "\n";
+       stdOut += "ALL      Dir  Cache                       ";
+       for (auto it = dcache.begin(); it != dcache.end(); ++it)
+       {
+         stdOut += it->first.c_str();
+         stdOut += "=";
+         stdOut += eos::common::StringConversion::GetSizeString(sizestring, (unsigned long long) it->second);
+         stdOut += " ";
+       }
+       stdOut += "\n";
+     }
      stdOut += "# ------------------------------------------------------------------------------------\n";
      stdOut += "ALL      memory virtual                   ";
      stdOut += eos::common::StringConversion::GetReadableSizeString(sizestring, (unsigned long long) mem.vmsize, "B");
@@ -351,6 +382,25 @@ ProcCommand::Ns ()
      stdOut += "uid=all gid=all ";
      gOFS->MgmMaster.PrintOut(stdOut);
      stdOut += "\n";
+     stdOut += "uid=all gid=all ";
+     gOFS->MgmMaster.PrintOutShipping(stdOut);
+     stdOut += "\n";
+     for (auto it = fcache.begin(); it != fcache.end(); ++it)
+     {
+       stdOut += "uid=all gid=all ns.cache.files.";
+       stdOut += it->first.c_str();
+       stdOut += "=";
+       stdOut += eos::common::StringConversion::GetSizeString(sizestring, (unsigned long long) it->second);
+       stdOut += "\n";
+     }
+     for (auto it = dcache.begin(); it != dcache.end(); ++it)
+     {
+       stdOut += "uid=all gid=all ns.cache.containers.";
+       stdOut += it->first.c_str();
+       stdOut += "=";
+       stdOut += eos::common::StringConversion::GetSizeString(sizestring, (unsigned long long) it->second);
+       stdOut += "\n";
+     }
      stdOut += "uid=all gid=all ns.memory.virtual=";
      stdOut += eos::common::StringConversion::GetSizeString(sizestring, (unsigned long long) mem.vmsize);
      stdOut += "\n";
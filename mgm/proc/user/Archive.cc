@@ -48,6 +48,67 @@ static const std::string ARCH_DELETE_ERR = ".archive.delete.err";
 static const std::string ARCH_LOG = ".archive.log";
 
 
+//------------------------------------------------------------------------------
+// Read the streamed result of a proc command line by line
+//------------------------------------------------------------------------------
+class ProcResultReader
+{
+public:
+
+  ProcResultReader(ProcCommand* cmd):
+    mCmd(cmd), mOffset(0), mPos(0), mEof(false) {}
+
+  //----------------------------------------------------------------------------
+  //! Get the next line of the result without the trailing newline
+  //!
+  //! @return true if a line was read, false at the end of the result
+  //----------------------------------------------------------------------------
+  bool GetLine(std::string& line)
+  {
+    size_t end;
+
+    while ((end = mPending.find('\n', mPos)) == std::string::npos)
+    {
+      if (mEof)
+      {
+        if (mPos == mPending.length())
+          return false;
+
+        line = mPending.substr(mPos);
+        mPos = mPending.length();
+        return true;
+      }
+
+      mPending.erase(0, mPos);
+      mPos = 0;
+      int nread = mCmd->read(mOffset, mBuff, sizeof(mBuff));
+
+      if (nread > 0)
+      {
+        mPending.append(mBuff, nread);
+        mOffset += nread;
+      }
+
+      if (nread < (int) sizeof(mBuff))
+        mEof = true;
+    }
+
+    line = mPending.substr(mPos, end - mPos);
+    mPos = end + 1;
+    return true;
+  }
+
+private:
+
+  ProcCommand* mCmd; ///< proc command producing the result
+  XrdSfsFileOffset mOffset; ///< offset of the next read
+  std::string mPending; ///< data read but not yet returned
+  size_t mPos; ///< position of the next line in mPending
+  bool mEof; ///< the complete result has been read
+  char mBuff[64 * 1024]; ///< read buffer
+};
+
+
 //------------------------------------------------------------------------------
 // Archive command
 //------------------------------------------------------------------------------
@@ -1106,38 +1167,20 @@ ProcCommand::ArchiveAddEntries(const std::string& arch_dir,
   else
     info += "&mgm.option=dI";
 
+  // Stream the find result instead of keeping it in memory
+  cmd_find->SetStreaming(true);
   cmd_find->open("/proc/user", info.c_str(), *pVid, mError);
-  int ret = cmd_find->close();
-
-  if (ret)
-  {
-    delete cmd_find;
-    eos_err("find fileinfo on directory=%s failed", arch_dir.c_str());
-    stdErr = "error: find fileinfo failed";
-    retc = ret;
-    return retc;
-  }
 
   size_t spos = 0;
   size_t key_length = 0; // lenght of file/dir name - it could have spaces
   std::string rel_path;
   std::string key, value, pair;
   std::istringstream line_iss;
-  std::ifstream result_ifs(cmd_find->GetResultFn());
+  ProcResultReader* result_reader = new ProcResultReader(cmd_find);
   XrdOucString unseal_str;
-
-  if (!result_ifs.good())
-  {
-    delete cmd_find;
-    eos_err("failed to open find fileinfo result file on MGM");
-    stdErr = "failed to open find fileinfo result file on MGM";
-    retc = EIO;
-    return retc;
-  }
-
   char* tmp_buff = new char[4096*4];
 
-  while (std::getline(result_ifs, line))
+  while (result_reader->GetLine(line))
   {
     if (line.find("&mgm.proc.stderr=") == 0)
       continue;
@@ -1192,6 +1235,7 @@ ProcCommand::ArchiveAddEntries(const std::string& arch_dir,
         if ((spos == std::string::npos) || (!line_iss.good()))
         {
           delete[] tmp_buff;
+          delete result_reader;
           delete cmd_find;
           eos_err("malformed xattr pair format");
           stdErr = "malformed xattr pair format";
@@ -1205,6 +1249,7 @@ ProcCommand::ArchiveAddEntries(const std::string& arch_dir,
         if (key != "xattrv")
         {
           delete[] tmp_buff;
+          delete result_reader;
           delete cmd_find;
           eos_err("not found expected xattrv");
           stdErr = "not found expected xattrv";
@@ -1265,7 +1310,18 @@ ProcCommand::ArchiveAddEntries(const std::string& arch_dir,
   }
 
   delete[] tmp_buff;
+  delete result_reader;
+  // The return code is known once the complete result has been read
+  int ret = cmd_find->close();
   delete cmd_find;
+
+  if (ret)
+  {
+    eos_err("find fileinfo on directory=%s failed", arch_dir.c_str());
+    stdErr = "error: find fileinfo failed";
+    retc = ret;
+  }
+
   return retc;
 }
 
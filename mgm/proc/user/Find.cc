@@ -68,9 +68,9 @@ ProcCommand::Find ()
 
   spath = path;
 
-  if (!OpenTemporaryOutputFiles())
+  if (!OpenOutputStreams())
   {
-    stdErr += "error: cannot write find result files on MGM\n";
+    stdErr += "error: cannot create find result streams on MGM\n";
     retc = EIO;
     return SFS_OK;
   }
@@ -400,6 +400,10 @@ ProcCommand::Find ()
     {
       for (foundit = (*found).begin(); foundit != (*found).end(); foundit++)
       {
+        // hold back if a streaming client is lagging behind or stop if it left
+        if (!WaitForClient())
+          break;
+
         if ((option.find("d")) == STR_NPOS)
         {
           if (option.find("f") == STR_NPOS)
@@ -416,6 +420,9 @@ ProcCommand::Find ()
 
         for (fileit = foundit->second.begin(); fileit != foundit->second.end(); fileit++)
         {
+          if (!WaitForClient())
+            break;
+
           cnt++;
           std::string fspath = foundit->first;
           fspath += *fileit;
@@ -870,6 +877,9 @@ ProcCommand::Find ()
     {
       for (foundit = (*found).begin(); foundit != (*found).end(); foundit++)
       {
+        if (!WaitForClient())
+          break;
+
         // eventually call the version purge function if we own this version dir or we are root
 
         if (purge && (foundit->first.find(EOS_COMMON_PATH_VERSION_PREFIX) != std::string::npos))
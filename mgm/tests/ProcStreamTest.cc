@@ -0,0 +1,184 @@
+//------------------------------------------------------------------------------
+// File: ProcStreamTest.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "ProcStreamTest.hh"
+#include "mgm/ProcStream.hh"
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <string>
+#include <pthread.h>
+/*----------------------------------------------------------------------------*/
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ProcStreamTest);
+
+using eos::mgm::ProcStream;
+
+//------------------------------------------------------------------------------
+// Producer writing a string in pieces, waiting for space after each piece as
+// the proc commands do
+//------------------------------------------------------------------------------
+struct Producer
+{
+  ProcStream* mStream;
+  std::string mData;
+  size_t mPiece;
+  bool mStopped; ///< WaitForSpace told the producer to stop
+
+  Producer(): mStream(0), mPiece(1), mStopped(false) {}
+};
+
+static void*
+Produce(void* arg)
+{
+  Producer* p = static_cast<Producer*>(arg);
+
+  for (size_t pos = 0; pos < p->mData.length(); pos += p->mPiece)
+  {
+    p->mStream->Write(p->mData.c_str() + pos,
+                      std::min(p->mPiece, p->mData.length() - pos));
+
+    if (!p->mStream->WaitForSpace())
+    {
+      p->mStopped = true;
+      break;
+    }
+  }
+
+  p->mStream->Close();
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Read a given number of bytes as a string
+//------------------------------------------------------------------------------
+static std::string
+ReadString(ProcStream& stream, size_t len)
+{
+  std::string out(len, '\0');
+  out.resize(stream.Read(&out[0], len));
+  return out;
+}
+
+//------------------------------------------------------------------------------
+// Wrap-around of the ring buffer
+//------------------------------------------------------------------------------
+void
+ProcStreamTest::WrapAroundTest()
+{
+  ProcStream stream(8);
+  CPPUNIT_ASSERT(stream.Write("012345", 6));
+  CPPUNIT_ASSERT_EQUAL(std::string("0123"), ReadString(stream, 4));
+  // 2 bytes at the end of the buffer and 3 at its start
+  CPPUNIT_ASSERT(stream.Write("6789a", 5));
+  CPPUNIT_ASSERT_EQUAL(std::string("456789a"), ReadString(stream, 7));
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 11, stream.GetOffset());
+  // the drained buffer starts over at its beginning
+  CPPUNIT_ASSERT(stream.Write("bcdefgh", 7));
+  stream.Close();
+  CPPUNIT_ASSERT_EQUAL(std::string("bcdefgh"), ReadString(stream, 8));
+  CPPUNIT_ASSERT_EQUAL(std::string(""), ReadString(stream, 8));
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 18, stream.GetOffset());
+}
+
+//------------------------------------------------------------------------------
+// Growing and shrinking of the buffer
+//------------------------------------------------------------------------------
+void
+ProcStreamTest::ResizeTest()
+{
+  ProcStream stream(4);
+  CPPUNIT_ASSERT(stream.Write("abc", 3));
+  CPPUNIT_ASSERT_EQUAL(std::string("ab"), ReadString(stream, 2));
+  // the remaining byte sits in the middle of the buffer when it grows
+  CPPUNIT_ASSERT(stream.Write("defghij", 7));
+  CPPUNIT_ASSERT(stream.Write("kl", 2));
+  CPPUNIT_ASSERT_EQUAL(std::string("cdefghijkl"), ReadString(stream, 10));
+  // drained, the buffer is back at its capacity and wraps around again
+  CPPUNIT_ASSERT(stream.Write("mno", 3));
+  CPPUNIT_ASSERT_EQUAL(std::string("mn"), ReadString(stream, 2));
+  CPPUNIT_ASSERT(stream.Write("pqr", 3));
+  CPPUNIT_ASSERT_EQUAL(std::string("opqr"), ReadString(stream, 4));
+  // growing while the content wraps around keeps the order
+  CPPUNIT_ASSERT(stream.Write("stu", 3));
+  CPPUNIT_ASSERT_EQUAL(std::string("s"), ReadString(stream, 1));
+  CPPUNIT_ASSERT(stream.Write("vwxyz", 5));
+  stream.Close();
+  CPPUNIT_ASSERT_EQUAL(std::string("tuvwxyz"), ReadString(stream, 16));
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 26, stream.GetOffset());
+}
+
+//------------------------------------------------------------------------------
+// Abort while the producer waits for space
+//------------------------------------------------------------------------------
+void
+ProcStreamTest::AbortTest()
+{
+  ProcStream stream(4);
+  Producer producer;
+  producer.mStream = &stream;
+  producer.mData = "0123456789";
+  producer.mPiece = 8;
+  pthread_t tid;
+  CPPUNIT_ASSERT(!pthread_create(&tid, 0, Produce, &producer));
+  // the producer wrote more than the capacity and waits for space
+  CPPUNIT_ASSERT_EQUAL(std::string("0123"), ReadString(stream, 4));
+  stream.Abort();
+  pthread_join(tid, 0);
+  CPPUNIT_ASSERT(producer.mStopped);
+  CPPUNIT_ASSERT(!stream.Write("x", 1));
+  CPPUNIT_ASSERT(!stream.WaitForSpace());
+  CPPUNIT_ASSERT_EQUAL(std::string(""), ReadString(stream, 4));
+}
+
+//------------------------------------------------------------------------------
+// Short reads before the end of the stream
+//------------------------------------------------------------------------------
+void
+ProcStreamTest::ShortReadTest()
+{
+  ProcStream stream(4);
+  Producer producer;
+  producer.mStream = &stream;
+
+  for (int i = 0; i < 100; i++)
+    producer.mData += (char)('a' + (i % 26));
+
+  producer.mPiece = 2;
+  pthread_t tid;
+  CPPUNIT_ASSERT(!pthread_create(&tid, 0, Produce, &producer));
+  // the producer stops at the capacity, the read does not wait for more
+  std::string first = ReadString(stream, 1000);
+  CPPUNIT_ASSERT_EQUAL(std::string("abcd"), first);
+  // reading until 0 as ProcCommand::read does gets the whole stream
+  std::string out = first;
+  char buff[1000];
+  size_t len;
+
+  while ((len = stream.Read(buff, sizeof(buff))))
+    out.append(buff, len);
+
+  pthread_join(tid, 0);
+  CPPUNIT_ASSERT(!producer.mStopped);
+  CPPUNIT_ASSERT_EQUAL(producer.mData, out);
+  CPPUNIT_ASSERT_EQUAL((uint64_t) 100, stream.GetOffset());
+}
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+//! @file ProcStreamTest.hh
+//! @brief Unit tests of the proc command result ring buffer
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#ifndef __EOSMGMTEST_PROCSTREAMTEST_HH__
+#define __EOSMGMTEST_PROCSTREAMTEST_HH__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+//------------------------------------------------------------------------------
+//! Declaration of ProcStreamTest class
+//------------------------------------------------------------------------------
+class ProcStreamTest: public CppUnit::TestCase
+{
+  CPPUNIT_TEST_SUITE(ProcStreamTest);
+    CPPUNIT_TEST(WrapAroundTest);
+    CPPUNIT_TEST(ResizeTest);
+    CPPUNIT_TEST(AbortTest);
+    CPPUNIT_TEST(ShortReadTest);
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  //----------------------------------------------------------------------------
+  //! Data written across the end of the ring buffer is read back in order
+  //----------------------------------------------------------------------------
+  void WrapAroundTest();
+
+  //----------------------------------------------------------------------------
+  //! An entry larger than the free space grows the buffer keeping its content
+  //! and the buffer works as a ring again once it shrank after being drained
+  //----------------------------------------------------------------------------
+  void ResizeTest();
+
+  //----------------------------------------------------------------------------
+  //! Abort releases a producer waiting for space and stops the stream
+  //----------------------------------------------------------------------------
+  void AbortTest();
+
+  //----------------------------------------------------------------------------
+  //! A read larger than the capacity returns less before the end of the
+  //! stream and reading until 0 returns the whole stream, as done by
+  //! ProcCommand::read
+  //----------------------------------------------------------------------------
+  void ShortReadTest();
+};
+
+#endif // __EOSMGMTEST_PROCSTREAMTEST_HH__
@@ -0,0 +1,182 @@
+//------------------------------------------------------------------------------
+// File: QuotaTableTest.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "QuotaTableTest.hh"
+#include "mgm/QuotaTable.hh"
+/*----------------------------------------------------------------------------*/
+#include <atomic>
+#include <map>
+#include <vector>
+#include <pthread.h>
+/*----------------------------------------------------------------------------*/
+
+CPPUNIT_TEST_SUITE_REGISTRATION(QuotaTableTest);
+
+using eos::mgm::QuotaTable;
+
+typedef std::vector< std::pair<unsigned long long, long long> > EntryVector;
+
+//------------------------------------------------------------------------------
+// Quota key of a tag and an id, as used by SpaceQuota
+//------------------------------------------------------------------------------
+static unsigned long long
+Key(unsigned long tag, unsigned long id)
+{
+  return ((unsigned long long) tag << 32) | id;
+}
+
+//------------------------------------------------------------------------------
+// Reader thread checking a fixed set of values while the table grows
+//------------------------------------------------------------------------------
+struct ReaderThread
+{
+  QuotaTable* mTable;
+  std::atomic<bool> mStop;
+  int mErrors;
+
+  ReaderThread(): mTable(0), mStop(false), mErrors(0) {}
+};
+
+static void*
+ReadValues(void* arg)
+{
+  ReaderThread* rt = static_cast<ReaderThread*>(arg);
+
+  while (!rt->mStop)
+  {
+    for (unsigned long id = 0; id < 16; id++)
+    {
+      if (rt->mTable->Get(Key(1, id)) != (long long) id + 1)
+        rt->mErrors++;
+    }
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Growth of the table
+//------------------------------------------------------------------------------
+void
+QuotaTableTest::GrowthTest()
+{
+  QuotaTable table;
+
+  for (unsigned long id = 0; id < 16; id++)
+    table.Set(Key(1, id), id + 1);
+
+  ReaderThread rt;
+  pthread_t tid;
+  rt.mTable = &table;
+  CPPUNIT_ASSERT(!pthread_create(&tid, 0, ReadValues, &rt));
+
+  for (unsigned long id = 0; id < 4096; id++)
+    table.Set(Key(2, id), 2 * id);
+
+  rt.mStop = true;
+  pthread_join(tid, 0);
+  CPPUNIT_ASSERT_EQUAL(0, rt.mErrors);
+
+  for (unsigned long id = 0; id < 16; id++)
+    CPPUNIT_ASSERT_EQUAL((long long) id + 1, table.Get(Key(1, id)));
+
+  for (unsigned long id = 0; id < 4096; id++)
+    CPPUNIT_ASSERT_EQUAL((long long)(2 * id), table.Get(Key(2, id)));
+
+  CPPUNIT_ASSERT_EQUAL(0LL, table.Get(Key(3, 0)));
+  CPPUNIT_ASSERT_EQUAL(0LL, table.Get(Key(2, 4096)));
+}
+
+//------------------------------------------------------------------------------
+// Erasing and setting values again
+//------------------------------------------------------------------------------
+void
+QuotaTableTest::EraseAndSetTest()
+{
+  QuotaTable table;
+  CPPUNIT_ASSERT(!table.Erase(Key(1, 5)));
+  table.Set(Key(1, 5), 100);
+  CPPUNIT_ASSERT(table.Erase(Key(1, 5)));
+  CPPUNIT_ASSERT_EQUAL(0LL, table.Get(Key(1, 5)));
+  CPPUNIT_ASSERT(!table.Erase(Key(1, 5)));
+  table.Set(Key(1, 5), 200);
+  CPPUNIT_ASSERT_EQUAL(200LL, table.Get(Key(1, 5)));
+  // an erased value restarts from 0 when added to
+  CPPUNIT_ASSERT(table.Erase(Key(1, 5)));
+  table.Add(Key(1, 5), 10);
+  CPPUNIT_ASSERT_EQUAL(10LL, table.Get(Key(1, 5)));
+  table.Add(Key(1, 5), -20);
+  CPPUNIT_ASSERT_EQUAL(10LL, table.Get(Key(1, 5)));
+  table.Add(Key(1, 5), -10);
+  CPPUNIT_ASSERT_EQUAL(0LL, table.Get(Key(1, 5)));
+
+  // erasing many values does not prevent the table from growing
+  for (unsigned long id = 0; id < 1000; id++)
+    table.Set(Key(2, id), id);
+
+  for (unsigned long id = 0; id < 1000; id += 2)
+    CPPUNIT_ASSERT(table.Erase(Key(2, id)));
+
+  for (unsigned long id = 0; id < 1000; id++)
+    CPPUNIT_ASSERT_EQUAL((long long)((id % 2) ? id : 0), table.Get(Key(2, id)));
+
+  for (unsigned long id = 0; id < 1000; id += 2)
+    table.Set(Key(2, id), id + 1);
+
+  for (unsigned long id = 0; id < 1000; id++)
+    CPPUNIT_ASSERT_EQUAL((long long)((id % 2) ? id : id + 1),
+                         table.Get(Key(2, id)));
+}
+
+//------------------------------------------------------------------------------
+// Listing of the set values
+//------------------------------------------------------------------------------
+void
+QuotaTableTest::GetEntriesTest()
+{
+  QuotaTable table;
+  EntryVector entries;
+  table.GetEntries(entries);
+  CPPUNIT_ASSERT(entries.empty());
+  std::map<unsigned long long, long long> expected;
+
+  for (unsigned long id = 0; id < 600; id++)
+  {
+    table.Set(Key(3, id), id * 3);
+    expected[Key(3, id)] = id * 3;
+  }
+
+  for (unsigned long id = 0; id < 600; id += 3)
+  {
+    table.Erase(Key(3, id));
+    expected.erase(Key(3, id));
+  }
+
+  table.Set(Key(3, 0), 7);
+  expected[Key(3, 0)] = 7;
+  table.GetEntries(entries);
+  CPPUNIT_ASSERT_EQUAL(expected.size(), entries.size());
+  std::map<unsigned long long, long long> listed(entries.begin(), entries.end());
+  CPPUNIT_ASSERT_EQUAL(entries.size(), listed.size());
+  CPPUNIT_ASSERT(listed == expected);
+}
@@ -0,0 +1,57 @@
+//------------------------------------------------------------------------------
+//! @file QuotaTableTest.hh
+//! @brief Unit tests of the lock-free quota table
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#ifndef __EOSMGMTEST_QUOTATABLETEST_HH__
+#define __EOSMGMTEST_QUOTATABLETEST_HH__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+//------------------------------------------------------------------------------
+//! Declaration of QuotaTableTest class
+//------------------------------------------------------------------------------
+class QuotaTableTest: public CppUnit::TestCase
+{
+  CPPUNIT_TEST_SUITE(QuotaTableTest);
+    CPPUNIT_TEST(GrowthTest);
+    CPPUNIT_TEST(EraseAndSetTest);
+    CPPUNIT_TEST(GetEntriesTest);
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  //----------------------------------------------------------------------------
+  //! The table grows past its initial 256 slots without losing values, also
+  //! for concurrent readers
+  //----------------------------------------------------------------------------
+  void GrowthTest();
+
+  //----------------------------------------------------------------------------
+  //! An unset value reads as 0 and can be set again, Add never goes below 0
+  //----------------------------------------------------------------------------
+  void EraseAndSetTest();
+
+  //----------------------------------------------------------------------------
+  //! GetEntries lists exactly the set values
+  //----------------------------------------------------------------------------
+  void GetEntriesTest();
+};
+
+#endif // __EOSMGMTEST_QUOTATABLETEST_HH__
@@ -66,6 +66,21 @@ class IChLogFileMDSvc
   //----------------------------------------------------------------------------
   virtual void compact(void*& compactingData) = 0;
 
+  //----------------------------------------------------------------------------
+  //! Copy the records appended to the log since the last catch up (or since
+  //! compactPrepare) to the compacted log.
+  //!
+  //! Like compact this does not access any of the in-memory structures, it
+  //! may be called repeatedly to shrink the part of the log compactCommit
+  //! has to replay under the exclusive lock.
+  //!
+  //! @param  compactingData state information returned by compactPrepare
+  //! @param  autorepair     skip broken records like compactCommit
+  //! @return                number of bytes of the log caught up
+  //----------------------------------------------------------------------------
+  virtual uint64_t compactCatchUp(void*& compactingData,
+                                  bool autorepair = false) = 0;
+
   //----------------------------------------------------------------------------
   //! Prepare for online compacting.
   //!
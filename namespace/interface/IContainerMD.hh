@@ -33,6 +33,7 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 #include <sys/time.h>
 
 EOSNSNAMESPACE_BEGIN
@@ -42,6 +43,54 @@ class IContainerMDSvc;
 class IFileMDSvc;
 class IFileMD;
 
+//------------------------------------------------------------------------------
+//! Interface for a visitor of the names of the children of a container
+//------------------------------------------------------------------------------
+class IContainerNameVisitor
+{
+ public:
+  virtual ~IContainerNameVisitor() {}
+
+  //----------------------------------------------------------------------------
+  //! Visit the next name
+  //!
+  //! @return true to go on with the following name, false to stop
+  //----------------------------------------------------------------------------
+  virtual bool visitName(const std::string& name) = 0;
+};
+
+//------------------------------------------------------------------------------
+//! Visitor collecting up to a given number of names, used to copy a directory
+//! listing in batches instead of in one go
+//------------------------------------------------------------------------------
+class ContainerNameBatch: public IContainerNameVisitor
+{
+ public:
+  ContainerNameBatch(size_t max): pMax(max) {}
+
+  bool visitName(const std::string& name)
+  {
+    pNames.push_back(name);
+    return pNames.size() < pMax;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Check if the batch is full i.e. there may be more names after it
+  //----------------------------------------------------------------------------
+  bool isFull() const
+  {
+    return pNames.size() >= pMax;
+  }
+
+  std::vector<std::string>& getNames()
+  {
+    return pNames;
+  }
+
+ private:
+  size_t pMax;
+  std::vector<std::string> pNames;
+};
 
 //------------------------------------------------------------------------------
 //! Class holding the interface to the metadata information concerning a
@@ -318,6 +367,27 @@ class IContainerMD
   //----------------------------------------------------------------------------
   virtual std::set<std::string> getNameContainers() const = 0;
 
+  //----------------------------------------------------------------------------
+  //! Visit the file names in lexicographical order without copying them
+  //!
+  //! @param visitor visitor called for each name until it returns false
+  //! @param after the iteration starts with the first name following this
+  //!        one, an empty string starts with the first name
+  //----------------------------------------------------------------------------
+  virtual void visitNameFiles(IContainerNameVisitor* visitor,
+                              const std::string& after = "") const = 0;
+
+  //----------------------------------------------------------------------------
+  //! Visit the subcontainer names in lexicographical order without copying
+  //! them
+  //!
+  //! @param visitor visitor called for each name until it returns false
+  //! @param after the iteration starts with the first name following this
+  //!        one, an empty string starts with the first name
+  //----------------------------------------------------------------------------
+  virtual void visitNameContainers(IContainerNameVisitor* visitor,
+                                   const std::string& after = "") const = 0;
+
  private:
 
   //----------------------------------------------------------------------------
@@ -150,6 +150,15 @@ class IContainerMDSvc
   //---------------------------------------------------------------------------
   virtual void
   setContainerAccounting (IFileMDChangeListener* containerAccounting) = 0;
+
+  //----------------------------------------------------------------------------
+  //! Get statistics of the metadata object cache. Implementations without an
+  //! object cache leave the map untouched.
+  //!
+  //! @param stats map filled with counter names and values
+  //----------------------------------------------------------------------------
+  virtual void
+  getCacheStatistics(std::map<std::string, uint64_t>& /*stats*/) {}
 };
 
 EOSNSNAMESPACE_END
@@ -197,6 +197,15 @@ class IFileMDSvc
   //! Visit all the files
   //------------------------------------------------------------------------
   virtual void visit( IFileVisitor *visitor ) = 0;
+
+  //----------------------------------------------------------------------------
+  //! Get statistics of the metadata object cache. Implementations without an
+  //! object cache leave the map untouched.
+  //!
+  //! @param stats map filled with counter names and values
+  //----------------------------------------------------------------------------
+  virtual void
+  getCacheStatistics(std::map<std::string, uint64_t>& /*stats*/) {}
 };
 
 EOSNSNAMESPACE_END
@@ -0,0 +1,217 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @brief Sorted index of the children names of a container
+//------------------------------------------------------------------------------
+
+#include "namespace/ns_in_memory/ChildIndex.hh"
+#include <algorithm>
+
+//! Maximum number of names in a chunk, a full chunk is split in two
+#define EOS_NS_CHILD_INDEX_CHUNK 512
+
+EOSNSNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+ChildIndex::ChildIndex():
+  pSize(0)
+{
+}
+
+//------------------------------------------------------------------------------
+// Find the chunk which holds or would hold a name
+//------------------------------------------------------------------------------
+size_t
+ChildIndex::findChunk(const std::string& name) const
+{
+  size_t lo = 0;
+  size_t hi = pChunks.size();
+
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+
+    if (pChunks[mid].back() < name)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+//------------------------------------------------------------------------------
+// Add a name
+//------------------------------------------------------------------------------
+void
+ChildIndex::insert(const std::string& name)
+{
+  if (pChunks.empty())
+  {
+    pChunks.push_back(Chunk(1, name));
+    pSize = 1;
+    return;
+  }
+
+  // A name after the last one goes to the last chunk
+  size_t idx = std::min(findChunk(name), pChunks.size() - 1);
+  Chunk& chunk = pChunks[idx];
+  Chunk::iterator it = std::lower_bound(chunk.begin(), chunk.end(), name);
+
+  if (it != chunk.end() && *it == name)
+    return;
+
+  chunk.insert(it, name);
+  ++pSize;
+
+  if (chunk.size() > EOS_NS_CHILD_INDEX_CHUNK)
+  {
+    Chunk upper(chunk.begin() + chunk.size() / 2, chunk.end());
+    chunk.resize(chunk.size() / 2);
+    pChunks.insert(pChunks.begin() + idx + 1, Chunk());
+    pChunks[idx + 1].swap(upper);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Remove a name
+//------------------------------------------------------------------------------
+void
+ChildIndex::erase(const std::string& name)
+{
+  size_t idx = findChunk(name);
+
+  if (idx == pChunks.size())
+    return;
+
+  Chunk& chunk = pChunks[idx];
+  Chunk::iterator it = std::lower_bound(chunk.begin(), chunk.end(), name);
+
+  if (it == chunk.end() || *it != name)
+    return;
+
+  chunk.erase(it);
+  --pSize;
+
+  if (chunk.empty())
+  {
+    pChunks.erase(pChunks.begin() + idx);
+    return;
+  }
+
+  // Merge small neighbours so that deletions don't leave many tiny chunks
+  if ((idx + 1 < pChunks.size()) &&
+      (chunk.size() + pChunks[idx + 1].size() <= EOS_NS_CHILD_INDEX_CHUNK / 2))
+  {
+    Chunk& next = pChunks[idx + 1];
+    chunk.insert(chunk.end(), next.begin(), next.end());
+    pChunks.erase(pChunks.begin() + idx + 1);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Remove all the names
+//------------------------------------------------------------------------------
+void
+ChildIndex::clear()
+{
+  std::vector<Chunk>().swap(pChunks);
+  pSize = 0;
+}
+
+//------------------------------------------------------------------------------
+// Visit the names in order
+//------------------------------------------------------------------------------
+void
+ChildIndex::visit(IContainerNameVisitor* visitor,
+                  const std::string& after) const
+{
+  size_t idx = 0;
+  Chunk::const_iterator it;
+
+  if (after.empty())
+  {
+    if (pChunks.empty())
+      return;
+
+    it = pChunks[0].begin();
+  }
+  else
+  {
+    // First chunk holding a name greater than after
+    size_t hi = pChunks.size();
+
+    while (idx < hi)
+    {
+      size_t mid = (idx + hi) / 2;
+
+      if (pChunks[mid].back() <= after)
+        idx = mid + 1;
+      else
+        hi = mid;
+    }
+
+    if (idx == pChunks.size())
+      return;
+
+    it = std::upper_bound(pChunks[idx].begin(), pChunks[idx].end(), after);
+  }
+
+  for (; idx < pChunks.size(); ++idx)
+  {
+    for (; it != pChunks[idx].end(); ++it)
+    {
+      if (!visitor->visitName(*it))
+        return;
+    }
+
+    if (idx + 1 < pChunks.size())
+      it = pChunks[idx + 1].begin();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Get the memory used by the index
+//------------------------------------------------------------------------------
+size_t
+ChildIndex::getMemoryUsage() const
+{
+  size_t size = sizeof(*this) + pChunks.capacity() * sizeof(Chunk);
+
+  for (auto chunk = pChunks.begin(); chunk != pChunks.end(); ++chunk)
+  {
+    size += chunk->capacity() * sizeof(std::string);
+
+    for (auto it = chunk->begin(); it != chunk->end(); ++it)
+    {
+      // Short strings live inside the object itself
+      const char* data = it->data();
+      const char* obj = reinterpret_cast<const char*>(&*it);
+
+      if (data < obj || data >= obj + sizeof(std::string))
+        size += it->capacity() + 1;
+    }
+  }
+
+  return size;
+}
+
+EOSNSNAMESPACE_END
@@ -0,0 +1,101 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @brief Sorted index of the children names of a container
+//------------------------------------------------------------------------------
+
+#ifndef EOS_NS_CHILD_INDEX_HH
+#define EOS_NS_CHILD_INDEX_HH
+
+#include "namespace/Namespace.hh"
+#include "namespace/interface/IContainerMD.hh"
+#include <string>
+#include <vector>
+
+EOSNSNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Names of the children of a large container kept in lexicographical order
+//! next to the hash map used for the lookups. The names are stored in sorted
+//! chunks of bounded size, so an insertion or a removal moves at most one
+//! chunk and a listing can resume from any name with a binary search instead
+//! of sorting the whole container.
+//------------------------------------------------------------------------------
+class ChildIndex
+{
+ public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  ChildIndex();
+
+  //----------------------------------------------------------------------------
+  //! Add a name, nothing happens if it is already there
+  //----------------------------------------------------------------------------
+  void insert(const std::string& name);
+
+  //----------------------------------------------------------------------------
+  //! Remove a name, nothing happens if it is not there
+  //----------------------------------------------------------------------------
+  void erase(const std::string& name);
+
+  //----------------------------------------------------------------------------
+  //! Remove all the names
+  //----------------------------------------------------------------------------
+  void clear();
+
+  //----------------------------------------------------------------------------
+  //! Get number of names
+  //----------------------------------------------------------------------------
+  size_t size() const
+  {
+    return pSize;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Visit the names in order
+  //!
+  //! @param visitor visitor called for each name until it returns false
+  //! @param after the iteration starts with the first name following this
+  //!        one, an empty string starts with the first name
+  //----------------------------------------------------------------------------
+  void visit(IContainerNameVisitor* visitor, const std::string& after) const;
+
+  //----------------------------------------------------------------------------
+  //! Get the memory used by the index in bytes. Strings sharing their buffer
+  //! with the hash map keys are counted as well, so this is an upper bound.
+  //----------------------------------------------------------------------------
+  size_t getMemoryUsage() const;
+
+ private:
+  typedef std::vector<std::string> Chunk;
+
+  //----------------------------------------------------------------------------
+  //! Get the index of the first chunk whose last name is not less than the
+  //! given one, or the number of chunks if there is none
+  //----------------------------------------------------------------------------
+  size_t findChunk(const std::string& name) const;
+
+  std::vector<Chunk> pChunks;
+  size_t             pSize;
+};
+
+EOSNSNAMESPACE_END
+
+#endif // EOS_NS_CHILD_INDEX_HH
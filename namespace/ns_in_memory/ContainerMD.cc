@@ -26,16 +26,117 @@
 #include "namespace/interface/IContainerMDSvc.hh"
 #include "namespace/interface/IFileMDSvc.hh"
 #include <sys/stat.h>
+#include <algorithm>
 
 EOSNSNAMESPACE_BEGIN
 
+//------------------------------------------------------------------------------
+// Containers with at least this many files or subcontainers keep their names
+// sorted, smaller ones sort them when they are listed
+//------------------------------------------------------------------------------
+size_t ContainerMD::sChildIndexMin = 10000;
+
+//------------------------------------------------------------------------------
+// Compare the names pointed to
+//------------------------------------------------------------------------------
+static bool
+lessName(const std::string* a, const std::string* b)
+{
+  return *a < *b;
+}
+
+//------------------------------------------------------------------------------
+// Visit the keys of a children map in order, using the index if there is one
+//------------------------------------------------------------------------------
+template <typename Map>
+static void
+visitNames(const Map& map, const ChildIndex* index,
+           IContainerNameVisitor* visitor, const std::string& after)
+{
+  if (index)
+  {
+    index->visit(visitor, after);
+    return;
+  }
+
+  std::vector<const std::string*> names;
+  names.reserve(map.size());
+
+  for (auto it = map.begin(); it != map.end(); ++it)
+  {
+    if (after.empty() || (it->first > after))
+      names.push_back(&it->first);
+  }
+
+  std::sort(names.begin(), names.end(), lessName);
+
+  for (auto it = names.begin(); it != names.end(); ++it)
+  {
+    if (!visitor->visitName(**it))
+      return;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Update the index after a name was added to a children map, the index is
+// built once the map is large enough
+//------------------------------------------------------------------------------
+template <typename Map>
+static void
+indexAdded(ChildIndex*& index, const Map& map, const std::string& name,
+           size_t min)
+{
+  if (index)
+  {
+    index->insert(name);
+    return;
+  }
+
+  if (!min || (map.size() < min))
+    return;
+
+  std::vector<const std::string*> names;
+  names.reserve(map.size());
+
+  for (auto it = map.begin(); it != map.end(); ++it)
+    names.push_back(&it->first);
+
+  std::sort(names.begin(), names.end(), lessName);
+  index = new ChildIndex();
+
+  for (auto it = names.begin(); it != names.end(); ++it)
+    index->insert(**it);
+}
+
+//------------------------------------------------------------------------------
+// Update the index after a name was removed from a children map, the index is
+// dropped once the map is small enough
+//------------------------------------------------------------------------------
+template <typename Map>
+static void
+indexRemoved(ChildIndex*& index, const Map& map, const std::string& name,
+             size_t min)
+{
+  if (!index)
+    return;
+
+  if (!min || (map.size() < min / 2))
+  {
+    delete index;
+    index = 0;
+    return;
+  }
+
+  index->erase(name);
+}
+
 //------------------------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------------------------
 ContainerMD::ContainerMD(id_t id, IFileMDSvc* file_svc, IContainerMDSvc* cont_svc):
   IContainerMD(), pId(id), pParentId(0), pFlags(0), pName(""), pCUid(0),
   pCGid(0), pMode(040755), pACLId(0), pTreeSize(0), pFileSvc(file_svc),
-  pContSvc(cont_svc)
+  pContSvc(cont_svc), pFileIndex(0), pContainerIndex(0)
 {
   pCTime.tv_sec = 0;
   pCTime.tv_nsec = 0;
@@ -56,6 +157,8 @@ ContainerMD::~ContainerMD()
 {
   pFiles.clear();
   pSubContainers.clear();
+  delete pFileIndex;
+  delete pContainerIndex;
 }
 
 //------------------------------------------------------------------------------
@@ -70,7 +173,8 @@ ContainerMD::clone() const
 //------------------------------------------------------------------------------
 // Copy constructor
 //------------------------------------------------------------------------------
-ContainerMD::ContainerMD(const ContainerMD& other)
+ContainerMD::ContainerMD(const ContainerMD& other):
+  pFileIndex(0), pContainerIndex(0)
 {
   *this = other;
 }
@@ -117,6 +221,7 @@ void
 ContainerMD::removeContainer(const std::string& name)
 {
   pSubContainers.erase(name);
+  indexRemoved(pContainerIndex, pSubContainers, name, sChildIndexMin);
 }
 
 //------------------------------------------------------------------------------
@@ -127,6 +232,8 @@ ContainerMD::addContainer(IContainerMD* container)
 {
   container->setParentId(pId);
   pSubContainers[container->getName()] = container->getId();
+  indexAdded(pContainerIndex, pSubContainers, container->getName(),
+             sChildIndexMin);
 }
 
 //------------------------------------------------------------------------------
@@ -151,6 +258,7 @@ ContainerMD::addFile(IFileMD* file)
 {
   file->setContainerId(pId);
   pFiles[file->getName()] = file->getId();
+  indexAdded(pFileIndex, pFiles, file->getName(), sChildIndexMin);
   IFileMDChangeListener::Event e(file, IFileMDChangeListener::SizeChange,
 				 0,0, file->getSize() );
   file->getFileMDSvc()->notifyListeners( &e );
@@ -169,6 +277,7 @@ ContainerMD::removeFile(const std::string& name)
 				   0, 0, -file->getSize() );
     file->getFileMDSvc()->notifyListeners( &e );
     pFiles.erase( name );
+    indexRemoved(pFileIndex, pFiles, name, sChildIndexMin);
   }
 }
 
@@ -419,6 +528,43 @@ ContainerMD::getNameContainers() const
   return dnames;
 }
 
+//------------------------------------------------------------------------------
+// Visit the file names in lexicographical order
+//------------------------------------------------------------------------------
+void
+ContainerMD::visitNameFiles(IContainerNameVisitor* visitor,
+                            const std::string& after) const
+{
+  visitNames(pFiles, pFileIndex, visitor, after);
+}
+
+//------------------------------------------------------------------------------
+// Visit the subcontainer names in lexicographical order
+//------------------------------------------------------------------------------
+void
+ContainerMD::visitNameContainers(IContainerNameVisitor* visitor,
+                                 const std::string& after) const
+{
+  visitNames(pSubContainers, pContainerIndex, visitor, after);
+}
+
+//------------------------------------------------------------------------------
+// Get the memory used by the sorted indices of the children
+//------------------------------------------------------------------------------
+size_t
+ContainerMD::getChildIndexMemory() const
+{
+  size_t size = 0;
+
+  if (pFileIndex)
+    size += pFileIndex->getMemoryUsage();
+
+  if (pContainerIndex)
+    size += pContainerIndex->getMemoryUsage();
+
+  return size;
+}
+
 //------------------------------------------------------------------------------
 // Set modification time
 //------------------------------------------------------------------------------
@@ -27,6 +27,7 @@
 #include "namespace/Namespace.hh"
 #include "namespace/interface/IContainerMD.hh"
 #include "namespace/interface/IFileMD.hh"
+#include "namespace/ns_in_memory/ChildIndex.hh"
 #include <stdint.h>
 #include <unistd.h>
 #include <cstring>
@@ -481,6 +482,36 @@ class ContainerMD: public IContainerMD
   //----------------------------------------------------------------------------
   std::set<std::string> getNameContainers() const;
 
+  //----------------------------------------------------------------------------
+  //! Visit the file names in lexicographical order without copying them
+  //----------------------------------------------------------------------------
+  void visitNameFiles(IContainerNameVisitor* visitor,
+                      const std::string& after = "") const;
+
+  //----------------------------------------------------------------------------
+  //! Visit the subcontainer names in lexicographical order without copying
+  //! them
+  //----------------------------------------------------------------------------
+  void visitNameContainers(IContainerNameVisitor* visitor,
+                           const std::string& after = "") const;
+
+  //----------------------------------------------------------------------------
+  //! Get the memory used by the sorted indices of the children in bytes, 0 if
+  //! the container is too small to have them
+  //----------------------------------------------------------------------------
+  size_t getChildIndexMemory() const;
+
+  //----------------------------------------------------------------------------
+  //! Set the number of files or subcontainers from which the names are kept
+  //! in a sorted index, so that listing them doesn't need to sort them every
+  //! time. The index is dropped when the number falls below half of it. 0
+  //! disables the indices.
+  //----------------------------------------------------------------------------
+  static void setChildIndexMin(size_t min)
+  {
+    sChildIndexMin = min;
+  }
+
   //----------------------------------------------------------------------------
   //! Serialize the object to a buffer
   //----------------------------------------------------------------------------
@@ -513,6 +544,9 @@ class ContainerMD: public IContainerMD
 
   IFileMDSvc* pFileSvc; ///< File metadata service
   IContainerMDSvc* pContSvc; ///< Container metadata service
+  ChildIndex* pFileIndex; ///< Sorted file names of a large container
+  ChildIndex* pContainerIndex; ///< Sorted subcontainer names of a large container
+  static size_t sChildIndexMin; ///< Number of children from which they are indexed
 };
 
 EOSNSNAMESPACE_END
@@ -458,7 +458,8 @@ namespace
     eos::ChangeLogFile *newLog;
     eos::ChangeLogFile *originalLog;
     std::vector<ContainerRecordData> records;
-    uint64_t newRecord;
+    uint64_t newRecord; // first record not copied yet
+    std::map<eos::IContainerMD::id_t, ContainerRecordData> updates;
   };
 
   //----------------------------------------------------------------------------
@@ -733,6 +734,11 @@ namespace eos
     it = config.find( "auto_repair" );
     if (it != config.end() && it->second == "true" )
       pAutoRepair = true;
+
+    // Number of children from which a container keeps their names sorted
+    it = config.find( "child_index_min" );
+    if ( it != config.end() )
+      ContainerMD::setChildIndexMin( strtoull( it->second.c_str(), 0, 10 ) );
   }
 
   //----------------------------------------------------------------------------
@@ -901,6 +907,41 @@ namespace eos
     }
   }
 
+  //----------------------------------------------------------------------------
+  // Copy the records appended since the last catch up to the new log
+  //----------------------------------------------------------------------------
+  uint64_t
+  ChangeLogContainerMDSvc::compactCatchUp (void *&compactingData,
+                                           bool autorepair)
+  {
+    ::ContainerCompactingData *data = (::ContainerCompactingData*)compactingData;
+    if (!data)
+    {
+      MDException e(EINVAL);
+      e.getMessage() << "Compacting data incorrect";
+      throw e;
+    }
+
+    // The log is being appended, the scan stops before a record that is
+    // still being written
+    uint64_t start = data->newRecord;
+    try
+    {
+      ::ContainerUpdateHandler updateHandler(data->updates, data->newLog);
+      data->newRecord =
+        data->originalLog->scanAllRecordsAtOffset(&updateHandler, start,
+                                                  autorepair, true);
+    }
+    catch (MDException &e)
+    {
+      data->newLog->close();
+      delete data;
+      compactingData = 0;
+      throw;
+    }
+    return data->newRecord - start;
+  }
+
   //----------------------------------------------------------------------------
   // Commit the compacting information.
   //----------------------------------------------------------------------------
@@ -916,8 +957,9 @@ namespace eos
     }
 
     // Copy the part of the old log that has been appended after we
-    // prepared
-    std::map<eos::IContainerMD::id_t, ContainerRecordData> updates;
+    // prepared or caught up the last time
+    std::map<eos::IContainerMD::id_t, ContainerRecordData> &updates =
+      data->updates;
     try
     {
       ::ContainerUpdateHandler updateHandler(updates, data->newLog);
@@ -165,6 +165,16 @@ public:
   //--------------------------------------------------------------------------
   void compact(void*& compactingData);
 
+  //--------------------------------------------------------------------------
+  //! Copy the records appended to the log since the last catch up to the
+  //! compacted log. Does not access the in-memory structures.
+  //!
+  //! @param  compactingData state information returned by compactPrepare
+  //! @param  autorepair     skip broken records like compactCommit
+  //! @return                number of bytes of the log caught up
+  //--------------------------------------------------------------------------
+  uint64_t compactCatchUp(void*& compactingData, bool autorepair = false);
+
   //--------------------------------------------------------------------------
   //! Commit the compacting infomrmation.
   //!
@@ -499,7 +499,8 @@ namespace eos
   //----------------------------------------------------------------------------
   uint64_t ChangeLogFile::scanAllRecordsAtOffset( ILogRecordScanner *scanner,
                                                   uint64_t           startOffset,
-						  bool               autorepair )
+						  bool               autorepair,
+						  bool               appending )
   {
     if( !pIsOpen )
     {
@@ -509,26 +510,19 @@ namespace eos
     }
 
     //--------------------------------------------------------------------------
-    // Get the offset information
+    // Get the offset information - the records are read with pread, the file
+    // offset used by storeRecord is left alone
     //--------------------------------------------------------------------------
-    off_t end = ::lseek( pFd, 0, SEEK_END );
-    if( end == -1 )
+    struct stat st;
+    if( ::fstat( pFd, &st ) )
     {
       MDException ex( EFAULT );
       ex.getMessage() << "Scan: Unable to find the end of the log file: ";
       ex.getMessage() << strerror( errno );
       throw ex;
     }
-
-    off_t offset = ::lseek( pFd, startOffset, SEEK_SET );
-    if( offset != (off_t)startOffset )
-    {
-      MDException ex( EFAULT );
-      ex.getMessage() << "Scan: Unable to find the record data at offset 0x";
-      ex.getMessage() << std::setbase(16) << startOffset << "; ";
-      ex.getMessage() << strerror( errno );
-      throw ex;
-    }
+    off_t end    = st.st_size;
+    off_t offset = startOffset;
 
     //--------------------------------------------------------------------------
     // Read all the records
@@ -560,6 +554,16 @@ namespace eos
 	readerror = true;
       }
 
+      if( readerror && appending )
+      {
+	// a record still being written at the end is not a corruption
+	uint16_t header[2];
+	if( offset + 24 > end ||
+	    (::pread( pFd, header, 4, offset ) == 4 &&
+	     header[0] == RECORD_MAGIC && offset + 24 + header[1] > end) )
+	  break;
+      }
+
       if( readerror ) 
       {
 	if (autorepair) {
@@ -613,7 +617,8 @@ namespace eos
 
       now = time(0);
 
-      if ( (100.0 * offset / end ) > progress) {
+      // a log being appended is scanned in short rounds, no need to report
+      if ( !appending && (100.0 * offset / end ) > progress) {
 	double estimate = (1+end-offset) / ((1.0*offset/(now+1 - start_time)));
 	if (progress==0)
 	  fprintf(stderr,"PROGRESS [ scan %-64s ] %02u%% estimate none \n", fname.c_str(), (unsigned int)progress);
@@ -624,7 +629,8 @@ namespace eos
       }      
     }
     now = time(0);
-    fprintf(stderr,"ALERT    [ %-64s ] finished in %ds\n", fname.c_str(), (int)(now - start_time));
+    if (!appending)
+      fprintf(stderr,"ALERT    [ %-64s ] finished in %ds\n", fname.c_str(), (int)(now - start_time));
 
     return offset;
   }
@@ -195,11 +195,15 @@ namespace eos
       //! Scan all the records in the changelog file starting from a given
       //! offset
       //!
+      //! @param appending the log is being appended - stop before a record
+      //!                  that is not completely written yet instead of
+      //!                  reporting a corruption
       //! @return offset of the record following the last scanned record
       //------------------------------------------------------------------------
       uint64_t scanAllRecordsAtOffset( ILogRecordScanner *scanner,
                                        uint64_t           startOffset,
-                                       bool               autorepair=false );
+                                       bool               autorepair=false,
+                                       bool               appending=false );
 
       //------------------------------------------------------------------------
       //! Follow the new records in a file starting at a given offset and
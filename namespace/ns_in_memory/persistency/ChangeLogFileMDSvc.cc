@@ -575,7 +575,8 @@ struct CompactingData
   eos::ChangeLogFile*      newLog;
   eos::ChangeLogFile*      originalLog;
   std::vector<RecordData>  records;
-  uint64_t                 newRecord;
+  uint64_t                 newRecord; // first record not copied yet
+  std::map<eos::IFileMD::id_t, RecordData> updates;
 };
 
 //------------------------------------------------------------------------------
@@ -1124,6 +1125,44 @@ void ChangeLogFileMDSvc::compact(void*& compactingData)
   }
 }
 
+//------------------------------------------------------------------------------
+// Copy the records appended since the last catch up to the new log
+//------------------------------------------------------------------------------
+uint64_t ChangeLogFileMDSvc::compactCatchUp(void*& compactingData,
+                                            bool autorepair)
+{
+  ::CompactingData* data = (::CompactingData*)compactingData;
+
+  if (!data)
+  {
+    MDException e(EINVAL);
+    e.getMessage() << "Compacting data incorrect" ;
+    throw e;
+  }
+
+  // The log is being appended, the scan stops before a record that is still
+  // being written
+  uint64_t start = data->newRecord;
+
+  try
+  {
+    ::UpdateHandler updateHandler(data->updates, data->newLog);
+    data->newRecord = data->originalLog->scanAllRecordsAtOffset(&updateHandler,
+                                                                start,
+                                                                autorepair,
+                                                                true);
+  }
+  catch (MDException& e)
+  {
+    data->newLog->close();
+    delete data;
+    compactingData = 0;
+    throw;
+  }
+
+  return data->newRecord - start;
+}
+
 //------------------------------------------------------------------------------
 // Commit the compacting information.
 //------------------------------------------------------------------------------
@@ -1140,9 +1179,9 @@ void ChangeLogFileMDSvc::compactCommit(void* compactingData, bool autorepair)
 
   //--------------------------------------------------------------------------
   // Copy the part of the old log that has been appended after we
-  // prepared
+  // prepared or caught up the last time
   //--------------------------------------------------------------------------
-  std::map<eos::IFileMD::id_t, RecordData> updates;
+  std::map<eos::IFileMD::id_t, RecordData>& updates = data->updates;
 
   try
   {
@@ -25,6 +25,8 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
 #include <sstream>
 #include <vector>
 #include <algorithm>
@@ -50,12 +52,14 @@ class HierarchicalViewTest: public CppUnit::TestCase
     CPPUNIT_TEST(quotaTest);
     CPPUNIT_TEST(lostContainerTest);
     CPPUNIT_TEST(onlineCompactingTest);
+    CPPUNIT_TEST(onlineCompactingCatchUpTest);
     CPPUNIT_TEST_SUITE_END();
 
     void reloadTest();
     void quotaTest();
     void lostContainerTest();
     void onlineCompactingTest();
+    void onlineCompactingCatchUpTest();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(HierarchicalViewTest);
@@ -839,3 +843,140 @@ void HierarchicalViewTest::onlineCompactingTest()
   unlink(fileNameContMD.c_str());
   unlink(newFileLogName.c_str());
 }
+
+//------------------------------------------------------------------------------
+// File creation thread
+//------------------------------------------------------------------------------
+struct CreateData
+{
+  CreateData(): first(0), last(0), done(false) {}
+  std::shared_ptr<eos::IView> view;
+  int                         first;
+  int                         last;
+  volatile bool               done;
+};
+
+void* createThread(void* arg)
+{
+  CreateData* cd = (CreateData*)arg;
+
+  for (int i = cd->first; i < cd->last; ++i)
+  {
+    std::ostringstream s;
+    s << "/test/file" << i;
+    cd->view->createFile(s.str());
+  }
+
+  cd->done = true;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Online compacting catching up with a log being appended and containing a
+// broken record
+//------------------------------------------------------------------------------
+void HierarchicalViewTest::onlineCompactingCatchUpTest()
+{
+  //----------------------------------------------------------------------------
+  // Initializer
+  //----------------------------------------------------------------------------
+  std::shared_ptr<eos::IContainerMDSvc> contSvc =
+    std::shared_ptr<eos::IContainerMDSvc>(new eos::ChangeLogContainerMDSvc());
+  std::shared_ptr<eos::IFileMDSvc> fileSvc =
+    std::shared_ptr<eos::IFileMDSvc>(new eos::ChangeLogFileMDSvc());
+  std::shared_ptr<eos::IView> view =
+    std::shared_ptr<eos::IView>(new eos::HierarchicalView());
+  fileSvc->setContMDService(contSvc.get());
+  contSvc->setFileMDService(fileSvc.get());
+  std::map<std::string, std::string> fileSettings;
+  std::map<std::string, std::string> contSettings;
+  std::map<std::string, std::string> settings;
+  std::string fileNameFileMD = getTempName("/tmp", "eosns");
+  std::string fileNameContMD = getTempName("/tmp", "eosns");
+  contSettings["changelog_path"] = fileNameContMD;
+  contSvc->configure(contSettings);
+  fileSettings["changelog_path"] = fileNameFileMD;
+  fileSvc->configure(fileSettings);
+  view->setContainerMDSvc(contSvc.get());
+  view->setFileMDSvc(fileSvc.get());
+  view->configure(settings);
+  view->initialize();
+  //----------------------------------------------------------------------------
+  // Create some files and compact
+  //----------------------------------------------------------------------------
+  CPPUNIT_ASSERT_NO_THROW(view->createContainer("/test/", true));
+
+  for (int i = 0; i < 10000; ++i)
+  {
+    std::ostringstream s;
+    s << "/test/file" << i;
+    CPPUNIT_ASSERT_NO_THROW(view->createFile(s.str()));
+  }
+
+  std::string newFileLogName = getTempName("/tmp", "eosns");
+  eos::ChangeLogFileMDSvc* clFileSvc = dynamic_cast<eos::ChangeLogFileMDSvc*>
+                                       (view->getFileMDSvc());
+  void* compData = 0;
+  CPPUNIT_ASSERT_NO_THROW(compData = clFileSvc->compactPrepare(newFileLogName));
+  CPPUNIT_ASSERT_NO_THROW(clFileSvc->compact(compData));
+
+  //----------------------------------------------------------------------------
+  // Catch up while the log is appended, records being written must not be
+  // taken for a corruption
+  //----------------------------------------------------------------------------
+  CreateData cd;
+  cd.view  = view;
+  cd.first = 10000;
+  cd.last  = 20000;
+  pthread_t thread;
+  CPPUNIT_ASSERT(pthread_create(&thread, 0, createThread, &cd) == 0);
+  uint64_t caughtUp = 0;
+
+  while (!cd.done)
+  {
+    CPPUNIT_ASSERT_NO_THROW(caughtUp += clFileSvc->compactCatchUp(compData,
+                                                                  true));
+  }
+
+  CPPUNIT_ASSERT(pthread_join(thread, 0) == 0);
+  CPPUNIT_ASSERT_NO_THROW(caughtUp += clFileSvc->compactCatchUp(compData,
+                                                                true));
+  CPPUNIT_ASSERT(caughtUp > 0);
+
+  //----------------------------------------------------------------------------
+  // Break the log and append behind the broken part, the catch up skips it
+  //----------------------------------------------------------------------------
+  int fd = open(fileNameFileMD.c_str(), O_WRONLY | O_APPEND);
+  CPPUNIT_ASSERT(fd >= 0);
+  char garbage[16];
+  memset(garbage, 0, sizeof(garbage));
+  CPPUNIT_ASSERT(write(fd, garbage, sizeof(garbage)) == sizeof(garbage));
+  close(fd);
+
+  for (int i = 20000; i < 21000; ++i)
+  {
+    std::ostringstream s;
+    s << "/test/file" << i;
+    CPPUNIT_ASSERT_NO_THROW(view->createFile(s.str()));
+  }
+
+  CPPUNIT_ASSERT_NO_THROW(caughtUp = clFileSvc->compactCatchUp(compData, true));
+  CPPUNIT_ASSERT(caughtUp > 0);
+  CPPUNIT_ASSERT_NO_THROW(clFileSvc->compactCommit(compData, true));
+  CheckOnlineComp(view, 21000, 0);
+  //----------------------------------------------------------------------------
+  // Reinitialize from the compacted log and check again
+  //----------------------------------------------------------------------------
+  view->finalize();
+  fileSettings["changelog_path"] = newFileLogName;
+  fileSvc->configure(fileSettings);
+  view->initialize();
+  CheckOnlineComp(view, 21000, 0);
+  view->finalize();
+  //----------------------------------------------------------------------------
+  // Cleanup
+  //----------------------------------------------------------------------------
+  unlink(fileNameFileMD.c_str());
+  unlink(fileNameContMD.c_str());
+  unlink(newFileLogName.c_str());
+}
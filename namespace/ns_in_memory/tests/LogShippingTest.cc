@@ -0,0 +1,264 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// desc:   Changelog shipping test
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "namespace/utils/TestHelpers.hh"
+#include "namespace/utils/LogShipping.hh"
+#include "namespace/ns_in_memory/persistency/ChangeLogFile.hh"
+
+#define NUMRECORDS 100000
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class LogShippingTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( LogShippingTest );
+    CPPUNIT_TEST( replicationLagTest );
+    CPPUNIT_TEST( authenticationTest );
+    CPPUNIT_TEST_SUITE_END();
+    void replicationLagTest();
+    void authenticationTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LogShippingTest );
+
+//------------------------------------------------------------------------------
+// Record counter
+//------------------------------------------------------------------------------
+class RecordCounter: public eos::ILogRecordScanner
+{
+  public:
+    RecordCounter(): pCount( 0 ) {}
+
+    virtual bool processRecord( uint64_t offset, char type,
+                                const eos::Buffer &buffer )
+    {
+      ++pCount;
+      return true;
+    }
+
+    uint64_t getCount() const
+    {
+      return pCount;
+    }
+
+  private:
+    uint64_t pCount;
+};
+
+//------------------------------------------------------------------------------
+// Ship a changelog written under load to a receiver in another process and
+// measure how far the receiver lags behind
+//------------------------------------------------------------------------------
+void LogShippingTest::replicationLagTest()
+{
+  std::string srcDir = getTempName( "/tmp", "eosns" );
+  std::string dstDir = getTempName( "/tmp", "eosns" );
+  std::string name   = "files.shipping.mdlog";
+  unsigned    port   = 20000 + getpid() % 10000;
+  CPPUNIT_ASSERT( mkdir( srcDir.c_str(), 0755 ) == 0 );
+  CPPUNIT_ASSERT( mkdir( dstDir.c_str(), 0755 ) == 0 );
+
+  //----------------------------------------------------------------------------
+  // The receiving side lives in its own process
+  //----------------------------------------------------------------------------
+  pid_t pid = fork();
+  CPPUNIT_ASSERT( pid >= 0 );
+
+  if( pid == 0 )
+  {
+    eos::LogReceiver receiver( dstDir, port, "shipping secret" );
+    receiver.allowPeer( "localhost" );
+    receiver.allow( name );
+    try
+    {
+      receiver.start();
+    }
+    catch( eos::MDException &e )
+    {
+      _exit( 1 );
+    }
+
+    while( 1 )
+      sleep( 1 );
+  }
+
+  //----------------------------------------------------------------------------
+  // Write the records and sample the lag while they are shipped
+  //----------------------------------------------------------------------------
+  eos::ChangeLogFile file;
+  std::string        srcPath = srcDir + "/" + name;
+  CPPUNIT_ASSERT_NO_THROW( file.open( srcPath ) );
+
+  eos::LogShipper shipper( srcPath, "localhost", port, "shipping secret" );
+  CPPUNIT_ASSERT_NO_THROW( shipper.start() );
+
+  eos::LogShipperStats stats;
+  eos::Buffer          buffer;
+  uint64_t             maxLag = 0;
+  uint64_t             sumLag = 0;
+  uint64_t             samples = 0;
+  srandom( time( 0 ) );
+
+  for( int i = 0; i < NUMRECORDS; ++i )
+  {
+    buffer.clear();
+    int size = 32 + random() % 512;
+    for( int j = 0; j < size; ++j )
+      buffer.putData( &j, 1 );
+    CPPUNIT_ASSERT_NO_THROW( file.storeRecord( 1, buffer ) );
+
+    if( i % 100 == 0 )
+    {
+      shipper.getStats( stats );
+      if( stats.lagMs > maxLag )
+        maxLag = stats.lagMs;
+      sumLag += stats.lagMs;
+      ++samples;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Wait for the receiver to catch up
+  //----------------------------------------------------------------------------
+  uint64_t size = file.getNextOffset();
+  for( int i = 0; i < 6000; ++i )
+  {
+    shipper.getStats( stats );
+    if( stats.ackedOffset == size )
+      break;
+    usleep( 10000 );
+  }
+
+  shipper.stop();
+  file.close();
+  kill( pid, SIGKILL );
+  waitpid( pid, 0, 0 );
+
+  std::cout << std::endl << "records: " << NUMRECORDS;
+  std::cout << " bytes: " << size;
+  std::cout << " batches: " << stats.batches;
+  std::cout << " lag avg: " << (samples ? sumLag / samples : 0) << "ms";
+  std::cout << " lag max: " << maxLag << "ms" << std::endl;
+
+  CPPUNIT_ASSERT( stats.ackedOffset == size );
+
+  //----------------------------------------------------------------------------
+  // The copy must hold all the records
+  //----------------------------------------------------------------------------
+  eos::ChangeLogFile copy;
+  RecordCounter      counter;
+  std::string        dstPath = dstDir + "/" + name;
+  CPPUNIT_ASSERT_NO_THROW( copy.open( dstPath, eos::ChangeLogFile::ReadOnly ) );
+  CPPUNIT_ASSERT_NO_THROW( copy.scanAllRecords( &counter ) );
+  CPPUNIT_ASSERT( counter.getCount() == NUMRECORDS );
+  copy.close();
+
+  unlink( srcPath.c_str() );
+  unlink( dstPath.c_str() );
+  rmdir( srcDir.c_str() );
+  rmdir( dstDir.c_str() );
+}
+
+//------------------------------------------------------------------------------
+// Shippers without the secret or from an unknown host are refused before
+// anything is written
+//------------------------------------------------------------------------------
+void LogShippingTest::authenticationTest()
+{
+  std::string srcDir = getTempName( "/tmp", "eosns" );
+  std::string dstDir = getTempName( "/tmp", "eosns" );
+  std::string name   = "files.shipping.mdlog";
+  std::string dstPath = dstDir + "/" + name;
+  unsigned    port   = 20000 + (getpid() + 1) % 10000;
+  CPPUNIT_ASSERT( mkdir( srcDir.c_str(), 0755 ) == 0 );
+  CPPUNIT_ASSERT( mkdir( dstDir.c_str(), 0755 ) == 0 );
+
+  eos::ChangeLogFile file;
+  eos::Buffer        buffer;
+  std::string        srcPath = srcDir + "/" + name;
+  CPPUNIT_ASSERT_NO_THROW( file.open( srcPath ) );
+  buffer.putData( "record", 6 );
+  CPPUNIT_ASSERT_NO_THROW( file.storeRecord( 1, buffer ) );
+
+  //----------------------------------------------------------------------------
+  // Wrong secret
+  //----------------------------------------------------------------------------
+  eos::LogShipperStats stats;
+  struct stat          st;
+  {
+    eos::LogReceiver receiver( dstDir, port, "shipping secret" );
+    receiver.allowPeer( "localhost" );
+    receiver.allow( name );
+    CPPUNIT_ASSERT_NO_THROW( receiver.start() );
+
+    eos::LogShipper shipper( srcPath, "localhost", port, "wrong secret" );
+    CPPUNIT_ASSERT_NO_THROW( shipper.start() );
+    sleep( 1 );
+    shipper.getStats( stats );
+    shipper.stop();
+    receiver.stop();
+    CPPUNIT_ASSERT( !stats.connected );
+    CPPUNIT_ASSERT( stats.ackedOffset == 0 );
+    CPPUNIT_ASSERT( ::stat( dstPath.c_str(), &st ) != 0 );
+  }
+
+  //----------------------------------------------------------------------------
+  // Unknown host
+  //----------------------------------------------------------------------------
+  {
+    eos::LogReceiver receiver( dstDir, port, "shipping secret" );
+    receiver.allowPeer( "192.0.2.1" );
+    receiver.allow( name );
+    CPPUNIT_ASSERT_NO_THROW( receiver.start() );
+
+    eos::LogShipper shipper( srcPath, "localhost", port, "shipping secret" );
+    CPPUNIT_ASSERT_NO_THROW( shipper.start() );
+    sleep( 1 );
+    shipper.getStats( stats );
+    shipper.stop();
+    receiver.stop();
+    CPPUNIT_ASSERT( !stats.connected );
+    CPPUNIT_ASSERT( ::stat( dstPath.c_str(), &st ) != 0 );
+  }
+
+  //----------------------------------------------------------------------------
+  // Without a secret nothing starts
+  //----------------------------------------------------------------------------
+  eos::LogReceiver receiver( dstDir, port, "" );
+  CPPUNIT_ASSERT_THROW( receiver.start(), eos::MDException );
+
+  file.close();
+  unlink( srcPath.c_str() );
+  rmdir( srcDir.c_str() );
+  rmdir( dstDir.c_str() );
+}
@@ -17,6 +17,8 @@
 //------------------------------------------------------------------------------
 
 #include <iostream>
+#include <deque>
+#include "namespace/ns_in_memory/ContainerMD.hh"
 #include "namespace/ns_in_memory/views/HierarchicalView.hh"
 #include "namespace/ns_in_memory/persistency/ChangeLogContainerMDSvc.hh"
 #include "namespace/ns_in_memory/persistency/ChangeLogFileMDSvc.hh"
@@ -54,7 +56,8 @@ uint64_t clockGetTime( clockid_t type = CLOCK_REALTIME )
 // Boot the namespace
 //------------------------------------------------------------------------------
 eos::IView *bootNamespace( const std::string &dirLog,
-                           const std::string &fileLog )
+                           const std::string &fileLog,
+                           const std::string &indexMin )
   throw( eos::MDException )
 {
   eos::IContainerMDSvc *contSvc = new eos::ChangeLogContainerMDSvc();
@@ -66,6 +69,8 @@ eos::IView *bootNamespace( const std::string &dirLog,
   std::map<std::string, std::string> settings;
   contSettings["changelog_path"] = dirLog;
   fileSettings["changelog_path"] = fileLog;
+  if( !indexMin.empty() )
+    contSettings["child_index_min"] = indexMin;
 
   fileSvc->configure( fileSettings );
   contSvc->configure( contSettings );
@@ -92,15 +97,79 @@ void closeNamespace( eos::IView *view ) throw( eos::MDException )
   delete fileSvc;
 }
 
+//------------------------------------------------------------------------------
+// Name visitor counting the names
+//------------------------------------------------------------------------------
+class NameCounter: public eos::IContainerNameVisitor
+{
+  public:
+    NameCounter(): count( 0 ) {}
+
+    bool visitName( const std::string &name )
+    {
+      ++count;
+      return true;
+    }
+
+    uint64_t count;
+};
+
+//------------------------------------------------------------------------------
+// Report the memory used by the sorted child indices and the time needed to
+// list all the containers in order
+//------------------------------------------------------------------------------
+void reportChildIndex( eos::IView *view ) throw( eos::MDException )
+{
+  std::deque<std::shared_ptr<eos::IContainerMD> > queue;
+  queue.push_back( view->getContainer( "/" ) );
+  uint64_t numContainers = 0;
+  uint64_t numIndexed    = 0;
+  uint64_t indexMemory   = 0;
+  NameCounter counter;
+  uint64_t listTime = 0;
+
+  while( !queue.empty() )
+  {
+    std::shared_ptr<eos::IContainerMD> cont = queue.front();
+    queue.pop_front();
+    ++numContainers;
+
+    eos::ContainerMD *memCont = dynamic_cast<eos::ContainerMD*>( cont.get() );
+    if( memCont && memCont->getChildIndexMemory() )
+    {
+      ++numIndexed;
+      indexMemory += memCont->getChildIndexMemory();
+    }
+
+    uint64_t start = clockGetTime( CLOCK_REALTIME );
+    cont->visitNameFiles( &counter );
+    cont->visitNameContainers( &counter );
+    listTime += clockGetTime( CLOCK_REALTIME ) - start;
+
+    std::set<std::string> dnames = cont->getNameContainers();
+    for( auto it = dnames.begin(); it != dnames.end(); ++it )
+      queue.push_back( cont->findContainer( *it ) );
+  }
+
+  std::cerr << "[i] Containers: " << numContainers << std::endl;
+  std::cerr << "[i] Containers with a child index: " << numIndexed;
+  std::cerr << std::endl;
+  std::cerr << "[i] Child index memory (MB): ";
+  std::cerr << (double)indexMemory/1024.0/1024.0 << std::endl;
+  std::cerr << "[i] Sorted listing of " << counter.count << " entries: ";
+  std::cerr << (double)listTime/1000000.0 << " s" << std::endl;
+}
+
 int main( int argc, char **argv )
 {
   //----------------------------------------------------------------------------
   // Check up the commandline params
   //----------------------------------------------------------------------------
-  if( argc != 3 )
+  if( argc != 3 && argc != 4 )
   {
     std::cerr << "Usage:"                                << std::endl;
-    std::cerr << "  ns-benchmark directory.log file.log" << std::endl;
+    std::cerr << "  ns-benchmark directory.log file.log [child_index_min]";
+    std::cerr << std::endl;
     return 1;
   };
 
@@ -112,7 +181,8 @@ int main( int argc, char **argv )
     std::cerr << "[i] Booting up..." << std::endl;
     zeroTimer( CLOCK_PROCESS_CPUTIME_ID );
     uint64_t realTimeStart = clockGetTime( CLOCK_REALTIME );
-    eos::IView *view = bootNamespace( argv[1], argv[2] );
+    eos::IView *view = bootNamespace( argv[1], argv[2],
+                                      argc == 4 ? argv[3] : "" );
     uint64_t realTimeStop = clockGetTime( CLOCK_REALTIME );
     uint64_t cpuTimeStop = clockGetTime( CLOCK_PROCESS_CPUTIME_ID );
     double realTime = (double)(realTimeStop-realTimeStart)/1000000.0;
@@ -120,6 +190,7 @@ int main( int argc, char **argv )
     std::cerr << "[i] Booted." << std::endl;
     std::cerr << "[i] Real time: " << realTime << std::endl;
     std::cerr << "[i] CPU time: "  << cpuTime  << std::endl;
+    reportChildIndex( view );
     closeNamespace( view );
   }
   catch( eos::MDException &e )
@@ -23,9 +23,15 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 #include <sstream>
+#include <set>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
 
 #include "namespace/utils/TestHelpers.hh"
 #include "namespace/utils/PathProcessor.hh"
+#include "namespace/ns_in_memory/ChildIndex.hh"
 
 //------------------------------------------------------------------------------
 // Declaration
@@ -35,9 +41,11 @@ class OtherTests: public CppUnit::TestCase
   public:
     CPPUNIT_TEST_SUITE( OtherTests );
     CPPUNIT_TEST( pathSplitterTest );
+    CPPUNIT_TEST( childIndexTest );
     CPPUNIT_TEST_SUITE_END();
 
     void pathSplitterTest();
+    void childIndexTest();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( OtherTests );
@@ -97,3 +105,96 @@ void OtherTests::pathSplitterTest()
   eos::PathProcessor::splitPath( elements, "" );
   CPPUNIT_ASSERT( elements.size() == 0 );
 }
+
+//------------------------------------------------------------------------------
+// Visitor collecting the names
+//------------------------------------------------------------------------------
+class NameCollector: public eos::IContainerNameVisitor
+{
+  public:
+    NameCollector( size_t max ): pMax( max ) {}
+
+    bool visitName( const std::string &name )
+    {
+      names.push_back( name );
+      return names.size() < pMax;
+    }
+
+    std::vector<std::string> names;
+
+  private:
+    size_t pMax;
+};
+
+//------------------------------------------------------------------------------
+// Test the sorted child index against a set
+//------------------------------------------------------------------------------
+void OtherTests::childIndexTest()
+{
+  eos::ChildIndex    index;
+  std::set<std::string> names;
+  srandom( 42 );
+
+  //----------------------------------------------------------------------------
+  // Add and remove random names, enough to split and merge the chunks
+  //----------------------------------------------------------------------------
+  for( int i = 0; i < 20000; ++i )
+  {
+    std::ostringstream o;
+    o << "file" << random() % 5000;
+
+    if( random() % 3 )
+    {
+      index.insert( o.str() );
+      names.insert( o.str() );
+    }
+    else
+    {
+      index.erase( o.str() );
+      names.erase( o.str() );
+    }
+  }
+
+  CPPUNIT_ASSERT( index.size() == names.size() );
+  CPPUNIT_ASSERT( index.getMemoryUsage() > names.size() * sizeof(std::string) );
+
+  //----------------------------------------------------------------------------
+  // Full listing in order
+  //----------------------------------------------------------------------------
+  NameCollector all( names.size() + 1 );
+  index.visit( &all, "" );
+  CPPUNIT_ASSERT( all.names.size() == names.size() );
+  CPPUNIT_ASSERT( std::equal( names.begin(), names.end(), all.names.begin() ) );
+
+  //----------------------------------------------------------------------------
+  // Listing in pages resuming after the last name, also after names which
+  // are not in the index
+  //----------------------------------------------------------------------------
+  std::vector<std::string> paged;
+  std::string after = "";
+  while( true )
+  {
+    NameCollector page( 100 );
+    index.visit( &page, after );
+    paged.insert( paged.end(), page.names.begin(), page.names.end() );
+    if( page.names.size() < 100 )
+      break;
+    after = page.names.back();
+  }
+  CPPUNIT_ASSERT( paged == all.names );
+
+  NameCollector rest( names.size() + 1 );
+  index.visit( &rest, "file25" );
+  std::set<std::string>::iterator it = names.upper_bound( "file25" );
+  CPPUNIT_ASSERT( rest.names.size() == (size_t)std::distance( it, names.end() ) );
+  CPPUNIT_ASSERT( std::equal( it, names.end(), rest.names.begin() ) );
+
+  NameCollector none( 10 );
+  index.visit( &none, "zzz" );
+  CPPUNIT_ASSERT( none.names.empty() );
+
+  index.clear();
+  CPPUNIT_ASSERT( index.size() == 0 );
+  index.visit( &none, "" );
+  CPPUNIT_ASSERT( none.names.empty() );
+}
@@ -351,6 +351,39 @@ ContainerMD::getNameContainers() const
   return set_subconts;
 }
 
+//------------------------------------------------------------------------------
+// Visit the file names in lexicographical order. The table enumeration is not
+// ordered, so the names are collected first.
+//------------------------------------------------------------------------------
+void
+ContainerMD::visitNameFiles(IContainerNameVisitor* visitor,
+                            const std::string& after) const
+{
+  std::set<std::string> names = getNameFiles();
+
+  for (auto it = names.upper_bound(after); it != names.end(); ++it)
+  {
+    if (!visitor->visitName(*it))
+      return;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Visit the subcontainer names in lexicographical order
+//------------------------------------------------------------------------------
+void
+ContainerMD::visitNameContainers(IContainerNameVisitor* visitor,
+                                 const std::string& after) const
+{
+  std::set<std::string> names = getNameContainers();
+
+  for (auto it = names.upper_bound(after); it != names.end(); ++it)
+  {
+    if (!visitor->visitName(*it))
+      return;
+  }
+}
+
 //------------------------------------------------------------------------------
 // Access checking helpers
 //------------------------------------------------------------------------------
@@ -364,6 +364,34 @@ ContainerMD::getNameContainers() const
   return set_dirs;
 }
 
+//------------------------------------------------------------------------------
+// Visit the file names in lexicographical order
+//------------------------------------------------------------------------------
+void
+ContainerMD::visitNameFiles(IContainerNameVisitor* visitor,
+                            const std::string& after) const
+{
+  for (auto it = mFilesMap.upper_bound(after); it != mFilesMap.end(); ++it) {
+    if (!visitor->visitName(it->first)) {
+      return;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Visit the subcontainer names in lexicographical order
+//------------------------------------------------------------------------------
+void
+ContainerMD::visitNameContainers(IContainerNameVisitor* visitor,
+                                 const std::string& after) const
+{
+  for (auto it = mDirsMap.upper_bound(after); it != mDirsMap.end(); ++it) {
+    if (!visitor->visitName(it->first)) {
+      return;
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 // Access checking helpers
 //------------------------------------------------------------------------------
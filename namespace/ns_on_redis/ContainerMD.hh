@@ -403,6 +403,19 @@ public:
   //----------------------------------------------------------------------------
   virtual std::set<std::string> getNameContainers() const;
 
+  //----------------------------------------------------------------------------
+  //! Visit the file names in lexicographical order without copying them
+  //----------------------------------------------------------------------------
+  virtual void visitNameFiles(IContainerNameVisitor* visitor,
+                              const std::string& after = "") const;
+
+  //----------------------------------------------------------------------------
+  //! Visit the subcontainer names in lexicographical order without copying
+  //! them
+  //----------------------------------------------------------------------------
+  virtual void visitNameContainers(IContainerNameVisitor* visitor,
+                                   const std::string& after = "") const;
+
   //----------------------------------------------------------------------------
   //! Serialize the object to a buffer
   //----------------------------------------------------------------------------
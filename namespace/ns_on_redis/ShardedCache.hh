@@ -0,0 +1,531 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @brief Sharded CLOCK cache for namespace objects. Lookups only take a
+//!        per-shard read lock, evictions never drop an entry which is still
+//!        referenced in other parts of the program and ids which are known
+//!        not to exist in the backend are remembered for a short time in a
+//!        negative cache.
+//------------------------------------------------------------------------------
+
+#ifndef __EOS_NS_REDIS_SHARDED_CACHE_HH__
+#define __EOS_NS_REDIS_SHARDED_CACHE_HH__
+
+#include "common/RWMutex.hh"
+#include "namespace/Namespace.hh"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+EOSNSNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Sharded cache for namespace entries
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+class ShardedCache {
+public:
+  //----------------------------------------------------------------------------
+  //! Cache statistics
+  //----------------------------------------------------------------------------
+  struct Stats {
+    std::uint64_t mSize;         ///< Number of cached objects
+    std::uint64_t mNegSize;      ///< Number of cached missing ids
+    std::uint64_t mHits;         ///< Lookups served from the cache
+    std::uint64_t mMisses;       ///< Lookups not found in the cache
+    std::uint64_t mNegHits;      ///< Lookups answered by the negative cache
+    std::uint64_t mEvictions;    ///< Objects evicted from the cache
+    std::uint64_t mPinnedSkips;  ///< Eviction candidates skipped as referenced
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param max_size maximum number of entries in the cache
+  //! @param num_shards number of shards, rounded up to a power of 2
+  //! @param neg_ttl lifetime of the negative entries - ids can be created in
+  //!        the backend by someone else, so their absence is not trusted
+  //!        forever
+  //----------------------------------------------------------------------------
+  ShardedCache(std::uint64_t max_size, std::uint32_t num_shards = 64,
+               std::chrono::milliseconds neg_ttl = std::chrono::seconds(10));
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  virtual ~ShardedCache() = default;
+
+  //----------------------------------------------------------------------------
+  //! Get entry
+  //!
+  //! @param id entry id
+  //!
+  //! @return shared ptr to requested object or nullptr if not found
+  //----------------------------------------------------------------------------
+  std::shared_ptr<EntryT> get(IdT id);
+
+  //----------------------------------------------------------------------------
+  //! Put entry
+  //!
+  //! @param id entry id
+  //! @param obj entry object
+  //!
+  //! @return object stored in the cache for the given id - this can be an
+  //!         already existing object if another thread was faster. If the
+  //!         shard is full then the CLOCK hand evicts entries which were not
+  //!         recently accessed and are not referenced anywhere else.
+  //----------------------------------------------------------------------------
+  std::shared_ptr<EntryT> put(IdT id, std::shared_ptr<EntryT> obj);
+
+  //----------------------------------------------------------------------------
+  //! Remove entry from cache
+  //!
+  //! @param id entry id
+  //!
+  //! @return true if successfully removed from the cache, false otherwise
+  //----------------------------------------------------------------------------
+  bool remove(IdT id);
+
+  //----------------------------------------------------------------------------
+  //! Record an id which does not exist in the backend
+  //!
+  //! @param id entry id
+  //----------------------------------------------------------------------------
+  void setMissing(IdT id);
+
+  //----------------------------------------------------------------------------
+  //! Check if an id is known not to exist in the backend
+  //!
+  //! @param id entry id
+  //!
+  //! @return true if id is in the negative cache and the entry did not
+  //!         expire, otherwise false
+  //----------------------------------------------------------------------------
+  bool isMissing(IdT id);
+
+  //----------------------------------------------------------------------------
+  //! Get cache size
+  //!
+  //! @return cache size
+  //----------------------------------------------------------------------------
+  std::uint64_t size() const;
+
+  //----------------------------------------------------------------------------
+  //! Set max size
+  //!
+  //! @param max_size new maximum number of entries
+  //----------------------------------------------------------------------------
+  void set_max_size(const std::uint64_t max_size);
+
+  //----------------------------------------------------------------------------
+  //! Get snapshot of the cache statistics
+  //----------------------------------------------------------------------------
+  Stats getStats() const;
+
+  //----------------------------------------------------------------------------
+  //! Get cache statistics as name/value pairs
+  //!
+  //! @param stats map filled with counter names and values
+  //----------------------------------------------------------------------------
+  void getStats(std::map<std::string, std::uint64_t>& stats) const;
+
+private:
+  //! Fraction of the max size reserved for the negative cache
+  static constexpr double sNegativeRatio = 0.1;
+
+  using ClockT = std::chrono::steady_clock;
+
+  //! Forbid copying or moving cache objects
+  ShardedCache(const ShardedCache& other) = delete;
+  ShardedCache& operator=(const ShardedCache& other) = delete;
+  ShardedCache(ShardedCache&& other) = delete;
+  ShardedCache& operator=(ShardedCache&& other) = delete;
+
+  //----------------------------------------------------------------------------
+  //! Node of the CLOCK ring
+  //----------------------------------------------------------------------------
+  struct Node {
+    Node(IdT id, std::shared_ptr<EntryT> obj):
+      mId(id), mObj(obj), mReferenced(true) {}
+
+    IdT mId;
+    std::shared_ptr<EntryT> mObj;
+    std::atomic<bool> mReferenced; ///< Set on access, cleared by the hand
+  };
+
+  using ListT = std::list<Node>;
+
+  //----------------------------------------------------------------------------
+  //! Cache shard
+  //----------------------------------------------------------------------------
+  struct Shard {
+    Shard(): mHand(mRing.end()), mMaxSize(0), mMaxNegSize(0), mHits(0),
+      mMisses(0), mNegHits(0), mEvictions(0), mPinnedSkips(0)
+    {
+      mMutex.SetBlocking(true);
+    }
+
+    mutable eos::common::RWMutex mMutex;
+    ListT mRing; ///< CLOCK ring of cached objects
+    typename ListT::iterator mHand; ///< Current position of the CLOCK hand
+    std::unordered_map<IdT, typename ListT::iterator> mMap;
+    //! Ids known not to exist and the expiry time of this knowledge
+    std::unordered_map<IdT, ClockT::time_point> mNegMap;
+    std::deque<IdT> mNegFifo; ///< Insertion order of the negative entries
+    std::uint64_t mMaxSize;
+    std::uint64_t mMaxNegSize;
+    std::atomic<std::uint64_t> mHits;
+    std::atomic<std::uint64_t> mMisses;
+    std::atomic<std::uint64_t> mNegHits;
+    std::atomic<std::uint64_t> mEvictions;
+    std::atomic<std::uint64_t> mPinnedSkips;
+  };
+
+  //----------------------------------------------------------------------------
+  //! Get shard responsible for the given id
+  //----------------------------------------------------------------------------
+  inline Shard&
+  getShard(IdT id) const
+  {
+    // Mix the id so that sequential ids spread evenly across shards
+    std::uint64_t h = static_cast<std::uint64_t>(id) * 0x9E3779B97F4A7C15ull;
+    return *mShards[(h >> 32) & mShardMask];
+  }
+
+  //----------------------------------------------------------------------------
+  //! Evict entries from the shard until it is below its max size. Must be
+  //! called with the shard write lock held.
+  //----------------------------------------------------------------------------
+  void evict(Shard& shard);
+
+  //----------------------------------------------------------------------------
+  //! Remove id from the negative cache. Must be called with the shard write
+  //! lock held.
+  //----------------------------------------------------------------------------
+  void clearMissing(Shard& shard, IdT id);
+
+  std::vector<std::unique_ptr<Shard>> mShards;
+  std::uint64_t mShardMask;
+  const std::chrono::milliseconds mNegTtl; ///< Lifetime of negative entries
+};
+
+// Definition of class static member
+template <typename IdT, typename EntryT>
+constexpr double ShardedCache<IdT, EntryT>::sNegativeRatio;
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+ShardedCache<IdT, EntryT>::ShardedCache(std::uint64_t max_size,
+                                        std::uint32_t num_shards,
+                                        std::chrono::milliseconds neg_ttl):
+  mNegTtl(neg_ttl)
+{
+  std::uint32_t count = 1;
+
+  while (count < num_shards) {
+    count <<= 1;
+  }
+
+  mShardMask = count - 1;
+
+  for (std::uint32_t i = 0; i < count; ++i) {
+    mShards.emplace_back(new Shard());
+  }
+
+  set_max_size(max_size);
+}
+
+//------------------------------------------------------------------------------
+// Get object
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+std::shared_ptr<EntryT>
+ShardedCache<IdT, EntryT>::get(IdT id)
+{
+  Shard& shard = getShard(id);
+  eos::common::RWMutexReadLock lock_r(shard.mMutex);
+  auto iter = shard.mMap.find(id);
+
+  if (iter == shard.mMap.end()) {
+    shard.mMisses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  shard.mHits.fetch_add(1, std::memory_order_relaxed);
+  iter->second->mReferenced.store(true, std::memory_order_relaxed);
+  return iter->second->mObj;
+}
+
+//------------------------------------------------------------------------------
+// Put object
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+std::shared_ptr<EntryT>
+ShardedCache<IdT, EntryT>::put(IdT id, std::shared_ptr<EntryT> obj)
+{
+  Shard& shard = getShard(id);
+  eos::common::RWMutexWriteLock lock_w(shard.mMutex);
+  auto iter = shard.mMap.find(id);
+
+  if (iter != shard.mMap.end()) {
+    iter->second->mReferenced.store(true, std::memory_order_relaxed);
+    return iter->second->mObj;
+  }
+
+  clearMissing(shard, id);
+
+  if (shard.mMap.size() >= shard.mMaxSize) {
+    evict(shard);
+  }
+
+  // New entries are inserted just behind the hand so that they are the last
+  // ones to be inspected during the next sweep
+  auto iter_new = shard.mRing.emplace(shard.mHand, id, obj);
+  shard.mMap.emplace(id, iter_new);
+  return obj;
+}
+
+//------------------------------------------------------------------------------
+// Remove object
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+bool
+ShardedCache<IdT, EntryT>::remove(IdT id)
+{
+  Shard& shard = getShard(id);
+  eos::common::RWMutexWriteLock lock_w(shard.mMutex);
+  auto iter = shard.mMap.find(id);
+
+  if (iter == shard.mMap.end()) {
+    return false;
+  }
+
+  if (shard.mHand == iter->second) {
+    ++shard.mHand;
+  }
+
+  shard.mRing.erase(iter->second);
+  shard.mMap.erase(iter);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Record missing id
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+void
+ShardedCache<IdT, EntryT>::setMissing(IdT id)
+{
+  Shard& shard = getShard(id);
+  eos::common::RWMutexWriteLock lock_w(shard.mMutex);
+
+  if ((shard.mMaxNegSize == 0) || (mNegTtl.count() <= 0) ||
+      shard.mMap.count(id)) {
+    return;
+  }
+
+  ClockT::time_point now = ClockT::now();
+  auto ins = shard.mNegMap.emplace(id, now + mNegTtl);
+
+  if (!ins.second) {
+    ins.first->second = now + mNegTtl;
+    return;
+  }
+
+  shard.mNegFifo.push_back(id);
+
+  // All entries have the same lifetime so the oldest ones expire first
+  while (!shard.mNegFifo.empty()) {
+    auto front = shard.mNegMap.find(shard.mNegFifo.front());
+
+    if ((shard.mNegFifo.size() <= shard.mMaxNegSize) &&
+        (front != shard.mNegMap.end()) && (front->second > now)) {
+      break;
+    }
+
+    if (front != shard.mNegMap.end()) {
+      shard.mNegMap.erase(front);
+    }
+
+    shard.mNegFifo.pop_front();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Check missing id
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+bool
+ShardedCache<IdT, EntryT>::isMissing(IdT id)
+{
+  Shard& shard = getShard(id);
+  eos::common::RWMutexReadLock lock_r(shard.mMutex);
+  auto iter = shard.mNegMap.find(id);
+
+  // Expired entries are only dropped by writers, readers just ignore them
+  if ((iter != shard.mNegMap.end()) && (iter->second > ClockT::now())) {
+    shard.mNegHits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Get cache size
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+std::uint64_t
+ShardedCache<IdT, EntryT>::size() const
+{
+  std::uint64_t total = 0;
+
+  for (auto& shard : mShards) {
+    eos::common::RWMutexReadLock lock_r(shard->mMutex);
+    total += shard->mMap.size();
+  }
+
+  return total;
+}
+
+//------------------------------------------------------------------------------
+// Set max size
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+void
+ShardedCache<IdT, EntryT>::set_max_size(const std::uint64_t max_size)
+{
+  std::uint64_t per_shard = (max_size + mShardMask) / (mShardMask + 1);
+  std::uint64_t neg_per_shard = per_shard * sNegativeRatio;
+
+  for (auto& shard : mShards) {
+    eos::common::RWMutexWriteLock lock_w(shard->mMutex);
+    shard->mMaxSize = per_shard;
+    shard->mMaxNegSize = neg_per_shard;
+
+    if (shard->mMap.size() > shard->mMaxSize) {
+      evict(*shard);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Get statistics
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+typename ShardedCache<IdT, EntryT>::Stats
+ShardedCache<IdT, EntryT>::getStats() const
+{
+  Stats stats {0, 0, 0, 0, 0, 0, 0};
+
+  for (auto& shard : mShards) {
+    {
+      eos::common::RWMutexReadLock lock_r(shard->mMutex);
+      stats.mSize += shard->mMap.size();
+      stats.mNegSize += shard->mNegMap.size();
+    }
+    stats.mHits += shard->mHits.load(std::memory_order_relaxed);
+    stats.mMisses += shard->mMisses.load(std::memory_order_relaxed);
+    stats.mNegHits += shard->mNegHits.load(std::memory_order_relaxed);
+    stats.mEvictions += shard->mEvictions.load(std::memory_order_relaxed);
+    stats.mPinnedSkips += shard->mPinnedSkips.load(std::memory_order_relaxed);
+  }
+
+  return stats;
+}
+
+//------------------------------------------------------------------------------
+// Get statistics as name/value pairs
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+void
+ShardedCache<IdT, EntryT>::getStats(std::map<std::string, std::uint64_t>&
+                                    stats) const
+{
+  Stats snapshot = getStats();
+  stats["size"] = snapshot.mSize;
+  stats["negative_size"] = snapshot.mNegSize;
+  stats["hits"] = snapshot.mHits;
+  stats["misses"] = snapshot.mMisses;
+  stats["negative_hits"] = snapshot.mNegHits;
+  stats["evictions"] = snapshot.mEvictions;
+  stats["pinned_skips"] = snapshot.mPinnedSkips;
+}
+
+//------------------------------------------------------------------------------
+// Evict entries using the CLOCK algorithm
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+void
+ShardedCache<IdT, EntryT>::evict(Shard& shard)
+{
+  // Every entry gets at most two visits of the hand: one to clear the
+  // reference bit and one to evict it. If all entries are still referenced
+  // elsewhere the shard is allowed to grow above its max size.
+  std::uint64_t budget = 2 * shard.mRing.size();
+
+  while ((shard.mMap.size() >= shard.mMaxSize) && !shard.mRing.empty() &&
+         budget--) {
+    if (shard.mHand == shard.mRing.end()) {
+      shard.mHand = shard.mRing.begin();
+    }
+
+    Node& node = *shard.mHand;
+
+    if (node.mReferenced.exchange(false, std::memory_order_relaxed)) {
+      ++shard.mHand;
+      continue;
+    }
+
+    if (node.mObj.use_count() > 1) {
+      shard.mPinnedSkips.fetch_add(1, std::memory_order_relaxed);
+      ++shard.mHand;
+      continue;
+    }
+
+    shard.mMap.erase(node.mId);
+    shard.mHand = shard.mRing.erase(shard.mHand);
+    shard.mEvictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Remove id from the negative cache
+//------------------------------------------------------------------------------
+template <typename IdT, typename EntryT>
+void
+ShardedCache<IdT, EntryT>::clearMissing(Shard& shard, IdT id)
+{
+  // Stale ids left in the FIFO are harmless, they only shorten the lifetime
+  // of a later negative entry for the same id
+  shard.mNegMap.erase(id);
+}
+
+EOSNSNAMESPACE_END
+
+#endif // __EOS_NS_REDIS_SHARDED_CACHE_HH__
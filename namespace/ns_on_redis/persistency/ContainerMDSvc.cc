@@ -84,6 +84,13 @@ ContainerMDSvc::getContainerMD(IContainerMD::id_t id)
     return cont;
   }
 
+  // Avoid a round trip to the KV store for ids known not to exist
+  if (mContainerCache.isMissing(id)) {
+    MDException e(ENOENT);
+    e.getMessage() << "Container #" << id << " not found";
+    throw e;
+  }
+
   // If not in cache, then get it from the KV store
   std::string blob;
 
@@ -98,6 +105,7 @@ ContainerMDSvc::getContainerMD(IContainerMD::id_t id)
   }
 
   if (blob.empty()) {
+    mContainerCache.setMissing(id);
     MDException e(ENOENT);
     e.getMessage() << "Container #" << id << " not found";
     throw e;
@@ -27,7 +27,7 @@
 #include "namespace/interface/IContainerMD.hh"
 #include "namespace/interface/IContainerMDSvc.hh"
 #include "namespace/ns_on_redis/Constants.hh"
-#include "namespace/ns_on_redis/LRU.hh"
+#include "namespace/ns_on_redis/ShardedCache.hh"
 #include "namespace/ns_on_redis/accounting/QuotaStats.hh"
 #include <list>
 #include <map>
@@ -148,6 +148,17 @@ public:
     // TODO(esindril): add implementation
   }
 
+  //----------------------------------------------------------------------------
+  //! Get statistics of the container object cache
+  //!
+  //! @param stats map filled with counter names and values
+  //----------------------------------------------------------------------------
+  void
+  getCacheStatistics(std::map<std::string, uint64_t>& stats)
+  {
+    mContainerCache.getStats(stats);
+  }
+
 private:
   typedef std::list<IContainerMDChangeListener*> ListenerList;
 
@@ -174,7 +185,7 @@ private:
   redox::Redox* pRedox;     ///< Redis client
   std::string pRedisHost;   ///< Redis instance host
   uint32_t pRedisPort;      ///< Redis instance port
-  LRU<IContainerMD::id_t, IContainerMD> mContainerCache;
+  ShardedCache<IContainerMD::id_t, IContainerMD> mContainerCache;
 };
 
 EOSNSNAMESPACE_END
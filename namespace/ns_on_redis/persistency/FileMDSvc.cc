@@ -81,6 +81,13 @@ FileMDSvc::getFileMD(IFileMD::id_t id)
     return file;
   }
 
+  // Avoid a round trip to the KV store for ids known not to exist
+  if (mFileCache.isMissing(id)) {
+    MDException e(ENOENT);
+    e.getMessage() << "File #" << id << " not found";
+    throw e;
+  }
+
   // If not in cache, then get info from KV store
   std::string blob;
 
@@ -95,6 +102,7 @@ FileMDSvc::getFileMD(IFileMD::id_t id)
   }
 
   if (blob.empty()) {
+    mFileCache.setMissing(id);
     MDException e(ENOENT);
     e.getMessage() << "File #" << id << " not found";
     throw e;
@@ -371,6 +379,15 @@ FileMDSvc::addToConsistencyCheck(IFileMD::id_t id)
   }
 }
 
+//------------------------------------------------------------------------------
+// Get statistics of the file object cache
+//------------------------------------------------------------------------------
+void
+FileMDSvc::getCacheStatistics(std::map<std::string, uint64_t>& stats)
+{
+  mFileCache.getStats(stats);
+}
+
 //------------------------------------------------------------------------------
 // Get file bucket
 //------------------------------------------------------------------------------
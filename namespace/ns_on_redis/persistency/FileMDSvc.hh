@@ -25,7 +25,7 @@
 #define __EOS_NS_FILE_MD_SVC_HH__
 
 #include "namespace/interface/IFileMDSvc.hh"
-#include "namespace/ns_on_redis/LRU.hh"
+#include "namespace/ns_on_redis/ShardedCache.hh"
 #include "namespace/ns_on_redis/RedisClient.hh"
 #include <condition_variable>
 #include <list>
@@ -148,6 +148,13 @@ public:
   //----------------------------------------------------------------------------
   void addToConsistencyCheck(IFileMD::id_t id);
 
+  //----------------------------------------------------------------------------
+  //! Get statistics of the file object cache
+  //!
+  //! @param stats map filled with counter names and values
+  //----------------------------------------------------------------------------
+  void getCacheStatistics(std::map<std::string, uint64_t>& stats);
+
 private:
   typedef std::list<IFileMDChangeListener*> ListenerList;
 
@@ -184,7 +191,7 @@ private:
   redox::Redox* pRedox;
   std::string pRedisHost;
   uint32_t pRedisPort;
-  LRU<IFileMD::id_t, IFileMD> mFileCache;
+  ShardedCache<IFileMD::id_t, IFileMD> mFileCache;
 };
 
 EOSNSNAMESPACE_END
@@ -0,0 +1,118 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @brief Multi-threaded microbenchmark comparing the single lock LRU with the
+//!        sharded CLOCK cache used for the namespace objects
+//------------------------------------------------------------------------------
+
+#include "namespace/ns_on_redis/LRU.hh"
+#include "namespace/ns_on_redis/ShardedCache.hh"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//! Dummy namespace entry
+//------------------------------------------------------------------------------
+struct Entry {
+  explicit Entry(std::uint64_t id) : mId(id) {}
+
+  std::uint64_t
+  getId() const
+  {
+    return mId;
+  }
+
+  std::uint64_t mId;
+};
+
+//------------------------------------------------------------------------------
+// Run the workload against the given cache: each thread does random lookups
+// in an id range twice the size of the cache and inserts the missing entries.
+//
+// @return number of operations per second
+//------------------------------------------------------------------------------
+template <typename CacheT>
+double
+runBenchmark(CacheT& cache, std::uint64_t num_threads, std::uint64_t num_ops,
+             std::uint64_t max_id)
+{
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::uint64_t i = 0; i < num_threads; ++i) {
+    workers.emplace_back([&cache, i, num_ops, max_id]() {
+      std::mt19937_64 gen(i);
+      // Skewed access pattern: most lookups go to a small hot set
+      std::geometric_distribution<std::uint64_t> dist(10.0 / max_id);
+
+      for (std::uint64_t op = 0; op < num_ops; ++op) {
+        std::uint64_t id = dist(gen) % max_id;
+
+        if (!cache.get(id)) {
+          cache.put(id, std::make_shared<Entry>(id));
+        }
+      }
+    });
+  }
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+                                          start;
+  return (num_threads * num_ops) / elapsed.count();
+}
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main(int argc, char** argv)
+{
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <num_threads> <ops_per_thread> "
+              << "[cache_size]" << std::endl;
+    return 1;
+  }
+
+  std::uint64_t num_threads = std::strtoull(argv[1], 0, 10);
+  std::uint64_t num_ops = std::strtoull(argv[2], 0, 10);
+  std::uint64_t cache_size = (argc > 3) ? std::strtoull(argv[3], 0, 10) :
+                             1000000;
+  {
+    eos::LRU<std::uint64_t, Entry> lru(cache_size);
+    double rate = runBenchmark(lru, num_threads, num_ops, 2 * cache_size);
+    std::cout << "LRU          : " << (std::uint64_t)rate << " ops/s"
+              << std::endl;
+  }
+  {
+    eos::ShardedCache<std::uint64_t, Entry> sharded(cache_size);
+    double rate = runBenchmark(sharded, num_threads, num_ops, 2 * cache_size);
+    auto stats = sharded.getStats();
+    std::cout << "ShardedCache : " << (std::uint64_t)rate << " ops/s"
+              << " hits=" << stats.mHits << " misses=" << stats.mMisses
+              << " evictions=" << stats.mEvictions << std::endl;
+  }
+  return 0;
+}
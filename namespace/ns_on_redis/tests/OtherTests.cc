@@ -22,10 +22,13 @@
 //------------------------------------------------------------------------------
 
 #include "namespace/ns_on_redis/LRU.hh"
+#include "namespace/ns_on_redis/ShardedCache.hh"
 #include "namespace/utils/PathProcessor.hh"
 #include "namespace/utils/TestHelpers.hh"
 #include <cppunit/extensions/HelperMacros.h>
+#include <chrono>
 #include <sstream>
+#include <thread>
 
 //------------------------------------------------------------------------------
 // Declaration
@@ -35,10 +38,12 @@ public:
   CPPUNIT_TEST_SUITE(OtherTests);
   CPPUNIT_TEST(pathSplitterTest);
   CPPUNIT_TEST(lruTest);
+  CPPUNIT_TEST(shardedCacheTest);
   CPPUNIT_TEST_SUITE_END();
 
   void pathSplitterTest();
   void lruTest();
+  void shardedCacheTest();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(OtherTests);
@@ -150,3 +155,74 @@ OtherTests::lruTest()
   // Obect 102 should have been evicted from the cache
   CPPUNIT_ASSERT(!cache.get(100));
 }
+
+//------------------------------------------------------------------------------
+// Test sharded namespace cache eviction, pinning and negative entries
+//------------------------------------------------------------------------------
+void
+OtherTests::shardedCacheTest()
+{
+  struct Entry {
+    explicit Entry(std::uint64_t id) : id_(id) {}
+
+    std::uint64_t
+    getId() const
+    {
+      return id_;
+    }
+
+    std::uint64_t id_;
+  };
+
+  std::uint64_t max_size = 1000;
+  eos::ShardedCache<std::uint64_t, Entry> cache{max_size, 8};
+
+  for (std::uint64_t id = 0; id < max_size; ++id) {
+    CPPUNIT_ASSERT(cache.put(id, std::make_shared<Entry>(id)));
+  }
+
+  for (std::uint64_t id = 0; id < max_size; ++id) {
+    CPPUNIT_ASSERT(cache.get(id)->getId() == id);
+  }
+
+  // Hold a reference to one object and overflow the cache several times
+  std::shared_ptr<Entry> elem = cache.get(101);
+  CPPUNIT_ASSERT(elem);
+
+  for (std::uint64_t id = max_size; id < 5 * max_size; ++id) {
+    CPPUNIT_ASSERT(cache.put(id, std::make_shared<Entry>(id)));
+  }
+
+  CPPUNIT_ASSERT(cache.size() <= max_size + 1);
+  // Object 101 should still be in cache as we hold a reference to it
+  CPPUNIT_ASSERT(cache.get(101) == elem);
+  // Object 100 should have been evicted from the cache
+  CPPUNIT_ASSERT(!cache.get(100));
+  // Putting an existing id returns the cached object
+  CPPUNIT_ASSERT(cache.put(101, std::make_shared<Entry>(101)) == elem);
+
+  // Negative entries are dropped once the object is added
+  cache.setMissing(max_size * 10);
+  CPPUNIT_ASSERT(cache.isMissing(max_size * 10));
+  cache.put(max_size * 10, std::make_shared<Entry>(max_size * 10));
+  CPPUNIT_ASSERT(!cache.isMissing(max_size * 10));
+  CPPUNIT_ASSERT(cache.remove(max_size * 10));
+  CPPUNIT_ASSERT(!cache.remove(max_size * 10));
+
+  auto stats = cache.getStats();
+  CPPUNIT_ASSERT(stats.mEvictions >= 4 * max_size - 1);
+  CPPUNIT_ASSERT(stats.mNegHits == 1);
+  CPPUNIT_ASSERT(stats.mMisses == 1);
+
+  // Negative entries expire, the id may have been created by someone else
+  eos::ShardedCache<std::uint64_t, Entry> short_cache{max_size, 8,
+      std::chrono::milliseconds(50)};
+  short_cache.setMissing(1);
+  CPPUNIT_ASSERT(short_cache.isMissing(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  CPPUNIT_ASSERT(!short_cache.isMissing(1));
+  // Recording the id again renews the expired entry
+  short_cache.setMissing(1);
+  CPPUNIT_ASSERT(short_cache.getStats().mNegSize == 1);
+  CPPUNIT_ASSERT(short_cache.isMissing(1));
+}
@@ -0,0 +1,1137 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// desc:   Streaming replication of changelog files between two hosts
+//------------------------------------------------------------------------------
+
+#include "namespace/utils/LogShipping.hh"
+#include "namespace/utils/Descriptor.hh"
+#include "namespace/utils/ThreadUtils.hh"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Protocol, all the integers are sent in host byte order like the records
+  // of the changelog itself
+  //
+  // hello:     magic(4) version(2) flags(2) namelen(2) name(namelen)
+  // challenge: nonce(16)
+  // proof:     mac(32) of the hello
+  // reply:     offset(8) mac(32) - size of the receiver's copy, REFUSED(8)
+  //            without mac on error
+  // batch:     magic(4) length(4) offset(8) data(length) mac(32)
+  // ack:       offset(8) mac(32) - size of the receiver's copy after the batch
+  //
+  // The macs are HMAC-SHA256 digests keyed with HMAC-SHA256(secret, nonce),
+  // the shared secret never goes over the wire and a connection can not be
+  // replayed with another nonce.
+  //----------------------------------------------------------------------------
+  const uint32_t HELLO_MAGIC      = 0x4c534845;
+  const uint32_t BATCH_MAGIC      = 0x4c534842;
+  const uint16_t PROTOCOL_VERSION = 2;
+  const uint16_t FLAG_RESET       = 0x0001;
+  const uint64_t REFUSED          = (uint64_t)-1;
+  const unsigned NONCE_LEN        = 16;
+  const unsigned MAC_LEN          = 32;
+
+  //----------------------------------------------------------------------------
+  // Throw an MDException with the given message
+  //----------------------------------------------------------------------------
+  void throwError( int errorNo, const std::string &message )
+  {
+    eos::MDException e( errorNo );
+    e.getMessage() << message;
+    throw e;
+  }
+
+  //----------------------------------------------------------------------------
+  // Monotonic enough time in milliseconds
+  //----------------------------------------------------------------------------
+  uint64_t nowMs()
+  {
+    timeval tv;
+    gettimeofday( &tv, 0 );
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  }
+
+  //----------------------------------------------------------------------------
+  // Compute the HMAC-SHA256 of data, mac has to hold MAC_LEN bytes
+  //----------------------------------------------------------------------------
+  void computeMac( const std::string &key, const char *data, size_t len,
+                   char *mac )
+  {
+    unsigned macLen = MAC_LEN;
+    HMAC( EVP_sha256(), key.c_str(), key.length(),
+          (const unsigned char*)data, len, (unsigned char*)mac, &macLen );
+  }
+
+  //----------------------------------------------------------------------------
+  // Check the HMAC-SHA256 of data in constant time
+  //----------------------------------------------------------------------------
+  bool checkMac( const std::string &key, const char *data, size_t len,
+                 const char *mac )
+  {
+    char expected[MAC_LEN];
+    computeMac( key, data, len, expected );
+    return CRYPTO_memcmp( expected, mac, MAC_LEN ) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Derive the key of a connection from the shared secret and the nonce
+  //----------------------------------------------------------------------------
+  std::string sessionKey( const std::string &secret, const char *nonce )
+  {
+    std::string key( MAC_LEN, '\0' );
+    computeMac( secret, nonce, NONCE_LEN, &key[0] );
+    return key;
+  }
+
+  //----------------------------------------------------------------------------
+  // Send an offset followed by its mac
+  //----------------------------------------------------------------------------
+  void writeOffset( eos::Descriptor &socket, const std::string &key,
+                    uint64_t offset ) throw( eos::DescriptorException )
+  {
+    char message[8 + MAC_LEN];
+    memcpy( message, &offset, 8 );
+    computeMac( key, message, 8, message + 8 );
+    socket.write( message, sizeof( message ) );
+  }
+
+  //----------------------------------------------------------------------------
+  // Check if host resolves to the address of a peer
+  //----------------------------------------------------------------------------
+  bool isHostAddress( const std::string &host, const sockaddr_in &peer )
+  {
+    addrinfo  hints;
+    addrinfo *result = 0;
+    memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if( getaddrinfo( host.c_str(), 0, &hints, &result ) )
+      return false;
+
+    bool found = false;
+    for( addrinfo *ai = result; ai && !found; ai = ai->ai_next )
+    {
+      const sockaddr_in *addr = (const sockaddr_in*)ai->ai_addr;
+      found = (addr->sin_addr.s_addr == peer.sin_addr.s_addr);
+    }
+    freeaddrinfo( result );
+    return found;
+  }
+
+  //----------------------------------------------------------------------------
+  // Connect to a host, return the descriptor. The connection attempt is given
+  // up as soon as stop is set.
+  //----------------------------------------------------------------------------
+  int connectTo( const std::string &host, unsigned port,
+                 const volatile bool &stop )
+    throw( eos::DescriptorException )
+  {
+    addrinfo  hints;
+    addrinfo *result = 0;
+    char      service[16];
+    memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf( service, sizeof( service ), "%u", port );
+
+    int status = getaddrinfo( host.c_str(), service, &hints, &result );
+    if( status )
+    {
+      eos::DescriptorException ex;
+      ex.getMessage() << "Unable to resolve " << host << ": ";
+      ex.getMessage() << gai_strerror( status );
+      throw ex;
+    }
+
+    int fd    = -1;
+    int error = 0;
+    for( addrinfo *ai = result; ai; ai = ai->ai_next )
+    {
+      fd = ::socket( ai->ai_family, ai->ai_socktype, ai->ai_protocol );
+      if( fd < 0 )
+      {
+        error = errno;
+        continue;
+      }
+
+      // connect in the background to be able to give up when stopped
+      int flags = ::fcntl( fd, F_GETFL );
+      ::fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+
+      if( ::connect( fd, ai->ai_addr, ai->ai_addrlen ) == 0 )
+        error = 0;
+      else if( errno != EINPROGRESS )
+        error = errno;
+      else
+      {
+        error = ETIMEDOUT;
+        while( !stop )
+        {
+          pollfd pollDesc;
+          memset( &pollDesc, 0, sizeof( pollfd ) );
+          pollDesc.fd     = fd;
+          pollDesc.events = POLLOUT;
+
+          int ret = poll( &pollDesc, 1, 200 );
+          if( ret < 0 && errno != EINTR )
+          {
+            error = errno;
+            break;
+          }
+          if( ret > 0 )
+          {
+            socklen_t len = sizeof( error );
+            if( ::getsockopt( fd, SOL_SOCKET, SO_ERROR, &error, &len ) )
+              error = errno;
+            break;
+          }
+        }
+        if( stop )
+          error = EINTR;
+      }
+
+      if( !error )
+      {
+        ::fcntl( fd, F_SETFL, flags );
+        break;
+      }
+
+      ::close( fd );
+      fd = -1;
+      if( stop )
+        break;
+    }
+    freeaddrinfo( result );
+
+    if( fd < 0 )
+    {
+      eos::DescriptorException ex;
+      ex.getMessage() << "Unable to connect to " << host << ":" << port;
+      ex.getMessage() << ": " << strerror( error );
+      throw ex;
+    }
+
+    // the batches are small and latency matters
+    int one = 1;
+    ::setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+    return fd;
+  }
+
+  //----------------------------------------------------------------------------
+  // Read exactly len bytes at offset from a file
+  //----------------------------------------------------------------------------
+  bool readAt( int fd, char *buffer, size_t len, off_t offset )
+  {
+    while( len )
+    {
+      ssize_t ret = ::pread( fd, buffer, len, offset );
+      if( ret < 0 && errno == EINTR )
+        continue;
+      if( ret <= 0 )
+        return false;
+      buffer += ret;
+      offset += ret;
+      len    -= ret;
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Write exactly len bytes at offset to a file
+  //----------------------------------------------------------------------------
+  bool writeAt( int fd, const char *buffer, size_t len, off_t offset )
+  {
+    while( len )
+    {
+      ssize_t ret = ::pwrite( fd, buffer, len, offset );
+      if( ret < 0 && errno == EINTR )
+        continue;
+      if( ret <= 0 )
+        return false;
+      buffer += ret;
+      offset += ret;
+      len    -= ret;
+    }
+    return true;
+  }
+}
+
+namespace eos
+{
+  //----------------------------------------------------------------------------
+  // Constructor
+  //----------------------------------------------------------------------------
+  LogShipper::LogShipper( const std::string &path, const std::string &host,
+                          unsigned port, const std::string &secret ):
+    pPath( path ), pHost( host ), pPort( port ), pSecret( secret ),
+    pThread( 0 ),
+    pStarted( false ), pStop( false ), pFd( -1 ), pInode( 0 ),
+    pInotifyFd( -1 ), pWatchFd( -1 ), pReset( false ), pSocketFd( -1 ),
+    pPendingSince( 0 )
+  {
+    size_t pos = path.rfind( '/' );
+    pName = (pos == std::string::npos) ? path : path.substr( pos + 1 );
+    pthread_mutex_init( &pMutex, 0 );
+  }
+
+  //----------------------------------------------------------------------------
+  // Destructor
+  //----------------------------------------------------------------------------
+  LogShipper::~LogShipper()
+  {
+    stop();
+
+    if( pInotifyFd >= 0 )
+      ::close( pInotifyFd );
+
+    if( pFd >= 0 )
+      ::close( pFd );
+
+    pthread_mutex_destroy( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Start the shipping thread
+  //----------------------------------------------------------------------------
+  void LogShipper::start() throw( MDException )
+  {
+    if( pStarted )
+      return;
+
+    if( pSecret.empty() )
+      throwError( EINVAL, "LogShipper: no shared secret to ship " + pPath );
+
+    pStop = false;
+    int rc = pthread_create( &pThread, 0, shipperThread, this );
+    if( rc )
+    {
+      MDException e( rc );
+      e.getMessage() << "LogShipper: unable to start the shipper for ";
+      e.getMessage() << pPath << ": " << strerror( rc );
+      throw e;
+    }
+    pStarted = true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Stop the shipping thread
+  //----------------------------------------------------------------------------
+  void LogShipper::stop()
+  {
+    if( !pStarted )
+      return;
+
+    pStop = true;
+
+    // unblock the thread if it waits for the receiver
+    pthread_mutex_lock( &pMutex );
+    if( pSocketFd >= 0 )
+      ::shutdown( pSocketFd, SHUT_RDWR );
+    pthread_mutex_unlock( &pMutex );
+
+    pthread_join( pThread, 0 );
+    pStarted = false;
+  }
+
+  //----------------------------------------------------------------------------
+  // Get the statistics
+  //----------------------------------------------------------------------------
+  void LogShipper::getStats( LogShipperStats &stats )
+  {
+    pthread_mutex_lock( &pMutex );
+    stats = pStats;
+    if( pPendingSince )
+      stats.lagMs = nowMs() - pPendingSince;
+    else
+      stats.lagMs = 0;
+    pthread_mutex_unlock( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Thread start function
+  //----------------------------------------------------------------------------
+  void *LogShipper::shipperThread( void *data )
+  {
+    ThreadUtils::blockAIOSignals();
+    LogShipper *shipper = reinterpret_cast<LogShipper*>( data );
+    shipper->ship();
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Open the local log, reopen it if it has been replaced
+  //----------------------------------------------------------------------------
+  bool LogShipper::openLog()
+  {
+    struct stat st;
+    if( ::stat( pPath.c_str(), &st ) )
+      return false;
+
+    if( pFd >= 0 && st.st_ino == pInode )
+      return true;
+
+    if( pFd >= 0 )
+    {
+      // a new file, the remote copy has to start from scratch as well
+      ::close( pFd );
+      pFd    = -1;
+      pReset = true;
+    }
+
+    pFd = ::open( pPath.c_str(), O_RDONLY );
+    if( pFd < 0 )
+      return false;
+
+    if( ::fstat( pFd, &st ) )
+    {
+      ::close( pFd );
+      pFd = -1;
+      return false;
+    }
+    pInode = st.st_ino;
+
+#ifdef __linux__
+    if( pInotifyFd < 0 )
+      pInotifyFd = inotify_init1( IN_NONBLOCK );
+
+    if( pInotifyFd >= 0 )
+    {
+      if( pWatchFd >= 0 )
+        inotify_rm_watch( pInotifyFd, pWatchFd );
+      pWatchFd = inotify_add_watch( pInotifyFd, pPath.c_str(),
+                                    IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF |
+                                    IN_DELETE_SELF );
+    }
+#endif
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Wait until the log grows beyond offset or timeout milliseconds passed
+  //----------------------------------------------------------------------------
+  bool LogShipper::waitForData( uint64_t offset, unsigned timeout )
+  {
+    struct stat st;
+    if( !::fstat( pFd, &st ) && (uint64_t)st.st_size > offset )
+      return true;
+
+#ifdef __linux__
+    if( pInotifyFd >= 0 && pWatchFd >= 0 )
+    {
+      pollfd pollDesc;
+      memset( &pollDesc, 0, sizeof( pollfd ) );
+      pollDesc.fd     = pInotifyFd;
+      pollDesc.events = POLLIN;
+
+      if( poll( &pollDesc, 1, timeout ) > 0 )
+      {
+        // drain the queued events, only the file size matters
+        char events[4096];
+        while( ::read( pInotifyFd, events, sizeof( events ) ) > 0 ) {}
+      }
+    }
+    else
+#endif
+    {
+      usleep( 10000 );
+    }
+
+    return !::fstat( pFd, &st ) && (uint64_t)st.st_size > offset;
+  }
+
+  //----------------------------------------------------------------------------
+  // Register the socket of the current connection
+  //----------------------------------------------------------------------------
+  void LogShipper::setConnected( int fd )
+  {
+    pthread_mutex_lock( &pMutex );
+    pSocketFd = fd;
+    pStats.connected = false;
+    if( fd >= 0 )
+    {
+      pStats.reconnects++;
+      // stop might have missed the socket
+      if( pStop )
+        ::shutdown( fd, SHUT_RDWR );
+    }
+    pthread_mutex_unlock( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Remember the last error
+  //----------------------------------------------------------------------------
+  void LogShipper::setError( const std::string &error )
+  {
+    pthread_mutex_lock( &pMutex );
+    pStats.lastError = error;
+    pthread_mutex_unlock( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Ship the log until stopped
+  //----------------------------------------------------------------------------
+  void LogShipper::ship()
+  {
+    std::vector<char> buffer;
+
+    while( !pStop )
+    {
+      int  fd     = -1;
+      bool failed = false;
+
+      try
+      {
+        if( !openLog() )
+        {
+          std::ostringstream o;
+          o << "Unable to open " << pPath << ": " << strerror( errno );
+          throwError( ENOENT, o.str() );
+        }
+
+        fd = connectTo( pHost, pPort, pStop );
+        setConnected( fd );
+        Descriptor socket( fd );
+
+        //----------------------------------------------------------------------
+        // Say hello, prove that we know the secret and get the offset to
+        // resume from
+        //----------------------------------------------------------------------
+        uint16_t nameLen = pName.length();
+        uint16_t flags   = pReset ? FLAG_RESET : 0;
+        std::string hello( 10 + nameLen, '\0' );
+        memcpy( &hello[0], &HELLO_MAGIC, 4 );
+        memcpy( &hello[4], &PROTOCOL_VERSION, 2 );
+        memcpy( &hello[6], &flags, 2 );
+        memcpy( &hello[8], &nameLen, 2 );
+        memcpy( &hello[10], pName.c_str(), nameLen );
+        socket.write( hello.c_str(), hello.length() );
+
+        char nonce[NONCE_LEN];
+        socket.readBlocking( nonce, NONCE_LEN );
+        std::string key = sessionKey( pSecret, nonce );
+
+        char mac[MAC_LEN];
+        computeMac( key, hello.c_str(), hello.length(), mac );
+        socket.write( mac, MAC_LEN );
+
+        uint64_t acked = 0;
+        socket.readBlocking( (char*)&acked, 8 );
+
+        if( acked == REFUSED )
+          throwError( EPERM, "The receiver refused " + pName );
+
+        socket.readBlocking( mac, MAC_LEN );
+        if( !checkMac( key, (char*)&acked, 8, mac ) )
+          throwError( EPERM, "The receiver of " + pName +
+                             " failed to authenticate" );
+
+        struct stat st;
+        if( ::fstat( pFd, &st ) )
+          throwError( errno, "Unable to stat " + pPath );
+
+        if( acked > (uint64_t)st.st_size )
+        {
+          // the remote copy is not a prefix of our log, rotate it away
+          pReset = true;
+          throwError( EINVAL, "The remote copy of " + pName +
+                                     " is longer than the local log" );
+        }
+
+        pReset = false;
+        pthread_mutex_lock( &pMutex );
+        pStats.connected   = true;
+        pStats.ackedOffset = acked;
+        pStats.lastError.clear();
+        pthread_mutex_unlock( &pMutex );
+
+        //----------------------------------------------------------------------
+        // Ship whatever has been appended since the last acknowledgement
+        //----------------------------------------------------------------------
+        while( !pStop )
+        {
+          if( ::stat( pPath.c_str(), &st ) || st.st_ino != pInode )
+          {
+            // the log has been replaced, reconnect to reset the remote copy
+            break;
+          }
+
+          if( ::fstat( pFd, &st ) )
+            throwError( errno, "Unable to stat " + pPath );
+
+          uint64_t size = st.st_size;
+          pthread_mutex_lock( &pMutex );
+          pStats.localOffset = size;
+          if( size > acked && !pPendingSince )
+            pPendingSince = nowMs();
+          pthread_mutex_unlock( &pMutex );
+
+          if( size <= acked )
+          {
+            waitForData( acked, 200 );
+            continue;
+          }
+
+          uint32_t len = (size - acked > sMaxBatch) ? sMaxBatch : size - acked;
+          buffer.resize( 16 + len + MAC_LEN );
+          if( !readAt( pFd, &buffer[16], len, acked ) )
+            throwError( EIO, "Unable to read " + pPath );
+
+          memcpy( &buffer[0], &BATCH_MAGIC, 4 );
+          memcpy( &buffer[4], &len, 4 );
+          memcpy( &buffer[8], &acked, 8 );
+          computeMac( key, &buffer[0], 16 + len, &buffer[16 + len] );
+
+          uint64_t sent = nowMs();
+          socket.write( &buffer[0], 16 + len + MAC_LEN );
+
+          uint64_t ack = 0;
+          socket.readBlocking( (char*)&ack, 8 );
+          socket.readBlocking( mac, MAC_LEN );
+          uint64_t received = nowMs();
+
+          if( !checkMac( key, (char*)&ack, 8, mac ) )
+            throwError( EPROTO, "Unauthenticated acknowledgement for " + pName );
+
+          if( ack != acked + len )
+          {
+            std::ostringstream o;
+            o << "Unexpected acknowledgement for " << pName << ": " << ack;
+            o << " instead of " << acked + len;
+            throwError( EPROTO, o.str() );
+          }
+          acked = ack;
+
+          pthread_mutex_lock( &pMutex );
+          pStats.ackedOffset   = acked;
+          pStats.rttMs         = received - sent;
+          pStats.bytesShipped += len;
+          pStats.batches++;
+          pStats.lastAck       = time( 0 );
+
+          // what is left was appended at the earliest while the batch was in
+          // flight, unless the batch was truncated to sMaxBatch
+          if( pStats.localOffset <= acked )
+            pPendingSince = 0;
+          else if( len < sMaxBatch )
+            pPendingSince = sent;
+          pthread_mutex_unlock( &pMutex );
+        }
+      }
+      catch( DescriptorException &e )
+      {
+        setError( e.getMessage().str() );
+        failed = true;
+      }
+      catch( MDException &e )
+      {
+        setError( e.getMessage().str() );
+        failed = !pReset;
+      }
+
+      pthread_mutex_lock( &pMutex );
+      pSocketFd        = -1;
+      pStats.connected = false;
+      pthread_mutex_unlock( &pMutex );
+
+      if( fd >= 0 )
+        ::close( fd );
+
+      // retry after a second, unless only the remote copy needs a reset
+      for( int i = 0; failed && i < 10 && !pStop; ++i )
+        usleep( 100000 );
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Constructor
+  //----------------------------------------------------------------------------
+  LogReceiver::LogReceiver( const std::string &directory, unsigned port,
+                            const std::string &secret ):
+    pDirectory( directory ), pPort( port ), pSecret( secret ),
+    pListenFd( -1 ), pThread( 0 ),
+    pStarted( false ), pStop( false )
+  {
+    pthread_mutex_init( &pMutex, 0 );
+  }
+
+  //----------------------------------------------------------------------------
+  // Destructor
+  //----------------------------------------------------------------------------
+  LogReceiver::~LogReceiver()
+  {
+    stop();
+    pthread_mutex_destroy( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Accept the log with the given name
+  //----------------------------------------------------------------------------
+  void LogReceiver::allow( const std::string &name )
+  {
+    pthread_mutex_lock( &pMutex );
+    pAllowed.insert( name );
+    pStats[name];
+    pthread_mutex_unlock( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Accept connections from the given host
+  //----------------------------------------------------------------------------
+  void LogReceiver::allowPeer( const std::string &host )
+  {
+    pthread_mutex_lock( &pMutex );
+    pPeers.insert( host );
+    pthread_mutex_unlock( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Check if a connection comes from an accepted host
+  //----------------------------------------------------------------------------
+  bool LogReceiver::isAllowedPeer( int fd )
+  {
+    sockaddr_in peer;
+    socklen_t   len = sizeof( peer );
+    if( ::getpeername( fd, (sockaddr*)&peer, &len ) ||
+        peer.sin_family != AF_INET )
+      return false;
+
+    pthread_mutex_lock( &pMutex );
+    std::set<std::string> peers = pPeers;
+    pthread_mutex_unlock( &pMutex );
+
+    // resolve the names every time, the addresses of the hosts may change
+    for( std::set<std::string>::const_iterator it = peers.begin();
+         it != peers.end(); ++it )
+    {
+      if( isHostAddress( *it, peer ) )
+        return true;
+    }
+    return false;
+  }
+
+  //----------------------------------------------------------------------------
+  // Start listening
+  //----------------------------------------------------------------------------
+  void LogReceiver::start() throw( MDException )
+  {
+    if( pStarted )
+      return;
+
+    if( pSecret.empty() )
+      throwError( EINVAL, "LogReceiver: no shared secret to authenticate "
+                          "the shippers" );
+
+    pListenFd = ::socket( AF_INET, SOCK_STREAM, 0 );
+    if( pListenFd < 0 )
+    {
+      MDException e( errno );
+      e.getMessage() << "LogReceiver: unable to create socket: ";
+      e.getMessage() << strerror( errno );
+      throw e;
+    }
+
+    int one = 1;
+    ::setsockopt( pListenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) );
+
+    sockaddr_in addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port        = htons( (unsigned short)pPort );
+
+    if( ::bind( pListenFd, (sockaddr*)&addr, sizeof( addr ) ) ||
+        ::listen( pListenFd, 20 ) )
+    {
+      MDException e( errno );
+      e.getMessage() << "LogReceiver: unable to listen on port " << pPort;
+      e.getMessage() << ": " << strerror( errno );
+      ::close( pListenFd );
+      pListenFd = -1;
+      throw e;
+    }
+
+    pStop = false;
+    int rc = pthread_create( &pThread, 0, acceptThread, this );
+    if( rc )
+    {
+      MDException e( rc );
+      e.getMessage() << "LogReceiver: unable to start the receiver: ";
+      e.getMessage() << strerror( rc );
+      ::close( pListenFd );
+      pListenFd = -1;
+      throw e;
+    }
+    pStarted = true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Stop listening and drop all connections
+  //----------------------------------------------------------------------------
+  void LogReceiver::stop()
+  {
+    if( !pStarted )
+      return;
+
+    pStop = true;
+    pthread_join( pThread, 0 );
+    ::close( pListenFd );
+    pListenFd = -1;
+
+    pthread_mutex_lock( &pMutex );
+    for( std::list<Connection*>::iterator it = pConnections.begin();
+         it != pConnections.end(); ++it )
+    {
+      if( (*it)->fd >= 0 )
+        ::shutdown( (*it)->fd, SHUT_RDWR );
+    }
+    pthread_mutex_unlock( &pMutex );
+
+    reapConnections( true );
+    pStarted = false;
+  }
+
+  //----------------------------------------------------------------------------
+  // Get the statistics of all the accepted logs
+  //----------------------------------------------------------------------------
+  void LogReceiver::getStats( std::map<std::string, LogReceiverStats> &stats )
+  {
+    pthread_mutex_lock( &pMutex );
+    stats = pStats;
+    pthread_mutex_unlock( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Record a connection error for a log, under the empty name if the log is
+  // not accepted or not known yet
+  //----------------------------------------------------------------------------
+  void LogReceiver::setError( const std::string &name,
+                              const std::string &error )
+  {
+    pthread_mutex_lock( &pMutex );
+    LogReceiverStats &stats = pStats[pAllowed.count( name ) ? name : ""];
+    stats.errors++;
+    stats.lastError = error;
+    pthread_mutex_unlock( &pMutex );
+  }
+
+  //----------------------------------------------------------------------------
+  // Thread start functions
+  //----------------------------------------------------------------------------
+  void *LogReceiver::acceptThread( void *data )
+  {
+    ThreadUtils::blockAIOSignals();
+    LogReceiver *receiver = reinterpret_cast<LogReceiver*>( data );
+    receiver->acceptConnections();
+    return 0;
+  }
+
+  void *LogReceiver::connectionThread( void *data )
+  {
+    ThreadUtils::blockAIOSignals();
+    Connection *conn = reinterpret_cast<Connection*>( data );
+    conn->receiver->receive( conn );
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Join the finished connection threads, or all of them
+  //----------------------------------------------------------------------------
+  void LogReceiver::reapConnections( bool all )
+  {
+    std::list<Connection*> finished;
+    pthread_mutex_lock( &pMutex );
+    std::list<Connection*>::iterator it = pConnections.begin();
+    while( it != pConnections.end() )
+    {
+      if( all || (*it)->done )
+      {
+        finished.push_back( *it );
+        it = pConnections.erase( it );
+      }
+      else
+        ++it;
+    }
+    pthread_mutex_unlock( &pMutex );
+
+    for( it = finished.begin(); it != finished.end(); ++it )
+    {
+      pthread_join( (*it)->thread, 0 );
+      delete *it;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Accept the shippers' connections
+  //----------------------------------------------------------------------------
+  void LogReceiver::acceptConnections()
+  {
+    while( !pStop )
+    {
+      reapConnections( false );
+
+      pollfd pollDesc;
+      memset( &pollDesc, 0, sizeof( pollfd ) );
+      pollDesc.fd     = pListenFd;
+      pollDesc.events = POLLIN;
+
+      if( poll( &pollDesc, 1, 200 ) <= 0 )
+        continue;
+
+      int fd = ::accept( pListenFd, 0, 0 );
+      if( fd < 0 )
+        continue;
+
+      int one = 1;
+      ::setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+
+      Connection *conn = new Connection();
+      conn->receiver = this;
+      conn->fd       = fd;
+      conn->done     = false;
+
+      pthread_mutex_lock( &pMutex );
+      int rc = pthread_create( &conn->thread, 0, connectionThread, conn );
+      if( rc )
+      {
+        pthread_mutex_unlock( &pMutex );
+        ::close( fd );
+        delete conn;
+        setError( "", std::string( "Unable to start a connection thread: " ) +
+                      strerror( rc ) );
+        continue;
+      }
+      pConnections.push_back( conn );
+      pthread_mutex_unlock( &pMutex );
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Write the batches of a shipper to the local copy of its log
+  //----------------------------------------------------------------------------
+  void LogReceiver::receive( Connection *conn )
+  {
+    Descriptor        socket( conn->fd );
+    std::string       name;
+    std::string       key;
+    bool              registered = false;
+    int               logFd      = -1;
+    std::vector<char> buffer;
+
+    try
+    {
+      if( !isAllowedPeer( conn->fd ) )
+        throwError( EPERM, "Refused connection from an unknown host" );
+
+      //------------------------------------------------------------------------
+      // Check the hello and that the shipper knows the secret
+      //------------------------------------------------------------------------
+      char     header[16];
+      uint32_t magic;
+      uint16_t version, flags, nameLen;
+      socket.readBlocking( header, 10 );
+      memcpy( &magic,   header,     4 );
+      memcpy( &version, header + 4, 2 );
+      memcpy( &flags,   header + 6, 2 );
+      memcpy( &nameLen, header + 8, 2 );
+
+      if( magic != HELLO_MAGIC || version != PROTOCOL_VERSION ||
+          !nameLen || nameLen > 255 )
+        throwError( EPROTO, "Invalid hello" );
+
+      name.resize( nameLen );
+      socket.readBlocking( &name[0], nameLen );
+
+      char nonce[NONCE_LEN];
+      if( RAND_bytes( (unsigned char*)nonce, NONCE_LEN ) != 1 )
+        throwError( EIO, "Unable to generate a nonce" );
+      socket.write( nonce, NONCE_LEN );
+      key = sessionKey( pSecret, nonce );
+
+      std::string hello( header, 10 );
+      hello += name;
+      char mac[MAC_LEN];
+      socket.readBlocking( mac, MAC_LEN );
+      if( !checkMac( key, hello.c_str(), hello.length(), mac ) )
+        throwError( EPERM, "Authentication failed for log " + name );
+
+      pthread_mutex_lock( &pMutex );
+      if( pAllowed.count( name ) )
+      {
+        std::map<std::string, Connection*>::iterator it = pActive.find( name );
+        if( it == pActive.end() )
+        {
+          pActive[name] = conn;
+          registered    = true;
+        }
+        else if( it->second->fd >= 0 )
+        {
+          // the shipper reconnected, drop the stale connection, the shipper
+          // gets in with its next attempt
+          ::shutdown( it->second->fd, SHUT_RDWR );
+        }
+      }
+      pthread_mutex_unlock( &pMutex );
+
+      if( !registered )
+        throwError( EPERM, "Refused log " + name );
+
+      //------------------------------------------------------------------------
+      // Open the local copy, rotate it away if the shipper starts over
+      //------------------------------------------------------------------------
+      std::string path = pDirectory + "/" + name;
+      struct stat st;
+
+      if( (flags & FLAG_RESET) && !::stat( path.c_str(), &st ) )
+      {
+        std::ostringstream backup;
+        backup << path << "." << time( 0 );
+        if( ::rename( path.c_str(), backup.str().c_str() ) )
+          throwError( errno, "Unable to rotate " + path );
+      }
+
+      logFd = ::open( path.c_str(), O_WRONLY | O_CREAT, 0644 );
+      if( logFd < 0 || ::fstat( logFd, &st ) )
+        throwError( errno, "Unable to open " + path );
+
+      uint64_t size = st.st_size;
+      writeOffset( socket, key, size );
+
+      pthread_mutex_lock( &pMutex );
+      pStats[name].connected = true;
+      pStats[name].offset    = size;
+      pthread_mutex_unlock( &pMutex );
+
+      //------------------------------------------------------------------------
+      // Append the batches and acknowledge them
+      //------------------------------------------------------------------------
+      time_t lastSync = time( 0 );
+      while( !pStop )
+      {
+        uint32_t len;
+        uint64_t offset;
+        socket.readBlocking( header, 16 );
+        memcpy( &magic,  header,     4 );
+        memcpy( &len,    header + 4, 4 );
+        memcpy( &offset, header + 8, 8 );
+
+        if( magic != BATCH_MAGIC || len > LogShipper::sMaxBatch ||
+            offset != size )
+          throwError( EPROTO, "Invalid batch for " + name );
+
+        // nothing is written before the whole batch is authenticated
+        buffer.resize( 16 + len + MAC_LEN );
+        memcpy( &buffer[0], header, 16 );
+        socket.readBlocking( &buffer[16], len + MAC_LEN );
+
+        if( !checkMac( key, &buffer[0], 16 + len, &buffer[16 + len] ) )
+          throwError( EPERM, "Unauthenticated batch for " + name );
+
+        if( !writeAt( logFd, &buffer[16], len, offset ) )
+          throwError( errno, "Unable to write " + path );
+
+        size += len;
+
+        // sync once a second like eosfilesync did
+        time_t now = time( 0 );
+        if( now != lastSync )
+        {
+          fdatasync( logFd );
+          lastSync = now;
+        }
+
+        writeOffset( socket, key, size );
+
+        pthread_mutex_lock( &pMutex );
+        LogReceiverStats &stats = pStats[name];
+        stats.offset         = size;
+        stats.bytesReceived += len;
+        stats.batches++;
+        stats.lastReceive    = now;
+        pthread_mutex_unlock( &pMutex );
+      }
+    }
+    catch( DescriptorException &e )
+    {
+      // a dropped connection is only an error while we are running
+      if( !pStop )
+        setError( name, e.getMessage().str() );
+    }
+    catch( MDException &e )
+    {
+      if( !registered )
+      {
+        try
+        {
+          socket.write( (char*)&REFUSED, 8 );
+        }
+        catch( DescriptorException &e )
+        {
+        }
+      }
+      setError( name, e.getMessage().str() );
+    }
+
+    if( logFd >= 0 )
+    {
+      fdatasync( logFd );
+      ::close( logFd );
+    }
+
+    pthread_mutex_lock( &pMutex );
+    if( registered )
+    {
+      pActive.erase( name );
+      pStats[name].connected = false;
+    }
+    ::close( conn->fd );
+    conn->fd   = -1;
+    conn->done = true;
+    pthread_mutex_unlock( &pMutex );
+  }
+}
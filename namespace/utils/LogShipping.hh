@@ -0,0 +1,261 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// desc:   Streaming replication of changelog files between two hosts
+//------------------------------------------------------------------------------
+
+#ifndef EOS_NS_LOG_SHIPPING_HH
+#define EOS_NS_LOG_SHIPPING_HH
+
+#include <string>
+#include <map>
+#include <set>
+#include <list>
+#include <stdint.h>
+#include <ctime>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "namespace/MDException.hh"
+
+namespace eos
+{
+  //----------------------------------------------------------------------------
+  //! Statistics of a log shipper
+  //----------------------------------------------------------------------------
+  struct LogShipperStats
+  {
+    LogShipperStats(): connected( false ), localOffset( 0 ), ackedOffset( 0 ),
+                       lagMs( 0 ), rttMs( 0 ), bytesShipped( 0 ),
+                       batches( 0 ), reconnects( 0 ), lastAck( 0 ) {}
+
+    bool        connected;    //!< connected to the receiver
+    uint64_t    localOffset;  //!< size of the local changelog
+    uint64_t    ackedOffset;  //!< offset acknowledged by the receiver
+    uint64_t    lagMs;        //!< age of the oldest unacknowledged data
+    uint64_t    rttMs;        //!< round trip time of the last batch
+    uint64_t    bytesShipped; //!< bytes shipped since the start
+    uint64_t    batches;      //!< batches shipped since the start
+    uint64_t    reconnects;   //!< connections established since the start
+    time_t      lastAck;      //!< time of the last acknowledgement
+    std::string lastError;    //!< last connection error
+  };
+
+  //----------------------------------------------------------------------------
+  //! Statistics of a log stream received from a shipper
+  //----------------------------------------------------------------------------
+  struct LogReceiverStats
+  {
+    LogReceiverStats(): connected( false ), offset( 0 ), bytesReceived( 0 ),
+                        batches( 0 ), errors( 0 ), lastReceive( 0 ) {}
+
+    bool        connected;     //!< a shipper is connected for this log
+    uint64_t    offset;        //!< size of the local copy of the log
+    uint64_t    bytesReceived; //!< bytes received since the start
+    uint64_t    batches;       //!< batches received since the start
+    uint64_t    errors;        //!< refused or failed connections
+    time_t      lastReceive;   //!< time of the last batch
+    std::string lastError;     //!< last connection error
+  };
+
+  //----------------------------------------------------------------------------
+  //! Ship a changelog file to a remote LogReceiver
+  //!
+  //! A background thread keeps a persistent connection to the receiver, waits
+  //! (inotify) for the local log to grow and sends everything appended since
+  //! the last acknowledged offset in one batch of at most sMaxBatch bytes.
+  //! Records appended while a batch is in flight go with the next one. The
+  //! receiver acknowledges the offset it has written, this offset is where the
+  //! shipping resumes after a reconnection. If the local log is replaced by a
+  //! new file (compaction, slave to master transition) or the remote copy is
+  //! longer than the local log, the remote copy is rotated away and shipped
+  //! again from the start. Both sides prove the knowledge of a shared secret
+  //! and every batch and acknowledgement carries a mac keyed with it.
+  //----------------------------------------------------------------------------
+  class LogShipper
+  {
+    public:
+      //------------------------------------------------------------------------
+      //! Maximum size of a batch
+      //------------------------------------------------------------------------
+      static const uint32_t sMaxBatch = 4 * 1024 * 1024;
+
+      //------------------------------------------------------------------------
+      //! Constructor
+      //!
+      //! @param path   path of the local changelog file
+      //! @param host   host of the receiver
+      //! @param port   port of the receiver
+      //! @param secret secret shared with the receiver
+      //------------------------------------------------------------------------
+      LogShipper( const std::string &path, const std::string &host,
+                  unsigned port, const std::string &secret );
+
+      //------------------------------------------------------------------------
+      //! Destructor
+      //------------------------------------------------------------------------
+      virtual ~LogShipper();
+
+      //------------------------------------------------------------------------
+      //! Start the shipping thread
+      //------------------------------------------------------------------------
+      void start() throw( MDException );
+
+      //------------------------------------------------------------------------
+      //! Stop the shipping thread, interrupts a pending connection attempt
+      //------------------------------------------------------------------------
+      void stop();
+
+      //------------------------------------------------------------------------
+      //! Get the statistics
+      //------------------------------------------------------------------------
+      void getStats( LogShipperStats &stats );
+
+      //------------------------------------------------------------------------
+      //! Get the path of the shipped log
+      //------------------------------------------------------------------------
+      const std::string &getPath() const
+      {
+        return pPath;
+      }
+
+    private:
+      static void *shipperThread( void *data );
+      void ship();
+      bool openLog();
+      bool waitForData( uint64_t offset, unsigned timeout );
+      void setConnected( int fd );
+      void setError( const std::string &error );
+
+      std::string      pPath;
+      std::string      pName;
+      std::string      pHost;
+      unsigned         pPort;
+      std::string      pSecret;
+      pthread_t        pThread;
+      bool             pStarted;
+      volatile bool    pStop;
+      int              pFd;
+      ino_t            pInode;
+      int              pInotifyFd;
+      int              pWatchFd;
+      bool             pReset;
+      pthread_mutex_t  pMutex;       //!< protects pSocketFd and pStats
+      int              pSocketFd;
+      uint64_t         pPendingSince;
+      LogShipperStats  pStats;
+  };
+
+  //----------------------------------------------------------------------------
+  //! Receive changelog files shipped by LogShippers
+  //!
+  //! Listens on a port and writes the batches of each connected shipper at
+  //! the end of the local copy of the log, in the given directory. A follower
+  //! of the local copy sees the records as soon as the batch is written. Only
+  //! connections from the hosts registered with allowPeer and knowing the
+  //! shared secret are accepted, for the log names registered with allow.
+  //! Only one shipper at a time may write a given log.
+  //----------------------------------------------------------------------------
+  class LogReceiver
+  {
+    public:
+      //------------------------------------------------------------------------
+      //! Constructor
+      //!
+      //! @param directory directory of the local copies
+      //! @param port      port to listen on
+      //! @param secret    secret shared with the shippers
+      //------------------------------------------------------------------------
+      LogReceiver( const std::string &directory, unsigned port,
+                   const std::string &secret );
+
+      //------------------------------------------------------------------------
+      //! Destructor
+      //------------------------------------------------------------------------
+      virtual ~LogReceiver();
+
+      //------------------------------------------------------------------------
+      //! Accept the log with the given name
+      //------------------------------------------------------------------------
+      void allow( const std::string &name );
+
+      //------------------------------------------------------------------------
+      //! Accept connections from the given host
+      //------------------------------------------------------------------------
+      void allowPeer( const std::string &host );
+
+      //------------------------------------------------------------------------
+      //! Start listening
+      //------------------------------------------------------------------------
+      void start() throw( MDException );
+
+      //------------------------------------------------------------------------
+      //! Stop listening and drop all connections
+      //------------------------------------------------------------------------
+      void stop();
+
+      //------------------------------------------------------------------------
+      //! Check if the receiver is listening
+      //------------------------------------------------------------------------
+      bool isStarted() const
+      {
+        return pStarted;
+      }
+
+      //------------------------------------------------------------------------
+      //! Get the statistics of all the accepted logs, the errors of the
+      //! connections refused before an accepted log name was known are
+      //! counted under the empty name
+      //------------------------------------------------------------------------
+      void getStats( std::map<std::string, LogReceiverStats> &stats );
+
+    private:
+      struct Connection
+      {
+        LogReceiver   *receiver;
+        pthread_t      thread;
+        int            fd;
+        volatile bool  done;
+      };
+
+      static void *acceptThread( void *data );
+      static void *connectionThread( void *data );
+      void acceptConnections();
+      void receive( Connection *conn );
+      void reapConnections( bool all );
+      bool isAllowedPeer( int fd );
+      void setError( const std::string &name, const std::string &error );
+
+      std::string                             pDirectory;
+      unsigned                                pPort;
+      std::string                             pSecret;
+      int                                     pListenFd;
+      pthread_t                               pThread;
+      bool                                    pStarted;
+      volatile bool                           pStop;
+      pthread_mutex_t                         pMutex; //!< protects all below
+      std::set<std::string>                   pAllowed;
+      std::set<std::string>                   pPeers;
+      std::map<std::string, Connection*>      pActive;
+      std::list<Connection*>                  pConnections;
+      std::map<std::string, LogReceiverStats> pStats;
+  };
+}
+
+#endif // EOS_NS_LOG_SHIPPING_HH
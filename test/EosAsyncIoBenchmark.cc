@@ -0,0 +1,308 @@
+// ----------------------------------------------------------------------
+// File: EosAsyncIoBenchmark.cc
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @brief Benchmark comparing random vector reads on a local file done with
+//!        one blocking read per chunk (the synchronous LocalIo path) against
+//!        the asynchronous engine using a thread pool and io_uring
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include "fst/io/AsyncIoEngine.hh"
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+typedef std::chrono::steady_clock Clock;
+
+//------------------------------------------------------------------------------
+//! Benchmark parameters
+//------------------------------------------------------------------------------
+struct Params
+{
+  std::string mPath; ///< test file
+  uint64_t mFileSize; ///< size of the test file
+  uint32_t mChunks; ///< chunks per vector read
+  uint32_t mChunkSize; ///< size of each chunk
+  uint64_t mReadV; ///< number of vector reads
+  uint32_t mInFlight; ///< vector reads in flight for the async modes
+};
+
+//------------------------------------------------------------------------------
+// Build a random chunk list reading into the given buffer
+//------------------------------------------------------------------------------
+static void
+BuildChunks (const Params& params, std::mt19937_64& gen, char* buffer,
+             XrdCl::ChunkList& chunks)
+{
+  std::uniform_int_distribution<uint64_t>
+  dist(0, params.mFileSize / params.mChunkSize - 1);
+  chunks.clear();
+
+  for (uint32_t i = 0; i < params.mChunks; i++)
+  {
+    chunks.push_back(XrdCl::ChunkInfo(dist(gen) * params.mChunkSize,
+                                      params.mChunkSize,
+                                      buffer + (uint64_t) i * params.mChunkSize));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Print IOPS, throughput and latency percentiles of a run
+//------------------------------------------------------------------------------
+static void
+Report (const char* name, const Params& params, double elapsed,
+        std::vector<double>& latencies, uint64_t errors)
+{
+  std::sort(latencies.begin(), latencies.end());
+  double sum = 0;
+
+  for (size_t i = 0; i < latencies.size(); i++)
+    sum += latencies[i];
+
+  double nchunks = (double) params.mReadV * params.mChunks;
+  std::cout << name
+            << " iops=" << (uint64_t)(nchunks / elapsed)
+            << " MB/s=" << (uint64_t)(nchunks * params.mChunkSize / elapsed / 1e6)
+            << " readv/s=" << (uint64_t)(params.mReadV / elapsed)
+            << " lat-avg-us=" << (uint64_t)(sum / latencies.size())
+            << " lat-p50-us=" << (uint64_t) latencies[latencies.size() / 2]
+            << " lat-p99-us=" << (uint64_t) latencies[latencies.size() * 99 / 100]
+            << " errors=" << errors << std::endl;
+}
+
+//------------------------------------------------------------------------------
+// Drop the test file from the page cache
+//------------------------------------------------------------------------------
+static void
+DropCache (int fd)
+{
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+//------------------------------------------------------------------------------
+// Synchronous path: one blocking read per chunk
+//------------------------------------------------------------------------------
+static void
+RunSync (const Params& params, int fd)
+{
+  std::vector<char> buffer((uint64_t) params.mChunks * params.mChunkSize);
+  std::vector<double> latencies;
+  std::mt19937_64 gen(0);
+  XrdCl::ChunkList chunks;
+  uint64_t errors = 0;
+  DropCache(fd);
+  Clock::time_point start = Clock::now();
+
+  for (uint64_t n = 0; n < params.mReadV; n++)
+  {
+    BuildChunks(params, gen, &buffer[0], chunks);
+    Clock::time_point t0 = Clock::now();
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+      if (pread(fd, chunks[i].buffer, chunks[i].length, chunks[i].offset) !=
+          (ssize_t) chunks[i].length)
+        errors++;
+    }
+
+    latencies.push_back(std::chrono::duration<double, std::micro>
+                        (Clock::now() - t0).count());
+  }
+
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  Report("sync          ", params, elapsed.count(), latencies, errors);
+}
+
+//------------------------------------------------------------------------------
+// Asynchronous path keeping mInFlight vector reads outstanding
+//------------------------------------------------------------------------------
+static void
+RunAsync (const char* name, const Params& params, int fd, bool use_uring)
+{
+  eos::fst::AsyncIoEngine engine(params.mInFlight * params.mChunks,
+                                 params.mInFlight, use_uring);
+
+  if (use_uring && !engine.UsesUring())
+  {
+    std::cout << name << " not available" << std::endl;
+    return;
+  }
+
+  // one buffer slot per vector read in flight
+  uint64_t slot_size = (uint64_t) params.mChunks * params.mChunkSize;
+  std::vector<char*> slots;
+
+  for (uint32_t i = 0; i < params.mInFlight; i++)
+  {
+    char* ptr = 0;
+
+    if (posix_memalign((void**) &ptr, 4096, slot_size))
+    {
+      std::cerr << "error: cannot allocate buffers" << std::endl;
+      exit(1);
+    }
+
+    slots.push_back(ptr);
+  }
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<uint32_t> free_slots;
+  std::vector<double> latencies;
+  uint64_t errors = 0;
+  uint64_t completed = 0;
+
+  for (uint32_t i = 0; i < params.mInFlight; i++)
+    free_slots.push_back(i);
+
+  std::mt19937_64 gen(0);
+  XrdCl::ChunkList chunks;
+  DropCache(fd);
+  Clock::time_point start = Clock::now();
+
+  for (uint64_t n = 0; n < params.mReadV; n++)
+  {
+    uint32_t slot;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      while (free_slots.empty())
+        cond.wait(lock);
+
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+
+    BuildChunks(params, gen, slots[slot], chunks);
+    Clock::time_point t0 = Clock::now();
+    uint64_t expected = slot_size;
+    engine.SubmitReadV(fd, chunks, [&, slot, t0, expected](int64_t nread)
+    {
+      double lat = std::chrono::duration<double, std::micro>
+                   (Clock::now() - t0).count();
+      std::unique_lock<std::mutex> lock(mutex);
+      latencies.push_back(lat);
+
+      if (nread != (int64_t) expected)
+        errors++;
+
+      completed++;
+      free_slots.push_back(slot);
+      cond.notify_all();
+    });
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (completed < params.mReadV)
+      cond.wait(lock);
+  }
+
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  Report(name, params, elapsed.count(), latencies, errors);
+
+  for (size_t i = 0; i < slots.size(); i++)
+    free(slots[i]);
+}
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main (int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <file> [file_size_mb=1024] "
+              << "[chunks_per_readv=64] [chunk_size=4096] [num_readv=10000] "
+              << "[in_flight=16]" << std::endl;
+    return 1;
+  }
+
+  Params params;
+  params.mPath = argv[1];
+  params.mFileSize = ((argc > 2) ? strtoull(argv[2], 0, 10) : 1024) << 20;
+  params.mChunks = (argc > 3) ? strtoul(argv[3], 0, 10) : 64;
+  params.mChunkSize = (argc > 4) ? strtoul(argv[4], 0, 10) : 4096;
+  params.mReadV = (argc > 5) ? strtoull(argv[5], 0, 10) : 10000;
+  params.mInFlight = (argc > 6) ? strtoul(argv[6], 0, 10) : 16;
+
+  if (!params.mChunks || !params.mChunkSize || !params.mReadV ||
+      !params.mInFlight || (params.mFileSize < params.mChunkSize))
+  {
+    std::cerr << "error: invalid parameters" << std::endl;
+    return 1;
+  }
+
+  int fd = open(params.mPath.c_str(), O_RDWR | O_CREAT, 0600);
+
+  if (fd < 0)
+  {
+    std::cerr << "error: cannot open " << params.mPath << std::endl;
+    return 1;
+  }
+
+  struct stat buf;
+
+  if (fstat(fd, &buf) || ((uint64_t) buf.st_size < params.mFileSize))
+  {
+    // fill the file with real data, sparse files do not hit the disk
+    std::vector<char> block(1 << 20);
+    std::mt19937_64 gen(1);
+
+    for (uint64_t off = 0; off < params.mFileSize; off += block.size())
+    {
+      for (size_t i = 0; i < block.size(); i += sizeof(uint64_t))
+        *reinterpret_cast<uint64_t*>(&block[i]) = gen();
+
+      if (pwrite(fd, &block[0], block.size(), off) != (ssize_t) block.size())
+      {
+        std::cerr << "error: cannot write " << params.mPath << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  std::cout << "file=" << params.mPath << " size=" << params.mFileSize
+            << " chunks/readv=" << params.mChunks
+            << " chunk-size=" << params.mChunkSize
+            << " readv=" << params.mReadV
+            << " in-flight=" << params.mInFlight << std::endl;
+  RunSync(params, fd);
+  RunAsync("thread-pool   ", params, fd, false);
+  RunAsync("io_uring      ", params, fd, true);
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,302 @@
+//------------------------------------------------------------------------------
+// File: EosAuthTransportBenchmark.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// Benchmark of the transport between the authentication proxy and the MGM.
+// A stand-in MGM (ROUTER -> DEALER proxy and REP workers, as in the MGM auth
+// service) answers stat requests after an optional delay, while client
+// threads send requests through an AuthTransport and measure the latency.
+//
+// usage: eosauthbench [threads] [requests/thread] [workers] [delay us] [port]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+/*----------------------------------------------------------------------------*/
+#include "auth_plugin/AuthTransport.hh"
+#include "auth_plugin/ProtoUtils.hh"
+#include "common/Logging.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdOuc/XrdOucErrInfo.hh"
+#include "XrdSec/XrdSecEntity.hh"
+/*----------------------------------------------------------------------------*/
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+/*----------------------------------------------------------------------------*/
+
+using namespace eos::auth;
+
+zmq::context_t* gContext = 0;
+AuthTransport* gTransport = 0;
+int gNumRequests = 10000;
+int gDelay = 0;
+
+//------------------------------------------------------------------------------
+// Per client thread results
+//------------------------------------------------------------------------------
+struct ClientResult
+{
+  ClientResult(): failed(0) {}
+
+  std::vector<uint64_t> latency; // latency of each request in microseconds
+  uint64_t failed;
+};
+
+//------------------------------------------------------------------------------
+// Current time in microseconds
+//------------------------------------------------------------------------------
+static uint64_t
+GetTimeUs()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+//------------------------------------------------------------------------------
+// Stand-in MGM proxy forwarding between the ROUTER and the workers
+//------------------------------------------------------------------------------
+static void*
+MgmProxy(void* arg)
+{
+  std::string endpoint = static_cast<char*>(arg);
+  zmq::socket_t frontend(*gContext, ZMQ_ROUTER);
+  zmq::socket_t backend(*gContext, ZMQ_DEALER);
+  frontend.bind(endpoint.c_str());
+  backend.bind("inproc://authbackend");
+
+  try
+  {
+#if ZMQ_VERSION_MAJOR == 2
+    zmq_device(ZMQ_QUEUE, &frontend, &backend);
+#else
+    zmq::proxy(static_cast<void*>(frontend), static_cast<void*>(backend),
+               static_cast<void*>(0));
+#endif
+  }
+  catch (zmq::error_t& err)
+  {
+    // Context terminated
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Stand-in MGM worker answering every request with SFS_OK
+//------------------------------------------------------------------------------
+static void*
+MgmWorker(void* arg)
+{
+  zmq::socket_t responder(*gContext, ZMQ_REP);
+
+  // The proxy thread may not have bound the backend yet
+  while (true)
+  {
+    try
+    {
+      responder.connect("inproc://authbackend");
+    }
+    catch (zmq::error_t& err)
+    {
+      usleep(1000);
+      continue;
+    }
+
+    break;
+  }
+
+  RequestProto req_proto;
+  ResponseProto resp;
+
+  try
+  {
+    while (true)
+    {
+      zmq::message_t request;
+
+      if (!responder.recv(&request))
+        continue;
+
+      req_proto.ParseFromArray(request.data(), request.size());
+
+      if (gDelay)
+        usleep(gDelay);
+
+      resp.set_response(SFS_OK);
+      int reply_size = resp.ByteSize();
+      zmq::message_t reply(reply_size);
+      google::protobuf::io::ArrayOutputStream aos(reply.data(), reply_size);
+      resp.SerializeToZeroCopyStream(&aos);
+      responder.send(reply, ZMQ_NOBLOCK);
+    }
+  }
+  catch (zmq::error_t& err)
+  {
+    // Context terminated
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Client thread sending stat requests one after the other
+//------------------------------------------------------------------------------
+static void*
+Client(void* arg)
+{
+  ClientResult* result = static_cast<ClientResult*>(arg);
+  XrdOucErrInfo error;
+  XrdSecEntity client("unix");
+  client.name = (char*)"bench";
+  client.host = (char*)"localhost";
+  result->latency.reserve(gNumRequests);
+
+  for (int i = 0; i < gNumRequests; i++)
+  {
+    std::ostringstream sstr;
+    sstr << "/eos/bench/file" << i;
+    RequestProto* req_proto = utils::GetStatRequest(
+                                RequestProto_OperationType_STAT,
+                                sstr.str().c_str(), error, &client, "");
+    req_proto->set_hmac("");
+
+    uint64_t start = GetTimeUs();
+    int msg_size = req_proto->ByteSize();
+    zmq::message_t request(msg_size);
+    google::protobuf::io::ArrayOutputStream aos(request.data(), msg_size);
+    req_proto->SerializeToZeroCopyStream(&aos);
+    uint64_t req_id = gTransport->Send(request);
+    zmq::message_t reply;
+    ResponseProto resp;
+
+    if (req_id && gTransport->Recv(req_id, reply) &&
+        resp.ParseFromArray(reply.data(), reply.size()))
+      result->latency.push_back(GetTimeUs() - start);
+    else
+      result->failed++;
+
+    delete req_proto;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Main function
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int num_threads = (argc > 1) ? atoi(argv[1]) : 64;
+  gNumRequests = (argc > 2) ? atoi(argv[2]) : 10000;
+  int num_workers = (argc > 3) ? atoi(argv[3]) : 16;
+  gDelay = (argc > 4) ? atoi(argv[4]) : 0;
+  int port = (argc > 5) ? atoi(argv[5]) : 25555;
+
+  eos::common::Logging::Init();
+  eos::common::Logging::SetUnit("eosauthbench@localhost");
+  eos::common::Logging::gShortFormat = true;
+  eos::common::Logging::SetLogPriority(LOG_ERR);
+
+  gContext = new zmq::context_t(1);
+  std::ostringstream sstr;
+  sstr << "tcp://127.0.0.1:" << port;
+  std::string bind_endpoint = sstr.str();
+  sstr.str("");
+  sstr << "127.0.0.1:" << port;
+
+  pthread_t proxy_tid;
+  pthread_create(&proxy_tid, 0, MgmProxy, (void*)bind_endpoint.c_str());
+  std::vector<pthread_t> workers(num_workers);
+
+  for (int i = 0; i < num_workers; i++)
+    pthread_create(&workers[i], 0, MgmWorker, 0);
+
+  gTransport = new AuthTransport(gContext, 5000);
+  gTransport->AddBackend(sstr.str());
+
+  if (!gTransport->Start())
+  {
+    fprintf(stderr, "error: unable to start the transport\n");
+    return 1;
+  }
+
+  std::vector<pthread_t> clients(num_threads);
+  std::vector<ClientResult> results(num_threads);
+  uint64_t start = GetTimeUs();
+
+  for (int i = 0; i < num_threads; i++)
+    pthread_create(&clients[i], 0, Client, &results[i]);
+
+  for (int i = 0; i < num_threads; i++)
+    pthread_join(clients[i], 0);
+
+  uint64_t duration = GetTimeUs() - start;
+  std::vector<uint64_t> latency;
+  uint64_t failed = 0;
+
+  for (int i = 0; i < num_threads; i++)
+  {
+    latency.insert(latency.end(), results[i].latency.begin(),
+                   results[i].latency.end());
+    failed += results[i].failed;
+  }
+
+  std::sort(latency.begin(), latency.end());
+  size_t n = latency.size();
+  fprintf(stdout, "# threads=%d workers=%d delay=%dus\n", num_threads,
+          num_workers, gDelay);
+  fprintf(stdout, "ALL      requests                         %lu\n",
+          (unsigned long) n);
+  fprintf(stdout, "ALL      failed                           %lu\n",
+          (unsigned long) failed);
+  fprintf(stdout, "ALL      rate                             %.02f req/s\n",
+          duration ? (1000000.0 * n / duration) : 0.0);
+
+  if (n)
+  {
+    fprintf(stdout, "ALL      latency p50                      %lu us\n",
+            (unsigned long) latency[n * 50 / 100]);
+    fprintf(stdout, "ALL      latency p90                      %lu us\n",
+            (unsigned long) latency[n * 90 / 100]);
+    fprintf(stdout, "ALL      latency p99                      %lu us\n",
+            (unsigned long) latency[n * 99 / 100]);
+    fprintf(stdout, "ALL      latency max                      %lu us\n",
+            (unsigned long) latency[n - 1]);
+  }
+
+  // Closing the context makes the stand-in MGM threads exit
+  delete gTransport;
+  delete gContext;
+  pthread_join(proxy_tid, 0);
+
+  for (int i = 0; i < num_workers; i++)
+    pthread_join(workers[i], 0);
+
+  return (failed ? 1 : 0);
+}
@@ -0,0 +1,281 @@
+//------------------------------------------------------------------------------
+// File: EosQuotaBenchmark.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// Benchmark of the quota admission check done for every write open. Client
+// threads run the lookups of SpaceQuota::CheckWriteQuota (the refresh of the
+// uid/gid usage followed by the reads of the limits and counters) for random
+// users, while a thread keeps changing limits and adding new users as the
+// periodic refresh does. The lock-free QuotaTable is compared with the former
+// map protected by a mutex.
+//
+// usage: eosquotabench [threads] [checks/thread] [users]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <atomic>
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/time.h>
+/*----------------------------------------------------------------------------*/
+#include "mgm/QuotaTable.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+
+// Quota tags, as in SpaceQuota
+enum
+{
+  kUserBytesIs = 1, kUserLogicalBytesIs, kUserFilesIs, kUserBytesTarget,
+  kUserFilesTarget, kGroupBytesIs = 11, kGroupLogicalBytesIs, kGroupFilesIs,
+  kGroupBytesTarget, kGroupFilesTarget
+};
+
+static const unsigned long gProjectId = 99;
+int gNumChecks = 1000000;
+int gNumUsers = 1000;
+std::atomic<bool> gStop(false);
+
+//------------------------------------------------------------------------------
+// Quota values kept in a map protected by a mutex, the former scheme
+//------------------------------------------------------------------------------
+class LockedMap
+{
+public:
+  long long Get(unsigned long long key)
+  {
+    XrdSysMutexHelper lock(mMutex);
+    return mMap[key];
+  }
+
+  void Set(unsigned long long key, long long value)
+  {
+    XrdSysMutexHelper lock(mMutex);
+    mMap[key] = value;
+  }
+
+private:
+  XrdSysMutex mMutex;
+  std::map<unsigned long long, long long> mMap;
+};
+
+//------------------------------------------------------------------------------
+// Current time in microseconds
+//------------------------------------------------------------------------------
+static uint64_t
+GetTimeUs()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+//------------------------------------------------------------------------------
+// Quota index of a tag and an id
+//------------------------------------------------------------------------------
+static inline unsigned long long
+Index(unsigned long tag, unsigned long id)
+{
+  return ((unsigned long long) tag << 32) | id;
+}
+
+//------------------------------------------------------------------------------
+// One admission check, returns true if the write is allowed
+//------------------------------------------------------------------------------
+template<class Table>
+static bool
+Check(Table& table, unsigned long uid, unsigned long gid, long long size)
+{
+  // Usage refreshed from the namespace quota node
+  table.Set(Index(kUserBytesIs, uid), uid * 1000);
+  table.Set(Index(kUserLogicalBytesIs, uid), uid * 500);
+  table.Set(Index(kUserFilesIs, uid), uid);
+  table.Set(Index(kGroupBytesIs, gid), gid * 1000);
+  table.Set(Index(kGroupLogicalBytesIs, gid), gid * 500);
+  table.Set(Index(kGroupFilesIs, gid), gid);
+  // Limits and counters used by the decision
+  long long user_bytes = table.Get(Index(kUserBytesTarget, uid)) -
+                         table.Get(Index(kUserBytesIs, uid));
+  long long user_files = table.Get(Index(kUserFilesTarget, uid)) -
+                         table.Get(Index(kUserFilesIs, uid));
+  long long group_bytes = table.Get(Index(kGroupBytesTarget, gid)) -
+                          table.Get(Index(kGroupBytesIs, gid));
+  long long group_files = table.Get(Index(kGroupFilesTarget, gid)) -
+                          table.Get(Index(kGroupFilesIs, gid));
+  long long proj_bytes = table.Get(Index(kGroupBytesTarget, gProjectId)) -
+                         table.Get(Index(kGroupBytesIs, gProjectId));
+  long long proj_files = table.Get(Index(kGroupFilesTarget, gProjectId)) -
+                         table.Get(Index(kGroupFilesIs, gProjectId));
+  return ((user_bytes > size) && (user_files > 0) && (group_bytes > size) &&
+          (group_files > 0)) || ((proj_bytes > size) && (proj_files > 0));
+}
+
+//------------------------------------------------------------------------------
+// Per client thread arguments and results
+//------------------------------------------------------------------------------
+template<class Table>
+struct ClientArg
+{
+  ClientArg(): table(0), seed(0), allowed(0), duration(0) {}
+
+  Table* table;
+  unsigned int seed;
+  uint64_t allowed;
+  uint64_t duration; // in microseconds
+};
+
+//------------------------------------------------------------------------------
+// Client thread running admission checks for random users
+//------------------------------------------------------------------------------
+template<class Table>
+static void*
+Client(void* arg)
+{
+  ClientArg<Table>* client = static_cast<ClientArg<Table>*>(arg);
+  uint64_t start = GetTimeUs();
+
+  for (int i = 0; i < gNumChecks; i++)
+  {
+    unsigned long uid = 1 + rand_r(&client->seed) % gNumUsers;
+
+    if (Check(*client->table, uid, uid % 100, 4096))
+      client->allowed++;
+  }
+
+  client->duration = GetTimeUs() - start;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Updater thread changing limits and adding users until the clients are done
+//------------------------------------------------------------------------------
+template<class Table>
+static void*
+Updater(void* arg)
+{
+  Table* table = static_cast<Table*>(arg);
+  unsigned int seed = 1;
+  unsigned long new_uid = gNumUsers + 1;
+
+  while (!gStop)
+  {
+    for (int i = 0; i < 1000; i++)
+    {
+      unsigned long uid = 1 + rand_r(&seed) % gNumUsers;
+      table->Set(Index(kUserBytesTarget, uid), 1ll << (30 + rand_r(&seed) % 4));
+    }
+
+    // New users appear and get their default quota
+    table->Set(Index(kUserBytesTarget, new_uid), 1ll << 30);
+    table->Set(Index(kUserFilesTarget, new_uid), 1000000);
+    new_uid++;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Run the benchmark on a table and print the results
+//------------------------------------------------------------------------------
+template<class Table>
+static void
+Run(const char* name, int num_threads)
+{
+  Table table;
+
+  for (int uid = 1; uid <= gNumUsers; uid++)
+  {
+    table.Set(Index(kUserBytesTarget, uid), 1ll << 30);
+    table.Set(Index(kUserFilesTarget, uid), 1000000);
+  }
+
+  for (int gid = 0; gid < 100; gid++)
+  {
+    table.Set(Index(kGroupBytesTarget, gid), 1ll << 40);
+    table.Set(Index(kGroupFilesTarget, gid), 100000000);
+  }
+
+  gStop = false;
+  pthread_t updater;
+  pthread_create(&updater, 0, Updater<Table>, &table);
+  std::vector<pthread_t> clients(num_threads);
+  std::vector< ClientArg<Table> > args(num_threads);
+  uint64_t start = GetTimeUs();
+
+  for (int i = 0; i < num_threads; i++)
+  {
+    args[i].table = &table;
+    args[i].seed = i + 1;
+    pthread_create(&clients[i], 0, Client<Table>, &args[i]);
+  }
+
+  for (int i = 0; i < num_threads; i++)
+    pthread_join(clients[i], 0);
+
+  uint64_t duration = GetTimeUs() - start;
+  gStop = true;
+  pthread_join(updater, 0);
+  uint64_t allowed = 0;
+  uint64_t busy = 0;
+
+  for (int i = 0; i < num_threads; i++)
+  {
+    allowed += args[i].allowed;
+    busy += args[i].duration;
+  }
+
+  uint64_t n = (uint64_t) num_threads * gNumChecks;
+  fprintf(stdout, "%-8s checks                           %lu\n", name,
+          (unsigned long) n);
+  fprintf(stdout, "%-8s allowed                          %lu\n", name,
+          (unsigned long) allowed);
+  fprintf(stdout, "%-8s rate                             %.02f checks/s\n",
+          name, duration ? (1000000.0 * n / duration) : 0.0);
+  fprintf(stdout, "%-8s latency                          %.02f ns/check\n",
+          name, n ? (1000.0 * busy / n) : 0.0);
+}
+
+//------------------------------------------------------------------------------
+// Main function
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int num_threads = (argc > 1) ? atoi(argv[1]) : 16;
+  gNumChecks = (argc > 2) ? atoi(argv[2]) : 1000000;
+  gNumUsers = (argc > 3) ? atoi(argv[3]) : 1000;
+
+  if ((num_threads <= 0) || (gNumChecks <= 0) || (gNumUsers <= 0))
+  {
+    fprintf(stderr, "usage: eosquotabench [threads] [checks/thread] [users]\n");
+    return 1;
+  }
+
+  fprintf(stdout, "# threads=%d checks/thread=%d users=%d\n", num_threads,
+          gNumChecks, gNumUsers);
+  Run<eos::mgm::QuotaTable>("TABLE", num_threads);
+  Run<LockedMap>("MUTEX", num_threads);
+  return 0;
+}